@@ -0,0 +1,399 @@
+/*
+ * alloc-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Stress and fragmentation benchmark for the pool.h size classes behind
+ * malloc() (heap.c), against a model of newlib-nano's malloc() - first
+ * fit on an address-ordered free list, splitting and coalescing - given
+ * the same number of bytes.
+ *
+ * A random mix of sizes, in proportion to the classes, is allocated and
+ * freed while the number of live blocks rises and falls to MAX_LIVE. Every block is filled with a
+ * pattern that is checked when it is freed. For each allocator we report
+ * failed requests, those that failed although enough bytes were free
+ * (fragmentation), and the most work one call did: pools or free-list
+ * chunks looked at. (Host time would mostly measure the simulated
+ * PRIMASK, so it is not shown.) Then the scratch arenas, calloc() and
+ * realloc() are checked, and every class must be whole again at the end.
+ *
+ * Usage: alloc-bench [--ops N] [--seed S] [--check]
+ *   --check  exit with status 1 on a corrupted or lost block, a class
+ *            that is not whole at the end, a pool call that looked at
+ *            more than POOL_NUM_CLASSES pools, or an arena that misbehaves
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "pool.h"
+
+// heap.c, renamed by the Makefile
+void *heap_malloc(size_t size);
+void heap_free(void *ptr);
+void *heap_calloc(size_t n, size_t size);
+void *heap_realloc(void *ptr, size_t size);
+
+#define MAX_LIVE 256U
+
+static uint32_t rng = 1;
+
+static uint32_t next_rand(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+// The classes are meant to be sized for the program's own requests, so
+// draw them as if they had been: a class in proportion to its count, and
+// any size it is the best fit for
+static uint32_t random_size(void) {
+  uint32_t total = 0, below = 0;
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) total += pool_class(i)->count;
+  uint32_t r = next_rand() % total;
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    const pool_t *p = pool_class(i);
+    if (r < p->count) return below + 1U + next_rand() % (p->block_size - below);
+    r -= p->count;
+    below = p->block_size;
+  }
+  return 1;
+}
+
+//// newlib-nano malloc() model, on a byte array
+
+#define NANO_NONE   0xFFFFFFFFU
+#define NANO_HDR    8U   // Size word, padded to keep the payload 8-aligned
+#define NANO_MIN    16U
+
+typedef struct {
+  uint8_t *mem;
+  uint32_t budget;
+  uint32_t brk;       // Like _sbrk(): the heap grows up to budget
+  uint32_t free_head; // Offset of the first free chunk, by address
+  uint32_t free_bytes;
+  uint32_t steps;     // Chunks looked at by the last call
+} nano_t;
+
+static uint32_t *nano_word(nano_t *h, uint32_t at) {
+  return (uint32_t *)(h->mem + at);
+}
+#define NANO_SIZE(H, C) (*nano_word((H), (C)))
+#define NANO_NEXT(H, C) (*nano_word((H), (C) + 4U))
+
+static void *nano_malloc(nano_t *h, uint32_t size) {
+  uint32_t need = (size + NANO_HDR + 7U) & ~7U;
+  if (need < NANO_MIN) need = NANO_MIN;
+  h->steps = 0;
+
+  for (uint32_t prev = NANO_NONE, c = h->free_head; c != NANO_NONE;
+       prev = c, c = NANO_NEXT(h, c)) {
+    h->steps++;
+    uint32_t have = NANO_SIZE(h, c);
+    if (have < need) continue;
+    h->free_bytes -= need;
+    if (have - need >= NANO_MIN) {
+      // Hand out the top of the chunk, leaving the rest on the list
+      NANO_SIZE(h, c) = have - need;
+      c += have - need;
+      NANO_SIZE(h, c) = need;
+    } else {
+      h->free_bytes -= have - need;
+      if (prev == NANO_NONE) h->free_head = NANO_NEXT(h, c);
+      else NANO_NEXT(h, prev) = NANO_NEXT(h, c);
+    }
+    return h->mem + c + NANO_HDR;
+  }
+
+  if (h->budget - h->brk < need) return NULL;
+  uint32_t c = h->brk;
+  h->brk += need;
+  NANO_SIZE(h, c) = need;
+  return h->mem + c + NANO_HDR;
+}
+
+static void nano_free(nano_t *h, void *ptr) {
+  uint32_t c = (uint32_t)((uint8_t *)ptr - h->mem) - NANO_HDR;
+  uint32_t prev = NANO_NONE, r = h->free_head;
+  h->steps = 0;
+  h->free_bytes += NANO_SIZE(h, c);
+
+  while (r != NANO_NONE && r < c) {
+    h->steps++;
+    prev = r;
+    r = NANO_NEXT(h, r);
+  }
+  if (prev != NANO_NONE && prev + NANO_SIZE(h, prev) == c) {
+    NANO_SIZE(h, prev) += NANO_SIZE(h, c);
+    c = prev;
+  } else if (prev != NANO_NONE) {
+    NANO_NEXT(h, prev) = c;
+  } else {
+    h->free_head = c;
+  }
+  if (r != NANO_NONE && c + NANO_SIZE(h, c) == r) {
+    NANO_SIZE(h, c) += NANO_SIZE(h, r);
+    NANO_NEXT(h, c) = NANO_NEXT(h, r);
+  } else {
+    NANO_NEXT(h, c) = r;
+  }
+}
+
+//// The workload
+
+typedef struct {
+  const char *name;
+  uint64_t allocs, frees, failed, fragmented;
+  uint32_t max_alloc_steps, max_free_steps;
+  uint64_t corrupt;
+} result_t;
+
+typedef struct {
+  uint8_t *ptr;
+  uint32_t size;
+  uint8_t tag;
+} live_t;
+
+static nano_t nano;
+static int use_nano;
+
+static uint32_t first_class(uint32_t size) {
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    if (size <= pool_class(i)->block_size) return i;
+  }
+  return POOL_NUM_CLASSES;
+}
+
+static uint32_t class_of(const void *ptr) {
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    if (pool_owns(pool_class(i), ptr)) return i;
+  }
+  return POOL_NUM_CLASSES;
+}
+
+// Bytes the pools could still hand out to a request of this size
+static uint32_t pool_free_bytes(void) {
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    const pool_t *p = pool_class(i);
+    n += (p->count - p->used) * p->block_size;
+  }
+  return n;
+}
+
+static void do_alloc(result_t *r, live_t *l, uint32_t size) {
+  uint32_t steps;
+  if (use_nano) {
+    l->ptr = (uint8_t *)nano_malloc(&nano, size);
+    steps = nano.steps;
+  } else {
+    l->ptr = (uint8_t *)heap_malloc(size);
+    // Classes looked at: from the first that fits to the one that served
+    uint32_t first = first_class(size);
+    steps = (l->ptr ? class_of(l->ptr) : POOL_NUM_CLASSES) - first + (l->ptr ? 1U : 0U);
+  }
+  r->allocs++;
+  if (steps > r->max_alloc_steps) r->max_alloc_steps = steps;
+
+  if (!l->ptr) {
+    r->failed++;
+    uint32_t free_bytes = use_nano ? nano.free_bytes + nano.budget - nano.brk : pool_free_bytes();
+    if (free_bytes >= size + (use_nano ? NANO_HDR : 0U)) r->fragmented++;
+    return;
+  }
+  l->size = size;
+  l->tag = (uint8_t)next_rand();
+  memset(l->ptr, l->tag, size);
+}
+
+static void do_free(result_t *r, live_t *l) {
+  for (uint32_t k = 0; k < l->size; k++) {
+    if (l->ptr[k] != l->tag) {
+      r->corrupt++;
+      break;
+    }
+  }
+  uint32_t steps;
+  if (use_nano) {
+    nano_free(&nano, l->ptr);
+    steps = nano.steps;
+  } else {
+    uint32_t c = class_of(l->ptr);
+    heap_free(l->ptr);
+    steps = c + 1U;
+  }
+  r->frees++;
+  if (steps > r->max_free_steps) r->max_free_steps = steps;
+  l->ptr = NULL;
+}
+
+static void run(result_t *r, uint32_t ops, uint32_t seed) {
+  static live_t live[MAX_LIVE];
+  uint32_t n = 0;
+  rng = seed;
+
+  for (uint32_t i = 0; i < ops; i++) {
+    // The live count swings between a few and MAX_LIVE every 4096 calls
+    uint32_t phase = i % 4096U;
+    uint32_t target = 8U + (MAX_LIVE - 8U) * (phase < 2048U ? phase : 4096U - phase) / 2048U;
+    if (n < target && next_rand() % 4U != 0U) {
+      do_alloc(r, &live[n], random_size());
+      if (live[n].ptr) n++;
+    } else if (n) {
+      uint32_t k = next_rand() % n;
+      do_free(r, &live[k]);
+      live[k] = live[--n];
+    }
+  }
+  while (n) do_free(r, &live[--n]);
+}
+
+static void print_result(const result_t *r) {
+  printf("%-12s %9llu %8llu %10llu %10lu %10lu %8llu\n", r->name,
+         (unsigned long long)r->allocs, (unsigned long long)r->failed,
+         (unsigned long long)r->fragmented, (unsigned long)r->max_alloc_steps,
+         (unsigned long)r->max_free_steps, (unsigned long long)r->corrupt);
+}
+
+//// Arenas, calloc() and realloc()
+
+static int check_arena(void) {
+  static uint8_t buf[1024 + 3];
+  arena_t a;
+  int ok = 1;
+
+  arena_init(&a, "scratch", buf + 3, 1024);
+  ok &= ((uintptr_t)a.base & 7U) == 0 && a.size <= 1024U;
+
+  uint32_t outer = arena_mark(&a);
+  {
+    ARENA_SCOPE(&a);
+    char *x = (char *)arena_alloc(&a, 5);
+    ok &= x != NULL && ((uintptr_t)x & 7U) == 0;
+    {
+      ARENA_SCOPE(&a);
+      uint32_t inner = arena_mark(&a);
+      while (arena_alloc(&a, 100)) { }
+      ok &= a.failures == 1U && a.peak <= a.size && inner == 8U;
+    }
+    ok &= arena_mark(&a) == 8U;
+  }
+  ok &= arena_mark(&a) == outer && arena_alloc(&a, 0xFFFFFFFFU) == NULL;
+  printf("arena: scopes released to %lu bytes, peak %lu of %lu: %s\n",
+         (unsigned long)a.top, (unsigned long)a.peak, (unsigned long)a.size,
+         ok ? "ok" : "WRONG");
+  return ok;
+}
+
+static int check_calloc_realloc(void) {
+  int ok = 1;
+  uint8_t *p = (uint8_t *)heap_calloc(10, 3);
+  for (uint32_t k = 0; p && k < 30U; k++) ok &= p[k] == 0;
+  memset(p, 0x5A, 30);
+  uint8_t *q = (uint8_t *)heap_realloc(p, 31);
+  ok &= q == p;                               // Still fits its 32-byte block
+  q = (uint8_t *)heap_realloc(q, 200);
+  for (uint32_t k = 0; q && k < 30U; k++) ok &= q[k] == 0x5A;
+  ok &= pool_block_size(q) == 256U;
+  heap_free(q);
+  ok &= heap_calloc(0x10000, 0x10000) == NULL && heap_malloc(5000) == NULL;
+  uint32_t bad = pool_bad_frees();
+  heap_free(&ok);
+  ok &= pool_bad_frees() == bad + 1U;
+  printf("calloc/realloc: %s\n", ok ? "ok" : "WRONG");
+  return ok;
+}
+
+// Every class must be back to all free, and hand out each block once
+static int check_whole(void) {
+  static void *blocks[1024];
+  int ok = 1;
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    pool_t *p = pool_class(i);
+    ok &= p->used == 0U;
+    uint32_t n = 0;
+    while (n < 1024U && (blocks[n] = pool_alloc(p)) != NULL) n++;
+    ok &= n == p->count;
+    for (uint32_t a = 0; a < n; a++) {
+      ok &= pool_owns(p, blocks[a]);
+      for (uint32_t b = a + 1U; b < n && b < a + 8U; b++) ok &= blocks[a] != blocks[b];
+    }
+    while (n) pool_free(p, blocks[--n]);
+  }
+  printf("classes whole again: %s\n", ok ? "yes" : "NO");
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  uint32_t ops = 1000000;
+  uint32_t seed = 12345;
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--ops") && i + 1 < argc) {
+      ops = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      seed = (uint32_t)strtoul(argv[++i], NULL, 0) | 1U;
+    } else if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--ops N] [--seed S] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  uint32_t budget = 0;
+  printf("size classes:");
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    const pool_t *p = pool_class(i);
+    printf(" %lux%lu", (unsigned long)p->block_size, (unsigned long)p->count);
+    budget += p->block_size * p->count;
+  }
+  printf(" = %lu bytes, also given to the first-fit heap\n\n", (unsigned long)budget);
+
+  result_t pools = { "pool classes", 0, 0, 0, 0, 0, 0, 0 };
+  result_t first = { "first fit", 0, 0, 0, 0, 0, 0, 0 };
+
+  use_nano = 0;
+  run(&pools, ops, seed);
+
+  nano.mem = (uint8_t *)calloc(budget, 1);
+  nano.budget = budget;
+  nano.brk = 0;
+  nano.free_head = NANO_NONE;
+  nano.free_bytes = 0;
+  use_nano = 1;
+  run(&first, ops, seed);
+  free(nano.mem);
+
+  printf("%-12s %9s %8s %10s %10s %10s %8s\n", "allocator", "allocs", "failed",
+         "fragmented", "alloc steps", "free steps", "corrupt");
+  print_result(&pools);
+  print_result(&first);
+  printf("(steps: the most size classes, or free-list chunks, one call looked at)\n\n");
+
+  int ok = !pools.corrupt && !first.corrupt && pools.max_alloc_steps <= POOL_NUM_CLASSES &&
+           pools.max_free_steps <= POOL_NUM_CLASSES && pools.allocs - pools.failed == pools.frees;
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    const pool_t *p = pool_class(i);
+    printf("%-8s peak %4lu of %4lu, empty %lu times\n", p->name, (unsigned long)p->peak,
+           (unsigned long)p->count, (unsigned long)p->failures);
+  }
+  printf("\n");
+
+  ok &= check_arena();
+  ok &= check_calloc_realloc();
+  ok &= check_whole();
+
+  if (check && !ok) {
+    fprintf(stderr, "FAIL: a block was corrupted or lost, or a call was not bounded\n");
+    return 1;
+  }
+  return 0;
+}
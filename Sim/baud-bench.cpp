@@ -0,0 +1,335 @@
+/*
+ * baud-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * The console line's rate (Src/baud.h) over the simulated USART3: auto-
+ * baud at start-up, then negotiation by baud-host.h, then bulk traffic at
+ * the rate agreed.
+ *
+ * The USART runs from the HSI, as power_init() leaves it in main.c, so
+ * 2Mbaud is the fastest it reaches (16MHz with OVER8) and 3Mbaud is never
+ * offered.
+ *
+ * Auto-baud: a host at each of several rates sends 'U' first, and the
+ * port must lock on to that rate and then answer a ping at it. Also a
+ * host at 115200 whose first byte is a key, which must reach the console
+ * as it is, and a host whose first byte is not 'U' and garbled, which
+ * must be dropped before its 'U' locks.
+ *
+ * Negotiation: from 115200 (and once from an auto-baud rate) up to
+ * 3Mbaud, on a clean line; on one that damages bytes above 1Mbaud both
+ * ways; and on one that damages only the firmware's output above 460800,
+ * so VERIFY gets through and its echo does not. Each must end with both
+ * ends at the same rate, the fastest the line carries: where a trial
+ * failed, both must have fallen back on their own, and update.c's BEGIN
+ * must not offer the failed rate either. A line gives the rate, the time
+ * it took, the trials and fallbacks, and then the KB/s of 64-byte pings
+ * kept CMD_QUEUE_LEN deep at that rate, against the same at 115200.
+ *
+ * The host's side of the line runs at the rate it set: a byte sent or
+ * received while the two sides disagree arrives damaged, as in
+ * update-bench; while auto-baud waits, sim.cpp decides.
+ *
+ * Usage: baud-bench [--check]
+ *   --check  exit with status 1 if auto-baud locks on to the wrong rate or
+ *            drops a key, a negotiation ends anywhere but the best rate
+ *            the line carries or with the ends apart, or pings at a
+ *            negotiated rate lose a byte or run under MIN_SPEEDUP times
+ *            faster than at 115200 on a clean line
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "baud.h"
+#include "baud-host.h"
+#include "clock.h"
+#include "cmd.h"
+#include "cmd-host.h"
+#include "console.h"
+#include "critical.h"
+#include "tick.h"
+#include "uart.h"
+#include "update.h"
+
+// Drivers from Src/main.c (which has no header of its own)
+void uart3_rxtx_init(void);
+
+#define HOME_BAUD 115200U
+#define MAX_BAUD 3000000U
+#define HOST_QUEUE (1U << 16)
+#define PINGS 400U
+#define AUTOBAUD_PINGS 8U
+#define MIN_SPEEDUP 8.0
+#define DAMAGE_EVERY 16U // On a line above its rate, one byte in this many
+
+static const cmd_entry_t commands[] = {
+  { 0x01, 0, CMD_PAYLOAD_MAX, "ping", cmd_ping },
+  { BAUD_CMD_PROPOSE, 4, 4, "baud-propose", baud_propose },
+  { BAUD_CMD_VERIFY, BAUD_PATTERN_LEN, BAUD_PATTERN_LEN, "baud-verify", baud_verify },
+  { BAUD_CMD_COMMIT, 0, 0, "baud-commit", baud_commit },
+};
+
+// Bytes from the host waiting to go onto the line, in order
+static uint8_t host_q[HOST_QUEUE];
+static uint32_t host_head, host_tail;
+static uint32_t host_baud;
+
+// Rates above these damage bytes to and from the firmware (0: none do)
+static uint32_t up_max, down_max;
+static uint32_t up_count, down_count;
+
+static cmd_client_t client;
+static baud_host_t host;
+static int locked;
+
+// The two sides of the line agree on the rate to within 2%
+static int line_agrees(void) {
+  double dev = 10.0 * sim_core_hz / (double)sim_usart_frame_cycles(USART3);
+  double d = dev - (double)host_baud;
+  return d < 0.02 * dev && -d < 0.02 * dev;
+}
+
+static void host_send(cmd_client_t *c, const uint8_t *buf, size_t len) {
+  (void)c;
+  for (size_t i = 0; i < len; i++) host_q[host_head++ % HOST_QUEUE] = buf[i];
+}
+
+static int rx_from_host(USART_TypeDef *usart) {
+  (void)usart;
+  if (host_tail == host_head) return -1;
+  uint8_t b = host_q[host_tail++ % HOST_QUEUE];
+  if (uart_port(UART_USART3)->autobaud == UART_AUTOBAUD_WAITING) return b;
+  if (!line_agrees()) return b ^ 0xA5U;
+  if (up_max && host_baud > up_max && ++up_count % DAMAGE_EVERY == 0) b ^= 0x10U;
+  return b;
+}
+
+static void to_host(USART_TypeDef *usart, uint8_t c) {
+  (void)usart;
+  if (!line_agrees()) c ^= 0xA5U;
+  if (down_max && host_baud > down_max && ++down_count % DAMAGE_EVERY == 0) c ^= 0x10U;
+  cmd_client_feed(&client, &c, 1);
+}
+
+static void set_host_baud(baud_host_t *b, uint32_t baud) {
+  (void)b;
+  host_baud = baud;
+}
+
+// main.c's loop: handle requests and the line's rate, else sleep until
+// the next interrupt
+static void firmware_step(void) {
+  cmd_poll();
+  if (baud_poll()) locked = 1;
+  uint32_t primask = critical_enter();
+  if (!cmd_pending()) __WFI();
+  critical_exit(primask);
+}
+
+static void run_for_ms(uint32_t ms) {
+  uint64_t until = sim_now_ns() + ms * 1000000ULL;
+  while (sim_now_ns() < until) firmware_step();
+}
+
+// Reset, and main.c's start-up as far as auto-baud; the host is at `baud`
+static void reset(uint32_t baud) {
+  sim_reset();
+  clock_init();
+  tick_init(clock_hclk_hz());
+  uart3_rxtx_init();
+  console_init();
+  uart_set_clock(uart_port(UART_USART3), UART_CLK_HSI); // As power_init() does
+  sim_usart_set_tx_sink(USART3, to_host);
+  sim_usart_set_rx_source(USART3, rx_from_host);
+  sim_usart_set_far_baud(USART3, baud);
+  cmd_init(commands, sizeof(commands) / sizeof(commands[0]));
+  baud_init();
+  cmd_client_init(&client);
+  client.send = host_send;
+  host_head = host_tail = 0;
+  host_baud = baud;
+  up_max = down_max = 0;
+  up_count = down_count = 0;
+  locked = 0;
+}
+
+// Pings answered with the payload they went with
+static uint32_t pongs, bad_pongs;
+
+static void got_pong(cmd_client_t *c, const cmd_response_t *r) {
+  (void)c;
+  int same = r->status == CMD_OK && r->len == CMD_PAYLOAD_MAX;
+  for (uint32_t i = 0; same && i < CMD_PAYLOAD_MAX; i++) same = r->payload[i] == (uint8_t)(r->seq + i);
+  if (same) {
+    pongs++;
+  } else {
+    bad_pongs++;
+  }
+}
+
+// n 64-byte pings, CMD_QUEUE_LEN outstanding; returns payload KB/s both
+// ways, or 0 if any went wrong
+static double pings(uint32_t n) {
+  uint8_t p[CMD_PAYLOAD_MAX];
+  uint32_t sent = 0;
+
+  cmd_client_init(&client);
+  client.send = host_send;
+  client.response = got_pong;
+  pongs = bad_pongs = 0;
+  uint64_t t0 = sim_now_ns(), give_up = t0 + 10000000000ULL;
+  while (pongs + bad_pongs < n && sim_now_ns() < give_up) {
+    while (sent < n && client.outstanding < CMD_QUEUE_LEN) {
+      for (uint32_t i = 0; i < CMD_PAYLOAD_MAX; i++) p[i] = (uint8_t)(client.next_seq + i);
+      cmd_client_request(&client, 0x01, p, sizeof(p), sim_now_ns());
+      sent++;
+    }
+    firmware_step();
+  }
+  double s = (double)(sim_now_ns() - t0) / 1e9;
+  if (pongs != n || bad_pongs) return 0.0;
+  return 2.0 * n * CMD_PAYLOAD_MAX / 1024.0 / s;
+}
+
+// The host sends `first` and, unless it is 'U', a 'U' after it, at baud;
+// auto-baud must lock on to `want` (0: keep the home rate, and pass
+// `first` to the console)
+static void autobaud(uint32_t baud, uint8_t first, uint32_t want, int *ok) {
+  uart_port_t *p = uart_port(UART_USART3);
+
+  reset(baud);
+  uint32_t failed = p->rx_stats.autobaud;
+  host_q[host_head++] = first;
+  if (first != 'U') {
+    run_for_ms(2);
+    host_q[host_head++] = 'U';
+  }
+  uint64_t t0 = sim_now_ns(), give_up = t0 + 20000000ULL;
+  while (!locked && sim_now_ns() < give_up) firmware_step();
+  double us = (double)(sim_now_ns() - t0) / 1e3;
+  run_for_ms(1);
+
+  uint8_t key = 0;
+  int got_key = uart_try_read(&key);
+  double kbs = pings(AUTOBAUD_PINGS);
+  const baud_stats_t *st = baud_stats();
+
+  int good = kbs > 0.0 && p->baud == host_baud;
+  const char *what;
+  if (want) {
+    good &= locked && p->baud == want && st->autobaud == want && !got_key &&
+            p->rx_stats.autobaud == failed + (first != 'U');
+    what = first == 'U' ? "locked" : "locked after a bad byte";
+  } else {
+    good &= !locked && p->baud == HOME_BAUD && got_key && key == first && !st->autobaud &&
+            p->autobaud == UART_AUTOBAUD_KEPT;
+    what = "kept, key passed on";
+  }
+  printf("%8lu  0x%02x %-24s %8lu %8.0f %8.1f  %s\n", (unsigned long)baud, first, what,
+         (unsigned long)p->baud, want ? us : 0.0, kbs, good ? "ok" : "FAILED");
+  if (!good) *ok = 0;
+}
+
+typedef struct {
+  const char *name;
+  uint32_t from;          // The host's rate at reset, found by auto-baud
+  uint32_t up_max, down_max;
+  uint32_t want;          // Where it must end; 0: the fastest the USART reaches
+  uint32_t fallbacks;     // The firmware's, at least
+} run_t;
+
+static void negotiate(const run_t *r, double home_kbs, int *ok) {
+  uart_port_t *p = uart_port(UART_USART3);
+
+  reset(r->from);
+  if (r->from != HOME_BAUD) {
+    host_q[host_head++] = 'U';
+    while (!locked) firmware_step();
+  }
+  run_for_ms(1);
+  uint32_t want = r->want ? r->want : baud_pick(MAX_BAUD, BAUD_MAX_PPM);
+  up_max = r->up_max;
+  down_max = r->down_max;
+
+  cmd_client_init(&client);
+  client.send = host_send;
+  host.set_baud = set_host_baud;
+  baud_host_init(&host, &client, host_baud, MAX_BAUD);
+  uint64_t give_up = sim_now_ns() + 10000000000ULL;
+  while (baud_host_poll(&host, sim_now_ns()) && sim_now_ns() < give_up) firmware_step();
+  double ms = (double)(host.done_at - host.started_at) / 1e6;
+
+  // Anything the firmware still has to do to its side
+  run_for_ms(BAUD_WINDOW_MS + 50U);
+  const baud_stats_t *st = baud_stats();
+  int together = p->baud == host_baud;
+  double kbs = pings(PINGS);
+
+  printf("%-14s %8lu %8lu %8.1f %6lu %6lu %8.1f %6.1fx  %-6s %s\n", r->name,
+         (unsigned long)r->from, (unsigned long)host.baud, ms, (unsigned long)host.trials,
+         (unsigned long)st->fallbacks, kbs, home_kbs ? kbs / home_kbs : 0.0,
+         baud_host_state_name(host.state), together ? "together" : "APART");
+
+  int good = host.state == BAUD_HOST_DONE && together && host.baud == want && kbs > 0.0 &&
+             st->committed == 1U && st->fallbacks >= r->fallbacks &&
+             host.fallbacks >= r->fallbacks;
+  // A failed rate stays failed, for update.c's BEGIN too
+  if (r->fallbacks) good &= baud_pick(MAX_BAUD, UPDATE_BAUD_MAX_PPM) == want;
+  if (!r->up_max && !r->down_max) good &= kbs >= MIN_SPEEDUP * home_kbs;
+  if (!good) {
+    printf("  FAIL: expected both ends at %lu baud after %lu fallbacks\n", (unsigned long)want,
+           (unsigned long)r->fallbacks);
+    *ok = 0;
+  }
+}
+
+int main(int argc, char **argv) {
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  int ok = 1;
+  reset(HOME_BAUD);
+  printf("console on the HSI: fastest rate %lu of %u asked for, window %ums\n\n",
+         (unsigned long)baud_pick(MAX_BAUD, BAUD_MAX_PPM), MAX_BAUD, BAUD_WINDOW_MS);
+
+  printf("%8s  %-4s %-24s %8s %8s %8s\n", "host", "sent", "auto-baud", "baud", "us", "KB/s");
+  static const uint32_t rates[] = { 9600, 57600, 115200, 230400, 460800, 1000000 };
+  for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) autobaud(rates[i], 'U', rates[i], &ok);
+  autobaud(HOME_BAUD, 'x', 0, &ok);
+  autobaud(460800, 'x', 460800, &ok);
+
+  reset(HOME_BAUD);
+  double home_kbs = pings(PINGS);
+  printf("\n%-14s %8s %8s %8s %6s %6s %8s %7s  %-6s %s\n", "negotiation", "from", "baud", "ms",
+         "trials", "backs", "KB/s", "of 115k", "result", "ends");
+  static const run_t runs[] = {
+    { "clean", HOME_BAUD, 0, 0, 0, 0 },
+    { "clean", 230400, 0, 0, 0, 0 },
+    { "1M line", HOME_BAUD, 1000000, 1000000, 1000000, 1 },
+    { "echo lost", HOME_BAUD, 0, 460800, 460800, 1 },
+  };
+  for (unsigned i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) negotiate(&runs[i], home_kbs, &ok);
+  printf("\n");
+
+  if (check && !ok) {
+    fprintf(stderr, "FAIL: auto-baud or a negotiation went wrong, or bulk traffic was under %.0fx "
+            "115200 on a clean line\n", MIN_SPEEDUP);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,200 @@
+/*
+ * baud-host.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See baud-host.h, and Src/baud.h for the commands.
+ */
+
+#include <string.h>
+
+#include "baud-host.h"
+#include "baud.h"
+
+// How long each request may go unanswered, in ns: a VERIFY frame takes
+// under 7ms each way at 115200
+#define TIMEOUT_NS 100000000ULL
+// PROPOSE is tried for longer than a window: if its answer was lost, the
+// firmware may be on trial and deaf to it until the window ends
+#define PROPOSE_ATTEMPTS (BAUD_WINDOW_MS * 1000000ULL / TIMEOUT_NS + 3U)
+#define VERIFY_ATTEMPTS  2U
+#define COMMIT_ATTEMPTS  3U
+// After the window, for the firmware's main loop to get round to it
+#define BACK_MARGIN_NS   20000000ULL
+
+static inline uint32_t get_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static void change_baud(baud_host_t *b, uint32_t baud) {
+  b->baud = baud;
+  if (b->set_baud) b->set_baud(b, baud);
+}
+
+static void send_propose(baud_host_t *b) {
+  uint8_t p[4];
+  put_le32(p, b->max_baud);
+  b->state = BAUD_HOST_PROPOSE;
+  b->attempts++;
+  cmd_client_request(b->cmd, BAUD_CMD_PROPOSE, p, sizeof(p), b->now);
+}
+
+static void send_verify(baud_host_t *b) {
+  uint8_t p[BAUD_PATTERN_LEN];
+  for (uint32_t i = 0; i < BAUD_PATTERN_LEN; i++) p[i] = baud_pattern(i);
+  b->state = BAUD_HOST_VERIFY;
+  b->attempts++;
+  cmd_client_request(b->cmd, BAUD_CMD_VERIFY, p, sizeof(p), b->now);
+}
+
+static void send_commit(baud_host_t *b) {
+  b->state = BAUD_HOST_COMMIT;
+  b->attempts++;
+  cmd_client_request(b->cmd, BAUD_CMD_COMMIT, NULL, 0, b->now);
+}
+
+static void finish(baud_host_t *b, baud_host_state_t s) {
+  b->state = s;
+  b->done_at = b->now;
+}
+
+// Give the trial rate up: wait for the firmware to, then go back and ask
+// for less
+static void fall_back(baud_host_t *b) {
+  b->fallbacks++;
+  b->state = BAUD_HOST_BACK;
+  b->until = b->changed_at + (uint64_t)b->window_ms * 1000000ULL + BACK_MARGIN_NS;
+}
+
+static void got_response(cmd_client_t *c, const cmd_response_t *r) {
+  baud_host_t *b = (baud_host_t *)c->ctx;
+
+  switch (r->id) {
+  case BAUD_CMD_PROPOSE:
+    if (b->state != BAUD_HOST_PROPOSE) break;
+    if (r->status != CMD_OK || r->len < 8U) {
+      finish(b, BAUD_HOST_FAILED);
+      break;
+    }
+    b->trial = get_le32(r->payload);
+    b->window_ms = get_le32(r->payload + 4);
+    b->attempts = 0;
+    if (b->trial == b->baud) {
+      finish(b, BAUD_HOST_DONE);
+      break;
+    }
+    b->trials++;
+    change_baud(b, b->trial);
+    b->changed_at = b->now;
+    b->until = b->now + BAUD_SETTLE_MS * 1000000ULL;
+    b->state = BAUD_HOST_SETTLE;
+    break;
+
+  case BAUD_CMD_VERIFY: {
+    if (b->state != BAUD_HOST_VERIFY) break;
+    int same = r->status == CMD_OK && r->len == BAUD_PATTERN_LEN;
+    for (uint32_t i = 0; same && i < BAUD_PATTERN_LEN; i++) same = r->payload[i] == baud_pattern(i);
+    if (!same) {
+      // A frame with a good CRC and the wrong bytes, or refused: give up now
+      if (r->status == CMD_OK) b->bad_echoes++;
+      fall_back(b);
+      break;
+    }
+    b->attempts = 0;
+    send_commit(b);
+    break;
+  }
+
+  case BAUD_CMD_COMMIT:
+    if (b->state != BAUD_HOST_COMMIT) break;
+    if (r->status == CMD_OK && r->len >= 4U && get_le32(r->payload) == b->baud) {
+      finish(b, BAUD_HOST_DONE);
+    } else {
+      fall_back(b);
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void expired(cmd_client_t *c, uint8_t seq, uint8_t id) {
+  baud_host_t *b = (baud_host_t *)c->ctx;
+  (void)seq;
+
+  b->timeouts++;
+  if (id == BAUD_CMD_PROPOSE && b->state == BAUD_HOST_PROPOSE) {
+    if (b->attempts < PROPOSE_ATTEMPTS) {
+      send_propose(b);
+    } else {
+      finish(b, BAUD_HOST_FAILED);
+    }
+  } else if (id == BAUD_CMD_VERIFY && b->state == BAUD_HOST_VERIFY) {
+    if (b->attempts < VERIFY_ATTEMPTS) {
+      send_verify(b);
+    } else {
+      fall_back(b);
+    }
+  } else if (id == BAUD_CMD_COMMIT && b->state == BAUD_HOST_COMMIT) {
+    if (b->attempts < COMMIT_ATTEMPTS) {
+      send_commit(b);
+    } else {
+      fall_back(b);
+    }
+  }
+}
+
+void baud_host_init(baud_host_t *b, cmd_client_t *c, uint32_t home_baud, uint32_t max_baud) {
+  void (*set_baud)(baud_host_t *, uint32_t) = b->set_baud;
+  void *ctx = b->ctx;
+
+  memset(b, 0, sizeof(*b));
+  b->set_baud = set_baud;
+  b->ctx = ctx;
+  b->cmd = c;
+  b->home_baud = b->baud = home_baud;
+  b->max_baud = max_baud;
+  b->state = BAUD_HOST_PROPOSE;
+  c->response = got_response;
+  c->ctx = b;
+}
+
+int baud_host_poll(baud_host_t *b, uint64_t now) {
+  b->now = now;
+  if (b->state == BAUD_HOST_PROPOSE && !b->attempts) {
+    if (!b->started_at) b->started_at = now;
+    send_propose(b);
+  }
+  if (b->state == BAUD_HOST_SETTLE && now >= b->until) {
+    b->attempts = 0;
+    send_verify(b);
+  }
+  if (b->state == BAUD_HOST_BACK && now >= b->until) {
+    // Whatever is still outstanding went at the trial rate
+    for (unsigned s = 0; s < 256U; s++) cmd_client_forget(b->cmd, (uint8_t)s);
+    change_baud(b, b->home_baud);
+    b->max_baud = b->trial - 1U;
+    b->attempts = 0;
+    b->state = BAUD_HOST_PROPOSE;
+    send_propose(b);
+  }
+  if (now > TIMEOUT_NS) cmd_client_expire(b->cmd, now - TIMEOUT_NS, expired);
+  return b->state != BAUD_HOST_DONE && b->state != BAUD_HOST_FAILED;
+}
+
+const char *baud_host_state_name(baud_host_state_t s) {
+  static const char *const names[] = { "propose", "settle", "verify", "commit", "back", "done",
+                                       "failed" };
+  return (unsigned)s < sizeof(names) / sizeof(names[0]) ? names[s] : "?";
+}
@@ -0,0 +1,81 @@
+/*
+ * baud-host.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Host side of the console rate negotiation (Src/baud.h), over a
+ * cmd_client_t (cmd-host.h): PROPOSE at the rate the line has, a change
+ * of rate, VERIFY, COMMIT. Used by baud-bench and update-send; the
+ * transport and the clock are the caller's.
+ *
+ * A trial that fails - VERIFY or COMMIT unanswered after their attempts,
+ * a wrong echo, or a refusal - is waited out: the firmware goes back at
+ * the end of its window, so the client stays at the trial rate until
+ * window_ms after its own change (which came after the firmware's), then
+ * changes back and PROPOSEs again below the rate that failed. It stops
+ * when PROPOSE offers the rate the line already has.
+ *
+ * If every COMMIT response is lost but a COMMIT got through, the two ends
+ * part: the firmware keeps the new rate and the client goes back. Only a
+ * line too bad for the new rate loses all of them, and the host has to
+ * find the firmware again (at its new rate, or after a reset).
+ */
+
+#ifndef BAUD_HOST_H_
+#define BAUD_HOST_H_
+
+#include <stdint.h>
+
+#include "cmd-host.h"
+
+typedef enum {
+  BAUD_HOST_PROPOSE = 0,  // PROPOSE sent
+  BAUD_HOST_SETTLE,       // Waiting BAUD_SETTLE_MS after the change of rate
+  BAUD_HOST_VERIFY,       // VERIFY sent
+  BAUD_HOST_COMMIT,       // COMMIT sent
+  BAUD_HOST_BACK,         // Waiting out the firmware's window to go back
+  BAUD_HOST_DONE,
+  BAUD_HOST_FAILED
+} baud_host_state_t;
+
+typedef struct baud_host baud_host_t;
+
+struct baud_host {
+  // Change the line to baud; called after the response that asks for it
+  void (*set_baud)(baud_host_t *b, uint32_t baud);
+  void *ctx;
+
+  cmd_client_t *cmd;
+  uint32_t max_baud;      // Asked for in the next PROPOSE
+  uint32_t home_baud;     // The rate PROPOSE goes at
+
+  baud_host_state_t state;
+  uint64_t now;           // ns, from the last baud_host_poll()
+  uint64_t changed_at;    // When the client changed to the trial rate
+  uint64_t until;         // End of SETTLE or BACK
+  uint32_t attempts;      // Of the request in flight
+  uint64_t started_at, done_at;
+
+  uint32_t baud;          // The line's rate now
+  uint32_t trial;         // The rate on trial
+  uint32_t window_ms;     // From PROPOSE
+
+  uint32_t trials;        // Rates tried
+  uint32_t fallbacks;     // Of those, given up
+  uint32_t bad_echoes;    // VERIFY answered with other bytes
+  uint64_t timeouts;
+};
+
+// Set up a negotiation from home_baud up to max_baud, and take over
+// c->response and c->ctx
+void baud_host_init(baud_host_t *b, cmd_client_t *c, uint32_t home_baud, uint32_t max_baud);
+
+// Send what can be sent and expire what timed out; now is in ns.
+// Returns 0 once the negotiation is DONE (baud is the rate agreed) or
+// FAILED (PROPOSE went unanswered; the line is at home_baud).
+int baud_host_poll(baud_host_t *b, uint64_t now);
+
+const char *baud_host_state_name(baud_host_state_t s);
+
+#endif /* BAUD_HOST_H_ */
@@ -0,0 +1,290 @@
+/*
+ * bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Console throughput benchmark on the simulated USART3.
+ *
+ * Pushes bytes through each console path and reports, in simulated time:
+ * * bytes/s, and how close that is to the line rate
+ * * CPU register accesses per byte (bus traffic the path generates)
+ * * interrupts per byte and how busy the CPU was
+ *
+ * Every byte that leaves the TX pin is checked against the pattern that
+ * was written, in order.
+ *
+ * Then, on the interrupt ring, each full-ring policy with transmission
+ * stalled: three ringfuls written with the USART3 interrupt disabled
+ * must leave the first ringful (DROP_NEWEST) or the last one
+ * (OVERWRITE_OLDEST) to go out when it is enabled again; with PRIMASK set
+ * instead, BLOCK must send every byte by polling. On the DMA path, eight
+ * buffers through BLOCK: console_dma_stats() must put the time spent
+ * waiting for a buffer in wait_cycles, leaving cpu_cycles under 1%; and
+ * with no buffer coming free, console_write_isr() must queue each whole
+ * record entire or refuse it, and say which.
+ *
+ * Built twice by the Makefile: "bench" uses the interrupt ring and
+ * "bench-dma" the DMA ping-pong path (CONSOLE_TX_DMA).
+ *
+ * Usage: bench [--bytes N] [--check] [--hsi]
+ *   --check  exit with status 1 if a path is below 95% of the line rate,
+ *            a byte arrives other than it was written, a policy keeps
+ *            other bytes than it should, or the DMA path counts its
+ *            waiting as work or splits a whole record
+ *   --hsi    stay on the 16MHz reset clock instead of calling clock_init()
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "clock.h"
+#include "console.h"
+#include "critical.h"
+#include "prof.h"
+
+// Drivers from Src/main.c (which has no header of its own)
+void uart3_rxtx_init(void);
+void uart_write(USART_TypeDef *usartx, uint8_t val);
+
+#define MIN_LINE_RATE_FRACTION 0.95
+
+static uint64_t line_bytes; // Bytes seen leaving the TX pin
+static uint64_t bad_bytes;  // Of those, not the pattern's byte there
+static uint64_t pattern_from; // The pattern byte the line should start at
+
+// Byte n of what the paths write: not periodic in any ring size
+static uint8_t pattern(uint64_t n) {
+  return (uint8_t)(n * 131U + (n >> 8) + (n >> 16));
+}
+
+static void count_tx(USART_TypeDef *usart, uint8_t c) {
+  (void)usart;
+  if (c != pattern(line_bytes + pattern_from)) bad_bytes++;
+  line_bytes++;
+}
+
+static void start_line(uint64_t from) {
+  line_bytes = bad_bytes = 0;
+  pattern_from = from;
+}
+
+static int expect(int ok, const char *what) {
+  printf("  %-62s %s\n", what, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+#ifndef CONSOLE_TX_DMA
+// Write three ringfuls of the pattern, in pieces that do not divide the
+// ring, under a policy with the line stalled; what reaches the line must
+// be `keep` bytes of the pattern from `first` on
+static int policy_case(console_tx_policy_t policy, const char *what) {
+  const uint32_t total = 3U * CONSOLE_TX_BUF_SIZE;
+  const console_tx_stats_t *st = console_tx_stats();
+  console_tx_stats_t before = *st;
+  static uint8_t buf[3U * CONSOLE_TX_BUF_SIZE];
+  for (uint32_t i = 0; i < total; i++) buf[i] = pattern(i);
+
+  uint32_t keep = policy == CONSOLE_TX_BLOCK ? total : CONSOLE_TX_BUF_SIZE;
+  uint32_t first = policy == CONSOLE_TX_OVERWRITE_OLDEST ? total - keep : 0;
+
+  console_set_tx_policy(policy);
+  start_line(first);
+  uint32_t primask = 0;
+  if (policy == CONSOLE_TX_BLOCK) {
+    primask = critical_enter(); // Stalled for the ISR: BLOCK must poll
+  } else {
+    NVIC_DisableIRQ(USART3_IRQn);
+  }
+  for (uint32_t sent = 0; sent < total; sent += 100U) {
+    console_write(buf + sent, (int)(total - sent < 100U ? total - sent : 100U));
+  }
+  if (policy == CONSOLE_TX_BLOCK) {
+    critical_exit(primask);
+  } else {
+    NVIC_EnableIRQ(USART3_IRQn);
+  }
+  console_flush();
+  console_set_tx_policy(CONSOLE_TX_POLICY);
+
+  int ok = line_bytes == keep && !bad_bytes;
+  if (policy == CONSOLE_TX_DROP_NEWEST) ok &= st->dropped - before.dropped == total - keep;
+  if (policy == CONSOLE_TX_OVERWRITE_OLDEST) ok &= st->overwritten - before.overwritten == total - keep;
+  if (policy == CONSOLE_TX_BLOCK) ok &= st->full_waits > before.full_waits;
+  return expect(ok, what);
+}
+#else
+// Eight buffers of the pattern through BLOCK, short enough that the
+// statistics' 32-bit cycle counts do not wrap: nearly all of it is spent
+// waiting for the line, which must be in wait_cycles, not cpu_cycles
+static int dma_stats_case(const char *what) {
+  const uint32_t total = 8U * CONSOLE_DMA_BUF_SIZE;
+  static uint8_t buf[8U * CONSOLE_DMA_BUF_SIZE];
+  for (uint32_t i = 0; i < total; i++) buf[i] = pattern(i);
+
+  console_flush();
+  start_line(0);
+  console_dma_reset_stats();
+  console_write(buf, (int)total);
+  console_flush();
+  const console_dma_stats_t *st = console_dma_stats();
+  printf("\nconsole_dma_stats() for %lu bytes: %lu cycles of work, %lu waiting, of %lu\n",
+         (unsigned long)total, (unsigned long)st->cpu_cycles, (unsigned long)st->wait_cycles,
+         (unsigned long)st->elapsed_cycles);
+
+  int ok = line_bytes == total && !bad_bytes && st->full_waits > 0U;
+  ok &= (uint64_t)st->cpu_cycles + st->wait_cycles <= st->elapsed_cycles;
+  ok &= st->wait_cycles > st->elapsed_cycles / 2U && st->cpu_cycles < st->elapsed_cycles / 100U;
+  return expect(ok, what);
+}
+
+// Records of a size that does not divide the buffer, written whole through
+// console_write_isr() with the DMA's interrupt off so no buffer comes free:
+// each must be queued entire or not at all, as it reports, and the line
+// must carry exactly the records it said it queued
+static int dma_whole_case(const char *what) {
+  const uint32_t rec = 100U, tries = 3U * CONSOLE_DMA_BUF_SIZE / rec;
+  static uint8_t buf[100];
+
+  console_flush();
+  start_line(0);
+  uint32_t dropped = console_isr_dropped();
+  uint32_t queued = 0, refused = 0, split = 0;
+  NVIC_DisableIRQ(CONSOLE_DMA_IRQn);
+  for (uint32_t i = 0; i < tries; i++) {
+    for (uint32_t k = 0; k < rec; k++) buf[k] = pattern(queued + k);
+    uint32_t n = console_write_isr(buf, rec, 1);
+    if (n == rec) {
+      queued += n;
+    } else {
+      refused += rec;
+      if (n) split++;
+    }
+  }
+  NVIC_EnableIRQ(CONSOLE_DMA_IRQn);
+  console_flush();
+  printf("\nwhole records on the stalled DMA path: %lu bytes queued, %lu refused\n",
+         (unsigned long)queued, (unsigned long)refused);
+
+  int ok = !split && queued >= CONSOLE_DMA_BUF_SIZE / 2U && refused > 0U;
+  ok &= line_bytes == queued && !bad_bytes;
+  ok &= console_isr_dropped() - dropped == refused;
+  return expect(ok, what);
+}
+#endif
+
+static int report(const char *name, uint64_t bytes, const sim_counters_t *a,
+                  const sim_counters_t *b, double line_rate) {
+  uint64_t cycles = b->cycles - a->cycles;
+  uint64_t busy = cycles - (b->idle_cycles - a->idle_cycles);
+  double secs = (double)cycles / sim_core_hz;
+  double bps = (double)bytes / secs;
+
+  printf("%-16s %10llu %12.0f %7.1f%% %10.2f %9.3f %7.1f%%\n",
+         name, (unsigned long long)bytes, bps, 100.0 * bps / line_rate,
+         (double)(b->reg_accesses - a->reg_accesses) / (double)bytes,
+         (double)(b->irq_entries - a->irq_entries) / (double)bytes,
+         100.0 * (double)busy / (double)cycles);
+
+  return bps >= MIN_LINE_RATE_FRACTION * line_rate;
+}
+
+int main(int argc, char **argv) {
+  uint64_t total = 4UL * 1024UL * 1024UL;
+  int check = 0;
+  int pll = 1;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--bytes") && i + 1 < argc) {
+      total = strtoull(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else if (!strcmp(argv[i], "--hsi")) {
+      pll = 0;
+    } else {
+      fprintf(stderr, "usage: %s [--bytes N] [--check] [--hsi]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  sim_reset();
+  sim_usart_set_tx_sink(USART3, count_tx);
+  prof_init();
+  if (pll) clock_init();
+  uart3_rxtx_init();
+
+  double line_rate = (double)sim_core_hz / (double)sim_usart_frame_cycles(USART3);
+  printf("USART3 BRR=%lu, line rate %.0f bytes/s, core %lu Hz\n\n",
+         (unsigned long)USART3->BRR.v, line_rate, (unsigned long)sim_core_hz);
+  printf("%-16s %10s %12s %8s %10s %9s %8s\n",
+         "path", "bytes", "bytes/s", "line", "regs/byte", "irq/byte", "cpu");
+
+  int ok = 1;
+  sim_counters_t a, b;
+
+  // Polled uart_write(): the CPU spins on TXE for every byte.
+  // Kept short since every poll is a simulated register access.
+  uint64_t polled = total / 64U;
+  line_bytes = 0;
+  a = sim_count;
+  start_line(0);
+  for (uint64_t i = 0; i < polled; i++) uart_write(USART3, pattern(i));
+  while (!(USART3->ISR & USART_ISR_TC));
+  b = sim_count;
+  ok &= report("polled", line_bytes, &a, &b, line_rate);
+  uint64_t bad = bad_bytes + (line_bytes != polled);
+  const prof_site_t *wait = prof_find("uart_tx_wait");
+
+  // Buffered console: printf-sized lines of the pattern through
+  // console_write(); filling them is host code, and takes no time
+  static uint8_t line[64];
+
+  console_init();
+  start_line(0);
+  a = sim_count;
+  for (uint64_t sent = 0; sent < total; sent += sizeof(line)) {
+    for (unsigned i = 0; i < sizeof(line); i++) line[i] = pattern(sent + i);
+    console_write(line, (int)sizeof(line));
+  }
+  console_flush();
+  b = sim_count;
+  bad += bad_bytes + (line_bytes != total);
+#ifdef CONSOLE_TX_DMA
+  ok &= report("dma ping-pong", line_bytes, &a, &b, line_rate);
+#else
+  ok &= report("interrupt ring", line_bytes, &a, &b, line_rate);
+#endif
+
+  if (wait && wait->count) {
+    printf("\npolled TXE wait (uart_tx_wait probe): %lu waits, min %lu mean %lu max %lu cycles\n",
+           (unsigned long)wait->count, (unsigned long)wait->min,
+           (unsigned long)(wait->sum / wait->count), (unsigned long)wait->max);
+  }
+
+  printf("\n");
+  char what[80];
+  snprintf(what, sizeof(what), "%llu bytes through both paths, each as written",
+           (unsigned long long)(polled + total));
+  ok &= expect(!bad, what);
+#ifndef CONSOLE_TX_DMA
+  ok &= policy_case(CONSOLE_TX_DROP_NEWEST, "DROP_NEWEST, TX stalled: the first ringful goes out");
+  ok &= policy_case(CONSOLE_TX_OVERWRITE_OLDEST, "OVERWRITE_OLDEST, TX stalled: the last ringful goes out");
+  ok &= policy_case(CONSOLE_TX_BLOCK, "BLOCK, interrupts masked: every byte, sent by polling");
+#else
+  ok &= dma_stats_case("BLOCK: waiting for a buffer is not counted as work");
+  ok &= dma_whole_case("console_write_isr(whole): a record goes entire or not at all");
+#endif
+
+  if (check && !ok) {
+    fprintf(stderr, "FAIL: a console path is below %.0f%% of the line rate, lost or changed "
+            "a byte, a full-ring policy kept the wrong bytes, waiting was counted as work or a whole "
+            "record was split\n",
+            100.0 * MIN_LINE_RATE_FRACTION);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,296 @@
+/*
+ * button-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Debounce test and latency benchmark for button.c on the simulated core.
+ *
+ * Each scenario drives PC13 through a pattern of edges - clean, bouncing,
+ * a noise spike, chatter longer than the lock-out - while a main loop
+ * like main-btn.c's sleeps in __WFI() and takes the events. The events
+ * that come out are checked against the ones the pattern should give,
+ * and at the times it should give them.
+ *
+ * For every event caused directly by an edge it reports the latency from
+ * the edge to the handler's timestamp, and to the main loop having the
+ * event in hand.
+ *
+ * Usage: button-bench [--verbose] [--check]
+ *   --check  exit with status 1 if any scenario gives the wrong events
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "button.h"
+#include "clock.h"
+#include "critical.h"
+#include "cycles.h"
+#include "nucleo-btn.h"
+#include "prof.h"
+
+#define MAX_EDGES  64
+#define MAX_EVENTS 16
+
+// Where the handler timestamp may be from where the pattern says:
+// edges are seen at once, TIM7 counts tenths of a millisecond
+#define EDGE_TOL_NS  5000ULL
+#define TIMER_TOL_NS 150000ULL
+
+typedef struct {
+  uint64_t at_ns;  // From the start of the scenario
+  int level;
+} edge_t;
+
+typedef struct {
+  uint32_t type;
+  uint64_t at_ns;
+  int from_edge;   // Caused by the edge at at_ns itself, not by TIM7
+} expect_t;
+
+typedef struct {
+  const char *name;
+  edge_t edges[MAX_EDGES];
+  unsigned num_edges;
+  expect_t expect[MAX_EVENTS];
+  unsigned num_expect;
+} scenario_t;
+
+static void edge(scenario_t *s, double ms, int level) {
+  s->edges[s->num_edges].at_ns = (uint64_t)(ms * 1e6 + 0.5);
+  s->edges[s->num_edges].level = level;
+  s->num_edges++;
+}
+
+// Contacts meeting (or parting) at `ms`, then bouncing `n` times over
+// the next `over` ms before they stay at `level`
+static void bounce(scenario_t *s, double ms, int level, unsigned n, double over) {
+  edge(s, ms, level);
+  for (unsigned i = 1; i <= 2 * n; i++) edge(s, ms + over * i / (2.0 * n), (i & 1U) ? !level : level);
+}
+
+static void expect(scenario_t *s, uint32_t type, double ms, int from_edge) {
+  s->expect[s->num_expect].type = type;
+  s->expect[s->num_expect].at_ns = (uint64_t)(ms * 1e6 + 0.5);
+  s->expect[s->num_expect].from_edge = from_edge;
+  s->num_expect++;
+}
+
+static const char *type_name(uint32_t type) {
+  switch (type) {
+  case BUTTON_PRESS:      return "press";
+  case BUTTON_RELEASE:    return "release";
+  case BUTTON_LONG_PRESS: return "long";
+  default:                return "?";
+  }
+}
+
+static uint64_t ns_to_cycles(uint64_t ns) {
+  return ns * (sim_core_hz / 1000U) / 1000000U;
+}
+
+static double cycles_to_us(uint64_t c) {
+  return (double)c * 1e6 / sim_core_hz;
+}
+
+typedef struct {
+  uint64_t n, sum, min, max;
+} stat_t;
+
+static void stat_add(stat_t *st, uint64_t v) {
+  if (!st->n || v < st->min) st->min = v;
+  if (v > st->max) st->max = v;
+  st->sum += v;
+  st->n++;
+}
+
+static void stat_print(const char *what, const stat_t *st) {
+  if (!st->n) return;
+  printf("%-24s %6llu %8llu %8llu %8llu %9.3f %9.3f\n", what, (unsigned long long)st->n,
+         (unsigned long long)st->min, (unsigned long long)(st->sum / st->n),
+         (unsigned long long)st->max, cycles_to_us(st->min), cycles_to_us(st->max));
+}
+
+static stat_t to_handler, to_app;
+static uint64_t dwt_origin; // sim_count.cycles when CYCCNT was 0
+
+// Play one scenario from now; returns the number of mismatches
+static int run(const scenario_t *s, int verbose) {
+  uint64_t t0 = sim_count.cycles + ns_to_cycles(1000000ULL);
+  uint64_t last = s->edges[s->num_edges - 1].at_ns;
+  for (unsigned i = 0; i < s->num_expect; i++) {
+    if (s->expect[i].at_ns > last) last = s->expect[i].at_ns;
+  }
+  // Long enough for any lock-out or long press the pattern started to end
+  uint64_t end = t0 + ns_to_cycles(last) + ns_to_cycles((BUTTON_LONG_MS + 100ULL) * 1000000ULL);
+
+  for (unsigned i = 0; i < s->num_edges; i++) {
+    sim_gpio_input_at(GPIOC, USER_BTN_B, s->edges[i].level, t0 + ns_to_cycles(s->edges[i].at_ns));
+  }
+  // Not a change: just something to wake for at the end
+  sim_gpio_input_at(GPIOC, USER_BTN_B, s->edges[s->num_edges - 1].level, end);
+
+  button_event_t got[MAX_EVENTS];
+  uint64_t got_at[MAX_EVENTS];
+  unsigned n = 0;
+  while (sim_count.cycles < end) {
+    button_event_t ev;
+    while (button_get(&ev)) {
+      if (n < MAX_EVENTS) {
+        got[n] = ev;
+        got_at[n] = sim_count.cycles;
+      }
+      n++;
+    }
+    uint32_t primask = critical_enter();
+    if (!button_pending()) __WFI();
+    critical_exit(primask);
+  }
+
+  int bad = n != s->num_expect;
+  printf("%-34s %u events%s\n", s->name, n, bad ? "  MISMATCH" : "");
+  for (unsigned i = 0; i < n && i < MAX_EVENTS; i++) {
+    // The handler's timestamp, from the start of the pattern
+    uint64_t seen = (uint64_t)(uint32_t)(got[i].cycles - (uint32_t)(t0 - dwt_origin));
+    double seen_ms = cycles_to_us(seen) / 1000.0;
+    const expect_t *e = i < s->num_expect ? &s->expect[i] : NULL;
+    int ok = 0;
+    if (e && e->type == got[i].type) {
+      uint64_t want = ns_to_cycles(e->at_ns);
+      uint64_t tol = ns_to_cycles(e->from_edge ? EDGE_TOL_NS : TIMER_TOL_NS);
+      ok = seen >= want && seen - want <= tol;
+      if (ok && e->from_edge) {
+        stat_add(&to_handler, seen - want);
+        stat_add(&to_app, got_at[i] - (t0 + want));
+      }
+    }
+    if (!ok) bad = 1;
+    if (verbose || !ok) {
+      printf("  %-8s at %10.4f ms", type_name(got[i].type), seen_ms);
+      if (e) printf("   expected %-8s at %10.4f ms", type_name(e->type), e->at_ns / 1e6);
+      printf("%s\n", ok ? "" : "  <--");
+    }
+  }
+  if (button_down()) {
+    printf("  still down at the end\n");
+    bad = 1;
+  }
+  return bad;
+}
+
+int main(int argc, char **argv) {
+  int check = 0, verbose = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else if (!strcmp(argv[i], "--verbose")) {
+      verbose = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--verbose] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  static scenario_t sc[8];
+  unsigned ns = 0;
+  scenario_t *s;
+  double L = BUTTON_LOCKOUT_MS;
+
+  s = &sc[ns++];
+  s->name = "clean press and release";
+  edge(s, 0, 1);
+  edge(s, 200, 0);
+  expect(s, BUTTON_PRESS, 0, 1);
+  expect(s, BUTTON_RELEASE, 200, 1);
+
+  s = &sc[ns++];
+  s->name = "bouncing press and release";
+  bounce(s, 0, 1, 6, 3.0);
+  bounce(s, 300, 0, 4, 1.5);
+  expect(s, BUTTON_PRESS, 0, 1);
+  expect(s, BUTTON_RELEASE, 300, 1);
+
+  s = &sc[ns++];
+  s->name = "50ns noise spike";
+  edge(s, 0, 1);
+  edge(s, 0.00005, 0);
+
+  s = &sc[ns++];
+  s->name = "tap shorter than the lock-out";
+  bounce(s, 0, 1, 2, 0.5);
+  edge(s, 5, 0);
+  expect(s, BUTTON_PRESS, 0, 1);
+  expect(s, BUTTON_RELEASE, L, 0);
+
+  s = &sc[ns++];
+  s->name = "long press";
+  bounce(s, 0, 1, 5, 2.0);
+  bounce(s, 1500, 0, 3, 1.0);
+  expect(s, BUTTON_PRESS, 0, 1);
+  expect(s, BUTTON_LONG_PRESS, BUTTON_LONG_MS, 0);
+  expect(s, BUTTON_RELEASE, 1500, 1);
+
+  s = &sc[ns++];
+  s->name = "double click";
+  bounce(s, 0, 1, 3, 1.0);
+  bounce(s, 60, 0, 3, 1.0);
+  bounce(s, 120, 1, 3, 1.0);
+  bounce(s, 180, 0, 3, 1.0);
+  expect(s, BUTTON_PRESS, 0, 1);
+  expect(s, BUTTON_RELEASE, 60, 1);
+  expect(s, BUTTON_PRESS, 120, 1);
+  expect(s, BUTTON_RELEASE, 180, 1);
+
+  // Contacts that chatter for longer than the lock-out really are opening
+  // again: toggling every 1ms from 0.5ms to 29.5ms, then held until 100ms
+  s = &sc[ns++];
+  s->name = "chatter longer than the lock-out";
+  edge(s, 0, 1);
+  for (unsigned k = 0; k < 30; k++) edge(s, k + 0.5, (k & 1U) != 0);
+  edge(s, 100, 0);
+  expect(s, BUTTON_PRESS, 0, 1);
+  expect(s, BUTTON_RELEASE, L + 0.5, 1);     // First edge after the lock-out
+  expect(s, BUTTON_PRESS, 2 * L + 0.5, 0);   // Settled high by then
+  expect(s, BUTTON_RELEASE, 100, 1);
+
+  sim_reset();
+  clock_init();
+  prof_init();
+  dwt_origin = sim_count.cycles - cycles_now();
+  button_init();
+
+  printf("core %lu Hz, lock-out %u ms, long press %u ms\n\n",
+         (unsigned long)sim_core_hz, BUTTON_LOCKOUT_MS, BUTTON_LONG_MS);
+
+  sim_counters_t a = sim_count;
+  int failures = 0;
+  for (unsigned i = 0; i < ns; i++) failures += run(&sc[i], verbose);
+  sim_counters_t b = sim_count;
+
+  printf("\n%-24s %6s %8s %8s %8s %9s %9s\n", "latency from the edge", "events",
+         "min cyc", "mean cyc", "max cyc", "min us", "max us");
+  stat_print("to handler timestamp", &to_handler);
+  stat_print("to main loop", &to_app);
+
+  const prof_site_t *p = prof_find("button_exti");
+  if (p && p->count) {
+    printf("EXTI handler: %lu runs, %lu-%lu cycles\n", (unsigned long)p->count,
+           (unsigned long)p->min, (unsigned long)p->max);
+  }
+  uint64_t cycles = b.cycles - a.cycles;
+  printf("%llu interrupts in %.1f s, cpu busy %.4f%%, %lu events dropped\n",
+         (unsigned long long)(b.irq_entries - a.irq_entries), cycles_to_us(cycles) / 1e6,
+         100.0 * (double)(cycles - (b.idle_cycles - a.idle_cycles)) / (double)cycles,
+         (unsigned long)button_dropped());
+
+  if (check && (failures || button_dropped())) {
+    fprintf(stderr, "FAIL: %d scenarios gave the wrong events\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,487 @@
+/*
+ * capture-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Checks for the logic-analyzer capture (capture.c) and its host side
+ * (capture-host.h).
+ *
+ * First the run-length encoder and decoder on their own, over synthetic
+ * port traces: an idle port, a clock toggling every sample, SPI bursts,
+ * UART bytes, noise on masked-off pins, and runs long enough for 4-byte
+ * varints. Each is encoded in random-sized pieces into frames the way
+ * capture_poll() does, decoded, and must come back sample for sample;
+ * a line gives the bytes each sample cost. Malformed records must be
+ * refused.
+ *
+ * Then whole captures on the simulated core: a function drives GPIOE
+ * (sim_gpio_set_source()), TIM1 and DMA2 sample it, and the frames on the
+ * simulated USART3 are decoded. Every sample the DMA took is logged with
+ * its time, and what comes out must be exactly the logged samples from
+ * `pre` before the first trigger edge, taken one sample period apart:
+ * * a triggered burst that fits in the ring, at a line far too slow to
+ *   stream it, with its VCD file's pin changes counted
+ * * a slow signal streamed until stopped, many times round the ring
+ * * a busy port the line cannot keep up with, which must stop with
+ *   OVERRUN and still send everything up to there
+ * * a capture with no trigger pins, which starts at once
+ *
+ * Usage: capture-bench [--check]
+ *   --check  exit with status 1 on any mismatch
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "capture.h"
+#include "capture-host.h"
+#include "clock.h"
+#include "console.h"
+#include "critical.h"
+#include "tick.h"
+#include "uart.h"
+
+// Drivers from Src/main.c (which has no header of its own)
+void uart3_rxtx_init(void);
+
+#define MAX_LOG (4U << 20)
+
+static unsigned failures;
+
+static uint32_t hash(uint64_t k) {
+  uint64_t x = (k + 0x9E3779B97F4A7C15ULL) * 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 31;
+  x *= 0x94D049BB133111EBULL;
+  return (uint32_t)(x >> 32);
+}
+
+// ---- Synthetic traces, as functions of the sample number
+
+typedef struct {
+  const char *name;
+  uint16_t mask;
+  uint64_t len;
+  uint16_t (*sample)(uint64_t k);
+} trace_t;
+
+static uint16_t idle_port(uint64_t k) {
+  return k < 150000U ? 0x0100U : 0x0108U;
+}
+
+static uint16_t clock_pin(uint64_t k) {
+  return (uint16_t)(k & 1U);
+}
+
+// Chip select on pin 4 low for 64 bits, clock on pin 5 (8 samples a bit),
+// data out on pin 6 and in on pin 7, in every frame of 1000 samples
+static uint16_t spi(uint64_t k) {
+  uint64_t frame = k / 1000U, t = k % 1000U;
+  if (t < 100U || t >= 100U + 64U * 8U) return 0x0010U;
+  uint64_t bit = (t - 100U) / 8U;
+  uint32_t h = hash(frame * 64U + bit);
+  uint16_t v = (t - 100U) % 8U >= 4U ? 0x0020U : 0;
+  return (uint16_t)(v | ((h & 1U) << 6) | (((h >> 1) & 1U) << 7));
+}
+
+// 115200 baud bytes on pin 9 sampled at 1MHz, idle high between them
+static uint16_t uart_line(uint64_t k) {
+  uint64_t bit = k * 115200U / 1000000U;
+  uint64_t byte = bit / 14U, b = bit % 14U;
+  if (b == 0) return 0;                       // Start bit
+  if (b >= 9U) return 1U << 9;                // Stop bit and a gap
+  return (uint16_t)(((hash(byte) >> (b - 1U)) & 1U) << 9);
+}
+
+// Noise on every pin, of which only 4 are recorded: most change often
+static uint16_t noise(uint64_t k) {
+  return (uint16_t)(hash(k / 3U) & 0xFFFFU);
+}
+
+// Runs of 3 million samples, each longer than a 3-byte varint holds
+static uint16_t long_runs(uint64_t k) {
+  return (uint16_t)((k / 3000000U) % 3U);
+}
+
+static const trace_t traces[] = {
+  { "idle",      0xFFFFU, 300000U,  idle_port },
+  { "clock",     0x0001U, 200000U,  clock_pin },
+  { "spi",       0x00F0U, 500000U,  spi },
+  { "uart",      0x0200U, 1000000U, uart_line },
+  { "noise",     0x0F00U, 300000U,  noise },
+  { "long runs", 0x0003U, 20000000U, long_runs },
+};
+
+static uint32_t rng = 12345;
+static uint32_t rnd(void) {
+  rng = rng * 1664525UL + 1013904223UL;
+  return rng >> 8;
+}
+
+static const trace_t *checking;
+static uint64_t run_bad, run_next;
+
+static void check_run(capture_host_t *h, uint64_t at, uint16_t value, uint32_t len) {
+  (void)h;
+  if (at != run_next) run_bad++;
+  for (uint64_t k = at; k < at + len && k < checking->len; k++) {
+    if ((checking->sample(k) & checking->mask) != value) {
+      run_bad++;
+      break;
+    }
+  }
+  run_next = at + len;
+}
+
+static void round_trip(const trace_t *t) {
+  static uint16_t chunk[8192];
+  uint8_t frame[CAPTURE_PAYLOAD_MAX];
+  uint32_t used = 0;
+  uint64_t bytes = 0, frames = 0, k = 0;
+  capture_rle_t e;
+  capture_host_t h;
+
+  capture_host_init(&h);
+  h.run = check_run;
+  checking = t;
+  run_bad = run_next = 0;
+  capture_rle_init(&e);
+
+  while (k < t->len) {
+    uint32_t n = 1U + rnd() % 8000U;
+    if (n > t->len - k) n = (uint32_t)(t->len - k);
+    for (uint32_t i = 0; i < n; i++) chunk[i] = t->sample(k + i);
+    uint32_t done = 0;
+    while (done < n) {
+      done += capture_rle_encode(&e, chunk + done, n - done, t->mask, frame,
+                                 CAPTURE_PAYLOAD_MAX - CAPTURE_RECORD_MAX, &used);
+      // A full frame, or now and then the encoder catching up
+      if (done < n || rnd() % 4U == 0) {
+        used += capture_rle_flush(&e, frame + used);
+        if (used > CAPTURE_PAYLOAD_MAX || capture_host_records(&h, frame, used)) run_bad++;
+        bytes += used;
+        frames++;
+        used = 0;
+      }
+    }
+    k += n;
+  }
+  used += capture_rle_flush(&e, frame + used);
+  if (capture_host_records(&h, frame, used)) run_bad++;
+  bytes += used;
+  frames++;
+
+  int bad = run_bad || h.samples != t->len;
+  printf("  %-10s %9llu samples, mask %04x: %8llu bytes in %6llu frames, %7.4f bytes/sample%s\n",
+         t->name, (unsigned long long)t->len, t->mask, (unsigned long long)bytes,
+         (unsigned long long)frames, (double)bytes / (double)t->len, bad ? "  MISMATCH" : "");
+  failures += (unsigned)bad;
+}
+
+static void bad_records(void) {
+  // A run of 0, a varint cut short, an XOR wider than 16 bits
+  static const uint8_t zero_run[] = { 0x01, 0x05, 0x02, 0x00 };
+  static const uint8_t cut[] = { 0x01, 0x85 };
+  static const uint8_t wide[] = { 0x80, 0x80, 0x04, 0x01 };
+  capture_host_t h;
+
+  capture_host_init(&h);
+  int bad = !capture_host_records(&h, zero_run, sizeof(zero_run)) ||
+            !capture_host_records(&h, cut, sizeof(cut)) ||
+            !capture_host_records(&h, wide, sizeof(wide));
+  printf("  malformed records %s\n", bad ? "ACCEPTED" : "refused");
+  failures += (unsigned)bad;
+}
+
+// ---- Whole captures on the simulated core
+
+typedef struct {
+  const char *name;
+  uint32_t baud;
+  capture_config_t cfg;
+  uint32_t (*signal)(uint64_t ns);
+  uint64_t stop_after_ns;     // capture_stop() then; 0 for never
+  uint8_t status;             // The END status it must give
+} run_t;
+
+// What the DMA read, and when
+static uint16_t log_value[MAX_LOG];
+static uint64_t log_ns[MAX_LOG];
+static uint32_t log_len;
+static uint32_t (*signal_fn)(uint64_t ns);
+
+static uint32_t port_source(GPIO_TypeDef *gpio, uint64_t ns) {
+  (void)gpio;
+  uint32_t v = signal_fn(ns);
+  if (log_len < MAX_LOG) {
+    log_value[log_len] = (uint16_t)v;
+    log_ns[log_len] = ns;
+  }
+  log_len++;
+  return v;
+}
+
+// SPI bursts: 32 bits at 500kHz every 100us from 2ms in, chip select on
+// pin 4 (the trigger, falling), clock on 5, data on 6; pins 8-15 count,
+// unrecorded
+static uint32_t spi_bus(uint64_t ns) {
+  uint64_t frame = ns / 100000U, t = ns % 100000U;
+  uint32_t v = (uint32_t)((ns / 1000U) & 0xFFU) << 8;
+  if (ns < 2000000U || t < 20000U || t >= 20000U + 32U * 2000U) return v | 0x10U;
+  uint64_t bit = (t - 20000U) / 2000U;
+  v |= (t - 20000U) % 2000U >= 1000U ? 0x20U : 0;
+  return v | ((hash(frame * 32U + bit) & 1U) << 6);
+}
+
+// A 1kHz PWM on pin 2 whose duty creeps up, a 50Hz one on pin 3 and a
+// 10kHz square wave on pin 1
+static uint32_t pwm(uint64_t ns) {
+  uint64_t period = ns / 1000000U, t = ns % 1000000U;
+  uint32_t v = t < (period % 100U) * 10000U ? 0x4U : 0;
+  v |= (ns % 100000U) < 50000U ? 0x2U : 0;
+  return v | ((ns % 20000000U) < 10000000U ? 0x8U : 0);
+}
+
+// A 400kHz clock on pin 0 and changing data on pin 1, with no let-up
+static uint32_t busy_bus(uint64_t ns) {
+  uint64_t half = ns / 1250U;
+  return (uint32_t)((half & 1U) | ((hash(half / 2U) & 1U) << 1));
+}
+
+static capture_host_t host;
+static capture_vcd_t vcd;
+static FILE *vcd_file;
+static char *vcd_text;
+static size_t vcd_size;
+static uint64_t decoded_bad, decoded_next;
+static uint32_t decoded_first;  // Log index of the first sample sent
+static uint16_t decoded_mask;
+static int ended;
+
+static void to_host(USART_TypeDef *usart, uint8_t c) {
+  (void)usart;
+  capture_host_feed(&host, &c, 1);
+}
+
+static const run_t *running_now;
+static uint32_t first_trigger(const capture_config_t *c);
+
+// The trigger is in the log by now: the samples sent start `pre` before it
+static void got_header(capture_host_t *h) {
+  uint32_t trig = first_trigger(&running_now->cfg);
+  decoded_first = trig == UINT32_MAX || trig < h->pre ? 0 : trig - h->pre;
+  if (vcd_file) capture_vcd_begin(&vcd, vcd_file, h);
+}
+
+static void got_run(capture_host_t *h, uint64_t at, uint16_t value, uint32_t len) {
+  (void)h;
+  if (at != decoded_next) decoded_bad++;
+  for (uint64_t k = at; k < at + len; k++) {
+    uint64_t i = decoded_first + k;
+    if (i >= log_len || i >= MAX_LOG || (log_value[i] & decoded_mask) != value) {
+      decoded_bad++;
+      break;
+    }
+  }
+  decoded_next = at + len;
+  if (vcd_file) capture_vcd_run(&vcd, at, value, len);
+}
+
+static void got_end(capture_host_t *h) {
+  if (vcd_file) capture_vcd_end(&vcd, h->samples);
+  ended = 1;
+}
+
+// The first trigger edge in the log, as capture.c should find it
+static uint32_t first_trigger(const capture_config_t *c) {
+  if (!c->rising && !c->falling) return 0;
+  for (uint32_t i = 1; i < log_len && i < MAX_LOG; i++) {
+    uint16_t prev = log_value[i - 1U], v = log_value[i];
+    if ((~prev & v & c->rising) | (prev & ~v & c->falling)) return i;
+  }
+  return UINT32_MAX;
+}
+
+// Pin changes from log[first] over n samples, as the VCD file should have
+static uint64_t pin_changes(uint32_t first, uint64_t n, uint16_t mask) {
+  uint64_t changes = 0;
+  for (uint64_t k = 1; k < n; k++) {
+    uint16_t d = (uint16_t)((log_value[first + k] ^ log_value[first + k - 1U]) & mask);
+    while (d) {
+      changes += d & 1U;
+      d >>= 1;
+    }
+  }
+  return changes;
+}
+
+static uint64_t count_vcd_changes(const char *text) {
+  uint64_t n = 0;
+  int in_dump = 0;
+  for (const char *p = text; *p; p = strchr(p, '\n') ? strchr(p, '\n') + 1 : p + strlen(p)) {
+    if (!strncmp(p, "$dumpvars", 9)) in_dump = 1;
+    else if (!strncmp(p, "$end", 4)) in_dump = 0;
+    else if (!in_dump && (*p == '0' || *p == '1') && p[1] != 'T') n++;
+  }
+  return n;
+}
+
+static void capture_run(const run_t *r) {
+  sim_reset();
+  clock_init();
+  tick_init(clock_hclk_hz());
+  uart3_rxtx_init();
+  console_init();
+  uart_set_baud(uart_port(UART_USART3), r->baud);
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPIOEEN;
+
+  log_len = 0;
+  signal_fn = r->signal;
+  sim_gpio_set_source(GPIOE, port_source);
+  sim_usart_set_tx_sink(USART3, to_host);
+  capture_host_init(&host);
+  host.header = got_header;
+  host.run = got_run;
+  host.end = got_end;
+  decoded_bad = decoded_next = 0;
+  decoded_mask = r->cfg.mask;
+  ended = 0;
+  running_now = r;
+  vcd_file = r->stop_after_ns || r->status != CAPTURE_DONE ? NULL : open_memstream(&vcd_text, &vcd_size);
+
+  const capture_stats_t before = *capture_stats();
+  uint32_t rate = capture_start(&r->cfg);
+  if (!rate) {
+    printf("  %s: capture_start() refused %lu Hz\n", r->name, (unsigned long)r->cfg.rate_hz);
+    failures++;
+    return;
+  }
+  uint64_t period_ns = 1000000000ULL / rate;  // Rates here divide 1GHz
+
+  // main.c's loop: poll, then sleep until the next interrupt
+  uint64_t t0 = sim_now_ns(), busy0 = sim_count.cycles - sim_count.idle_cycles;
+  uint64_t started = sim_count.cycles;
+  int stopped = 0;
+  while (capture_busy()) {
+    if (r->stop_after_ns && !stopped && sim_now_ns() - t0 >= r->stop_after_ns) {
+      capture_stop();
+      stopped = 1;
+    }
+    capture_poll();
+    uint32_t primask = critical_enter();
+    if (capture_busy()) __WFI();
+    critical_exit(primask);
+  }
+  uint64_t cycles = sim_count.cycles - started;
+  uint64_t busy = sim_count.cycles - sim_count.idle_cycles - busy0;
+  // The last frames leave the line
+  while (console_tx_busy() || !ended) {
+    uint32_t primask = critical_enter();
+    __WFI();
+    critical_exit(primask);
+    if (sim_now_ns() - t0 > 60000000000ULL) break;
+  }
+  sim_gpio_set_source(GPIOE, NULL);
+  sim_usart_set_tx_sink(USART3, NULL);
+
+  if (vcd_file) fclose(vcd_file);
+
+  // Where the samples sent should have started
+  uint32_t trig = first_trigger(&r->cfg);
+  uint32_t pre = r->cfg.rising || r->cfg.falling ? r->cfg.pre : 0U;
+  if (pre > CAPTURE_PRE_MAX) pre = CAPTURE_PRE_MAX;
+  if (pre > trig) pre = trig;
+
+  int bad = 1;
+  const char *why = "";
+  if (!ended) why = "no END";
+  else if (host.status != r->status) why = "wrong END status";
+  else if (host.lost || host.bad_records) why = "frames lost or bad";
+  else if (host.samples != host.end_samples) why = "sample count differs";
+  else if (log_len > MAX_LOG) why = "log overflow";
+  else if (trig == UINT32_MAX) why = "no trigger in the signal";
+  else if (host.pre != pre) why = "wrong pre-trigger count";
+  else if (r->status == CAPTURE_DONE && host.samples != pre + r->cfg.post) why = "wrong sample count";
+  else if (decoded_bad) why = "samples differ";
+  else bad = 0;
+
+  // Sample times: one period apart, as near as ns go, from first to last
+  uint64_t last = decoded_first + host.samples;
+  for (uint64_t i = decoded_first + 1U; !bad && i < last; i++) {
+    uint64_t d = log_ns[i] - log_ns[i - 1U];
+    if (d < period_ns || d > period_ns + 1U) {
+      bad = 1;
+      why = "sample spacing";
+    }
+  }
+  if (!bad && vcd_text) {
+    uint64_t want = pin_changes(decoded_first, host.samples, r->cfg.mask);
+    uint64_t got = count_vcd_changes(vcd_text);
+    if (got != want || vcd.changes != want) {
+      bad = 1;
+      why = "VCD pin changes";
+    }
+    printf("  %-9s VCD file: %lu bytes, %llu pin changes\n", r->name, (unsigned long)vcd_size,
+           (unsigned long long)got);
+  }
+  free(vcd_text);
+  vcd_text = NULL;
+
+  printf("  %-9s %8lu Hz, %7lu baud: %s after %lu samples (%lu before the trigger), "
+         "%lu bytes of records, %.2f bits/sample%s%s\n",
+         r->name, (unsigned long)rate, (unsigned long)r->baud,
+         capture_host_status_name(host.status), (unsigned long)host.samples,
+         (unsigned long)host.pre, (unsigned long)(capture_stats()->bytes - before.bytes),
+         host.samples ? 8.0 * (double)(capture_stats()->bytes - before.bytes) / (double)host.samples : 0.0,
+         bad ? "  MISMATCH: " : "", why);
+  printf("            %lu blocks, %.1f%% cpu busy while sampling, %lu polls found the line full\n",
+         (unsigned long)(capture_stats()->blocks - before.blocks), 100.0 * (double)busy / (double)cycles,
+         (unsigned long)(capture_stats()->waits - before.waits));
+  failures += (unsigned)bad;
+}
+
+static const run_t runs[] = {
+  // 22000 samples of SPI at 4MHz fit in the ring: 115200 baud is no matter
+  { "burst", 115200U,
+    { GPIOE, 0x0070U, 0, 0x0010U, 4000000U, 2000U, 20000U }, spi_bus, 0, CAPTURE_DONE },
+  // 1s of PWM at 2MHz: 2 million samples through a 32768-sample ring,
+  // in enough frames for the sequence number to wrap
+  { "stream", 921600U,
+    { GPIOE, 0x000EU, 0x0004U, 0, 2000000U, 1000U, 0 }, pwm, 1000000000U, CAPTURE_STOPPED },
+  // A clock at 8MHz is more than 3Mbaud can carry: OVERRUN after the ring
+  { "overrun", 3000000U,
+    { GPIOE, 0x0003U, 0x0001U, 0, 8000000U, 500U, 1000000U }, busy_bus, 0, CAPTURE_OVERRUN },
+  // No trigger pins: from the first sample
+  { "immediate", 921600U,
+    { GPIOE, 0x0070U, 0, 0, 1000000U, 100U, 10000U }, spi_bus, 0, CAPTURE_DONE },
+};
+
+int main(int argc, char **argv) {
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  printf("encoder and decoder, synthetic traces:\n");
+  for (unsigned i = 0; i < sizeof(traces) / sizeof(traces[0]); i++) round_trip(&traces[i]);
+  bad_records();
+
+  printf("captures through TIM1, DMA2 and USART3:\n");
+  for (unsigned i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) capture_run(&runs[i]);
+
+  if (check && failures) {
+    fprintf(stderr, "FAIL: %u mismatches\n", failures);
+    return 1;
+  }
+  return 0;
+}
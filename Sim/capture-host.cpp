@@ -0,0 +1,216 @@
+/*
+ * capture-host.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See capture-host.h, and Src/capture.h for the frames and records.
+ */
+
+#include <string.h>
+
+#include "capture-host.h"
+#include "cmd-host.h"
+
+// VCD identifiers: one printable character per pin, and the trigger's
+#define VCD_ID(PIN)  ((char)('!' + (PIN)))
+#define VCD_TRIGGER  'T'
+
+static inline uint16_t get_le16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int get_varint(const uint8_t **p, const uint8_t *end, uint32_t *v) {
+  uint32_t x = 0;
+  for (unsigned shift = 0; shift < 35U; shift += 7U) {
+    if (*p >= end) return 0;
+    uint8_t b = *(*p)++;
+    x |= (uint32_t)(b & 0x7FU) << shift;
+    if (!(b & 0x80U)) {
+      *v = x;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void capture_host_init(capture_host_t *h) {
+  memset(h, 0, sizeof(*h));
+  h->port = 0xFF;
+}
+
+int capture_host_records(capture_host_t *h, const uint8_t *buf, size_t len) {
+  const uint8_t *p = buf, *end = buf + len;
+
+  while (p < end) {
+    uint32_t x, n;
+    if (!get_varint(&p, end, &x) || !get_varint(&p, end, &n) || x > 0xFFFFU || !n) return -1;
+    h->value ^= (uint16_t)x;
+    if (h->run) h->run(h, h->samples, h->value, n);
+    h->samples += n;
+  }
+  return 0;
+}
+
+static int try_frame(capture_host_t *h) {
+  uint8_t raw[CAPTURE_HOST_FRAME_MAX];
+  uint32_t rl = 0;
+
+  // COBS: each code byte says how far it is to the next (implied) zero
+  uint32_t i = 0;
+  while (i < h->len) {
+    uint8_t code = h->chunk[i++];
+    if (i - 1U + code > h->len) return 0;
+    for (uint32_t k = 1; k < code; k++) raw[rl++] = h->chunk[i++];
+    if (code < 0xFFU && i < h->len) raw[rl++] = 0;
+  }
+  if (rl < 6U) return 0;
+  rl -= 4U;
+  if (cmd_host_crc32(raw, rl) != get_le32(raw + rl)) return 0;
+
+  uint8_t seq = raw[0], type = raw[1];
+  const uint8_t *p = raw + 2;
+  uint32_t n = rl - 2U;
+
+  if (type == CAPTURE_FRAME_HEADER && n >= 15U) {
+    h->rate_hz = get_le32(p);
+    h->port = p[4];
+    h->mask = get_le16(p + 5);
+    h->rising = get_le16(p + 7);
+    h->falling = get_le16(p + 9);
+    h->pre = get_le32(p + 11);
+    h->started = 1;
+    h->value = 0;
+    h->samples = 0;
+    h->next_seq = seq;
+  } else if (type != CAPTURE_FRAME_DATA && type != CAPTURE_FRAME_END) {
+    return 0;
+  }
+  h->frames++;
+  if (seq != h->next_seq && (h->started || type != CAPTURE_FRAME_END)) {
+    h->lost += (uint8_t)(seq - h->next_seq);
+  }
+  h->next_seq = (uint8_t)(seq + 1U);
+
+  if (type == CAPTURE_FRAME_HEADER) {
+    if (h->header) h->header(h);
+  } else if (type == CAPTURE_FRAME_DATA) {
+    if (h->started && capture_host_records(h, p, n)) h->bad_records++;
+  } else if (n >= 5U) {
+    h->end_samples = get_le32(p);
+    h->status = p[4];
+    if (h->end) h->end(h);
+    h->started = 0;
+  }
+  return 1;
+}
+
+static void pass_text(capture_host_t *h, const uint8_t *buf, size_t len) {
+  if (len && h->text) h->text(h, buf, len);
+}
+
+void capture_host_feed(capture_host_t *h, const uint8_t *buf, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    if (buf[i] == 0) {
+      if (!h->long_text && h->len && !try_frame(h)) pass_text(h, h->chunk, h->len);
+      h->len = 0;
+      h->long_text = 0;
+      i++;
+      continue;
+    }
+
+    // The run of bytes up to the next delimiter
+    size_t j = i;
+    while (j < len && buf[j] != 0) j++;
+    if (!h->long_text && h->len + (j - i) > sizeof(h->chunk)) {
+      pass_text(h, h->chunk, h->len);
+      h->len = 0;
+      h->long_text = 1;
+    }
+    if (h->long_text) {
+      pass_text(h, buf + i, j - i);
+    } else {
+      memcpy(h->chunk + h->len, buf + i, j - i);
+      h->len += (uint32_t)(j - i);
+    }
+    i = j;
+  }
+}
+
+void capture_host_flush(capture_host_t *h) {
+  if (!h->long_text && h->len) {
+    pass_text(h, h->chunk, h->len);
+    h->len = 0;
+    h->long_text = 1;
+  }
+}
+
+const char *capture_host_status_name(uint8_t status) {
+  static const char *const names[] = { "done", "stopped", "overrun", "DMA error" };
+  return status < sizeof(names) / sizeof(names[0]) ? names[status] : "?";
+}
+
+// Sample `at` in ps: exact for any rate up to CAPTURE_RATE_MAX
+static uint64_t ps_of(const capture_host_t *h, uint64_t at) {
+  uint64_t rate = h->rate_hz ? h->rate_hz : 1U;
+  return at / rate * 1000000000000ULL + at % rate * 1000000000000ULL / rate;
+}
+
+void capture_vcd_begin(capture_vcd_t *v, FILE *f, const capture_host_t *h) {
+  char port = h->port < 26U ? (char)('A' + h->port) : '?';
+
+  v->f = f;
+  v->h = h;
+  v->last = 0;
+  v->any = 0;
+  v->triggered = 0;
+  v->changes = 0;
+  fprintf(f, "$version capture-vcd $end\n");
+  fprintf(f, "$comment GPIO%c at %lu samples/s; trigger rising %04x falling %04x, "
+             "at sample %lu $end\n",
+          port, (unsigned long)h->rate_hz, h->rising, h->falling, (unsigned long)h->pre);
+  fprintf(f, "$timescale 1ps $end\n$scope module GPIO%c $end\n", port);
+  for (unsigned pin = 0; pin < 16U; pin++) {
+    if (h->mask & (1U << pin)) fprintf(f, "$var wire 1 %c P%c%u $end\n", VCD_ID(pin), port, pin);
+  }
+  fprintf(f, "$var wire 1 %c trigger $end\n$upscope $end\n$enddefinitions $end\n", VCD_TRIGGER);
+}
+
+void capture_vcd_run(capture_vcd_t *v, uint64_t at, uint16_t value, uint32_t len) {
+  const capture_host_t *h = v->h;
+  uint64_t trigger = h->pre;
+  // The trigger is at or inside this run
+  int trig = !v->triggered && trigger >= at && trigger < at + len;
+  uint16_t diff = v->any ? (uint16_t)(value ^ v->last) : h->mask;
+
+  if (diff || (trig && trigger == at)) {
+    fprintf(v->f, v->any ? "#%llu\n" : "#%llu\n$dumpvars\n", (unsigned long long)ps_of(h, at));
+    for (unsigned pin = 0; pin < 16U; pin++) {
+      if (!(diff & (1U << pin))) continue;
+      fprintf(v->f, "%u%c\n", (value >> pin) & 1U, VCD_ID(pin));
+      if (v->any) v->changes++;
+    }
+    if (!v->any) {
+      fprintf(v->f, "%c%c\n$end\n", trig && trigger == at ? '1' : '0', VCD_TRIGGER);
+    } else if (trig && trigger == at) {
+      fprintf(v->f, "1%c\n", VCD_TRIGGER);
+    }
+  }
+  if (trig && trigger > at) {
+    fprintf(v->f, "#%llu\n1%c\n", (unsigned long long)ps_of(h, trigger), VCD_TRIGGER);
+  }
+  if (trig) v->triggered = 1;
+  v->any = 1;
+  v->last = value;
+}
+
+void capture_vcd_end(capture_vcd_t *v, uint64_t at) {
+  if (v->any) fprintf(v->f, "#%llu\n", (unsigned long long)ps_of(v->h, at));
+}
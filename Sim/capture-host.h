@@ -0,0 +1,103 @@
+/*
+ * capture-host.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Host side of the logic-analyzer capture (Src/capture.h): picks the
+ * frames out of the console byte stream, decodes the run-length records
+ * back into runs of samples, and writes them as a VCD file. Used by
+ * capture-vcd and capture-bench.
+ *
+ * As with trace-host.h, anything between two 0x00 bytes that is not a
+ * frame with a good CRC is passed on as text. A frame lost in between is
+ * seen by its sequence number and counted; the runs after it are out of
+ * place by however many samples it held, so a capture with any lost is
+ * best taken again.
+ */
+
+#ifndef CAPTURE_HOST_H_
+#define CAPTURE_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "capture.h"
+
+// The largest frame capture.c sends, without its delimiters
+#define CAPTURE_HOST_FRAME_MAX (2U + CAPTURE_PAYLOAD_MAX + 4U + 2U)
+
+typedef struct capture_host capture_host_t;
+
+struct capture_host {
+  // HEADER: a capture starts, its settings below
+  void (*header)(capture_host_t *h);
+  // `len` samples reading `value`, from sample `at` (0 is the first sent)
+  void (*run)(capture_host_t *h, uint64_t at, uint16_t value, uint32_t len);
+  // END: status and end_samples below
+  void (*end)(capture_host_t *h);
+  // Bytes that were not part of a frame, in order; may be NULL
+  void (*text)(capture_host_t *h, const uint8_t *buf, size_t len);
+  void *ctx;
+
+  // From HEADER
+  uint32_t rate_hz;
+  uint8_t port;           // 0 for GPIOA, 0xFF if not known
+  uint16_t mask, rising, falling;
+  uint32_t pre;           // Samples before the trigger
+  int started;            // A HEADER came, and no END since
+
+  // From END
+  uint32_t end_samples;   // As the firmware counted them
+  uint8_t status;         // capture_end_t
+
+  uint16_t value;         // The last run's
+  uint64_t samples;       // Decoded since HEADER
+  uint8_t next_seq;
+
+  uint8_t chunk[CAPTURE_HOST_FRAME_MAX];
+  uint32_t len;
+  int long_text;          // The current chunk is too long to be a frame
+
+  uint64_t frames;        // Good ones
+  uint64_t lost;          // Missing by sequence number
+  uint64_t bad_records;   // DATA frames whose records did not decode
+};
+
+void capture_host_init(capture_host_t *h);
+
+// Feed bytes as they arrive; calls the callbacks
+void capture_host_feed(capture_host_t *h, const uint8_t *buf, size_t len);
+
+// End of stream, or the line has gone quiet: pass on any text still held
+void capture_host_flush(capture_host_t *h);
+
+// Decode a DATA payload, calling run() for each record. Returns 0, or -1
+// if a record is cut short or has a run of 0 (the runs before it count).
+int capture_host_records(capture_host_t *h, const uint8_t *buf, size_t len);
+
+const char *capture_host_status_name(uint8_t status);
+
+// VCD output: a wire per recorded pin, named after the port (PB7, ...),
+// and `trigger`, high from the trigger sample on. Time is in ps from the
+// first sample sent.
+typedef struct {
+  FILE *f;
+  const capture_host_t *h;
+  uint16_t last;
+  int any;                // A value has been written
+  int triggered;          // The trigger has been written
+  uint64_t changes;       // Pin changes written
+} capture_vcd_t;
+
+// The VCD header and declarations, from h's HEADER
+void capture_vcd_begin(capture_vcd_t *v, FILE *f, const capture_host_t *h);
+
+// A run from capture_host_t's run()
+void capture_vcd_run(capture_vcd_t *v, uint64_t at, uint16_t value, uint32_t len);
+
+// A last timestamp at sample `at`, so the final run shows its length
+void capture_vcd_end(capture_vcd_t *v, uint64_t at);
+
+#endif /* CAPTURE_HOST_H_ */
@@ -0,0 +1,138 @@
+/*
+ * capture-vcd.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Writes the logic-analyzer captures (Src/capture.h) in a console byte
+ * stream to VCD files, for GTKWave or any other waveform viewer.
+ *
+ * Usage: capture-vcd [--out PREFIX] [STREAM]
+ *   STREAM  a capture file, a serial port or a pseudo-terminal; stdin if
+ *           not given. Serial ports are read as they are (set the baud
+ *           rate with stty first).
+ *   --out   capture N goes to PREFIX-N.vcd (default "capture")
+ *
+ * Console text between frames is copied through to stdout; a line on
+ * stderr sums up each capture.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capture-host.h"
+
+// A pause this long ends any text held back as a possible frame
+#define QUIET_MS 100
+
+static const char *prefix = "capture";
+static unsigned captures;
+static FILE *out;
+static capture_vcd_t vcd;
+static uint64_t lost_at_header;
+
+static void got_header(capture_host_t *h) {
+  char path[1024];
+
+  if (out) fclose(out);
+  snprintf(path, sizeof(path), "%s-%u.vcd", prefix, captures++);
+  out = fopen(path, "w");
+  if (!out) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return;
+  }
+  capture_vcd_begin(&vcd, out, h);
+  lost_at_header = h->lost;
+  fprintf(stderr, "%s: %lu samples/s, %lu before the trigger\n", path, (unsigned long)h->rate_hz,
+          (unsigned long)h->pre);
+}
+
+static void got_run(capture_host_t *h, uint64_t at, uint16_t value, uint32_t len) {
+  (void)h;
+  if (out) capture_vcd_run(&vcd, at, value, len);
+}
+
+static void got_end(capture_host_t *h) {
+  if (!h->started) {
+    fprintf(stderr, "capture ended untriggered (%s)\n", capture_host_status_name(h->status));
+    return;
+  }
+  if (out) {
+    capture_vcd_end(&vcd, h->samples);
+    fclose(out);
+    out = NULL;
+  }
+  fprintf(stderr, "  %s: %llu samples, %llu pin changes", capture_host_status_name(h->status),
+          (unsigned long long)h->samples, (unsigned long long)vcd.changes);
+  if (h->samples != h->end_samples || h->lost != lost_at_header) {
+    fprintf(stderr, "; %llu frames lost, the firmware sent %lu samples",
+            (unsigned long long)(h->lost - lost_at_header), (unsigned long)h->end_samples);
+  }
+  fprintf(stderr, "\n");
+}
+
+static void print_text(capture_host_t *h, const uint8_t *buf, size_t len) {
+  (void)h;
+  fwrite(buf, 1, len, stdout);
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  const char *stream = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+      prefix = argv[++i];
+    } else if (argv[i][0] != '-' && !stream) {
+      stream = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s [--out PREFIX] [STREAM]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  int fd = STDIN_FILENO;
+  if (stream && (fd = open(stream, O_RDONLY | O_NOCTTY)) < 0) {
+    fprintf(stderr, "%s: %s\n", stream, strerror(errno));
+    return 1;
+  }
+
+  static capture_host_t h;
+  capture_host_init(&h);
+  h.header = got_header;
+  h.run = got_run;
+  h.end = got_end;
+  h.text = print_text;
+
+  uint8_t buf[4096];
+  for (;;) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int r = poll(&pfd, 1, QUIET_MS);
+    if (r < 0 && errno == EINTR) continue;
+    if (r == 0) {
+      capture_host_flush(&h);
+      continue;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+    if (n <= 0) break;
+    capture_host_feed(&h, buf, (size_t)n);
+  }
+  capture_host_flush(&h);
+
+  if (out) {
+    // The stream ended part way through a capture: keep what came
+    capture_vcd_end(&vcd, h.samples);
+    fclose(out);
+    fprintf(stderr, "  cut short after %llu samples\n", (unsigned long long)h.samples);
+  }
+  fprintf(stderr, "%u captures\n", captures);
+  return 0;
+}
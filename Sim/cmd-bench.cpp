@@ -0,0 +1,358 @@
+/*
+ * cmd-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Command throughput of cmd.c against cmd-host.h on the simulated USART3.
+ *
+ * The host side keeps `window` pings outstanding (1: one at a time, or
+ * CMD_QUEUE_LEN: pipelined) while a main loop like main.c's runs
+ * cmd_poll() and sleeps in __WFI() between requests. Every reply must
+ * echo its own payload. Each line gives commands/s, how near that is to
+ * what the line itself allows (baud / 10 over the longer of the two
+ * frames), the CPU time it took and the latency from the host sending
+ * a request (it may wait behind others) to its response being complete.
+ *
+ * Then the error paths: request frames with a byte damaged, keys typed
+ * between frames, unknown ids and wrong lengths. Damaged requests must
+ * be counted and not answered, the host must expire and resend them,
+ * and the keys must reach uart_try_read() in order.
+ *
+ * Usage: cmd-bench [--seconds S] [--check]
+ *   --check  exit with status 1 if a reply is wrong or missing, an error
+ *            path misbehaves, or pipelined pings reach less than
+ *            MIN_LINE_FRACTION of the line's bound
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "clock.h"
+#include "cmd.h"
+#include "cmd-host.h"
+#include "console.h"
+#include "critical.h"
+#include "uart.h"
+
+// Drivers from Src/main.c (which has no header of its own)
+void uart3_rxtx_init(void);
+
+#define MIN_LINE_FRACTION 0.90
+#define PING_LEN 16U
+#define HOST_QUEUE (1U << 16)
+
+#define ID_PING  0x01U
+#define ID_STATS 0x02U
+#define ID_NONE  0x7EU
+
+static const cmd_entry_t commands[] = {
+  { ID_PING, 0, CMD_PAYLOAD_MAX, "ping", cmd_ping },
+  { ID_STATS, 0, 0, "stats", cmd_get_stats },
+};
+
+// Bytes from the host waiting to go onto the line, in order
+static uint8_t host_q[HOST_QUEUE];
+static uint32_t host_head, host_tail;
+
+static cmd_client_t client;
+
+// What each outstanding sequence number should come back with
+static uint8_t expect[256][PING_LEN];
+
+// Results of the current run
+static struct {
+  uint64_t replies;
+  uint64_t wrong;       // Bad payload or status
+  uint64_t lat_sum;
+  uint64_t lat_max;
+  uint64_t resent;
+  uint8_t last_status;  // Of the last reply, for the error path checks
+  uint32_t last_len;
+  uint8_t last_payload[CMD_PAYLOAD_MAX];
+  uint64_t text;        // Bytes the host saw outside responses
+} run_stats;
+
+// Damage one request frame in every `corrupt_every` (0: none)
+static uint32_t corrupt_every, corrupt_count, frame_count;
+
+static void host_send(cmd_client_t *c, const uint8_t *buf, size_t len) {
+  (void)c;
+  frame_count++;
+  size_t hit = 0;
+  if (corrupt_every && frame_count % corrupt_every == 0) {
+    // Anything inside the delimiters, to another non-zero byte, so the
+    // frame keeps its length and the one after it is not disturbed
+    hit = 1 + frame_count % (len - 2);
+    corrupt_count++;
+  }
+  for (size_t i = 0; i < len; i++) {
+    uint8_t b = buf[i];
+    if (i == hit && hit) b = (uint8_t)(b == 0xFFU ? 0x01U : b + 1U);
+    host_q[host_head++ % HOST_QUEUE] = b;
+  }
+}
+
+static void host_keys(const char *s) {
+  while (*s) host_q[host_head++ % HOST_QUEUE] = (uint8_t)*s++;
+}
+
+static int rx_from_host(USART_TypeDef *usart) {
+  (void)usart;
+  if (host_tail == host_head) return -1;
+  return host_q[host_tail++ % HOST_QUEUE];
+}
+
+static void to_host(USART_TypeDef *usart, uint8_t c) {
+  (void)usart;
+  cmd_client_feed(&client, &c, 1);
+}
+
+static void got_response(cmd_client_t *c, const cmd_response_t *r) {
+  (void)c;
+  uint64_t lat = sim_count.cycles - r->sent_at;
+  run_stats.replies++;
+  run_stats.lat_sum += lat;
+  if (lat > run_stats.lat_max) run_stats.lat_max = lat;
+  run_stats.last_status = r->status;
+  run_stats.last_len = (uint32_t)r->len;
+  memcpy(run_stats.last_payload, r->payload, r->len);
+  if (r->id == ID_PING &&
+      (r->status != CMD_OK || r->len != PING_LEN || memcmp(r->payload, expect[r->seq], PING_LEN))) {
+    run_stats.wrong++;
+  }
+}
+
+static void got_text(cmd_client_t *c, const uint8_t *buf, size_t len) {
+  (void)c;
+  (void)buf;
+  run_stats.text += len;
+}
+
+static uint32_t lcg = 12345;
+
+static int send_ping(void) {
+  uint8_t payload[PING_LEN];
+  for (unsigned k = 0; k < PING_LEN; k++) {
+    lcg = lcg * 1664525U + 1013904223U;
+    payload[k] = (uint8_t)(lcg >> 24); // Zeros too, for COBS
+  }
+  int seq = cmd_client_request(&client, ID_PING, payload, PING_LEN, sim_count.cycles);
+  if (seq >= 0) memcpy(expect[seq], payload, PING_LEN);
+  return seq;
+}
+
+// Resend an expired ping as a new request
+static void resend(cmd_client_t *c, uint8_t seq, uint8_t id) {
+  (void)c;
+  (void)id;
+  uint8_t payload[PING_LEN];
+  memcpy(payload, expect[seq], PING_LEN);
+  int s = cmd_client_request(&client, ID_PING, payload, PING_LEN, sim_count.cycles);
+  if (s >= 0) memcpy(expect[s], payload, PING_LEN);
+  run_stats.resent++;
+}
+
+// main.c's wait: handle requests, else sleep until the next interrupt
+static void firmware_step(void) {
+  cmd_poll();
+  uint32_t primask = critical_enter();
+  if (!cmd_pending()) __WFI();
+  critical_exit(primask);
+}
+
+static void start(uint32_t baud) {
+  uart_open(uart_port(UART_USART3), baud);
+  console_init();
+  cmd_init(commands, sizeof(commands) / sizeof(commands[0]));
+  cmd_client_init(&client);
+  client.send = host_send;
+  client.response = got_response;
+  client.text = got_text;
+  host_head = host_tail = 0;
+  memset(&run_stats, 0, sizeof(run_stats));
+  corrupt_every = corrupt_count = frame_count = 0;
+}
+
+// Line time of one byte, in core cycles
+static uint64_t byte_cycles(void) {
+  return sim_usart_frame_cycles(USART3);
+}
+
+// Let everything in flight finish: the host queue, the firmware and
+// the responses on the line
+static void drain(uint64_t timeout) {
+  uint64_t until = sim_count.cycles + timeout;
+  while (sim_count.cycles < until && (client.outstanding || host_tail != host_head || cmd_pending())) {
+    firmware_step();
+  }
+  until = sim_count.cycles + 64U * byte_cycles();
+  while (sim_count.cycles < until) firmware_step();
+  cmd_client_flush(&client);
+}
+
+// One throughput run; returns 0 if it failed
+static int run(uint32_t baud, uint32_t window, double seconds) {
+  start(baud);
+
+  uint64_t b = byte_cycles();
+  // Request and response frames: header, payload, CRC, COBS code, two 0x00
+  uint32_t req_frame = 2U + PING_LEN + 4U + 3U;
+  uint32_t resp_frame = 3U + PING_LEN + 4U + 3U;
+  double bound = (double)sim_core_hz / (double)b / (double)(req_frame > resp_frame ? req_frame : resp_frame);
+
+  sim_counters_t s0 = sim_count;
+  uint64_t end = s0.cycles + (uint64_t)(seconds * sim_core_hz);
+  while (sim_count.cycles < end) {
+    while (client.outstanding < window) send_ping();
+    firmware_step();
+  }
+  uint64_t replies_in_time = run_stats.replies;
+  sim_counters_t s1 = sim_count;
+  drain(1000U * b);
+
+  uint64_t cycles = s1.cycles - s0.cycles;
+  double rate = (double)replies_in_time * sim_core_hz / (double)cycles;
+  double busy = (double)(cycles - (s1.idle_cycles - s0.idle_cycles));
+  double us = 1e6 / sim_core_hz;
+  const cmd_stats_t *fw = cmd_stats();
+  uint64_t lost = client.requests - client.responses;
+
+  printf("%8lu %6lu %8.0f %8.0f %6.1f%% %6.1f%% %9.0f %7.1f %8.1f %8.1f %5llu\n",
+         (unsigned long)baud, (unsigned long)window, rate, bound, 100.0 * rate / bound,
+         100.0 * busy / cycles, busy / (double)replies_in_time,
+         (double)(s1.irq_entries - s0.irq_entries) / (double)replies_in_time,
+         us * (double)run_stats.lat_sum / (double)run_stats.replies,
+         us * (double)run_stats.lat_max,
+         (unsigned long long)(lost + run_stats.wrong + fw->bad_crc + fw->bad_frame + fw->dropped));
+
+  int ok = !lost && !run_stats.wrong && !client.unmatched && !fw->bad_crc && !fw->bad_frame &&
+           !fw->dropped && fw->peak_queued <= window;
+  if (window == CMD_QUEUE_LEN && rate < MIN_LINE_FRACTION * bound) ok = 0;
+  return ok;
+}
+
+// Damaged frames and typed keys in between good ones; returns 0 if it failed
+static int errors(uint32_t baud, uint32_t pings) {
+  static const char keys[] = "hello, keys between the frames";
+  int ok = 1;
+
+  start(baud);
+  uint64_t b = byte_cycles();
+  corrupt_every = 5;
+
+  uint32_t sent = 0, key = 0;
+  uint8_t typed[sizeof(keys)];
+  uint32_t typed_len = 0;
+  uint64_t timeout = 400U * b;
+  while (sent < pings || client.outstanding) {
+    if (sent < pings && client.outstanding < CMD_QUEUE_LEN) {
+      send_ping();
+      sent++;
+      if (keys[key] && (sent & 1U)) {
+        char k[2] = { keys[key++], 0 };
+        host_keys(k);
+      }
+    }
+    firmware_step();
+    uint8_t c;
+    while (uart_try_read(&c)) {
+      if (typed_len < sizeof(typed)) typed[typed_len++] = c;
+    }
+    if (sim_count.cycles > timeout) cmd_client_expire(&client, sim_count.cycles - timeout, resend);
+  }
+  drain(1000U * b);
+  uint8_t c;
+  while (uart_try_read(&c)) {
+    if (typed_len < sizeof(typed)) typed[typed_len++] = c;
+  }
+
+  const cmd_stats_t *fw = cmd_stats();
+  printf("%lu pings, %lu frames damaged: %lu bad CRC, %lu bad frame, %lu expired and resent\n",
+         (unsigned long)pings, (unsigned long)corrupt_count, (unsigned long)fw->bad_crc,
+         (unsigned long)fw->bad_frame, (unsigned long)run_stats.resent);
+  if (fw->bad_crc + fw->bad_frame != corrupt_count || run_stats.resent != corrupt_count) {
+    printf("  FAIL: every damaged frame should be counted and resent once\n");
+    ok = 0;
+  }
+  if (run_stats.replies != pings || run_stats.wrong || client.unmatched) {
+    printf("  FAIL: %llu replies for %lu pings, %llu wrong, %llu unmatched\n",
+           (unsigned long long)run_stats.replies, (unsigned long)pings,
+           (unsigned long long)run_stats.wrong, (unsigned long long)client.unmatched);
+    ok = 0;
+  }
+  printf("%lu keys typed between frames, %lu read back\n", (unsigned long)key, (unsigned long)typed_len);
+  if (typed_len != key || memcmp(typed, keys, key)) {
+    printf("  FAIL: keys lost or out of order\n");
+    ok = 0;
+  }
+
+  // Requests the table turns down, and the counters themselves
+  corrupt_every = 0;
+  uint8_t big[CMD_PAYLOAD_MAX];
+  memset(big, 0x55, sizeof(big));
+  cmd_client_request(&client, ID_NONE, NULL, 0, sim_count.cycles);
+  drain(1000U * b);
+  int unknown_ok = run_stats.last_status == CMD_ERR_UNKNOWN && fw->unknown == 1;
+  cmd_client_request(&client, ID_STATS, big, 1, sim_count.cycles);
+  drain(1000U * b);
+  int length_ok = run_stats.last_status == CMD_ERR_LENGTH;
+  cmd_client_request(&client, ID_STATS, NULL, 0, sim_count.cycles);
+  drain(1000U * b);
+  uint32_t got_requests = (uint32_t)run_stats.last_payload[0] | ((uint32_t)run_stats.last_payload[1] << 8) |
+                          ((uint32_t)run_stats.last_payload[2] << 16) |
+                          ((uint32_t)run_stats.last_payload[3] << 24);
+  int stats_ok = run_stats.last_status == CMD_OK && run_stats.last_len == sizeof(cmd_stats_t) &&
+                 got_requests == fw->requests;
+  printf("unknown id: %s, wrong length: %s, stats: %s (%lu requests)\n",
+         unknown_ok ? "refused" : "FAIL", length_ok ? "refused" : "FAIL",
+         stats_ok ? "ok" : "FAIL", (unsigned long)got_requests);
+  return ok && unknown_ok && length_ok && stats_ok;
+}
+
+int main(int argc, char **argv) {
+  static const uint32_t bauds[] = { 115200, 921600, 2000000 };
+  double seconds = 0.2;
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+      seconds = strtod(argv[++i], NULL);
+    } else if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--seconds S] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  sim_reset();
+  clock_init();
+  uart3_rxtx_init();
+  console_init();
+  sim_usart_set_tx_sink(USART3, to_host);
+  sim_usart_set_rx_source(USART3, rx_from_host);
+
+  printf("%u byte pings for %.2f s each, core %lu Hz\n\n", PING_LEN, seconds, (unsigned long)sim_core_hz);
+  printf("%8s %6s %8s %8s %7s %7s %9s %7s %8s %8s %5s\n", "baud", "window", "cmd/s", "bound",
+         "of it", "cpu", "cyc/cmd", "irq/cmd", "mean us", "max us", "bad");
+
+  int ok = 1;
+  for (unsigned i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+    ok &= run(bauds[i], 1, seconds);
+    ok &= run(bauds[i], CMD_QUEUE_LEN, seconds);
+  }
+  printf("\n");
+  ok &= errors(921600, 200);
+
+  if (check && !ok) {
+    fprintf(stderr, "FAIL: a reply was wrong or missing, an error path misbehaved, or pipelined "
+                    "pings fell below %.0f%% of the line's bound\n", 100.0 * MIN_LINE_FRACTION);
+    return 1;
+  }
+  return 0;
+}
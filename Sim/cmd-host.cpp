@@ -0,0 +1,168 @@
+/*
+ * cmd-host.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See cmd-host.h, and Src/cmd.h for the frame format.
+ */
+
+#include <string.h>
+
+#include "cmd-host.h"
+
+uint32_t cmd_host_crc32(const void *buf, size_t len) {
+  const uint8_t *p = (const uint8_t *)buf;
+  uint32_t crc = 0xFFFFFFFFUL;
+  while (len--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320UL & (0U - (crc & 1U)));
+  }
+  return ~crc;
+}
+
+size_t cmd_host_frame(uint8_t *out, const uint8_t *raw, size_t len) {
+  uint8_t *p = out;
+  *p++ = 0;
+  uint8_t *code_at = p++;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; i++) {
+    if (raw[i] == 0) {
+      *code_at = code;
+      code_at = p++;
+      code = 1;
+    } else {
+      *p++ = raw[i];
+      if (++code == 0xFFU) {
+        *code_at = code;
+        code_at = p++;
+        code = 1;
+      }
+    }
+  }
+  *code_at = code;
+  *p++ = 0;
+  return (size_t)(p - out);
+}
+
+void cmd_client_init(cmd_client_t *c) {
+  memset(c, 0, sizeof(*c));
+}
+
+int cmd_client_request(cmd_client_t *c, uint8_t id, const void *payload, size_t len, uint64_t now) {
+  uint8_t raw[2U + CMD_PAYLOAD_MAX + 4U];
+  uint8_t frame[sizeof(raw) + sizeof(raw) / 254U + 3U];
+
+  if (len > CMD_PAYLOAD_MAX || c->outstanding == 256U) return -1;
+  uint8_t seq = c->next_seq;
+  while (c->pending[seq].busy) seq++;
+  c->next_seq = (uint8_t)(seq + 1U);
+  c->pending[seq].busy = 1;
+  c->pending[seq].id = id;
+  c->pending[seq].sent_at = now;
+  c->outstanding++;
+  c->requests++;
+
+  raw[0] = seq;
+  raw[1] = id;
+  memcpy(raw + 2, payload, len);
+  uint32_t crc = cmd_host_crc32(raw, len + 2U);
+  for (int k = 0; k < 4; k++) raw[len + 2U + k] = (uint8_t)(crc >> (8 * k));
+  c->send(c, frame, cmd_host_frame(frame, raw, len + 6U));
+  return seq;
+}
+
+// Decode the held chunk as a response; 0 if it is not one
+static int try_response(cmd_client_t *c) {
+  uint8_t raw[CMD_HOST_FRAME_MAX];
+  uint32_t rl = 0;
+
+  uint32_t i = 0;
+  while (i < c->len) {
+    uint8_t code = c->chunk[i++];
+    if (i - 1U + code > c->len) return 0;
+    for (uint32_t k = 1; k < code; k++) raw[rl++] = c->chunk[i++];
+    if (code < 0xFFU && i < c->len) raw[rl++] = 0;
+  }
+  if (rl < 7U || !(raw[1] & CMD_RESPONSE)) return 0;
+  uint32_t n = rl - 4U;
+  uint32_t crc = (uint32_t)raw[n] | ((uint32_t)raw[n + 1U] << 8) |
+                 ((uint32_t)raw[n + 2U] << 16) | ((uint32_t)raw[n + 3U] << 24);
+  if (cmd_host_crc32(raw, n) != crc) return 0;
+
+  uint8_t seq = raw[0], id = (uint8_t)(raw[1] & ~CMD_RESPONSE);
+  if (!c->pending[seq].busy || c->pending[seq].id != id) {
+    c->unmatched++;
+    return 1;
+  }
+  cmd_response_t r = { seq, id, raw[2], raw + 3, n - 3U, c->pending[seq].sent_at };
+  c->pending[seq].busy = 0;
+  c->outstanding--;
+  c->responses++;
+  if (c->response) c->response(c, &r);
+  return 1;
+}
+
+static void pass_text(cmd_client_t *c, const uint8_t *buf, size_t len) {
+  if (len && c->text) c->text(c, buf, len);
+}
+
+void cmd_client_feed(cmd_client_t *c, const uint8_t *buf, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    if (buf[i] == 0) {
+      if (!c->long_text && c->len && !try_response(c)) pass_text(c, c->chunk, c->len);
+      c->len = 0;
+      c->long_text = 0;
+      i++;
+      continue;
+    }
+
+    size_t j = i;
+    while (j < len && buf[j] != 0) j++;
+    if (!c->long_text && c->len + (j - i) > sizeof(c->chunk)) {
+      pass_text(c, c->chunk, c->len);
+      c->len = 0;
+      c->long_text = 1;
+    }
+    if (c->long_text) {
+      pass_text(c, buf + i, j - i);
+    } else {
+      memcpy(c->chunk + c->len, buf + i, j - i);
+      c->len += (uint32_t)(j - i);
+    }
+    i = j;
+  }
+}
+
+void cmd_client_flush(cmd_client_t *c) {
+  if (!c->long_text && c->len) {
+    pass_text(c, c->chunk, c->len);
+    c->len = 0;
+    c->long_text = 1;
+  }
+}
+
+uint32_t cmd_client_expire(cmd_client_t *c, uint64_t before,
+                           void (*expired)(cmd_client_t *c, uint8_t seq, uint8_t id)) {
+  uint32_t n = 0;
+  for (unsigned s = 0; s < 256U && c->outstanding; s++) {
+    if (!c->pending[s].busy || c->pending[s].sent_at >= before) continue;
+    c->pending[s].busy = 0;
+    c->outstanding--;
+    c->expired++;
+    n++;
+    if (expired) expired(c, (uint8_t)s, c->pending[s].id);
+  }
+  return n;
+}
+
+int cmd_client_forget(cmd_client_t *c, uint8_t seq) {
+  if (!c->pending[seq].busy) return 0;
+  c->pending[seq].busy = 0;
+  c->outstanding--;
+  c->expired++;
+  return 1;
+}
@@ -0,0 +1,103 @@
+/*
+ * cmd-host.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Host side of the framed command protocol (Src/cmd.h): builds request
+ * frames, picks responses out of the byte stream and matches each to its
+ * request by sequence number. Used by cmd-bench; the transport is the
+ * caller's, through send().
+ *
+ * Up to 256 requests can be outstanding, one per sequence number. A
+ * request that is never answered (its frame or the response was damaged,
+ * or the firmware's queue was full) stays outstanding until
+ * cmd_client_expire() gives up on it; resending it is the caller's call.
+ *
+ * As with trace-host.h, anything between two 0x00 bytes that is not a
+ * response with a good CRC is passed on as text: console output, and
+ * trace records, share the line.
+ */
+
+#ifndef CMD_HOST_H_
+#define CMD_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cmd.h"
+
+// The largest response frame, without its delimiters
+#define CMD_HOST_FRAME_MAX (3U + CMD_PAYLOAD_MAX + 4U + 2U)
+
+typedef struct {
+  uint8_t seq;
+  uint8_t id;              // The request's, without CMD_RESPONSE
+  uint8_t status;          // cmd_status_t
+  const uint8_t *payload;
+  size_t len;
+  uint64_t sent_at;        // As given to cmd_client_request()
+} cmd_response_t;
+
+typedef struct cmd_client cmd_client_t;
+
+struct cmd_client {
+  // Bytes for the line: a whole frame, delimiters included
+  void (*send)(cmd_client_t *c, const uint8_t *buf, size_t len);
+  // A response to an outstanding request
+  void (*response)(cmd_client_t *c, const cmd_response_t *r);
+  // Bytes that were not part of a response, in order; may be NULL
+  void (*text)(cmd_client_t *c, const uint8_t *buf, size_t len);
+  void *ctx;
+
+  struct {
+    uint8_t busy;
+    uint8_t id;
+    uint64_t sent_at;
+  } pending[256];
+  uint32_t outstanding;
+  uint8_t next_seq;
+
+  uint8_t chunk[CMD_HOST_FRAME_MAX];
+  uint32_t len;
+  int long_text;  // The current chunk is too long to be a response
+
+  uint64_t requests;   // Sent
+  uint64_t responses;  // Matched to a request
+  uint64_t unmatched;  // Good responses to no outstanding request
+  uint64_t expired;    // Given up on by cmd_client_expire()
+};
+
+void cmd_client_init(cmd_client_t *c);
+
+// Send a request; now is any timestamp the caller likes, handed back with
+// the response. Returns the sequence number, or -1 if all 256 are
+// outstanding or the payload is over CMD_PAYLOAD_MAX.
+int cmd_client_request(cmd_client_t *c, uint8_t id, const void *payload, size_t len, uint64_t now);
+
+// Feed bytes from the line as they arrive; calls response() and text()
+void cmd_client_feed(cmd_client_t *c, const uint8_t *buf, size_t len);
+
+// The line has gone quiet: pass on any text still held back
+void cmd_client_flush(cmd_client_t *c);
+
+// Forget requests sent before `before`; returns how many. Calls back
+// expired() for each, if it is not NULL, with the request's sequence
+// number and id.
+uint32_t cmd_client_expire(cmd_client_t *c, uint64_t before,
+                           void (*expired)(cmd_client_t *c, uint8_t seq, uint8_t id));
+
+// Forget one request, as cmd_client_expire() would, when the caller
+// knows it is lost: the firmware answers in order, so a request still
+// outstanding when a later one is answered never will be. Returns 0 if
+// seq was not outstanding.
+int cmd_client_forget(cmd_client_t *c, uint8_t seq);
+
+// CRC-32 as Src/crc.h computes it
+uint32_t cmd_host_crc32(const void *buf, size_t len);
+
+// COBS-encode len bytes between two 0x00 delimiters; returns the frame
+// length, at most len + len / 254 + 3
+size_t cmd_host_frame(uint8_t *out, const uint8_t *raw, size_t len);
+
+#endif /* CMD_HOST_H_ */
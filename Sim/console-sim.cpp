@@ -0,0 +1,117 @@
+/*
+ * console-sim.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Runs the firmware's main() on the simulated board with USART3 bridged
+ * to the host: stdin/stdout by default, or a pseudo-terminal with --pty
+ * (connect a terminal program to the /dev/pts path it prints).
+ *
+ * Simulated time is held back to real time while waiting for input, so
+ * an idle firmware does not spin the host CPU.
+ * Exits shortly after stdin reaches end of file.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+int firmware_main(void); // Src/main.c, built with -Dmain=firmware_main
+
+static int in_fd = STDIN_FILENO;
+static int out_fd = STDOUT_FILENO;
+static uint64_t eof_at; // Simulated cycle stdin ended, or 0
+static struct timespec start;
+
+static uint8_t out_buf[256];
+static size_t out_len;
+
+static void flush_out(void) {
+  size_t off = 0;
+  while (off < out_len) {
+    ssize_t n = write(out_fd, out_buf + off, out_len - off);
+    if (n < 0 && errno != EINTR && errno != EAGAIN) break;
+    if (n > 0) off += (size_t)n;
+  }
+  out_len = 0;
+}
+
+static void tx_to_host(USART_TypeDef *usart, uint8_t c) {
+  (void)usart;
+  out_buf[out_len++] = c;
+  if (c == '\n' || out_len == sizeof(out_buf)) flush_out();
+}
+
+// Sleep off however far simulated time has run ahead of the wall clock
+static void pace(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  double real = (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) * 1e-9;
+  double sim = (double)sim_count.cycles / sim_core_hz;
+  if (sim > real + 0.001) {
+    double ahead = sim - real;
+    if (ahead > 0.05) ahead = 0.05;
+    usleep((useconds_t)(ahead * 1e6));
+  }
+}
+
+static int rx_from_host(USART_TypeDef *usart) {
+  (void)usart;
+  uint8_t c;
+
+  if (eof_at) {
+    // Give the firmware a tenth of a simulated second to finish replying
+    if (sim_count.cycles - eof_at > sim_core_hz / 10U) {
+      flush_out();
+      exit(0);
+    }
+    return -1;
+  }
+
+  ssize_t n = read(in_fd, &c, 1);
+  if (n == 1) return c;
+  if (n == 0 && in_fd == STDIN_FILENO) {
+    eof_at = sim_count.cycles;
+    return -1;
+  }
+  // EAGAIN, or EIO on a pty nobody has opened yet
+  flush_out();
+  pace();
+  return -1;
+}
+
+static int open_pty(void) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+    perror("console-sim: pty");
+    exit(1);
+  }
+  fprintf(stderr, "console-sim: USART3 is on %s\n", ptsname(fd));
+  return fd;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "--pty")) {
+    in_fd = out_fd = open_pty();
+  } else if (argc > 1) {
+    fprintf(stderr, "usage: %s [--pty]\n", argv[0]);
+    return 2;
+  }
+  fcntl(in_fd, F_SETFL, fcntl(in_fd, F_GETFL) | O_NONBLOCK);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  sim_reset();
+  sim_usart_set_tx_sink(USART3, tx_to_host);
+  sim_usart_set_rx_source(USART3, rx_from_host);
+
+  return firmware_main();
+}
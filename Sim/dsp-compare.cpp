@@ -0,0 +1,250 @@
+/*
+ * dsp-compare.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * dsp.c's kernels against their scalar references.
+ *
+ * Each signal goes through the reference whole, and through the kernel in
+ * pseudo-random block sizes (odd ones included), once into a separate
+ * buffer and once in place. The Q15 kernels and the conversions must give
+ * exactly what the references do, saturation and NaN included; the
+ * biquads must agree to within rounding. The DSP instructions are those
+ * of stm32f7xx.h here, so this checks the arithmetic, not the timing:
+ * the cycle counts come from dsp-bench.c on the board.
+ *
+ * Usage: dsp-compare [--check]
+ *   --check  exit with status 1 if any kernel differs from its reference
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dsp.h"
+
+#define SIGNAL    4099  // Not a multiple of any block size
+#define MAX_BLOCK 67
+#define TRIALS    20
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return rng;
+}
+
+static int16_t random_q15(void) {
+  return (int16_t)next_random();
+}
+
+static uint32_t random_block(void) {
+  return 1U + (uint32_t)(next_random() % MAX_BLOCK);
+}
+
+static int cases, bad;
+
+static void result(const char *what, int ok) {
+  cases++;
+  if (!ok) {
+    printf("MISMATCH %s\n", what);
+    bad++;
+  }
+}
+
+static int same_q15(const int16_t *a, const int16_t *b, int n) {
+  return !memcmp(a, b, n * sizeof(*a));
+}
+
+// Within tol of the reference, relative to its largest sample
+static int close_enough(const double *ref, const double *y, int n, double tol) {
+  double peak = 1.0, worst = 0.0;
+  for (int i = 0; i < n; i++) peak = fmax(peak, fabs(ref[i]));
+  for (int i = 0; i < n; i++) worst = fmax(worst, fabs(y[i] - ref[i]));
+  return worst <= tol * peak;
+}
+
+static int16_t x[SIGNAL], x2[SIGNAL], ref[SIGNAL], y[SIGNAL], yin[SIGNAL];
+
+static void fir(uint32_t num_taps) {
+  static int16_t taps[65], state[64 + MAX_BLOCK];
+  char name[40];
+  dsp_fir_q15_t f, g;
+
+  for (uint32_t k = 0; k < num_taps; k++) taps[k] = random_q15();
+  dsp_fir_q15_ref(taps, num_taps, x, ref, SIGNAL);
+
+  // Full-scale taps saturate; a separate state buffer for the in-place run
+  static int16_t state2[64 + MAX_BLOCK];
+  dsp_fir_q15_init(&f, taps, num_taps, state, MAX_BLOCK);
+  dsp_fir_q15_init(&g, taps, num_taps, state2, MAX_BLOCK);
+  memcpy(yin, x, sizeof(x));
+  for (uint32_t i = 0, n; i < SIGNAL; i += n) {
+    n = random_block();
+    if (n > SIGNAL - i) n = SIGNAL - i;
+    dsp_fir_q15(&f, x + i, y + i, n);
+    dsp_fir_q15(&g, yin + i, yin + i, n);
+  }
+  snprintf(name, sizeof(name), "FIR q15, %lu taps", (unsigned long)num_taps);
+  result(name, same_q15(ref, y, SIGNAL) && same_q15(ref, yin, SIGNAL));
+}
+
+static void movavg(uint32_t len) {
+  static int16_t state[100 + MAX_BLOCK], state2[100 + MAX_BLOCK];
+  char name[40];
+  dsp_movavg_q15_t m, m2;
+
+  dsp_movavg_q15_ref(len, x, ref, SIGNAL);
+  dsp_movavg_q15_init(&m, len, state, MAX_BLOCK);
+  dsp_movavg_q15_init(&m2, len, state2, MAX_BLOCK);
+  memcpy(yin, x, sizeof(x));
+  for (uint32_t i = 0, n; i < SIGNAL; i += n) {
+    n = random_block();
+    if (n > SIGNAL - i) n = SIGNAL - i;
+    dsp_movavg_q15(&m, x + i, y + i, n);
+    dsp_movavg_q15(&m2, yin + i, yin + i, n);
+  }
+  snprintf(name, sizeof(name), "moving average q15, %lu", (unsigned long)len);
+  result(name, same_q15(ref, y, SIGNAL) && same_q15(ref, yin, SIGNAL));
+}
+
+// A cascade of second-order low-pass sections at fc (of fs) and q, by
+// the usual bilinear-transform design
+static void lowpass(double *c, uint32_t sections, double fc, double q) {
+  double w = 2.0 * M_PI * fc, alpha = sin(w) / (2.0 * q), a0 = 1.0 + alpha;
+  for (uint32_t s = 0; s < sections; s++, c += 5) {
+    c[0] = (1.0 - cos(w)) / 2.0 / a0;
+    c[1] = (1.0 - cos(w)) / a0;
+    c[2] = c[0];
+    c[3] = -2.0 * cos(w) / a0;
+    c[4] = (1.0 - alpha) / a0;
+  }
+}
+
+static void biquad(uint32_t sections, double fc, double q) {
+  static double c64[5 * 8], s64[2 * 8], xd[SIGNAL], refd[SIGNAL], yd[SIGNAL], yf_d[SIGNAL];
+  static float c32[5 * 8], s32[2 * 8], xf[SIGNAL], yf[SIGNAL];
+  char name[60];
+  dsp_biquad_f32_t f32;
+  dsp_biquad_f64_t f64;
+
+  lowpass(c64, sections, fc, q);
+  for (uint32_t k = 0; k < 5 * sections; k++) c32[k] = (float)c64[k];
+  for (int i = 0; i < SIGNAL; i++) {
+    xf[i] = (float)x[i] / 32768.0f;
+    xd[i] = xf[i];
+  }
+
+  dsp_biquad_ref(c64, sections, xd, refd, SIGNAL);
+  dsp_biquad_f64_init(&f64, c64, sections, s64);
+  memcpy(yd, xd, sizeof(xd));
+  for (uint32_t i = 0, n; i < SIGNAL; i += n) {
+    n = random_block();
+    if (n > SIGNAL - i) n = SIGNAL - i;
+    dsp_biquad_f64(&f64, yd + i, yd + i, n);
+  }
+  snprintf(name, sizeof(name), "biquad f64, %lu sections at %.3f fs", (unsigned long)sections, fc);
+  result(name, close_enough(refd, yd, SIGNAL, 1e-9));
+
+  // Against the single-precision coefficients' own response
+  for (uint32_t k = 0; k < 5 * sections; k++) c64[k] = c32[k];
+  dsp_biquad_ref(c64, sections, xd, refd, SIGNAL);
+  dsp_biquad_f32_init(&f32, c32, sections, s32);
+  for (uint32_t i = 0, n; i < SIGNAL; i += n) {
+    n = random_block();
+    if (n > SIGNAL - i) n = SIGNAL - i;
+    dsp_biquad_f32(&f32, xf + i, yf + i, n);
+  }
+  for (int i = 0; i < SIGNAL; i++) yf_d[i] = yf[i];
+  snprintf(name, sizeof(name), "biquad f32, %lu sections at %.3f fs", (unsigned long)sections, fc);
+  result(name, close_enough(refd, yf_d, SIGNAL, 1e-3));
+}
+
+static void conversions(void) {
+  static float f[SIGNAL], fref[SIGNAL];
+  int n = SIGNAL;
+
+  dsp_q15_to_f32_ref(x, fref, n);
+  dsp_q15_to_f32(x, f, n);
+  result("q15 -> f32", !memcmp(f, fref, sizeof(f)));
+
+  // Past full scale, exact halves of a step either side, and the odd ones
+  for (int i = 0; i < n; i++) {
+    uint64_t r = next_random();
+    switch (r % 4U) {
+    case 0:  f[i] = (float)((int32_t)(r >> 8) % 50000) / 32768.0f; break;
+    case 1:  f[i] = ((float)(int16_t)(r >> 16) + 0.5f) / 32768.0f; break;
+    case 2:  f[i] = (float)(int16_t)(r >> 16) / 32768.0f * 1.0001f; break;
+    default: f[i] = (float)(int32_t)(r >> 32) / 65536.0f; break;
+    }
+  }
+  static const float special[] = { NAN, -NAN, INFINITY, -INFINITY, 1.0f, -1.0f, 0.0f, -0.0f,
+                                   32767.5f / 32768.0f, -32768.5f / 32768.0f, 0.5f / 32768.0f,
+                                   1.5f / 32768.0f, -0.5f / 32768.0f, -1.5f / 32768.0f, 1e30f };
+  memcpy(f + 1, special, sizeof(special)); // Odd-aligned, for the pairs
+  dsp_f32_to_q15_ref(f, ref, n);
+  dsp_f32_to_q15(f, y, n);
+  dsp_f32_to_q15(f + 1, y + 1, 1); // One alone, at an odd address
+  result("f32 -> q15", same_q15(ref, y, n) && y[1] == 32767 && y[3] == 32767 && y[4] == -32768);
+}
+
+static void add_max(void) {
+  for (int n = 0; n < 40; n++) {
+    dsp_add_q15_ref(x, x2, ref, n);
+    dsp_add_q15(x, x2, y, n);
+    memcpy(yin, x, sizeof(x));
+    dsp_add_q15(yin, x2, yin, n);
+    result("add q15", same_q15(ref, y, n) && same_q15(ref, yin, n));
+    result("max q15", dsp_max_q15(x + 1, n) == dsp_max_q15_ref(x + 1, n));
+  }
+  // Every sample full scale, one way and the other
+  static int16_t hi[9], lo[9];
+  for (int i = 0; i < 9; i++) hi[i] = 32767, lo[i] = -32768;
+  dsp_add_q15(hi, hi, y, 9);
+  dsp_add_q15(lo, lo, y + 9, 9);
+  dsp_add_q15_ref(hi, hi, ref, 9);
+  dsp_add_q15_ref(lo, lo, ref + 9, 9);
+  result("add q15 saturation", same_q15(ref, y, 18) && y[0] == 32767 && y[9] == -32768);
+  result("max q15 of -32768s", dsp_max_q15(lo, 9) == -32768 && dsp_max_q15(lo, 0) == -32768);
+}
+
+int main(int argc, char **argv) {
+  int check = argc > 1 && !strcmp(argv[1], "--check");
+  dsp_fir_q15_t f;
+  dsp_movavg_q15_t m;
+  int16_t s[4];
+
+  result("FIR init rejects 0 taps", dsp_fir_q15_init(&f, x, 0, s, 1) == -1);
+  result("moving average init rejects 0", dsp_movavg_q15_init(&m, 0, s, 1) == -1);
+
+  for (int t = 0; t < TRIALS; t++) {
+    // Full-scale noise, then a quieter signal that mostly does not saturate
+    for (int i = 0; i < SIGNAL; i++) {
+      x[i] = (t & 1) ? (int16_t)(random_q15() / 8) : random_q15();
+      x2[i] = random_q15();
+    }
+    fir(1);
+    fir(2);
+    fir(1U + (uint32_t)(next_random() % 64U));
+    movavg(1);
+    movavg(1U + (uint32_t)(next_random() % 100U));
+    add_max();
+  }
+  conversions();
+  biquad(1, 0.1, M_SQRT1_2);
+  biquad(4, 0.1, M_SQRT1_2);
+  biquad(8, 0.01, 0.9); // Poles close to the unit circle
+
+  printf("%d cases, %d differ from the reference\n", cases, bad);
+  if (check && bad) {
+    fprintf(stderr, "FAIL: a DSP kernel differs from its reference\n");
+    return 1;
+  }
+  return 0;
+}
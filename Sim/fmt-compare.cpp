@@ -0,0 +1,133 @@
+/*
+ * fmt-compare.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * fmt.c against the host C library.
+ *
+ * Every case is formatted by fmt_snprintf() and snprintf() into a roomy
+ * buffer and into a short one; the text, the returned length and the
+ * truncation have to agree. A run of pseudo-random integers and doubles
+ * follows, at every %f precision. Then both are timed over the table.
+ * The timing is of the host, not the Cortex-M7: it only says whether the
+ * formatter is in the same league as a full C library. The cycle counts
+ * on the target come from fmt-bench.c.
+ *
+ * Usage: fmt-compare [--check]
+ *   --check  exit with status 1 if any case differs
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "fmt.h"
+
+#define ITERATIONS 20000
+#define RANDOM_VALUES 50000
+
+// Each case is formatted by both; F is the formatter, B the buffer
+#define CASES(F, B, N) \
+  F(B, N, "plain text"); \
+  F(B, N, "%d %i %u", 0, -1, 4000000000U); \
+  F(B, N, "%d %d", INT32_MIN, INT32_MAX); \
+  F(B, N, "[%5d] [%-5d] [%05d] [%+d] [% d]", 42, 42, -42, 42, 42); \
+  F(B, N, "[%.3d] [%8.3d] [%-8.3d] [%.0d]", 7, -7, 7, 0); \
+  F(B, N, "%x %X %#x %#X %#x %o %#o %#o", 0xBEEFU, 0xBEEFU, 255U, 255U, 0U, 8U, 8U, 0U); \
+  F(B, N, "[%08lx] [%#010lx]", 0xDEADUL, 0xDEADUL); \
+  F(B, N, "%lld %llu %llx", (long long)INT64_MIN, 18446744073709551615ULL, 0x123456789ABCDEFULL); \
+  F(B, N, "%hhd %hhu %hd %hu", 300, 300, 70000, 70000); \
+  F(B, N, "%zu %zd %jd %td", (size_t)12345, (ptrdiff_t)-5, (intmax_t)-99, (ptrdiff_t)17); \
+  F(B, N, "[%*d] [%-*d] [%.*d] [%*.*d]", 6, 1, 6, 2, 4, 3, -7, 2, 5); \
+  F(B, N, "[%c] [%3c] [%-3c]", 'a', 'b', 'c'); \
+  F(B, N, "[%s] [%10s] [%-10s] [%.2s] [%10.3s]", "str", "right", "left", "trunc", "abcdef"); \
+  F(B, N, "[%p]", (void *)0x20000000U); \
+  F(B, N, "%f %f %f", 0.0, 1.5, -2.25); \
+  F(B, N, "%.0f %.0f %.0f %.0f %.0f", 0.5, 1.5, 2.5, -0.5, 3.49); \
+  F(B, N, "%.2f %.3f %.9f %.1f", 3.14159, 2.0005, 0.000000001, 0.05); \
+  F(B, N, "[%10.2f] [%-10.2f] [%010.2f] [%+.1f] [% .1f]", 3.14159, 3.14159, -3.14159, 1.0, 1.0); \
+  F(B, N, "%#.0f %.4f", 3.0, 123456789.123); \
+  F(B, N, "%f %F", 1e20, 123456789012345678.0); \
+  F(B, N, "%f %F %5.1f", 1.0 / 0.0, -1.0 / 0.0, 0.0 / 0.0); \
+  F(B, N, "%.1f%% done, %lu of %lu", 99.5, 995UL, 1000UL); \
+  F(B, N, "HardFault CFSR %08lx HFSR %08lx MMFAR %08lx", 0x8200UL, 0x40000000UL, 0UL)
+
+#define FMT_CALL(B, N, ...) do { \
+    char a[200], b[200]; \
+    memset(a, '#', sizeof(a)); \
+    memset(b, '#', sizeof(b)); \
+    int na = fmt_snprintf(a, N, __VA_ARGS__); \
+    int nb = snprintf(b, N, __VA_ARGS__); \
+    if (na != nb || memcmp(a, b, sizeof(a))) { \
+      printf("MISMATCH size %d: %s\n  fmt  %d \"%.*s\"\n  libc %d \"%.*s\"\n", \
+             (int)(N), #__VA_ARGS__, na, (int)sizeof(a), a, nb, (int)sizeof(b), b); \
+      bad++; \
+    } \
+    cases++; \
+  } while (0)
+
+#define TIME_FMT(B, N, ...)  sink += fmt_snprintf(B, N, __VA_ARGS__)
+#define TIME_LIBC(B, N, ...) sink += snprintf(B, N, __VA_ARGS__)
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return rng;
+}
+
+static double now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  int check = argc > 1 && !strcmp(argv[1], "--check");
+  int cases = 0, bad = 0;
+
+  // Roomy, truncated mid-way, and nothing at all
+  CASES(FMT_CALL, , 150);
+  CASES(FMT_CALL, , 9);
+  CASES(FMT_CALL, , 1);
+
+  for (int i = 0; i < RANDOM_VALUES; i++) {
+    uint64_t r = next_random();
+    // Doubles of all sizes around 1, and ones with a few decimals
+    double d = (double)(int64_t)r / (double)(1ULL << (r & 63U));
+    double cents = (double)(int32_t)r / 100.0;
+    int prec = (int)(i % 10);
+    FMT_CALL(, 150, "%lld %llx %ld %d %u", (long long)r, (unsigned long long)r,
+             (long)(r >> 20), (int)r, (unsigned)(r >> 32));
+    FMT_CALL(, 150, "%.*f %.*f %-12.3f|", prec, d, prec, cents, cents);
+  }
+
+  char buf[200];
+  volatile int sink = 0;
+  int per_pass = 0;
+#define COUNT(B, N, ...) per_pass++
+  CASES(COUNT, , 0);
+
+  double t0 = now_ns();
+  for (int i = 0; i < ITERATIONS; i++) { CASES(TIME_FMT, buf, sizeof(buf)); }
+  double t1 = now_ns();
+  for (int i = 0; i < ITERATIONS; i++) { CASES(TIME_LIBC, buf, sizeof(buf)); }
+  double t2 = now_ns();
+
+  double calls = (double)ITERATIONS * per_pass;
+  printf("%d cases, %d differ from the C library\n", cases, bad);
+  printf("host time per call: fmt_snprintf %.0f ns, snprintf %.0f ns\n",
+         (t1 - t0) / calls, (t2 - t1) / calls);
+
+  if (check && bad) {
+    fprintf(stderr, "FAIL: fmt_snprintf differs from snprintf\n");
+    return 1;
+  }
+  return 0;
+}
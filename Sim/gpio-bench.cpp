@@ -0,0 +1,183 @@
+/*
+ * gpio-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Checks gpio-config.h's folded port configurations against the pin at a
+ * time path they replace, on the simulated GPIOC.
+ *
+ * Each X-macro pin list is applied three ways to the same starting port:
+ * folded at compile time by GPIO_PORT_APPLY(), built at run time with
+ * gpio_cfg_add_pin() and applied with gpio_port_apply(), and pin by pin
+ * with main.c's set_pin_mode() and a read-modify-write of OTYPER,
+ * OSPEEDR, PUPDR and the pin's AFR nibble (what uart3_rxtx_init() did
+ * before). MODER, OTYPER, OSPEEDR, PUPDR, AFRL and AFRH must come out the
+ * same all three ways, from a zeroed port and from one already holding
+ * other settings (whose bits outside the list must survive).
+ *
+ * The lists: a mix of modes either side of the AFRL/AFRH boundary, every
+ * open-drain/pull combination on AF pins 8-13, and all sixteen pins with
+ * every mode, speed and pull and a different AF each. A line gives each
+ * path's register accesses.
+ *
+ * Usage: gpio-bench [--check]
+ *   --check  exit with status 1 if any register differs between the paths
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "gpio-config.h"
+
+// From Src/main.c (which has no header of its own)
+void set_pin_mode(GPIO_TypeDef *gpiox, uint32_t pin_num, uint32_t mode);
+
+#define MIXED_PINS(X) \
+  X(0,  GPIO_CFG_MODE_OUTPUT, GPIO_CFG_OPEN_DRAIN, GPIO_CFG_SPEED_LOW,    GPIO_CFG_PULL_UP,   0) \
+  X(3,  GPIO_CFG_MODE_AF,     GPIO_CFG_PUSH_PULL,  GPIO_CFG_SPEED_VHIGH,  GPIO_CFG_PULL_DOWN, 5) \
+  X(7,  GPIO_CFG_MODE_AF,     GPIO_CFG_OPEN_DRAIN, GPIO_CFG_SPEED_MEDIUM, GPIO_CFG_PULL_NONE, 15) \
+  X(8,  GPIO_CFG_MODE_AF,     GPIO_CFG_OPEN_DRAIN, GPIO_CFG_SPEED_HIGH,   GPIO_CFG_PULL_UP,   7) \
+  X(9,  GPIO_CFG_MODE_INPUT,  GPIO_CFG_PUSH_PULL,  GPIO_CFG_SPEED_LOW,    GPIO_CFG_PULL_DOWN, 3) \
+  X(12, GPIO_CFG_MODE_ANALOG, GPIO_CFG_PUSH_PULL,  GPIO_CFG_SPEED_LOW,    GPIO_CFG_PULL_NONE, 0) \
+  X(15, GPIO_CFG_MODE_AF,     GPIO_CFG_OPEN_DRAIN, GPIO_CFG_SPEED_VHIGH,  GPIO_CFG_PULL_DOWN, 11)
+
+// Open-drain and push-pull with each pull, as an I2C or one-wire bus has
+#define DRAIN_PINS(X) \
+  X(8,  GPIO_CFG_MODE_AF, GPIO_CFG_OPEN_DRAIN, GPIO_CFG_SPEED_HIGH,  GPIO_CFG_PULL_NONE, 4) \
+  X(9,  GPIO_CFG_MODE_AF, GPIO_CFG_OPEN_DRAIN, GPIO_CFG_SPEED_HIGH,  GPIO_CFG_PULL_UP,   4) \
+  X(10, GPIO_CFG_MODE_AF, GPIO_CFG_OPEN_DRAIN, GPIO_CFG_SPEED_LOW,   GPIO_CFG_PULL_DOWN, 6) \
+  X(11, GPIO_CFG_MODE_AF, GPIO_CFG_PUSH_PULL,  GPIO_CFG_SPEED_VHIGH, GPIO_CFG_PULL_NONE, 9) \
+  X(12, GPIO_CFG_MODE_AF, GPIO_CFG_PUSH_PULL,  GPIO_CFG_SPEED_MEDIUM, GPIO_CFG_PULL_UP,  12) \
+  X(13, GPIO_CFG_MODE_AF, GPIO_CFG_PUSH_PULL,  GPIO_CFG_SPEED_HIGH,  GPIO_CFG_PULL_DOWN, 14)
+
+// Pin P: mode P % 4, type from bit 2, speed P + 1, pull P % 3, AF 15 - P
+#define FULL_PIN(X, P) X(P, (P) % 4U, ((P) >> 2) & 1U, ((P) + 1U) & 3U, (P) % 3U, 15U - (P))
+#define FULL_PINS(X) \
+  FULL_PIN(X, 0)  FULL_PIN(X, 1)  FULL_PIN(X, 2)  FULL_PIN(X, 3) \
+  FULL_PIN(X, 4)  FULL_PIN(X, 5)  FULL_PIN(X, 6)  FULL_PIN(X, 7) \
+  FULL_PIN(X, 8)  FULL_PIN(X, 9)  FULL_PIN(X, 10) FULL_PIN(X, 11) \
+  FULL_PIN(X, 12) FULL_PIN(X, 13) FULL_PIN(X, 14) FULL_PIN(X, 15)
+
+typedef struct {
+  uint32_t moder, otyper, ospeedr, pupdr, afrl, afrh;
+} regs_t;
+
+static const char *const reg_names[] = { "MODER", "OTYPER", "OSPEEDR", "PUPDR", "AFRL", "AFRH" };
+
+static int failures;
+
+static void load(GPIO_TypeDef *g, const regs_t *r) {
+  g->MODER = r->moder;
+  g->OTYPER = r->otyper;
+  g->OSPEEDR = r->ospeedr;
+  g->PUPDR = r->pupdr;
+  g->AFR[0] = r->afrl;
+  g->AFR[1] = r->afrh;
+}
+
+static regs_t save(GPIO_TypeDef *g) {
+  regs_t r = { g->MODER, g->OTYPER, g->OSPEEDR, g->PUPDR, g->AFR[0], g->AFR[1] };
+  return r;
+}
+
+// The pin at a time path: one read-modify-write per register per pin
+static void per_pin(GPIO_TypeDef *g, uint32_t pin, uint32_t mode, uint32_t otype, uint32_t speed,
+                    uint32_t pull, uint32_t af) {
+  MODIFY_REG(g->OTYPER, 1UL << pin, otype << pin);
+  MODIFY_REG(g->OSPEEDR, 3UL << (2U * pin), speed << (2U * pin));
+  MODIFY_REG(g->PUPDR, 3UL << (2U * pin), pull << (2U * pin));
+  if (mode == GPIO_CFG_MODE_AF) {
+    int afr = pin >= 8U ? 1 : 0;
+    uint32_t shift = (pin - 8U * (uint32_t)afr) * 4U;
+    g->AFR[afr] &= ~(0xFUL << shift);
+    g->AFR[afr] |= af << shift;
+  }
+  set_pin_mode(g, pin, mode);
+}
+
+#define PER_PIN(P, M, T, S, U, A) per_pin(GPIOC, P, M, T, S, U, A);
+#define ADD_PIN(P, M, T, S, U, A) gpio_cfg_add_pin(&cfg, P, M, T, S, U, A);
+
+// Compare two results register by register
+static int same(const char *list, const char *start, const char *path, const regs_t *want,
+                const regs_t *got) {
+  const uint32_t *w = (const uint32_t *)want, *g = (const uint32_t *)got;
+  int ok = 1;
+  for (unsigned i = 0; i < sizeof(reg_names) / sizeof(reg_names[0]); i++) {
+    if (w[i] != g[i]) {
+      printf("  FAIL: %s from %s: %s %s %08lx, pin by pin %08lx\n", list, start, path, reg_names[i],
+             (unsigned long)g[i], (unsigned long)w[i]);
+      ok = 0;
+    }
+  }
+  return ok;
+}
+
+// One list from one starting state, all three ways
+#define CHECK_LIST(NAME, LIST, START, START_NAME) do { \
+    regs_t by_pin, folded, run_time; \
+    uint64_t a0, a_pin, a_folded, a_run; \
+    gpio_port_cfg_t cfg; \
+    load(GPIOC, (START)); \
+    a0 = sim_count.reg_accesses; \
+    LIST(PER_PIN) \
+    a_pin = sim_count.reg_accesses - a0; \
+    by_pin = save(GPIOC); \
+    load(GPIOC, (START)); \
+    a0 = sim_count.reg_accesses; \
+    GPIO_PORT_APPLY(GPIOC, LIST); \
+    a_folded = sim_count.reg_accesses - a0; \
+    folded = save(GPIOC); \
+    memset(&cfg, 0, sizeof(cfg)); \
+    LIST(ADD_PIN) \
+    load(GPIOC, (START)); \
+    a0 = sim_count.reg_accesses; \
+    gpio_port_apply(GPIOC, &cfg); \
+    a_run = sim_count.reg_accesses - a0; \
+    run_time = save(GPIOC); \
+    int ok_ = same(NAME, START_NAME, "folded", &by_pin, &folded) & \
+              same(NAME, START_NAME, "run-time", &by_pin, &run_time); \
+    if (!ok_) failures++; \
+    printf("  %-8s %-8s %10llu %10llu %10llu  %s\n", NAME, START_NAME, (unsigned long long)a_pin, \
+           (unsigned long long)a_folded, (unsigned long long)a_run, ok_ ? "ok" : "FAILED"); \
+  } while (0)
+
+int main(int argc, char **argv) {
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  sim_reset();
+  static const regs_t zero = { 0, 0, 0, 0, 0, 0 };
+  // Bits in every field, so a list that leaves a pin alone must keep them
+  static const regs_t dirty = { 0x9C3A65F1UL, 0x0000B5A3UL, 0x6D2E8B17UL, 0x51A4C2E8UL,
+                                0xE4D1B7A3UL, 0x3F8C12D6UL };
+
+  printf("GPIOC: MODER, OTYPER, OSPEEDR, PUPDR, AFRL and AFRH three ways\n\n");
+  printf("  %-8s %-8s %10s %10s %10s\n", "pins", "from", "pin by pin", "folded", "run-time");
+  CHECK_LIST("mixed", MIXED_PINS, &zero, "zero");
+  CHECK_LIST("mixed", MIXED_PINS, &dirty, "set");
+  CHECK_LIST("drain", DRAIN_PINS, &zero, "zero");
+  CHECK_LIST("drain", DRAIN_PINS, &dirty, "set");
+  CHECK_LIST("all 16", FULL_PINS, &zero, "zero");
+  CHECK_LIST("all 16", FULL_PINS, &dirty, "set");
+  printf("\n%d failed\n", failures);
+
+  if (check && failures) {
+    fprintf(stderr, "FAIL: %d pin lists configured differently by gpio-config.h\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,482 @@
+/*
+ * kernel-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Checks and measures the kernel (Src/kernel.h) on the simulated core.
+ *
+ * The checks are the scheduling rules: the most urgent ready thread
+ * runs, at once when it becomes ready, with waiters woken by priority and
+ * then in order; threads of one priority share the core a time slice at
+ * a time; timed waits end on the tick they should; queues keep their
+ * order whether the getter or the putter has to wait.
+ *
+ * The measurements are in core clocks:
+ * * switch: from one thread blocking to the next one running
+ * * wake: from an interrupt handler giving a semaphore to the thread
+ *   waiting on it running
+ * * IRQ latency: from a TIM6 update to its handler reading TIM6->CNT,
+ *   with the core idle and then with two threads switching as fast as
+ *   they can underneath
+ * The sim charges SIM_IRQ_CYCLES per exception and a cycle or so per
+ * register access, and nothing for the code in between, so these show
+ * the kernel's structure - what it masks, and for how long in register
+ * accesses - rather than the board's figures; type 'k' on the board for
+ * those.
+ *
+ * Usage: kernel-bench [--check]
+ *   --check  exit with status 1 if a rule is broken, or the IRQ latency
+ *            under load is more than the idle one plus the kernel's
+ *            longest masked section and one exception entry
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "clock.h"
+#include "cycles.h"
+#include "kernel.h"
+#include "tick.h"
+
+#define STACK_WORDS 256U
+#define NUM_WORKERS 4
+#define BENCH_PRIO  (KERNEL_PRIORITIES - 1U)
+
+// Longest any check may take, in ticks, before it counts as hung
+#define JOIN_TICKS 2000U
+
+static kernel_thread_t bench_thread, workers[NUM_WORKERS];
+static uint32_t stacks[NUM_WORKERS][STACK_WORDS];
+static kernel_sem_t done;
+static int failures;
+
+static void expect(int ok, const char *what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) failures++;
+}
+
+static void spawn(int i, const char *name, uint32_t prio, kernel_fn_t fn, uintptr_t arg) {
+  kernel_thread_create(&workers[i], name, prio, stacks[i], STACK_WORDS, fn, (void *)arg);
+}
+
+// Each worker ends with this; join() waits for n of them
+static void finish(void) {
+  kernel_sem_give(&done);
+}
+
+static int join(unsigned n) {
+  for (unsigned i = 0; i < n; i++) {
+    if (kernel_sem_take(&done, JOIN_TICKS) != KERNEL_OK) return 0;
+  }
+  return 1;
+}
+
+// The order things happened in
+static char order[64];
+static unsigned order_len;
+
+static void note(char c) {
+  if (order_len < sizeof(order) - 1U) order[order_len++] = c;
+  order[order_len] = 0;
+}
+
+static void order_reset(void) {
+  order_len = 0;
+  order[0] = 0;
+}
+
+typedef struct {
+  uint64_t n, sum;
+  uint32_t min, max;
+} span_t;
+
+static void span_reset(span_t *s) {
+  memset(s, 0, sizeof(*s));
+  s->min = 0xFFFFFFFFUL;
+}
+
+static void span_add(span_t *s, uint32_t v) {
+  s->n++;
+  s->sum += v;
+  if (v < s->min) s->min = v;
+  if (v > s->max) s->max = v;
+}
+
+static void span_print(const char *what, const span_t *s) {
+  double ns = 1e9 / (double)sim_core_hz;
+  if (!s->n) {
+    printf("  %-30s none\n", what);
+    return;
+  }
+  printf("  %-30s %8llu %7lu %9.1f %7lu %9.0f\n", what, (unsigned long long)s->n,
+         (unsigned long)s->min, (double)s->sum / (double)s->n, (unsigned long)s->max,
+         s->max * ns);
+}
+
+/* ----------------------------------------------------------------------
+ * Priorities and preemption
+ */
+
+static kernel_sem_t go, ping;
+
+// Notes its letter once it has a `go`
+static void waiter(void *arg) {
+  kernel_sem_take(&go, KERNEL_FOREVER);
+  note((char)(uintptr_t)arg);
+  finish();
+}
+
+static void noter(void *arg) {
+  note((char)(uintptr_t)arg);
+  finish();
+}
+
+static void giver(void *arg) {
+  (void)arg;
+  note('1');
+  kernel_sem_give(&ping);
+  note('3');
+  finish();
+}
+
+static void taker(void *arg) {
+  (void)arg;
+  kernel_sem_take(&ping, KERNEL_FOREVER);
+  note('2');
+  finish();
+}
+
+static void check_priorities(void) {
+  kernel_sem_init(&go, 0, 10);
+  kernel_sem_init(&ping, 0, 1);
+
+  order_reset();
+  note('a');
+  spawn(0, "urgent", 3, noter, 'b');
+  note('c');
+  expect(join(1) && !strcmp(order, "abc"), "a more urgent thread runs as soon as it is made");
+
+  // Made least urgent first, so that they queue up in the wrong order
+  order_reset();
+  spawn(0, "low", 4, waiter, 'l');
+  spawn(1, "high", 2, waiter, 'h');
+  spawn(2, "mid", 3, waiter, 'm');
+  for (int i = 0; i < 3; i++) kernel_sem_give(&go);
+  expect(join(3) && !strcmp(order, "hml"), "waiters wake most urgent first");
+
+  order_reset();
+  spawn(0, "first", 3, waiter, 'a');
+  spawn(1, "second", 3, waiter, 'b');
+  spawn(2, "third", 3, waiter, 'c');
+  for (int i = 0; i < 3; i++) kernel_sem_give(&go);
+  expect(join(3) && !strcmp(order, "abc"), "waiters of one priority wake in order");
+
+  order_reset();
+  spawn(0, "taker", 2, taker, 0);
+  spawn(1, "giver", 4, giver, 0);
+  expect(join(2) && !strcmp(order, "123"), "giving to a more urgent waiter switches to it");
+
+  expect(kernel_sem_give(&ping) == KERNEL_OK && kernel_sem_give(&ping) == KERNEL_FULL &&
+         kernel_sem_take(&ping, 0) == KERNEL_OK && kernel_sem_take(&ping, 0) == KERNEL_TIMEOUT,
+         "a semaphore counts up to its maximum and no further");
+}
+
+/* ----------------------------------------------------------------------
+ * Time slices
+ */
+
+static uint32_t spin_from, spin_until;
+static uint32_t turns[2];
+static int last_spinner;
+
+static void spinner(void *arg) {
+  int me = (int)(uintptr_t)arg;
+
+  kernel_sleep(spin_from - tick_now());
+  while ((int32_t)(tick_now() - spin_until) < 0) {
+    if (last_spinner != me) {
+      last_spinner = me;
+      turns[me]++;
+    }
+    sim_run(16);
+  }
+  finish();
+}
+
+static void check_slices(void) {
+  const uint32_t ticks = 100;
+  uint32_t slices = kernel_stats()->slices;
+
+  turns[0] = turns[1] = 0;
+  last_spinner = -1;
+  // Both asleep until the same tick, then both ready at once
+  spin_from = tick_now() + 2U;
+  spin_until = spin_from + ticks;
+  spawn(0, "spin0", 3, spinner, 0);
+  spawn(1, "spin1", 3, spinner, 1);
+  int joined = join(2);
+  slices = kernel_stats()->slices - slices;
+  printf("  %lu + %lu turns, %lu slices ended in %lu ticks\n", (unsigned long)turns[0],
+         (unsigned long)turns[1], (unsigned long)slices, (unsigned long)ticks);
+  uint32_t want = ticks / KERNEL_SLICE_TICKS;
+  expect(joined && turns[0] + turns[1] + 1U >= want && turns[0] + turns[1] <= want + 1U &&
+         turns[0] + 1U >= turns[1] && turns[1] + 1U >= turns[0],
+         "busy threads of one priority take turns by the slice");
+}
+
+/* ----------------------------------------------------------------------
+ * Timed waits
+ */
+
+static kernel_status_t timed_result;
+static uint32_t timed_ticks, slept_ticks, periods_late;
+
+static void timed(void *arg) {
+  kernel_sem_t never;
+  (void)arg;
+
+  kernel_sem_init(&never, 0, 1);
+  uint32_t t0 = tick_now();
+  timed_result = kernel_sem_take(&never, 7);
+  timed_ticks = tick_now() - t0;
+
+  t0 = tick_now();
+  kernel_sleep(5);
+  slept_ticks = tick_now() - t0;
+
+  uint32_t due = tick_now();
+  periods_late = 0;
+  for (int i = 0; i < 10; i++) {
+    kernel_sleep_until(&due, 3);
+    if (tick_now() != due) periods_late++;
+    sim_run(1000);
+  }
+  finish();
+}
+
+static void check_timeouts(void) {
+  spawn(0, "timed", 3, timed, 0);
+  int joined = join(1);
+  expect(joined && timed_result == KERNEL_TIMEOUT && timed_ticks == 7,
+         "a wait with a time limit ends on its tick");
+  expect(joined && slept_ticks == 5, "kernel_sleep() wakes on its tick");
+  expect(joined && !periods_late, "kernel_sleep_until() keeps its period");
+}
+
+/* ----------------------------------------------------------------------
+ * Queues
+ */
+
+#define QUEUE_ITEMS 1000U
+
+static kernel_queue_t queue;
+static uint32_t queue_buf[4];
+static uint32_t queue_bad, queue_full_put;
+
+static void producer(void *arg) {
+  (void)arg;
+  for (uint32_t i = 0; i < QUEUE_ITEMS; i++) kernel_queue_put(&queue, &i, KERNEL_FOREVER);
+  finish();
+}
+
+static void consumer(void *arg) {
+  uint32_t v;
+  (void)arg;
+  for (uint32_t i = 0; i < QUEUE_ITEMS; i++) {
+    if (kernel_queue_get(&queue, &v, 100) != KERNEL_OK || v != i) queue_bad++;
+  }
+  finish();
+}
+
+static void check_queues(void) {
+  uint32_t v = 0;
+
+  kernel_queue_init(&queue, queue_buf, sizeof(queue_buf[0]), 4);
+  queue_bad = 0;
+  spawn(0, "producer", 2, producer, 0);
+  spawn(1, "consumer", 3, consumer, 0);
+  expect(join(2) && !queue_bad, "items keep their order past a waiting putter");
+
+  queue_bad = 0;
+  spawn(0, "consumer", 2, consumer, 0);
+  spawn(1, "producer", 3, producer, 0);
+  expect(join(2) && !queue_bad, "items keep their order past a waiting getter");
+
+  queue_full_put = 0;
+  for (uint32_t i = 0; i < 5; i++) {
+    if (kernel_queue_put(&queue, &i, 0) != KERNEL_OK) queue_full_put++;
+  }
+  uint32_t t0 = tick_now();
+  int ok = queue_full_put == 1U && kernel_queue_count(&queue) == 4U;
+  for (uint32_t i = 0; i < 4; i++) ok &= kernel_queue_get(&queue, &v, 0) == KERNEL_OK && v == i;
+  ok &= kernel_queue_get(&queue, &v, 3) == KERNEL_TIMEOUT && tick_now() - t0 == 3U;
+  expect(ok, "a full queue refuses, an empty one times out");
+}
+
+/* ----------------------------------------------------------------------
+ * Switch time, and latency
+ */
+
+#define TIM6_HZ 10000U
+
+// The measuring threads run until this tick: the bench thread is the
+// least urgent, and gets no turn while they are busy
+static uint32_t stop_at;
+static kernel_sem_t pp[2], irq_sem;
+static uint32_t blocked_at, irq_at;
+static uint32_t cycles_per_count;
+static span_t switch_span, wake_span, irq_span;
+
+// Two threads handing the core to each other: each gives the other's
+// semaphore, then blocks on its own
+static int running(void) {
+  return (int32_t)(tick_now() - stop_at) < 0;
+}
+
+static void pinger(void *arg) {
+  int me = (int)(uintptr_t)arg;
+  while (running()) {
+    kernel_sem_give(&pp[!me]);
+    blocked_at = cycles_now();
+    if (kernel_sem_take(&pp[me], 10) == KERNEL_OK) span_add(&switch_span, cycles_now() - blocked_at);
+    sim_run(4);
+  }
+  kernel_sem_give(&pp[!me]);
+  finish();
+}
+
+void TIM6_DAC_IRQHandler(void) {
+  uint32_t count = TIM6->CNT;
+  TIM6->SR = ~TIM_SR_UIF;
+  span_add(&irq_span, count * cycles_per_count);
+  irq_at = cycles_now();
+  kernel_sem_give(&irq_sem);
+}
+
+static void irq_waiter(void *arg) {
+  (void)arg;
+  while (running()) {
+    if (kernel_sem_take(&irq_sem, 10) == KERNEL_OK) span_add(&wake_span, cycles_now() - irq_at);
+  }
+  finish();
+}
+
+static void tim6_start(void) {
+  uint32_t pclk1 = clock_pclk1_hz();
+  uint32_t tim_clk = clock_hclk_hz() == pclk1 ? pclk1 : 2U * pclk1;
+
+  cycles_per_count = clock_hclk_hz() / tim_clk;
+  RCC->APB1ENR |= RCC_APB1ENR_TIM6EN;
+  TIM6->PSC = 0;
+  TIM6->ARR = tim_clk / TIM6_HZ - 1U;
+  TIM6->EGR = TIM_EGR_UG;
+  TIM6->SR = ~TIM_SR_UIF;
+  TIM6->DIER = TIM_DIER_UIE;
+  NVIC_SetPriority(TIM6_DAC_IRQn, 2);
+  NVIC_EnableIRQ(TIM6_DAC_IRQn);
+  TIM6->CR1 = TIM_CR1_CEN;
+}
+
+static void tim6_stop(void) {
+  TIM6->CR1 = 0;
+  NVIC_DisableIRQ(TIM6_DAC_IRQn);
+}
+
+static void measure(uint32_t ticks) {
+  uint32_t lock_max = 0;
+
+  printf("\n  %-30s %8s %7s %9s %7s %9s\n", "core clocks", "count", "min", "mean", "max", "max ns");
+
+  // Switches alone
+  span_reset(&switch_span);
+  kernel_sem_init(&pp[0], 0, 1);
+  kernel_sem_init(&pp[1], 0, 1);
+  stop_at = tick_now() + ticks;
+  spawn(0, "ping", 3, pinger, 0);
+  spawn(1, "pong", 3, pinger, 1);
+  int joined = join(2);
+  span_print("switch, thread to thread", &switch_span);
+
+  // Interrupts with the core idle
+  span_reset(&wake_span);
+  span_reset(&irq_span);
+  kernel_sem_init(&irq_sem, 0, 1);
+  stop_at = tick_now() + ticks;
+  tim6_start();
+  spawn(2, "irq", 1, irq_waiter, 0);
+  joined &= join(1);
+  tim6_stop();
+  span_t idle_irq = irq_span;
+  span_print("IRQ latency, idle", &irq_span);
+  span_print("wake from IRQ, idle", &wake_span);
+
+  // And with the two threads switching underneath
+  span_reset(&wake_span);
+  span_reset(&irq_span);
+  kernel_sem_init(&pp[0], 0, 1);
+  kernel_sem_init(&pp[1], 0, 1);
+  stop_at = tick_now() + ticks;
+  kernel_reset_stats();
+  tim6_start();
+  spawn(2, "irq", 1, irq_waiter, 0);
+  spawn(0, "ping", 3, pinger, 0);
+  spawn(1, "pong", 3, pinger, 1);
+  joined &= join(3);
+  tim6_stop();
+  lock_max = kernel_stats()->lock_max;
+  span_print("IRQ latency, switching", &irq_span);
+  span_print("wake from IRQ, switching", &wake_span);
+  printf("  %-30s %8lu\n  %-30s %8lu\n  %-30s %8lu\n", "kernel's longest masked", (unsigned long)lock_max,
+         "kernel's longest switch", (unsigned long)kernel_stats()->switch_max,
+         "switches", (unsigned long)kernel_stats()->switches);
+  printf("\n");
+
+  expect(joined && switch_span.n && idle_irq.n && irq_span.n && wake_span.n,
+         "threads switched and every interrupt woke its thread");
+  // TIM6->CNT only has cycles_per_count resolution, and an interrupt can
+  // come just as PendSV or SysTick is entered, which the sim charges in
+  // full (a core would take it late-arriving, and save the stacking)
+  expect(irq_span.max <= idle_irq.max + lock_max + SIM_IRQ_CYCLES + cycles_per_count,
+         "IRQ latency under load: idle, masked and one entry at most");
+}
+
+int main(int argc, char **argv) {
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  sim_reset();
+  clock_init();
+  cycles_init();
+  tick_init(clock_hclk_hz());
+  kernel_init();
+  kernel_sem_init(&done, 0, NUM_WORKERS);
+  kernel_start(&bench_thread, "bench", BENCH_PRIO);
+
+  printf("kernel: %u priorities, %u-tick slices, core %lu Hz, %u Hz tick\n\n",
+         KERNEL_PRIORITIES, KERNEL_SLICE_TICKS, (unsigned long)sim_core_hz, TICK_HZ);
+  check_priorities();
+  check_slices();
+  check_timeouts();
+  check_queues();
+  measure(TICK_MS(50U));
+
+  printf("%d failed\n", failures);
+  if (check && failures) {
+    fprintf(stderr, "FAIL: %d kernel checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * kernel-port.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Host stand-in for Src/kernel-port.c: threads are ucontext contexts,
+ * and the simulated PendSV handler swaps between them.
+ *
+ * Handlers run synchronously at register accesses (sim.cpp), so a
+ * thread switched out is left part way through whatever access pended
+ * PendSV or let it run - as on the core, where it would be left at the
+ * instruction after. Each thread has a host stack of its own, big enough
+ * for host code: the stack given to kernel_thread_create() is painted
+ * but never used here, so its use reads as nothing. The caller of
+ * kernel_start() keeps the host's own stack.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include "sim.h"
+#include "kernel.h"
+#include "kernel-port.h"
+
+#define HOST_STACK_BYTES (256U * 1024U)
+
+static ucontext_t main_context;
+static void (*thread_entry)(void);
+
+// A new thread's first switch in lands here, inside PendSV_Handler
+static void thread_start(void) {
+  sim_exception_return();
+  thread_entry();
+}
+
+// Threads are static, so their host stacks are never freed
+void *kernel_port_frame(uint32_t *stack, uint32_t words, void (*entry)(void)) {
+  (void)stack;
+  (void)words;
+  ucontext_t *c = (ucontext_t *)calloc(1, sizeof(*c));
+  void *host_stack = malloc(HOST_STACK_BYTES);
+  if (!c || !host_stack || getcontext(c)) {
+    fprintf(stderr, "sim: no memory for a thread\n");
+    abort();
+  }
+  c->uc_stack.ss_sp = host_stack;
+  c->uc_stack.ss_size = HOST_STACK_BYTES;
+  c->uc_link = NULL;
+  thread_entry = entry;
+  makecontext(c, thread_start, 0);
+  return c;
+}
+
+void *kernel_port_adopt(void) {
+  return &main_context;
+}
+
+void PendSV_Handler(void) {
+  ucontext_t *from = (ucontext_t *)kernel_self()->sp;
+  ucontext_t *to = (ucontext_t *)kernel_switch(from);
+  if (to != from) swapcontext(from, to);
+}
@@ -0,0 +1,349 @@
+/*
+ * power-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Idle policies of power.c compared on the simulated core: the same ten
+ * seconds of work under each of
+ *   spin   never sleep (power_idle(POWER_RUN, ...))
+ *   sleep  WFI between events
+ *   stop   Stop mode whenever power.c allows it, else WFI
+ *
+ * The work is a main loop like main-btn.c's and main.c's put together: a
+ * 100ms sched.h timer doing a little work, button presses (with some
+ * bounce) at random times and command pings from the host (cmd-host.h)
+ * every 150-450ms. The host sends a 0x00 and waits 1ms before each ping,
+ * for Stop mode to lose instead of the frame.
+ *
+ * For each policy it reports where the time went by power.c's LPTIM1
+ * books, what woke the core from Stop, the average current and charge
+ * per event (timer runs, button events and pings) from power.h's assumed
+ * currents, and the latency of each kind of event. The currents are
+ * rough figures, not measurements: the comparison is the point.
+ *
+ * Usage: power-bench [--seconds S] [--check]
+ *   --check  exit with status 1 if a ping goes unanswered, a button
+ *            event is lost or wrong, the timer drifts, power.c's books
+ *            disagree with the simulated time, or Stop does not use less
+ *            than half of Sleep's charge (a held button and the wait
+ *            after each command keep it in Sleep for much of the time)
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "button.h"
+#include "clock.h"
+#include "cmd.h"
+#include "cmd-host.h"
+#include "console.h"
+#include "critical.h"
+#include "nucleo-btn.h"
+#include "power.h"
+#include "prof.h"
+#include "sched.h"
+#include "tick.h"
+#include "uart.h"
+
+// Drivers from Src/main.c (which has no header of its own)
+void uart3_rxtx_init(void);
+
+#define PERIOD_MS      100U
+#define WORK_CYCLES    20000U   // Each timer run: about 93us at 216MHz
+#define PING_LEN       16U
+#define WAKE_GAP_NS    1000000ULL
+#define MAX_PINGS      128U
+#define MAX_PRESSES    40U      // Six input changes each: the sim holds 256
+#define HOST_QUEUE     4096U
+#define ID_PING        0x01U
+
+// A timer run may be a tick either side of where it should be
+#define TIMER_TOL_NS   1500000ULL
+
+static const cmd_entry_t commands[] = {
+  { ID_PING, 0, CMD_PAYLOAD_MAX, "ping", cmd_ping },
+};
+
+static const power_busy_t stop_busy[] = { console_tx_busy, button_busy };
+
+// The scenario, the same for every policy: times from the start in ns
+static uint64_t ping_at[MAX_PINGS];
+static unsigned num_pings;
+static uint64_t press_at[MAX_PRESSES], release_at[MAX_PRESSES];
+static unsigned num_presses;
+
+typedef struct {
+  uint64_t n, sum, max;
+} stat_t;
+
+static void stat_add(stat_t *st, uint64_t v) {
+  if (v > st->max) st->max = v;
+  st->sum += v;
+  st->n++;
+}
+
+static double stat_mean_ms(const stat_t *st) {
+  return st->n ? (double)st->sum / (double)st->n / 1e6 : 0.0;
+}
+
+// One policy's run
+static struct {
+  uint64_t t0;             // sim_now_ns() at the start of the scenario
+  unsigned next_ping;
+  uint8_t expect[256][PING_LEN];
+  uint64_t answered, wrong;
+  stat_t ping_lat;         // Wake byte sent to response complete
+  unsigned button_events, button_wrong;
+  stat_t button_lat;       // Edge to the main loop having the event
+  uint64_t timer_runs, last_run;
+  uint64_t timer_err_max;  // Interval from PERIOD_MS, either way
+} r;
+
+static uint8_t host_q[HOST_QUEUE];
+static uint64_t host_release[HOST_QUEUE];
+static uint32_t host_head, host_tail;
+static uint64_t send_release;  // When the bytes host_send() queues may go
+static cmd_client_t client;
+static uint32_t lcg = 2026;
+
+static void host_send(cmd_client_t *c, const uint8_t *buf, size_t len) {
+  (void)c;
+  for (size_t i = 0; i < len; i++) {
+    host_release[host_head % HOST_QUEUE] = send_release;
+    host_q[host_head++ % HOST_QUEUE] = buf[i];
+  }
+}
+
+// The host acts when the line is polled: each ping is a 0x00 to wake
+// the board, then the frame a little later
+static int rx_from_host(USART_TypeDef *usart) {
+  (void)usart;
+  uint64_t now = sim_now_ns();
+  if (r.next_ping < num_pings && now >= r.t0 + ping_at[r.next_ping]) {
+    uint8_t wake = 0, payload[PING_LEN];
+    send_release = now;
+    host_send(&client, &wake, 1);
+    for (unsigned k = 0; k < PING_LEN; k++) {
+      lcg = lcg * 1664525U + 1013904223U;
+      payload[k] = (uint8_t)(lcg >> 24);
+    }
+    send_release = now + WAKE_GAP_NS;
+    int seq = cmd_client_request(&client, ID_PING, payload, PING_LEN, now);
+    if (seq >= 0) memcpy(r.expect[seq], payload, PING_LEN);
+    r.next_ping++;
+  }
+  if (host_tail == host_head || host_release[host_tail % HOST_QUEUE] > now) return -1;
+  return host_q[host_tail++ % HOST_QUEUE];
+}
+
+static void to_host(USART_TypeDef *usart, uint8_t c) {
+  (void)usart;
+  cmd_client_feed(&client, &c, 1);
+}
+
+static void got_response(cmd_client_t *c, const cmd_response_t *resp) {
+  (void)c;
+  r.answered++;
+  stat_add(&r.ping_lat, sim_now_ns() - resp->sent_at);
+  if (resp->status != CMD_OK || resp->len != PING_LEN || memcmp(resp->payload, r.expect[resp->seq], PING_LEN)) {
+    r.wrong++;
+  }
+}
+
+static void timer_work(void *arg) {
+  (void)arg;
+  // In slices: sim_run() takes no interrupts until it is done, and the
+  // whole of it is longer than a byte at 115200
+  for (unsigned i = 0; i < WORK_CYCLES / 2000U; i++) sim_run(2000U);
+  uint64_t now = sim_now_ns();
+  if (r.timer_runs++) {
+    uint64_t want = PERIOD_MS * 1000000ULL, got = now - r.last_run;
+    uint64_t err = got > want ? got - want : want - got;
+    if (err > r.timer_err_max) r.timer_err_max = err;
+  }
+  r.last_run = now;
+}
+
+static void got_button(const button_event_t *ev) {
+  unsigned i = r.button_events++;
+  unsigned press = i / 2U;
+  uint32_t want = (i & 1U) ? BUTTON_RELEASE : BUTTON_PRESS;
+  if (press >= num_presses || ev->type != want) {
+    r.button_wrong++;
+    return;
+  }
+  uint64_t edge = r.t0 + ((i & 1U) ? release_at[press] : press_at[press]);
+  stat_add(&r.button_lat, sim_now_ns() - edge);
+}
+
+// A press with its contacts bouncing twice over half a millisecond
+static void schedule_button(uint64_t t0) {
+  for (unsigned i = 0; i < num_presses; i++) {
+    for (int level = 1; level >= 0; level--) {
+      uint64_t at = t0 + (level ? press_at[i] : release_at[i]);
+      sim_gpio_input_at_ns(GPIOC, USER_BTN_B, level, at);
+      sim_gpio_input_at_ns(GPIOC, USER_BTN_B, !level, at + 150000U);
+      sim_gpio_input_at_ns(GPIOC, USER_BTN_B, level, at + 400000U);
+    }
+  }
+}
+
+static void make_scenario(double seconds) {
+  uint64_t end = (uint64_t)(seconds * 1e9) - 500000000ULL;
+  uint64_t t = 300000000ULL;
+  while (num_pings < MAX_PINGS && t < end) {
+    ping_at[num_pings++] = t;
+    lcg = lcg * 1664525U + 1013904223U;
+    t += 150000000ULL + (lcg >> 8) % 300000000ULL;
+  }
+  t = 700000000ULL;
+  while (num_presses < MAX_PRESSES && t < end) {
+    lcg = lcg * 1664525U + 1013904223U;
+    press_at[num_presses] = t;
+    release_at[num_presses] = t + 100000000ULL + (lcg >> 8) % 200000000ULL;
+    t = release_at[num_presses++] + 200000000ULL + (lcg >> 12) % 600000000ULL;
+  }
+}
+
+static const char *const names[POWER_NUM_STATES] = { "spin", "sleep", "stop" };
+
+// One policy from reset; returns 0 if it failed. *ua gets the average current.
+static int run(power_state_t policy, double seconds, uint32_t *ua) {
+  static sched_timer_t timer;
+
+  sim_reset();
+  clock_init();
+  prof_init();
+  tick_init(clock_hclk_hz());
+  sched_init();
+  uart3_rxtx_init();
+  console_init();
+  cmd_init(commands, sizeof(commands) / sizeof(commands[0]));
+  button_init();
+  power_init(stop_busy, sizeof(stop_busy) / sizeof(stop_busy[0]), POWER_WAKE_UART3);
+
+  memset(&r, 0, sizeof(r));
+  cmd_client_init(&client);
+  client.send = host_send;
+  client.response = got_response;
+  host_head = host_tail = 0;
+  sim_usart_set_tx_sink(USART3, to_host);
+  sim_usart_set_rx_source(USART3, rx_from_host);
+
+  r.t0 = sim_now_ns();
+  schedule_button(r.t0);
+  sched_start(&timer, "work", TICK_MS(PERIOD_MS), TICK_MS(PERIOD_MS), timer_work, NULL);
+  power_reset_stats();
+  sim_counters_t s0 = sim_count;
+  uint64_t end = r.t0 + (uint64_t)(seconds * 1e9);
+
+  // The main loop. In the spin policy __NOP() is the busy loop: the
+  // sim skips it ahead to the next event, and power.c counts it as run.
+  while (sim_now_ns() < end) {
+    button_event_t ev;
+    uint8_t c;
+    sched_run();
+    while (button_get(&ev)) got_button(&ev);
+    cmd_poll();
+    while (uart_try_read(&c)) {}
+    uint32_t primask = critical_enter();
+    uint32_t next = sched_ticks_to_next();
+    if (next && !button_pending() && !cmd_pending() && !console_rx_available()) {
+      if (power_idle(policy, next) == POWER_RUN) __NOP();
+    }
+    critical_exit(primask);
+  }
+
+  const power_stats_t *ps = power_stats();
+  sim_counters_t s1 = sim_count;
+  uint64_t lp_total = ps->lp[POWER_RUN] + ps->lp[POWER_SLEEP] + ps->lp[POWER_STOP];
+  uint32_t hz = power_lp_hz();
+  double secs = (double)lp_total / hz;
+  uint64_t events = r.timer_runs + r.button_events + r.answered;
+  *ua = power_average_ua(ps);
+  double uc_per_event = (double)*ua * secs / (double)events;
+
+  printf("%-6s %5.1f%% %5.1f%% %5.1f%% %8lu %8.1f %4lu/%lu/%lu %6.2f/%-6.2f %6.2f/%-6.2f %6.0f\n",
+         names[policy], 100.0 * ps->lp[POWER_RUN] / lp_total, 100.0 * ps->lp[POWER_SLEEP] / lp_total,
+         100.0 * ps->lp[POWER_STOP] / lp_total, (unsigned long)*ua, uc_per_event,
+         (unsigned long)ps->wake_uart, (unsigned long)ps->wake_button, (unsigned long)ps->wake_timer,
+         stat_mean_ms(&r.ping_lat), r.ping_lat.max / 1e6, stat_mean_ms(&r.button_lat),
+         r.button_lat.max / 1e6, r.timer_err_max / 1e3);
+
+  int ok = 1;
+  if (r.answered != num_pings || r.wrong || client.unmatched) {
+    printf("  FAIL: %llu of %u pings answered, %llu wrong\n", (unsigned long long)r.answered,
+           num_pings, (unsigned long long)r.wrong);
+    ok = 0;
+  }
+  if (r.button_events != 2U * num_presses || r.button_wrong || button_dropped()) {
+    printf("  FAIL: %u button events for %u presses, %u wrong\n", r.button_events, num_presses,
+           r.button_wrong);
+    ok = 0;
+  }
+  uint64_t want_runs = (uint64_t)(seconds * 1000.0) / PERIOD_MS;
+  if (r.timer_runs + 1U < want_runs || r.timer_runs > want_runs || r.timer_err_max > TIMER_TOL_NS) {
+    printf("  FAIL: %llu timer runs for %llu, off by up to %llu us\n", (unsigned long long)r.timer_runs,
+           (unsigned long long)want_runs, (unsigned long long)(r.timer_err_max / 1000U));
+    ok = 0;
+  }
+  // power.c's books against the simulated time
+  double sim_secs = (double)(sim_now_ns() - r.t0) / 1e9;
+  double stop_secs = (double)(s1.stop_ns - s0.stop_ns) / 1e9;
+  double lp_stop_secs = (double)ps->lp[POWER_STOP] / hz;
+  if (fabs(secs - sim_secs) > sim_secs * 0.001 || fabs(lp_stop_secs - stop_secs) > sim_secs * 0.001) {
+    printf("  FAIL: power.c counted %.4f s (%.4f s in Stop), the sim %.4f s (%.4f s)\n", secs,
+           lp_stop_secs, sim_secs, stop_secs);
+    ok = 0;
+  }
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  double seconds = 10.0;
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+      seconds = strtod(argv[++i], NULL);
+    } else if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--seconds S] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (seconds < 2.0) seconds = 2.0;
+  make_scenario(seconds);
+
+  printf("%.1f s: %u ms timer, %u button presses, %u pings; assumed run %u, sleep %u, stop %u uA\n\n",
+         seconds, PERIOD_MS, num_presses, num_pings, POWER_RUN_UA, POWER_SLEEP_UA, POWER_STOP_UA);
+  printf("%-6s %6s %6s %6s %8s %8s %10s %13s %13s %6s\n", "policy", "run", "sleep", "stop",
+         "avg uA", "uC/event", "wake u/b/t", "ping ms", "button ms", "timer");
+  printf("%-6s %6s %6s %6s %8s %8s %10s %13s %13s %6s\n", "", "", "", "", "", "", "",
+         "mean/max", "mean/max", "err us");
+
+  uint32_t ua[POWER_NUM_STATES];
+  int ok = 1;
+  for (int p = POWER_RUN; p < POWER_NUM_STATES; p++) {
+    ok &= run((power_state_t)p, seconds, &ua[p]);
+  }
+  printf("\nstop: %llu bytes lost to wake-ups (the 0x00 before each ping)\n",
+         (unsigned long long)sim_usart_rx_lost(USART3));
+  if (ua[POWER_STOP] * 2U > ua[POWER_SLEEP]) {
+    printf("  FAIL: Stop should take under half of Sleep's charge\n");
+    ok = 0;
+  }
+
+  if (check && !ok) {
+    fprintf(stderr, "FAIL\n");
+    return 1;
+  }
+  return 0;
+}
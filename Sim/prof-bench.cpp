@@ -0,0 +1,174 @@
+/*
+ * prof-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Checks prof.c's per-site statistics against durations known in advance,
+ * timed on the simulated DWT->CYCCNT.
+ *
+ * A PROF_BEGIN/PROF_END pair around sim_run(n) records n cycles plus the
+ * probe's own cost (the CYCCNT read, the same every time), which an empty
+ * span measures first. Each span must then land in the log2 bucket of n
+ * plus that cost and in no other, and the site's count, min, max and mean
+ * must be those of the spans. prof_record() is also called directly with
+ * the values either side of bucket boundaries, up to 0xFFFFFFFF; one span
+ * crosses the counter's wrap; prof_reset() must clear a site; and
+ * prof_init() must start the counter but leave one already running alone.
+ *
+ * Usage: prof-bench [--check]
+ *   --check  exit with status 1 if any of those does not hold
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "cycles.h"
+#include "prof.h"
+
+static int expect(int ok, const char *what) {
+  printf("  %-62s %s\n", what, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+// n cycles of work, probed
+static void span(uint64_t n) {
+  PROF_BEGIN(bench_span);
+  sim_run(n);
+  PROF_END(bench_span);
+}
+
+static uint32_t log2_floor(uint32_t v) {
+  uint32_t k = 0;
+  while (v >>= 1) k++;
+  return k;
+}
+
+// What a site should hold after the durations so far
+typedef struct {
+  uint32_t count, min, max;
+  uint64_t sum;
+} want_t;
+
+static void want_add(want_t *w, uint32_t cycles) {
+  if (!w->count || cycles < w->min) w->min = cycles;
+  if (cycles > w->max) w->max = cycles;
+  w->count++;
+  w->sum += cycles;
+}
+
+static int same_stats(const prof_site_t *s, const want_t *w) {
+  return s->count == w->count && s->min == w->min && s->max == w->max && s->sum == w->sum &&
+         s->sum / s->count == w->sum / w->count;
+}
+
+// The histogram gained one in the bucket of `cycles`, and nothing else
+static int counted_once(const uint32_t *before, const prof_site_t *s, uint32_t cycles) {
+  uint32_t b = log2_floor(cycles);
+  int ok = 1;
+  for (uint32_t k = 0; k < PROF_BUCKETS; k++) {
+    if (s->hist[k] != before[k] + (k == b ? 1U : 0U)) ok = 0;
+  }
+  if (!ok) {
+    printf("  FAIL: %lu cycles not counted in bucket %lu alone\n", (unsigned long)cycles,
+           (unsigned long)b);
+  }
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int check = 0, ok = 1;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  sim_reset();
+  printf("prof.c statistics on the simulated DWT->CYCCNT\n\n");
+
+  // prof_init() starts a stopped counter, and leaves a running one alone
+  prof_init();
+  ok &= expect((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) != 0U, "prof_init() starts the counter");
+  sim_run(100000);
+  uint32_t before_init = cycles_now();
+  prof_init();
+  ok &= expect(cycles_now() >= before_init, "prof_init() leaves a running counter alone");
+
+  // The probe's own cost, from an empty span
+  span(0);
+  prof_site_t *s = prof_find("bench_span");
+  if (!s) {
+    fprintf(stderr, "FAIL: the probe did not record\n");
+    return 1;
+  }
+  uint32_t probe = s->min;
+  printf("  probe cost %lu cycles\n", (unsigned long)probe);
+  prof_reset();
+
+  // Spans of known length: from the bottom bucket up to 2^24
+  static const uint32_t work[] = { 0, 1, 2, 3, 5, 8, 13, 60, 61, 62, 100, 1000, 1017, 1018, 4096,
+                                   65530, 65536, 1000000, 16777216 };
+  want_t w = { 0, 0, 0, 0 };
+  int buckets_ok = 1;
+  for (unsigned i = 0; i < sizeof(work) / sizeof(work[0]); i++) {
+    uint32_t before[PROF_BUCKETS];
+    memcpy(before, s->hist, sizeof(before));
+    span(work[i]);
+    uint32_t d = work[i] + probe;
+    want_add(&w, d);
+    // This span alone is known to be d
+    buckets_ok &= counted_once(before, s, d);
+  }
+  ok &= expect(buckets_ok, "each span lands in the log2 bucket of its length");
+  ok &= expect(same_stats(s, &w), "count, min, max and mean of the spans");
+  printf("  %lu spans: min %lu, mean %lu, max %lu\n", (unsigned long)s->count,
+         (unsigned long)s->min, (unsigned long)(s->sum / s->count), (unsigned long)s->max);
+
+  // Across the counter's wrap
+  prof_reset();
+  DWT->CYCCNT = 0xFFFFFFFFU - 500U;
+  span(1000);
+  ok &= expect(s->count == 1U && s->min == 1000U + probe && s->max == 1000U + probe,
+               "a span across the counter's wrap");
+
+  // prof_record() directly, either side of bucket boundaries
+  static prof_site_t direct = { "bench_direct", 0, 0, 0, 0, 0, 0, { 0 } };
+  static const uint32_t edges[] = { 0, 1, 2, 3, 4, 7, 8, 255, 256, 65535, 65536, 0x7FFFFFFFU,
+                                    0x80000000U, 0xFFFFFFFFU, 0xFFFFFFFFU };
+  want_t wd = { 0, 0, 0, 0 };
+  int edges_ok = 1;
+  for (unsigned i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+    uint32_t before[PROF_BUCKETS];
+    memcpy(before, direct.hist, sizeof(before));
+    prof_record(&direct, edges[i]);
+    edges_ok &= counted_once(before, &direct, edges[i]);
+    want_add(&wd, edges[i]);
+  }
+  ok &= expect(edges_ok, "0 to 0xFFFFFFFF, each in its bucket (0 and 1 in bucket 0)");
+  ok &= expect(same_stats(&direct, &wd) && direct.sum > 0xFFFFFFFFULL,
+               "their count, min, max and 64-bit sum");
+  ok &= expect(prof_find("bench_direct") == &direct, "prof_find() finds a site once it records");
+
+  // prof_reset() clears everything; the next duration is min and max
+  prof_reset();
+  int clear = !direct.count && !direct.min && !direct.max && !direct.sum;
+  for (uint32_t k = 0; k < PROF_BUCKETS; k++) clear &= !direct.hist[k];
+  prof_record(&direct, 300);
+  ok &= expect(clear && direct.count == 1U && direct.min == 300U && direct.max == 300U &&
+               direct.hist[8] == 1U, "prof_reset() clears a site");
+
+  if (check && !ok) {
+    fprintf(stderr, "FAIL: prof.c recorded durations it was not given\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * ring-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Stress test and throughput benchmark of the lock-free queues,
+ * Src/ring.h and Src/mpsc.h, on host threads standing in for handlers
+ * and thread mode. No simulated peripherals: the headers are used as
+ * they are.
+ *
+ * Stress: a producer and a consumer thread pass a known byte sequence
+ * through a small SPSC ring, each mixing the byte, bulk and span calls
+ * in random sizes so every wrap position is met; then several producer
+ * threads put numbered items into a small MPSC queue and the consumer
+ * checks each producer's items arrive all, once and in order. Built as
+ * ring-tsan with -fsanitize=thread, ThreadSanitizer also reports any
+ * access the acquire/release ordering does not cover.
+ *
+ * Throughput: bytes per second through a larger SPSC ring a byte at a
+ * time, in bulk and in place, and items per second through the MPSC
+ * queue. These are host figures, for comparing the calls with each
+ * other; the ordering costs on the Cortex-M7 are a DMB per counter.
+ *
+ * Usage: ring-bench [--check] [--stress]
+ *   --check   exit with status 1 if any byte or item is wrong
+ *   --stress  run the stress test only (as ring-tsan does)
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mpsc.h"
+#include "ring.h"
+
+#define STRESS_BYTES   (4UL * 1024UL * 1024UL)
+#define STRESS_RING    64U
+#define STRESS_ITEMS   200000UL // Per producer
+#define STRESS_QUEUE   16U
+#define PRODUCERS      3U
+
+#define BENCH_BYTES    (64UL * 1024UL * 1024UL)
+#define BENCH_RING     4096U
+#define BENCH_CHUNK    256U
+#define BENCH_ITEMS    4000000UL // In all
+
+typedef struct {
+  uint32_t producer;
+  uint32_t n;
+} item_t;
+
+typedef enum { BYTES, BULK, SPAN, MIXED } call_t;
+
+static int failures;
+
+static uint8_t ring_buf[BENCH_RING];
+static ring_t ring;
+static call_t mode;
+static unsigned long total;
+static unsigned long bad_bytes;
+
+static item_t queue_buf[STRESS_QUEUE];
+static uint32_t queue_seq[STRESS_QUEUE];
+static mpsc_t queue;
+static unsigned long per_producer;
+static unsigned long bad_items;
+
+static void expect(int ok, const char *what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) failures++;
+}
+
+static double now_s(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+// Per thread: xorshift32
+static uint32_t next_rand(uint32_t *rng) {
+  *rng ^= *rng << 13;
+  *rng ^= *rng >> 17;
+  *rng ^= *rng << 5;
+  return *rng;
+}
+
+// Byte n of the stream; 251 is prime, so it never lines up with a wrap
+static uint8_t byte_at(unsigned long n) {
+  return (uint8_t)(n % 251UL);
+}
+
+static void *ring_producer(void *arg) {
+  uint32_t rng = 0x12345678U;
+  uint8_t chunk[BENCH_RING];
+  unsigned long sent = 0;
+  (void)arg;
+
+  while (sent < total) {
+    call_t m = mode == MIXED ? (call_t)(next_rand(&rng) % 3U) : mode;
+    uint32_t want = mode == MIXED ? 1U + next_rand(&rng) % (STRESS_RING + 8U) : BENCH_CHUNK;
+    if (want > total - sent) want = (uint32_t)(total - sent);
+    uint32_t n = 0;
+
+    switch (m) {
+    case BYTES:
+      n = ring_put(&ring, byte_at(sent));
+      break;
+    case BULK:
+      for (uint32_t i = 0; i < want; i++) chunk[i] = byte_at(sent + i);
+      n = ring_write(&ring, chunk, want);
+      break;
+    default: {
+      uint8_t *dst = ring_reserve(&ring, &n);
+      if (n > want) n = want;
+      for (uint32_t i = 0; i < n; i++) dst[i] = byte_at(sent + i);
+      ring_commit(&ring, n);
+      break;
+    }
+    }
+    sent += n;
+    if (!n) sched_yield();
+  }
+  return NULL;
+}
+
+static void *ring_consumer(void *arg) {
+  uint32_t rng = 0x9abcdef0U;
+  uint8_t chunk[BENCH_RING];
+  unsigned long got = 0;
+  (void)arg;
+
+  while (got < total) {
+    call_t m = mode == MIXED ? (call_t)(next_rand(&rng) % 3U) : mode;
+    uint32_t want = mode == MIXED ? 1U + next_rand(&rng) % (STRESS_RING + 8U) : BENCH_CHUNK;
+    uint32_t n = 0;
+
+    switch (m) {
+    case BYTES: {
+      uint8_t c;
+      n = ring_get(&ring, &c);
+      if (n && c != byte_at(got)) bad_bytes++;
+      break;
+    }
+    case BULK:
+      n = ring_read(&ring, chunk, want);
+      for (uint32_t i = 0; i < n; i++) {
+        if (chunk[i] != byte_at(got + i)) bad_bytes++;
+      }
+      break;
+    default: {
+      const uint8_t *src = ring_peek(&ring, &n);
+      if (n > want) n = want;
+      for (uint32_t i = 0; i < n; i++) {
+        if (src[i] != byte_at(got + i)) bad_bytes++;
+      }
+      ring_consume(&ring, n);
+      break;
+    }
+    }
+    got += n;
+    if (!n) sched_yield();
+  }
+  return NULL;
+}
+
+// Bytes per second through a ring of `size` in mode m
+static double run_ring(call_t m, uint32_t size, unsigned long bytes) {
+  pthread_t producer, consumer;
+
+  memset(ring_buf, 0, sizeof(ring_buf));
+  ring = (ring_t)RING_INIT(ring_buf, size);
+  mode = m;
+  total = bytes;
+  bad_bytes = 0;
+
+  double t0 = now_s();
+  pthread_create(&consumer, NULL, ring_consumer, NULL);
+  pthread_create(&producer, NULL, ring_producer, NULL);
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+  return (double)bytes / (now_s() - t0);
+}
+
+static void *queue_producer(void *arg) {
+  item_t it = { (uint32_t)(uintptr_t)arg, 0 };
+  while (it.n < per_producer) {
+    if (mpsc_put(&queue, &it)) {
+      it.n++;
+    } else {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+// Items per second from PRODUCERS threads through a queue of len
+static double run_queue(uint32_t len, unsigned long items) {
+  pthread_t producers[PRODUCERS];
+  uint32_t expected[PRODUCERS] = { 0 };
+  item_t got[8];
+
+  memset(queue_buf, 0, sizeof(queue_buf));
+  memset(queue_seq, 0, sizeof(queue_seq));
+  queue = (mpsc_t)MPSC_INIT(queue_buf, queue_seq, sizeof(item_t), len);
+  per_producer = items / PRODUCERS;
+  bad_items = 0;
+
+  double t0 = now_s();
+  for (uint32_t i = 0; i < PRODUCERS; i++) {
+    pthread_create(&producers[i], NULL, queue_producer, (void *)(uintptr_t)i);
+  }
+  unsigned long left = per_producer * PRODUCERS;
+  while (left) {
+    uint32_t n = mpsc_read(&queue, got, (uint32_t)(sizeof(got) / sizeof(got[0])));
+    for (uint32_t i = 0; i < n; i++) {
+      if (got[i].producer >= PRODUCERS || got[i].n != expected[got[i].producer]++) bad_items++;
+    }
+    left -= n;
+    if (!n) sched_yield();
+  }
+  for (uint32_t i = 0; i < PRODUCERS; i++) pthread_join(producers[i], NULL);
+  double rate = (double)(per_producer * PRODUCERS) / (now_s() - t0);
+  if (mpsc_count(&queue)) bad_items++;
+  return rate;
+}
+
+int main(int argc, char **argv) {
+  int check = 0, stress_only = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else if (!strcmp(argv[i], "--stress")) {
+      stress_only = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--check] [--stress]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  printf("ring: %lu bytes through %u, %u producers of %lu items through %u\n", STRESS_BYTES,
+         STRESS_RING, PRODUCERS, STRESS_ITEMS, STRESS_QUEUE);
+  run_ring(MIXED, STRESS_RING, STRESS_BYTES);
+  expect(!bad_bytes, "SPSC: every byte in order, mixing byte, bulk and span calls");
+  run_queue(STRESS_QUEUE, STRESS_ITEMS * PRODUCERS);
+  expect(!bad_items, "MPSC: every producer's items, each once and in order");
+
+  if (!stress_only) {
+    printf("\n  %-30s %12s\n", "throughput", "MB/s");
+    static const struct { call_t mode; const char *what; } modes[] = {
+      { BYTES, "SPSC, ring_put/ring_get" },
+      { BULK, "SPSC, ring_write/ring_read" },
+      { SPAN, "SPSC, reserve/commit, peek" },
+    };
+    for (unsigned i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+      unsigned long bytes = modes[i].mode == BYTES ? BENCH_BYTES / 16UL : BENCH_BYTES;
+      double rate = run_ring(modes[i].mode, BENCH_RING, bytes);
+      printf("  %-30s %12.1f\n", modes[i].what, rate / 1e6);
+      if (bad_bytes) failures++;
+    }
+    double rate = run_queue(STRESS_QUEUE, BENCH_ITEMS);
+    printf("  %-30s %12.1f  (%u-byte items, Mitems/s %.2f)\n", "MPSC, mpsc_put/mpsc_read",
+           rate * sizeof(item_t) / 1e6, (unsigned)sizeof(item_t), rate / 1e6);
+    if (bad_items) failures++;
+    printf("\n");
+  }
+
+  printf("%d failed\n", failures);
+  if (check && failures) {
+    fprintf(stderr, "FAIL: %d queue checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
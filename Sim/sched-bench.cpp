@@ -0,0 +1,146 @@
+/*
+ * sched-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Timer-wheel scheduler jitter benchmark on the simulated core.
+ *
+ * Runs many periodic jobs at once on the SysTick time base, each doing a
+ * little work and toggling a pin, while the interrupt-driven console
+ * streams text, and reports per period how late the jobs ran: from the
+ * start of the tick they were due in to the start of their callback.
+ *
+ * Usage: sched-bench [--timers N] [--seconds S] [--work CYCLES] [--check]
+ *   --check  exit with status 1 if any run was skipped or a whole tick late
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "clock.h"
+#include "console.h"
+#include "sched.h"
+#include "tick.h"
+
+// Drivers from Src/main.c (which has no header of its own)
+void uart3_rxtx_init(void);
+
+#define MAX_TIMERS 1024
+
+static const uint32_t periods_ms[] = { 1, 2, 3, 5, 10, 20, 50, 100 };
+#define NUM_PERIODS (sizeof(periods_ms) / sizeof(periods_ms[0]))
+
+static sched_timer_t timers[MAX_TIMERS];
+static sched_timer_t console_timer;
+static uint64_t work_cycles = 500;
+
+static void job(void *arg) {
+  uint32_t pin = (uint32_t)(uintptr_t)arg;
+  sim_run(work_cycles);
+  GPIOB->BSRR = 1UL << pin;
+  GPIOB->BSRR = 1UL << (pin + 16U);
+}
+
+static void chatter(void *arg) {
+  static const char line[] = "the quick brown fox jumps over the lazy dog 0123456789 ...\r\n";
+  (void)arg;
+  console_write((const uint8_t *)line, (int)sizeof(line) - 1);
+}
+
+static void ignore_tx(USART_TypeDef *usart, uint8_t c) {
+  (void)usart;
+  (void)c;
+}
+
+int main(int argc, char **argv) {
+  unsigned num_timers = 64;
+  double seconds = 10.0;
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--timers") && i + 1 < argc) {
+      num_timers = (unsigned)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+      seconds = strtod(argv[++i], NULL);
+    } else if (!strcmp(argv[i], "--work") && i + 1 < argc) {
+      work_cycles = strtoull(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--timers N] [--seconds S] [--work CYCLES] [--check]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (num_timers > MAX_TIMERS) num_timers = MAX_TIMERS;
+
+  sim_reset();
+  sim_usart_set_tx_sink(USART3, ignore_tx);
+  clock_init();
+  uart3_rxtx_init();
+  console_init();
+  tick_init(clock_hclk_hz());
+  sched_init();
+
+  for (unsigned i = 0; i < num_timers; i++) {
+    uint32_t p = TICK_MS(periods_ms[i % NUM_PERIODS]);
+    // Spread the phases so that not everything lands on the same tick
+    sched_start(&timers[i], "job", 1U + i % p, p, job, (void *)(uintptr_t)(i % 16U));
+  }
+  sched_start(&console_timer, "console", 1, TICK_MS(10), chatter, NULL);
+
+  sim_counters_t a = sim_count;
+  uint64_t end = sim_count.cycles + (uint64_t)(seconds * sim_core_hz);
+  while (sim_count.cycles < end) {
+    sched_run();
+    sched_wait();
+  }
+  sim_counters_t b = sim_count;
+
+  double per_us = (double)tick_cycles_per_tick() / (1000000.0 / TICK_HZ);
+  uint32_t worst = 0;
+  uint32_t skipped = 0;
+
+  printf("%u timers, %llu cycles of work each, console streaming, core %lu Hz, %u Hz tick\n\n",
+         num_timers, (unsigned long long)work_cycles, (unsigned long)sim_core_hz, TICK_HZ);
+  printf("%9s %7s %9s %9s %9s %9s %8s\n",
+         "period ms", "timers", "runs", "min us", "mean us", "max us", "skipped");
+  for (unsigned p = 0; p < NUM_PERIODS; p++) {
+    unsigned n = 0;
+    uint64_t runs = 0, sum = 0, skip = 0;
+    uint32_t lo = 0xFFFFFFFFUL, hi = 0;
+    for (unsigned i = p; i < num_timers; i += NUM_PERIODS) {
+      const sched_timer_t *t = &timers[i];
+      n++;
+      runs += t->runs;
+      sum += t->late_sum;
+      skip += t->skipped;
+      if (t->runs && t->late_min < lo) lo = t->late_min;
+      if (t->late_max > hi) hi = t->late_max;
+    }
+    if (!runs) continue;
+    printf("%9lu %7u %9llu %9.2f %9.2f %9.2f %8llu\n",
+           (unsigned long)periods_ms[p], n, (unsigned long long)runs,
+           lo / per_us, (double)sum / (double)runs / per_us, hi / per_us,
+           (unsigned long long)skip);
+    if (hi > worst) worst = hi;
+    skipped += (uint32_t)skip;
+  }
+
+  uint64_t cycles = b.cycles - a.cycles;
+  printf("\ncpu busy %.1f%%, %.0f interrupts/s\n",
+         100.0 * (double)(cycles - (b.idle_cycles - a.idle_cycles)) / (double)cycles,
+         (double)(b.irq_entries - a.irq_entries) * sim_core_hz / (double)cycles);
+
+  if (check && (skipped || worst >= tick_cycles_per_tick())) {
+    fprintf(stderr, "FAIL: %lu runs skipped, worst lateness %.2f us\n",
+            (unsigned long)skipped, worst / per_us);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,2133 @@
+/*
+ * sim.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Peripheral models behind the simulated stm32f7xx.h.
+ *
+ * Every register access from the drivers lands in sim_read()/sim_write(),
+ * which charge simulated time, bring the peripheral models up to date,
+ * apply the access, and then run any interrupt handler that became due.
+ * See sim.h for the timing model.
+ *
+ * USART behavior: RM0410 Rev 5 Sec 34.5 p 1239
+ * DMA behavior:   RM0410 Rev 5 Sec 8.3 p 221
+ * EXTI behavior:  RM0410 Rev 5 Sec 11.3 p 297
+ * TIM6/7:         RM0410 Rev 5 Sec 28.3 p 1035
+ * CRC unit:       RM0410 Rev 5 Sec 14.3
+ * LPTIM1:         RM0410 Rev 5 Sec 33.4
+ * Flash:          RM0410 Rev 5 Sec 3.3
+ * Stop mode:      RM0410 Rev 5 Sec 4.3.6, PM0253 Rev 5 Sec 2.5
+ * NVIC behavior:  Arm v7-M ARM Sec B1.5
+ */
+
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "boot.h"
+#include "memstat.h"
+
+GPIO_TypeDef sim_GPIOA, sim_GPIOB, sim_GPIOC, sim_GPIOD, sim_GPIOE;
+USART_TypeDef sim_USART1, sim_USART2, sim_USART3, sim_UART4;
+USART_TypeDef sim_UART5, sim_USART6, sim_UART7, sim_UART8;
+RCC_TypeDef sim_RCC;
+PWR_TypeDef sim_PWR;
+FLASH_TypeDef sim_FLASH;
+sim_dma_block sim_DMA1, sim_DMA2;
+SYSCFG_TypeDef sim_SYSCFG;
+EXTI_TypeDef sim_EXTI;
+TIM_TypeDef sim_TIM1, sim_TIM6, sim_TIM7, sim_TIM8;
+LPTIM_TypeDef sim_LPTIM1;
+CRC_TypeDef sim_CRC;
+DWT_Type sim_DWT;
+CoreDebug_Type sim_CoreDebug;
+SysTick_Type sim_SysTick;
+SCB_Type sim_SCB;
+MPU_Type sim_MPU;
+FPU_Type sim_FPU;
+uint32_t sim_apsr_ge;
+
+uint32_t sim_core_hz  = 16000000UL;
+uint32_t sim_pclk1_hz = 16000000UL;
+uint32_t sim_pclk2_hz = 16000000UL;
+static uint32_t sysclk_hz = 16000000UL;
+sim_counters_t sim_count;
+
+// Interrupt handlers that may or may not be linked in
+extern void USART1_IRQHandler(void) __attribute__((weak));
+extern void USART2_IRQHandler(void) __attribute__((weak));
+extern void USART3_IRQHandler(void) __attribute__((weak));
+extern void UART4_IRQHandler(void) __attribute__((weak));
+extern void UART5_IRQHandler(void) __attribute__((weak));
+extern void USART6_IRQHandler(void) __attribute__((weak));
+extern void UART7_IRQHandler(void) __attribute__((weak));
+extern void UART8_IRQHandler(void) __attribute__((weak));
+extern void DMA1_Stream3_IRQHandler(void) __attribute__((weak));
+extern void DMA2_Stream1_IRQHandler(void) __attribute__((weak));
+extern void DMA2_Stream5_IRQHandler(void) __attribute__((weak));
+extern void EXTI0_IRQHandler(void) __attribute__((weak));
+extern void EXTI1_IRQHandler(void) __attribute__((weak));
+extern void EXTI2_IRQHandler(void) __attribute__((weak));
+extern void EXTI3_IRQHandler(void) __attribute__((weak));
+extern void EXTI4_IRQHandler(void) __attribute__((weak));
+extern void EXTI9_5_IRQHandler(void) __attribute__((weak));
+extern void EXTI15_10_IRQHandler(void) __attribute__((weak));
+extern void TIM6_DAC_IRQHandler(void) __attribute__((weak));
+extern void TIM7_IRQHandler(void) __attribute__((weak));
+extern void TIM8_UP_TIM13_IRQHandler(void) __attribute__((weak));
+extern void TIM1_UP_TIM10_IRQHandler(void) __attribute__((weak));
+extern void LP_Timer1_IRQHandler(void) __attribute__((weak));
+extern void SysTick_Handler(void) __attribute__((weak));
+extern void PendSV_Handler(void) __attribute__((weak));
+
+static void step(void);
+static void service(void);
+
+
+/* ----------------------------------------------------------------------
+ * Time in nanoseconds. sim_count.cycles runs at whatever the core clock
+ * is, so it is rebased here each time that changes; events that must keep
+ * their place across a clock change (GPIO inputs, LPTIM1) are kept in ns.
+ */
+
+#define NS_PER_S 1000000000ULL
+
+static uint64_t ns_base;        // sim_now_ns() at cycle ns_base_cycles
+static uint64_t ns_base_cycles;
+static uint32_t ns_hz = 16000000UL;
+
+// At a cycle no earlier than the last clock change
+static uint64_t ns_of(uint64_t cycle) {
+  if (cycle < ns_base_cycles) return ns_base;
+  uint64_t d = cycle - ns_base_cycles;
+  return ns_base + d / ns_hz * NS_PER_S + d % ns_hz * NS_PER_S / ns_hz;
+}
+
+uint64_t sim_now_ns(void) {
+  return ns_of(sim_count.cycles);
+}
+
+// The first cycle at which sim_now_ns() >= ns, at the current core clock
+static uint64_t cycles_at(uint64_t ns) {
+  if (ns <= ns_base) return ns_base_cycles;
+  uint64_t d = ns - ns_base;
+  return ns_base_cycles + d / NS_PER_S * ns_hz + (d % NS_PER_S * ns_hz + NS_PER_S - 1U) / NS_PER_S;
+}
+
+// The core clock is about to change: keep sim_now_ns() continuous
+static void ns_rebase(uint32_t hz) {
+  if (hz == ns_hz) return;
+  ns_base = sim_now_ns();
+  ns_base_cycles = sim_count.cycles;
+  ns_hz = hz;
+}
+
+/* ----------------------------------------------------------------------
+ * What the linker script and startup code provide on the target: the
+ * stack area with its guard region below it (memstat.h) and the _sbrk()
+ * heap (sysmem.c). Firmware code does not run on this stack, so it stays
+ * painted; the host's own stack is used.
+ */
+
+#define SIM_GUARD_BYTES 256
+#define SIM_STACK_WORDS 4096
+#define SIM_HEAP_BYTES  4096
+#define SIM_STR_(X) #X
+#define SIM_STR(X) SIM_STR_(X)
+
+uint32_t sim_stack_guard[SIM_GUARD_BYTES / 4] __asm__("_sstack_guard");
+uint32_t sim_stack[SIM_STACK_WORDS] __asm__("_sstack");
+uint8_t sim_heap[SIM_HEAP_BYTES] __asm__("_sheap");
+__asm__(".globl _estack\n\t.set _estack, _sstack + 4 * " SIM_STR(SIM_STACK_WORDS) "\n\t"
+        ".globl _eheap\n\t.set _eheap, _sheap + " SIM_STR(SIM_HEAP_BYTES));
+
+static uint8_t *sim_brk = sim_heap;
+
+void *_sbrk(ptrdiff_t incr) {
+  if (incr > sim_heap + SIM_HEAP_BYTES - sim_brk || incr < sim_heap - sim_brk) return (void *)-1;
+  uint8_t *prev = sim_brk;
+  sim_brk += incr;
+  return prev;
+}
+
+
+/* The host has already loaded .data and zeroed .bss, so Reset_Handler's
+   regions are all empty here. The ITCM load image is a flash stand-in
+   for boot_bench() to copy from. There are no static constructors. */
+#define SIM_IMAGE_WORDS 1024
+
+uint32_t sim_image[SIM_IMAGE_WORDS] __asm__("_siitcm");
+__asm__(".globl _sdata\n\t.set _sdata, _siitcm\n\t"
+        ".globl _sdtcm\n\t.set _sdtcm, _siitcm\n\t.globl _edtcm\n\t.set _edtcm, _siitcm\n\t"
+        ".globl _sitcm\n\t.set _sitcm, _siitcm\n\t.globl _eitcm\n\t.set _eitcm, _siitcm\n\t"
+        ".globl _sbss\n\t.set _sbss, _siitcm\n\t.globl _ebss\n\t.set _ebss, _siitcm\n\t"
+        ".globl _sdtcm_bss\n\t.set _sdtcm_bss, _siitcm\n\t"
+        ".globl _edtcm_bss\n\t.set _edtcm_bss, _siitcm");
+
+void __libc_init_array(void) {
+}
+
+// The startup's loops, in Startup/startup_stm32f767zitx.s on the target
+void boot_copy_block(uint32_t *dst, uint32_t *end, const uint32_t *src) {
+  while (dst < end) *dst++ = *src++;
+}
+
+void boot_fill_block(uint32_t *dst, uint32_t *end, uint32_t value) {
+  while (dst < end) *dst++ = value;
+}
+
+void boot_copy_word(uint32_t *dst, uint32_t *end, const uint32_t *src) {
+  boot_copy_block(dst, end, src);
+}
+
+void boot_fill_word(uint32_t *dst, uint32_t *end, uint32_t value) {
+  boot_fill_block(dst, end, value);
+}
+
+/* ----------------------------------------------------------------------
+ * Address decoding
+ */
+
+typedef enum {
+  K_PLAIN, K_GPIO, K_USART, K_DMA, K_DWT, K_RCC, K_PWR, K_SYSTICK, K_SCB, K_EXTI, K_TIM, K_CRC,
+  K_LPTIM, K_FLASH, K_SYSCFG
+} kind_t;
+
+typedef struct {
+  void *base;
+  size_t size;
+  kind_t kind;
+  uint32_t cost;
+  int index; // Which model of that kind
+} region_t;
+
+static const region_t regions[] = {
+  { &sim_GPIOA,     sizeof(sim_GPIOA),     K_GPIO,  SIM_AHB_CYCLES, 0 },
+  { &sim_GPIOB,     sizeof(sim_GPIOB),     K_GPIO,  SIM_AHB_CYCLES, 1 },
+  { &sim_GPIOC,     sizeof(sim_GPIOC),     K_GPIO,  SIM_AHB_CYCLES, 2 },
+  { &sim_GPIOD,     sizeof(sim_GPIOD),     K_GPIO,  SIM_AHB_CYCLES, 3 },
+  { &sim_GPIOE,     sizeof(sim_GPIOE),     K_GPIO,  SIM_AHB_CYCLES, 4 },
+  { &sim_USART1,    sizeof(sim_USART1),    K_USART, SIM_APB_CYCLES, 0 },
+  { &sim_USART2,    sizeof(sim_USART2),    K_USART, SIM_APB_CYCLES, 1 },
+  { &sim_USART3,    sizeof(sim_USART3),    K_USART, SIM_APB_CYCLES, 2 },
+  { &sim_UART4,     sizeof(sim_UART4),     K_USART, SIM_APB_CYCLES, 3 },
+  { &sim_UART5,     sizeof(sim_UART5),     K_USART, SIM_APB_CYCLES, 4 },
+  { &sim_USART6,    sizeof(sim_USART6),    K_USART, SIM_APB_CYCLES, 5 },
+  { &sim_UART7,     sizeof(sim_UART7),     K_USART, SIM_APB_CYCLES, 6 },
+  { &sim_UART8,     sizeof(sim_UART8),     K_USART, SIM_APB_CYCLES, 7 },
+  { &sim_RCC,       sizeof(sim_RCC),       K_RCC,   SIM_AHB_CYCLES, 0 },
+  { &sim_PWR,       sizeof(sim_PWR),       K_PWR,   SIM_APB_CYCLES, 0 },
+  { &sim_FLASH,     sizeof(sim_FLASH),     K_FLASH, SIM_AHB_CYCLES, 0 },
+  { &sim_DMA1,      sizeof(sim_DMA1),      K_DMA,   SIM_AHB_CYCLES, 0 },
+  { &sim_DMA2,      sizeof(sim_DMA2),      K_DMA,   SIM_AHB_CYCLES, 1 },
+  { &sim_SYSCFG,    sizeof(sim_SYSCFG),    K_SYSCFG, SIM_APB_CYCLES, 0 },
+  { &sim_EXTI,      sizeof(sim_EXTI),      K_EXTI,  SIM_APB_CYCLES, 0 },
+  { &sim_TIM6,      sizeof(sim_TIM6),      K_TIM,   SIM_APB_CYCLES, 0 },
+  { &sim_TIM7,      sizeof(sim_TIM7),      K_TIM,   SIM_APB_CYCLES, 1 },
+  { &sim_TIM8,      sizeof(sim_TIM8),      K_TIM,   SIM_APB_CYCLES, 2 },
+  { &sim_TIM1,      sizeof(sim_TIM1),      K_TIM,   SIM_APB_CYCLES, 3 },
+  { &sim_CRC,       sizeof(sim_CRC),       K_CRC,   SIM_AHB_CYCLES, 0 },
+  { &sim_LPTIM1,    sizeof(sim_LPTIM1),    K_LPTIM, SIM_APB_CYCLES, 0 },
+  { &sim_DWT,       sizeof(sim_DWT),       K_DWT,   1,              0 },
+  { &sim_CoreDebug, sizeof(sim_CoreDebug), K_PLAIN, 1,              0 },
+  { &sim_SysTick,   sizeof(sim_SysTick),   K_SYSTICK, 1,            0 },
+  { &sim_SCB,       sizeof(sim_SCB),       K_SCB,   1,              0 },
+  { &sim_MPU,       sizeof(sim_MPU),       K_PLAIN, 1,              0 },
+  { &sim_FPU,       sizeof(sim_FPU),       K_PLAIN, 1,              0 },
+};
+#define NUM_REGIONS (sizeof(regions) / sizeof(regions[0]))
+
+static const region_t *find_region(const void *p, uint32_t *offset) {
+  const uint8_t *a = (const uint8_t *)p;
+  for (unsigned i = 0; i < NUM_REGIONS; i++) {
+    const uint8_t *b = (const uint8_t *)regions[i].base;
+    if (a >= b && a < b + regions[i].size) {
+      *offset = (uint32_t)(a - b);
+      return &regions[i];
+    }
+  }
+  fprintf(stderr, "sim: access to unmapped register at %p\n", p);
+  abort();
+}
+
+
+/* ----------------------------------------------------------------------
+ * GPIO
+ */
+
+static GPIO_TypeDef *const gpios[] = { &sim_GPIOA, &sim_GPIOB, &sim_GPIOC, &sim_GPIOD, &sim_GPIOE };
+#define NUM_GPIOS (sizeof(gpios) / sizeof(gpios[0]))
+static uint32_t gpio_in[NUM_GPIOS];
+static sim_gpio_watch_t gpio_watch[NUM_GPIOS];
+static sim_gpio_source_t gpio_source[NUM_GPIOS];
+
+// What IDR reads at time ns. Pins in output mode read back what they
+// drive: RM0410 Rev 5 Sec 6.3.10.
+static uint32_t gpio_idr(int idx, uint64_t ns) {
+  uint32_t moder = gpios[idx]->MODER.v, out = 0;
+  for (unsigned pin = 0; pin < 16U; pin++) {
+    if (((moder >> (2U * pin)) & 3U) == 1U) out |= 1UL << pin;
+  }
+  uint32_t in = gpio_source[idx] ? gpio_source[idx](gpios[idx], ns) : gpio_in[idx];
+  return ((in & ~out) | (gpios[idx]->ODR.v & out)) & 0xFFFFUL;
+}
+
+static uint32_t gpio_read(int idx, uint32_t off) {
+  GPIO_TypeDef *g = gpios[idx];
+  if (off == offsetof(GPIO_TypeDef, IDR)) return gpio_idr(idx, sim_now_ns());
+  if (off == offsetof(GPIO_TypeDef, BSRR)) return 0;
+  return ((sim_reg *)((uint8_t *)g + off))->v;
+}
+
+// From the CPU or a DMA transfer at time t
+static void gpio_write(int idx, uint32_t off, uint32_t v, uint64_t t) {
+  GPIO_TypeDef *g = gpios[idx];
+  uint32_t was = g->ODR.v;
+  if (off == offsetof(GPIO_TypeDef, BSRR)) {
+    // Set has priority over reset: RM0410 Rev 5 Sec 6.4.7
+    g->ODR.v = ((g->ODR.v & ~(v >> 16)) | v) & 0xFFFFUL;
+  } else if (off != offsetof(GPIO_TypeDef, IDR)) {
+    ((sim_reg *)((uint8_t *)g + off))->v = v;
+  }
+  if (g->ODR.v != was && gpio_watch[idx]) gpio_watch[idx](g, g->ODR.v, t);
+}
+
+void sim_gpio_set_watch(GPIO_TypeDef *gpio, sim_gpio_watch_t watch) {
+  for (unsigned i = 0; i < NUM_GPIOS; i++) {
+    if (gpios[i] == gpio) gpio_watch[i] = watch;
+  }
+}
+
+void sim_gpio_set_source(GPIO_TypeDef *gpio, sim_gpio_source_t source) {
+  for (unsigned i = 0; i < NUM_GPIOS; i++) {
+    if (gpios[i] == gpio) gpio_source[i] = source;
+  }
+}
+
+static void exti_edge(unsigned port, uint32_t pin, int rising);
+
+static void gpio_set_input(unsigned idx, uint32_t pin, int level) {
+  uint32_t was = gpio_in[idx];
+  if (level) gpio_in[idx] |= 1UL << pin;
+  else       gpio_in[idx] &= ~(1UL << pin);
+  if (gpio_in[idx] != was) exti_edge(idx, pin, level);
+}
+
+void sim_gpio_set_input(GPIO_TypeDef *gpio, uint32_t pin, int level) {
+  for (unsigned i = 0; i < NUM_GPIOS; i++) {
+    if (gpios[i] == gpio) gpio_set_input(i, pin, level);
+  }
+}
+
+// Input changes waiting for their time, in time order
+#define SIM_MAX_INPUTS 256
+typedef struct {
+  uint64_t at; // sim_now_ns()
+  uint8_t port;
+  uint8_t pin;
+  uint8_t level;
+} gpio_change_t;
+static gpio_change_t inputs[SIM_MAX_INPUTS];
+static unsigned num_inputs;
+
+void sim_gpio_input_at_ns(GPIO_TypeDef *gpio, uint32_t pin, int level, uint64_t at) {
+  unsigned port = 0;
+  while (port < NUM_GPIOS && gpios[port] != gpio) port++;
+  if (port == NUM_GPIOS || num_inputs == SIM_MAX_INPUTS) {
+    fprintf(stderr, "sim: cannot schedule that GPIO input change\n");
+    abort();
+  }
+  // After any already waiting for the same time
+  unsigned i = num_inputs++;
+  for (; i > 0 && inputs[i - 1].at > at; i--) inputs[i] = inputs[i - 1];
+  inputs[i].at = at;
+  inputs[i].port = (uint8_t)port;
+  inputs[i].pin = (uint8_t)pin;
+  inputs[i].level = level ? 1U : 0U;
+}
+
+void sim_gpio_input_at(GPIO_TypeDef *gpio, uint32_t pin, int level, uint64_t at) {
+  sim_gpio_input_at_ns(gpio, pin, level, ns_of(at));
+}
+
+// now in ns
+static void gpio_step(uint64_t now) {
+  unsigned n = 0;
+  while (n < num_inputs && inputs[n].at <= now) {
+    gpio_set_input(inputs[n].port, inputs[n].pin, inputs[n].level);
+    n++;
+  }
+  if (n) {
+    memmove(inputs, inputs + n, (num_inputs - n) * sizeof(inputs[0]));
+    num_inputs -= n;
+  }
+}
+
+
+/* ----------------------------------------------------------------------
+ * EXTI: GPIO lines 0-15 only, routed by SYSCFG->EXTICR.
+ * A selected edge sets the pending bit whether or not the line is
+ * unmasked in IMR; the interrupt is PR & IMR. RM0410 Rev 5 Sec 11.3.5
+ */
+
+static void exti_edge(unsigned port, uint32_t pin, int rising) {
+  uint32_t sel = (sim_SYSCFG.EXTICR[pin / 4U].v >> (4U * (pin % 4U))) & 0xFU;
+  uint32_t bit = 1UL << pin;
+  if (sel != port) return;
+  if (rising ? (sim_EXTI.RTSR.v & bit) : (sim_EXTI.FTSR.v & bit)) sim_EXTI.PR.v |= bit;
+}
+
+static void exti_write(uint32_t off, uint32_t v) {
+  if (off == offsetof(EXTI_TypeDef, PR)) {
+    sim_EXTI.PR.v &= ~v; // Write 1 to clear
+  } else if (off == offsetof(EXTI_TypeDef, SWIER)) {
+    sim_EXTI.PR.v |= v & ~sim_EXTI.SWIER.v; // 0 to 1 sets the pending bit
+    sim_EXTI.SWIER.v = v;
+  } else {
+    ((sim_reg *)((uint8_t *)&sim_EXTI + off))->v = v;
+  }
+  sim_EXTI.SWIER.v &= sim_EXTI.PR.v; // Each SWIER bit clears with its PR bit
+}
+
+// EXTI lines behind each EXTI interrupt
+static const struct {
+  IRQn_Type irq;
+  uint32_t lines;
+} exti_irqs[] = {
+  { EXTI0_IRQn, 1UL << 0 },
+  { EXTI1_IRQn, 1UL << 1 },
+  { EXTI2_IRQn, 1UL << 2 },
+  { EXTI3_IRQn, 1UL << 3 },
+  { EXTI4_IRQn, 1UL << 4 },
+  { EXTI9_5_IRQn, 0x03E0UL },
+  { EXTI15_10_IRQn, 0xFC00UL },
+};
+#define NUM_EXTI_IRQS (sizeof(exti_irqs) / sizeof(exti_irqs[0]))
+
+
+/* ----------------------------------------------------------------------
+ * USART
+ */
+
+typedef struct {
+  USART_TypeDef *regs;
+  IRQn_Type irq;
+  void (*handler)(void);
+  uint32_t *pclk_hz;   // Its APB clock, the kernel clock unless DCKCFGR2 picks another
+  int rx_port;         // The RX pin, for the Stop mode wake-up: gpios[] index, or -1
+  uint32_t rx_pin;
+
+  int shifting;        // A frame is on the TX line
+  uint64_t shift_end;  // ...and its stop bit ends here
+  uint16_t shift_data;
+  int tdr_full;        // A second byte waits in TDR (TXE = 0)
+  uint16_t tdr;
+
+  int rx_busy;         // A frame is arriving on the RX line
+  uint64_t rx_done;
+  uint16_t rx_data;
+  uint64_t rx_poll;    // When to next ask the source for a byte
+
+  sim_tx_sink_t sink;
+  sim_rx_source_t source;
+  uint64_t tx_count, rx_count;
+  uint64_t rx_lost;    // Offered while the USART had no clock, in Stop mode
+  uint32_t far_baud;   // The far end's rate, for auto-baud; 0 follows BRR
+} usart_model_t;
+
+// In the order of the K_USART regions, which is also the order of their
+// DCKCFGR2 clock selection fields. RX pins as the Nucleo-144 uses them
+// (USART3 on PD9, the ST-LINK virtual COM port), else the first choice
+// in the datasheet's alternate function table.
+#define USART_MODEL(REGS, IRQN, HANDLER, HZ, PORT, PIN) \
+  { REGS, IRQN, HANDLER, HZ, PORT, PIN, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, NULL, 0, 0, 0, 0 }
+static usart_model_t usarts[] = {
+  USART_MODEL(&sim_USART1, USART1_IRQn, USART1_IRQHandler, &sim_pclk2_hz, 1, 15),
+  USART_MODEL(&sim_USART2, USART2_IRQn, USART2_IRQHandler, &sim_pclk1_hz, 3, 6),
+  USART_MODEL(&sim_USART3, USART3_IRQn, USART3_IRQHandler, &sim_pclk1_hz, 3, 9),
+  USART_MODEL(&sim_UART4,  UART4_IRQn,  UART4_IRQHandler,  &sim_pclk1_hz, 2, 11),
+  USART_MODEL(&sim_UART5,  UART5_IRQn,  UART5_IRQHandler,  &sim_pclk1_hz, 3, 2),
+  USART_MODEL(&sim_USART6, USART6_IRQn, USART6_IRQHandler, &sim_pclk2_hz, 2, 7),
+  USART_MODEL(&sim_UART7,  UART7_IRQn,  UART7_IRQHandler,  &sim_pclk1_hz, 4, 7),
+  USART_MODEL(&sim_UART8,  UART8_IRQn,  UART8_IRQHandler,  &sim_pclk1_hz, 4, 0),
+};
+#define NUM_USARTS (sizeof(usarts) / sizeof(usarts[0]))
+
+// DCKCFGR2: 00 the APB clock, 01 SYSCLK, 10 HSI, 11 LSE. RM0410 Rev 5 Sec 5.3.28
+static uint64_t usart_kernel_hz(const usart_model_t *u) {
+  unsigned sel = (sim_RCC.DCKCFGR2.v >> (2U * (unsigned)(u - usarts))) & 3U;
+  switch (sel) {
+  case 1: return sysclk_hz;
+  case 2: return 16000000UL;
+  case 3: return 32768UL;
+  default: return *u->pclk_hz;
+  }
+}
+
+static usart_model_t *usart_model(const USART_TypeDef *regs) {
+  for (unsigned i = 0; i < NUM_USARTS; i++) {
+    if (usarts[i].regs == regs) return &usarts[i];
+  }
+  return NULL;
+}
+
+uint64_t sim_usart_frame_cycles(USART_TypeDef *usart) {
+  usart_model_t *u = usart_model(usart);
+  uint32_t cr1 = usart->CR1.v;
+  uint32_t brr = usart->BRR.v & 0xFFFFUL;
+  int over8 = (cr1 & USART_CR1_OVER8) != 0;
+
+  // USARTDIV: with OVER8 the low nibble is stored shifted right by one
+  uint64_t div = over8 ? ((brr & 0xFFF0UL) | ((brr & 0x7UL) << 1)) : brr;
+  if (div < 16) div = 16;
+
+  // Frame length in half bits: start + data + stop
+  uint64_t data = 8;
+  if (cr1 & USART_CR1_M0) data = 9;
+  else if (cr1 & USART_CR1_M1) data = 7;
+  static const uint64_t stop_halves[4] = { 2, 1, 4, 3 };
+  uint64_t halves = 2 * (1 + data) + stop_halves[(usart->CR2.v & USART_CR2_STOP) >> USART_CR2_STOP_Pos];
+
+  // Kernel clocks per bit: USARTDIV, or USARTDIV / 2 with OVER8
+  uint64_t kernel = div * halves / (over8 ? 4U : 2U);
+  return kernel * sim_core_hz / usart_kernel_hz(u);
+}
+
+static void dma_service(uint64_t t);
+
+// The rate BRR gives
+static uint64_t usart_baud(const usart_model_t *u) {
+  uint64_t frame = sim_usart_frame_cycles(u->regs);
+  uint64_t bits = 10; // Near enough for 8N1 comparisons
+  return frame ? bits * sim_core_hz / frame : 0;
+}
+
+/* Auto-baud, RM0410 Rev 5 Sec 34.5.6: the character that has just come in
+   was timed. ABRMOD 00 needs its first data bit 1, 01 the first two bits
+   10, 10 the character 0x7F and 11 0x55; otherwise ABRE, and BRR stays.
+   Either way ABRF, until RQR ABRRQ asks again. A character sent at a rate
+   more than 2% from ours arrives garbled, with FE. */
+static void usart_autobaud(usart_model_t *u) {
+  USART_TypeDef *r = u->regs;
+  uint32_t mode = (r->CR2.v & USART_CR2_ABRMOD) >> USART_CR2_ABRMOD_Pos;
+  uint32_t c = u->rx_data & 0xFFU;
+  int ok = mode == 0 ? (c & 1U) != 0 : mode == 1 ? (c & 3U) == 1U : mode == 2 ? c == 0x7FU : c == 0x55U;
+  uint64_t ours = usart_baud(u);
+  uint64_t far = u->far_baud ? u->far_baud : ours;
+
+  if (ok) {
+    uint64_t k = usart_kernel_hz(u) * ((r->CR1.v & USART_CR1_OVER8) ? 2U : 1U);
+    uint64_t div = (k + far / 2U) / far;
+    if (div < 16 || div > 0xFFFF) {
+      ok = 0;
+    } else {
+      r->BRR.v = (r->CR1.v & USART_CR1_OVER8) ? (uint32_t)((div & 0xFFF0U) | ((div & 0xFU) >> 1))
+                                               : (uint32_t)div;
+    }
+  }
+  if (!ok) {
+    r->ISR.v |= USART_ISR_ABRE;
+    if (far * 50U > ours * 51U || far * 51U < ours * 50U) {
+      r->ISR.v |= USART_ISR_FE;
+      u->rx_data ^= 0xA5U;
+    }
+  }
+  r->ISR.v |= USART_ISR_ABRF;
+}
+
+// Hardware (or DMA) puts a byte in TDR at time t
+static void usart_load_tdr(usart_model_t *u, uint16_t data, uint64_t t) {
+  USART_TypeDef *r = u->regs;
+  if (!(r->CR1.v & USART_CR1_UE) || !(r->CR1.v & USART_CR1_TE)) return;
+
+  if (!u->shifting) {
+    // Straight through to the shift register; TXE stays set
+    u->shifting = 1;
+    u->shift_data = data;
+    u->shift_end = t + sim_usart_frame_cycles(r);
+    r->ISR.v |= USART_ISR_TXE;
+  } else {
+    u->tdr = data;
+    u->tdr_full = 1;
+    r->ISR.v &= ~USART_ISR_TXE;
+  }
+  r->ISR.v &= ~USART_ISR_TC;
+}
+
+static void usart_step(usart_model_t *u, uint64_t now) {
+  USART_TypeDef *r = u->regs;
+
+  for (;;) {
+    uint64_t t_tx = u->shifting ? u->shift_end : UINT64_MAX;
+    uint64_t t_rx = u->rx_busy ? u->rx_done : (u->source ? u->rx_poll : UINT64_MAX);
+    uint64_t t = t_tx < t_rx ? t_tx : t_rx;
+    if (t > now) break;
+
+    if (t == t_tx) {
+      u->tx_count++;
+      if (u->sink) u->sink(r, (uint8_t)u->shift_data);
+      if (u->tdr_full) {
+        u->tdr_full = 0;
+        u->shift_data = u->tdr;
+        u->shift_end = t + sim_usart_frame_cycles(r);
+        r->ISR.v |= USART_ISR_TXE;
+        dma_service(t);
+      } else {
+        u->shifting = 0;
+        r->ISR.v |= USART_ISR_TC;
+      }
+    } else if (u->rx_busy) {
+      u->rx_busy = 0;
+      u->rx_poll = t;
+      if ((r->CR2.v & USART_CR2_ABREN) && !(r->ISR.v & USART_ISR_ABRF)) usart_autobaud(u);
+      if (r->ISR.v & USART_ISR_RXNE) {
+        if (!(r->CR3.v & USART_CR3_OVRDIS)) r->ISR.v |= USART_ISR_ORE;
+      } else {
+        r->RDR.v = u->rx_data;
+        r->ISR.v |= USART_ISR_RXNE;
+        u->rx_count++;
+        dma_service(t);
+      }
+    } else {
+      // Poll the source; a byte offered now finishes arriving one frame later
+      int c = -1;
+      uint32_t on = USART_CR1_UE | USART_CR1_RE;
+      if ((r->CR1.v & on) == on) c = u->source(r);
+      if (c >= 0) {
+        if (u->rx_port >= 0) {
+          gpio_set_input((unsigned)u->rx_port, u->rx_pin, 0); // Start bit
+          gpio_set_input((unsigned)u->rx_port, u->rx_pin, 1);
+        }
+        u->rx_busy = 1;
+        u->rx_data = (uint16_t)c;
+        u->rx_done = t + sim_usart_frame_cycles(r);
+      } else {
+        u->rx_poll = t + sim_usart_frame_cycles(r);
+      }
+    }
+  }
+}
+
+static uint32_t usart_read(usart_model_t *u, uint32_t off) {
+  USART_TypeDef *r = u->regs;
+  if (off == offsetof(USART_TypeDef, RDR)) {
+    r->ISR.v &= ~USART_ISR_RXNE;
+    return r->RDR.v;
+  }
+  return ((sim_reg *)((uint8_t *)r + off))->v;
+}
+
+static void usart_write(usart_model_t *u, uint32_t off, uint32_t v) {
+  USART_TypeDef *r = u->regs;
+
+  switch (off) {
+  case offsetof(USART_TypeDef, TDR):
+    r->TDR.v = v & USART_TDR_TDR;
+    usart_load_tdr(u, (uint16_t)(v & USART_TDR_TDR), sim_count.cycles);
+    break;
+  case offsetof(USART_TypeDef, ICR):
+    r->ISR.v &= ~(v & (USART_ICR_PECF | USART_ICR_FECF | USART_ICR_NCF |
+                       USART_ICR_ORECF | USART_ICR_IDLECF | USART_ICR_TCCF));
+    break;
+  case offsetof(USART_TypeDef, RQR):
+    if (v & USART_RQR_ABRRQ) r->ISR.v &= ~(USART_ISR_ABRF | USART_ISR_ABRE);
+    if (v & USART_RQR_RXFRQ) r->ISR.v &= ~USART_ISR_RXNE;
+    if (v & USART_RQR_TXFRQ) { u->tdr_full = 0; r->ISR.v |= USART_ISR_TXE; }
+    break;
+  case offsetof(USART_TypeDef, ISR):
+  case offsetof(USART_TypeDef, RDR):
+    break; // Read only
+  case offsetof(USART_TypeDef, CR1):
+    r->CR1.v = v;
+    // TEACK/REACK follow TE/RE once the USART is enabled
+    r->ISR.v &= ~(USART_ISR_TEACK | USART_ISR_REACK);
+    if (v & USART_CR1_UE) {
+      if (v & USART_CR1_TE) r->ISR.v |= USART_ISR_TEACK;
+      if (v & USART_CR1_RE) r->ISR.v |= USART_ISR_REACK;
+    }
+    break;
+  default:
+    ((sim_reg *)((uint8_t *)r + off))->v = v;
+    break;
+  }
+}
+
+static int usart_irq_level(const usart_model_t *u) {
+  uint32_t cr1 = u->regs->CR1.v, cr3 = u->regs->CR3.v, isr = u->regs->ISR.v;
+  return ((cr1 & USART_CR1_TXEIE)  && (isr & USART_ISR_TXE)) ||
+         ((cr1 & USART_CR1_TCIE)   && (isr & USART_ISR_TC)) ||
+         ((cr1 & USART_CR1_RXNEIE) && (isr & (USART_ISR_RXNE | USART_ISR_ORE))) ||
+         ((cr1 & USART_CR1_IDLEIE) && (isr & USART_ISR_IDLE)) ||
+         ((cr1 & USART_CR1_PEIE)   && (isr & USART_ISR_PE)) ||
+         ((cr3 & USART_CR3_EIE)    && (isr & (USART_ISR_FE | USART_ISR_NE | USART_ISR_ORE)));
+}
+
+void sim_usart_set_tx_sink(USART_TypeDef *usart, sim_tx_sink_t sink) {
+  usart_model(usart)->sink = sink;
+}
+
+void sim_usart_set_far_baud(USART_TypeDef *usart, uint32_t baud) {
+  usart_model(usart)->far_baud = baud;
+}
+
+void sim_usart_set_rx_source(USART_TypeDef *usart, sim_rx_source_t source) {
+  usart_model_t *u = usart_model(usart);
+  u->source = source;
+  u->rx_poll = sim_count.cycles;
+}
+
+uint64_t sim_usart_tx_count(USART_TypeDef *usart) {
+  return usart_model(usart)->tx_count;
+}
+
+uint64_t sim_usart_rx_count(USART_TypeDef *usart) {
+  return usart_model(usart)->rx_count;
+}
+
+uint64_t sim_usart_rx_lost(USART_TypeDef *usart) {
+  return usart_model(usart)->rx_lost;
+}
+
+
+/* ----------------------------------------------------------------------
+ * DMA: memory <-> USART transfers, paced by TXE/RXNE
+ */
+
+typedef struct {
+  sim_dma_block *block;
+  IRQn_Type irq[8];
+  uint32_t pos[8];   // Items moved since the stream was enabled
+  uint32_t total[8]; // NDTR at enable, for circular reload and half transfer
+} dma_model_t;
+
+static dma_model_t dmas[] = {
+  { &sim_DMA1,
+    { (IRQn_Type)11, (IRQn_Type)12, (IRQn_Type)13, (IRQn_Type)14,
+      (IRQn_Type)15, (IRQn_Type)16, (IRQn_Type)17, (IRQn_Type)47 }, { 0 }, { 0 } },
+  { &sim_DMA2,
+    { (IRQn_Type)56, (IRQn_Type)57, (IRQn_Type)58, (IRQn_Type)59,
+      (IRQn_Type)60, (IRQn_Type)68, (IRQn_Type)69, (IRQn_Type)70 }, { 0 }, { 0 } },
+};
+#define NUM_DMAS (sizeof(dmas) / sizeof(dmas[0]))
+
+static const unsigned dma_flag_shift[4] = { 0, 6, 16, 22 };
+#define DMA_FLAG_TE 3U
+#define DMA_FLAG_HT 4U
+#define DMA_FLAG_TC 5U
+
+static sim_reg *dma_isr(dma_model_t *d, unsigned s) {
+  return s < 4 ? &d->block->regs.LISR : &d->block->regs.HISR;
+}
+
+static void dma_flag(dma_model_t *d, unsigned s, unsigned flag) {
+  dma_isr(d, s)->v |= 1UL << (dma_flag_shift[s & 3U] + flag);
+}
+
+// One item moved: count it and handle half/complete
+static void dma_advance(dma_model_t *d, unsigned s) {
+  DMA_Stream_TypeDef *st = &d->block->stream[s];
+  d->pos[s]++;
+  st->NDTR.v--;
+  if (st->NDTR.v == d->total[s] / 2U) dma_flag(d, s, DMA_FLAG_HT);
+  if (st->NDTR.v == 0) {
+    dma_flag(d, s, DMA_FLAG_TC);
+    if (st->CR.v & (DMA_SxCR_CIRC | DMA_SxCR_DBM)) {
+      st->NDTR.v = d->total[s];
+      d->pos[s] = 0;
+      if (st->CR.v & DMA_SxCR_DBM) st->CR.v ^= DMA_SxCR_CT;
+    } else {
+      st->CR.v &= ~DMA_SxCR_EN;
+    }
+  }
+}
+
+static uint8_t *dma_mem(dma_model_t *d, unsigned s) {
+  DMA_Stream_TypeDef *st = &d->block->stream[s];
+  uint32_t base = (st->CR.v & DMA_SxCR_CT) ? st->M1AR.v : st->M0AR.v;
+  uint32_t size = 1UL << ((st->CR.v & DMA_SxCR_MSIZE) >> DMA_SxCR_MSIZE_Pos);
+  uint32_t off = (st->CR.v & DMA_SxCR_MINC) ? d->pos[s] * size : 0;
+  // Only works for buffers below 4GB: the host build links with -no-pie
+  return (uint8_t *)(uintptr_t)(base + off);
+}
+
+static void dma_service(uint64_t t) {
+  for (unsigned i = 0; i < NUM_DMAS; i++) {
+    dma_model_t *d = &dmas[i];
+    for (unsigned s = 0; s < 8; s++) {
+      DMA_Stream_TypeDef *st = &d->block->stream[s];
+      if (!(st->CR.v & DMA_SxCR_EN)) continue;
+
+      for (unsigned n = 0; n < NUM_USARTS; n++) {
+        usart_model_t *u = &usarts[n];
+        USART_TypeDef *r = u->regs;
+        uint32_t dir = st->CR.v & DMA_SxCR_DIR;
+
+        if (dir == DMA_SxCR_DIR_0 && st->PAR.v == (uint32_t)(uintptr_t)&r->TDR) {
+          while ((st->CR.v & DMA_SxCR_EN) && (r->CR3.v & USART_CR3_DMAT) &&
+                 (r->ISR.v & USART_ISR_TXE) && (r->CR1.v & USART_CR1_TE)) {
+            usart_load_tdr(u, *dma_mem(d, s), t);
+            dma_advance(d, s);
+          }
+        } else if (dir == 0 && st->PAR.v == (uint32_t)(uintptr_t)&r->RDR) {
+          if ((r->CR3.v & USART_CR3_DMAR) && (r->ISR.v & USART_ISR_RXNE)) {
+            *dma_mem(d, s) = (uint8_t)r->RDR.v;
+            r->ISR.v &= ~USART_ISR_RXNE;
+            dma_advance(d, s);
+          }
+        }
+      }
+    }
+  }
+}
+
+// A peripheral (a timer update) asks stream s on channel chan for one
+// item at time t: memory to a GPIO or plain register, or a GPIO port's
+// IDR or a plain register to memory. Items are MSIZE; PSIZE must match,
+// as there is no FIFO to pack them.
+static void dma_request(dma_model_t *d, unsigned s, uint32_t chan, uint64_t t) {
+  DMA_Stream_TypeDef *st = &d->block->stream[s];
+  uint32_t cr = st->CR.v;
+  uint32_t dir = cr & DMA_SxCR_DIR;
+  if (!(cr & DMA_SxCR_EN) || ((cr & DMA_SxCR_CHSEL) >> DMA_SxCR_CHSEL_Pos) != chan ||
+      (dir != DMA_SxCR_DIR_0 && dir != 0)) {
+    return;
+  }
+
+  uint8_t *m = dma_mem(d, s);
+  uint32_t size = 1UL << ((cr & DMA_SxCR_MSIZE) >> DMA_SxCR_MSIZE_Pos);
+  uint32_t off;
+  const region_t *rg = find_region((void *)(uintptr_t)st->PAR.v, &off);
+
+  if (dir == 0) {
+    uint32_t v;
+    if (rg->kind == K_GPIO && off == offsetof(GPIO_TypeDef, IDR)) {
+      gpio_step(ns_of(t)); // Inputs scheduled up to the sample
+      v = gpio_idr(rg->index, ns_of(t));
+    } else if (rg->kind == K_PLAIN) {
+      v = ((sim_reg *)(uintptr_t)st->PAR.v)->v;
+    } else {
+      fprintf(stderr, "sim: request-paced DMA from that peripheral is not modelled\n");
+      abort();
+    }
+    if (size == 4) *(uint32_t *)m = v;
+    else if (size == 2) *(uint16_t *)m = (uint16_t)v;
+    else *m = (uint8_t)v;
+    dma_advance(d, s);
+    return;
+  }
+
+  uint32_t v = size == 4 ? *(const uint32_t *)m : size == 2 ? *(const uint16_t *)m : *m;
+  if (rg->kind == K_GPIO) {
+    gpio_write(rg->index, off, v, t);
+  } else if (rg->kind == K_PLAIN) {
+    ((sim_reg *)(uintptr_t)st->PAR.v)->v = v;
+  } else {
+    fprintf(stderr, "sim: request-paced DMA to that peripheral is not modelled\n");
+    abort();
+  }
+  dma_advance(d, s);
+}
+
+static uint32_t dma_read(dma_model_t *d, uint32_t off) {
+  return ((sim_reg *)((uint8_t *)d->block + off))->v;
+}
+
+static void dma_write(dma_model_t *d, uint32_t off, uint32_t v) {
+  sim_dma_block *b = d->block;
+
+  if (off == offsetof(DMA_TypeDef, LIFCR)) { b->regs.LISR.v &= ~v; return; }
+  if (off == offsetof(DMA_TypeDef, HIFCR)) { b->regs.HISR.v &= ~v; return; }
+  if (off < sizeof(DMA_TypeDef)) return; // LISR/HISR are read only
+
+  unsigned s = (off - sizeof(DMA_TypeDef)) / sizeof(DMA_Stream_TypeDef);
+  uint32_t reg = (off - sizeof(DMA_TypeDef)) % sizeof(DMA_Stream_TypeDef);
+  DMA_Stream_TypeDef *st = &b->stream[s];
+
+  if ((reg == offsetof(DMA_Stream_TypeDef, M0AR) || reg == offsetof(DMA_Stream_TypeDef, M1AR)) &&
+      (st->CR.v & DMA_SxCR_EN)) {
+    // Only the memory address not in use may change, in double-buffer
+    // mode; writing the one in use is a transfer error. RM0410 Rev 5 Sec 8.3.10
+    if (!(st->CR.v & DMA_SxCR_DBM)) return;
+    uint32_t in_use = (st->CR.v & DMA_SxCR_CT) ? offsetof(DMA_Stream_TypeDef, M1AR)
+                                               : offsetof(DMA_Stream_TypeDef, M0AR);
+    if (reg == in_use) {
+      dma_flag(d, s, DMA_FLAG_TE);
+      st->CR.v &= ~DMA_SxCR_EN;
+      return;
+    }
+    ((sim_reg *)((uint8_t *)b + off))->v = v;
+  } else if (reg == offsetof(DMA_Stream_TypeDef, CR)) {
+    uint32_t was = st->CR.v;
+    st->CR.v = v;
+    if (!(was & DMA_SxCR_EN) && (v & DMA_SxCR_EN)) {
+      d->pos[s] = 0;
+      d->total[s] = st->NDTR.v & 0xFFFFUL;
+    } else if ((was & DMA_SxCR_EN) && !(v & DMA_SxCR_EN)) {
+      dma_flag(d, s, DMA_FLAG_TC); // Disabling a running stream completes it
+    }
+  } else {
+    ((sim_reg *)((uint8_t *)b + off))->v = v;
+  }
+  dma_service(sim_count.cycles);
+}
+
+static int dma_irq_level(dma_model_t *d, unsigned s) {
+  uint32_t flags = dma_isr(d, s)->v >> dma_flag_shift[s & 3U];
+  uint32_t cr = d->block->stream[s].CR.v;
+  return ((cr & DMA_SxCR_TCIE) && (flags & (1UL << DMA_FLAG_TC))) ||
+         ((cr & DMA_SxCR_HTIE) && (flags & (1UL << DMA_FLAG_HT))) ||
+         ((cr & DMA_SxCR_TEIE) && (flags & (1UL << DMA_FLAG_TE)));
+}
+
+
+/* ----------------------------------------------------------------------
+ * DWT cycle counter: backed by simulated time
+ */
+
+static uint64_t dwt_base;
+
+static uint32_t dwt_read(uint32_t off) {
+  if (off == offsetof(DWT_Type, CYCCNT)) {
+    if (sim_DWT.CTRL.v & DWT_CTRL_CYCCNTENA_Msk) {
+      sim_DWT.CYCCNT.v = (uint32_t)(sim_count.cycles - dwt_base);
+    }
+    return sim_DWT.CYCCNT.v;
+  }
+  return ((sim_reg *)((uint8_t *)&sim_DWT + off))->v;
+}
+
+static void dwt_write(uint32_t off, uint32_t v) {
+  if (off == offsetof(DWT_Type, CYCCNT)) dwt_base = sim_count.cycles - v;
+  if (off == offsetof(DWT_Type, CTRL) && (v & DWT_CTRL_CYCCNTENA_Msk) &&
+      !(sim_DWT.CTRL.v & DWT_CTRL_CYCCNTENA_Msk)) {
+    dwt_base = sim_count.cycles - sim_DWT.CYCCNT.v; // Resume from where it stopped
+  }
+  ((sim_reg *)((uint8_t *)&sim_DWT + off))->v = v;
+}
+
+
+/* ----------------------------------------------------------------------
+ * RCC and PWR: oscillators, the PLL and over-drive are ready as soon as
+ * they are enabled, and the clock switch takes effect immediately. The
+ * board has its 32.768kHz LSE crystal fitted.
+ * RM0410 Rev 5 Sec 5.3.1-5.3.3, 5.3.21-5.3.22, 4.4.1-4.4.2
+ */
+
+static const uint8_t ahb_shift[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9 };
+static const uint8_t apb_shift[8] = { 0, 0, 0, 0, 1, 2, 3, 4 };
+
+static void rcc_update(void) {
+  uint32_t cr = sim_RCC.CR.v;
+  uint32_t cfgr = sim_RCC.CFGR.v;
+  uint32_t pll = sim_RCC.PLLCFGR.v;
+  uint32_t sysclk = 16000000UL;
+
+  cr = (cr & ~RCC_CR_HSERDY) | ((cr & RCC_CR_HSEON) ? RCC_CR_HSERDY : 0U);
+  cr = (cr & ~RCC_CR_PLLRDY) | ((cr & RCC_CR_PLLON) ? RCC_CR_PLLRDY : 0U);
+  sim_RCC.CR.v = cr;
+  uint32_t bdcr = sim_RCC.BDCR.v, csr = sim_RCC.CSR.v;
+  sim_RCC.BDCR.v = (bdcr & ~RCC_BDCR_LSERDY) | ((bdcr & RCC_BDCR_LSEON) ? RCC_BDCR_LSERDY : 0U);
+  sim_RCC.CSR.v = (csr & ~RCC_CSR_LSIRDY) | ((csr & RCC_CSR_LSION) ? RCC_CSR_LSIRDY : 0U);
+  cfgr = (cfgr & ~RCC_CFGR_SWS) | ((cfgr & RCC_CFGR_SW) << 2);
+  sim_RCC.CFGR.v = cfgr;
+
+  if ((cfgr & RCC_CFGR_SWS) == RCC_CFGR_SWS_HSE) {
+    sysclk = 8000000UL;
+  } else if ((cfgr & RCC_CFGR_SWS) == RCC_CFGR_SWS_PLL) {
+    uint32_t in = (pll & RCC_PLLCFGR_PLLSRC_HSE) ? 8000000UL : 16000000UL;
+    uint32_t m = (pll & RCC_PLLCFGR_PLLM) >> RCC_PLLCFGR_PLLM_Pos;
+    uint32_t n = (pll & RCC_PLLCFGR_PLLN) >> RCC_PLLCFGR_PLLN_Pos;
+    uint32_t p = (((pll & RCC_PLLCFGR_PLLP) >> RCC_PLLCFGR_PLLP_Pos) + 1U) * 2U;
+    if (m) sysclk = (in / m) * n / p;
+  }
+
+  sysclk_hz = sysclk;
+  sim_core_hz = sysclk >> ahb_shift[(cfgr & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos];
+  ns_rebase(sim_core_hz);
+  sim_pclk1_hz = sim_core_hz >> apb_shift[(cfgr & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos];
+  sim_pclk2_hz = sim_core_hz >> apb_shift[(cfgr & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos];
+}
+
+static void pwr_update(void) {
+  uint32_t cr1 = sim_PWR.CR1.v;
+  sim_PWR.CSR1.v = (sim_PWR.CSR1.v & ~(PWR_CSR1_ODRDY | PWR_CSR1_ODSWRDY)) |
+                   ((cr1 & PWR_CR1_ODEN) ? PWR_CSR1_ODRDY : 0U) |
+                   ((cr1 & PWR_CR1_ODSWEN) ? PWR_CSR1_ODSWRDY : 0U);
+}
+
+
+/* ----------------------------------------------------------------------
+ * SysTick and the SCB pending bits
+ * Cortex-M7 PM0253 Rev 5 Sec 4.4 (SysTick) and 4.3.3 (ICSR)
+ *
+ * Core exceptions are kept by exception number (IRQn + 16) alongside
+ * the external interrupts; SysTick and PendSV are pended as edges.
+ */
+
+#define EXC_PENDSV  (PendSV_IRQn + 16)
+#define EXC_SYSTICK (SysTick_IRQn + 16)
+#define SIM_NUM_EXC (SIM_NUM_IRQS + 16)
+
+static uint8_t exc_pending[16];
+static uint64_t st_reload_at; // When the counter last reloaded from LOAD
+static uint64_t st_next;      // When it next reaches zero
+
+static uint64_t systick_period(void) {
+  uint64_t n = (sim_SysTick.LOAD.v & SysTick_LOAD_RELOAD_Msk) + 1U;
+  return (sim_SysTick.CTRL.v & SysTick_CTRL_CLKSOURCE_Msk) ? n : n * 8U;
+}
+
+static void systick_step(uint64_t now) {
+  if (!(sim_SysTick.CTRL.v & SysTick_CTRL_ENABLE_Msk) || now < st_next) return;
+  uint64_t period = systick_period();
+  st_next += ((now - st_next) / period + 1U) * period;
+  st_reload_at = st_next - period;
+  sim_SysTick.CTRL.v |= SysTick_CTRL_COUNTFLAG_Msk;
+  if (sim_SysTick.CTRL.v & SysTick_CTRL_TICKINT_Msk) exc_pending[EXC_SYSTICK] = 1;
+}
+
+static void systick_restart(void) {
+  st_reload_at = sim_count.cycles;
+  st_next = st_reload_at + systick_period();
+}
+
+static uint32_t systick_read(uint32_t off) {
+  if (off == offsetof(SysTick_Type, CTRL)) {
+    uint32_t v = sim_SysTick.CTRL.v;
+    sim_SysTick.CTRL.v &= ~SysTick_CTRL_COUNTFLAG_Msk; // Cleared on read
+    return v;
+  }
+  if (off == offsetof(SysTick_Type, VAL) && (sim_SysTick.CTRL.v & SysTick_CTRL_ENABLE_Msk)) {
+    uint64_t div = (sim_SysTick.CTRL.v & SysTick_CTRL_CLKSOURCE_Msk) ? 1U : 8U;
+    return (uint32_t)((sim_SysTick.LOAD.v & SysTick_LOAD_RELOAD_Msk) -
+                      (sim_count.cycles - st_reload_at) / div);
+  }
+  return ((sim_reg *)((uint8_t *)&sim_SysTick + off))->v;
+}
+
+static void systick_write(uint32_t off, uint32_t v) {
+  uint32_t was = sim_SysTick.CTRL.v & SysTick_CTRL_ENABLE_Msk;
+  if (off == offsetof(SysTick_Type, CTRL)) {
+    sim_SysTick.CTRL.v = (sim_SysTick.CTRL.v & SysTick_CTRL_COUNTFLAG_Msk) | (v & 7U);
+    if (!was && (v & SysTick_CTRL_ENABLE_Msk)) systick_restart();
+    return;
+  }
+  if (off == offsetof(SysTick_Type, VAL)) {
+    // Any write clears the counter and COUNTFLAG; it reloads on the next clock
+    sim_SysTick.VAL.v = 0;
+    sim_SysTick.CTRL.v &= ~SysTick_CTRL_COUNTFLAG_Msk;
+    if (was) systick_restart();
+    return;
+  }
+  ((sim_reg *)((uint8_t *)&sim_SysTick + off))->v = v;
+}
+
+static uint32_t scb_read(uint32_t off) {
+  if (off == offsetof(SCB_Type, ICSR)) {
+    return (exc_pending[EXC_SYSTICK] ? SCB_ICSR_PENDSTSET_Msk : 0U) |
+           (exc_pending[EXC_PENDSV] ? SCB_ICSR_PENDSVSET_Msk : 0U);
+  }
+  return ((sim_reg *)((uint8_t *)&sim_SCB + off))->v;
+}
+
+static void scb_write(uint32_t off, uint32_t v) {
+  if (off == offsetof(SCB_Type, ICSR)) {
+    if (v & SCB_ICSR_PENDSTSET_Msk) exc_pending[EXC_SYSTICK] = 1;
+    if (v & SCB_ICSR_PENDSTCLR_Msk) exc_pending[EXC_SYSTICK] = 0;
+    if (v & SCB_ICSR_PENDSVSET_Msk) exc_pending[EXC_PENDSV] = 1;
+    if (v & SCB_ICSR_PENDSVCLR_Msk) exc_pending[EXC_PENDSV] = 0;
+    return;
+  }
+  ((sim_reg *)((uint8_t *)&sim_SCB + off))->v = v;
+}
+
+
+/* ----------------------------------------------------------------------
+ * Timers, counting up only: TIM6/TIM7 (basic) and the time bases of TIM1
+ * and TIM8. They count up to ARR, then an update event resets the
+ * counter, loads PSC, sets UIF and, with UDE, requests a DMA transfer;
+ * one-pulse mode also clears CEN. TIM1/TIM8's repetition counters and
+ * channels are not modelled. A timer runs from its APB's timer clock, which is PCLK when
+ * the APB is not divided and twice PCLK when it is.
+ * RM0410 Rev 5 Sec 5.2, 28.3-28.4 (basic), 17.3 (TIM1/TIM8)
+ */
+
+typedef struct {
+  TIM_TypeDef *regs;
+  IRQn_Type irq;
+  void (*handler)(void);
+  int apb2;         // On APB2 rather than APB1
+  int dma;          // Update DMA request: dmas[] index, or -1
+  unsigned dma_stream;
+  uint32_t dma_chan;  // RM0410 Rev 5 Sec 8.3.4 Tables 27-28
+  uint32_t psc;     // Prescaler in use: PSC is only taken at an update event
+  uint64_t start;   // Core cycle at which the counter held cnt0
+  uint32_t cnt0;
+  uint64_t update;  // When the counter next overflows, while CEN is set
+} tim_model_t;
+
+// In the order of the K_TIM regions
+static tim_model_t tims[] = {
+  { &sim_TIM6, TIM6_DAC_IRQn,      TIM6_DAC_IRQHandler,      0, 0, 1, 7, 0, 0, 0, 0 },
+  { &sim_TIM7, TIM7_IRQn,          TIM7_IRQHandler,          0, 0, 2, 1, 0, 0, 0, 0 },
+  { &sim_TIM8, TIM8_UP_TIM13_IRQn, TIM8_UP_TIM13_IRQHandler, 1, 1, 1, 7, 0, 0, 0, 0 },
+  { &sim_TIM1, TIM1_UP_TIM10_IRQn, TIM1_UP_TIM10_IRQHandler, 1, 1, 5, 6, 0, 0, 0, 0 },
+};
+#define NUM_TIMS (sizeof(tims) / sizeof(tims[0]))
+
+static uint64_t tim_kernel_hz(const tim_model_t *t) {
+  uint32_t cfgr = sim_RCC.CFGR.v;
+  if (t->apb2) {
+    int divided = (cfgr & RCC_CFGR_PPRE2) >= RCC_CFGR_PPRE2_DIV2;
+    return divided ? 2ULL * sim_pclk2_hz : sim_pclk2_hz;
+  }
+  int divided = (cfgr & RCC_CFGR_PPRE1) >= RCC_CFGR_PPRE1_DIV2;
+  return divided ? 2ULL * sim_pclk1_hz : sim_pclk1_hz;
+}
+
+// An update event at time t
+static void tim_update(tim_model_t *t, uint64_t at) {
+  TIM_TypeDef *r = t->regs;
+  r->SR.v |= TIM_SR_UIF;
+  t->psc = r->PSC.v & 0xFFFFU;
+  if ((r->DIER.v & TIM_DIER_UDE) && t->dma >= 0) dma_request(&dmas[t->dma], t->dma_stream, t->dma_chan, at);
+}
+
+static uint32_t tim_count(const tim_model_t *t, uint64_t now) {
+  if (!(t->regs->CR1.v & TIM_CR1_CEN)) return t->regs->CNT.v;
+  uint64_t n = (now - t->start) * tim_kernel_hz(t) / ((t->psc + 1ULL) * sim_core_hz);
+  return (uint32_t)((t->cnt0 + n) & 0xFFFFU);
+}
+
+// Count from cnt0 at `now`
+static void tim_restart(tim_model_t *t, uint32_t cnt0, uint64_t now) {
+  uint32_t arr = t->regs->ARR.v & 0xFFFFU;
+  t->cnt0 = cnt0;
+  t->start = now;
+  if (arr == 0) {
+    t->update = UINT64_MAX; // The counter is blocked with ARR = 0
+    return;
+  }
+  uint64_t n = cnt0 <= arr ? arr - cnt0 + 1U : 0x10000U - cnt0 + arr + 1U;
+  uint64_t hz = tim_kernel_hz(t);
+  t->update = now + (n * (t->psc + 1ULL) * sim_core_hz + hz - 1U) / hz;
+}
+
+static void tim_step(tim_model_t *t, uint64_t now) {
+  TIM_TypeDef *r = t->regs;
+  while ((r->CR1.v & TIM_CR1_CEN) && t->update <= now) {
+    uint64_t at = t->update;
+    if (!(r->CR1.v & TIM_CR1_UDIS)) tim_update(t, at);
+    r->CNT.v = 0;
+    if (r->CR1.v & TIM_CR1_OPM) r->CR1.v &= ~TIM_CR1_CEN;
+    else tim_restart(t, 0, at);
+  }
+}
+
+// When the CPU next needs to see this timer: at every update, unless
+// all the updates do is feed a DMA stream - then when that stream next
+// raises a flag. DMA requests do not wake the core from WFI.
+static uint64_t tim_next_event(const tim_model_t *t) {
+  const TIM_TypeDef *r = t->regs;
+  if (!(r->CR1.v & TIM_CR1_CEN)) return UINT64_MAX;
+  if ((r->DIER.v & TIM_DIER_UIE) || !(r->DIER.v & TIM_DIER_UDE) || t->dma < 0 ||
+      (r->CR1.v & TIM_CR1_OPM)) {
+    return t->update;
+  }
+  const dma_model_t *d = &dmas[t->dma];
+  const DMA_Stream_TypeDef *st = &d->block->stream[t->dma_stream];
+  uint32_t cr = st->CR.v;
+  if (!(cr & DMA_SxCR_EN) || ((cr & DMA_SxCR_CHSEL) >> DMA_SxCR_CHSEL_Pos) != t->dma_chan) {
+    return t->update;
+  }
+  // Updates until the transfer that completes the block, or half of it
+  uint64_t n = st->NDTR.v;
+  uint32_t half = d->total[t->dma_stream] / 2U;
+  if ((cr & DMA_SxCR_HTIE) && st->NDTR.v > half) n -= half;
+  if (n == 0) return t->update;
+  uint64_t hz = tim_kernel_hz(t);
+  uint64_t period = ((r->ARR.v + 1ULL) * (t->psc + 1ULL) * sim_core_hz + hz - 1U) / hz;
+  return t->update + (n - 1U) * period;
+}
+
+static uint32_t tim_read(tim_model_t *t, uint32_t off) {
+  if (off == offsetof(TIM_TypeDef, CNT)) return tim_count(t, sim_count.cycles);
+  return ((sim_reg *)((uint8_t *)t->regs + off))->v;
+}
+
+static void tim_write(tim_model_t *t, uint32_t off, uint32_t v) {
+  TIM_TypeDef *r = t->regs;
+  uint64_t now = sim_count.cycles;
+  uint32_t cnt = tim_count(t, now);
+
+  switch (off) {
+  case offsetof(TIM_TypeDef, CR1):
+    r->CNT.v = cnt; // Stopping leaves the count where it is
+    r->CR1.v = v;
+    if (v & TIM_CR1_CEN) tim_restart(t, cnt, now);
+    break;
+  case offsetof(TIM_TypeDef, EGR):
+    if (v & TIM_EGR_UG) {
+      // Software update: reset the counter and load PSC. With URS it
+      // sets no UIF and requests no DMA.
+      if (r->CR1.v & TIM_CR1_URS) t->psc = r->PSC.v & 0xFFFFU;
+      else tim_update(t, now);
+      r->CNT.v = 0;
+      if (r->CR1.v & TIM_CR1_CEN) tim_restart(t, 0, now);
+    }
+    break;
+  case offsetof(TIM_TypeDef, SR):
+    r->SR.v &= v; // Write 0 to clear
+    break;
+  case offsetof(TIM_TypeDef, CNT):
+    r->CNT.v = v & 0xFFFFU;
+    if (r->CR1.v & TIM_CR1_CEN) tim_restart(t, r->CNT.v, now);
+    break;
+  case offsetof(TIM_TypeDef, ARR):
+    r->ARR.v = v & 0xFFFFU; // No preload modelled: takes effect at once
+    if (r->CR1.v & TIM_CR1_CEN) tim_restart(t, cnt, now);
+    break;
+  default:
+    ((sim_reg *)((uint8_t *)r + off))->v = v;
+    break;
+  }
+}
+
+static int tim_irq_level(const tim_model_t *t) {
+  return (t->regs->SR.v & TIM_SR_UIF) && (t->regs->DIER.v & TIM_DIER_UIE);
+}
+
+
+/* ----------------------------------------------------------------------
+ * LPTIM1, continuous mode, counting its kernel clock from DCKCFGR2
+ * (PCLK1, LSI, HSI or LSE) divided by the prescaler. It is kept in ns so
+ * that it runs on through core clock changes and Stop mode. CMPM and
+ * ARRM set as the counter reaches CMP and ARR; one that is enabled in IER
+ * also raises EXTI line 23, which can wake the core from Stop. Writes to
+ * CMP and ARR are taken at once (CMPOK and ARROK set straight away), and
+ * ARR should be written before the counter is started.
+ */
+
+#define LPTIM_EXTI_LINE (1UL << 23)
+
+static struct {
+  int running;
+  uint64_t start; // sim_now_ns() when it counted from 0
+  uint64_t seen;  // Counts checked for matches so far
+} lptim;
+
+static uint64_t lptim_hz(void) {
+  switch ((sim_RCC.DCKCFGR2.v & RCC_DCKCFGR2_LPTIM1SEL) >> 24) {
+  case 1: return 32000UL;    // LSI, nominal
+  case 2: return 16000000UL; // HSI
+  case 3: return 32768UL;    // LSE
+  default: return sim_pclk1_hz;
+  }
+}
+
+static uint32_t lptim_shift(void) {
+  return (sim_LPTIM1.CFGR.v & LPTIM_CFGR_PRESC) >> LPTIM_CFGR_PRESC_Pos;
+}
+
+// Counts since the start at time now
+static uint64_t lptim_counts(uint64_t now) {
+  uint64_t d = now - lptim.start, hz = lptim_hz();
+  return (d / NS_PER_S * hz + d % NS_PER_S * hz / NS_PER_S) >> lptim_shift();
+}
+
+// When the count reaches k
+static uint64_t lptim_ns_at(uint64_t k) {
+  uint64_t clocks = k << lptim_shift(), hz = lptim_hz();
+  return lptim.start + clocks / hz * NS_PER_S + (clocks % hz * NS_PER_S + hz - 1U) / hz;
+}
+
+// The first count after `after` at which the counter holds v
+static uint64_t lptim_match(uint32_t v, uint64_t after) {
+  uint64_t period = (sim_LPTIM1.ARR.v & 0xFFFFU) + 1ULL;
+  if (v >= period) return UINT64_MAX;
+  uint64_t k = after - after % period + v;
+  return k > after ? k : k + period;
+}
+
+static void lptim_step(uint64_t now) {
+  if (!lptim.running) return;
+  uint64_t n = lptim_counts(now);
+  if (n <= lptim.seen) return;
+  uint32_t was = sim_LPTIM1.ISR.v;
+  if (lptim_match(sim_LPTIM1.CMP.v & 0xFFFFU, lptim.seen) <= n) sim_LPTIM1.ISR.v |= LPTIM_ISR_CMPM;
+  if (lptim_match(sim_LPTIM1.ARR.v & 0xFFFFU, lptim.seen) <= n) sim_LPTIM1.ISR.v |= LPTIM_ISR_ARRM;
+  lptim.seen = n;
+  uint32_t raised = sim_LPTIM1.ISR.v & ~was & sim_LPTIM1.IER.v;
+  if (raised && (sim_EXTI.RTSR.v & LPTIM_EXTI_LINE)) sim_EXTI.PR.v |= LPTIM_EXTI_LINE;
+}
+
+// In ns: the next match that can raise an interrupt
+static uint64_t lptim_next_event(void) {
+  if (!lptim.running) return UINT64_MAX;
+  uint64_t k = UINT64_MAX;
+  if (sim_LPTIM1.IER.v & LPTIM_IER_CMPMIE) k = lptim_match(sim_LPTIM1.CMP.v & 0xFFFFU, lptim.seen);
+  if (sim_LPTIM1.IER.v & LPTIM_IER_ARRMIE) {
+    uint64_t a = lptim_match(sim_LPTIM1.ARR.v & 0xFFFFU, lptim.seen);
+    if (a < k) k = a;
+  }
+  return k == UINT64_MAX ? k : lptim_ns_at(k);
+}
+
+static uint32_t lptim_read(uint32_t off) {
+  if (off == offsetof(LPTIM_TypeDef, CNT)) {
+    if (!lptim.running) return 0;
+    uint64_t period = (sim_LPTIM1.ARR.v & 0xFFFFU) + 1ULL;
+    return (uint32_t)(lptim_counts(sim_now_ns()) % period);
+  }
+  return ((sim_reg *)((uint8_t *)&sim_LPTIM1 + off))->v;
+}
+
+static void lptim_write(uint32_t off, uint32_t v) {
+  switch (off) {
+  case offsetof(LPTIM_TypeDef, ICR):
+    sim_LPTIM1.ISR.v &= ~v;
+    break;
+  case offsetof(LPTIM_TypeDef, CR):
+    if (v & LPTIM_CR_SNGSTRT) {
+      fprintf(stderr, "sim: LPTIM one-shot mode is not modelled\n");
+      abort();
+    }
+    sim_LPTIM1.CR.v = v & LPTIM_CR_ENABLE;
+    if (!(v & LPTIM_CR_ENABLE)) {
+      lptim.running = 0;
+    } else if ((v & LPTIM_CR_CNTSTRT) && !lptim.running) {
+      lptim.running = 1;
+      lptim.start = sim_now_ns();
+      lptim.seen = 0;
+    }
+    break;
+  case offsetof(LPTIM_TypeDef, CMP):
+    sim_LPTIM1.CMP.v = v & 0xFFFFU;
+    sim_LPTIM1.ISR.v |= LPTIM_ISR_CMPOK;
+    break;
+  case offsetof(LPTIM_TypeDef, ARR):
+    sim_LPTIM1.ARR.v = v & 0xFFFFU;
+    sim_LPTIM1.ISR.v |= LPTIM_ISR_ARROK;
+    break;
+  case offsetof(LPTIM_TypeDef, ISR):
+  case offsetof(LPTIM_TypeDef, CNT):
+    break; // Read only
+  default:
+    ((sim_reg *)((uint8_t *)&sim_LPTIM1 + off))->v = v;
+    break;
+  }
+}
+
+static int lptim_irq_level(void) {
+  return (sim_LPTIM1.ISR.v & sim_LPTIM1.IER.v & (LPTIM_ISR_CMPM | LPTIM_ISR_ARRM)) != 0;
+}
+
+
+/* ----------------------------------------------------------------------
+ * CRC unit: 32-bit words only, done by the time of the next access. DR.v
+ * holds the CRC register itself, before any REV_OUT reversal.
+ */
+
+static uint32_t bit_reverse(uint32_t v) {
+  uint32_t r = 0;
+  for (unsigned i = 0; i < 32; i++, v >>= 1) r = (r << 1) | (v & 1U);
+  return r;
+}
+
+static uint32_t crc_read(uint32_t off) {
+  if (off == offsetof(CRC_TypeDef, DR)) {
+    return (sim_CRC.CR.v & CRC_CR_REV_OUT) ? bit_reverse(sim_CRC.DR.v) : sim_CRC.DR.v;
+  }
+  return ((sim_reg *)((uint8_t *)&sim_CRC + off))->v;
+}
+
+static void crc_write(uint32_t off, uint32_t v) {
+  if (off == offsetof(CRC_TypeDef, DR)) {
+    // REV_IN: 01 reverses the bits of each byte, 10 of each half-word, 11 the word
+    uint32_t rev = (sim_CRC.CR.v & CRC_CR_REV_IN) >> 5;
+    if (rev) {
+      v = bit_reverse(v);
+      if (rev == 1U) v = __builtin_bswap32(v);
+      if (rev == 2U) v = (v >> 16) | (v << 16);
+    }
+    uint32_t crc = sim_CRC.DR.v ^ v;
+    for (unsigned i = 0; i < 32; i++) crc = (crc << 1) ^ ((crc & 0x80000000UL) ? sim_CRC.POL.v : 0U);
+    sim_CRC.DR.v = crc;
+  } else if (off == offsetof(CRC_TypeDef, CR)) {
+    if (v & CRC_CR_RESET) sim_CRC.DR.v = sim_CRC.INIT.v;
+    sim_CRC.CR.v = v & ~CRC_CR_RESET;
+  } else {
+    ((sim_reg *)((uint8_t *)&sim_CRC + off))->v = v;
+  }
+}
+
+
+/* ----------------------------------------------------------------------
+ * Flash: RM0410 Rev 5 Sec 3.3, dual-bank mode only.
+ *
+ * The 2MB lives in a memfd. Both banks are mapped read-only at
+ * FLASHAXI_BASE, in the order SYSCFG->MEMRMP SWP_FB says, and the whole
+ * of it again read-write at flash_mem, in physical order, for the model.
+ * A store from the code faults; the SIGSEGV handler keeps a copy of the
+ * page and lets the store through. The next register access (step())
+ * finds what changed against the copy and puts it through the
+ * controller: with PG set and the right PSIZE it becomes old & new and
+ * keeps the flash busy, otherwise it is undone and flagged.
+ */
+
+#define FLASH_SIZE      (2UL << 20)
+#define FLASH_BANK      (1UL << 20)
+#define FLASH_PAGE      4096UL
+#define FLASH_MAX_DIRTY 16U
+#define FLASH_KEY1      0x45670123UL
+#define FLASH_KEY2      0xCDEF89ABUL
+#define FLASH_OPTCR_RESET 0xFFFFAAEDUL // RM0410 Rev 5 Sec 3.7.6: nDBANK set
+#define FLASH_SR_ERRORS (FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_ERSERR)
+
+extern void FLASH_IRQHandler(void) __attribute__((weak));
+
+static uint8_t *const flash_view = (uint8_t *)FLASHAXI_BASE;
+
+static struct {
+  int fd;
+  uint8_t *mem;          // Read-write, physical order
+  int dual;              // nDBANK clear
+  int swapped;           // How flash_view is mapped now
+  int keys;              // Unlock sequence: 0, 1 after KEY1, -1 locked until reset
+  int busy;
+  uint64_t busy_until;   // sim_now_ns()
+  uint64_t erases, programs;
+  unsigned dirty;
+  uint8_t *dirty_page[FLASH_MAX_DIRTY];
+  uint8_t shadow[FLASH_MAX_DIRTY][FLASH_PAGE];
+} flash;
+
+static void flash_fault(int sig, siginfo_t *si, void *uc) {
+  (void)uc;
+  uint8_t *a = (uint8_t *)si->si_addr;
+  if (sig != SIGSEGV || a < flash_view || a >= flash_view + FLASH_SIZE || flash.dirty == FLASH_MAX_DIRTY) {
+    signal(SIGSEGV, SIG_DFL); // A real crash: let it happen again, unhandled
+    return;
+  }
+  uint8_t *page = flash_view + ((uintptr_t)(a - flash_view) & ~(FLASH_PAGE - 1U));
+  memcpy(flash.shadow[flash.dirty], page, FLASH_PAGE);
+  flash.dirty_page[flash.dirty++] = page;
+  mprotect(page, FLASH_PAGE, PROT_READ | PROT_WRITE);
+}
+
+// Put the two banks at FLASHAXI_BASE, bank 2 first if swapped
+static void flash_map(int swapped) {
+  for (unsigned half = 0; half < 2; half++) {
+    off_t off = (off_t)((half ^ (unsigned)swapped) * FLASH_BANK);
+    void *at = flash_view + half * FLASH_BANK;
+    int fixed = flash.mem ? MAP_FIXED : MAP_FIXED_NOREPLACE;
+    if (mmap(at, FLASH_BANK, PROT_READ, MAP_SHARED | fixed, flash.fd, off) != at) {
+      fprintf(stderr, "sim: cannot map flash at %p\n", at);
+      abort();
+    }
+  }
+  flash.swapped = swapped;
+}
+
+static void flash_open(void) {
+  flash.fd = memfd_create("sim-flash", 0);
+  if (flash.fd < 0 || ftruncate(flash.fd, FLASH_SIZE) < 0) {
+    fprintf(stderr, "sim: cannot make the flash memory\n");
+    abort();
+  }
+  flash_map(0);
+  flash.mem = (uint8_t *)mmap(NULL, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, flash.fd, 0);
+  if (flash.mem == MAP_FAILED) abort();
+  memset(flash.mem, 0xFF, FLASH_SIZE);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = flash_fault;
+  sa.sa_flags = SA_SIGINFO;
+  sigaction(SIGSEGV, &sa, NULL);
+}
+
+// Physical address in flash.mem of an address in flash_view
+static uint8_t *flash_phys(const uint8_t *view) {
+  uintptr_t off = (uintptr_t)(view - flash_view);
+  return flash.mem + (off ^ (flash.swapped ? FLASH_BANK : 0U));
+}
+
+static void flash_done(void) {
+  flash.busy = 0;
+  sim_FLASH.SR.v &= ~FLASH_SR_BSY;
+  sim_FLASH.CR.v &= ~FLASH_CR_STRT;
+  if (sim_FLASH.CR.v & FLASH_CR_EOPIE) sim_FLASH.SR.v |= FLASH_SR_EOP;
+}
+
+static void flash_step(uint64_t now) {
+  if (flash.busy && now >= flash.busy_until) flash_done();
+}
+
+// A new operation while one is running stalls the bus until it is over
+static void flash_start(uint64_t ns) {
+  if (flash.busy) {
+    uint64_t t = cycles_at(flash.busy_until);
+    if (t > sim_count.cycles) sim_count.cycles = t;
+    flash_done();
+  }
+  flash.busy = 1;
+  flash.busy_until = sim_now_ns() + ns;
+  sim_FLASH.SR.v |= FLASH_SR_BSY;
+}
+
+static void flash_error(uint32_t err) {
+  sim_FLASH.SR.v |= err;
+  if (sim_FLASH.CR.v & FLASH_CR_ERRIE) sim_FLASH.SR.v |= FLASH_SR_OPERR;
+}
+
+// The code changed a word from old to new
+static void flash_store(uint8_t *view, uint32_t old, uint32_t v) {
+  uint32_t cr = sim_FLASH.CR.v;
+  uint32_t *w = (uint32_t *)flash_phys(view);
+  if ((cr & FLASH_CR_LOCK) || !(cr & FLASH_CR_PG) || (cr & (FLASH_CR_SER | FLASH_CR_MER))) {
+    *w = old;
+    flash_error(FLASH_SR_ERSERR);
+  } else if ((cr & FLASH_CR_PSIZE) != FLASH_CR_PSIZE_1) {
+    *w = old;
+    flash_error(FLASH_SR_PGPERR);
+  } else {
+    flash_start(SIM_FLASH_PROGRAM_NS);
+    *w = old & v; // Programming only clears bits
+    flash.programs++;
+  }
+}
+
+// Put the code's stores since the last look through the controller
+static void flash_sync(void) {
+  for (unsigned i = 0; i < flash.dirty; i++) {
+    uint32_t *now = (uint32_t *)flash.dirty_page[i];
+    const uint32_t *was = (const uint32_t *)flash.shadow[i];
+    for (unsigned k = 0; k < FLASH_PAGE / 4U; k++) {
+      if (now[k] != was[k]) flash_store((uint8_t *)&now[k], was[k], now[k]);
+    }
+    mprotect(flash.dirty_page[i], FLASH_PAGE, PROT_READ);
+  }
+  flash.dirty = 0;
+}
+
+// Sector sizes in a bank, dual-bank mode: RM0410 Rev 5 Sec 3.3.1 Table 4
+static uint32_t flash_sector(uint32_t n, uint32_t *size) {
+  static const uint32_t kb[12] = { 16, 16, 16, 16, 64, 128, 128, 128, 128, 128, 128, 128 };
+  uint32_t off = 0;
+  for (uint32_t i = 0; i < n; i++) off += kb[i] * 1024U;
+  *size = kb[n] * 1024U;
+  return off;
+}
+
+static void flash_erase(uint32_t cr) {
+  uint32_t snb = (cr & FLASH_CR_SNB) >> FLASH_CR_SNB_Pos;
+  uint32_t n = snb & 0xFU, size;
+  if (!flash.dual) {
+    fprintf(stderr, "sim: only dual-bank flash is modelled\n");
+    abort();
+  }
+  if (n > 11U || (snb & 0x10U) != (snb & ~0xFU)) {
+    flash_error(FLASH_SR_ERSERR);
+    return;
+  }
+  uint32_t off = flash_sector(n, &size) + (snb & 0x10U ? FLASH_BANK : 0U);
+  flash_start(size == 16384U ? SIM_FLASH_ERASE_16K_NS :
+              size == 65536U ? SIM_FLASH_ERASE_64K_NS : SIM_FLASH_ERASE_128K_NS);
+  memset(flash.mem + off, 0xFF, size);
+  flash.erases++;
+}
+
+static void flash_write(uint32_t off, uint32_t v) {
+  switch (off) {
+  case offsetof(FLASH_TypeDef, KEYR):
+    if (flash.keys == 0 && v == FLASH_KEY1) {
+      flash.keys = 1;
+    } else if (flash.keys == 1 && v == FLASH_KEY2) {
+      flash.keys = 0;
+      sim_FLASH.CR.v &= ~FLASH_CR_LOCK;
+    } else {
+      flash.keys = -1; // A bus error on the chip, and locked until reset
+    }
+    break;
+  case offsetof(FLASH_TypeDef, SR):
+    sim_FLASH.SR.v &= ~(v & (FLASH_SR_EOP | FLASH_SR_OPERR | FLASH_SR_ERRORS));
+    break;
+  case offsetof(FLASH_TypeDef, CR):
+    if (sim_FLASH.CR.v & FLASH_CR_LOCK) break;
+    sim_FLASH.CR.v = v;
+    if ((v & FLASH_CR_STRT) && (v & FLASH_CR_SER)) flash_erase(v);
+    break;
+  case offsetof(FLASH_TypeDef, OPTCR):
+  case offsetof(FLASH_TypeDef, OPTCR1):
+    break; // Option bytes: see sim_flash_set_dual_bank()
+  default:
+    ((sim_reg *)((uint8_t *)&sim_FLASH + off))->v = v;
+    break;
+  }
+}
+
+static int flash_irq_level(void) {
+  uint32_t cr = sim_FLASH.CR.v, sr = sim_FLASH.SR.v;
+  return ((cr & FLASH_CR_EOPIE) && (sr & FLASH_SR_EOP)) || ((cr & FLASH_CR_ERRIE) && (sr & FLASH_SR_OPERR));
+}
+
+static void syscfg_write(uint32_t off, uint32_t v) {
+  ((sim_reg *)((uint8_t *)&sim_SYSCFG + off))->v = v;
+  int swapped = (sim_SYSCFG.MEMRMP.v & SYSCFG_MEMRMP_SWP_FB) != 0;
+  if (swapped != flash.swapped) {
+    flash_sync();
+    flash_map(swapped);
+  }
+}
+
+static void flash_reset(void) {
+  if (!flash.mem) flash_open();
+  flash_sync();
+  if (flash.swapped) flash_map(0);
+  flash.keys = flash.busy = 0;
+  flash.erases = flash.programs = 0;
+  sim_FLASH.CR.v = FLASH_CR_LOCK;
+  sim_FLASH.OPTCR.v = FLASH_OPTCR_RESET & ~(flash.dual ? FLASH_OPTCR_nDBANK : 0U);
+}
+
+void sim_flash_set_dual_bank(int dual) {
+  flash.dual = dual != 0;
+  sim_FLASH.OPTCR.v = FLASH_OPTCR_RESET & ~(flash.dual ? FLASH_OPTCR_nDBANK : 0U);
+}
+
+uint8_t *sim_flash_bank(int bank) {
+  if (!flash.mem) flash_open();
+  flash_sync();
+  return flash.mem + (bank == 2 ? FLASH_BANK : 0U);
+}
+
+void sim_flash_erase_all(void) {
+  memset(sim_flash_bank(1), 0xFF, FLASH_SIZE);
+}
+
+uint64_t sim_flash_erases(void) { return flash.erases; }
+uint64_t sim_flash_programs(void) { return flash.programs; }
+
+
+/* ----------------------------------------------------------------------
+ * Register access entry points
+ */
+
+uint32_t sim_read(const sim_reg *reg) {
+  uint32_t off;
+  const region_t *rg = find_region(reg, &off);
+  uint32_t v;
+
+  sim_count.cycles += rg->cost;
+  sim_count.reg_accesses++;
+  step();
+
+  switch (rg->kind) {
+  case K_GPIO:  v = gpio_read(rg->index, off); break;
+  case K_USART: v = usart_read(&usarts[rg->index], off); break;
+  case K_DMA:   v = dma_read(&dmas[rg->index], off); break;
+  case K_DWT:   v = dwt_read(off); break;
+  case K_SYSTICK: v = systick_read(off); break;
+  case K_SCB:   v = scb_read(off); break;
+  case K_TIM:   v = tim_read(&tims[rg->index], off); break;
+  case K_CRC:   v = crc_read(off); break;
+  case K_LPTIM: v = lptim_read(off); break;
+  case K_PLAIN:
+  default:      v = reg->v; break;
+  }
+
+  service();
+  return v;
+}
+
+void sim_write(sim_reg *reg, uint32_t v) {
+  uint32_t off;
+  const region_t *rg = find_region(reg, &off);
+
+  sim_count.cycles += rg->cost;
+  sim_count.reg_accesses++;
+  step();
+
+  switch (rg->kind) {
+  case K_GPIO:  gpio_write(rg->index, off, v, sim_count.cycles); break;
+  case K_USART: usart_write(&usarts[rg->index], off, v); dma_service(sim_count.cycles); break;
+  case K_DMA:   dma_write(&dmas[rg->index], off, v); break;
+  case K_DWT:   dwt_write(off, v); break;
+  case K_RCC:   reg->v = v; rcc_update(); break;
+  case K_PWR:   reg->v = v; pwr_update(); break;
+  case K_SYSTICK: systick_write(off, v); break;
+  case K_SCB:   scb_write(off, v); break;
+  case K_EXTI:  exti_write(off, v); break;
+  case K_TIM:   tim_write(&tims[rg->index], off, v); break;
+  case K_CRC:   crc_write(off, v); break;
+  case K_LPTIM: lptim_write(off, v); break;
+  case K_FLASH: flash_write(off, v); break;
+  case K_SYSCFG: syscfg_write(off, v); break;
+  case K_PLAIN:
+  default:      reg->v = v; break;
+  }
+
+  service();
+}
+
+
+/* ----------------------------------------------------------------------
+ * Time and interrupts
+ */
+
+typedef void (*handler_t)(void);
+// All indexed by exception number: IRQn + 16
+static handler_t vectors[SIM_NUM_EXC];
+static uint8_t nvic_enabled[SIM_NUM_EXC];
+static uint8_t nvic_prio[SIM_NUM_EXC];
+static int enabled_list[SIM_NUM_EXC]; // nvic_enabled as a list, for speed
+static int num_enabled;
+static uint32_t primask;
+static int active[SIM_NUM_EXC + 1]; // Stack of running handlers
+static int depth;
+static uint64_t irq_since;          // When depth last went from 0 to 1
+
+void SCB_EnableICache(void) { sim_SCB.CCR.v |= SCB_CCR_IC_Msk; sim_run(1); }
+void SCB_DisableICache(void) { sim_SCB.CCR.v &= ~SCB_CCR_IC_Msk; sim_run(1); }
+void SCB_EnableDCache(void) { sim_SCB.CCR.v |= SCB_CCR_DC_Msk; sim_run(1); }
+void SCB_DisableDCache(void) { sim_SCB.CCR.v &= ~SCB_CCR_DC_Msk; sim_run(1); }
+void SCB_CleanDCache(void) { sim_run(1); }
+void SCB_InvalidateDCache(void) { sim_run(1); }
+void SCB_CleanDCache_by_Addr(uint32_t *addr, int32_t dsize) { (void)addr; (void)dsize; sim_run(1); }
+void SCB_InvalidateDCache_by_Addr(uint32_t *addr, int32_t dsize) { (void)addr; (void)dsize; sim_run(1); }
+
+static void update_enabled_list(void) {
+  num_enabled = 0;
+  for (int n = 0; n < SIM_NUM_EXC; n++) {
+    if (nvic_enabled[n]) enabled_list[num_enabled++] = n;
+  }
+}
+
+static void step(void) {
+  flash_sync();
+  flash_step(sim_now_ns());
+  for (unsigned i = 0; i < NUM_USARTS; i++) usart_step(&usarts[i], sim_count.cycles);
+  for (unsigned i = 0; i < NUM_TIMS; i++) tim_step(&tims[i], sim_count.cycles);
+  gpio_step(sim_now_ns());
+  lptim_step(sim_now_ns());
+  systick_step(sim_count.cycles);
+}
+
+static uint64_t next_event(void) {
+  uint64_t t = UINT64_MAX;
+  for (unsigned i = 0; i < NUM_USARTS; i++) {
+    const usart_model_t *u = &usarts[i];
+    if (u->shifting && u->shift_end < t) t = u->shift_end;
+    if (u->rx_busy && u->rx_done < t) t = u->rx_done;
+    if (!u->rx_busy && u->source && u->rx_poll < t) t = u->rx_poll;
+  }
+  for (unsigned i = 0; i < NUM_TIMS; i++) {
+    uint64_t u = tim_next_event(&tims[i]);
+    if (u < t) t = u;
+  }
+  if (num_inputs && cycles_at(inputs[0].at) < t) t = cycles_at(inputs[0].at);
+  if (lptim_next_event() != UINT64_MAX && cycles_at(lptim_next_event()) < t) {
+    t = cycles_at(lptim_next_event());
+  }
+  if ((sim_SysTick.CTRL.v & SysTick_CTRL_ENABLE_Msk) && st_next < t) t = st_next;
+  if (flash.busy && cycles_at(flash.busy_until) < t) t = cycles_at(flash.busy_until);
+  return t;
+}
+
+static int irq_level(int exc) {
+  if (exc < 16) return exc_pending[exc];
+  for (unsigned i = 0; i < NUM_USARTS; i++) {
+    if (usarts[i].irq + 16 == exc) return usart_irq_level(&usarts[i]);
+  }
+  for (unsigned i = 0; i < NUM_DMAS; i++) {
+    for (unsigned s = 0; s < 8; s++) {
+      if (dmas[i].irq[s] + 16 == exc) return dma_irq_level(&dmas[i], s);
+    }
+  }
+  for (unsigned i = 0; i < NUM_EXTI_IRQS; i++) {
+    if (exti_irqs[i].irq + 16 == exc) return (sim_EXTI.PR.v & sim_EXTI.IMR.v & exti_irqs[i].lines) != 0;
+  }
+  for (unsigned i = 0; i < NUM_TIMS; i++) {
+    if (tims[i].irq + 16 == exc) return tim_irq_level(&tims[i]);
+  }
+  if (exc == LPTIM1_IRQn + 16) return lptim_irq_level();
+  if (exc == FLASH_IRQn + 16) return flash_irq_level();
+  return 0;
+}
+
+// Run whatever handlers are due, highest priority (lowest value) first,
+// preempting the current handler only for a strictly higher priority
+static void service(void) {
+  static uint64_t runaway;
+
+  while (!primask) {
+    int best = -1;
+    int limit = depth ? nvic_prio[active[depth - 1]] : 256;
+    for (int i = 0; i < num_enabled; i++) {
+      int n = enabled_list[i];
+      if (nvic_prio[n] < limit && irq_level(n)) {
+        if (best < 0 || nvic_prio[n] < nvic_prio[best]) best = n;
+      }
+    }
+    if (best < 0) break;
+
+    if (!vectors[best]) {
+      fprintf(stderr, "sim: IRQ %d enabled and pending but no handler is linked\n", best - 16);
+      abort();
+    }
+    if (++runaway > 100000000ULL) {
+      fprintf(stderr, "sim: IRQ %d never stops firing - is its flag cleared?\n", best - 16);
+      abort();
+    }
+
+    // Kept outside this frame: PendSV_Handler may return on another
+    // thread's stack (sim_exception_return())
+    if (!depth) irq_since = sim_count.cycles;
+    sim_count.irq_entries++;
+    sim_count.cycles += SIM_IRQ_CYCLES;
+    if (best < 16) exc_pending[best] = 0;
+    active[depth++] = best;
+    vectors[best]();
+    depth--;
+    if (!depth) sim_count.irq_cycles += sim_count.cycles - irq_since;
+  }
+  if (!depth) runaway = 0;
+}
+
+void sim_exception_return(void) {
+  depth--;
+  if (!depth) sim_count.irq_cycles += sim_count.cycles - irq_since;
+}
+
+void sim_run(uint64_t n) {
+  sim_count.cycles += n;
+  step();
+  service();
+}
+
+// An enabled interrupt is pending: WFI returns at once, masked or not
+static int irq_pending(void) {
+  for (int i = 0; i < num_enabled; i++) {
+    if (irq_level(enabled_list[i])) return 1;
+  }
+  return 0;
+}
+
+static void idle(void) {
+  step();
+  uint64_t t = next_event();
+  if (t != UINT64_MAX && t > sim_count.cycles) {
+    sim_count.idle_cycles += t - sim_count.cycles;
+    sim_count.cycles = t;
+  } else {
+    sim_count.cycles++;
+  }
+  step();
+  service();
+}
+
+/* Stop mode: WFI with SLEEPDEEP. The core clock, the PLL, the HSE and
+   over-drive go off; everything clocked from them (USARTs, TIM6/7/8, DMA,
+   SysTick, the cycle counter) freezes. Only EXTI lines wake the core:
+   GPIO edges and LPTIM1, which runs on from the LSE or LSI. A USART
+   cannot receive without its clock, so a byte arriving in Stop is lost;
+   its start bit is still a falling edge on the RX pin, which EXTI can
+   see. The core then restarts on the HSI after SIM_STOP_WAKE_LP_NS, or
+   SIM_STOP_WAKE_NS with the main regulator and flash left on; bytes
+   arriving during that are lost too. An interrupt already pending and
+   enabled stops WFI from sleeping at all. */
+
+static uint64_t stop_next_event(void) {
+  uint64_t t = UINT64_MAX;
+  for (unsigned i = 0; i < NUM_USARTS; i++) {
+    if (usarts[i].source && usarts[i].rx_poll < t) t = usarts[i].rx_poll;
+  }
+  if (num_inputs && cycles_at(inputs[0].at) < t) t = cycles_at(inputs[0].at);
+  if (lptim_next_event() != UINT64_MAX && cycles_at(lptim_next_event()) < t) {
+    t = cycles_at(lptim_next_event());
+  }
+  return t;
+}
+
+// The line still delivers bytes; the receiver is not listening
+static void stop_usart_step(usart_model_t *u, uint64_t now) {
+  uint32_t on = USART_CR1_UE | USART_CR1_RE;
+  while (u->source && u->rx_poll <= now) {
+    int c = (u->regs->CR1.v & on) == on ? u->source(u->regs) : -1;
+    if (c >= 0) {
+      u->rx_lost++;
+      if (u->rx_port >= 0) {
+        gpio_set_input((unsigned)u->rx_port, u->rx_pin, 0); // Start bit
+        gpio_set_input((unsigned)u->rx_port, u->rx_pin, 1);
+      }
+    }
+    u->rx_poll += sim_usart_frame_cycles(u->regs);
+  }
+}
+
+static void stop(void) {
+  if (sim_PWR.CR1.v & PWR_CR1_PDDS) {
+    fprintf(stderr, "sim: Standby mode is not modelled\n");
+    abort();
+  }
+  step();
+  if (irq_pending()) {
+    sim_run(1);
+    return;
+  }
+
+  sim_RCC.CR.v &= ~(RCC_CR_HSEON | RCC_CR_PLLON);
+  sim_RCC.CFGR.v &= ~RCC_CFGR_SW;
+  sim_PWR.CR1.v &= ~(PWR_CR1_ODEN | PWR_CR1_ODSWEN);
+  rcc_update();
+  pwr_update();
+  for (unsigned i = 0; i < NUM_USARTS; i++) {
+    usart_model_t *u = &usarts[i];
+    if (u->rx_busy) u->rx_lost++; // Cut off
+    u->rx_busy = 0;
+    if (u->rx_poll < sim_count.cycles) u->rx_poll = sim_count.cycles;
+  }
+
+  uint64_t t0 = sim_count.cycles, ns0 = sim_now_ns();
+  uint64_t wake = UINT64_MAX; // In ns, once an EXTI line has fired
+  for (;;) {
+    uint64_t now = sim_now_ns();
+    gpio_step(now);
+    lptim_step(now);
+    for (unsigned i = 0; i < NUM_USARTS; i++) stop_usart_step(&usarts[i], sim_count.cycles);
+    if (wake == UINT64_MAX && (sim_EXTI.PR.v & sim_EXTI.IMR.v)) {
+      int lp = (sim_PWR.CR1.v & (PWR_CR1_LPDS | PWR_CR1_FPDS)) != 0;
+      wake = now + (lp ? SIM_STOP_WAKE_LP_NS : SIM_STOP_WAKE_NS);
+    }
+    if (now >= wake) break;
+
+    uint64_t t = stop_next_event();
+    if (wake != UINT64_MAX && cycles_at(wake) < t) t = cycles_at(wake);
+    if (t == UINT64_MAX) {
+      fprintf(stderr, "sim: Stop mode with nothing left to wake the core\n");
+      abort();
+    }
+    sim_count.cycles = t > sim_count.cycles ? t : sim_count.cycles + 1U;
+  }
+
+  // Everything on the core clock picks up where it left off
+  uint64_t slept = sim_count.cycles - t0;
+  for (unsigned i = 0; i < NUM_USARTS; i++) {
+    if (usarts[i].shifting) usarts[i].shift_end += slept;
+  }
+  for (unsigned i = 0; i < NUM_TIMS; i++) {
+    tims[i].start += slept;
+    if (tims[i].update != UINT64_MAX) tims[i].update += slept;
+  }
+  st_reload_at += slept;
+  st_next += slept;
+  dwt_base += slept;
+  sim_count.idle_cycles += slept;
+  sim_count.stops++;
+  sim_count.stop_ns += sim_now_ns() - ns0;
+  step();
+  service();
+}
+
+// memset() a register block (sim_reg has a user-defined assignment)
+#define ZERO(x) memset((void *)&(x), 0, sizeof(x))
+
+void sim_reset(void) {
+  ZERO(sim_GPIOA);
+  ZERO(sim_GPIOB);
+  ZERO(sim_GPIOC);
+  ZERO(sim_GPIOD);
+  ZERO(sim_GPIOE);
+  ZERO(sim_RCC);
+  ZERO(sim_PWR);
+  ZERO(sim_FLASH);
+  ZERO(sim_DMA1);
+  ZERO(sim_DMA2);
+  ZERO(sim_SYSCFG);
+  ZERO(sim_EXTI);
+  ZERO(sim_CRC);
+  ZERO(sim_LPTIM1);
+  ZERO(sim_DWT);
+  ZERO(sim_CoreDebug);
+  ZERO(sim_SysTick);
+  ZERO(sim_SCB);
+  ZERO(sim_MPU);
+  ZERO(sim_FPU);
+  memset(exc_pending, 0, sizeof(exc_pending));
+  st_reload_at = st_next = 0;
+  memset(gpio_in, 0, sizeof(gpio_in));
+  memset(gpio_watch, 0, sizeof(gpio_watch));
+  memset(gpio_source, 0, sizeof(gpio_source));
+  num_inputs = 0;
+  memset(&lptim, 0, sizeof(lptim));
+  ns_base = ns_base_cycles = 0;
+  ns_hz = 16000000UL;
+  flash_reset();
+
+  // Reset values: RM0410 Rev 5 Sec 6.4.1, 5.3.1-5.3.3, 34.8.8
+  sim_GPIOA.MODER.v = 0xA8000000UL;
+  sim_GPIOB.MODER.v = 0x00000280UL;
+  sim_RCC.CR.v = 0x00000083UL;
+  sim_RCC.PLLCFGR.v = 0x24003010UL;
+  sim_PWR.CR1.v = 0x0000C000UL;
+  sim_CRC.DR.v = sim_CRC.INIT.v = 0xFFFFFFFFUL; // Sec 14.4
+  sim_CRC.POL.v = 0x04C11DB7UL;
+  sim_MPU.TYPE.v = 8UL << MPU_TYPE_DREGION_Pos; // PM0253 Rev 5 Sec 4.6.1
+  sim_FPU.MVFR0.v = 0x10110221UL; // Single and double precision: Sec 4.7
+  sim_FPU.FPCCR.v = FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+
+  // As the startup code does
+  sim_SCB.CPACR.v = 0xFUL << 20;
+  for (unsigned i = 0; i < SIM_STACK_WORDS; i++) sim_stack[i] = MEMSTAT_PAINT;
+  sim_brk = sim_heap;
+
+  for (unsigned i = 0; i < NUM_USARTS; i++) {
+    usart_model_t *u = &usarts[i];
+    ZERO(*u->regs);
+    u->regs->ISR.v = USART_ISR_TXE | USART_ISR_TC;
+    u->shifting = u->tdr_full = u->rx_busy = 0;
+    u->rx_poll = 0;
+    u->tx_count = u->rx_count = u->rx_lost = 0;
+    u->far_baud = 0;
+    if (u->rx_port >= 0) gpio_in[u->rx_port] |= 1UL << u->rx_pin; // Idle line
+  }
+  for (unsigned i = 0; i < NUM_TIMS; i++) {
+    ZERO(*tims[i].regs);
+    tims[i].psc = 0;
+    tims[i].update = UINT64_MAX;
+  }
+  for (unsigned i = 0; i < NUM_DMAS; i++) {
+    memset(dmas[i].pos, 0, sizeof(dmas[i].pos));
+    memset(dmas[i].total, 0, sizeof(dmas[i].total));
+  }
+
+  memset(vectors, 0, sizeof(vectors));
+  for (unsigned i = 0; i < NUM_USARTS; i++) vectors[usarts[i].irq + 16] = usarts[i].handler;
+  vectors[DMA1_Stream3_IRQn + 16] = DMA1_Stream3_IRQHandler;
+  vectors[DMA2_Stream1_IRQn + 16] = DMA2_Stream1_IRQHandler;
+  vectors[DMA2_Stream5_IRQn + 16] = DMA2_Stream5_IRQHandler;
+  vectors[EXTI0_IRQn + 16] = EXTI0_IRQHandler;
+  vectors[EXTI1_IRQn + 16] = EXTI1_IRQHandler;
+  vectors[EXTI2_IRQn + 16] = EXTI2_IRQHandler;
+  vectors[EXTI3_IRQn + 16] = EXTI3_IRQHandler;
+  vectors[EXTI4_IRQn + 16] = EXTI4_IRQHandler;
+  vectors[EXTI9_5_IRQn + 16] = EXTI9_5_IRQHandler;
+  vectors[EXTI15_10_IRQn + 16] = EXTI15_10_IRQHandler;
+  for (unsigned i = 0; i < NUM_TIMS; i++) vectors[tims[i].irq + 16] = tims[i].handler;
+  vectors[LPTIM1_IRQn + 16] = LP_Timer1_IRQHandler;
+  vectors[FLASH_IRQn + 16] = FLASH_IRQHandler;
+  vectors[EXC_SYSTICK] = SysTick_Handler;
+  vectors[EXC_PENDSV] = PendSV_Handler;
+  memset(nvic_enabled, 0, sizeof(nvic_enabled));
+  // Core exceptions are always enabled; SysTick is gated by CTRL.TICKINT
+  nvic_enabled[EXC_PENDSV] = nvic_enabled[EXC_SYSTICK] = 1;
+  update_enabled_list();
+  memset(nvic_prio, 0, sizeof(nvic_prio));
+  primask = 0;
+  sim_masked_max = 0;
+  depth = 0;
+
+  sim_core_hz = sim_pclk1_hz = sim_pclk2_hz = sysclk_hz = 16000000UL;
+  ZERO(sim_count);
+  dwt_base = 0;
+}
+
+
+/* ----------------------------------------------------------------------
+ * Core intrinsics and NVIC
+ */
+
+uint32_t __get_PRIMASK(void) { sim_run(1); return primask; }
+uint64_t sim_masked_max;
+static uint64_t masked_since;
+
+static void set_primask(uint32_t pm) {
+  if (pm && !primask) masked_since = sim_count.cycles;
+  if (!pm && primask && sim_count.cycles - masked_since > sim_masked_max) {
+    sim_masked_max = sim_count.cycles - masked_since;
+  }
+  primask = pm;
+}
+
+void __set_PRIMASK(uint32_t pm) { set_primask(pm & 1U); sim_run(1); }
+void __disable_irq(void) { set_primask(1); sim_run(1); }
+void __enable_irq(void) { set_primask(0); sim_run(1); }
+uint32_t __get_IPSR(void) { sim_run(1); return depth ? (uint32_t)active[depth - 1] : 0U; }
+void __NOP(void) { idle(); }
+void __WFI(void) {
+  if (sim_SCB.SCR.v & SCB_SCR_SLEEPDEEP_Msk) {
+    stop();
+  } else {
+    step();
+    if (irq_pending()) sim_run(1);
+    else idle();
+  }
+}
+void __set_MSP(uint32_t top) { (void)top; sim_run(1); }
+void __DMB(void) { sim_run(1); }
+void __DSB(void) { sim_run(1); }
+void __ISB(void) { sim_run(1); }
+
+void NVIC_EnableIRQ(IRQn_Type irqn) {
+  if (irqn >= 0) nvic_enabled[irqn + 16] = 1;
+  update_enabled_list();
+  sim_run(1);
+}
+
+void NVIC_DisableIRQ(IRQn_Type irqn) {
+  if (irqn >= 0) nvic_enabled[irqn + 16] = 0;
+  update_enabled_list();
+  sim_run(1);
+}
+
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority) {
+  if (irqn >= -15) nvic_prio[irqn + 16] = (uint8_t)(priority & 0xFU);
+  sim_run(1);
+}
+
+uint32_t NVIC_GetPriority(IRQn_Type irqn) {
+  sim_run(1);
+  return irqn >= -15 ? nvic_prio[irqn + 16] : 0U;
+}
+
+uint32_t NVIC_GetActive(IRQn_Type irqn) {
+  sim_run(1);
+  for (int i = 0; i < depth; i++) {
+    if (active[i] == irqn + 16) return 1U;
+  }
+  return 0U;
+}
+
+void NVIC_SystemReset(void) {
+  fprintf(stderr, "sim: NVIC_SystemReset()\n");
+  exit(1);
+}
+
+
+/* ----------------------------------------------------------------------
+ * printf() from the drivers goes out the simulated console
+ */
+
+int _write(int file, char *ptr, int len);
+
+int sim_printf(const char *fmt, ...) {
+  char buf[512];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0) return n;
+  if (n >= (int)sizeof(buf)) n = (int)sizeof(buf) - 1;
+  return _write(1, buf, n);
+}
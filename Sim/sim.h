@@ -0,0 +1,162 @@
+/*
+ * sim.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Host-side control of the simulated peripherals in sim.cpp:
+ * simulated time, access counters, byte-level hooks for the USARTs and
+ * GPIO input pins.
+ *
+ * Timing model (cycle-approximate, in core clock cycles):
+ * * Every CPU register access costs SIM_APB_CYCLES or SIM_AHB_CYCLES
+ * * Exception entry + exit cost SIM_IRQ_CYCLES
+ * * Code between register accesses is free
+ * * A USART frame takes BRR (OVER8=0) or USARTDIV/2 (OVER8=1) kernel
+ *   clocks per bit, times start + data + parity + stop bits
+ * * TIM1/6/7/8 count their APB timer clock divided by PSC + 1; an update
+ *   DMA request moves its item at the update, taking no time
+ * * LPTIM1 and scheduled GPIO inputs keep real time (sim_now_ns()) across
+ *   core clock changes and Stop mode
+ * * WFI returns at once if an enabled interrupt is pending, even with
+ *   PRIMASK set; with SCB->SCR SLEEPDEEP set it is Stop mode: see stop()
+ *   in sim.cpp
+ * * A flash sector erase or word program keeps the flash busy for the
+ *   SIM_FLASH_* times below, in real time; a store to flash while it is
+ *   busy stalls the core until it is not
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+
+#define SIM_SIDE_INCLUDE
+#include "stm32f7xx.h"
+
+#define SIM_AHB_CYCLES 2U
+#define SIM_APB_CYCLES 6U
+#define SIM_IRQ_CYCLES 24U
+
+// Stop mode wake-up time, with the regulator in low-power mode or the
+// flash powered down (LPDS or FPDS), and without: of the order of the
+// STM32F767 datasheet's tWUSTOP figures, not measured
+#define SIM_STOP_WAKE_LP_NS 100000U
+#define SIM_STOP_WAKE_NS    15000U
+
+// Flash erase and program (x32 parallelism) times: of the order of the
+// STM32F767 datasheet's typical figures, not measured
+#define SIM_FLASH_ERASE_16K_NS  250000000ULL
+#define SIM_FLASH_ERASE_64K_NS  500000000ULL
+#define SIM_FLASH_ERASE_128K_NS 1000000000ULL
+#define SIM_FLASH_PROGRAM_NS    16000ULL
+
+// Core, APB1 and APB2 clocks in Hz; all the 16MHz HSI at reset
+extern uint32_t sim_core_hz;
+extern uint32_t sim_pclk1_hz;
+extern uint32_t sim_pclk2_hz;
+
+// Running totals; take the difference of two snapshots to measure something
+typedef struct {
+  uint64_t cycles;       // Simulated core cycles since sim_reset()
+  uint64_t idle_cycles;  // Of those, skipped over by __NOP()/__WFI()
+  uint64_t reg_accesses; // CPU register reads + writes (not DMA)
+  uint64_t irq_entries;  // Interrupt handlers run
+  uint64_t irq_cycles;   // Cycles spent in handlers, including entry/exit
+  uint64_t stops;        // Times in Stop mode (their cycles count as idle)
+  uint64_t stop_ns;      // Time in Stop mode, wake-up included
+} sim_counters_t;
+
+extern sim_counters_t sim_count;
+
+// Longest stretch with PRIMASK set, in core cycles; zero it to start over
+extern uint64_t sim_masked_max;
+
+// Put every peripheral back to its reset state and zero the counters
+void sim_reset(void);
+
+// Advance simulated time (as if the CPU ran n cycles of non-register code)
+void sim_run(uint64_t n);
+
+// Simulated time since sim_reset() in ns, at one rate whatever the core
+// clock does
+uint64_t sim_now_ns(void);
+
+// USART byte hooks. The sink sees each byte as its stop bit completes.
+// The source is asked for the next byte whenever the receiver is free;
+// return -1 if nothing is waiting.
+typedef void (*sim_tx_sink_t)(USART_TypeDef *usart, uint8_t c);
+typedef int (*sim_rx_source_t)(USART_TypeDef *usart);
+void sim_usart_set_tx_sink(USART_TypeDef *usart, sim_tx_sink_t sink);
+void sim_usart_set_rx_source(USART_TypeDef *usart, sim_rx_source_t source);
+
+// The rate the far end of a USART's line sends at, which auto-baud
+// detection (CR2 ABREN) measures; 0, the default, is whatever BRR says.
+// A character that fails detection at a rate 2% or more off ours comes in
+// garbled, with FE; otherwise the line passes bytes as they are, and a
+// bench garbles them itself when the two ends disagree.
+void sim_usart_set_far_baud(USART_TypeDef *usart, uint32_t baud);
+
+// Core cycles one frame takes at the current USART settings
+uint64_t sim_usart_frame_cycles(USART_TypeDef *usart);
+
+// Bytes the USART has finished sending/receiving since sim_reset()
+uint64_t sim_usart_tx_count(USART_TypeDef *usart);
+uint64_t sim_usart_rx_count(USART_TypeDef *usart);
+
+// Bytes the source offered while the USART had no clock (Stop mode), lost
+uint64_t sim_usart_rx_lost(USART_TypeDef *usart);
+
+// Drive a GPIO input pin (what IDR reads back). A change is an edge for
+// the EXTI line SYSCFG->EXTICR routes that pin to.
+void sim_gpio_set_input(GPIO_TypeDef *gpio, uint32_t pin, int level);
+
+// The same, at core cycle `at` (counted like sim_count.cycles). Changes
+// are events: __WFI() wakes for them, so a handler can see exactly when
+// an edge came in.
+void sim_gpio_input_at(GPIO_TypeDef *gpio, uint32_t pin, int level, uint64_t at);
+
+// The same at sim_now_ns() `at`, which stays put if the clock changes
+void sim_gpio_input_at_ns(GPIO_TypeDef *gpio, uint32_t pin, int level, uint64_t at);
+
+// A function giving a whole port's input levels at sim_now_ns() `ns`,
+// for signals too fast to schedule pin by pin: IDR reads, by the CPU or
+// a DMA transfer, call it instead of using the pins above. Its changes
+// are not EXTI edges and do not wake __WFI(). NULL to stop. Either
+// way, pins in output mode read back their ODR bits.
+typedef uint32_t (*sim_gpio_source_t)(GPIO_TypeDef *gpio, uint64_t ns);
+void sim_gpio_set_source(GPIO_TypeDef *gpio, sim_gpio_source_t source);
+
+// Called whenever a port's output data register changes, from a CPU
+// write or a DMA transfer, with the new ODR and the core cycle of the
+// change. NULL to stop.
+typedef void (*sim_gpio_watch_t)(GPIO_TypeDef *gpio, uint32_t odr, uint64_t at);
+void sim_gpio_set_watch(GPIO_TypeDef *gpio, sim_gpio_watch_t watch);
+
+// Flash: 2MB at FLASHAXI_BASE, read-only to the code like the real
+// thing; a store is a program operation for the modelled controller
+// (RM0410 Rev 5 Sec 3.3), which checks it and stores old & new. The
+// contents and the dual-bank option (nDBANK) last over sim_reset(), as
+// they would over a reset; SYSCFG->MEMRMP SWP_FB does not. Only dual-bank
+// mode is modelled: a 1MB bank of 4 x 16K, 64K and 7 x 128K sectors.
+void sim_flash_set_dual_bank(int dual);
+
+// Physical bank 1 or 2, whatever SWP_FB maps where, for the host to load
+// or inspect: no time passes and the controller does not see it
+uint8_t *sim_flash_bank(int bank);
+
+// Every byte back to 0xFF
+void sim_flash_erase_all(void);
+
+// Sector erases and word programs since sim_reset()
+uint64_t sim_flash_erases(void);
+uint64_t sim_flash_programs(void);
+
+// Threads (Sim/kernel-port.cpp): PendSV_Handler swaps host stacks, so
+// a handler can return on another thread's stack than it was entered
+// on, leaving the frames below it on the old one. A thread starting for
+// the first time inside PendSV_Handler calls this in place of returning:
+// the exception return that puts the core back in thread mode.
+void sim_exception_return(void);
+
+#endif /* SIM_H_ */
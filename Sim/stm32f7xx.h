@@ -0,0 +1,875 @@
+/*
+ * stm32f7xx.h (host simulation)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Stand-in for the STM32CubeF7 CMSIS device header when building the
+ * drivers in Src/ on a PC. Only the parts the drivers use are here.
+ *
+ * Same layouts and bit values as stm32f767xx.h and core_cm7.h, but every
+ * register is a sim_reg: a 32-bit value whose reads and writes call into
+ * the peripheral models in sim.cpp. That is what lets TXE/RXNE follow
+ * the programmed BRR and lets us count register accesses.
+ *
+ * The drivers are compiled as C++ (g++ -x c++) for this; see Makefile.
+ */
+
+#ifndef SIM_STM32F7XX_H_
+#define SIM_STM32F7XX_H_
+
+#ifndef __cplusplus
+#error "The simulated device header needs the drivers compiled as C++ (-x c++)"
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* ----------------------------------------------------------------------
+ * Simulated register
+ */
+
+struct sim_reg;
+uint32_t sim_read(const sim_reg *r);
+void sim_write(sim_reg *r, uint32_t v);
+
+// The operators take any integer type: on the host "UL" constants are
+// 64 bits wide, where on the Cortex-M7 they are 32.
+struct sim_reg {
+  uint32_t v; // Raw contents; the peripheral models use this directly
+
+  operator uint32_t() const { return sim_read(this); }
+  sim_reg &operator=(const sim_reg &o) { sim_write(this, sim_read(&o)); return *this; }
+  template <typename T> sim_reg &operator=(T x) { sim_write(this, (uint32_t)x); return *this; }
+  template <typename T> sim_reg &operator|=(T x) { sim_write(this, sim_read(this) | (uint32_t)x); return *this; }
+  template <typename T> sim_reg &operator&=(T x) { sim_write(this, sim_read(this) & (uint32_t)x); return *this; }
+  template <typename T> sim_reg &operator^=(T x) { sim_write(this, sim_read(this) ^ (uint32_t)x); return *this; }
+  template <typename T> sim_reg &operator+=(T x) { sim_write(this, sim_read(this) + (uint32_t)x); return *this; }
+  template <typename T> sim_reg &operator-=(T x) { sim_write(this, sim_read(this) - (uint32_t)x); return *this; }
+};
+
+#define __I
+#define __O
+#define __IO
+#define __IM
+#define __OM
+#define __IOM
+
+/* ----------------------------------------------------------------------
+ * Interrupt numbers (stm32f767xx.h)
+ */
+
+typedef enum {
+  NonMaskableInt_IRQn   = -14,
+  MemoryManagement_IRQn = -12,
+  BusFault_IRQn         = -11,
+  UsageFault_IRQn       = -10,
+  SVCall_IRQn           = -5,
+  DebugMonitor_IRQn     = -4,
+  PendSV_IRQn           = -2,
+  SysTick_IRQn          = -1,
+  FLASH_IRQn            = 4,
+  EXTI0_IRQn            = 6,
+  EXTI1_IRQn            = 7,
+  EXTI2_IRQn            = 8,
+  EXTI3_IRQn            = 9,
+  EXTI4_IRQn            = 10,
+  DMA1_Stream0_IRQn     = 11,
+  DMA1_Stream1_IRQn     = 12,
+  DMA1_Stream2_IRQn     = 13,
+  DMA1_Stream3_IRQn     = 14,
+  DMA1_Stream4_IRQn     = 15,
+  DMA1_Stream5_IRQn     = 16,
+  DMA1_Stream6_IRQn     = 17,
+  EXTI9_5_IRQn          = 23,
+  TIM1_UP_TIM10_IRQn    = 25,
+  USART1_IRQn           = 37,
+  USART2_IRQn           = 38,
+  USART3_IRQn           = 39,
+  EXTI15_10_IRQn        = 40,
+  TIM8_UP_TIM13_IRQn    = 44,
+  DMA1_Stream7_IRQn     = 47,
+  UART4_IRQn            = 52,
+  UART5_IRQn            = 53,
+  TIM6_DAC_IRQn         = 54,
+  TIM7_IRQn             = 55,
+  DMA2_Stream0_IRQn     = 56,
+  DMA2_Stream1_IRQn     = 57,
+  DMA2_Stream5_IRQn     = 68,
+  USART6_IRQn           = 71,
+  UART7_IRQn            = 82,
+  UART8_IRQn            = 83,
+  LPTIM1_IRQn           = 93,
+} IRQn_Type;
+
+#define SIM_NUM_IRQS 128
+
+/* ----------------------------------------------------------------------
+ * Peripheral register layouts
+ */
+
+typedef struct {
+  sim_reg MODER;
+  sim_reg OTYPER;
+  sim_reg OSPEEDR;
+  sim_reg PUPDR;
+  sim_reg IDR;
+  sim_reg ODR;
+  sim_reg BSRR;
+  sim_reg LCKR;
+  sim_reg AFR[2];
+} GPIO_TypeDef;
+
+typedef struct {
+  sim_reg CR1;
+  sim_reg CR2;
+  sim_reg CR3;
+  sim_reg BRR;
+  sim_reg GTPR;
+  sim_reg RTOR;
+  sim_reg RQR;
+  sim_reg ISR;
+  sim_reg ICR;
+  sim_reg RDR;
+  sim_reg TDR;
+} USART_TypeDef;
+
+typedef struct {
+  sim_reg CR;
+  sim_reg PLLCFGR;
+  sim_reg CFGR;
+  sim_reg CIR;
+  sim_reg AHB1RSTR;
+  sim_reg AHB2RSTR;
+  sim_reg AHB3RSTR;
+  uint32_t RESERVED0;
+  sim_reg APB1RSTR;
+  sim_reg APB2RSTR;
+  uint32_t RESERVED1[2];
+  sim_reg AHB1ENR;
+  sim_reg AHB2ENR;
+  sim_reg AHB3ENR;
+  uint32_t RESERVED2;
+  sim_reg APB1ENR;
+  sim_reg APB2ENR;
+  uint32_t RESERVED3[2];
+  sim_reg AHB1LPENR;
+  sim_reg AHB2LPENR;
+  sim_reg AHB3LPENR;
+  uint32_t RESERVED4;
+  sim_reg APB1LPENR;
+  sim_reg APB2LPENR;
+  uint32_t RESERVED5[2];
+  sim_reg BDCR;
+  sim_reg CSR;
+  uint32_t RESERVED6[2];
+  sim_reg SSCGR;
+  sim_reg PLLI2SCFGR;
+  sim_reg PLLSAICFGR;
+  sim_reg DCKCFGR1;
+  sim_reg DCKCFGR2;
+} RCC_TypeDef;
+
+typedef struct {
+  sim_reg CR1;
+  sim_reg CSR1;
+  sim_reg CR2;
+  sim_reg CSR2;
+} PWR_TypeDef;
+
+typedef struct {
+  sim_reg ACR;
+  sim_reg KEYR;
+  sim_reg OPTKEYR;
+  sim_reg SR;
+  sim_reg CR;
+  sim_reg OPTCR;
+  sim_reg OPTCR1;
+} FLASH_TypeDef;
+
+typedef struct {
+  sim_reg CR;
+  sim_reg NDTR;
+  sim_reg PAR;
+  sim_reg M0AR;
+  sim_reg M1AR;
+  sim_reg FCR;
+} DMA_Stream_TypeDef;
+
+typedef struct {
+  sim_reg LISR;
+  sim_reg HISR;
+  sim_reg LIFCR;
+  sim_reg HIFCR;
+} DMA_TypeDef;
+
+typedef struct {
+  sim_reg MEMRMP;
+  sim_reg PMC;
+  sim_reg EXTICR[4];
+  uint32_t RESERVED[2];
+  sim_reg CMPCR;
+} SYSCFG_TypeDef;
+
+typedef struct {
+  sim_reg IMR;
+  sim_reg EMR;
+  sim_reg RTSR;
+  sim_reg FTSR;
+  sim_reg SWIER;
+  sim_reg PR;
+} EXTI_TypeDef;
+
+typedef struct {
+  sim_reg CR1;
+  sim_reg CR2;
+  sim_reg SMCR;
+  sim_reg DIER;
+  sim_reg SR;
+  sim_reg EGR;
+  sim_reg CCMR1;
+  sim_reg CCMR2;
+  sim_reg CCER;
+  sim_reg CNT;
+  sim_reg PSC;
+  sim_reg ARR;
+  sim_reg RCR;
+  sim_reg CCR1;
+  sim_reg CCR2;
+  sim_reg CCR3;
+  sim_reg CCR4;
+  sim_reg BDTR;
+  sim_reg DCR;
+  sim_reg DMAR;
+  sim_reg OR;
+} TIM_TypeDef;
+
+typedef struct {
+  sim_reg ISR;
+  sim_reg ICR;
+  sim_reg IER;
+  sim_reg CFGR;
+  sim_reg CR;
+  sim_reg CMP;
+  sim_reg ARR;
+  sim_reg CNT;
+} LPTIM_TypeDef;
+
+// IDR is 8 bits wide on the chip
+typedef struct {
+  sim_reg DR;
+  sim_reg IDR;
+  sim_reg CR;
+  uint32_t RESERVED2;
+  sim_reg INIT;
+  sim_reg POL;
+} CRC_TypeDef;
+
+// core_cm7.h
+typedef struct {
+  sim_reg CTRL;
+  sim_reg CYCCNT;
+  sim_reg CPICNT;
+  sim_reg EXCCNT;
+  sim_reg SLEEPCNT;
+  sim_reg LSUCNT;
+  sim_reg FOLDCNT;
+  sim_reg PCSR;
+  uint32_t RESERVED0[996];  // COMPn/MASKn/FUNCTIONn up to 0xFB0
+  sim_reg LAR;
+  sim_reg LSR;
+} DWT_Type;
+
+typedef struct {
+  sim_reg CTRL;
+  sim_reg LOAD;
+  sim_reg VAL;
+  sim_reg CALIB;
+} SysTick_Type;
+
+typedef struct {
+  sim_reg CPUID;
+  sim_reg ICSR;
+  sim_reg VTOR;
+  sim_reg AIRCR;
+  sim_reg SCR;
+  sim_reg CCR;
+  uint8_t SHPR[12];  // Priorities: set them with NVIC_SetPriority()
+  sim_reg SHCSR;
+  sim_reg CFSR;
+  sim_reg HFSR;
+  sim_reg DFSR;
+  sim_reg MMFAR;
+  sim_reg BFAR;
+  sim_reg AFSR;
+  uint32_t RESERVED0[18];  // ID and cache ID registers, 0x40-0x84
+  sim_reg CPACR;
+} SCB_Type;
+
+typedef struct {
+  sim_reg TYPE;
+  sim_reg CTRL;
+  sim_reg RNR;
+  sim_reg RBAR;
+  sim_reg RASR;
+} MPU_Type;
+
+typedef struct {
+  uint32_t RESERVED0[1];
+  sim_reg FPCCR;
+  sim_reg FPCAR;
+  sim_reg FPDSCR;
+  sim_reg MVFR0;
+  sim_reg MVFR1;
+  sim_reg MVFR2;
+} FPU_Type;
+
+typedef struct {
+  sim_reg DHCSR;
+  sim_reg DCRSR;
+  sim_reg DCRDR;
+  sim_reg DEMCR;
+} CoreDebug_Type;
+
+/* ----------------------------------------------------------------------
+ * Memory: flash is mapped at its real address by sim.cpp, so code can
+ * read it, and program it, through plain pointers
+ */
+
+#define FLASHAXI_BASE 0x08000000UL
+
+/* ----------------------------------------------------------------------
+ * Peripheral instances: the simulated register blocks in sim.cpp
+ */
+
+struct sim_dma_block {
+  DMA_TypeDef regs;             // 0x00
+  DMA_Stream_TypeDef stream[8]; // 0x10 + 0x18 * n, as on the chip
+};
+
+extern GPIO_TypeDef sim_GPIOA, sim_GPIOB, sim_GPIOC, sim_GPIOD, sim_GPIOE;
+extern USART_TypeDef sim_USART1, sim_USART2, sim_USART3, sim_UART4;
+extern USART_TypeDef sim_UART5, sim_USART6, sim_UART7, sim_UART8;
+extern RCC_TypeDef sim_RCC;
+extern PWR_TypeDef sim_PWR;
+extern FLASH_TypeDef sim_FLASH;
+extern sim_dma_block sim_DMA1, sim_DMA2;
+extern SYSCFG_TypeDef sim_SYSCFG;
+extern EXTI_TypeDef sim_EXTI;
+extern TIM_TypeDef sim_TIM1, sim_TIM6, sim_TIM7, sim_TIM8;
+extern LPTIM_TypeDef sim_LPTIM1;
+extern CRC_TypeDef sim_CRC;
+extern DWT_Type sim_DWT;
+extern CoreDebug_Type sim_CoreDebug;
+extern SysTick_Type sim_SysTick;
+extern SCB_Type sim_SCB;
+extern MPU_Type sim_MPU;
+extern FPU_Type sim_FPU;
+
+#define GPIOA        (&sim_GPIOA)
+#define GPIOB        (&sim_GPIOB)
+#define GPIOC        (&sim_GPIOC)
+#define GPIOD        (&sim_GPIOD)
+#define GPIOE        (&sim_GPIOE)
+#define USART1       (&sim_USART1)
+#define USART2       (&sim_USART2)
+#define USART3       (&sim_USART3)
+#define UART4        (&sim_UART4)
+#define UART5        (&sim_UART5)
+#define USART6       (&sim_USART6)
+#define UART7        (&sim_UART7)
+#define UART8        (&sim_UART8)
+#define RCC          (&sim_RCC)
+#define PWR          (&sim_PWR)
+#define FLASH        (&sim_FLASH)
+#define DMA1         (&sim_DMA1.regs)
+#define DMA2         (&sim_DMA2.regs)
+#define DMA1_Stream0 (&sim_DMA1.stream[0])
+#define DMA1_Stream1 (&sim_DMA1.stream[1])
+#define DMA1_Stream2 (&sim_DMA1.stream[2])
+#define DMA1_Stream3 (&sim_DMA1.stream[3])
+#define DMA1_Stream4 (&sim_DMA1.stream[4])
+#define DMA1_Stream5 (&sim_DMA1.stream[5])
+#define DMA1_Stream6 (&sim_DMA1.stream[6])
+#define DMA1_Stream7 (&sim_DMA1.stream[7])
+#define SYSCFG       (&sim_SYSCFG)
+#define EXTI         (&sim_EXTI)
+#define TIM6         (&sim_TIM6)
+#define TIM7         (&sim_TIM7)
+#define TIM1         (&sim_TIM1)
+#define TIM8         (&sim_TIM8)
+#define LPTIM1       (&sim_LPTIM1)
+#define CRC          (&sim_CRC)
+#define DMA2_Stream0 (&sim_DMA2.stream[0])
+#define DMA2_Stream1 (&sim_DMA2.stream[1])
+#define DMA2_Stream2 (&sim_DMA2.stream[2])
+#define DMA2_Stream3 (&sim_DMA2.stream[3])
+#define DMA2_Stream4 (&sim_DMA2.stream[4])
+#define DMA2_Stream5 (&sim_DMA2.stream[5])
+#define DMA2_Stream6 (&sim_DMA2.stream[6])
+#define DMA2_Stream7 (&sim_DMA2.stream[7])
+#define DWT          (&sim_DWT)
+#define CoreDebug    (&sim_CoreDebug)
+#define SysTick      (&sim_SysTick)
+#define SCB          (&sim_SCB)
+#define MPU          (&sim_MPU)
+#define FPU          (&sim_FPU)
+
+/* ----------------------------------------------------------------------
+ * Bit definitions (stm32f767xx.h / core_cm7.h)
+ */
+
+#define USART_CR1_UE      (1UL << 0)
+#define USART_CR1_UESM    (1UL << 1)
+#define USART_CR1_RE      (1UL << 2)
+#define USART_CR1_TE      (1UL << 3)
+#define USART_CR1_IDLEIE  (1UL << 4)
+#define USART_CR1_RXNEIE  (1UL << 5)
+#define USART_CR1_TCIE    (1UL << 6)
+#define USART_CR1_TXEIE   (1UL << 7)
+#define USART_CR1_PEIE    (1UL << 8)
+#define USART_CR1_PS      (1UL << 9)
+#define USART_CR1_PCE     (1UL << 10)
+#define USART_CR1_M0      (1UL << 12)
+#define USART_CR1_OVER8   (1UL << 15)
+#define USART_CR1_M1      (1UL << 28)
+#define USART_CR1_M       (USART_CR1_M0 | USART_CR1_M1)
+
+#define USART_CR2_STOP_Pos 12U
+#define USART_CR2_STOP    (3UL << 12)
+#define USART_CR2_ABREN   (1UL << 20)
+#define USART_CR2_ABRMOD_Pos 21U
+#define USART_CR2_ABRMOD  (3UL << 21)
+#define USART_CR2_ABRMOD_0 (1UL << 21)
+#define USART_CR2_ABRMOD_1 (2UL << 21)
+
+#define USART_CR3_EIE     (1UL << 0)
+#define USART_CR3_DMAR    (1UL << 6)
+#define USART_CR3_DMAT    (1UL << 7)
+#define USART_CR3_OVRDIS  (1UL << 12)
+
+#define USART_ISR_PE      (1UL << 0)
+#define USART_ISR_FE      (1UL << 1)
+#define USART_ISR_NE      (1UL << 2)
+#define USART_ISR_ORE     (1UL << 3)
+#define USART_ISR_IDLE    (1UL << 4)
+#define USART_ISR_RXNE    (1UL << 5)
+#define USART_ISR_TC      (1UL << 6)
+#define USART_ISR_TXE     (1UL << 7)
+#define USART_ISR_ABRE    (1UL << 14)
+#define USART_ISR_ABRF    (1UL << 15)
+#define USART_ISR_BUSY    (1UL << 16)
+#define USART_ISR_TEACK   (1UL << 21)
+#define USART_ISR_REACK   (1UL << 22)
+
+#define USART_ICR_PECF    (1UL << 0)
+#define USART_ICR_FECF    (1UL << 1)
+#define USART_ICR_NCF     (1UL << 2)
+#define USART_ICR_ORECF   (1UL << 3)
+#define USART_ICR_IDLECF  (1UL << 4)
+#define USART_ICR_TCCF    (1UL << 6)
+
+#define USART_RQR_ABRRQ   (1UL << 0)
+#define USART_RQR_RXFRQ   (1UL << 3)
+#define USART_RQR_TXFRQ   (1UL << 4)
+
+#define USART_RDR_RDR     (0x1FFUL)
+#define USART_TDR_TDR     (0x1FFUL)
+
+#define RCC_AHB1ENR_GPIOAEN (1UL << 0)
+#define RCC_AHB1ENR_GPIOBEN (1UL << 1)
+#define RCC_AHB1ENR_GPIOCEN (1UL << 2)
+#define RCC_AHB1ENR_GPIODEN (1UL << 3)
+#define RCC_AHB1ENR_GPIOEEN (1UL << 4)
+#define RCC_AHB1ENR_CRCEN   (1UL << 12)
+#define RCC_AHB1ENR_DMA1EN  (1UL << 21)
+#define RCC_AHB1ENR_DMA2EN  (1UL << 22)
+#define RCC_APB1ENR_TIM6EN  (1UL << 4)
+#define RCC_APB1ENR_TIM7EN  (1UL << 5)
+#define RCC_APB1ENR_LPTIM1EN (1UL << 9)
+#define RCC_APB1ENR_USART2EN (1UL << 17)
+#define RCC_APB1ENR_USART3EN (1UL << 18)
+#define RCC_APB1ENR_UART4EN (1UL << 19)
+#define RCC_APB1ENR_UART5EN (1UL << 20)
+#define RCC_APB1ENR_PWREN   (1UL << 28)
+#define RCC_APB1ENR_UART7EN (1UL << 30)
+#define RCC_APB1ENR_UART8EN (1UL << 31)
+#define RCC_APB2ENR_TIM1EN  (1UL << 0)
+#define RCC_APB2ENR_TIM8EN  (1UL << 1)
+#define RCC_APB2ENR_USART1EN (1UL << 4)
+#define RCC_APB2ENR_USART6EN (1UL << 5)
+#define RCC_APB2ENR_SYSCFGEN (1UL << 14)
+
+#define CRC_CR_RESET        (1UL << 0)
+#define CRC_CR_POLYSIZE     (3UL << 3)
+#define CRC_CR_REV_IN       (3UL << 5)
+#define CRC_CR_REV_IN_0     (1UL << 5)
+#define CRC_CR_REV_IN_1     (1UL << 6)
+#define CRC_CR_REV_OUT      (1UL << 7)
+
+#define RCC_CR_HSION        (1UL << 0)
+#define RCC_CR_HSIRDY       (1UL << 1)
+#define RCC_CR_HSEON        (1UL << 16)
+#define RCC_CR_HSERDY       (1UL << 17)
+#define RCC_CR_HSEBYP       (1UL << 18)
+#define RCC_CR_PLLON        (1UL << 24)
+#define RCC_CR_PLLRDY       (1UL << 25)
+
+#define RCC_BDCR_LSEON      (1UL << 0)
+#define RCC_BDCR_LSERDY     (1UL << 1)
+#define RCC_CSR_LSION       (1UL << 0)
+#define RCC_CSR_LSIRDY      (1UL << 1)
+
+// Kernel clocks: USARTs have two bits each from bit 0, in uart_id_t order
+#define RCC_DCKCFGR2_LPTIM1SEL   (3UL << 24)
+#define RCC_DCKCFGR2_LPTIM1SEL_0 (1UL << 24)
+#define RCC_DCKCFGR2_LPTIM1SEL_1 (2UL << 24)
+
+#define RCC_PLLCFGR_PLLM_Pos 0U
+#define RCC_PLLCFGR_PLLM    (0x3FUL << 0)
+#define RCC_PLLCFGR_PLLN_Pos 6U
+#define RCC_PLLCFGR_PLLN    (0x1FFUL << 6)
+#define RCC_PLLCFGR_PLLP_Pos 16U
+#define RCC_PLLCFGR_PLLP    (3UL << 16)
+#define RCC_PLLCFGR_PLLSRC  (1UL << 22)
+#define RCC_PLLCFGR_PLLSRC_HSE (1UL << 22)
+#define RCC_PLLCFGR_PLLSRC_HSI 0UL
+#define RCC_PLLCFGR_PLLQ_Pos 24U
+#define RCC_PLLCFGR_PLLQ    (0xFUL << 24)
+#define RCC_PLLCFGR_PLLR_Pos 28U
+#define RCC_PLLCFGR_PLLR    (7UL << 28)
+
+#define RCC_CFGR_SW         (3UL << 0)
+#define RCC_CFGR_SW_HSI     0UL
+#define RCC_CFGR_SW_HSE     1UL
+#define RCC_CFGR_SW_PLL     2UL
+#define RCC_CFGR_SWS        (3UL << 2)
+#define RCC_CFGR_SWS_HSI    0UL
+#define RCC_CFGR_SWS_HSE    (1UL << 2)
+#define RCC_CFGR_SWS_PLL    (2UL << 2)
+#define RCC_CFGR_HPRE_Pos   4U
+#define RCC_CFGR_HPRE       (0xFUL << 4)
+#define RCC_CFGR_HPRE_DIV1  0UL
+#define RCC_CFGR_PPRE1_Pos  10U
+#define RCC_CFGR_PPRE1      (7UL << 10)
+#define RCC_CFGR_PPRE1_DIV1 0UL
+#define RCC_CFGR_PPRE1_DIV2 (4UL << 10)
+#define RCC_CFGR_PPRE1_DIV4 (5UL << 10)
+#define RCC_CFGR_PPRE2_Pos  13U
+#define RCC_CFGR_PPRE2      (7UL << 13)
+#define RCC_CFGR_PPRE2_DIV1 0UL
+#define RCC_CFGR_PPRE2_DIV2 (4UL << 13)
+
+#define PWR_CR1_LPDS        (1UL << 0)
+#define PWR_CR1_PDDS        (1UL << 1)
+#define PWR_CR1_DBP         (1UL << 8)
+#define PWR_CR1_FPDS        (1UL << 9)
+#define PWR_CR1_ODEN        (1UL << 16)
+#define PWR_CR1_ODSWEN      (1UL << 17)
+#define PWR_CR1_VOS         (3UL << 14)
+#define PWR_CSR1_ODRDY      (1UL << 16)
+#define PWR_CSR1_ODSWRDY    (1UL << 17)
+
+#define FLASH_ACR_LATENCY   (0xFUL << 0)
+#define FLASH_ACR_LATENCY_7WS 7UL
+#define FLASH_ACR_PRFTEN    (1UL << 8)
+#define FLASH_ACR_ARTEN     (1UL << 9)
+#define FLASH_ACR_ARTRST    (1UL << 11)
+
+#define FLASH_SR_EOP        (1UL << 0)
+#define FLASH_SR_OPERR      (1UL << 1)
+#define FLASH_SR_WRPERR     (1UL << 4)
+#define FLASH_SR_PGAERR     (1UL << 5)
+#define FLASH_SR_PGPERR     (1UL << 6)
+#define FLASH_SR_ERSERR     (1UL << 7)
+#define FLASH_SR_BSY        (1UL << 16)
+
+#define FLASH_CR_PG         (1UL << 0)
+#define FLASH_CR_SER        (1UL << 1)
+#define FLASH_CR_MER        (1UL << 2)
+#define FLASH_CR_SNB_Pos    3U
+#define FLASH_CR_SNB        (0x1FUL << 3)
+#define FLASH_CR_PSIZE      (3UL << 8)
+#define FLASH_CR_PSIZE_1    (2UL << 8)
+#define FLASH_CR_STRT       (1UL << 16)
+#define FLASH_CR_EOPIE      (1UL << 24)
+#define FLASH_CR_ERRIE      (1UL << 25)
+#define FLASH_CR_LOCK       (1UL << 31)
+
+#define FLASH_OPTCR_nDBANK  (1UL << 29)
+
+#define SYSCFG_MEMRMP_SWP_FB (1UL << 8)
+
+#define DMA_SxCR_EN       (1UL << 0)
+#define DMA_SxCR_DMEIE    (1UL << 1)
+#define DMA_SxCR_TEIE     (1UL << 2)
+#define DMA_SxCR_HTIE     (1UL << 3)
+#define DMA_SxCR_TCIE     (1UL << 4)
+#define DMA_SxCR_PFCTRL   (1UL << 5)
+#define DMA_SxCR_DIR_Pos  6U
+#define DMA_SxCR_DIR      (3UL << 6)
+#define DMA_SxCR_DIR_0    (1UL << 6)
+#define DMA_SxCR_DIR_1    (1UL << 7)
+#define DMA_SxCR_CIRC     (1UL << 8)
+#define DMA_SxCR_PINC     (1UL << 9)
+#define DMA_SxCR_MINC     (1UL << 10)
+#define DMA_SxCR_PSIZE_Pos 11U
+#define DMA_SxCR_PSIZE    (3UL << 11)
+#define DMA_SxCR_PSIZE_0  (1UL << 11)
+#define DMA_SxCR_PSIZE_1  (1UL << 12)
+#define DMA_SxCR_MSIZE_Pos 13U
+#define DMA_SxCR_MSIZE    (3UL << 13)
+#define DMA_SxCR_MSIZE_0  (1UL << 13)
+#define DMA_SxCR_MSIZE_1  (1UL << 14)
+#define DMA_SxCR_PL       (3UL << 16)
+#define DMA_SxCR_DBM      (1UL << 18)
+#define DMA_SxCR_CT       (1UL << 19)
+#define DMA_SxCR_CHSEL_Pos 25U
+#define DMA_SxCR_CHSEL    (0xFUL << 25)
+
+// Flag positions within LISR/HISR for streams 0/4, 1/5, 2/6, 3/7
+#define DMA_LISR_FEIF0    (1UL << 0)
+#define DMA_LISR_DMEIF0   (1UL << 2)
+#define DMA_LISR_TEIF0    (1UL << 3)
+#define DMA_LISR_HTIF0    (1UL << 4)
+#define DMA_LISR_TCIF0    (1UL << 5)
+#define DMA_LISR_FEIF1    (1UL << 6)
+#define DMA_LISR_DMEIF1   (1UL << 8)
+#define DMA_LISR_TEIF1    (1UL << 9)
+#define DMA_LISR_HTIF1    (1UL << 10)
+#define DMA_LISR_TCIF1    (1UL << 11)
+#define DMA_LISR_TEIF2    (1UL << 19)
+#define DMA_LISR_HTIF2    (1UL << 20)
+#define DMA_LISR_TCIF2    (1UL << 21)
+#define DMA_LISR_FEIF3    (1UL << 22)
+#define DMA_LISR_DMEIF3   (1UL << 24)
+#define DMA_LISR_TEIF3    (1UL << 25)
+#define DMA_LISR_HTIF3    (1UL << 26)
+#define DMA_LISR_TCIF3    (1UL << 27)
+#define DMA_LIFCR_CFEIF1  (1UL << 6)
+#define DMA_LIFCR_CDMEIF1 (1UL << 8)
+#define DMA_LIFCR_CTEIF1  (1UL << 9)
+#define DMA_LIFCR_CHTIF1  (1UL << 10)
+#define DMA_LIFCR_CTCIF1  (1UL << 11)
+#define DMA_LIFCR_CFEIF3  (1UL << 22)
+#define DMA_LIFCR_CDMEIF3 (1UL << 24)
+#define DMA_LIFCR_CTEIF3  (1UL << 25)
+#define DMA_LIFCR_CHTIF3  (1UL << 26)
+#define DMA_LIFCR_CTCIF3  (1UL << 27)
+#define DMA_HISR_FEIF5    (1UL << 6)
+#define DMA_HISR_DMEIF5   (1UL << 8)
+#define DMA_HISR_TEIF5    (1UL << 9)
+#define DMA_HISR_HTIF5    (1UL << 10)
+#define DMA_HISR_TCIF5    (1UL << 11)
+#define DMA_HIFCR_CFEIF5  (1UL << 6)
+#define DMA_HIFCR_CDMEIF5 (1UL << 8)
+#define DMA_HIFCR_CTEIF5  (1UL << 9)
+#define DMA_HIFCR_CHTIF5  (1UL << 10)
+#define DMA_HIFCR_CTCIF5  (1UL << 11)
+
+#define SYSCFG_EXTICR3_EXTI9     (0xFUL << 4)
+#define SYSCFG_EXTICR3_EXTI9_PD  (3UL << 4)
+#define SYSCFG_EXTICR4_EXTI13    (0xFUL << 4)
+#define SYSCFG_EXTICR4_EXTI13_PC (2UL << 4)
+
+#define TIM_CR1_CEN       (1UL << 0)
+#define TIM_CR1_UDIS      (1UL << 1)
+#define TIM_CR1_URS       (1UL << 2)
+#define TIM_CR1_OPM       (1UL << 3)
+#define TIM_CR1_ARPE      (1UL << 7)
+#define TIM_DIER_UIE      (1UL << 0)
+#define TIM_SR_UIF        (1UL << 0)
+#define TIM_DIER_UDE      (1UL << 8)
+#define TIM_EGR_UG        (1UL << 0)
+
+#define LPTIM_ISR_CMPM    (1UL << 0)
+#define LPTIM_ISR_ARRM    (1UL << 1)
+#define LPTIM_ISR_CMPOK   (1UL << 3)
+#define LPTIM_ISR_ARROK   (1UL << 4)
+#define LPTIM_ICR_CMPMCF  (1UL << 0)
+#define LPTIM_ICR_ARRMCF  (1UL << 1)
+#define LPTIM_ICR_CMPOKCF (1UL << 3)
+#define LPTIM_ICR_ARROKCF (1UL << 4)
+#define LPTIM_IER_CMPMIE  (1UL << 0)
+#define LPTIM_IER_ARRMIE  (1UL << 1)
+#define LPTIM_CFGR_PRESC_Pos 9U
+#define LPTIM_CFGR_PRESC  (7UL << 9)
+#define LPTIM_CR_ENABLE   (1UL << 0)
+#define LPTIM_CR_SNGSTRT  (1UL << 1)
+#define LPTIM_CR_CNTSTRT  (1UL << 2)
+
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL << 0)
+
+#define SysTick_CTRL_ENABLE_Msk    (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk   (1UL << 1)
+#define SysTick_CTRL_CLKSOURCE_Msk (1UL << 2)
+#define SysTick_CTRL_COUNTFLAG_Msk (1UL << 16)
+#define SysTick_LOAD_RELOAD_Msk    (0xFFFFFFUL)
+#define SysTick_VAL_CURRENT_Msk    (0xFFFFFFUL)
+
+#define SCB_ICSR_PENDSTCLR_Msk     (1UL << 25)
+#define SCB_ICSR_PENDSTSET_Msk     (1UL << 26)
+#define SCB_ICSR_PENDSVCLR_Msk     (1UL << 27)
+#define SCB_ICSR_PENDSVSET_Msk     (1UL << 28)
+
+#define SCB_SCR_SLEEPDEEP_Msk      (1UL << 2)
+
+#define SCB_CCR_DC_Msk             (1UL << 16)
+#define SCB_CCR_IC_Msk             (1UL << 17)
+
+#define SCB_SHCSR_MEMFAULTENA_Msk  (1UL << 16)
+#define SCB_CFSR_MSTKERR_Msk       (1UL << 4)
+#define SCB_CFSR_MMARVALID_Msk     (1UL << 7)
+
+#define FPU_FPCCR_LSPACT_Msk       (1UL << 0)
+#define FPU_FPCCR_LSPEN_Msk        (1UL << 30)
+#define FPU_FPCCR_ASPEN_Msk        (1UL << 31)
+
+#define MPU_TYPE_DREGION_Pos       8U
+#define MPU_TYPE_DREGION_Msk       (0xFFUL << 8)
+#define MPU_CTRL_ENABLE_Msk        (1UL << 0)
+#define MPU_CTRL_HFNMIENA_Msk      (1UL << 1)
+#define MPU_CTRL_PRIVDEFENA_Msk    (1UL << 2)
+#define MPU_RASR_ENABLE_Msk        (1UL << 0)
+#define MPU_RASR_SIZE_Pos          1U
+#define MPU_RASR_SRD_Pos           8U
+#define MPU_RASR_B_Msk             (1UL << 16)
+#define MPU_RASR_C_Msk             (1UL << 17)
+#define MPU_RASR_S_Msk             (1UL << 18)
+#define MPU_RASR_TEX_Pos           19U
+#define MPU_RASR_AP_Pos            24U
+#define MPU_RASR_XN_Msk            (1UL << 28)
+
+/* ----------------------------------------------------------------------
+ * Register access macros (stm32f7xx.h)
+ */
+
+#define SET_BIT(REG, BIT)     ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)   ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)    ((REG) & (BIT))
+#define CLEAR_REG(REG)        ((REG) = (0x0))
+#define WRITE_REG(REG, VAL)   ((REG) = (VAL))
+#define READ_REG(REG)         ((REG))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) \
+  WRITE_REG((REG), (((READ_REG(REG)) & (~(CLEARMASK))) | (SETMASK)))
+
+/* ----------------------------------------------------------------------
+ * Core intrinsics and NVIC (cmsis_gcc.h / core_cm7.h)
+ *
+ * Each one costs a cycle of simulated time and gives pending interrupts
+ * a chance to run. __NOP() and __WFI() are treated as idle hints: time
+ * jumps ahead to the next peripheral event, which keeps spin-waits on
+ * RAM flags from crawling one cycle at a time.
+ */
+
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_IPSR(void);
+void __NOP(void);
+void __WFI(void);
+void __DMB(void);
+void __DSB(void);
+void __ISB(void);
+
+// L1 cache control (core_cm7.h): only tracked in SCB->CCR, there are no caches
+void SCB_EnableICache(void);
+void SCB_DisableICache(void);
+void SCB_EnableDCache(void);
+void SCB_DisableDCache(void);
+void SCB_CleanDCache(void);
+void SCB_InvalidateDCache(void);
+void SCB_CleanDCache_by_Addr(uint32_t *addr, int32_t dsize);
+void SCB_InvalidateDCache_by_Addr(uint32_t *addr, int32_t dsize);
+
+// The host keeps its own stack: only the loader's jump uses this
+void __set_MSP(uint32_t top);
+
+/* DSP extension intrinsics (cmsis_gcc.h): Arm v7-M ARM Sec A7.7. Plain
+   arithmetic on the host, taking no simulated time. The GE flags that
+   __SSUB16 sets, for __SEL, are kept in sim_apsr_ge. */
+extern uint32_t sim_apsr_ge;
+
+static inline int32_t sim_sat(int64_t v, uint32_t bits) {
+  int64_t max = (1LL << (bits - 1U)) - 1, min = -(1LL << (bits - 1U));
+  return (int32_t)(v > max ? max : v < min ? min : v);
+}
+
+static inline int32_t sim_lo(uint32_t v) { return (int16_t)(v & 0xFFFFU); }
+static inline int32_t sim_hi(uint32_t v) { return (int16_t)(v >> 16); }
+
+static inline uint32_t sim_pack(int32_t lo, int32_t hi) {
+  return ((uint32_t)lo & 0xFFFFU) | ((uint32_t)hi << 16);
+}
+
+static inline uint32_t __RBIT(uint32_t v) {
+  uint32_t r = 0;
+  for (unsigned i = 0; i < 32U; i++, v >>= 1) r = (r << 1) | (v & 1U);
+  return r;
+}
+
+static inline int32_t __SSAT(int32_t v, uint32_t bits) { return sim_sat(v, bits); }
+
+static inline uint32_t __SSAT16(uint32_t v, uint32_t bits) {
+  return sim_pack(sim_sat(sim_lo(v), bits), sim_sat(sim_hi(v), bits));
+}
+
+static inline uint32_t __QADD16(uint32_t a, uint32_t b) {
+  return sim_pack(sim_sat(sim_lo(a) + sim_lo(b), 16), sim_sat(sim_hi(a) + sim_hi(b), 16));
+}
+
+static inline uint32_t __SSUB16(uint32_t a, uint32_t b) {
+  int32_t lo = sim_lo(a) - sim_lo(b), hi = sim_hi(a) - sim_hi(b);
+  sim_apsr_ge = (lo >= 0 ? 0x3U : 0U) | (hi >= 0 ? 0xCU : 0U);
+  return sim_pack(lo, hi);
+}
+
+static inline uint32_t __SEL(uint32_t a, uint32_t b) {
+  uint32_t r = 0;
+  for (unsigned i = 0; i < 4; i++) {
+    r |= ((sim_apsr_ge >> i) & 1U ? a : b) & (0xFFUL << (8U * i));
+  }
+  return r;
+}
+
+static inline uint32_t __SMLAD(uint32_t a, uint32_t b, uint32_t acc) {
+  return acc + (uint32_t)(sim_lo(a) * sim_lo(b)) + (uint32_t)(sim_hi(a) * sim_hi(b));
+}
+
+static inline uint32_t __SMLSD(uint32_t a, uint32_t b, uint32_t acc) {
+  return acc + (uint32_t)(sim_lo(a) * sim_lo(b)) - (uint32_t)(sim_hi(a) * sim_hi(b));
+}
+
+static inline uint64_t __SMLALD(uint32_t a, uint32_t b, uint64_t acc) {
+  return acc + (uint64_t)((int64_t)sim_lo(a) * sim_lo(b) + (int64_t)sim_hi(a) * sim_hi(b));
+}
+
+#define __PKHBT(ARG1, ARG2, ARG3) \
+  ((((uint32_t)(ARG1)) & 0x0000FFFFUL) | ((((uint32_t)(ARG2)) << (ARG3)) & 0xFFFF0000UL))
+#define __PKHTB(ARG1, ARG2, ARG3) \
+  ((((uint32_t)(ARG1)) & 0xFFFF0000UL) | ((((uint32_t)(ARG2)) >> (ARG3)) & 0x0000FFFFUL))
+
+void NVIC_EnableIRQ(IRQn_Type irqn);
+void NVIC_DisableIRQ(IRQn_Type irqn);
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority);
+uint32_t NVIC_GetPriority(IRQn_Type irqn);
+// 1 while irqn's handler is running, preempted or not
+uint32_t NVIC_GetActive(IRQn_Type irqn);
+// Ends the simulation: there is nothing to come back to
+void NVIC_SystemReset(void) __attribute__((noreturn));
+
+/* ----------------------------------------------------------------------
+ * Host plumbing
+ *
+ * printf() in the drivers would otherwise go straight to the host's
+ * stdout; send it through _write() and the simulated console instead.
+ */
+
+#ifndef SIM_SIDE_INCLUDE
+int sim_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+#define printf sim_printf
+#endif
+
+#endif /* SIM_STM32F7XX_H_ */
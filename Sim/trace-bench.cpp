@@ -0,0 +1,209 @@
+/*
+ * trace-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * TRACE() records against console_printf() text on the simulated USART3.
+ *
+ * First a mix of events, with console text in between, is sent as trace
+ * records; the bytes leaving the TX pin are decoded with this program's
+ * own trace_fmt section and must give back exactly what fmt_snprintf()
+ * makes of the same events, and the text untouched. Then the same
+ * events are sent as records and as text, and the line time and bytes
+ * per event of the two are compared.
+ *
+ * Usage: trace-bench [--events N] [--check]
+ *   --check  exit with status 1 if the decoded stream differs or records
+ *            are not at least MIN_SAVING times smaller than the text
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "clock.h"
+#include "console.h"
+#include "fmt.h"
+#include "trace.h"
+#include "trace-host.h"
+#include "uart.h"
+
+// Drivers from Src/main.c (which has no header of its own)
+void uart3_rxtx_init(void);
+
+#define MIN_SAVING 3.0
+#define CAPTURE_MAX (16U << 20)
+
+// The events: the same arguments go to TRACE() and to fmt_snprintf()
+// and read like what firmware logs
+#define EVENTS(X, i) \
+  X("sched: watchdog kicked"); \
+  X("sched: timer %u ran %lu cycles late, period %lu ticks", \
+    (i) % 7U, (unsigned long)((i) * 37U % 5000U), 10UL * ((i) % 5U + 1U)); \
+  X("adc: channel %u reads %4d mV (%d below threshold)", \
+    (i) % 16U, (int)((i) * 13U % 3300U), -(int)((i) % 3U)); \
+  X("usart3: status %08lx, %u bytes queued, %u dropped", \
+    (unsigned long)((i) * 2654435761U), (i) % 1024U, 0U); \
+  X("motor: state %c -> %c after %lu us", 'A' + (int)((i) % 4U), \
+    'A' + (int)(((i) + 1U) % 4U), (unsigned long)((i) * 3U % 900U)); \
+  X("dma: [%*d] [%-.*x] buffer at %p done %%", 6, (int)(i), 4, (i), \
+    (void *)(uintptr_t)((i) & 1U ? 0x20000000U + (i) : 0U))
+
+static uint8_t *capture;
+static size_t captured;
+
+static char *expect, *got;
+static size_t expect_len, got_len;
+
+static void to_capture(USART_TypeDef *usart, uint8_t c) {
+  (void)usart;
+  if (captured < CAPTURE_MAX) capture[captured++] = c;
+}
+
+static void add(char *buf, size_t *len, const char *s, size_t n) {
+  if (*len + n < CAPTURE_MAX) {
+    memcpy(buf + *len, s, n);
+    *len += n;
+  }
+}
+
+// Records are marked so that they cannot pass for text
+static void add_record(char *buf, size_t *len, const char *text) {
+  add(buf, len, "\x01", 1);
+  add(buf, len, text, strlen(text));
+  add(buf, len, "\n", 1);
+}
+
+static void got_record(trace_decoder_t *d, uint64_t time, const char *text) {
+  (void)d;
+  (void)time;
+  add_record(got, &got_len, text);
+}
+
+static void got_text(trace_decoder_t *d, const uint8_t *buf, size_t len) {
+  (void)d;
+  add(got, &got_len, (const char *)buf, len);
+}
+
+// Never let a record be dropped: wait for the ISR to make room
+static void wait_room(void) {
+  while (uart_tx_free(uart_port(UART_USART3)) < 64U) __WFI();
+}
+
+#define TRACE_AND_EXPECT(...) do { \
+    char line_[160]; \
+    wait_room(); \
+    TRACE(__VA_ARGS__); \
+    fmt_snprintf(line_, sizeof(line_), __VA_ARGS__); \
+    add_record(expect, &expect_len, line_); \
+  } while (0)
+
+#define TRACE_ONLY(...) do { wait_room(); TRACE(__VA_ARGS__); } while (0)
+#define TEXT_ONLY(...) do { console_printf(__VA_ARGS__); console_printf("\r\n"); } while (0)
+
+static void run_line(const char *what, uint32_t events, uint64_t bytes,
+                     const sim_counters_t *a, const sim_counters_t *b) {
+  double secs = (double)(b->cycles - a->cycles) / sim_core_hz;
+  printf("%-8s %8lu %10llu %9.1f %12.0f %10.1f\n", what, (unsigned long)events,
+         (unsigned long long)bytes, (double)bytes / events, events / secs,
+         (double)(b->reg_accesses - a->reg_accesses) / events);
+}
+
+int main(int argc, char **argv) {
+  uint32_t rounds = 500;
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--events") && i + 1 < argc) {
+      rounds = (uint32_t)strtoul(argv[++i], NULL, 0) / 6U + 1U;
+    } else if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--events N] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  capture = (uint8_t *)malloc(CAPTURE_MAX);
+  expect = (char *)malloc(CAPTURE_MAX);
+  got = (char *)malloc(CAPTURE_MAX);
+  trace_elf_t elf;
+  if (!capture || !expect || !got || trace_elf_load(&elf, "/proc/self/exe")) return 1;
+
+  sim_reset();
+  sim_usart_set_tx_sink(USART3, to_capture);
+  clock_init();
+  uart3_rxtx_init();
+  console_init();
+  trace_init();
+
+  // Records and text, decoded again
+  size_t text_total = 0;
+  for (uint32_t i = 0; i < rounds; i++) {
+    EVENTS(TRACE_AND_EXPECT, i);
+    if (i % 16U == 0) {
+      char text[64];
+      int n = fmt_snprintf(text, sizeof(text), "console text %lu\r\n", (unsigned long)i);
+      console_printf("%s", text);
+      add(expect, &expect_len, text, (size_t)n);
+      text_total += (size_t)n;
+    }
+  }
+  console_flush();
+
+  trace_decoder_t d;
+  trace_decoder_init(&d, &elf);
+  d.record = got_record;
+  d.text = got_text;
+  trace_decode(&d, capture, captured);
+  trace_decode_flush(&d);
+
+  int ok = got_len == expect_len && !memcmp(got, expect, got_len);
+  printf("%lu records and %lu bytes of text decoded: %s\n",
+         (unsigned long)d.records, (unsigned long)text_total,
+         ok ? "identical" : "DIFFERENT");
+  if (!ok) {
+    size_t k = 0;
+    while (k < got_len && k < expect_len && got[k] == expect[k]) k++;
+    printf("first difference at byte %lu:\n  expected \"%.60s\"\n  decoded  \"%.60s\"\n",
+           (unsigned long)k, expect + k, got + k);
+  }
+
+  // The same events as records and as text
+  uint32_t events = rounds * 6U;
+  printf("\nUSART3 line rate %.0f bytes/s\n%-8s %8s %10s %9s %12s %10s\n",
+         (double)sim_core_hz / (double)sim_usart_frame_cycles(USART3),
+         "as", "events", "bytes", "B/event", "events/s", "regs/event");
+
+  sim_counters_t a = sim_count;
+  uint64_t t0 = sim_usart_tx_count(USART3);
+  for (uint32_t i = 0; i < rounds; i++) { EVENTS(TRACE_ONLY, i); }
+  console_flush();
+  sim_counters_t b = sim_count;
+  uint64_t trace_bytes = sim_usart_tx_count(USART3) - t0;
+  run_line("trace", events, trace_bytes, &a, &b);
+
+  a = sim_count;
+  t0 = sim_usart_tx_count(USART3);
+  for (uint32_t i = 0; i < rounds; i++) { EVENTS(TEXT_ONLY, i); }
+  console_flush();
+  b = sim_count;
+  uint64_t text_bytes = sim_usart_tx_count(USART3) - t0;
+  run_line("text", events, text_bytes, &a, &b);
+
+  double saving = (double)text_bytes / (double)trace_bytes;
+  printf("\nrecords are %.1fx smaller; %lu dropped\n", saving,
+         (unsigned long)trace_stats()->dropped);
+
+  trace_elf_free(&elf);
+  if (check && (!ok || saving < MIN_SAVING || trace_stats()->dropped)) {
+    fprintf(stderr, "FAIL: trace stream did not decode, or records are not %.0fx smaller\n",
+            MIN_SAVING);
+    return 1;
+  }
+  return 0;
+}
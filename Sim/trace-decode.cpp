@@ -0,0 +1,111 @@
+/*
+ * trace-decode.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Turns the console byte stream of a firmware that uses TRACE() back
+ * into text, with the format strings from its ELF file.
+ *
+ * Usage: trace-decode [--hz HZ] [--raw] FIRMWARE.elf [STREAM]
+ *   STREAM  a capture file, a serial port or a pseudo-terminal; stdin if
+ *           not given. Serial ports are read as they are (set the baud
+ *           rate with stty first).
+ *   --hz    core clock for the timestamps (default 216000000)
+ *   --raw   print timestamps in cycles rather than seconds
+ *
+ * Each record is printed on its own line as "[time] text"; console text
+ * between records is copied through unchanged.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace-host.h"
+
+// A pause this long ends any text held back as a possible record
+#define QUIET_MS 100
+
+static double hz = 216000000.0;
+static int raw;
+
+static void print_record(trace_decoder_t *d, uint64_t time, const char *text) {
+  (void)d;
+  if (raw) {
+    printf("[%12llu] %s\n", (unsigned long long)time, text);
+  } else {
+    printf("[%12.6f] %s\n", (double)time / hz, text);
+  }
+  fflush(stdout);
+}
+
+static void print_text(trace_decoder_t *d, const uint8_t *buf, size_t len) {
+  (void)d;
+  fwrite(buf, 1, len, stdout);
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  const char *elf_path = NULL;
+  const char *stream = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--hz") && i + 1 < argc) {
+      hz = strtod(argv[++i], NULL);
+    } else if (!strcmp(argv[i], "--raw")) {
+      raw = 1;
+    } else if (argv[i][0] != '-' && !elf_path) {
+      elf_path = argv[i];
+    } else if (argv[i][0] != '-' && !stream) {
+      stream = argv[i];
+    } else {
+      elf_path = NULL;
+      break;
+    }
+  }
+  if (!elf_path || hz <= 0.0) {
+    fprintf(stderr, "usage: %s [--hz HZ] [--raw] FIRMWARE.elf [STREAM]\n", argv[0]);
+    return 2;
+  }
+
+  trace_elf_t elf;
+  if (trace_elf_load(&elf, elf_path)) return 1;
+
+  int fd = STDIN_FILENO;
+  if (stream && (fd = open(stream, O_RDONLY | O_NOCTTY)) < 0) {
+    fprintf(stderr, "%s: %s\n", stream, strerror(errno));
+    return 1;
+  }
+
+  trace_decoder_t d;
+  trace_decoder_init(&d, &elf);
+  d.record = print_record;
+  d.text = print_text;
+
+  uint8_t buf[4096];
+  for (;;) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int r = poll(&pfd, 1, QUIET_MS);
+    if (r < 0 && errno == EINTR) continue;
+    if (r == 0) {
+      trace_decode_flush(&d);
+      continue;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+    if (n <= 0) break;
+    trace_decode(&d, buf, (size_t)n);
+  }
+  trace_decode_flush(&d);
+
+  fprintf(stderr, "%lu records\n", (unsigned long)d.records);
+  trace_elf_free(&elf);
+  return 0;
+}
@@ -0,0 +1,333 @@
+/*
+ * trace-host.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See trace-host.h, and Src/trace.h for the record format.
+ */
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace-host.h"
+
+#define TRACE_SECTION "trace_fmt"
+#define TS_SHIFT_TAG  "TRACE_TS_SHIFT="
+
+static uint8_t *read_file(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return NULL;
+  size_t cap = 1U << 20, len = 0;
+  uint8_t *buf = (uint8_t *)malloc(cap);
+  size_t n;
+  while (buf && (n = fread(buf + len, 1, cap - len, f)) > 0) {
+    len += n;
+    if (len == cap) buf = (uint8_t *)realloc(buf, cap *= 2U);
+  }
+  fclose(f);
+  *size = len;
+  return buf;
+}
+
+// Section headers of either class, as 64-bit values
+typedef struct {
+  uint32_t name, type;
+  uint64_t offset, size;
+} shdr_t;
+
+static int get_shdr(const uint8_t *img, size_t size, int is64, uint64_t shoff,
+                    uint32_t shentsize, uint32_t i, shdr_t *sh) {
+  uint64_t at = shoff + (uint64_t)i * shentsize;
+  if (is64) {
+    Elf64_Shdr s;
+    if (at + sizeof(s) > size) return -1;
+    memcpy(&s, img + at, sizeof(s));
+    sh->name = s.sh_name; sh->type = s.sh_type; sh->offset = s.sh_offset; sh->size = s.sh_size;
+  } else {
+    Elf32_Shdr s;
+    if (at + sizeof(s) > size) return -1;
+    memcpy(&s, img + at, sizeof(s));
+    sh->name = s.sh_name; sh->type = s.sh_type; sh->offset = s.sh_offset; sh->size = s.sh_size;
+  }
+  return sh->type == SHT_NOBITS || sh->offset + sh->size <= size ? 0 : -1;
+}
+
+int trace_elf_load(trace_elf_t *elf, const char *path) {
+  size_t size;
+  uint8_t *img = read_file(path, &size);
+  elf->fmt = NULL;
+  elf->fmt_size = 0;
+  elf->ts_shift = 0;
+  if (!img) {
+    fprintf(stderr, "%s: cannot read\n", path);
+    return -1;
+  }
+
+  int ok = 0;
+  if (size >= EI_NIDENT && !memcmp(img, ELFMAG, SELFMAG) && img[EI_DATA] == ELFDATA2LSB) {
+    int is64 = img[EI_CLASS] == ELFCLASS64;
+    uint64_t shoff;
+    uint32_t shentsize, shnum, shstrndx;
+    if (is64 && size >= sizeof(Elf64_Ehdr)) {
+      Elf64_Ehdr h;
+      memcpy(&h, img, sizeof(h));
+      shoff = h.e_shoff; shentsize = h.e_shentsize; shnum = h.e_shnum; shstrndx = h.e_shstrndx;
+    } else if (!is64 && size >= sizeof(Elf32_Ehdr)) {
+      Elf32_Ehdr h;
+      memcpy(&h, img, sizeof(h));
+      shoff = h.e_shoff; shentsize = h.e_shentsize; shnum = h.e_shnum; shstrndx = h.e_shstrndx;
+    } else {
+      shoff = shentsize = shnum = shstrndx = 0;
+    }
+
+    shdr_t names;
+    if (shnum && !get_shdr(img, size, is64, shoff, shentsize, shstrndx, &names)) {
+      for (uint32_t i = 0; i < shnum; i++) {
+        shdr_t sh;
+        if (get_shdr(img, size, is64, shoff, shentsize, i, &sh) || sh.name >= names.size) continue;
+        const char *name = (const char *)img + names.offset + sh.name;
+        if (strncmp(name, TRACE_SECTION, names.size - sh.name) || sh.type == SHT_NOBITS) continue;
+        elf->fmt = (char *)malloc(sh.size + 1U);
+        memcpy(elf->fmt, img + sh.offset, sh.size);
+        elf->fmt[sh.size] = '\0'; // In case the last string is cut off
+        elf->fmt_size = (uint32_t)sh.size;
+        ok = 1;
+        for (uint32_t k = 0; k < elf->fmt_size; k += (uint32_t)strlen(elf->fmt + k) + 1U) {
+          if (!strncmp(elf->fmt + k, TS_SHIFT_TAG, strlen(TS_SHIFT_TAG))) {
+            elf->ts_shift = (uint32_t)strtoul(elf->fmt + k + strlen(TS_SHIFT_TAG), NULL, 10);
+          }
+        }
+        break;
+      }
+    }
+    if (!ok) fprintf(stderr, "%s: no " TRACE_SECTION " section\n", path);
+  } else {
+    fprintf(stderr, "%s: not a little-endian ELF file\n", path);
+  }
+
+  free(img);
+  return ok ? 0 : -1;
+}
+
+void trace_elf_free(trace_elf_t *elf) {
+  free(elf->fmt);
+  elf->fmt = NULL;
+  elf->fmt_size = 0;
+}
+
+// One conversion through the host snprintf(), with the * values if any
+#define PUT(V) do { \
+    int put_n_ = star_w && star_p ? snprintf(tmp, sizeof(tmp), spec, w, p, V) \
+               : star_w ? snprintf(tmp, sizeof(tmp), spec, w, V) \
+               : star_p ? snprintf(tmp, sizeof(tmp), spec, p, V) \
+               : snprintf(tmp, sizeof(tmp), spec, V); \
+    append(out, size, &o, tmp, put_n_ < 0 ? 0U : (size_t)put_n_); \
+  } while (0)
+
+static void append(char *out, size_t size, size_t *o, const char *s, size_t n) {
+  if (*o + 1U < size) {
+    size_t room = size - 1U - *o;
+    memcpy(out + *o, s, n < room ? n : room);
+  }
+  *o += n;
+}
+
+uint32_t trace_format(char *out, size_t size, const char *fmt,
+                      const uint32_t *args, uint32_t n) {
+  size_t o = 0;
+  uint32_t k = 0;
+  char tmp[256];
+#define NEXT_ARG() (k < n ? args[k++] : (k++, 0U))
+
+  while (*fmt) {
+    if (*fmt != '%') {
+      append(out, size, &o, fmt++, 1);
+      continue;
+    }
+    fmt++;
+
+    // Rebuild the conversion without length modifiers: every value is 32 bits
+    char spec[32];
+    size_t sl = 0;
+    int star_w = 0, star_p = 0, w = 0, p = 0;
+    spec[sl++] = '%';
+    while (*fmt && strchr("-+ #0", *fmt) && sl < 8U) spec[sl++] = *fmt++;
+    if (*fmt == '*') {
+      star_w = 1;
+      w = (int32_t)NEXT_ARG();
+      spec[sl++] = *fmt++;
+    }
+    while (*fmt >= '0' && *fmt <= '9' && sl < 16U) spec[sl++] = *fmt++;
+    if (*fmt == '.') {
+      spec[sl++] = *fmt++;
+      if (*fmt == '*') {
+        star_p = 1;
+        p = (int32_t)NEXT_ARG();
+        spec[sl++] = *fmt++;
+      }
+      while (*fmt >= '0' && *fmt <= '9' && sl < 24U) spec[sl++] = *fmt++;
+    }
+    while (*fmt && strchr("hlLqjzt", *fmt)) fmt++;
+
+    char conv = *fmt;
+    if (!conv) break;
+    fmt++;
+    if (conv == '%') {
+      append(out, size, &o, "%", 1);
+      continue;
+    }
+
+    uint32_t v = NEXT_ARG();
+    switch (conv) {
+    case 'd':
+    case 'i':
+      spec[sl++] = 'd';
+      spec[sl] = '\0';
+      PUT((int)(int32_t)v);
+      break;
+    case 'u': case 'o': case 'x': case 'X':
+      spec[sl++] = conv;
+      spec[sl] = '\0';
+      PUT((unsigned)v);
+      break;
+    case 'c':
+      spec[sl++] = 'c';
+      spec[sl] = '\0';
+      PUT((int)(uint8_t)v);
+      break;
+    case 'p':
+      if (v == 0) {
+        spec[sl++] = 's';
+        spec[sl] = '\0';
+        PUT("(nil)");
+      } else {
+        memmove(spec + 2, spec + 1, sl - 1U);
+        spec[1] = '#';
+        sl++;
+        spec[sl++] = 'x';
+        spec[sl] = '\0';
+        PUT((unsigned)v);
+      }
+      break;
+    default:
+      // Not deferrable (see trace.h): show the raw value
+      snprintf(tmp, sizeof(tmp), "<%%%c 0x%08x>", conv, (unsigned)v);
+      append(out, size, &o, tmp, strlen(tmp));
+      break;
+    }
+  }
+#undef NEXT_ARG
+
+  if (size) out[o < size ? o : size - 1U] = '\0';
+  return k;
+}
+
+void trace_decoder_init(trace_decoder_t *d, const trace_elf_t *elf) {
+  memset(d, 0, sizeof(*d));
+  d->elf = elf;
+}
+
+static int get_varint(const uint8_t **p, const uint8_t *end, uint32_t *v) {
+  uint32_t x = 0;
+  for (unsigned shift = 0; shift < 35U; shift += 7U) {
+    if (*p == end) return 0;
+    uint8_t b = *(*p)++;
+    x |= (uint32_t)(b & 0x7FU) << shift;
+    if (!(b & 0x80U)) {
+      *v = x;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Decode the held chunk as a record; 0 if it is not one
+static int try_record(trace_decoder_t *d) {
+  uint8_t rec[TRACE_HOST_FRAME_MAX];
+  uint32_t rl = 0;
+
+  // COBS: each code byte says how far it is to the next (implied) zero
+  uint32_t i = 0;
+  while (i < d->len) {
+    uint8_t code = d->chunk[i++];
+    if (i - 1U + code > d->len) return 0;
+    for (uint32_t k = 1; k < code; k++) rec[rl++] = d->chunk[i++];
+    if (code < 0xFFU && i < d->len) rec[rl++] = 0;
+  }
+  if (rl < 3U) return 0;
+
+  uint8_t check = 0;
+  for (uint32_t k = 0; k + 1U < rl; k++) check ^= rec[k];
+  if (check != rec[rl - 1U]) return 0;
+
+  const uint8_t *p = rec, *end = rec + rl - 1U;
+  uint32_t id;
+  if (!get_varint(&p, end, &id) || !d->elf->fmt || id >= d->elf->fmt_size) return 0;
+  if (id && d->elf->fmt[id - 1U] != '\0') return 0;
+  const char *fmt = d->elf->fmt + id;
+
+  // How many arguments the format takes
+  uint32_t need = trace_format(NULL, 0, fmt, NULL, 0);
+  uint32_t args[64];
+  if (need > 64U) return 0;
+  for (uint32_t k = 0; k < need; k++) {
+    uint32_t z;
+    if (!get_varint(&p, end, &z)) return 0;
+    args[k] = (z >> 1) ^ (0U - (z & 1U));
+  }
+  uint32_t delta;
+  if (!get_varint(&p, end, &delta) || p != end) return 0;
+
+  char text[1024];
+  trace_format(text, sizeof(text), fmt, args, need);
+  d->time += (uint64_t)delta << d->elf->ts_shift;
+  d->records++;
+  if (d->record) d->record(d, d->time, text);
+  return 1;
+}
+
+static void pass_text(trace_decoder_t *d, const uint8_t *buf, size_t len) {
+  if (len && d->text) d->text(d, buf, len);
+}
+
+void trace_decode(trace_decoder_t *d, const uint8_t *buf, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    if (buf[i] == 0) {
+      if (!d->long_text && d->len && !try_record(d)) pass_text(d, d->chunk, d->len);
+      d->len = 0;
+      d->long_text = 0;
+      i++;
+      continue;
+    }
+
+    // The run of bytes up to the next delimiter
+    size_t j = i;
+    while (j < len && buf[j] != 0) j++;
+    if (!d->long_text && d->len + (j - i) > sizeof(d->chunk)) {
+      pass_text(d, d->chunk, d->len);
+      d->len = 0;
+      d->long_text = 1;
+    }
+    if (d->long_text) {
+      pass_text(d, buf + i, j - i);
+    } else {
+      memcpy(d->chunk + d->len, buf + i, j - i);
+      d->len += (uint32_t)(j - i);
+    }
+    i = j;
+  }
+}
+
+void trace_decode_flush(trace_decoder_t *d) {
+  if (!d->long_text && d->len) {
+    pass_text(d, d->chunk, d->len);
+    d->len = 0;
+    d->long_text = 1;
+  }
+}
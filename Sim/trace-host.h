@@ -0,0 +1,67 @@
+/*
+ * trace-host.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Host side of the binary trace log (Src/trace.h): reads the format
+ * strings out of the firmware ELF and turns a captured byte stream back
+ * into text. Used by trace-decode and trace-bench.
+ *
+ * The stream may mix records with ordinary console text: anything
+ * between two 0x00 bytes that is not a valid record (COBS, a known string
+ * id, the right number of arguments, the check byte) is passed on as text.
+ */
+
+#ifndef TRACE_HOST_H_
+#define TRACE_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The largest frame trace.c sends, delimiters included, with margin
+#define TRACE_HOST_FRAME_MAX 80U
+
+typedef struct {
+  char *fmt;          // Contents of the trace_fmt section
+  uint32_t fmt_size;
+  uint32_t ts_shift;  // Timestamps are in units of 2^ts_shift cycles
+} trace_elf_t;
+
+// Load the trace_fmt section of a 32- or 64-bit little-endian ELF file.
+// Returns 0, or -1 with a message on stderr.
+int trace_elf_load(trace_elf_t *elf, const char *path);
+void trace_elf_free(trace_elf_t *elf);
+
+typedef struct trace_decoder trace_decoder_t;
+
+struct trace_decoder {
+  const trace_elf_t *elf;
+  // A record: time is in core cycles since the first record
+  void (*record)(trace_decoder_t *d, uint64_t time, const char *text);
+  // Bytes that were not part of a record, in order
+  void (*text)(trace_decoder_t *d, const uint8_t *buf, size_t len);
+  void *ctx;
+
+  uint64_t time;
+  uint32_t records;
+  uint8_t chunk[TRACE_HOST_FRAME_MAX];
+  uint32_t len;
+  int long_text;      // The current chunk is too long to be a record
+};
+
+void trace_decoder_init(trace_decoder_t *d, const trace_elf_t *elf);
+
+// Feed bytes as they arrive; calls record() and text()
+void trace_decode(trace_decoder_t *d, const uint8_t *buf, size_t len);
+
+// End of stream, or the line has gone quiet: pass on any text still held
+// back. A record is sent in one burst, so a pause means it was not one.
+void trace_decode_flush(trace_decoder_t *d);
+
+// Format a record's arguments as the firmware would have.
+// Returns how many arguments fmt takes, whatever n is.
+uint32_t trace_format(char *out, size_t size, const char *fmt,
+                      const uint32_t *args, uint32_t n);
+
+#endif /* TRACE_HOST_H_ */
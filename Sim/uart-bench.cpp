@@ -0,0 +1,334 @@
+/*
+ * uart-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Several U(S)ART ports at once through the uart.c driver.
+ *
+ * Four ports at different baud rates (two on APB1, two on APB2) each send
+ * a distinct byte pattern and, at the same time, receive one from a
+ * simulated peer running flat out. Each port is run alone first and then
+ * all four together; a port should get its line rate either way, receive
+ * every byte intact, and never overrun.
+ *
+ * Then another handler (EXTI0, raised by software) sends three ringfuls
+ * through USART2 under BLOCK: above USART2's priority from thread mode,
+ * every byte must go out by polling; below it, by USART2's ISR
+ * preempting; and raised from inside USART2's ISR (by its receive
+ * filter), what does not fit must be dropped and nothing polled, since
+ * running the ISR's body there would make it re-entrant.
+ *
+ * Usage: uart-bench [--seconds S] [--check]
+ *   --check  exit with status 1 if a port falls below 95% of its line rate
+ *            or loses or corrupts a byte, or a send from another handler
+ *            does other than the above
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "clock.h"
+#include "critical.h"
+#include "uart.h"
+
+#define MIN_LINE_RATE_FRACTION 0.95
+#define NUM_LINKS 4
+
+typedef struct {
+  uart_id_t id;
+  uint32_t baud;
+  USART_TypeDef *regs;
+  uart_port_t *port;
+  uint8_t tx_buf[256];
+  uint8_t rx_buf[256];
+
+  uint64_t bytes;       // To send and to receive
+  uint64_t queued;      // Handed to uart_send()
+  uint64_t tx_seen;     // Seen on the TX pin
+  uint64_t tx_bad;      // ...in the wrong order or corrupted
+  uint64_t rx_offered;  // Bytes the peer has put on the RX pin
+  uint64_t rx_read;     // Taken out with uart_recv()
+  uint64_t rx_bad;
+  uint64_t t_start, t_tx_done, t_rx_done;
+  uart_rx_stats_t rx_stats0;  // At the start of the run
+} link_t;
+
+static link_t links[NUM_LINKS] = {
+  { UART_USART2, 115200,  USART2, NULL, { 0 }, { 0 }, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+  { UART_UART4,  460800,  UART4,  NULL, { 0 }, { 0 }, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+  { UART_USART1, 921600,  USART1, NULL, { 0 }, { 0 }, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+  { UART_USART6, 2000000, USART6, NULL, { 0 }, { 0 }, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+};
+
+static int running[NUM_LINKS];
+
+// Byte n of link k; differs between links so crossed wires show up
+static uint8_t pattern(unsigned k, uint64_t n) {
+  return (uint8_t)(n * 7U + (n >> 8) + k * 61U);
+}
+
+static link_t *link_of(USART_TypeDef *usart, unsigned *k) {
+  for (unsigned i = 0; i < NUM_LINKS; i++) {
+    if (links[i].regs == usart) {
+      *k = i;
+      return &links[i];
+    }
+  }
+  abort();
+}
+
+static void tx_pin(USART_TypeDef *usart, uint8_t c) {
+  unsigned k;
+  link_t *l = link_of(usart, &k);
+  if (c != pattern(k, l->tx_seen)) l->tx_bad++;
+  if (++l->tx_seen == l->bytes) l->t_tx_done = sim_count.cycles;
+}
+
+// The peer: sends the pattern back-to-back while the link is running
+static int rx_pin(USART_TypeDef *usart) {
+  unsigned k;
+  link_t *l = link_of(usart, &k);
+  if (!running[k] || l->rx_offered == l->bytes) return -1;
+  return pattern(k, l->rx_offered++);
+}
+
+static double line_rate(const link_t *l) {
+  return (double)sim_core_hz / (double)sim_usart_frame_cycles(l->regs);
+}
+
+static void run(const int *which, double seconds) {
+  uint8_t chunk[64];
+
+  for (unsigned k = 0; k < NUM_LINKS; k++) {
+    link_t *l = &links[k];
+    running[k] = which[k];
+    if (!which[k]) continue;
+    l->bytes = (uint64_t)(line_rate(l) * seconds);
+    l->queued = l->tx_seen = l->tx_bad = 0;
+    l->rx_offered = l->rx_read = l->rx_bad = 0;
+    l->t_start = sim_count.cycles;
+    l->t_tx_done = l->t_rx_done = 0;
+    l->rx_stats0 = *uart_rx_stats(l->port);
+    sim_usart_set_rx_source(l->regs, rx_pin);
+  }
+
+  for (;;) {
+    int busy = 0;
+    for (unsigned k = 0; k < NUM_LINKS; k++) {
+      link_t *l = &links[k];
+      if (!which[k]) continue;
+
+      // Top up the transmit ring without ever waiting on it
+      uint64_t n = l->bytes - l->queued;
+      if (n > uart_tx_free(l->port)) n = uart_tx_free(l->port);
+      if (n > sizeof(chunk)) n = sizeof(chunk);
+      for (unsigned i = 0; i < n; i++) chunk[i] = pattern(k, l->queued + i);
+      uart_send(l->port, chunk, (int)n);
+      l->queued += n;
+
+      int got = uart_recv(l->port, chunk, (int)sizeof(chunk));
+      for (int i = 0; i < got; i++) {
+        if (chunk[i] != pattern(k, l->rx_read)) l->rx_bad++;
+        l->rx_read++;
+      }
+      if (l->rx_read == l->bytes && !l->t_rx_done) l->t_rx_done = sim_count.cycles;
+
+      busy |= l->tx_seen < l->bytes || l->rx_read < l->bytes;
+    }
+    if (!busy) break;
+    __WFI();
+  }
+
+  for (unsigned k = 0; k < NUM_LINKS; k++) running[k] = 0;
+}
+
+// One line per running link; returns 0 if any of them failed
+static int report(const int *which) {
+  int ok = 1;
+  for (unsigned k = 0; k < NUM_LINKS; k++) {
+    const link_t *l = &links[k];
+    if (!which[k]) continue;
+    uint32_t overrun = uart_rx_stats(l->port)->overrun - l->rx_stats0.overrun;
+    uint32_t dropped = uart_rx_stats(l->port)->dropped - l->rx_stats0.dropped;
+    double rate = line_rate(l);
+    double tx = (double)l->tx_seen * sim_core_hz / (double)(l->t_tx_done - l->t_start);
+    double rx = (double)l->rx_read * sim_core_hz / (double)(l->t_rx_done - l->t_start);
+    uint64_t lost = overrun + dropped + l->tx_bad + l->rx_bad;
+
+    printf("%-7s %8lu %9llu %10.0f %6.1f%% %6.1f%% %6lu %6lu %5llu\n",
+           l->port->hw->name, (unsigned long)l->baud, (unsigned long long)l->bytes, rate,
+           100.0 * tx / rate, 100.0 * rx / rate, (unsigned long)overrun,
+           (unsigned long)dropped, (unsigned long long)(l->tx_bad + l->rx_bad));
+    if (tx < MIN_LINE_RATE_FRACTION * rate || rx < MIN_LINE_RATE_FRACTION * rate || lost) ok = 0;
+  }
+  return ok;
+}
+
+static void header(const char *what) {
+  printf("\n%s\n%-7s %8s %9s %10s %7s %7s %6s %6s %5s\n", what,
+         "port", "baud", "bytes", "line B/s", "tx", "rx", "ovr", "drop", "bad");
+}
+
+static int expect(int ok, const char *what) {
+  printf("  %-62s %s\n", what, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+// What EXTI0_IRQHandler() saw of its send through USART2
+static struct {
+  int fired;
+  critical_irq_t how;
+  uint32_t sent, dropped;  // By the port, during the handler
+  uint64_t irqs;           // Handlers that preempted it
+} nested;
+
+#define EXTI_LINE0 (1UL << 0)
+
+static uint8_t burst[3U * sizeof(links[0].tx_buf)];
+
+void EXTI0_IRQHandler(void) {
+  uart_port_t *p = links[0].port;
+  const uart_tx_stats_t *st = uart_tx_stats(p);
+  uint32_t sent = st->sent, dropped = st->dropped;
+  uint64_t irqs = sim_count.irq_entries;
+  uint8_t c;
+
+  EXTI->PR = EXTI_LINE0;
+  nested.how = critical_irq_progress(USART2_IRQn);
+  uart_send(p, burst, (int)sizeof(burst));
+  uart_flush(p);
+  uart_recv(p, &c, 1);
+  nested.sent = st->sent - sent;
+  nested.dropped = st->dropped - dropped;
+  nested.irqs = sim_count.irq_entries - irqs;
+  nested.fired++;
+}
+
+// USART2's receive filter: raise EXTI0 from inside its ISR
+static int raise_exti0(uint8_t c) {
+  (void)c;
+  EXTI->SWIER = 0;
+  EXTI->SWIER = EXTI_LINE0;
+  return 1;
+}
+
+static int peer_sent;
+
+static int one_byte(USART_TypeDef *usart) {
+  (void)usart;
+  return peer_sent++ ? -1 : 0x5A;
+}
+
+// EXTI0 at `prio` against USART2 at 8, raised from thread mode or from
+// USART2's ISR; then wait for the line. Returns the bytes that reached it.
+static uint64_t send_from_handler(uint32_t prio, int from_isr) {
+  link_t *l = &links[0];
+
+  uart_flush(l->port);
+  l->tx_seen = l->tx_bad = 0;
+  l->bytes = 0;
+  memset(&nested, 0, sizeof(nested));
+  NVIC_SetPriority(EXTI0_IRQn, prio);
+  if (from_isr) {
+    peer_sent = 0;
+    uart_set_rx_filter(l->port, raise_exti0);
+    sim_usart_set_rx_source(l->regs, one_byte);
+    while (!nested.fired) __WFI();
+    uart_set_rx_filter(l->port, NULL);
+  } else {
+    EXTI->SWIER = 0;
+    EXTI->SWIER = EXTI_LINE0;
+    while (!nested.fired) __WFI();
+  }
+  uart_flush(l->port);
+  return l->tx_seen;
+}
+
+int main(int argc, char **argv) {
+  double seconds = 0.5;
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+      seconds = strtod(argv[++i], NULL);
+    } else if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--seconds S] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  sim_reset();
+  clock_init();
+  for (unsigned k = 0; k < NUM_LINKS; k++) {
+    link_t *l = &links[k];
+    l->port = uart_port(l->id);
+    sim_usart_set_tx_sink(l->regs, tx_pin);
+    if (uart_open(l->port, l->baud) == UART_BAUD_UNREACHABLE) {
+      fprintf(stderr, "%s: %lu baud unreachable\n", l->port->hw->name, (unsigned long)l->baud);
+      return 1;
+    }
+    uart_start(l->port, l->tx_buf, sizeof(l->tx_buf), l->rx_buf, sizeof(l->rx_buf));
+  }
+  printf("%d ports, each sending and receiving for %.2f s of its line rate, core %lu Hz\n",
+         NUM_LINKS, seconds, (unsigned long)sim_core_hz);
+
+  int ok = 1;
+
+  header("one port at a time");
+  for (unsigned k = 0; k < NUM_LINKS; k++) {
+    int which[NUM_LINKS] = { 0 };
+    which[k] = 1;
+    run(which, seconds);
+    ok &= report(which);
+  }
+
+  int all[NUM_LINKS];
+  for (unsigned k = 0; k < NUM_LINKS; k++) all[k] = 1;
+  sim_counters_t a = sim_count;
+  header("all ports together");
+  run(all, seconds);
+  sim_counters_t b = sim_count;
+  ok &= report(all);
+
+  uint64_t cycles = b.cycles - a.cycles;
+  printf("\ncpu busy %.1f%%, %.0f interrupts/s\n",
+         100.0 * (double)(cycles - (b.idle_cycles - a.idle_cycles)) / (double)cycles,
+         (double)(b.irq_entries - a.irq_entries) * sim_core_hz / (double)cycles);
+
+  printf("\n%u bytes sent under BLOCK from EXTI0, USART2's ISR at priority 8\n",
+         (unsigned)sizeof(burst));
+  uart_port_t *p = links[0].port;
+  uint32_t ring = (uint32_t)sizeof(links[0].tx_buf);
+  for (uint32_t i = 0; i < sizeof(burst); i++) burst[i] = pattern(0, i);
+  uart_set_tx_policy(p, UART_TX_BLOCK);
+  NVIC_SetPriority(USART2_IRQn, 8);
+  EXTI->IMR |= EXTI_LINE0;
+  NVIC_EnableIRQ(EXTI0_IRQn);
+
+  uint64_t out = send_from_handler(4, 0);
+  ok &= expect(nested.how == CRITICAL_IRQ_POLL && nested.sent == sizeof(burst) && !nested.dropped &&
+               !nested.irqs && out == sizeof(burst) && !links[0].tx_bad,
+               "EXTI0 at 4: every byte, polled");
+  out = send_from_handler(12, 0);
+  ok &= expect(nested.how == CRITICAL_IRQ_WAIT && nested.irqs && !nested.dropped &&
+               out == sizeof(burst) && !links[0].tx_bad,
+               "EXTI0 at 12: every byte, by the ISR preempting it");
+  out = send_from_handler(4, 1);
+  ok &= expect(nested.how == CRITICAL_IRQ_PREEMPTED && !nested.sent &&
+               nested.dropped == sizeof(burst) - ring && out == ring && !links[0].tx_bad,
+               "EXTI0 at 4 inside the ISR: a ringful, none polled");
+
+  if (check && !ok) {
+    fprintf(stderr, "FAIL: a port is below %.0f%% of its line rate or lost data, or a send "
+            "from another handler polled where it must not\n", 100.0 * MIN_LINE_RATE_FRACTION);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,337 @@
+/*
+ * update-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Firmware updates of update.c by update-host.h over the simulated
+ * USART3, into the simulated flash, then a reset through loader.c.
+ *
+ * The flash starts as a part would leave the factory and a debugger: the
+ * loader in sector 0 and image A at 0x08008000 in bank 1, bank 2 erased.
+ * Each update then goes into whichever bank is not running, and after
+ * its reset the loader must pick that bank and 0x08008000 must hold the
+ * new image. A line gives the rate DATA ran at, sectors erased of those
+ * the image covers (the rest were already blank), the time from BEGIN to
+ * the END response and the image's KB/s, how near that is to what the
+ * line allows (UPDATE_CHUNK_MAX in each DATA frame), how often DATA
+ * waited for room in the staging ring, and how much of it was used.
+ *
+ * Pipelined and serial (UPDATE_BEGIN_SERIAL: erase it all, then program
+ * each chunk before answering it) are compared at two rates: at 921600
+ * baud the line is the slower, and the pipeline hides the erases behind
+ * it; at 3Mbaud the flash is, and there is little to win.
+ *
+ * Then the faults: DATA frames damaged on the line (the host goes back
+ * and the image must still be right), an image whose CRC is not the one
+ * BEGIN gave, and an update abandoned half way. After those the old
+ * image must still be the one that boots.
+ *
+ * Across all of them, the longest the firmware masked interrupts is
+ * given too.
+ *
+ * The host's side of the line runs at the rate it set: a byte sent or
+ * received while the two sides disagree arrives damaged.
+ *
+ * Usage: update-bench [--check]
+ *   --check  exit with status 1 if an update fails that should not, the
+ *            wrong bank or image boots, a fault is not caught, or
+ *            pipelined is not MIN_SPEEDUP times faster than serial at
+ *            921600 baud, or interrupts are masked for longer than
+ *            MAX_MASKED_US at a time
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "clock.h"
+#include "cmd.h"
+#include "cmd-host.h"
+#include "console.h"
+#include "critical.h"
+#include "flash.h"
+#include "loader.h"
+#include "tick.h"
+#include "uart.h"
+#include "update.h"
+#include "update-host.h"
+
+// Drivers from Src/main.c (which has no header of its own)
+void uart3_rxtx_init(void);
+
+#define MIN_SPEEDUP 1.25
+// Longest the firmware may mask interrupts during an update: a fifth of
+// a tick (the image CRC at END is done a chunk at a time to keep to it)
+#define MAX_MASKED_US 200U
+#define IMAGE_SIZE (192U * 1024U)  // Sectors 2 to 5 of the bank
+#define HOME_BAUD 115200U
+#define HOST_QUEUE (1U << 16)
+#define APP_ADDR (FLASHAXI_BASE + UPDATE_APP_OFFSET)
+
+static const cmd_entry_t commands[] = {
+  { UPDATE_CMD_BEGIN, 12, 13, "update-begin", update_begin },
+  { UPDATE_CMD_DATA, 5, CMD_PAYLOAD_MAX, "update-data", update_data },
+  { UPDATE_CMD_END, 0, 1, "update-end", update_end },
+};
+
+static uint8_t image_a[IMAGE_SIZE], image_b[IMAGE_SIZE], image_c[IMAGE_SIZE];
+
+// Bytes from the host waiting to go onto the line, in order
+static uint8_t host_q[HOST_QUEUE];
+static uint32_t host_head, host_tail;
+static uint32_t host_baud;
+
+static cmd_client_t client;
+static update_host_t host;
+static int reboot_asked;
+
+// Damage one DATA frame in every `corrupt_every` (0: none)
+static uint32_t corrupt_every, frame_count;
+
+// The two sides of the line agree on the rate to within 2%
+static int line_agrees(void) {
+  double dev = 10.0 * sim_core_hz / (double)sim_usart_frame_cycles(USART3);
+  double d = dev - (double)host_baud;
+  return d < 0.02 * dev && -d < 0.02 * dev;
+}
+
+static void host_send(cmd_client_t *c, const uint8_t *buf, size_t len) {
+  (void)c;
+  size_t hit = 0;
+  if (corrupt_every && len > 60U && ++frame_count % corrupt_every == 0) hit = len / 2U;
+  for (size_t i = 0; i < len; i++) {
+    uint8_t b = buf[i];
+    if (i == hit && hit) b = (uint8_t)(b == 0xFFU ? 0x01U : b + 1U);
+    host_q[host_head++ % HOST_QUEUE] = b;
+  }
+}
+
+static int rx_from_host(USART_TypeDef *usart) {
+  (void)usart;
+  if (host_tail == host_head) return -1;
+  uint8_t b = host_q[host_tail++ % HOST_QUEUE];
+  return line_agrees() ? b : b ^ 0xA5U;
+}
+
+static void to_host(USART_TypeDef *usart, uint8_t c) {
+  (void)usart;
+  if (!line_agrees()) c ^= 0xA5U;
+  cmd_client_feed(&client, &c, 1);
+}
+
+static void set_host_baud(update_host_t *u, uint32_t baud) {
+  (void)u;
+  host_baud = baud;
+}
+
+// main.c's loop: handle requests, then the update, else sleep until the
+// next interrupt
+static void firmware_step(void) {
+  cmd_poll();
+  if (update_poll()) reboot_asked = 1;
+  uint32_t primask = critical_enter();
+  if (!cmd_pending()) __WFI();
+  critical_exit(primask);
+}
+
+// Reset: the loader, then the application's start-up as far as the
+// command table
+static loader_bank_t reset(void) {
+  sim_reset();
+  loader_bank_t bank = loader_select();
+  clock_init();
+  tick_init(clock_hclk_hz());
+  uart3_rxtx_init();
+  console_init();
+  sim_usart_set_tx_sink(USART3, to_host);
+  sim_usart_set_rx_source(USART3, rx_from_host);
+  cmd_init(commands, sizeof(commands) / sizeof(commands[0]));
+  host_head = host_tail = 0;
+  host_baud = HOME_BAUD;
+  reboot_asked = 0;
+  return bank;
+}
+
+static void make_image(uint8_t *img, uint32_t seed) {
+  uint32_t *w = (uint32_t *)img;
+  uint32_t lcg = seed;
+  for (uint32_t i = 0; i < IMAGE_SIZE / 4U; i++) {
+    lcg = lcg * 1664525U + 1013904223U;
+    w[i] = lcg;
+  }
+  // A vector table the loader takes for one
+  w[0] = 0x20080000UL;
+  w[1] = APP_ADDR + 0x201U;
+}
+
+// The flash as it comes from the debugger
+static void factory(void) {
+  sim_flash_set_dual_bank(1);
+  sim_flash_erase_all();
+  uint8_t *b1 = sim_flash_bank(1);
+  for (uint32_t i = 0; i < 0x4000U; i++) b1[i] = (uint8_t)(i * 7U + 3U); // "The loader"
+  memcpy(b1 + UPDATE_APP_OFFSET, image_a, IMAGE_SIZE);
+}
+
+static const char *bank_name(loader_bank_t b) {
+  return b == LOADER_BANK1 ? "1" : b == LOADER_BANK2 ? "2" : "none";
+}
+
+typedef struct {
+  const char *name;
+  uint32_t max_baud;
+  uint8_t flags;          // UPDATE_BEGIN_*
+  uint32_t corrupt_every;
+  uint32_t bad_crc;       // XORed into the CRC BEGIN gives
+  int abandon;            // Stop sending half way
+} run_t;
+
+typedef struct {
+  update_host_state_t state;
+  double kbs;
+  loader_bank_t bank;     // After the reset
+} result_t;
+
+static uint64_t masked_max;  // Longest the firmware masked interrupts, any update
+
+// One update; with `expect` the bank that should boot afterwards
+static result_t update(const run_t *r, const uint8_t *img, loader_bank_t expect, int *ok) {
+  result_t res = { UPDATE_HOST_FAILED, 0.0, LOADER_NONE };
+  const update_stats_t *fw = update_stats();
+  update_stats_t before = *fw;
+
+  cmd_client_init(&client);
+  client.send = host_send;
+  host.set_baud = set_host_baud;
+  update_host_init(&host, &client, img, IMAGE_SIZE, HOME_BAUD, r->max_baud);
+  host.begin_flags = r->flags;
+  host.crc ^= r->bad_crc;
+  corrupt_every = r->corrupt_every;
+  frame_count = 0;
+
+  sim_masked_max = 0;
+  uint64_t give_up = sim_now_ns() + 60000000000ULL;
+  while (update_host_poll(&host, sim_now_ns()) && sim_now_ns() < give_up) {
+    if (r->abandon && host.acked >= IMAGE_SIZE / 2U) break;
+    firmware_step();
+  }
+  corrupt_every = 0;
+
+  // Let the firmware answer, change back and ask for its reset
+  uint64_t until = sim_now_ns() + (r->abandon ? (UPDATE_IDLE_MS + 100U) * 1000000ULL : 100000000ULL);
+  while (sim_now_ns() < until && !reboot_asked) firmware_step();
+  if (r->abandon) host_baud = HOME_BAUD; // The host gave up too
+  int line_back = uart_port(UART_USART3)->baud == HOME_BAUD;
+
+  res.state = host.state;
+  double s = (double)(host.done_at - host.started_at) / 1e9;
+  double bound = (double)host.baud / 10.0 * UPDATE_CHUNK_MAX / (2.0 + 4.0 + UPDATE_CHUNK_MAX + 4.0 + 3.0) / 1024.0;
+  if (res.state == UPDATE_HOST_DONE) res.kbs = IMAGE_SIZE / 1024.0 / s;
+
+  int want_done = !r->bad_crc && !r->abandon;
+  int asked = reboot_asked;
+  if (sim_masked_max > masked_max) masked_max = sim_masked_max;
+  res.bank = reset();
+  const uint8_t *booted = (const uint8_t *)(uintptr_t)APP_ADDR;
+  int image_ok = want_done ? !memcmp(booted, img, IMAGE_SIZE) : memcmp(booted, img, IMAGE_SIZE) != 0;
+
+  printf("%-10s %8lu %-9s %3lu/%-3lu %6.2f %7.1f %6.1f%% %6lu %6luK %6llu  %-6s %s\n", r->name,
+         (unsigned long)host.baud,
+         r->flags & UPDATE_BEGIN_SERIAL ? "serial" : "pipelined",
+         (unsigned long)(fw->erases - before.erases), (unsigned long)(fw->sectors - before.sectors),
+         res.state == UPDATE_HOST_DONE ? s : 0.0, res.kbs, res.kbs ? 100.0 * res.kbs / bound : 0.0,
+         (unsigned long)(fw->stage_waits - before.stage_waits), (unsigned long)(fw->stage_peak / 1024U),
+         (unsigned long long)host.go_backs, update_host_state_name(res.state), bank_name(res.bank));
+
+  int good = res.bank == expect && image_ok && line_back && host_baud == HOME_BAUD;
+  if (want_done) {
+    good &= res.state == UPDATE_HOST_DONE && asked &&
+            host.device_crc == cmd_host_crc32(img, IMAGE_SIZE);
+  } else if (r->bad_crc) {
+    good &= res.state == UPDATE_HOST_FAILED && host.device_crc == cmd_host_crc32(img, IMAGE_SIZE) &&
+            fw->failed == before.failed + 1U;
+  } else {
+    good &= fw->abandoned == before.abandoned + 1U;
+  }
+  if (r->corrupt_every) good &= host.go_backs > 0 && fw->gaps > before.gaps;
+  if (!good) {
+    printf("  FAIL: expected bank %s with %s image, the line back at %u\n", bank_name(expect),
+           want_done ? "the new" : "the old", HOME_BAUD);
+    *ok = 0;
+  }
+  return res;
+}
+
+int main(int argc, char **argv) {
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  make_image(image_a, 1);
+  make_image(image_b, 2);
+  make_image(image_c, 3);
+  factory();
+  int ok = 1;
+  loader_bank_t bank = reset();
+  if (bank != LOADER_BANK1) {
+    printf("FAIL: the factory image does not boot\n");
+    ok = 0;
+  }
+
+  printf("%uK images, core %lu Hz, BEGIN at %u baud\n\n", IMAGE_SIZE / 1024U, (unsigned long)sim_core_hz,
+         HOME_BAUD);
+  printf("%-10s %8s %-9s %7s %6s %7s %7s %6s %7s %6s  %-6s %s\n", "run", "baud", "mode", "erased",
+         "s", "KB/s", "of line", "waits", "staged", "backs", "result", "bank");
+
+  static const run_t runs[] = {
+    { "blank", 3000000, 0, 0, 0, 0 },
+    { "921600", 921600, 0, 0, 0, 0 },
+    { "921600", 921600, UPDATE_BEGIN_SERIAL, 0, 0, 0 },
+    { "3M", 3000000, 0, 0, 0, 0 },
+    { "3M", 3000000, UPDATE_BEGIN_SERIAL, 0, 0, 0 },
+    { "damaged", 921600, 0, 40, 0, 0 },
+  };
+  const uint8_t *imgs[] = { image_b, image_c, image_b, image_c, image_b, image_c };
+  result_t res[sizeof(runs) / sizeof(runs[0])];
+  for (unsigned i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+    bank = bank == LOADER_BANK1 ? LOADER_BANK2 : LOADER_BANK1;
+    res[i] = update(&runs[i], imgs[i], bank, &ok);
+  }
+
+  // The faults: bank stays the one that ran the last good update
+  static const run_t bad_crc = { "bad crc", 3000000, 0, 0, 1, 0 };
+  static const run_t abandon = { "abandoned", 3000000, 0, 0, 0, 1 };
+  update(&bad_crc, image_b, bank, &ok);
+  update(&abandon, image_b, bank, &ok);
+  if (memcmp((const void *)(uintptr_t)APP_ADDR, image_c, IMAGE_SIZE)) {
+    printf("FAIL: the last good image does not boot after the faults\n");
+    ok = 0;
+  }
+
+  double slow = res[2].kbs ? res[1].kbs / res[2].kbs : 0.0;
+  double fast = res[4].kbs ? res[3].kbs / res[4].kbs : 0.0;
+  double masked_us = (double)masked_max * 1e6 / sim_core_hz;
+  printf("\nlongest with interrupts masked: %llu cycles, %.1fus\n", (unsigned long long)masked_max,
+         masked_us);
+  if (masked_us > MAX_MASKED_US) ok = 0;
+  printf("pipelined over serial: %.2fx at 921600 baud, %.2fx at 3Mbaud\n", slow, fast);
+  if (slow < MIN_SPEEDUP) ok = 0;
+
+  if (check && !ok) {
+    fprintf(stderr, "FAIL: an update went wrong, pipelined was under %.2fx serial at 921600 baud, "
+            "or interrupts were masked over %uus\n", MIN_SPEEDUP, MAX_MASKED_US);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * update-host.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See update-host.h, and Src/update.h for the commands.
+ */
+
+#include <string.h>
+
+#include "update-host.h"
+#include "update.h"
+
+// How long each request may go unanswered, in ns. BEGIN may erase the
+// whole bank (UPDATE_BEGIN_SERIAL), DATA may wait for a sector erase
+// to make room in the ring, END for the ring to be programmed.
+#define BEGIN_TIMEOUT_NS 30000000000ULL
+#define DATA_TIMEOUT_NS  3000000000ULL
+#define END_TIMEOUT_NS   5000000000ULL
+#define ATTEMPTS 3U
+
+static inline uint32_t get_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static void change_baud(update_host_t *u, uint32_t baud) {
+  if (u->set_baud) u->set_baud(u, baud);
+}
+
+static void send_begin(update_host_t *u) {
+  uint8_t p[13];
+  put_le32(p, u->size);
+  put_le32(p + 4, u->crc);
+  put_le32(p + 8, u->max_baud);
+  p[12] = u->begin_flags;
+  u->state = UPDATE_HOST_BEGIN;
+  u->attempts++;
+  cmd_client_request(u->cmd, UPDATE_CMD_BEGIN, p, sizeof(p), u->now);
+}
+
+static void send_end(update_host_t *u) {
+  u->state = UPDATE_HOST_END;
+  u->attempts++;
+  cmd_client_request(u->cmd, UPDATE_CMD_END, &u->end_flags, 1, u->now);
+}
+
+static void send_chunk(update_host_t *u) {
+  uint8_t p[4 + UPDATE_CHUNK_MAX];
+  uint32_t n = u->size - u->next < UPDATE_CHUNK_MAX ? u->size - u->next : UPDATE_CHUNK_MAX;
+  put_le32(p, u->next);
+  memcpy(p + 4, u->image + u->next, n);
+  int seq = cmd_client_request(u->cmd, UPDATE_CMD_DATA, p, 4U + n, u->now);
+  if (seq < 0) return;
+  u->chunk_gen[seq] = u->gen;
+  u->chunk_order[seq] = u->chunks;
+  u->next += n;
+  u->chunks++;
+}
+
+// Start sending again from offset `at`
+static void go_back(update_host_t *u, uint32_t at) {
+  u->gen++;
+  u->go_backs++;
+  u->next = at;
+  if (at > u->acked) u->acked = at;
+}
+
+static void finish(update_host_t *u, update_host_state_t s) {
+  // The firmware goes back to home_baud after END, whatever its answer
+  if (u->baud != u->home_baud) change_baud(u, u->home_baud);
+  u->state = s;
+  u->done_at = u->now;
+}
+
+static void got_response(cmd_client_t *c, const cmd_response_t *r) {
+  update_host_t *u = (update_host_t *)c->ctx;
+
+  switch (r->id) {
+  case UPDATE_CMD_BEGIN:
+    if (u->state != UPDATE_HOST_BEGIN) break;
+    if (r->status != CMD_OK || r->len < 8U) {
+      u->fail_status = r->status;
+      u->state = UPDATE_HOST_FAILED;
+      u->done_at = u->now;
+      break;
+    }
+    u->baud = get_le32(r->payload);
+    u->stage = get_le32(r->payload + 4);
+    if (u->baud != u->home_baud) change_baud(u, u->baud);
+    u->settle_until = u->now + UPDATE_SETTLE_MS * 1000000ULL;
+    u->attempts = 0;
+    u->state = UPDATE_HOST_SETTLE;
+    break;
+
+  case UPDATE_CMD_DATA: {
+    for (unsigned s = 0; s < 256U; s++) {
+      if (u->cmd->pending[s].busy && u->cmd->pending[s].id == UPDATE_CMD_DATA &&
+          u->chunk_order[s] < u->chunk_order[r->seq] && cmd_client_forget(u->cmd, (uint8_t)s)) {
+        u->lost++;
+      }
+    }
+    if (u->state != UPDATE_HOST_DATA || r->len < 4U) break;
+    uint32_t want = get_le32(r->payload);
+    if (r->status == CMD_OK) {
+      if (want > u->acked) u->acked = want;
+      if (u->acked > u->next) u->next = u->acked;
+    } else if (r->status == CMD_ERR_ARG) {
+      if (u->chunk_gen[r->seq] == u->gen) go_back(u, want);
+    } else {
+      // The flash failed: END gets the line back to home_baud
+      u->fail_status = r->status;
+      send_end(u);
+    }
+    break;
+  }
+
+  case UPDATE_CMD_END:
+    if (u->state != UPDATE_HOST_END) break;
+    if (r->len >= 4U) u->device_crc = get_le32(r->payload);
+    if (r->status == CMD_OK && r->len >= 12U && !u->fail_status) {
+      u->device_ms = get_le32(r->payload + 4);
+      u->device_seq = get_le32(r->payload + 8);
+      finish(u, UPDATE_HOST_DONE);
+    } else if (r->status == CMD_ERR_ARG && r->len >= 4U && !u->fail_status) {
+      // Chunks the firmware never got
+      go_back(u, get_le32(r->payload));
+      u->acked = u->next;
+      u->attempts = 0;
+      u->state = UPDATE_HOST_DATA;
+    } else {
+      if (!u->fail_status) u->fail_status = r->status;
+      finish(u, UPDATE_HOST_FAILED);
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void expired(cmd_client_t *c, uint8_t seq, uint8_t id) {
+  update_host_t *u = (update_host_t *)c->ctx;
+
+  u->timeouts++;
+  if (id == UPDATE_CMD_DATA) {
+    if (u->state == UPDATE_HOST_DATA && u->chunk_gen[seq] == u->gen) go_back(u, u->acked);
+  } else if (id == UPDATE_CMD_BEGIN && u->state == UPDATE_HOST_BEGIN) {
+    if (u->attempts < ATTEMPTS) {
+      send_begin(u);
+    } else {
+      u->state = UPDATE_HOST_FAILED;
+      u->done_at = u->now;
+    }
+  } else if (id == UPDATE_CMD_END && u->state == UPDATE_HOST_END) {
+    if (u->attempts < ATTEMPTS) {
+      send_end(u);
+    } else {
+      finish(u, UPDATE_HOST_FAILED);
+    }
+  }
+}
+
+void update_host_init(update_host_t *u, cmd_client_t *c, const uint8_t *image, uint32_t size,
+                      uint32_t home_baud, uint32_t max_baud) {
+  void (*set_baud)(update_host_t *, uint32_t) = u->set_baud;
+  void *ctx = u->ctx;
+
+  memset(u, 0, sizeof(*u));
+  u->set_baud = set_baud;
+  u->ctx = ctx;
+  u->cmd = c;
+  u->image = image;
+  u->size = size;
+  u->crc = cmd_host_crc32(image, size);
+  u->home_baud = u->baud = home_baud;
+  u->max_baud = max_baud;
+  u->end_flags = UPDATE_END_REBOOT;
+  u->state = UPDATE_HOST_BEGIN;
+  c->response = got_response;
+  c->ctx = u;
+}
+
+int update_host_poll(update_host_t *u, uint64_t now) {
+  uint64_t timeout = u->state == UPDATE_HOST_BEGIN ? BEGIN_TIMEOUT_NS
+                     : u->state == UPDATE_HOST_END ? END_TIMEOUT_NS : DATA_TIMEOUT_NS;
+
+  u->now = now;
+  if (u->state == UPDATE_HOST_BEGIN && !u->attempts) {
+    u->started_at = now;
+    send_begin(u);
+  }
+  if (u->state == UPDATE_HOST_SETTLE && now >= u->settle_until) u->state = UPDATE_HOST_DATA;
+  if (u->state == UPDATE_HOST_DATA) {
+    while (u->next < u->size && u->cmd->outstanding < CMD_QUEUE_LEN) send_chunk(u);
+    if (u->acked == u->size && !u->cmd->outstanding) send_end(u);
+  }
+  if (now > timeout) cmd_client_expire(u->cmd, now - timeout, expired);
+  return u->state != UPDATE_HOST_DONE && u->state != UPDATE_HOST_FAILED;
+}
+
+const char *update_host_state_name(update_host_state_t s) {
+  static const char *const names[] = { "begin", "settle", "data", "end", "done", "failed" };
+  return (unsigned)s < sizeof(names) / sizeof(names[0]) ? names[s] : "?";
+}
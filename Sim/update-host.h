@@ -0,0 +1,92 @@
+/*
+ * update-host.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Host side of the firmware update (Src/update.h), over a cmd_client_t
+ * (cmd-host.h): BEGIN, a change of baud rate, DATA chunks, END. Used by
+ * update-bench and the update-send tool; the transport and the clock are
+ * the caller's.
+ *
+ * DATA keeps CMD_QUEUE_LEN chunks outstanding, as many as the firmware
+ * queues, so the line never waits on a round trip. When a chunk is lost
+ * the next one is a gap the firmware refuses with the offset it wants,
+ * and the client goes back there; a lost answer to the last chunks is
+ * found by expiry. Only the first refusal after a go-back counts: the
+ * chunks already sent after the lost one are refused too. As the
+ * firmware answers in order, a chunk still outstanding when a later one
+ * is answered is forgotten there and then, rather than keeping its place
+ * in the window until it expires.
+ */
+
+#ifndef UPDATE_HOST_H_
+#define UPDATE_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cmd-host.h"
+
+typedef enum {
+  UPDATE_HOST_BEGIN = 0,  // BEGIN sent
+  UPDATE_HOST_SETTLE,     // Waiting UPDATE_SETTLE_MS after the change of rate
+  UPDATE_HOST_DATA,
+  UPDATE_HOST_END,        // END sent
+  UPDATE_HOST_DONE,
+  UPDATE_HOST_FAILED
+} update_host_state_t;
+
+typedef struct update_host update_host_t;
+
+struct update_host {
+  // Change the line to baud; called after the response that asks for it
+  void (*set_baud)(update_host_t *u, uint32_t baud);
+  void *ctx;
+
+  cmd_client_t *cmd;
+  const uint8_t *image;
+  uint32_t size;          // A multiple of 4
+  uint32_t crc;           // Sent in BEGIN; the image's own unless changed
+  uint32_t max_baud;
+  uint32_t home_baud;     // The rate BEGIN goes at
+  uint8_t begin_flags;    // UPDATE_BEGIN_*
+  uint8_t end_flags;      // UPDATE_END_*
+
+  update_host_state_t state;
+  uint64_t now;           // ns, from the last update_host_poll()
+  uint64_t settle_until;
+  uint32_t next;          // Offset of the next chunk to send
+  uint32_t acked;         // The firmware has everything before this
+  uint32_t gen;           // Go-backs so far; a chunk's refusal counts only if it is from this one
+  uint32_t chunk_gen[256];
+  uint64_t chunk_order[256]; // chunks when it was sent
+  uint32_t attempts;      // Of BEGIN or END
+  uint64_t started_at, done_at;
+
+  // From the firmware
+  uint32_t baud;          // BEGIN: the rate for DATA (home_baud until then)
+  uint32_t stage;         // BEGIN: its staging ring
+  uint32_t device_crc;    // END
+  uint32_t device_ms;
+  uint32_t device_seq;
+  uint8_t fail_status;    // cmd_status_t that failed it
+
+  uint64_t chunks;        // DATA requests sent
+  uint64_t go_backs;
+  uint64_t lost;          // Chunks never answered
+  uint64_t timeouts;
+};
+
+// Set up an update of size bytes at image (a multiple of 4), sent at
+// home_baud up to max_baud, and take over c->response and c->ctx
+void update_host_init(update_host_t *u, cmd_client_t *c, const uint8_t *image, uint32_t size,
+                      uint32_t home_baud, uint32_t max_baud);
+
+// Send what can be sent and expire what timed out; now is in ns.
+// Returns 0 once the update is DONE or FAILED.
+int update_host_poll(update_host_t *u, uint64_t now);
+
+const char *update_host_state_name(update_host_state_t s);
+
+#endif /* UPDATE_HOST_H_ */
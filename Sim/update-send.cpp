@@ -0,0 +1,253 @@
+/*
+ * update-send.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Sends a firmware image to the board over its console serial port
+ * (Src/update.h), with update-host.h. The line's rate is negotiated
+ * first (Src/baud.h, baud-host.h), so the image goes at the fastest rate
+ * that passes VERIFY rather than the fastest the board's clock reaches.
+ *
+ * Usage: update-send [--baud B] [--home B] [--serial] [--no-reboot] PORT IMAGE
+ *   PORT         the board's serial port, e.g. /dev/ttyACM0
+ *   IMAGE        a raw binary linked at 0x08008000 (objcopy -O binary),
+ *                padded here with 0xFF to a multiple of 4
+ *   --baud B     the fastest rate to ask for (default 3000000); the
+ *                board offers the fastest it can reach up to B, and
+ *                lower ones while those fail
+ *   --home B     the rate the console runs at (default 115200)
+ *   --serial     erase everything first, then program chunk by chunk
+ *   --no-reboot  leave the new image to the next reset; the console
+ *                stays at the negotiated rate
+ *
+ * The port must take the rates as B-constants (Linux's include
+ * B921600 to B4000000); one it does not is never asked for.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "baud-host.h"
+#include "update-host.h"
+#include "update.h"
+
+static int fd = -1;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static speed_t speed_of(uint32_t baud) {
+  switch (baud) {
+  case 115200: return B115200;
+  case 230400: return B230400;
+#ifdef B460800
+  case 460800: return B460800;
+#endif
+#ifdef B921600
+  case 921600: return B921600;
+#endif
+#ifdef B1000000
+  case 1000000: return B1000000;
+#endif
+#ifdef B2000000
+  case 2000000: return B2000000;
+#endif
+#ifdef B3000000
+  case 3000000: return B3000000;
+#endif
+  default: return B0;
+  }
+}
+
+// The fastest of baud.c's rates up to max the port takes
+static uint32_t port_max(uint32_t max) {
+  static const uint32_t rates[] = { 3000000, 2000000, 1000000, 921600, 460800, 230400, 115200 };
+  for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+    if (rates[i] <= max && speed_of(rates[i]) != B0) return rates[i];
+  }
+  return 115200;
+}
+
+static int set_speed(uint32_t baud) {
+  struct termios t;
+  speed_t s = speed_of(baud);
+  if (s == B0 || tcgetattr(fd, &t)) return -1;
+  cfsetispeed(&t, s);
+  cfsetospeed(&t, s);
+  return tcsetattr(fd, TCSADRAIN, &t);
+}
+
+static void port_send(cmd_client_t *c, const uint8_t *buf, size_t len) {
+  (void)c;
+  while (len) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      perror("write");
+      exit(1);
+    }
+    buf += n;
+    len -= (size_t)n;
+  }
+}
+
+// Console output from the board
+static void port_text(cmd_client_t *c, const uint8_t *buf, size_t len) {
+  (void)c;
+  fwrite(buf, 1, len, stderr);
+}
+
+static void new_baud(update_host_t *u, uint32_t baud) {
+  (void)u;
+  if (set_speed(baud)) fprintf(stderr, "update-send: cannot set %lu baud\n", (unsigned long)baud);
+}
+
+static void negotiated_baud(baud_host_t *b, uint32_t baud) {
+  (void)b;
+  if (set_speed(baud)) fprintf(stderr, "update-send: cannot set %lu baud\n", (unsigned long)baud);
+}
+
+// Negotiate the line up to max; returns the rate agreed, home if none
+static uint32_t negotiate(cmd_client_t *c, uint32_t home, uint32_t max) {
+  static baud_host_t b;
+  b.set_baud = negotiated_baud;
+  baud_host_init(&b, c, home, max);
+  while (baud_host_poll(&b, now_ns())) {
+    struct pollfd p = { fd, POLLIN, 0 };
+    if (poll(&p, 1, 10) > 0) {
+      uint8_t buf[512];
+      ssize_t n = read(fd, buf, sizeof(buf));
+      if (n > 0) cmd_client_feed(c, buf, (size_t)n);
+    } else {
+      cmd_client_flush(c);
+    }
+  }
+  fprintf(stderr, "line: %lu baud after %lu trials, %lu fallbacks%s\n", (unsigned long)b.baud,
+          (unsigned long)b.trials, (unsigned long)b.fallbacks,
+          b.state == BAUD_HOST_DONE ? "" : " (no answer)");
+  return b.baud;
+}
+
+int main(int argc, char **argv) {
+  uint32_t max_baud = 3000000, home = 115200;
+  uint8_t begin_flags = 0, end_flags = UPDATE_END_REBOOT;
+  const char *port = NULL, *path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--baud") && i + 1 < argc) {
+      max_baud = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--home") && i + 1 < argc) {
+      home = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--serial")) {
+      begin_flags |= UPDATE_BEGIN_SERIAL;
+    } else if (!strcmp(argv[i], "--no-reboot")) {
+      end_flags = 0;
+    } else if (!port && argv[i][0] != '-') {
+      port = argv[i];
+    } else if (!path && argv[i][0] != '-') {
+      path = argv[i];
+    } else {
+      port = NULL;
+      break;
+    }
+  }
+  if (!port || !path) {
+    fprintf(stderr, "usage: %s [--baud B] [--home B] [--serial] [--no-reboot] PORT IMAGE\n", argv[0]);
+    return 2;
+  }
+
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  static uint8_t image[UPDATE_APP_MAX + 4U];
+  size_t size = fread(image, 1, sizeof(image), f);
+  fclose(f);
+  if (!size || size > UPDATE_APP_MAX) {
+    fprintf(stderr, "%s: %lu bytes; the most is %lu\n", path, (unsigned long)size,
+            (unsigned long)UPDATE_APP_MAX);
+    return 1;
+  }
+  while (size & 3U) image[size++] = 0xFF;
+
+  fd = open(port, O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    perror(port);
+    return 1;
+  }
+  struct termios t;
+  if (tcgetattr(fd, &t)) {
+    perror(port);
+    return 1;
+  }
+  cfmakeraw(&t);
+  t.c_cflag |= CLOCAL | CREAD;
+  t.c_cc[VMIN] = 0;
+  t.c_cc[VTIME] = 0;
+  if (tcsetattr(fd, TCSANOW, &t) || set_speed(home)) {
+    fprintf(stderr, "%s: cannot set %lu baud\n", port, (unsigned long)home);
+    return 1;
+  }
+  tcflush(fd, TCIOFLUSH);
+
+  static cmd_client_t client;
+  static update_host_t host;
+  cmd_client_init(&client);
+  client.send = port_send;
+  client.text = port_text;
+  uint32_t line = negotiate(&client, home, port_max(max_baud));
+  host.set_baud = new_baud;
+  update_host_init(&host, &client, image, (uint32_t)size, line, line);
+  host.begin_flags = begin_flags;
+  host.end_flags = end_flags;
+
+  uint32_t shown = 0;
+  while (update_host_poll(&host, now_ns())) {
+    struct pollfd p = { fd, POLLIN, 0 };
+    if (poll(&p, 1, 10) > 0) {
+      uint8_t buf[512];
+      ssize_t n = read(fd, buf, sizeof(buf));
+      if (n > 0) cmd_client_feed(&client, buf, (size_t)n);
+    } else {
+      cmd_client_flush(&client);
+    }
+    if (host.acked / 65536U != shown) {
+      shown = host.acked / 65536U;
+      fprintf(stderr, "\r%luK of %luK at %lu baud", (unsigned long)(host.acked / 1024U),
+              (unsigned long)(size / 1024U), (unsigned long)host.baud);
+    }
+  }
+  fprintf(stderr, "\n");
+  tcdrain(fd);
+  // After a reset the board is back at home; otherwise it stays at line
+  if (end_flags) set_speed(home);
+  close(fd);
+
+  if (host.state != UPDATE_HOST_DONE) {
+    fprintf(stderr, "update failed: status %u, %llu timeouts, board CRC %08lx, image CRC %08lx\n",
+            host.fail_status, (unsigned long long)host.timeouts, (unsigned long)host.device_crc,
+            (unsigned long)host.crc);
+    return 1;
+  }
+  double s = (double)(host.done_at - host.started_at) / 1e9;
+  printf("%lu bytes at %lu baud in %.2f s (%.1f KB/s; %lu ms on the board), %llu go-backs, "
+         "sequence %lu%s\n",
+         (unsigned long)size, (unsigned long)host.baud, s, (double)size / 1024.0 / s,
+         (unsigned long)host.device_ms, (unsigned long long)host.go_backs,
+         (unsigned long)host.device_seq, end_flags ? ", rebooting" : "");
+  return 0;
+}
@@ -0,0 +1,279 @@
+/*
+ * wave-bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Replay test for the waveform engine (wave.c) on the simulated core.
+ *
+ * Tables are compiled from random edge lists and played through TIM8 and
+ * DMA2 into the simulated GPIOB, with SysTick interrupts running. Every
+ * change of GPIOB's output register is recorded with its cycle, and
+ * checked against the table applied one word at a time in software: the
+ * same output values, each exactly (step number x step period) after the
+ * first. Then a table swap must land on a pass boundary, and a one-shot
+ * must play the table once and stop.
+ *
+ * Usage: wave-bench [--rate HZ] [--len N] [--passes N] [--check]
+ *   --check  exit with status 1 on any mismatch
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "clock.h"
+#include "critical.h"
+#include "tick.h"
+#include "wave.h"
+
+#define MAX_LEN     4096
+#define MAX_CHANGES 200000
+#define NUM_PINS    6
+
+typedef struct {
+  uint32_t odr;
+  uint64_t at;
+} change_t;
+
+static change_t changes[MAX_CHANGES];
+static unsigned num_changes;
+
+static void watch(GPIO_TypeDef *gpio, uint32_t odr, uint64_t at) {
+  (void)gpio;
+  if (num_changes < MAX_CHANGES) {
+    changes[num_changes].odr = odr;
+    changes[num_changes].at = at;
+  }
+  num_changes++;
+}
+
+static uint32_t rng = 12345;
+static uint32_t rnd(void) {
+  rng = rng * 1664525UL + 1013904223UL;
+  return rng >> 8;
+}
+
+// Random edges for pins 0, 7, 14 (the LEDs) and 1-3; pin 1 is a clock
+// toggling every step
+static const uint8_t pin_nums[NUM_PINS] = { 0, 7, 14, 1, 2, 3 };
+static uint32_t edge_buf[NUM_PINS][MAX_LEN];
+
+static int make_table(uint32_t *table, uint32_t len) {
+  wave_pin_t pins[NUM_PINS];
+  for (unsigned p = 0; p < NUM_PINS; p++) {
+    uint32_t n = 0;
+    for (uint32_t step = 1; step < len; step++) {
+      if (p == 3 || rnd() % 8U == 0) edge_buf[p][n++] = step;
+    }
+    pins[p].pin = pin_nums[p];
+    pins[p].initial = (uint8_t)(rnd() & 1U);
+    pins[p].edges = edge_buf[p];
+    pins[p].num_edges = n;
+  }
+  return wave_compile(table, len, pins, NUM_PINS);
+}
+
+// ODR after the word at each step of `passes` passes over the tables,
+// from `odr`; switches from table a to table b at step `swap_at`
+static unsigned expected(const uint32_t *a, const uint32_t *b, uint32_t len, uint64_t steps,
+                         uint64_t swap_at, uint32_t odr, change_t *out, unsigned max) {
+  unsigned n = 0;
+  for (uint64_t g = 0; g < steps; g++) {
+    uint32_t w = (g < swap_at ? a : b)[g % len];
+    uint32_t next = ((odr & ~(w >> 16)) | w) & 0xFFFFUL;
+    if (next != odr && n < max) {
+      out[n].odr = next;
+      out[n].at = g; // Step number, not a time
+      n++;
+    }
+    odr = next;
+  }
+  return n;
+}
+
+static change_t want[MAX_CHANGES];
+
+// Compare the recorded changes with the expected ones; returns mismatches.
+// what = NULL to say nothing about them.
+static unsigned compare(const char *what, unsigned num_want, uint64_t step_cycles) {
+  unsigned bad = 0;
+  unsigned n = num_changes < MAX_CHANGES ? num_changes : MAX_CHANGES;
+  if (n != num_want) {
+    if (what) printf("  %s: %u output changes, expected %u\n", what, n, num_want);
+    bad++;
+  }
+  if (!n || !num_want) return bad;
+  // Step 0 of the table went out when the first expected change did
+  uint64_t t0 = changes[0].at - want[0].at * step_cycles;
+  for (unsigned i = 0; i < n && i < num_want; i++) {
+    uint64_t at = t0 + want[i].at * step_cycles;
+    if (changes[i].odr != want[i].odr || changes[i].at != at) {
+      if (what && bad < 5) {
+        printf("  %s: change %u is %04lx at cycle %llu, expected %04lx at %llu\n", what, i,
+               (unsigned long)changes[i].odr, (unsigned long long)changes[i].at,
+               (unsigned long)want[i].odr, (unsigned long long)at);
+      }
+      bad++;
+    }
+  }
+  return bad;
+}
+
+// Sleep until the engine has made `passes` passes (or stopped)
+static void wait_passes(uint32_t passes) {
+  while (wave_busy() && wave_stats()->passes < passes) {
+    uint32_t primask = critical_enter();
+    if (wave_stats()->passes < passes) __WFI();
+    critical_exit(primask);
+  }
+}
+
+static uint32_t table_a[MAX_LEN], table_b[MAX_LEN];
+
+int main(int argc, char **argv) {
+  uint32_t rate = 12000000UL;
+  uint32_t len = 1000;
+  uint32_t passes = 20;
+  int check = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+      rate = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--len") && i + 1 < argc) {
+      len = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--passes") && i + 1 < argc) {
+      passes = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--check")) {
+      check = 1;
+    } else {
+      fprintf(stderr, "usage: %s [--rate HZ] [--len N] [--passes N] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (len < 2 || len > MAX_LEN) {
+    fprintf(stderr, "--len must be 2 to %u\n", MAX_LEN);
+    return 2;
+  }
+
+  unsigned failures = 0;
+
+  // The compiler must refuse bad edge lists
+  {
+    uint32_t t[8];
+    const uint32_t backwards[] = { 3, 2 };
+    const uint32_t too_late[] = { 8 };
+    const uint32_t at_zero[] = { 0 };
+    wave_pin_t p[2] = { { 0, 0, backwards, 2 }, { 0, 0, NULL, 0 } };
+    if (wave_compile(t, 8, p, 1) != -1) failures++;
+    p[0].edges = too_late; p[0].num_edges = 1;
+    if (wave_compile(t, 8, p, 1) != -1) failures++;
+    p[0].edges = at_zero;
+    if (wave_compile(t, 8, p, 1) != -1) failures++;
+    p[0].num_edges = 0; // The same pin twice
+    if (wave_compile(t, 8, p, 2) != -1) failures++;
+    p[0].pin = 16;
+    if (wave_compile(t, 8, p, 1) != -1) failures++;
+    if (failures) printf("wave_compile() accepted a bad edge list\n");
+  }
+
+  sim_reset();
+  clock_init();
+  tick_init(clock_hclk_hz());
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN;
+  for (unsigned p = 0; p < NUM_PINS; p++) GPIOB->MODER |= 1UL << (2U * pin_nums[p]);
+  sim_gpio_set_watch(GPIOB, watch);
+
+  if (make_table(table_a, len) || make_table(table_b, len)) {
+    fprintf(stderr, "wave_compile() failed\n");
+    return 1;
+  }
+
+  // Circular: `passes` passes, every edge on its step
+  num_changes = 0;
+  uint32_t odr0 = GPIOB->ODR;
+  sim_counters_t a = sim_count;
+  uint32_t actual = wave_start(table_a, len, rate, WAVE_CIRCULAR);
+  if (!actual) {
+    fprintf(stderr, "wave_start() cannot run at %lu Hz\n", (unsigned long)rate);
+    return 1;
+  }
+  uint64_t step_cycles = sim_core_hz / actual;
+  wait_passes(passes);
+  wave_stop();
+  sim_counters_t b = sim_count;
+  {
+    // Stopped mid-pass: compare only whole passes
+    unsigned w = expected(table_a, table_a, len, (uint64_t)passes * len, UINT64_MAX, odr0, want, MAX_CHANGES);
+    if (num_changes > w) num_changes = w;
+    unsigned bad = compare("circular", w, step_cycles);
+    printf("circular:  %lu steps/s (%llu cycles each), %lu words x %lu passes, %u output changes%s\n",
+           (unsigned long)actual, (unsigned long long)step_cycles, (unsigned long)len,
+           (unsigned long)passes, w, bad ? "  MISMATCH" : ", all on their step");
+    failures += bad;
+  }
+  uint64_t cycles = b.cycles - a.cycles;
+  printf("           cpu busy %.2f%% (SysTick included), %.2f interrupts per pass\n",
+         100.0 * (double)(cycles - (b.idle_cycles - a.idle_cycles)) / (double)cycles,
+         (double)(b.irq_entries - a.irq_entries) / passes);
+
+  // Swap mid-pass: B must start on a pass boundary, within two of the call
+  {
+    num_changes = 0;
+    odr0 = GPIOB->ODR;
+    uint32_t first = wave_stats()->passes;
+    uint32_t swaps = wave_stats()->swaps;
+    wave_start(table_a, len, rate, WAVE_CIRCULAR);
+    wait_passes(first + 3);
+    sim_run(step_cycles * len / 3); // Somewhere in pass 4
+    uint32_t called_in = wave_stats()->passes - first;
+    if (!wave_swap(table_b)) failures++;
+    wait_passes(first + 8);
+    wave_stop();
+    int bad = wave_stats()->swaps != swaps + 1 || wave_swap_pending();
+
+    // Which boundary? Try each: exactly one must explain the output
+    unsigned found = 0, found_at = 0;
+    for (unsigned k = called_in + 1; k <= called_in + 2; k++) {
+      unsigned w = expected(table_a, table_b, len, 8ULL * len, (uint64_t)k * len, odr0, want, MAX_CHANGES);
+      unsigned n = num_changes;
+      if (num_changes > w) num_changes = w;
+      unsigned bad_here = compare(NULL, w, step_cycles) > 0;
+      num_changes = n;
+      if (!bad_here) { found++; found_at = k; }
+    }
+    if (found != 1) bad = 1;
+    printf("swap:      called in pass %u, table B from the start of pass %u%s\n",
+           called_in + 1, found_at + 1, bad ? "  MISMATCH" : "");
+    failures += (unsigned)bad;
+  }
+
+  // One-shot: once through, then the engine stops by itself
+  {
+    num_changes = 0;
+    odr0 = GPIOB->ODR;
+    uint32_t first = wave_stats()->passes;
+    wave_start(table_b, len, rate, WAVE_ONE_SHOT);
+    wait_passes(first + 1);
+    sim_run(step_cycles * len * 2); // Nothing more may come out
+    unsigned w = expected(table_b, table_b, len, len, UINT64_MAX, odr0, want, MAX_CHANGES);
+    unsigned bad = compare("one-shot", w, step_cycles);
+    if (wave_busy() || wave_stats()->passes != first + 1) bad++;
+    printf("one-shot:  %u output changes, %s%s\n", w, wave_busy() ? "still running" : "stopped",
+           bad ? "  MISMATCH" : "");
+    failures += bad;
+  }
+
+  if (wave_stats()->errors) {
+    printf("%lu DMA transfer errors\n", (unsigned long)wave_stats()->errors);
+    failures++;
+  }
+  if (check && failures) {
+    fprintf(stderr, "FAIL: %u mismatches\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * arena.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Scratch arenas. See arena.h.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "console.h"
+
+void arena_init(arena_t *a, const char *name, void *buf, uint32_t size) {
+  // Start and end on 8-byte boundaries
+  uintptr_t start = ((uintptr_t)buf + 7U) & ~(uintptr_t)7U;
+  uint32_t skip = (uint32_t)(start - (uintptr_t)buf);
+  a->name = name;
+  a->base = (uint8_t *)start;
+  a->size = size > skip ? (size - skip) & ~7U : 0U;
+  a->top = 0;
+  a->peak = 0;
+  a->failures = 0;
+}
+
+void *arena_alloc(arena_t *a, uint32_t size) {
+  uint32_t need = (size + 7U) & ~7U;
+  if (need < size || need > a->size - a->top) {
+    a->failures++;
+    return NULL;
+  }
+  void *p = a->base + a->top;
+  a->top += need;
+  if (a->top > a->peak) a->peak = a->top;
+  return p;
+}
+
+void arena_report(const arena_t *a) {
+  console_printf("arena %s: %lu of %lu bytes in use, peak %lu, %lu failures\r\n",
+                 a->name, (unsigned long)a->top, (unsigned long)a->size,
+                 (unsigned long)a->peak, (unsigned long)a->failures);
+}
@@ -0,0 +1,70 @@
+/*
+ * arena.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Scratch arenas: allocation is a bump of an offset into a fixed buffer,
+ * and everything allocated since a mark is freed at once by going back
+ * to it. For memory a request needs while it is handled and not after:
+ *
+ *   {
+ *     ARENA_SCOPE(&scratch);
+ *     char *line = arena_alloc(&scratch, 128);
+ *     ...
+ *   } // line is gone
+ *
+ * Both are O(1). An arena belongs to one context: do not share one
+ * between thread mode and an interrupt handler.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdint.h>
+
+typedef struct {
+  const char *name;
+  uint8_t *base;
+  uint32_t size;
+  uint32_t top;       // Offset of the next free byte
+
+  uint32_t peak;      // Highest top ever
+  uint32_t failures;  // Allocations that did not fit
+} arena_t;
+
+void arena_init(arena_t *a, const char *name, void *buf, uint32_t size);
+
+// size bytes, 8-byte aligned, or NULL if the arena is full
+void *arena_alloc(arena_t *a, uint32_t size);
+
+// Where the arena is now, and going back there
+static inline uint32_t arena_mark(const arena_t *a) {
+  return a->top;
+}
+
+static inline void arena_release(arena_t *a, uint32_t mark) {
+  a->top = mark;
+}
+
+typedef struct {
+  arena_t *arena;
+  uint32_t mark;
+} arena_scope_t;
+
+static inline void arena_scope_end(arena_scope_t *s) {
+  arena_release(s->arena, s->mark);
+}
+
+// Free what the enclosing block allocates from A when it is left,
+// however that happens
+#define ARENA_SCOPE_(A, LINE) \
+  arena_scope_t arena_scope_##LINE __attribute__((cleanup(arena_scope_end))) = \
+    { (A), arena_mark(A) }
+#define ARENA_SCOPE_AT(A, LINE) ARENA_SCOPE_(A, LINE)
+#define ARENA_SCOPE(A) ARENA_SCOPE_AT(A, __LINE__)
+
+// printf() an arena's use
+void arena_report(const arena_t *a);
+
+#endif /* ARENA_H_ */
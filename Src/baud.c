@@ -0,0 +1,163 @@
+/*
+ * baud.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Console line rate negotiation and auto-baud. See baud.h for the
+ * protocol.
+ *
+ * The handlers run in thread mode from cmd_poll() and only decide; the
+ * change itself waits in baud_poll() until console_tx_busy() says the
+ * response has left the shift register, as update.c does for BEGIN.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "baud.h"
+#include "console.h"
+#include "tick.h"
+#include "uart.h"
+
+// Fastest first
+static const uint32_t rates[] = { 3000000, 2000000, 1000000, 921600, 460800, 230400, 115200,
+                                  57600,   38400,   19200,   9600 };
+
+// What auto-baud measured is taken for a standard rate this close to it
+#define SNAP_PPM 20000
+
+static uint32_t new_baud;   // To change to once the response has gone
+static uint32_t home_baud;  // The rate PROPOSE came at, while on trial
+static uint32_t trial_at;   // tick_now() of the change
+static int autobaud_done;
+
+static baud_stats_t stats;
+
+static inline uint32_t get_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uart_port_t *line(void) {
+  return uart_port(UART_USART3);
+}
+
+uint32_t baud_pick(uint32_t max, int32_t max_ppm) {
+  uart_port_t *p = line();
+
+  for (uint32_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+    int over8;
+    int32_t ppm;
+    if (rates[i] > max || (stats.limit && rates[i] >= stats.limit)) continue;
+    if (!compute_uart_divider(uart_kernel_hz(p), rates[i], &over8, &ppm)) continue;
+    if (ppm <= max_ppm && ppm >= -max_ppm) return rates[i];
+  }
+  return p->baud;
+}
+
+cmd_status_t baud_propose(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len) {
+  uart_port_t *p = line();
+
+  if (new_baud || home_baud) return CMD_ERR_FAILED; // One trial at a time
+  uint32_t baud = baud_pick(get_le32(req->payload), BAUD_MAX_PPM);
+  if (baud != p->baud) {
+    home_baud = p->baud;
+    new_baud = baud;
+    stats.proposals++;
+  }
+  put_le32(resp, baud);
+  put_le32(resp + 4, BAUD_WINDOW_MS);
+  *resp_len = 8;
+  return CMD_OK;
+}
+
+cmd_status_t baud_verify(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len) {
+  if (req->len != BAUD_PATTERN_LEN) return CMD_ERR_LENGTH;
+  for (uint32_t i = 0; i < BAUD_PATTERN_LEN; i++) {
+    if (req->payload[i] != baud_pattern(i)) {
+      stats.bad_verify++;
+      return CMD_ERR_ARG;
+    }
+  }
+  memcpy(resp, req->payload, BAUD_PATTERN_LEN);
+  *resp_len = BAUD_PATTERN_LEN;
+  return CMD_OK;
+}
+
+cmd_status_t baud_commit(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len) {
+  (void)req;
+  // Too early: the PROPOSE response is still going out at the old rate
+  if (new_baud) return CMD_ERR_FAILED;
+  if (home_baud) {
+    home_baud = 0;
+    stats.committed++;
+  }
+  put_le32(resp, line()->baud);
+  *resp_len = 4;
+  return CMD_OK;
+}
+
+void baud_init(void) {
+  memset(&stats, 0, sizeof(stats));
+  new_baud = home_baud = 0;
+  autobaud_done = 0;
+  uart_autobaud_start(line());
+}
+
+// A standard rate for what auto-baud measured, if one is close
+static uint32_t snap(uint32_t measured) {
+  for (uint32_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+    int64_t d = (int64_t)measured - (int64_t)rates[i];
+    if (d * 1000000 <= (int64_t)rates[i] * SNAP_PPM && -d * 1000000 <= (int64_t)rates[i] * SNAP_PPM) {
+      return rates[i];
+    }
+  }
+  return measured;
+}
+
+int baud_poll(void) {
+  uart_port_t *p = line();
+  int locked = 0;
+
+  if (!autobaud_done && p->autobaud != UART_AUTOBAUD_WAITING && !console_tx_busy()) {
+    autobaud_done = 1;
+    if (p->autobaud == UART_AUTOBAUD_LOCKED) {
+      uart_set_baud(p, snap(p->baud));
+      stats.autobaud = p->baud;
+      locked = 1;
+    }
+    uart_autobaud_stop(p);
+  }
+
+  // The response asking for it has to be all the way out first
+  if (new_baud && !console_tx_busy()) {
+    uart_set_baud(p, new_baud);
+    new_baud = 0;
+    trial_at = tick_now();
+  }
+  if (home_baud && !new_baud && tick_now() - trial_at > TICK_MS(BAUD_WINDOW_MS) &&
+      !console_tx_busy()) {
+    if (!stats.limit || p->baud < stats.limit) stats.limit = p->baud;
+    uart_set_baud(p, home_baud);
+    home_baud = 0;
+    stats.fallbacks++;
+  }
+  return locked;
+}
+
+int baud_busy(void) {
+  return new_baud || home_baud;
+}
+
+const baud_stats_t *baud_stats(void) {
+  return &stats;
+}
@@ -0,0 +1,113 @@
+/*
+ * baud.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * The console line's rate: found by auto-baud at start-up, then raised
+ * by negotiation with the host, as three cmd.h commands:
+ *
+ *   PROPOSE {max_baud: u32}
+ *           -> {baud, window_ms: u32}
+ *           baud is the fastest standard rate, 9600 to 3M, up to
+ *           max_baud that the USART clock reaches within BAUD_MAX_PPM
+ *           and that has not failed here (below). If it is the rate
+ *           already, that is all. Otherwise the rate is on trial: once the response's last
+ *           stop bit has gone, the device changes to it; the host changes
+ *           when it has the response, and waits BAUD_SETTLE_MS.
+ *   VERIFY  {BAUD_PATTERN_LEN bytes of baud_pattern()}
+ *           -> the same bytes
+ *           Checks both directions at the new rate: the device refuses a
+ *           wrong pattern with CMD_ERR_ARG, the host checks the echo. The
+ *           pattern has runs of 0s and 1s and every edge, where rate
+ *           errors show first. Any time is fine, not only on trial.
+ *   COMMIT  {} -> {baud}
+ *           The host had the echo back intact: the rate stays. Sent again
+ *           after a lost response, it gets the same answer.
+ *
+ * Fallback: if no COMMIT comes within window_ms of the change, the device
+ * goes back to the rate PROPOSE came at, and neither PROPOSE nor an
+ * update's BEGIN (update.h) offers that rate or a faster one again until
+ * reset. The host does the same when VERIFY or COMMIT goes unanswered,
+ * or the echo is wrong: it waits out the window, changes back, and may
+ * PROPOSE again with a lower max_baud. So each end falls back on its own,
+ * and they meet at the old rate without another word.
+ *
+ * Auto-baud: baud_init() has the USART take its rate from the first 0x55
+ * ('U') the host sends (uart_autobaud_start()). A host at 115200 can skip
+ * that; its first byte shows the line is right as it is.
+ *
+ * Sim/baud-host.h is the host side; update-send negotiates with it
+ * before an update, so the bulk data goes at the fastest rate that has
+ * passed VERIFY.
+ */
+
+#ifndef BAUD_H_
+#define BAUD_H_
+
+#include <stdint.h>
+
+#include "cmd.h"
+
+#define BAUD_CMD_PROPOSE 0x30U
+#define BAUD_CMD_VERIFY  0x31U
+#define BAUD_CMD_COMMIT  0x32U
+
+#define BAUD_PATTERN_LEN 64U
+
+// Rate error the USART clock may leave at a negotiated rate; the far end
+// adds its own, and 8N1 tolerates about 4% in all
+#ifndef BAUD_MAX_PPM
+#define BAUD_MAX_PPM 10000
+#endif
+
+// How long a rate on trial waits for COMMIT
+#ifndef BAUD_WINDOW_MS
+#define BAUD_WINDOW_MS 500U
+#endif
+
+// How long the host waits after a change of rate before sending
+#define BAUD_SETTLE_MS 5U
+
+typedef struct {
+  uint32_t autobaud;    // Rate auto-baud locked on to, 0 if none
+  uint32_t proposals;   // PROPOSEs that changed the rate
+  uint32_t committed;   // Of those, kept
+  uint32_t fallbacks;   // Of those, given up after the window
+  uint32_t bad_verify;  // VERIFYs with the wrong pattern
+  uint32_t limit;       // The slowest rate that has failed, 0 if none
+} baud_stats_t;
+
+// Command handlers for the application's table (cmd.h)
+cmd_status_t baud_propose(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len);
+cmd_status_t baud_verify(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len);
+cmd_status_t baud_commit(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len);
+
+// Start auto-baud on the console USART; after console_init()
+void baud_init(void);
+
+// From the main loop after cmd_poll(): changes the rate once the response
+// asking for it has gone, falls back when a trial runs out, and settles
+// auto-baud. Returns 1 when auto-baud has just locked on to a new rate.
+int baud_poll(void);
+
+// A rate is on trial or about to change: for power_init()'s busy table
+int baud_busy(void);
+
+// The fastest standard rate up to max that the console USART's clock
+// reaches within max_ppm and that has not failed a trial; the current
+// rate if none is
+uint32_t baud_pick(uint32_t max, int32_t max_ppm);
+
+// Byte i of the VERIFY pattern, for both ends: long runs of one level
+// and every single-bit edge, then a spread of the rest. A rate a few
+// percent out shows in the runs first.
+static inline uint8_t baud_pattern(uint32_t i) {
+  static const uint8_t fixed[] = { 0x55, 0xAA, 0x00, 0xFF, 0x00, 0x00, 0xFF, 0xFF,
+                                   0x0F, 0xF0, 0x33, 0xCC, 0x01, 0x80, 0x7F, 0xFE };
+  return i < sizeof(fixed) ? fixed[i] : (uint8_t)(i * 73U + 41U);
+}
+
+const baud_stats_t *baud_stats(void);
+
+#endif /* BAUD_H_ */
@@ -0,0 +1,182 @@
+/*
+ * boot.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Boot phase report, the startup loop comparison, and deferred static
+ * constructors. See boot.h.
+ *
+ * The comparison copies from flash (the ITCM code's load image) and fills
+ * scratch buffers in SRAM1 and DTCM, with interrupts masked. "Cold" has
+ * the D-cache cleaned and invalidated first, as it is at reset just after
+ * SystemInit() turns it on; "warm" runs it again straight after. It runs
+ * at the current clock: at 216MHz flash needs 7 wait states (RM0410 Rev 5
+ * Sec 3.3.2 p 89), where at the 16MHz reset clock it needed none, so the
+ * flash copies cost more cycles here than they did at boot.
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "boot.h"
+#include "console.h"
+#include "critical.h"
+#include "cycles.h"
+#include "sections.h"
+
+#define RESET_HZ    16000000UL // HSI: RM0410 Rev 5 Sec 5.2.2
+#define CPACR_FULL  (0xFUL << 20) // CP10 and CP11: PM0253 Rev 5 Sec 4.7.1
+#define MVFR0_DP    (0xFUL << 8)  // Double-precision support, Sec 4.7
+#define BENCH_WORDS 1024U
+
+// Linker script symbols
+extern uint32_t _sdata[], _edata[];
+extern uint32_t _sdtcm[], _edtcm[];
+extern uint32_t _siitcm[], _sitcm[], _eitcm[];
+extern uint32_t _sbss[], _ebss[];
+extern uint32_t _sdtcm_bss[], _edtcm_bss[];
+extern uint32_t _sstack[], _estack[];
+
+// newlib: runs .preinit_array, _init() and .init_array
+extern void __libc_init_array(void);
+
+DTCM_NOINIT volatile uint32_t boot_cycles[BOOT_NUM_MARKS];
+
+static int constructed;
+
+DTCM_NOINIT static uint32_t dtcm_buf[BENCH_WORDS];
+SRAM1_NOINIT static uint32_t sram1_buf[BENCH_WORDS];
+
+void boot_constructors(void) {
+  if (constructed) return;
+  constructed = 1;
+  __libc_init_array();
+}
+
+void boot_reset_constructors(void) {
+#if !BOOT_DEFER_CONSTRUCTORS
+  boot_constructors();
+#endif
+}
+
+static uint32_t span(const uint32_t *start, const uint32_t *end) {
+  return (uint32_t)((uintptr_t)end - (uintptr_t)start);
+}
+
+int boot_fpu_ok(void) {
+  uint32_t lazy = FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+  return (SCB->CPACR & CPACR_FULL) == CPACR_FULL && (FPU->FPCCR & lazy) == lazy &&
+         (FPU->MVFR0 & MVFR0_DP) != 0;
+}
+
+void boot_report(void) {
+  static const char *const names[BOOT_NUM_MARKS] = {
+    "DWT start", "SystemInit", ".data", ".dtcm_data", ".itcm", ".bss", ".dtcm_bss",
+    "stack paint", "constructors",
+  };
+  // Nothing was on the stack yet when it was painted
+  const uint32_t bytes[BOOT_NUM_MARKS] = {
+    0, 0, span(_sdata, _edata), span(_sdtcm, _edtcm), span(_sitcm, _eitcm),
+    span(_sbss, _ebss), span(_sdtcm_bss, _edtcm_bss), span(_sstack, _estack), 0,
+  };
+  uint32_t total = boot_cycles[BOOT_CONSTRUCTORS];
+
+  console_printf("\r\nreset to main() in %lu cycles, %lu us at %lu MHz%s\r\n",
+                 (unsigned long)total, (unsigned long)(total / (RESET_HZ / 1000000UL)),
+                 (unsigned long)(RESET_HZ / 1000000UL),
+                 BOOT_DEFER_CONSTRUCTORS ? ", constructors deferred" : "");
+  console_printf("phase             bytes   cycles  per word\r\n");
+  for (unsigned i = BOOT_SYSTEM_INIT; i < BOOT_NUM_MARKS; i++) {
+    uint32_t c = boot_cycles[i] - boot_cycles[i - 1U];
+    uint32_t words = bytes[i] / 4U;
+    if (words) {
+      console_printf("%-14s %8lu %8lu %6lu.%02lu\r\n", names[i], (unsigned long)bytes[i],
+                     (unsigned long)c, (unsigned long)(c / words),
+                     (unsigned long)(c * 100U / words % 100U));
+    } else {
+      console_printf("%-14s %8s %8lu\r\n", names[i], "-", (unsigned long)c);
+    }
+  }
+  console_printf("FPU %s: CPACR %08lx, FPCCR %08lx, MVFR0 %08lx\r\n",
+                 boot_fpu_ok() ? "on, lazy stacking" : "NOT SET UP",
+                 (unsigned long)SCB->CPACR, (unsigned long)FPU->FPCCR, (unsigned long)FPU->MVFR0);
+}
+
+typedef struct {
+  const char *name;
+  uint32_t *buf;
+  int copy; // Else a zero fill
+} bench_case_t;
+
+// Cycles to copy or fill BENCH_WORDS with one loop or the other
+static uint32_t time_loop(const bench_case_t *c, int block, int cold) {
+  uint32_t *end = c->buf + BENCH_WORDS;
+  uint32_t t0, t;
+  uint32_t primask = critical_enter();
+
+  if (cold && (SCB->CCR & SCB_CCR_DC_Msk)) {
+    SCB_CleanDCache();
+    SCB_InvalidateDCache();
+  }
+  t0 = cycles_now();
+  if (c->copy) {
+    if (block) boot_copy_block(c->buf, end, _siitcm);
+    else       boot_copy_word(c->buf, end, _siitcm);
+  } else {
+    if (block) boot_fill_block(c->buf, end, 0);
+    else       boot_fill_word(c->buf, end, 0);
+  }
+  t = cycles_now() - t0;
+
+  critical_exit(primask);
+  return t;
+}
+
+// Hundredths of a cycle per word
+static uint32_t per_word(uint32_t cycles) {
+  return (uint32_t)((uint64_t)cycles * 100U / BENCH_WORDS);
+}
+
+void boot_bench(void) {
+  const bench_case_t cases[] = {
+    { "copy -> SRAM1", sram1_buf, 1 },
+    { "copy -> DTCM",  dtcm_buf,  1 },
+    { "zero SRAM1",    sram1_buf, 0 },
+    { "zero DTCM",     dtcm_buf,  0 },
+  };
+  // Words of this image that the startup moves as each case does
+  const uint32_t words[] = {
+    span(_sdata, _edata) / 4U,
+    (span(_sdtcm, _edtcm) + span(_sitcm, _eitcm)) / 4U,
+    span(_sbss, _ebss) / 4U,
+    (span(_sdtcm_bss, _edtcm_bss) + span(_sstack, _estack)) / 4U,
+  };
+  uint64_t est[2] = { 0, 0 };
+
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) cycles_init();
+
+  console_printf("\r\ncycles per word over %u words, from flash\r\n", BENCH_WORDS);
+  console_printf("                  word loop       LDM/STM\r\n");
+  console_printf("                 cold   warm    cold   warm\r\n");
+  for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    uint32_t r[2][2]; // [block][warm]
+    for (int block = 0; block < 2; block++) {
+      r[block][0] = per_word(time_loop(&cases[i], block, 1));
+      r[block][1] = per_word(time_loop(&cases[i], block, 0));
+      est[block] += (uint64_t)words[i] * r[block][0] / 100U;
+    }
+    console_printf("%-14s %3lu.%02lu %3lu.%02lu  %3lu.%02lu %3lu.%02lu\r\n", cases[i].name,
+                   (unsigned long)(r[0][0] / 100U), (unsigned long)(r[0][0] % 100U),
+                   (unsigned long)(r[0][1] / 100U), (unsigned long)(r[0][1] % 100U),
+                   (unsigned long)(r[1][0] / 100U), (unsigned long)(r[1][0] % 100U),
+                   (unsigned long)(r[1][1] / 100U), (unsigned long)(r[1][1] % 100U));
+  }
+  console_printf("this image's copies and fills, at the cold rates: word loop %lu cycles, "
+                 "LDM/STM %lu cycles\r\n", (unsigned long)est[0], (unsigned long)est[1]);
+  console_printf("(at boot they took %lu cycles)\r\n",
+                 (unsigned long)(boot_cycles[BOOT_STACK_PAINT] - boot_cycles[BOOT_SYSTEM_INIT]));
+}
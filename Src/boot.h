@@ -0,0 +1,88 @@
+/*
+ * boot.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Reset to main(): how long each step of Reset_Handler took.
+ *
+ * Reset_Handler (Startup/startup_stm32f767zitx.s) starts DWT->CYCCNT from
+ * 0 as its first act, and records it at the end of each phase into
+ * boot_cycles[], which is in .dtcm_noinit so that zeroing .bss cannot
+ * lose it. The phases run at the reset clock, 16MHz HSI: clock_init()
+ * comes later, in main(). Cycles spent before the first instruction
+ * (the reset sequence and the option byte load), and the few that enable
+ * the FPU ahead of the counter, are not counted.
+ *
+ * The FPU is enabled first of all, since everything in C is built for
+ * it, with lazy stacking: an interrupt reserves 72 more bytes of stack
+ * for S0-S15 and FPSCR, but spends the cycles to save them only if its
+ * handler uses the FPU. boot_fpu_ok() reads the set-up back.
+ *
+ * The copies and fills move eight words per LDM/STM, then finish one word
+ * at a time. boot_bench() times them against the one-word loops the
+ * startup used before, on the same memories: per word, the old copy loop
+ * runs six instructions (ldr, str, three ALU, branch) and the old fill
+ * loop four; the new ones run one LDM/STM pair, or one STM, and three
+ * loop instructions per eight words.
+ *
+ * Static constructors (__libc_init_array) run last, from
+ * boot_reset_constructors(). Define BOOT_DEFER_CONSTRUCTORS as 1 to
+ * have main() call boot_constructors() itself, once whatever must come
+ * up first after a watchdog reset is running. Until then no C++ static
+ * object is constructed and no constructor-attribute function has run.
+ */
+
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include <stdint.h>
+
+#ifndef BOOT_DEFER_CONSTRUCTORS
+#define BOOT_DEFER_CONSTRUCTORS 0
+#endif
+
+// boot_cycles[] index: CYCCNT at the end of each phase. The startup
+// writes them by number, in this order.
+typedef enum {
+  BOOT_START,        // Cycle counter running
+  BOOT_SYSTEM_INIT,  // SystemInit(): L1 caches on
+  BOOT_DATA,         // .data copied from flash to SRAM1
+  BOOT_DTCM_DATA,    // .dtcm_data copied from flash
+  BOOT_ITCM,         // .itcm code copied from flash
+  BOOT_BSS,          // .bss zeroed
+  BOOT_DTCM_BSS,     // .dtcm_bss zeroed
+  BOOT_STACK_PAINT,  // Stack painted for memstat.c
+  BOOT_CONSTRUCTORS, // Static constructors run (or deferred): main() next
+  BOOT_NUM_MARKS
+} boot_mark_t;
+
+extern volatile uint32_t boot_cycles[BOOT_NUM_MARKS];
+
+// The startup's copy and fill loops. All pointers word aligned; they
+// write dst[0] up to (not including) end.
+void boot_copy_block(uint32_t *dst, uint32_t *end, const uint32_t *src);
+void boot_fill_block(uint32_t *dst, uint32_t *end, uint32_t value);
+// The one-word-per-iteration loops they replaced, for comparison
+void boot_copy_word(uint32_t *dst, uint32_t *end, const uint32_t *src);
+void boot_fill_word(uint32_t *dst, uint32_t *end, uint32_t value);
+
+// Called by Reset_Handler: runs the static constructors, unless deferred
+void boot_reset_constructors(void);
+
+// Run the static constructors if they have not been; safe to call again
+void boot_constructors(void);
+
+// 1 if CP10 and CP11 have full access, automatic and lazy FP context
+// saving are both on, and the FPU does double precision
+int boot_fpu_ok(void);
+
+// printf() each phase of this boot: bytes, cycles and cycles per word;
+// then the FPU set-up
+void boot_report(void);
+
+// printf() cycles per word of the startup's copy and fill loops against
+// the one-word loops, cold and warm, into SRAM1 and DTCM
+void boot_bench(void);
+
+#endif /* BOOT_H_ */
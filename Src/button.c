@@ -0,0 +1,174 @@
+/*
+ * button.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Debounced user button on EXTI13 and TIM7. See button.h.
+ *
+ * EXTI:   RM0410 Rev 5 Sec 11.3 p 297; line 13 is routed to PC13 by
+ *         SYSCFG_EXTICR4, Sec 7.2.6 p 225
+ * TIM7:   RM0410 Rev 5 Sec 28.3 p 1035 - with OPM the counter stops at
+ *         the update event, and URS keeps a software UG from setting UIF
+ * Timer clock: APB1 timers run at PCLK1, or 2 x PCLK1 if APB1 is
+ *         divided, Sec 5.2 p 150
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "button.h"
+#include "clock.h"
+#include "cycles.h"
+#include "nucleo-btn.h"
+#include "prof.h"
+#include "ring.h"
+#include "sections.h"
+
+#define BUTTON_LINE   USER_BTN // EXTI line n is pin n of the selected port
+#define TIM_HZ        10000UL  // TIM7 counts tenths of a millisecond
+
+typedef enum { TIMER_IDLE, TIMER_LOCKOUT, TIMER_LONG } timer_mode_t;
+
+// Written only by the handlers, which cannot preempt each other
+static volatile int down;
+static int long_sent;
+static timer_mode_t timer_mode;
+static volatile uint32_t dropped;
+static button_notify_t notify;
+
+static uint8_t queue_buf[BUTTON_QUEUE_LEN * sizeof(button_event_t)];
+static ring_t queue = RING_INIT(queue_buf, sizeof(queue_buf));
+
+static prof_site_t react_site = { "button_react", 0, 0, 0, 0, 0, 0, { 0 } };
+
+static void put(uint32_t type, uint32_t cycles) {
+  button_event_t ev = { cycles, type };
+  if (ring_free(&queue) < sizeof(ev)) {
+    dropped++;
+    return;
+  }
+  ring_write(&queue, (const uint8_t *)&ev, sizeof(ev));
+  if (notify) notify();
+}
+
+// Restart TIM7 to expire in ms
+static void timer_start(timer_mode_t mode, uint32_t ms) {
+  timer_mode = mode;
+  TIM7->CR1 &= ~TIM_CR1_CEN;
+  TIM7->CNT = 0;
+  TIM7->ARR = ms * (TIM_HZ / 1000U) - 1U;
+  TIM7->SR = ~TIM_SR_UIF;
+  TIM7->CR1 |= TIM_CR1_CEN;
+}
+
+static int pin(void) {
+  return (GPIOC->IDR & USER_BTN) != 0;
+}
+
+// The button went to `level`: report it and ignore the line for a while
+static void change(int level, uint32_t cycles) {
+  down = level;
+  put(level ? BUTTON_PRESS : BUTTON_RELEASE, cycles);
+  if (level) long_sent = 0;
+  EXTI->IMR &= ~BUTTON_LINE;
+  timer_start(TIMER_LOCKOUT, BUTTON_LOCKOUT_MS);
+}
+
+ITCM_CODE void EXTI15_10_IRQHandler(void) {
+  PROF_SCOPE(button_exti);
+  uint32_t now = cycles_now();
+
+  // Clear before reading the pin, so a later edge pends again
+  EXTI->PR = BUTTON_LINE;
+  int level = pin();
+  if (level != down) change(level, now);
+}
+
+ITCM_CODE void TIM7_IRQHandler(void) {
+  uint32_t now = cycles_now();
+
+  TIM7->SR = ~TIM_SR_UIF;
+  if (timer_mode == TIMER_LOCKOUT) {
+    // Forget the bounces, then look at where the pin settled
+    EXTI->PR = BUTTON_LINE;
+    EXTI->IMR |= BUTTON_LINE;
+    int level = pin();
+    if (level != down) {
+      change(level, now);
+    } else if (down && !long_sent) {
+      timer_start(TIMER_LONG, BUTTON_LONG_MS - BUTTON_LOCKOUT_MS);
+    } else {
+      timer_mode = TIMER_IDLE;
+    }
+  } else if (timer_mode == TIMER_LONG) {
+    timer_mode = TIMER_IDLE;
+    if (down) {
+      long_sent = 1;
+      put(BUTTON_LONG_PRESS, now);
+    }
+  }
+}
+
+void button_init(void) {
+  uint32_t pclk1 = clock_pclk1_hz();
+  uint32_t tim_clk = clock_hclk_hz() == pclk1 ? pclk1 : 2U * pclk1;
+
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPIOCEN;
+  RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+  RCC->APB1ENR |= RCC_APB1ENR_TIM7EN;
+
+  // Input, no pull: the board has its own pull-down (UM1974 Sec 6.6)
+  GPIOC->MODER &= USER_BTN_MODER;
+
+  TIM7->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+  TIM7->PSC = tim_clk / TIM_HZ - 1U;
+  TIM7->EGR = TIM_EGR_UG; // Load PSC now
+  TIM7->SR = ~TIM_SR_UIF;
+  TIM7->DIER = TIM_DIER_UIE;
+
+  MODIFY_REG(SYSCFG->EXTICR[3], SYSCFG_EXTICR4_EXTI13, SYSCFG_EXTICR4_EXTI13_PC);
+  EXTI->RTSR |= BUTTON_LINE;
+  EXTI->FTSR |= BUTTON_LINE;
+  EXTI->PR = BUTTON_LINE;
+
+  down = pin();
+  long_sent = 1; // Held since reset is not a long press
+  timer_mode = TIMER_IDLE;
+
+  NVIC_SetPriority(EXTI15_10_IRQn, BUTTON_IRQ_PRIORITY);
+  NVIC_SetPriority(TIM7_IRQn, BUTTON_IRQ_PRIORITY);
+  NVIC_EnableIRQ(TIM7_IRQn);
+  NVIC_EnableIRQ(EXTI15_10_IRQn);
+  EXTI->IMR |= BUTTON_LINE;
+}
+
+void button_set_notify(button_notify_t fn) {
+  notify = fn;
+}
+
+int button_get(button_event_t *ev) {
+  if (ring_used(&queue) < sizeof(*ev)) return 0;
+  ring_read(&queue, (uint8_t *)ev, sizeof(*ev));
+  prof_record(&react_site, cycles_now() - ev->cycles);
+  return 1;
+}
+
+int button_pending(void) {
+  return !ring_empty(&queue);
+}
+
+int button_down(void) {
+  return down;
+}
+
+int button_busy(void) {
+  return timer_mode != TIMER_IDLE;
+}
+
+uint32_t button_dropped(void) {
+  return dropped;
+}
@@ -0,0 +1,93 @@
+/*
+ * button.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Interrupt-driven user button: B1 on PC13 (nucleo-btn.h), active high,
+ * debounced with TIM7 and reported through an event queue. Nothing polls
+ * the pin, so the main loop can sleep until something happens.
+ *
+ * EXTI13 interrupts on both edges (RM0410 Rev 5 Sec 11.3). The first edge
+ * that changes the button's state is reported at once - the contacts
+ * have closed, however much they are about to bounce - so the reaction
+ * time is the interrupt latency, not a debounce delay. The handler then
+ * masks the line and starts TIM7 for BUTTON_LOCKOUT_MS, during which
+ * bounces are not even seen. When TIM7 expires the line is unmasked and
+ * the pin read again; if it no longer matches (the press was shorter
+ * than the lock-out) that change is reported in turn. An edge that finds
+ * the pin already back where it was - a spike - is ignored.
+ *
+ * A press still held BUTTON_LONG_MS after it started gives a
+ * BUTTON_LONG_PRESS as well, also timed by TIM7.
+ *
+ * Each event carries the DWT cycle count (cycles.h) at which its
+ * interrupt handler ran. button_get() records how long the event waited
+ * for the main loop in the "button_react" profile site, and the EXTI
+ * handler itself is the "button_exti" site: type 'p'.
+ */
+
+#ifndef BUTTON_H_
+#define BUTTON_H_
+
+#include <stdint.h>
+
+// Bounces after an edge are ignored for this long
+#ifndef BUTTON_LOCKOUT_MS
+#define BUTTON_LOCKOUT_MS 20U
+#endif
+
+// Held this long from the press is a long press; at most 6,500
+#ifndef BUTTON_LONG_MS
+#define BUTTON_LONG_MS 1000U
+#endif
+
+// Events waiting for button_get(); a power of two
+#ifndef BUTTON_QUEUE_LEN
+#define BUTTON_QUEUE_LEN 16U
+#endif
+
+// EXTI15_10 and TIM7 share this, so their handlers never preempt each other
+#ifndef BUTTON_IRQ_PRIORITY
+#define BUTTON_IRQ_PRIORITY 6U
+#endif
+
+typedef enum {
+  BUTTON_PRESS = 1,
+  BUTTON_RELEASE,
+  BUTTON_LONG_PRESS,
+} button_type_t;
+
+typedef struct {
+  uint32_t cycles;  // cycles_now() when the handler saw it
+  uint32_t type;    // button_type_t
+} button_event_t;
+
+// Set up PC13, EXTI13 and TIM7 and start listening. Call after
+// clock_init() (TIM7 is prescaled from the APB1 timer clock) and
+// prof_init() (for the timestamps).
+void button_init(void);
+
+// Called from the interrupt handler after each event is queued: to wake
+// a kernel thread that waits for them (kernel.h), say. NULL for none.
+typedef void (*button_notify_t)(void);
+void button_set_notify(button_notify_t fn);
+
+// Take the oldest event. Returns 0 if there is none.
+int button_get(button_event_t *ev);
+
+// True if an event is waiting: check it with interrupts masked before
+// __WFI() so that one arriving in between is not slept through
+int button_pending(void);
+
+// The debounced state: 1 while held down
+int button_down(void);
+
+// True while TIM7 is timing the lock-out or a long press: TIM7 stops in
+// Stop mode, so the core must not go deeper than Sleep
+int button_busy(void);
+
+// Events lost because the queue was full
+uint32_t button_dropped(void);
+
+#endif /* BUTTON_H_ */
@@ -0,0 +1,435 @@
+/*
+ * capture.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Timer-paced DMA from a port's IDR into a ring of blocks, and the
+ * trigger, encoder and framing behind it. See capture.h.
+ *
+ * TIM1 time base: RM0410 Rev 5 Sec 15.3.1 p 462; DIER.UDE raises a DMA
+ *   request at each update event, Sec 15.4.4. RCR is left at 0 so that
+ *   every overflow is an update.
+ * Timer clock: APB2 timers run at PCLK2, or 2 x PCLK2 if APB2 is
+ *   divided, Sec 5.2 p 150
+ * DMA2 Stream 5 Channel 6 is TIM1_UP: Sec 8.3.4 Table 28 p 229
+ * Peripheral-to-memory with the peripheral address fixed: Sec 8.3.6
+ * Double-buffer mode: Sec 8.3.10 p 235 - with the stream enabled only
+ *   the memory address register not in use (per CR.CT) may be written
+ *
+ * Blocks are numbered from 0 at the start of a run; block b lives in
+ * ring[b % CAPTURE_BLOCKS], and sample k of the run in block
+ * k / CAPTURE_BLOCK_SAMPLES. The interrupt after block j has filled
+ * points the stream's idle memory address at block j + 2, unless the
+ * thread still wants the block that held that slot (`keep`).
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "capture.h"
+#include "clock.h"
+#include "cobs.h"
+#include "console.h"
+#include "crc.h"
+#include "critical.h"
+#include "sections.h"
+#include "uart.h"
+
+#define CAPTURE_TIM      TIM1
+#define CAPTURE_DMA      DMA2
+#define CAPTURE_STREAM   DMA2_Stream5
+#define CAPTURE_DMA_CHAN 6UL
+
+// All the stream 5 flags live in HISR/HIFCR bits 6-11
+#define DMA_S5_FLAGS (DMA_HIFCR_CTCIF5 | DMA_HIFCR_CHTIF5 | DMA_HIFCR_CTEIF5 | \
+                      DMA_HIFCR_CDMEIF5 | DMA_HIFCR_CFEIF5)
+
+#define BLOCK      CAPTURE_BLOCK_SAMPLES
+#define NO_END     0xFFFFFFFFUL
+
+// seq, type, payload, CRC; COBS-encoded between two delimiters
+#define RAW_MAX    (2U + CAPTURE_PAYLOAD_MAX + 4U)
+#define WIRE_MAX   (COBS_MAX(RAW_MAX) + 2U)
+
+// Block-aligned so that invalidating one leaves its neighbours alone
+static uint16_t ring[CAPTURE_BLOCKS][BLOCK] SRAM1_NOINIT __attribute__((aligned(32)));
+
+// Shared with the interrupt
+static volatile uint8_t running;      // The DMA is sampling
+static volatile uint8_t end_status;   // capture_end_t, once sampling has stopped
+static volatile uint32_t filled;      // Blocks complete
+static volatile uint32_t keep;        // First block the thread still wants
+static volatile uint32_t last_block;  // Stop once this one is complete
+
+// Thread only
+static uint8_t active;                // Until END is queued
+static uint8_t headed;                // HEADER is framed
+static uint8_t ending;                // END is framed
+static capture_config_t config;
+static uint32_t rate;
+static uint32_t fresh;                // Blocks invalidated so far
+static uint32_t scan;                 // Next sample to look at for the trigger
+static uint16_t last_sample;
+static uint8_t triggered;
+static uint32_t start, end;           // Samples to send: [start, end)
+static uint32_t pos;                  // Next sample to encode
+static capture_rle_t rle;
+static uint8_t data[CAPTURE_PAYLOAD_MAX];
+static uint32_t data_len;
+static uint8_t wire[WIRE_MAX];        // A frame waiting for room on the line
+static uint32_t wire_len;
+static uint8_t seq;
+static capture_stats_t stats;
+
+static inline uint8_t *put_varint(uint8_t *p, uint32_t v) {
+  while (v >= 0x80U) {
+    *p++ = (uint8_t)(v | 0x80U);
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+static inline void put_le16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+void capture_rle_init(capture_rle_t *e) {
+  e->value = 0;
+  e->prev = 0;
+  e->run = 0;
+}
+
+static uint32_t put_record(capture_rle_t *e, uint8_t *out) {
+  uint8_t *p = put_varint(out, (uint32_t)(e->value ^ e->prev));
+  p = put_varint(p, e->run);
+  e->prev = e->value;
+  e->run = 0;
+  return (uint32_t)(p - out);
+}
+
+uint32_t capture_rle_encode(capture_rle_t *e, const uint16_t *s, uint32_t n, uint16_t mask,
+                            uint8_t *out, uint32_t room, uint32_t *used) {
+  uint32_t i = 0;
+
+  while (i < n) {
+    uint16_t v = (uint16_t)(s[i] & mask);
+    if (e->run && v != e->value) {
+      if (*used + CAPTURE_RECORD_MAX > room) break;
+      *used += put_record(e, out + *used);
+    }
+    // The rest of this run: most samples go no further than here
+    uint32_t j = i + 1U;
+    while (j < n && (uint16_t)(s[j] & mask) == v) j++;
+    e->value = v;
+    e->run += j - i;
+    i = j;
+  }
+  return i;
+}
+
+uint32_t capture_rle_flush(capture_rle_t *e, uint8_t *out) {
+  return e->run ? put_record(e, out) : 0U;
+}
+
+// Stop the timer and the stream, recording why if nothing has yet.
+// Safe from the DMA interrupt.
+static void halt(capture_end_t why) {
+  CAPTURE_TIM->CR1 &= ~TIM_CR1_CEN;
+  CAPTURE_TIM->DIER = 0;
+  CLEAR_BIT(CAPTURE_STREAM->CR, DMA_SxCR_EN);
+  while (CAPTURE_STREAM->CR & DMA_SxCR_EN);
+  CAPTURE_DMA->HIFCR = DMA_S5_FLAGS;
+  if (running) end_status = (uint8_t)why;
+  running = 0;
+}
+
+// Block b of the run, fresh from the DMA the first time
+static const uint16_t *block(uint32_t b) {
+  const uint16_t *p = ring[b % CAPTURE_BLOCKS];
+  if (b >= fresh) {
+    SCB_InvalidateDCache_by_Addr((uint32_t *)(uintptr_t)p, (int32_t)sizeof(ring[0]));
+    fresh = b + 1U;
+  }
+  return p;
+}
+
+// COBS-frame a payload into wire; it goes out from send()
+static void frame(uint8_t type, const uint8_t *payload, uint32_t len) {
+  uint8_t raw[RAW_MAX];
+
+  raw[0] = seq++;
+  raw[1] = type;
+  memcpy(raw + 2, payload, len);
+  len += 2U;
+  put_le32(raw + len, crc32(raw, len));
+  wire[0] = 0;
+  wire_len = cobs_encode(wire + 1, raw, len + 4U) + 1U;
+  wire[wire_len++] = 0;
+}
+
+// Queue the waiting frame if the line has room for it. Returns 1 if
+// nothing is left waiting.
+static int send(void) {
+  if (!wire_len) return 1;
+  if (uart_tx_free(uart_port(UART_USART3)) < wire_len) {
+    stats.waits++;
+    return 0;
+  }
+  console_write(wire, (int)wire_len);
+  stats.frames++;
+  wire_len = 0;
+  return 1;
+}
+
+// Frame the records so far, closing the open run
+static void frame_data(void) {
+  data_len += capture_rle_flush(&rle, data + data_len);
+  if (!data_len) return;
+  stats.bytes += data_len;
+  frame(CAPTURE_FRAME_DATA, data, data_len);
+  data_len = 0;
+}
+
+static void frame_header(uint32_t pre) {
+  static GPIO_TypeDef *const ports[] = { GPIOA, GPIOB, GPIOC, GPIOD, GPIOE };
+  uint8_t p[15];
+
+  put_le32(p, rate);
+  p[4] = 0xFF;
+  for (uint32_t i = 0; i < sizeof(ports) / sizeof(ports[0]); i++) {
+    if (ports[i] == config.port) p[4] = (uint8_t)i;
+  }
+  put_le16(p + 5, config.mask);
+  put_le16(p + 7, config.rising);
+  put_le16(p + 9, config.falling);
+  put_le32(p + 11, pre);
+  frame(CAPTURE_FRAME_HEADER, p, sizeof(p));
+}
+
+static void frame_end(void) {
+  uint8_t p[5];
+
+  put_le32(p, pos - start);
+  p[4] = end_status;
+  frame(CAPTURE_FRAME_END, p, sizeof(p));
+}
+
+// Look through the complete blocks for the first trigger edge, letting
+// the DMA have the blocks too old to hold the pre-trigger samples
+static void find_trigger(uint32_t avail) {
+  while (scan < avail) {
+    uint32_t b = scan / BLOCK, i = scan % BLOCK;
+    const uint16_t *s = block(b);
+    uint16_t prev = scan ? last_sample : s[0];
+    for (; i < BLOCK; i++) {
+      uint16_t v = s[i];
+      if ((~prev & v & config.rising) | (prev & ~v & config.falling)) break;
+      prev = v;
+    }
+    last_sample = prev;
+    scan = b * BLOCK + i;
+    if (i < BLOCK) {
+      triggered = 1;
+      break;
+    }
+    keep = (scan > config.pre ? scan - config.pre : 0U) / BLOCK;
+  }
+}
+
+// The trigger is sample t: send from `pre` samples before it
+static void trigger_at(uint32_t t) {
+  start = t > config.pre ? t - config.pre : 0U;
+  pos = start;
+  keep = start / BLOCK;
+  if (config.post) {
+    end = t + config.post;
+    last_block = (end - 1U) / BLOCK;
+  }
+}
+
+uint32_t capture_start(const capture_config_t *cfg) {
+  uint32_t pclk2 = clock_pclk2_hz();
+  uint32_t tim_clk = clock_hclk_hz() == pclk2 ? pclk2 : 2U * pclk2;
+
+  if (!cfg->port || !cfg->mask || cfg->rate_hz == 0 || cfg->rate_hz > CAPTURE_RATE_MAX ||
+      cfg->rate_hz > tim_clk / 2U) {
+    return 0;
+  }
+
+  // Timer clocks per sample, split between the prescaler and ARR
+  uint64_t period = ((uint64_t)tim_clk + cfg->rate_hz / 2U) / cfg->rate_hz;
+  uint64_t psc = (period - 1U) / 0x10000U;
+  if (psc > 0xFFFFU) return 0;
+  uint64_t arr = period / (psc + 1U) - 1U;
+
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA2EN);
+  SET_BIT(RCC->APB2ENR, RCC_APB2ENR_TIM1EN);
+  crc_init();
+  capture_stop();
+
+  config = *cfg;
+  config.rising &= cfg->mask;
+  config.falling &= cfg->mask;
+  if (config.pre > CAPTURE_PRE_MAX) config.pre = CAPTURE_PRE_MAX;
+  rate = (uint32_t)(tim_clk / ((psc + 1U) * (arr + 1U)));
+  fresh = scan = pos = start = 0;
+  end = NO_END;
+  last_sample = 0;
+  capture_rle_init(&rle);
+  data_len = wire_len = 0;
+  seq = 0;
+  filled = keep = 0;
+  last_block = NO_END;
+  // No trigger pins: sample 0 is the trigger
+  triggered = !config.rising && !config.falling;
+  if (triggered) trigger_at(0);
+  end_status = CAPTURE_DONE;
+  headed = ending = 0;
+  active = 1;
+  stats.runs++;
+
+  // Count without requests until everything is set up
+  CAPTURE_TIM->CR1 = TIM_CR1_URS;
+  CAPTURE_TIM->PSC = (uint32_t)psc;
+  CAPTURE_TIM->ARR = (uint32_t)arr;
+  CAPTURE_TIM->RCR = 0;
+  CAPTURE_TIM->CNT = 0;
+  CAPTURE_TIM->EGR = TIM_EGR_UG; // Load PSC now
+  CAPTURE_TIM->SR = 0;
+
+  // Channel 6, half-word to half-word, memory increment,
+  // peripheral-to-memory, very high priority, interrupts on complete and
+  // error; blocks 0 and 1 first, then the interrupt moves them along
+  CAPTURE_STREAM->PAR = (uint32_t)(uintptr_t)&config.port->IDR;
+  CAPTURE_STREAM->M0AR = (uint32_t)(uintptr_t)ring[0];
+  CAPTURE_STREAM->M1AR = (uint32_t)(uintptr_t)ring[1];
+  CAPTURE_STREAM->NDTR = BLOCK;
+  CAPTURE_STREAM->FCR = 0; // Direct mode, no FIFO
+  CAPTURE_STREAM->CR = (CAPTURE_DMA_CHAN << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_PL |
+                       DMA_SxCR_MSIZE_0 | DMA_SxCR_PSIZE_0 | DMA_SxCR_MINC | DMA_SxCR_DBM |
+                       DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+  running = 1;
+  CAPTURE_STREAM->CR |= DMA_SxCR_EN;
+
+  NVIC_EnableIRQ(DMA2_Stream5_IRQn);
+  CAPTURE_TIM->DIER = TIM_DIER_UDE;
+  CAPTURE_TIM->CR1 |= TIM_CR1_CEN;
+
+  return rate;
+}
+
+void capture_stop(void) {
+  uint32_t primask = critical_enter();
+  halt(CAPTURE_STOPPED);
+  critical_exit(primask);
+}
+
+// Frame END; the capture is over once it is queued
+static int finish(void) {
+  frame_end();
+  ending = 1;
+  if (!send()) return 0;
+  active = 0;
+  return 1;
+}
+
+int capture_poll(void) {
+  if (!active || !send()) return 0;
+  if (ending) {
+    active = 0;
+    return 1;
+  }
+
+  // Sampling may stop between the two reads, but then filled is final
+  int sampling = running;
+  uint32_t avail = filled * BLOCK;
+
+  if (!triggered) {
+    find_trigger(avail);
+    if (triggered) {
+      trigger_at(scan);
+    } else if (!sampling) {
+      return finish();
+    } else {
+      return 0;
+    }
+  }
+
+  if (!headed) {
+    headed = 1;
+    frame_header(scan - start);
+    if (!send()) return 0;
+  }
+
+  uint32_t limit = avail < end ? avail : end;
+  while (pos < limit) {
+    uint32_t i = pos % BLOCK;
+    uint32_t n = BLOCK - i < limit - pos ? BLOCK - i : limit - pos;
+    uint32_t took = capture_rle_encode(&rle, block(pos / BLOCK) + i, n, config.mask, data,
+                                       CAPTURE_PAYLOAD_MAX - CAPTURE_RECORD_MAX, &data_len);
+    pos += took;
+    stats.samples += took;
+    keep = pos / BLOCK;
+    if (took < n) {
+      frame_data();
+      if (!send()) return 0;
+    }
+  }
+
+  // Caught up with the DMA: send what there is rather than wait for it
+  frame_data();
+  if (!send()) return 0;
+  if (pos < end && sampling) return 0;
+
+  if (running) halt(CAPTURE_DONE);
+  return finish();
+}
+
+int capture_busy(void) {
+  return active;
+}
+
+const capture_stats_t *capture_stats(void) {
+  return &stats;
+}
+
+ITCM_CODE void DMA2_Stream5_IRQHandler(void) {
+  uint32_t isr = CAPTURE_DMA->HISR;
+
+  CAPTURE_DMA->HIFCR = DMA_S5_FLAGS;
+  if (isr & DMA_HISR_TEIF5) {
+    halt(CAPTURE_ERROR);
+    return;
+  }
+  if (!(isr & DMA_HISR_TCIF5) || !running) return;
+
+  uint32_t j = filled;
+  filled = j + 1U;
+  stats.blocks++;
+  if (j >= last_block) {
+    halt(CAPTURE_DONE);
+  } else if (j + 2U >= keep + CAPTURE_BLOCKS) {
+    // The thread still wants the block whose slot is next
+    stats.overruns++;
+    halt(CAPTURE_OVERRUN);
+  } else {
+    // The stream has just moved to the other memory address
+    uint32_t addr = (uint32_t)(uintptr_t)ring[(j + 2U) % CAPTURE_BLOCKS];
+    if (CAPTURE_STREAM->CR & DMA_SxCR_CT) CAPTURE_STREAM->M0AR = addr;
+    else                                  CAPTURE_STREAM->M1AR = addr;
+  }
+}
@@ -0,0 +1,148 @@
+/*
+ * capture.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Logic-analyzer capture: a GPIO port sampled by hardware, streamed out
+ * on the console line run-length encoded, and written to a VCD file by
+ * Sim/capture-vcd.
+ *
+ * TIM1's update event requests DMA2 Stream 5 (channel 6, TIM1_UP: RM0410
+ * Rev 5 Sec 8.3.4 Table 28), which copies the port's IDR into a ring of
+ * CAPTURE_BLOCKS blocks in SRAM1, one half-word per sample. The stream
+ * runs in double-buffer mode (Sec 8.3.10): each transfer-complete
+ * interrupt points the memory address it has just left at the block
+ * after next, as wave.c swaps tables. Samples land on timer periods
+ * whatever the CPU is doing, and one interrupt runs per block.
+ *
+ * capture_poll(), from the main loop, does the rest on completed blocks:
+ * * looks for the trigger, an edge on any of the trigger pins; with none
+ *   given the capture triggers on its first sample
+ * * keeps `pre` samples from before the trigger, as far as the ring
+ *   holds them (CAPTURE_PRE_MAX)
+ * * encodes from there on, and sends the frames without waiting
+ * The ring gives the encoder CAPTURE_BLOCKS - 2 blocks of slack. If the
+ * line cannot keep up and the DMA comes round to a block not yet sent,
+ * the capture stops there: what was sampled before it still goes out,
+ * and the END frame says OVERRUN. A busy port at a high rate needs the
+ * run to fit in the ring, or a faster line.
+ *
+ * The encoding is a string of records, one per run of equal samples:
+ *   LEB128 varint: the run's value XOR the previous run's (0 before the
+ *                  first); only the masked pins, so always 16 bits or less
+ *   LEB128 varint: the run's length in samples, at least 1
+ * A record with XOR 0 continues the previous run: the encoder closes its
+ * open run at the end of each frame so nothing waits for the next edge.
+ *
+ * Frames go out COBS-encoded between two 0x00 bytes, as cmd.h frames do:
+ *   seq      1 byte, counting frames from 0 at HEADER, so a lost one shows
+ *   type     1 byte, CAPTURE_FRAME_*
+ *   payload
+ *   crc      CRC-32 of seq, type and payload (crc.h), 4 bytes little-endian
+ * That is a command request's layout, which the firmware never sends, so
+ * Sim/cmd-host.h takes these frames for text.
+ *
+ * HEADER payload, little-endian:
+ *   rate_hz u32, port u8 (0 for GPIOA to 4 for GPIOE, 0xFF for others),
+ *   mask u16, rising u16, falling u16,
+ *   pre u32 (samples before the trigger that follow)
+ * DATA payload: whole records
+ * END payload: samples u32 (sent in all), status u8 (capture_end_t)
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+// The sample ring: CAPTURE_BLOCKS x CAPTURE_BLOCK_SAMPLES half-words
+#ifndef CAPTURE_BLOCKS
+#define CAPTURE_BLOCKS 8U
+#endif
+#ifndef CAPTURE_BLOCK_SAMPLES
+#define CAPTURE_BLOCK_SAMPLES 4096U
+#endif
+
+// Most samples kept from before the trigger: the ring less the two
+// blocks the DMA has, and two more the trigger scan may lag behind it
+#define CAPTURE_PRE_MAX ((CAPTURE_BLOCKS - 4U) * CAPTURE_BLOCK_SAMPLES)
+
+// Fastest sample rate: the DMA takes a few AHB cycles per sample, and
+// shares the bus matrix with everything else
+#define CAPTURE_RATE_MAX 10000000U
+
+#define CAPTURE_FRAME_HEADER 0x48U  // 'H'
+#define CAPTURE_FRAME_DATA   0x44U  // 'D'
+#define CAPTURE_FRAME_END    0x45U  // 'E'
+
+// Largest frame payload, and the largest record
+#define CAPTURE_PAYLOAD_MAX 240U
+#define CAPTURE_RECORD_MAX  8U
+
+typedef enum {
+  CAPTURE_DONE = 0,  // All the samples asked for
+  CAPTURE_STOPPED,   // capture_stop()
+  CAPTURE_OVERRUN,   // The DMA caught up with the encoder
+  CAPTURE_ERROR      // DMA transfer error
+} capture_end_t;
+
+typedef struct {
+  GPIO_TypeDef *port;
+  uint16_t mask;     // Pins to record
+  uint16_t rising;   // Trigger on a rising edge of any of these
+  uint16_t falling;  // or a falling edge of any of these
+  uint32_t rate_hz;  // Samples per second
+  uint32_t pre;      // Samples to keep from before the trigger
+  uint32_t post;     // Samples from the trigger on; 0 runs until stopped
+} capture_config_t;
+
+typedef struct {
+  uint32_t runs;      // Captures started
+  uint32_t overruns;
+  uint32_t blocks;    // Filled by the DMA
+  uint32_t samples;   // Sent
+  uint32_t bytes;     // Of records
+  uint32_t frames;    // Sent
+  uint32_t waits;     // Polls that found no room on the line
+} capture_stats_t;
+
+// Run-length encoder: the run open so far
+typedef struct {
+  uint16_t value;  // Of the open run
+  uint16_t prev;   // Of the last record
+  uint32_t run;    // Samples in the open run; 0 if none
+} capture_rle_t;
+
+void capture_rle_init(capture_rle_t *e);
+
+// Encode samples s[0..n), masked, closing runs into records at out +
+// *used while a whole record still fits in room bytes. Returns how many
+// samples it took: fewer than n only once out is full.
+uint32_t capture_rle_encode(capture_rle_t *e, const uint16_t *s, uint32_t n, uint16_t mask,
+                            uint8_t *out, uint32_t room, uint32_t *used);
+
+// Close the open run, if any, into a record at out (CAPTURE_RECORD_MAX
+// bytes). Returns its length.
+uint32_t capture_rle_flush(capture_rle_t *e, uint8_t *out);
+
+// Start capturing as cfg says; the pins must already be inputs. Stops
+// any capture running. Returns the sample rate actually set, or 0 if it
+// cannot be.
+uint32_t capture_start(const capture_config_t *cfg);
+
+// Stop sampling; what was sampled still goes out, then END
+void capture_stop(void);
+
+// Scan, encode and send; call from the main loop. Returns 1 when a
+// capture has just ended (its END frame queued).
+int capture_poll(void);
+
+// True from capture_start() until the END frame is queued
+int capture_busy(void);
+
+const capture_stats_t *capture_stats(void);
+
+#endif /* CAPTURE_H_ */
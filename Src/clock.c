@@ -0,0 +1,147 @@
+/*
+ * clock.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Clock tree bring-up to 216MHz. See clock.h.
+ *
+ * References (RM0410 Rev 5):
+ * * Clock tree: Sec 5.2 Figure 13 p 152
+ * * PLL: Sec 5.2.5 and RCC_PLLCFGR Sec 5.3.2 p 164
+ *   VCO input must be 1-2MHz; VCO output 100-432MHz
+ * * Over-drive: Sec 4.1.4 p 126 - needed above 180MHz
+ * * Flash wait states: Sec 3.3.2 Table 7 p 78 - 7 WS for 210-216MHz at 2.7-3.6V
+ * * ART accelerator and prefetch: Sec 3.3.3, FLASH_ACR Sec 3.7.1 p 101
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "nucleo-clk.h"
+#include "clock.h"
+
+// PLL settings: VCO in = 2MHz (HSE/4 or HSI/8), VCO out = 432MHz
+#define PLL_N       216UL
+#define PLL_P       2UL   // 432 / 2 = 216MHz SYSCLK
+#define PLL_Q       9UL   // 432 / 9 = 48MHz
+#define PLL_R       2UL   // Not used; reset value
+#define PLL_M_HSE   (HSE_HZ / 2000000UL)
+#define PLL_M_HSI   (HSI_HZ / 2000000UL)
+
+// Polling limit for each oscillator/regulator step.
+// There is no time base yet; at 16MHz this is tens of milliseconds.
+#define CLOCK_TIMEOUT 200000UL
+
+// AHB prescaler: HPRE 0xxx = /1, then /2 /4 /8 /16 /64 /128 /256 /512
+static const uint8_t ahb_shift[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9 };
+// APB prescalers: PPREx 0xx = /1, then /2 /4 /8 /16
+static const uint8_t apb_shift[8] = { 0, 0, 0, 0, 1, 2, 3, 4 };
+
+
+clock_source_t clock_init(void) {
+  uint32_t t;
+  clock_source_t src = CLOCK_PLL_HSE;
+
+  // Already running from the PLL (e.g. called again after a soft restart)?
+  // The PLL cannot be reconfigured while it is the system clock.
+  if ((RCC->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_PLL) {
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_HSI);
+    t = CLOCK_TIMEOUT;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI && --t);
+  }
+  CLEAR_BIT(RCC->CR, RCC_CR_PLLON);
+  t = CLOCK_TIMEOUT;
+  while ((RCC->CR & RCC_CR_PLLRDY) && --t);
+
+  // Regulator scale 1: required for over-drive. Only takes effect once
+  // the PLL is on; VOS can only be changed while the PLL is off.
+  SET_BIT(RCC->APB1ENR, PWR_CLK_EN);
+  MODIFY_REG(PWR->CR1, PWR_CR1_VOS, PWR_CR1_VOS);
+
+  // HSE in bypass mode: the ST-LINK drives a clock, there is no crystal
+  SET_BIT(RCC->CR, RCC_CR_HSEBYP | RCC_CR_HSEON);
+  t = CLOCK_TIMEOUT;
+  while (!(RCC->CR & RCC_CR_HSERDY) && --t);
+
+  uint32_t pllcfgr = (PLL_N << RCC_PLLCFGR_PLLN_Pos) |
+                     (((PLL_P / 2UL) - 1UL) << RCC_PLLCFGR_PLLP_Pos) |
+                     (PLL_Q << RCC_PLLCFGR_PLLQ_Pos) |
+                     (PLL_R << RCC_PLLCFGR_PLLR_Pos);
+  if (t) {
+    pllcfgr |= RCC_PLLCFGR_PLLSRC_HSE | (PLL_M_HSE << RCC_PLLCFGR_PLLM_Pos);
+  } else {
+    CLEAR_BIT(RCC->CR, RCC_CR_HSEON | RCC_CR_HSEBYP);
+    pllcfgr |= RCC_PLLCFGR_PLLSRC_HSI | (PLL_M_HSI << RCC_PLLCFGR_PLLM_Pos);
+    src = CLOCK_PLL_HSI;
+  }
+  RCC->PLLCFGR = pllcfgr;
+
+  SET_BIT(RCC->CR, RCC_CR_PLLON);
+  t = CLOCK_TIMEOUT;
+  while (!(RCC->CR & RCC_CR_PLLRDY) && --t);
+  if (!t) return CLOCK_FAILED;
+
+  // Over-drive on, then switch the regulator over to it
+  SET_BIT(PWR->CR1, PWR_CR1_ODEN);
+  t = CLOCK_TIMEOUT;
+  while (!(PWR->CSR1 & PWR_CSR1_ODRDY) && --t);
+  SET_BIT(PWR->CR1, PWR_CR1_ODSWEN);
+  t = CLOCK_TIMEOUT;
+  while (!(PWR->CSR1 & PWR_CSR1_ODSWRDY) && --t);
+  if (!t) return CLOCK_FAILED;
+
+  // Flash must be slowed down before the core speeds up.
+  // ART accelerator + prefetch hide most of the wait states for code
+  // fetched over AXIM.
+  FLASH->ACR = FLASH_ACR_LATENCY_7WS | FLASH_ACR_PRFTEN | FLASH_ACR_ARTEN;
+  if ((FLASH->ACR & FLASH_ACR_LATENCY) != FLASH_ACR_LATENCY_7WS) return CLOCK_FAILED;
+
+  // HCLK = SYSCLK; APB1 = /4 (54MHz max); APB2 = /2 (108MHz max)
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2,
+             RCC_CFGR_HPRE_DIV1 | RCC_CFGR_PPRE1_DIV4 | RCC_CFGR_PPRE2_DIV2);
+
+  MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL);
+  t = CLOCK_TIMEOUT;
+  while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL && --t);
+  if (!t) return CLOCK_FAILED;
+
+  return src;
+}
+
+uint32_t clock_sysclk_hz(void) {
+  switch (RCC->CFGR & RCC_CFGR_SWS) {
+  case RCC_CFGR_SWS_HSE:
+    return HSE_HZ;
+  case RCC_CFGR_SWS_PLL: {
+    uint32_t pll = RCC->PLLCFGR;
+    uint32_t in = (pll & RCC_PLLCFGR_PLLSRC_HSE) ? HSE_HZ : HSI_HZ;
+    uint32_t m = (pll & RCC_PLLCFGR_PLLM) >> RCC_PLLCFGR_PLLM_Pos;
+    uint32_t n = (pll & RCC_PLLCFGR_PLLN) >> RCC_PLLCFGR_PLLN_Pos;
+    uint32_t p = (((pll & RCC_PLLCFGR_PLLP) >> RCC_PLLCFGR_PLLP_Pos) + 1UL) * 2UL;
+    if (m == 0) return 0; // Invalid setting
+    return (in / m) * n / p;
+  }
+  case RCC_CFGR_SWS_HSI:
+  default:
+    return HSI_HZ;
+  }
+}
+
+uint32_t clock_hclk_hz(void) {
+  uint32_t hpre = (RCC->CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos;
+  return clock_sysclk_hz() >> ahb_shift[hpre];
+}
+
+uint32_t clock_pclk1_hz(void) {
+  uint32_t ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+  return clock_hclk_hz() >> apb_shift[ppre];
+}
+
+uint32_t clock_pclk2_hz(void) {
+  uint32_t ppre = (RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos;
+  return clock_hclk_hz() >> apb_shift[ppre];
+}
@@ -0,0 +1,37 @@
+/*
+ * clock.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Clock tree bring-up: 8MHz HSE bypass -> PLL -> 216MHz SYSCLK.
+ *
+ * Out of reset we run on the 16MHz HSI. clock_init() gives us
+ *   SYSCLK = HCLK = 216MHz, PCLK1 = 54MHz (APB1 max), PCLK2 = 108MHz (APB2 max)
+ * plus 48MHz on PLLQ for USB/RNG/SDMMC.
+ *
+ * The clock query functions read the RCC registers, so they are correct
+ * whatever the clock tree is currently doing (e.g. after Stop mode).
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdint.h>
+
+typedef enum {
+  CLOCK_PLL_HSE = 0,  // 216MHz from the ST-LINK 8MHz clock
+  CLOCK_PLL_HSI,      // 216MHz from the internal RC: HSE never became ready
+  CLOCK_FAILED        // Still on the HSI at 16MHz
+} clock_source_t;
+
+// Bring the core up to 216MHz. Falls back to the HSI as PLL input
+// if the HSE does not start (e.g. SB148 open, no MCO from the ST-LINK).
+clock_source_t clock_init(void);
+
+uint32_t clock_sysclk_hz(void);
+uint32_t clock_hclk_hz(void);
+uint32_t clock_pclk1_hz(void);
+uint32_t clock_pclk2_hz(void);
+
+#endif /* CLOCK_H_ */
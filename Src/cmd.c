@@ -0,0 +1,219 @@
+/*
+ * cmd.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Framed binary commands. See cmd.h for the format.
+ *
+ * The receive side runs in the USART3 interrupt handler, one byte per
+ * call: COBS is undone as the bytes come, into rx_buf, so all that is
+ * left at the closing 0x00 is the CRC (on the CRC unit, about a cycle a
+ * byte) and a copy into the queue. The queue is single-producer,
+ * single-consumer like ring.h: the handler moves only q_head, cmd_poll()
+ * only q_tail.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "cmd.h"
+#include "cobs.h"
+#include "console.h"
+#include "crc.h"
+#include "ring.h"
+#include "sections.h"
+#include "uart.h"
+
+#if (CMD_QUEUE_LEN & (CMD_QUEUE_LEN - 1U)) != 0
+#error "CMD_QUEUE_LEN must be a power of two"
+#endif
+
+#define CMD_CRC_LEN  4U
+#define CMD_REQ_MAX  (2U + CMD_PAYLOAD_MAX + CMD_CRC_LEN)
+#define CMD_RESP_MAX (3U + CMD_PAYLOAD_MAX + CMD_CRC_LEN)
+
+typedef enum {
+  RX_IDLE = 0,  // Between frames: bytes are text
+  RX_FRAME,     // After a 0x00
+  RX_SKIP       // In a frame already found bad, until its 0x00
+} rx_state_t;
+
+// The interrupt handler's alone
+static rx_state_t rx_state;
+static uint8_t rx_buf[CMD_REQ_MAX];
+static uint32_t rx_len;
+static uint8_t rx_left;     // Data bytes still to come in this COBS block
+static uint8_t rx_zero;     // The block stands for a 0x00 after it
+static uint8_t rx_started;  // A code byte has come since the 0x00
+
+static cmd_msg_t queue[CMD_QUEUE_LEN];
+static volatile uint32_t q_head, q_tail;
+
+static const cmd_entry_t *table;
+static uint32_t table_len;
+static cmd_stats_t stats;
+
+static inline uint32_t get_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+void cmd_init(const cmd_entry_t *t, uint32_t n) {
+  uart_port_t *p = uart_port(UART_USART3);
+  uart_set_rx_filter(p, NULL);
+  table = t;
+  table_len = n;
+  rx_state = RX_IDLE;
+  q_head = q_tail = 0;
+  memset(&stats, 0, sizeof(stats));
+  crc_init();
+  uart_set_rx_filter(p, cmd_rx_byte);
+}
+
+void cmd_stop(void) {
+  uart_set_rx_filter(uart_port(UART_USART3), NULL);
+}
+
+// A whole frame is in: queue it if it is a good request
+static void rx_end(void) {
+  if (rx_left || rx_len < 2U + CMD_CRC_LEN) {
+    stats.bad_frame++; // Cut short, or no room for the header and CRC
+    return;
+  }
+  uint32_t n = rx_len - CMD_CRC_LEN;
+  if (crc32(rx_buf, n) != get_le32(rx_buf + n)) {
+    stats.bad_crc++;
+    return;
+  }
+  uint32_t used = q_head - q_tail;
+  if (used == CMD_QUEUE_LEN) {
+    stats.dropped++;
+    return;
+  }
+
+  cmd_msg_t *m = &queue[q_head & (CMD_QUEUE_LEN - 1U)];
+  m->seq = rx_buf[0];
+  m->id = rx_buf[1];
+  m->len = (uint16_t)(n - 2U);
+  memcpy(m->payload, rx_buf + 2, n - 2U);
+  RING_BARRIER();
+  q_head++;
+  stats.requests++;
+  if (used + 1U > stats.peak_queued) stats.peak_queued = used + 1U;
+}
+
+// Too long for a request: skip to its end
+static inline int rx_put(uint8_t c) {
+  if (rx_len == sizeof(rx_buf)) {
+    stats.bad_frame++;
+    rx_state = RX_SKIP;
+    return 0;
+  }
+  rx_buf[rx_len++] = c;
+  return 1;
+}
+
+ITCM_CODE int cmd_rx_byte(uint8_t c) {
+  if (rx_state == RX_IDLE) {
+    if (c != 0) return 0; // Text
+    rx_state = RX_FRAME;
+    rx_len = rx_left = rx_zero = rx_started = 0;
+    return 1;
+  }
+  if (rx_state == RX_SKIP) {
+    if (c == 0) rx_state = RX_IDLE;
+    return 1;
+  }
+
+  if (c == 0) {
+    if (!rx_started) return 1; // Nothing yet: only another delimiter
+    rx_end();
+    rx_state = RX_IDLE;
+  } else if (rx_left == 0) {
+    // A code byte: first the zero the last block stood for, if any
+    if (rx_zero && !rx_put(0)) return 1;
+    rx_left = (uint8_t)(c - 1U);
+    rx_zero = c != 0xFFU;
+    rx_started = 1;
+  } else if (rx_put(c)) {
+    rx_left--;
+  }
+  return 1;
+}
+
+static cmd_status_t dispatch(const cmd_msg_t *m, uint8_t *resp, uint32_t *len) {
+  for (uint32_t i = 0; i < table_len; i++) {
+    const cmd_entry_t *e = &table[i];
+    if (e->id != m->id) continue;
+    if (m->len < e->min_len || m->len > e->max_len) return CMD_ERR_LENGTH;
+    cmd_status_t status = e->handler(m, resp, len);
+    if (*len > CMD_PAYLOAD_MAX) *len = CMD_PAYLOAD_MAX;
+    return status;
+  }
+  stats.unknown++;
+  return CMD_ERR_UNKNOWN;
+}
+
+static void respond(const cmd_msg_t *m) {
+  uint8_t raw[CMD_RESP_MAX];
+  uint8_t frame[COBS_MAX(CMD_RESP_MAX) + 2U];
+  uint32_t len = 0;
+
+  raw[2] = (uint8_t)dispatch(m, raw + 3, &len);
+  raw[0] = m->seq;
+  raw[1] = (uint8_t)(m->id | CMD_RESPONSE);
+  len += 3U;
+  put_le32(raw + len, crc32(raw, len));
+  len += CMD_CRC_LEN;
+
+  frame[0] = 0;
+  uint32_t n = cobs_encode(frame + 1, raw, len) + 1U;
+  frame[n++] = 0;
+  console_write(frame, (int)n);
+  stats.responses++;
+}
+
+uint32_t cmd_poll(void) {
+  uint32_t handled = 0;
+  while (q_tail != q_head) {
+    RING_BARRIER();
+    respond(&queue[q_tail & (CMD_QUEUE_LEN - 1U)]);
+    RING_BARRIER();
+    q_tail++; // Only now may the handler reuse the slot
+    handled++;
+  }
+  return handled;
+}
+
+uint32_t cmd_pending(void) {
+  return q_head - q_tail;
+}
+
+const cmd_stats_t *cmd_stats(void) {
+  return &stats;
+}
+
+cmd_status_t cmd_ping(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len) {
+  memcpy(resp, req->payload, req->len);
+  *resp_len = req->len;
+  return CMD_OK;
+}
+
+cmd_status_t cmd_get_stats(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len) {
+  const uint32_t *w = (const uint32_t *)&stats;
+  (void)req;
+  for (uint32_t i = 0; i < sizeof(stats) / sizeof(uint32_t); i++) put_le32(resp + 4U * i, w[i]);
+  *resp_len = sizeof(stats);
+  return CMD_OK;
+}
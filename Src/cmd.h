@@ -0,0 +1,113 @@
+/*
+ * cmd.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Framed binary commands over the console line (USART3).
+ *
+ * A request, before framing:
+ *   seq      1 byte, echoed in the response so the host can match them up
+ *   id       1 byte, the command (bit 7 clear)
+ *   payload  0 to CMD_PAYLOAD_MAX bytes
+ *   crc      CRC-32 of seq, id and payload (crc.h), 4 bytes little-endian
+ * A response is the same with id | 0x80 and a status byte (cmd_status_t)
+ * after it, then the handler's payload and the CRC.
+ *
+ * Each is COBS-encoded between two 0x00 bytes, as trace.h records are, so
+ * frames share the line with typed keys and console text both ways. The
+ * USART3 interrupt handler takes each byte as it arrives (uart.h's
+ * uart_rx_filter_t): a 0x00 starts a frame, the bytes up to the next are
+ * decoded on the fly, and at the end the CRC is checked and a good request
+ * queued. Bytes outside frames go to the receive ring as before, so
+ * uart_try_read() still sees keys. A second 0x00 in a row is taken as
+ * a new start, so an empty frame is only a delimiter.
+ *
+ * cmd_poll(), from the main loop, runs each queued request through the
+ * command table the application gave cmd_init() and sends the response.
+ * Bad frames (CRC, COBS or length) and requests that find the queue full
+ * get no response and are counted; the host resends them after a timeout.
+ * Sim/cmd-host.h is the host side.
+ */
+
+#ifndef CMD_H_
+#define CMD_H_
+
+#include <stdint.h>
+
+// Largest payload either way
+#ifndef CMD_PAYLOAD_MAX
+#define CMD_PAYLOAD_MAX 64U
+#endif
+
+// Requests waiting for cmd_poll(); must be a power of two
+#ifndef CMD_QUEUE_LEN
+#define CMD_QUEUE_LEN 4U
+#endif
+
+#define CMD_RESPONSE 0x80U  // In the id of a response
+
+typedef enum {
+  CMD_OK = 0,
+  CMD_ERR_UNKNOWN,  // No such command
+  CMD_ERR_LENGTH,   // Payload too short or too long for it
+  CMD_ERR_ARG,      // The handler did not like the payload
+  CMD_ERR_FAILED    // The handler could not do it
+} cmd_status_t;
+
+// A request as cmd_poll() hands it to a handler
+typedef struct {
+  uint8_t seq;
+  uint8_t id;
+  uint16_t len;
+  uint8_t payload[CMD_PAYLOAD_MAX];
+} cmd_msg_t;
+
+// Write up to CMD_PAYLOAD_MAX bytes of response at resp and set *resp_len
+// (0 on entry); return the status. Runs in thread mode.
+typedef cmd_status_t (*cmd_handler_t)(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len);
+
+// One command: requests with other payload lengths get CMD_ERR_LENGTH
+// without reaching the handler
+typedef struct {
+  uint8_t id;
+  uint8_t min_len;
+  uint8_t max_len;
+  const char *name;
+  cmd_handler_t handler;
+} cmd_entry_t;
+
+typedef struct {
+  uint32_t requests;   // Good requests queued
+  uint32_t responses;  // Sent
+  uint32_t bad_crc;    // Frames with the wrong CRC
+  uint32_t bad_frame;  // Broken COBS, too short or too long
+  uint32_t dropped;    // Good requests that found the queue full
+  uint32_t unknown;    // Requests for an id not in the table
+  uint32_t peak_queued;
+} cmd_stats_t;
+
+// Start taking frames off the console line; call after console_init().
+// The table is used in place and must stay put.
+void cmd_init(const cmd_entry_t *table, uint32_t n);
+
+// Stop: every received byte goes to the receive ring again
+void cmd_stop(void);
+
+// The USART3 receive filter: returns 1 if c was part of a frame
+int cmd_rx_byte(uint8_t c);
+
+// Handle every queued request and send the responses. Returns how many.
+uint32_t cmd_poll(void);
+
+// Requests waiting for cmd_poll()
+uint32_t cmd_pending(void);
+
+const cmd_stats_t *cmd_stats(void);
+
+// Handlers for the application's table. cmd_ping() sends the payload
+// back; cmd_get_stats() sends cmd_stats_t as little-endian words.
+cmd_status_t cmd_ping(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len);
+cmd_status_t cmd_get_stats(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len);
+
+#endif /* CMD_H_ */
@@ -0,0 +1,74 @@
+/*
+ * cobs.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Consistent Overhead Byte Stuffing: a frame with no 0x00 bytes in it,
+ * so 0x00 can delimit frames on a byte stream. Each code byte n is
+ * followed by n - 1 data bytes and stands for a 0x00 after them, except
+ * n = 0xFF (254 data bytes, no zero) and the last block of a frame.
+ * Used by trace.c and cmd.c.
+ */
+
+#ifndef COBS_H_
+#define COBS_H_
+
+#include <stdint.h>
+
+// Encoded size of len bytes at most: a code byte per 254
+#define COBS_MAX(LEN) ((LEN) + (LEN) / 254U + 1U)
+
+// An encoding in progress, for a frame that is not all at hand at once:
+// cobs_begin(), cobs_put() as often as needed, then cobs_end()
+typedef struct {
+  uint8_t *out;      // Next data byte
+  uint8_t *code_at;  // Code byte of the open block
+  uint8_t code;
+} cobs_enc_t;
+
+static inline void cobs_begin(cobs_enc_t *e, uint8_t *dst) {
+  e->code_at = dst;
+  e->out = dst + 1;
+  e->code = 1;
+}
+
+static inline void cobs_put(cobs_enc_t *e, const uint8_t *src, uint32_t len) {
+  uint8_t *out = e->out;
+  uint8_t *code_at = e->code_at;
+  uint8_t code = e->code;
+
+  for (uint32_t i = 0; i < len; i++) {
+    if (src[i] == 0) {
+      *code_at = code;
+      code_at = out++;
+      code = 1;
+    } else {
+      *out++ = src[i];
+      if (++code == 0xFFU) {
+        *code_at = code;
+        code_at = out++;
+        code = 1;
+      }
+    }
+  }
+  e->out = out;
+  e->code_at = code_at;
+  e->code = code;
+}
+
+// Close the last block; returns the encoded length from dst
+static inline uint32_t cobs_end(cobs_enc_t *e, const uint8_t *dst) {
+  *e->code_at = e->code;
+  return (uint32_t)(e->out - dst);
+}
+
+// Returns the encoded length
+static inline uint32_t cobs_encode(uint8_t *dst, const uint8_t *src, uint32_t len) {
+  cobs_enc_t e;
+  cobs_begin(&e, dst);
+  cobs_put(&e, src, len);
+  return cobs_end(&e, dst);
+}
+
+#endif /* COBS_H_ */
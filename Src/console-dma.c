@@ -0,0 +1,221 @@
+/*
+ * console-dma.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * DMA-driven, double-buffered USART3 console output.
+ * Built in only when CONSOLE_TX_DMA is defined; console_write() then
+ * hands whole buffers to this file instead of the byte-at-a-time ring.
+ *
+ * Two buffers ping-pong: one is being filled by _write() while the other
+ * is in flight on DMA1. The transfer-complete interrupt launches the
+ * filled buffer (if any) and hands the now-free one back for filling.
+ * A multi-KB dump costs a few memcpy()s plus one DMA setup per buffer.
+ *
+ * USART3_TX is DMA1 Stream 3 Channel 4: RM0410 Rev 5 Sec 8.3.4 Table 27 p 228
+ * DMA stream registers: RM0410 Rev 5 Sec 8.5 p 247
+ * USART DMA transmission: RM0410 Rev 5 Sec 34.5.15 p 1260
+ */
+
+#ifdef CONSOLE_TX_DMA
+
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "nucleo-clk.h"
+#include "console.h"
+#include "critical.h"
+#include "cycles.h"
+#include "sections.h"
+
+#define CONSOLE_USART     USART3
+#define CONSOLE_DMA       DMA1
+#define CONSOLE_DMA_TX    DMA1_Stream3
+#define CONSOLE_DMA_CHAN  4UL
+
+// All the stream 3 flags live in LISR/LIFCR bits 22-27
+#define DMA_S3_FLAGS (DMA_LIFCR_CTCIF3 | DMA_LIFCR_CHTIF3 | DMA_LIFCR_CTEIF3 | \
+                      DMA_LIFCR_CDMEIF3 | DMA_LIFCR_CFEIF3)
+
+// Longest copy done with interrupts masked; bounds our added IRQ latency
+#define DMA_COPY_CHUNK 64U
+
+// In DTCM: never cached, so the DMA always reads what the CPU wrote
+DTCM_BSS static uint8_t dma_buf[2][CONSOLE_DMA_BUF_SIZE];
+static volatile uint32_t fill_len;  // Bytes waiting in dma_buf[fill]
+static volatile uint8_t fill;       // Index of the buffer being filled
+static volatile uint8_t in_flight;  // DMA is running on dma_buf[fill ^ 1]
+
+static console_dma_stats_t dma_stats;
+static uint32_t stats_start;
+
+
+// Start sending the fill buffer and switch filling to the other one.
+// Caller must have interrupts masked (or be the DMA ISR).
+static void dma_launch(void) {
+  uint8_t *buf = dma_buf[fill];
+
+  CONSOLE_DMA->LIFCR = DMA_S3_FLAGS;
+  CONSOLE_USART->ICR = USART_ICR_TCCF;
+  CONSOLE_DMA_TX->M0AR = (uint32_t)(uintptr_t)buf;
+  CONSOLE_DMA_TX->NDTR = fill_len;
+  CONSOLE_DMA_TX->CR |= DMA_SxCR_EN;
+
+  dma_stats.transfers++;
+  dma_stats.bytes += fill_len;
+  in_flight = 1;
+  fill ^= 1U;
+  fill_len = 0;
+}
+
+void console_dma_init(void) {
+  SET_BIT(RCC->AHB1ENR, DMA1_CLK_EN);
+
+  // Stream must be disabled before it can be configured
+  CLEAR_BIT(CONSOLE_DMA_TX->CR, DMA_SxCR_EN);
+  while (CONSOLE_DMA_TX->CR & DMA_SxCR_EN);
+
+  CONSOLE_DMA->LIFCR = DMA_S3_FLAGS;
+  CONSOLE_DMA_TX->PAR = (uint32_t)(uintptr_t)&CONSOLE_USART->TDR;
+  CONSOLE_DMA_TX->FCR = 0; // Direct mode, no FIFO
+  // Channel 4, byte to byte, memory increment, memory-to-peripheral,
+  // interrupts on complete and error
+  CONSOLE_DMA_TX->CR = (CONSOLE_DMA_CHAN << DMA_SxCR_CHSEL_Pos) |
+                       DMA_SxCR_MINC | DMA_SxCR_DIR_0 |
+                       DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+
+  fill = 0;
+  fill_len = 0;
+  in_flight = 0;
+
+  // Let the USART raise DMA requests on TXE
+  SET_BIT(CONSOLE_USART->CR3, USART_CR3_DMAT);
+
+  // Leave the counter alone if boot or a probe is already timing with it
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) cycles_init();
+  console_dma_reset_stats();
+
+  NVIC_EnableIRQ(CONSOLE_DMA_IRQn);
+}
+
+int console_dma_write(const uint8_t *buf, int len, console_tx_policy_t policy) {
+  if (len <= 0) return len;
+
+  uint32_t t0 = cycles_now();
+  uint32_t waited = 0, full_waits = 0;
+  uint32_t left = (uint32_t)len;
+
+  while (left) {
+    uint32_t s = critical_enter();
+    uint32_t space = CONSOLE_DMA_BUF_SIZE - fill_len;
+
+    if (space == 0) {
+      if (!in_flight) {
+        dma_launch();
+        critical_exit(s);
+        continue;
+      }
+      if (policy == CONSOLE_TX_DROP_NEWEST) {
+        critical_exit(s);
+        break; // The rest is counted dropped below
+      }
+      if (policy == CONSOLE_TX_OVERWRITE_OLDEST) {
+        // The oldest bytes we still own are the unsent fill buffer
+        dma_stats.dropped += fill_len;
+        fill_len = 0;
+        critical_exit(s);
+        continue;
+      }
+      critical_exit(s);
+
+      // CONSOLE_TX_BLOCK: wait for the in-flight buffer to finish. The
+      // wait is the line's time, not work: keep it out of cpu_cycles
+      // (console_dma_irq() counts its own, whichever way it runs)
+      critical_irq_t how = critical_irq_progress(CONSOLE_DMA_IRQn);
+      if (how == CRITICAL_IRQ_PREEMPTED) {
+        // Its handler is beneath us: no buffer comes free until we return
+        break;
+      }
+      full_waits++;
+      uint32_t w0 = cycles_now();
+      if (how == CRITICAL_IRQ_POLL) {
+        while (in_flight) console_dma_poll();
+      } else {
+        while (in_flight) __NOP(); // The TC interrupt frees a buffer
+      }
+      waited += cycles_now() - w0;
+      continue;
+    }
+
+    uint32_t n = left < space ? left : space;
+    if (n > DMA_COPY_CHUNK) n = DMA_COPY_CHUNK;
+    memcpy(&dma_buf[fill][fill_len], buf, n);
+    fill_len += n;
+    if (!in_flight) dma_launch();
+    critical_exit(s);
+
+    buf += n;
+    left -= n;
+  }
+
+  // Handlers write here too, and console_dma_irq() adds its own cycles
+  uint32_t s = critical_enter();
+  dma_stats.dropped += left;
+  dma_stats.full_waits += full_waits;
+  dma_stats.cpu_cycles += cycles_now() - t0 - waited;
+  dma_stats.wait_cycles += waited;
+  critical_exit(s);
+  return len - (int)left;
+}
+
+uint32_t console_dma_free(void) {
+  return CONSOLE_DMA_BUF_SIZE - fill_len;
+}
+
+int console_dma_busy(void) {
+  return in_flight || fill_len != 0 || !(CONSOLE_USART->ISR & USART_ISR_TC);
+}
+
+ITCM_CODE void console_dma_irq(void) {
+  uint32_t t0 = cycles_now();
+  uint32_t isr = CONSOLE_DMA->LISR;
+
+  CONSOLE_DMA->LIFCR = DMA_S3_FLAGS;
+  if (isr & DMA_LISR_TEIF3) dma_stats.errors++;
+
+  if (isr & (DMA_LISR_TCIF3 | DMA_LISR_TEIF3)) {
+    in_flight = 0;
+    if (fill_len) dma_launch();
+  }
+
+  dma_stats.cpu_cycles += cycles_now() - t0;
+}
+
+// Run the ISR body if its flags are up; for when it cannot run, and is
+// not running beneath us (CRITICAL_IRQ_POLL)
+void console_dma_poll(void) {
+  if (CONSOLE_DMA->LISR & (DMA_LISR_TCIF3 | DMA_LISR_TEIF3)) console_dma_irq();
+}
+
+ITCM_CODE void DMA1_Stream3_IRQHandler(void) {
+  console_dma_irq();
+}
+
+void console_dma_reset_stats(void) {
+  uint32_t s = critical_enter();
+  memset(&dma_stats, 0, sizeof(dma_stats));
+  stats_start = cycles_now();
+  critical_exit(s);
+}
+
+const console_dma_stats_t *console_dma_stats(void) {
+  dma_stats.elapsed_cycles = cycles_now() - stats_start;
+  return &dma_stats;
+}
+
+#endif // CONSOLE_TX_DMA
@@ -0,0 +1,279 @@
+/*
+ * console.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Interrupt-driven, ring-buffered USART3 console output.
+ * See console.h for an overview.
+ *
+ * The rings, the ISR and the statistics are the USART3 port of the
+ * U(S)ART driver (uart.c); this file gives it the console's buffers, the
+ * DMA output option, formatted output and the newlib hooks.
+ *
+ * Only one writer may fill the transmit ring at a time. Thread-mode
+ * writers mark themselves busy; console_printf_isr() output that arrives
+ * meanwhile goes to a side ring, and the writer moves it over when it is
+ * done.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "console.h"
+#include "critical.h"
+#include "fmt.h"
+#include "ring.h"
+#include "sections.h"
+#include "uart.h"
+
+#if (CONSOLE_TX_BUF_SIZE & (CONSOLE_TX_BUF_SIZE - 1U)) != 0
+#error "CONSOLE_TX_BUF_SIZE must be a power of two"
+#endif
+#if (CONSOLE_RX_BUF_SIZE & (CONSOLE_RX_BUF_SIZE - 1U)) != 0
+#error "CONSOLE_RX_BUF_SIZE must be a power of two"
+#endif
+#if (CONSOLE_ISR_BUF_SIZE & (CONSOLE_ISR_BUF_SIZE - 1U)) != 0
+#error "CONSOLE_ISR_BUF_SIZE must be a power of two"
+#endif
+
+#define CONSOLE_PORT uart_port(UART_USART3)
+
+DTCM_BSS static uint8_t tx_buf[CONSOLE_TX_BUF_SIZE];
+DTCM_BSS static uint8_t rx_buf[CONSOLE_RX_BUF_SIZE];
+DTCM_BSS static uint8_t isr_buf[CONSOLE_ISR_BUF_SIZE];
+
+static ring_t isr_ring = RING_INIT(isr_buf, CONSOLE_ISR_BUF_SIZE);
+static volatile int writer_busy;  // A thread-mode write is filling the ring
+static volatile uint32_t isr_dropped;
+
+
+void console_init(void) {
+  uart_set_tx_policy(CONSOLE_PORT, CONSOLE_TX_POLICY);
+  uart_start(CONSOLE_PORT, tx_buf, CONSOLE_TX_BUF_SIZE, rx_buf, CONSOLE_RX_BUF_SIZE);
+
+#ifdef CONSOLE_TX_DMA
+  console_dma_init();
+#endif
+}
+
+void console_set_tx_policy(console_tx_policy_t policy) {
+  uart_set_tx_policy(CONSOLE_PORT, policy);
+}
+
+console_tx_policy_t console_get_tx_policy(void) {
+  return uart_get_tx_policy(CONSOLE_PORT);
+}
+
+const console_tx_stats_t *console_tx_stats(void) {
+  return uart_tx_stats(CONSOLE_PORT);
+}
+
+int console_tx_busy(void) {
+#ifdef CONSOLE_TX_DMA
+  if (console_dma_busy()) return 1;
+#endif
+  return uart_tx_busy(CONSOLE_PORT);
+}
+
+// Queue without waiting; returns the number of bytes that did not fit
+static uint32_t write_nowait(const uint8_t *buf, uint32_t len) {
+#ifdef CONSOLE_TX_DMA
+  return len - (uint32_t)console_dma_write(buf, (int)len, CONSOLE_TX_DROP_NEWEST);
+#else
+  return len - uart_send_nowait(CONSOLE_PORT, buf, len);
+#endif
+}
+
+// Returns the previous state for writer_exit()
+static int writer_enter(void) {
+  int was = writer_busy;
+  writer_busy = 1;
+  RING_BARRIER();
+  return was;
+}
+
+// Pass on whatever console_printf_isr() held back meanwhile
+static void writer_exit(int was) {
+  if (was) return;
+  uint32_t s = critical_enter();
+  uint8_t chunk[32];
+  uint32_t n;
+  while ((n = ring_read(&isr_ring, chunk, sizeof(chunk))) > 0) {
+    isr_dropped += write_nowait(chunk, n);
+  }
+  writer_busy = 0;
+  critical_exit(s);
+}
+
+static int write_locked(const uint8_t *buf, int len) {
+#ifdef CONSOLE_TX_DMA
+  if (len > 0) console_dma_write(buf, len, console_get_tx_policy());
+  return len;
+#endif
+  return uart_send(CONSOLE_PORT, buf, len);
+}
+
+int console_write(const uint8_t *buf, int len) {
+  int was = writer_enter();
+  int n = write_locked(buf, len);
+  writer_exit(was);
+  return n;
+}
+
+int console_putc(int ch) {
+  uint8_t c = (uint8_t)ch;
+  console_write(&c, 1);
+  return ch;
+}
+
+void console_flush(void) {
+#ifdef CONSOLE_TX_DMA
+  // Preempting the DMA handler, nothing can finish until we return
+  critical_irq_t how = critical_irq_progress(CONSOLE_DMA_IRQn);
+  while (how != CRITICAL_IRQ_PREEMPTED && console_dma_busy()) {
+    if (how == CRITICAL_IRQ_POLL) {
+      console_dma_poll(); // No interrupts will come, so do their work ourselves
+    } else {
+      __NOP(); // The TC interrupt finishes it
+    }
+  }
+#endif
+  uart_flush(CONSOLE_PORT);
+}
+
+#ifdef CONSOLE_TX_DMA
+// Each chunk goes to the DMA buffers as it fills
+static void printf_next(fmt_out_t *o) {
+  write_locked((const uint8_t *)o->start, (int)(o->p - o->start));
+  o->p = o->start;
+}
+#else
+// Each chunk is formatted in place in the transmit ring and queued as it
+// fills, so the ISR can start sending while the rest is being formatted
+static void printf_next(fmt_out_t *o) {
+  uint32_t len;
+  uart_tx_commit(CONSOLE_PORT, (uint32_t)(o->p - o->start), 0);
+  o->start = o->p = (char *)uart_tx_reserve(CONSOLE_PORT, CONSOLE_FMT_CHUNK, &len);
+  o->end = o->p + len;
+}
+#endif
+
+int console_vprintf(const char *fmt, va_list ap) {
+  int was = writer_enter();
+#ifdef CONSOLE_TX_DMA
+  char chunk[CONSOLE_FMT_CHUNK];
+  fmt_out_t o = { chunk, chunk + sizeof(chunk), chunk, printf_next, NULL, 0, 0 };
+  int n = fmt_vout(&o, fmt, ap);
+  write_locked((const uint8_t *)o.start, (int)(o.p - o.start));
+#else
+  // The first byte asks printf_next() for the first chunk
+  fmt_out_t o = { NULL, NULL, NULL, printf_next, NULL, 0, 0 };
+  int n = fmt_vout(&o, fmt, ap);
+  uart_tx_commit(CONSOLE_PORT, (uint32_t)(o.p - o.start), o.dropped);
+#endif
+  writer_exit(was);
+  return n;
+}
+
+int console_printf(const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = console_vprintf(fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+int console_printf_isr(const char *fmt, ...) {
+  char line[CONSOLE_ISR_LINE_MAX];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = fmt_vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  if (n <= 0) return n;
+
+  uint32_t len = (uint32_t)n < sizeof(line) ? (uint32_t)n : sizeof(line) - 1U;
+  uint32_t s = critical_enter();
+  isr_dropped += (uint32_t)n - len;
+  console_write_isr((const uint8_t *)line, len, 0);
+  critical_exit(s);
+  return n;
+}
+
+uint32_t console_write_isr(const uint8_t *buf, uint32_t len, int whole) {
+  uint32_t n = 0;
+  uint32_t s = critical_enter();
+  if (writer_busy) {
+    if (!whole || ring_free(&isr_ring) >= len) n = ring_write(&isr_ring, buf, len);
+  } else {
+#ifdef CONSOLE_TX_DMA
+    if (!whole || console_dma_free() >= len)
+#else
+    if (!whole || uart_tx_free(CONSOLE_PORT) >= len)
+#endif
+    n = len - write_nowait(buf, len);
+  }
+  isr_dropped += len - n;
+  critical_exit(s);
+  return n;
+}
+
+uint32_t console_isr_dropped(void) {
+  return isr_dropped;
+}
+
+void console_irq(void) {
+  uart_irq(CONSOLE_PORT);
+}
+
+
+int uart_try_read(uint8_t *c) {
+  return uart_recv(CONSOLE_PORT, c, 1);
+}
+
+int uart_read_n(uint8_t *buf, int len) {
+  return uart_recv(CONSOLE_PORT, buf, len);
+}
+
+int console_rx_available(void) {
+  return uart_rx_available(CONSOLE_PORT);
+}
+
+const console_rx_stats_t *console_rx_stats(void) {
+  return uart_rx_stats(CONSOLE_PORT);
+}
+
+
+// newlib hooks: everything printf() produces comes through one of these,
+// and scanf()/getchar() read through _read()/__io_getchar().
+// These override the weak versions in syscalls.c.
+
+int __io_putchar(int ch) {
+  return console_putc(ch);
+}
+
+int _write(int file, char *ptr, int len) {
+  (void)file;
+  return console_write((const uint8_t *)ptr, len);
+}
+
+// Blocks until a byte arrives
+int __io_getchar(void) {
+  uint8_t c;
+  while (!uart_try_read(&c));
+  return c;
+}
+
+// Blocks only until at least one byte is available, then returns
+// as many as are buffered (up to len)
+int _read(int file, char *ptr, int len) {
+  (void)file;
+  if (len <= 0) return 0;
+
+  ptr[0] = (char)__io_getchar();
+  return 1 + uart_read_n((uint8_t *)ptr + 1, len - 1);
+}
@@ -0,0 +1,170 @@
+/*
+ * console.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Interrupt-driven, ring-buffered USART3 console output.
+ *
+ * printf() and friends end up in _write() / __io_putchar(), which now only
+ * copy into a ring buffer. The USART3 TXE interrupt drains the ring one
+ * byte per interrupt and the TC interrupt tells us when the line has
+ * gone idle. The main loop no longer waits ~87us per character at 115200.
+ *
+ * Input is the mirror image: the RXNE interrupt moves each received byte
+ * into a ring, so nothing is lost to overrun while the main loop is busy.
+ * uart_try_read()/uart_read_n() never wait; __io_getchar()/_read() do.
+ *
+ * Define CONSOLE_TX_DMA to send through DMA1 with two ping-pong buffers
+ * instead (console-dma.c); better for bulk output.
+ *
+ * console_printf() formats with fmt.c straight into the transmit ring,
+ * a chunk of free space at a time: no heap, no line buffer, and no
+ * newlib printf() linked in. console_printf_isr() is the version for
+ * interrupt handlers.
+ */
+
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "fmt.h"
+#include "uart.h"
+
+// Transmit ring size in bytes; must be a power of two
+#ifndef CONSOLE_TX_BUF_SIZE
+#define CONSOLE_TX_BUF_SIZE 1024U
+#endif
+
+// Receive ring size in bytes; must be a power of two
+#ifndef CONSOLE_RX_BUF_SIZE
+#define CONSOLE_RX_BUF_SIZE 256U
+#endif
+
+// console_printf() hands the formatted text to the ISR this often
+#ifndef CONSOLE_FMT_CHUNK
+#define CONSOLE_FMT_CHUNK 64U
+#endif
+
+// Longest console_printf_isr() output; the rest is cut off. On the stack.
+#ifndef CONSOLE_ISR_LINE_MAX
+#define CONSOLE_ISR_LINE_MAX 128U
+#endif
+
+// Holds console_printf_isr() output that arrives while a thread-mode
+// write is under way; must be a power of two
+#ifndef CONSOLE_ISR_BUF_SIZE
+#define CONSOLE_ISR_BUF_SIZE 256U
+#endif
+
+// The console is the USART3 port of uart.c: same policies and statistics
+typedef uart_tx_policy_t console_tx_policy_t;
+#define CONSOLE_TX_BLOCK            UART_TX_BLOCK
+#define CONSOLE_TX_DROP_NEWEST      UART_TX_DROP_NEWEST
+#define CONSOLE_TX_OVERWRITE_OLDEST UART_TX_OVERWRITE_OLDEST
+
+// Policy set by console_init(); can be changed with console_set_tx_policy()
+#ifndef CONSOLE_TX_POLICY
+#define CONSOLE_TX_POLICY CONSOLE_TX_BLOCK
+#endif
+
+typedef uart_tx_stats_t console_tx_stats_t;
+typedef uart_rx_stats_t console_rx_stats_t;
+
+// Call after uart3_rxtx_init(): resets the rings, sets CONSOLE_TX_POLICY
+// and enables the USART3 IRQ
+void console_init(void);
+
+void console_set_tx_policy(console_tx_policy_t policy);
+console_tx_policy_t console_get_tx_policy(void);
+
+// Queue bytes for transmission according to the current policy.
+// Returns the number of bytes consumed from buf (always len unless len < 0).
+int console_write(const uint8_t *buf, int len);
+int console_putc(int ch);
+
+// printf() to the console through fmt.c (see fmt.h for the conversions).
+// Follows the TX policy like console_write(). Not for interrupt handlers.
+// Returns the number of bytes produced, including any dropped.
+int console_printf(const char *fmt, ...) FMT_CHECK(1, 2);
+int console_vprintf(const char *fmt, va_list ap);
+
+// For interrupt handlers (and anything else that must never wait):
+// formats on the stack, at most CONSOLE_ISR_LINE_MAX - 1 bytes, and queues
+// what fits without waiting. If it interrupted a thread-mode write, the
+// text is held back until that write is done so the two never interleave.
+int console_printf_isr(const char *fmt, ...) FMT_CHECK(1, 2);
+
+// Queue bytes from any context without waiting, held back like
+// console_printf_isr() output if a thread-mode write is under way. With
+// whole set, all of buf goes or none of it does. Returns the number of
+// bytes queued.
+uint32_t console_write_isr(const uint8_t *buf, uint32_t len, int whole);
+
+// Bytes console_printf_isr() and console_write_isr() cut off or found no room for
+uint32_t console_isr_dropped(void);
+
+// Wait until everything queued has left the shift register
+void console_flush(void);
+
+// Nonzero while bytes are queued or still shifting out
+int console_tx_busy(void);
+
+const console_tx_stats_t *console_tx_stats(void);
+
+// Non-blocking input. uart_try_read() returns 1 and stores a byte if one
+// was buffered, else 0. uart_read_n() returns how many bytes it copied.
+int uart_try_read(uint8_t *c);
+int uart_read_n(uint8_t *buf, int len);
+int console_rx_available(void);
+
+const console_rx_stats_t *console_rx_stats(void);
+
+// The USART3 interrupt handler body; exposed so it can be called directly
+void console_irq(void);
+
+
+// DMA output path (console-dma.c), built when CONSOLE_TX_DMA is defined.
+// console_init() sets it up and console_write() then sends through it.
+
+// DMA1 Stream 3 (channel 4 is USART3_TX)
+#define CONSOLE_DMA_IRQn DMA1_Stream3_IRQn
+
+// Size of each of the two ping-pong buffers; DMA NDTR allows up to 65535
+#ifndef CONSOLE_DMA_BUF_SIZE
+#define CONSOLE_DMA_BUF_SIZE 512U
+#endif
+
+// CPU occupancy = cpu_cycles / elapsed_cycles
+// Throughput    = bytes * core clock / elapsed_cycles
+// At the line rate, throughput approaches baud / 10 (8N1).
+typedef struct {
+  uint32_t bytes;           // Bytes handed to the DMA
+  uint32_t transfers;       // DMA transfers started
+  uint32_t dropped;         // Bytes discarded by the non-blocking policies, or
+                            // by BLOCK in a handler that preempted the DMA's
+  uint32_t full_waits;      // Times the writer waited for a free buffer
+  uint32_t errors;          // DMA transfer errors
+  uint32_t cpu_cycles;      // Cycles spent in console_dma_write() and the ISR,
+                            // not counting wait_cycles
+  uint32_t wait_cycles;     // Cycles console_dma_write() spent waiting for a
+                            // free buffer (CONSOLE_TX_BLOCK)
+  uint32_t elapsed_cycles;  // Cycles since console_dma_reset_stats()
+} console_dma_stats_t;
+
+void console_dma_init(void);
+// Returns the number of bytes queued: less than len only where the policy
+// dropped the newest bytes, or BLOCK could not wait
+int console_dma_write(const uint8_t *buf, int len, console_tx_policy_t policy);
+// Room in the fill buffer: that much is taken without waiting or dropping,
+// for as long as interrupts stay masked
+uint32_t console_dma_free(void);
+int console_dma_busy(void);
+void console_dma_irq(void);
+void console_dma_poll(void);
+void console_dma_reset_stats(void);
+const console_dma_stats_t *console_dma_stats(void);
+
+#endif /* CONSOLE_H_ */
@@ -0,0 +1,77 @@
+/*
+ * crc.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See crc.h.
+ *
+ * Registers: RM0410 Rev 5 Sec 14.4. POLYSIZE 00 is a 32-bit polynomial;
+ * REV_IN 11 bit-reverses each word written, so a little-endian word of
+ * four bytes goes in as those bytes would one at a time, each reflected;
+ * REV_OUT bit-reverses what DR reads back, which is then the state of the
+ * reflected software CRC below.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "crc.h"
+#include "critical.h"
+
+#define CRC32_POLY      0x04C11DB7UL
+#define CRC32_POLY_REFL 0xEDB88320UL  // The same, bit-reversed
+
+static inline uint32_t crc_byte(uint32_t crc, uint8_t b) {
+  crc ^= b;
+  for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (CRC32_POLY_REFL & (0U - (crc & 1U)));
+  return crc;
+}
+
+void crc_init(void) {
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_CRCEN);
+  (void)RCC->AHB1ENR; // Wait for the clock to reach the unit
+  CRC->INIT = 0xFFFFFFFFUL;
+  CRC->POL = CRC32_POLY;
+  CRC->CR = CRC_CR_REV_IN | CRC_CR_REV_OUT;
+}
+
+uint32_t crc32_continue(uint32_t crc, const void *buf, uint32_t len) {
+  const uint8_t *p = (const uint8_t *)buf;
+  crc = ~crc;
+
+  while (len >= 4U) {
+    uint32_t n = len < CRC_CHUNK ? len & ~3U : CRC_CHUNK;
+    const uint8_t *end = p + n;
+    uint32_t s = critical_enter();
+    // INIT is the unit's own register, not reflected as DR reads back
+    CRC->INIT = __RBIT(crc);
+    CRC->CR = CRC_CR_REV_IN | CRC_CR_REV_OUT | CRC_CR_RESET; // DR = INIT
+    for (; p < end; p += 4) {
+      uint32_t w;
+      memcpy(&w, p, sizeof(w));
+      CRC->DR = w;
+    }
+    crc = CRC->DR;
+    critical_exit(s);
+    len -= n;
+  }
+
+  while (len--) crc = crc_byte(crc, *p++);
+  return ~crc;
+}
+
+uint32_t crc32(const void *buf, uint32_t len) {
+  return crc32_continue(0, buf, len);
+}
+
+uint32_t crc32_sw(const void *buf, uint32_t len) {
+  const uint8_t *p = (const uint8_t *)buf;
+  uint32_t crc = 0xFFFFFFFFUL;
+  while (len--) crc = crc_byte(crc, *p++);
+  return ~crc;
+}
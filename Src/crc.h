@@ -0,0 +1,49 @@
+/*
+ * crc.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * CRC-32 on the STM32 CRC calculation unit (RM0410 Rev 5 Sec 14).
+ *
+ * The checksum is the usual CRC-32 of Ethernet, zip and zlib's crc32():
+ * polynomial 0x04C11DB7, bits reflected in and out, starting from and
+ * finally inverted with 0xFFFFFFFF. "123456789" gives 0xCBF43926.
+ *
+ * The unit takes one 32-bit word per write, reflected by its REV_IN
+ * setting, and holds off the next bus access until it is done (4 AHB
+ * cycles, Sec 14.3.1): about a cycle per byte, against some fifty for
+ * the bitwise loop. The last one to three bytes are done in software
+ * from the unit's result, since the device header has no byte-wide DR.
+ *
+ * There is only one unit: crc32() masks interrupts while it uses it, so
+ * it may be called from handlers and thread mode alike. It does so
+ * CRC_CHUNK bytes at a time, loading the unit from the running CRC for
+ * each, so a long buffer (a whole firmware image) does not hold
+ * interrupts off for longer than one chunk.
+ */
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <stdint.h>
+
+// Clock the unit and set it up for CRC-32
+void crc_init(void);
+
+// Most bytes done with interrupts masked; a multiple of 4
+#ifndef CRC_CHUNK
+#define CRC_CHUNK 1024U
+#endif
+
+// CRC-32 of len bytes at buf, with the CRC unit
+uint32_t crc32(const void *buf, uint32_t len);
+
+// The same, carried on from crc, the CRC-32 of the bytes before (0 for
+// none): crc32_continue(crc32(a, n), b, m) is the CRC-32 of a then b
+uint32_t crc32_continue(uint32_t crc, const void *buf, uint32_t len);
+
+// The same, a bit at a time in software, for comparison
+uint32_t crc32_sw(const void *buf, uint32_t len);
+
+#endif /* CRC_H_ */
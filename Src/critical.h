@@ -0,0 +1,58 @@
+/*
+ * critical.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Short interrupt-masked critical sections that nest correctly:
+ * the previous PRIMASK is saved and restored rather than blindly
+ * re-enabling interrupts on exit.
+ */
+
+#ifndef CRITICAL_H_
+#define CRITICAL_H_
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+// Mask all configurable interrupts; returns the state to hand to critical_exit()
+static inline uint32_t critical_enter(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  return primask;
+}
+
+// Restore the interrupt mask saved by critical_enter()
+static inline void critical_exit(uint32_t primask) {
+  __set_PRIMASK(primask);
+}
+
+// True if we cannot rely on an interrupt handler running to make progress:
+// either we are in a handler ourselves (IPSR != 0) or interrupts are masked.
+static inline int critical_irqs_blocked(void) {
+  return (__get_IPSR() != 0U) || (__get_PRIMASK() != 0U);
+}
+
+// How code that needs irqn's handler to make progress (a full transmit
+// ring, say) can get it.
+typedef enum {
+  CRITICAL_IRQ_WAIT,      // The handler can preempt us: wait for it
+  CRITICAL_IRQ_POLL,      // It cannot run, and is not running: call its body
+  CRITICAL_IRQ_PREEMPTED  // We preempted it (or are it): neither, give up
+} critical_irq_t;
+
+// Calling a handler's body is only safe where the handler itself cannot
+// be part way through beneath us: in thread mode with PRIMASK set, or in
+// a handler that irqn cannot preempt and did not get preempted by.
+static inline critical_irq_t critical_irq_progress(IRQn_Type irqn) {
+  uint32_t ipsr = __get_IPSR();
+  if (ipsr == 0U) return __get_PRIMASK() ? CRITICAL_IRQ_POLL : CRITICAL_IRQ_WAIT;
+  if (NVIC_GetActive(irqn)) return CRITICAL_IRQ_PREEMPTED;
+  // NMI and HardFault outrank every IRQ
+  if (__get_PRIMASK() || ipsr < 4U) return CRITICAL_IRQ_POLL;
+  return NVIC_GetPriority(irqn) < NVIC_GetPriority((IRQn_Type)((int32_t)ipsr - 16))
+         ? CRITICAL_IRQ_WAIT : CRITICAL_IRQ_POLL;
+}
+
+#endif /* CRITICAL_H_ */
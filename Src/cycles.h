@@ -0,0 +1,31 @@
+/*
+ * cycles.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Core clock cycle counter: DWT->CYCCNT.
+ * Arm v7-M ARM Sec C1.8; Cortex-M7 TRM Sec 3.2 (the M7 DWT needs unlocking via LAR).
+ * The counter wraps every 2^32 cycles (~20s at 216MHz), so only ever
+ * subtract two readings - never compare them.
+ */
+
+#ifndef CYCLES_H_
+#define CYCLES_H_
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+static inline void cycles_init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = 0xC5ACCE55UL; // CoreSight unlock key
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t cycles_now(void) {
+  return DWT->CYCCNT;
+}
+
+#endif /* CYCLES_H_ */
@@ -0,0 +1,189 @@
+/*
+ * dsp-bench.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See dsp-bench.h.
+ *
+ * Each case runs one block from rest through the reference and then the
+ * kernel, with interrupts masked and the signals in DTCM, where a real
+ * signal path would keep them. The Q15 outputs must match exactly; the
+ * floating-point ones to within rounding of the double reference.
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "console.h"
+#include "critical.h"
+#include "cycles.h"
+#include "dsp.h"
+#include "dsp-bench.h"
+#include "sections.h"
+
+#define BLOCK        256U
+#define FIR_TAPS     32U
+#define IIR_SECTIONS 4U
+#define AVG_LEN      16U
+
+typedef enum {
+  CASE_FIR, CASE_IIR_F32, CASE_IIR_F64, CASE_AVG, CASE_TO_F32, CASE_TO_Q15, CASE_ADD, CASE_MAX,
+  NUM_CASES
+} bench_case_t;
+
+static const char *const names[NUM_CASES] = {
+  "FIR q15, 32 taps", "biquad f32, 4 sections", "biquad f64, 4 sections",
+  "moving average q15, 16", "q15 -> f32", "f32 -> q15", "add q15 (QADD16)", "max q15 (SEL)",
+};
+
+// [0] from the reference, [1] from the kernel
+DTCM_BSS static int16_t x_q15[BLOCK], x2_q15[BLOCK], y_q15[2][BLOCK];
+DTCM_BSS static float x_f32[BLOCK], y_f32[2][BLOCK];
+DTCM_BSS static double x_f64[BLOCK], y_f64[2][BLOCK];
+DTCM_BSS static int16_t fir_state[FIR_TAPS - 1U + BLOCK];
+DTCM_BSS static int16_t avg_state[AVG_LEN + BLOCK];
+static float iir_state_f32[2U * IIR_SECTIONS];
+static double iir_state_f64[2U * IIR_SECTIONS];
+static int16_t max_out[2];
+
+static int16_t taps[FIR_TAPS];
+static float iir_f32[5U * IIR_SECTIONS];
+static double iir_f64[5U * IIR_SECTIONS];
+
+static dsp_fir_q15_t fir;
+static dsp_biquad_f32_t iir32;
+static dsp_biquad_f64_t iir64;
+static dsp_movavg_q15_t avg;
+
+// Second-order Butterworth low-pass at fs / 10, the same in each section
+static const double lowpass[5] = {
+  0.0674553, 0.1349105, 0.0674553, -1.1429805, 0.4128016,
+};
+
+static uint32_t rng = 12345;
+static int16_t rnd_q15(void) {
+  rng = rng * 1664525UL + 1013904223UL;
+  return (int16_t)(rng >> 16);
+}
+
+static void make_signals(void) {
+  for (uint32_t i = 0; i < BLOCK; i++) {
+    // A triangle wave with noise on it, and noise alone
+    int32_t tri = (int32_t)((i * 1024U) & 0x7FFFU) - 16384;
+    x_q15[i] = (int16_t)(tri + rnd_q15() / 2);
+    x2_q15[i] = rnd_q15();
+    // Past full scale at times, for the saturation
+    x_f32[i] = (float)x_q15[i] * (1.25f / 32768.0f);
+    x_f64[i] = x_f32[i];
+  }
+  for (uint32_t k = 0; k < FIR_TAPS; k++) taps[k] = (int16_t)(rnd_q15() / 32);
+  for (uint32_t k = 0; k < 5U * IIR_SECTIONS; k++) {
+    iir_f64[k] = lowpass[k % 5U];
+    iir_f32[k] = (float)lowpass[k % 5U];
+  }
+}
+
+// Start the streaming kernels from rest, as the references do
+static void setup(bench_case_t c) {
+  if (c == CASE_FIR) dsp_fir_q15_init(&fir, taps, FIR_TAPS, fir_state, BLOCK);
+  if (c == CASE_IIR_F32) dsp_biquad_f32_init(&iir32, iir_f32, IIR_SECTIONS, iir_state_f32);
+  if (c == CASE_IIR_F64) dsp_biquad_f64_init(&iir64, iir_f64, IIR_SECTIONS, iir_state_f64);
+  if (c == CASE_AVG) dsp_movavg_q15_init(&avg, AVG_LEN, avg_state, BLOCK);
+}
+
+static void run(bench_case_t c, int kernel) {
+  int16_t *yq = y_q15[kernel];
+  switch (c) {
+  case CASE_FIR:
+    if (kernel) dsp_fir_q15(&fir, x_q15, yq, BLOCK);
+    else        dsp_fir_q15_ref(taps, FIR_TAPS, x_q15, yq, BLOCK);
+    break;
+  case CASE_IIR_F32:
+    if (kernel) dsp_biquad_f32(&iir32, x_f32, y_f32[1], BLOCK);
+    else        dsp_biquad_ref(iir_f64, IIR_SECTIONS, x_f64, y_f64[0], BLOCK);
+    break;
+  case CASE_IIR_F64:
+    if (kernel) dsp_biquad_f64(&iir64, x_f64, y_f64[1], BLOCK);
+    else        dsp_biquad_ref(iir_f64, IIR_SECTIONS, x_f64, y_f64[0], BLOCK);
+    break;
+  case CASE_AVG:
+    if (kernel) dsp_movavg_q15(&avg, x_q15, yq, BLOCK);
+    else        dsp_movavg_q15_ref(AVG_LEN, x_q15, yq, BLOCK);
+    break;
+  case CASE_TO_F32:
+    if (kernel) dsp_q15_to_f32(x_q15, y_f32[1], BLOCK);
+    else        dsp_q15_to_f32_ref(x_q15, y_f32[0], BLOCK);
+    break;
+  case CASE_TO_Q15:
+    if (kernel) dsp_f32_to_q15(x_f32, yq, BLOCK);
+    else        dsp_f32_to_q15_ref(x_f32, yq, BLOCK);
+    break;
+  case CASE_ADD:
+    if (kernel) dsp_add_q15(x_q15, x2_q15, yq, BLOCK);
+    else        dsp_add_q15_ref(x_q15, x2_q15, yq, BLOCK);
+    break;
+  default:
+    max_out[kernel] = kernel ? dsp_max_q15(x_q15, BLOCK) : dsp_max_q15_ref(x_q15, BLOCK);
+    break;
+  }
+}
+
+static double diff(double a, double b) {
+  return a > b ? a - b : b - a;
+}
+
+// Did the kernel give what the reference did?
+static int agree(bench_case_t c) {
+  for (uint32_t i = 0; i < BLOCK; i++) {
+    switch (c) {
+    case CASE_IIR_F32:
+      if (diff(y_f32[1][i], y_f64[0][i]) > 1e-4) return 0;
+      break;
+    case CASE_IIR_F64:
+      if (diff(y_f64[1][i], y_f64[0][i]) > 1e-9) return 0;
+      break;
+    case CASE_TO_F32:
+      if (y_f32[1][i] != y_f32[0][i]) return 0;
+      break;
+    case CASE_MAX:
+      return max_out[0] == max_out[1];
+    default:
+      if (y_q15[1][i] != y_q15[0][i]) return 0;
+      break;
+    }
+  }
+  return 1;
+}
+
+// Hundredths of a cycle per sample
+static uint32_t time_run(bench_case_t c, int kernel) {
+  uint32_t t0, t;
+  uint32_t primask = critical_enter();
+
+  setup(c);
+  t0 = cycles_now();
+  run(c, kernel);
+  t = cycles_now() - t0;
+
+  critical_exit(primask);
+  return t * 100U / BLOCK;
+}
+
+void dsp_bench(void) {
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) cycles_init();
+  make_signals();
+
+  console_printf("\r\ncycles per sample over %u samples        ref      dsp\r\n", BLOCK);
+  for (int c = 0; c < NUM_CASES; c++) {
+    uint32_t ref = time_run((bench_case_t)c, 0);
+    uint32_t ker = time_run((bench_case_t)c, 1);
+    console_printf("%-32s %5lu.%02lu %5lu.%02lu%s\r\n", names[c],
+                   (unsigned long)(ref / 100U), (unsigned long)(ref % 100U),
+                   (unsigned long)(ker / 100U), (unsigned long)(ker % 100U),
+                   agree((bench_case_t)c) ? "" : "  MISMATCH");
+  }
+}
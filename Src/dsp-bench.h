@@ -0,0 +1,17 @@
+/*
+ * dsp-bench.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * The kernels in dsp.h against their scalar references: cycles per
+ * sample of each over the same block, and whether they agree.
+ */
+
+#ifndef DSP_BENCH_H_
+#define DSP_BENCH_H_
+
+// Print a table of cycles per sample, reference and kernel
+void dsp_bench(void);
+
+#endif /* DSP_BENCH_H_ */
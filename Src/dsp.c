@@ -0,0 +1,316 @@
+/*
+ * dsp.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Signal kernels and their references. See dsp.h.
+ *
+ * SIMD instructions: Arm v7-M ARM Sec A4.4.3 (parallel add and subtract,
+ *   GE flags), A7.7 (SMLALD, SMLSD, QADD16, SSUB16, SEL, PKHBT/PKHTB)
+ * FPU: PM0253 Rev 5 Sec 3.11 - single and double precision, with fused
+ *   multiply-add (VFMA), which GCC uses for a * b + c
+ *
+ * The FIR keeps its window newest sample first, so the taps can be given
+ * in their natural order and both step through memory the same way.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "dsp.h"
+
+// Two Q15 samples from anywhere: the M7 does unaligned word loads
+static inline uint32_t read_pair(const int16_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline void write_pair(int16_t *p, uint32_t v) {
+  memcpy(p, &v, sizeof(v));
+}
+
+static inline int16_t sat_q15(int64_t v) {
+  return (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+}
+
+// A sum of Q30 products back to Q15, rounding halves up
+static inline int16_t q15_round(int64_t acc) {
+  return sat_q15((acc + 0x4000) >> 15);
+}
+
+/* ----------------------------------------------------------------------
+ * FIR
+ */
+
+int dsp_fir_q15_init(dsp_fir_q15_t *f, const int16_t *taps, uint32_t num_taps,
+                     int16_t *state, uint32_t block) {
+  if (num_taps == 0 || block == 0) return -1;
+  f->taps = taps;
+  f->num_taps = num_taps;
+  f->state = state;
+  f->block = block;
+  memset(state, 0, (num_taps - 1U + block) * sizeof(state[0]));
+  return 0;
+}
+
+void dsp_fir_q15(dsp_fir_q15_t *f, const int16_t *in, int16_t *out, uint32_t n) {
+  const int16_t *b = f->taps;
+  uint32_t taps = f->num_taps;
+  uint32_t pairs = taps & ~1UL;
+  // The history is at state[block] on, newest first; in[0] goes just
+  // before it and in[n - 1] furthest away
+  int16_t *newest = f->state + f->block - 1U;
+  uint32_t i;
+
+  for (i = 0; i < n; i++) newest[-(int32_t)i] = in[i];
+
+  // out[i]'s window starts at in[i]; out[i + 1]'s one sample earlier
+  for (i = 0; i + 1U < n; i += 2U) {
+    const int16_t *p = newest - i;
+    const int16_t *q = p - 1;
+    uint64_t acc0 = 0, acc1 = 0;
+    for (uint32_t k = 0; k < pairs; k += 2U) {
+      uint32_t c = read_pair(b + k);
+      acc0 = __SMLALD(c, read_pair(p + k), acc0);
+      acc1 = __SMLALD(c, read_pair(q + k), acc1);
+    }
+    if (taps & 1U) {
+      acc0 += (uint64_t)(int64_t)((int32_t)b[pairs] * p[pairs]);
+      acc1 += (uint64_t)(int64_t)((int32_t)b[pairs] * q[pairs]);
+    }
+    out[i] = q15_round((int64_t)acc0);
+    out[i + 1U] = q15_round((int64_t)acc1);
+  }
+  if (i < n) {
+    const int16_t *p = newest - i;
+    uint64_t acc = 0;
+    for (uint32_t k = 0; k < pairs; k += 2U) acc = __SMLALD(read_pair(b + k), read_pair(p + k), acc);
+    if (taps & 1U) acc += (uint64_t)(int64_t)((int32_t)b[pairs] * p[pairs]);
+    out[i] = q15_round((int64_t)acc);
+  }
+
+  // The newest num_taps - 1 samples are the next call's history
+  memmove(newest + 1, newest + 1 - n, (taps - 1U) * sizeof(*newest));
+}
+
+void dsp_fir_q15_ref(const int16_t *taps, uint32_t num_taps, const int16_t *x, int16_t *y,
+                     uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    int64_t acc = 0;
+    for (uint32_t k = 0; k < num_taps && k <= i; k++) acc += (int32_t)taps[k] * x[i - k];
+    y[i] = q15_round(acc);
+  }
+}
+
+/* ----------------------------------------------------------------------
+ * IIR
+ */
+
+void dsp_biquad_f32_init(dsp_biquad_f32_t *f, const float *coeffs, uint32_t sections, float *state) {
+  f->coeffs = coeffs;
+  f->state = state;
+  f->sections = sections;
+  memset(state, 0, 2U * sections * sizeof(state[0]));
+}
+
+void dsp_biquad_f64_init(dsp_biquad_f64_t *f, const double *coeffs, uint32_t sections, double *state) {
+  f->coeffs = coeffs;
+  f->state = state;
+  f->sections = sections;
+  memset(state, 0, 2U * sections * sizeof(state[0]));
+}
+
+// The same loop in either precision; the first section reads in, the
+// rest work on out in place
+#define BIQUAD_BODY(T)                                           \
+  const T *c = f->coeffs;                                        \
+  T *d = f->state;                                               \
+  const T *src = in;                                             \
+  for (uint32_t s = 0; s < f->sections; s++, c += 5, d += 2) {   \
+    T b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];     \
+    T d1 = d[0], d2 = d[1];                                      \
+    for (uint32_t i = 0; i < n; i++) {                           \
+      T x = src[i];                                              \
+      T y = b0 * x + d1;                                         \
+      d1 = b1 * x - a1 * y + d2;                                 \
+      d2 = b2 * x - a2 * y;                                      \
+      out[i] = y;                                                \
+    }                                                            \
+    d[0] = d1;                                                   \
+    d[1] = d2;                                                   \
+    src = out;                                                   \
+  }
+
+void dsp_biquad_f32(dsp_biquad_f32_t *f, const float *in, float *out, uint32_t n) {
+  BIQUAD_BODY(float)
+}
+
+void dsp_biquad_f64(dsp_biquad_f64_t *f, const double *in, double *out, uint32_t n) {
+  BIQUAD_BODY(double)
+}
+
+void dsp_biquad_ref(const double *coeffs, uint32_t sections, const double *x, double *y,
+                    uint32_t n) {
+  const double *src = x;
+  for (uint32_t s = 0; s < sections; s++, coeffs += 5) {
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    for (uint32_t i = 0; i < n; i++) {
+      double xi = src[i];
+      double yi = coeffs[0] * xi + coeffs[1] * x1 + coeffs[2] * x2 - coeffs[3] * y1 - coeffs[4] * y2;
+      x2 = x1;
+      x1 = xi;
+      y2 = y1;
+      y1 = yi;
+      y[i] = yi;
+    }
+    src = y;
+  }
+}
+
+/* ----------------------------------------------------------------------
+ * Moving average
+ */
+
+// sum / len, by the reciprocal
+static inline int16_t movavg_scale(int32_t sum, int32_t recip) {
+  return sat_q15(((int64_t)sum * recip + (1LL << 29)) >> 30);
+}
+
+int dsp_movavg_q15_init(dsp_movavg_q15_t *m, uint32_t len, int16_t *state, uint32_t block) {
+  if (len == 0 || len > 65536U || block == 0) return -1;
+  m->state = state;
+  m->len = len;
+  m->block = block;
+  m->sum = 0;
+  m->recip = (int32_t)(((1ULL << 30) + len / 2U) / len);
+  memset(state, 0, (len + block) * sizeof(state[0]));
+  return 0;
+}
+
+void dsp_movavg_q15(dsp_movavg_q15_t *m, const int16_t *in, int16_t *out, uint32_t n) {
+  // The last len samples, oldest first, then this block: each new
+  // sample comes in at s[len + i] as s[i] goes out
+  int16_t *s = m->state;
+  uint32_t len = m->len;
+  int32_t recip = m->recip;
+  int32_t sum = m->sum;
+  uint32_t i;
+
+  memcpy(s + len, in, n * sizeof(*s));
+  for (i = 0; i + 1U < n; i += 2U) {
+    uint32_t x_in = read_pair(s + len + i), x_out = read_pair(s + i);
+    // (in, out) in one word; SMLSD adds in x 1 and takes away out x 1
+    sum = (int32_t)__SMLSD(__PKHBT(x_in, x_out, 16), 0x00010001UL, (uint32_t)sum);
+    int16_t y0 = movavg_scale(sum, recip);
+    sum = (int32_t)__SMLSD(__PKHTB(x_out, x_in, 16), 0x00010001UL, (uint32_t)sum);
+    int16_t y1 = movavg_scale(sum, recip);
+    write_pair(out + i, __PKHBT(y0, y1, 16));
+  }
+  if (i < n) {
+    sum += s[len + i] - s[i];
+    out[i] = movavg_scale(sum, recip);
+  }
+  memmove(s, s + n, len * sizeof(*s));
+  m->sum = sum;
+}
+
+void dsp_movavg_q15_ref(uint32_t len, const int16_t *x, int16_t *y, uint32_t n) {
+  int32_t recip = (int32_t)(((1ULL << 30) + len / 2U) / len);
+  for (uint32_t i = 0; i < n; i++) {
+    int32_t sum = 0;
+    for (uint32_t k = 0; k < len && k <= i; k++) sum += x[i - k];
+    y[i] = movavg_scale(sum, recip);
+  }
+}
+
+/* ----------------------------------------------------------------------
+ * Conversions
+ */
+
+#define Q15_SCALE 32768.0f
+
+// Round to nearest even by the FPU's own rounding (FPSCR.RMode is
+// round-to-nearest out of reset): adding 1.5 x 2^23 leaves no bits below
+// the units for any |v| below 2^22, and the clamp sees to that
+static inline int32_t to_q15(float x) {
+  float v = x * Q15_SCALE;
+  v = v < 32767.0f ? v : 32767.0f; // NaN too
+  v = v > -32768.0f ? v : -32768.0f;
+  return (int32_t)((v + 12582912.0f) - 12582912.0f);
+}
+
+void dsp_q15_to_f32(const int16_t *in, float *out, uint32_t n) {
+  const float scale = 1.0f / Q15_SCALE;
+  uint32_t i;
+  for (i = 0; i + 1U < n; i += 2U) {
+    uint32_t w = read_pair(in + i);
+    out[i] = (float)(int16_t)(w & 0xFFFFU) * scale;
+    out[i + 1U] = (float)((int32_t)w >> 16) * scale;
+  }
+  if (i < n) out[i] = (float)in[i] * scale;
+}
+
+void dsp_f32_to_q15(const float *in, int16_t *out, uint32_t n) {
+  uint32_t i;
+  for (i = 0; i + 1U < n; i += 2U) {
+    write_pair(out + i, __PKHBT(to_q15(in[i]), to_q15(in[i + 1U]), 16));
+  }
+  if (i < n) out[i] = (int16_t)to_q15(in[i]);
+}
+
+void dsp_q15_to_f32_ref(const int16_t *in, float *out, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) out[i] = (float)in[i] / Q15_SCALE;
+}
+
+void dsp_f32_to_q15_ref(const float *in, int16_t *out, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    double v = (double)in[i] * Q15_SCALE;
+    if (!(v < 32767.0)) v = 32767.0;
+    else if (v < -32768.0) v = -32768.0;
+    int32_t t = (int32_t)v; // Toward zero, then to nearest even
+    double frac = v - t;
+    if (frac > 0.5 || (frac == 0.5 && (t & 1))) t++;
+    else if (frac < -0.5 || (frac == -0.5 && (t & 1))) t--;
+    out[i] = (int16_t)t;
+  }
+}
+
+/* ----------------------------------------------------------------------
+ * Add and max
+ */
+
+void dsp_add_q15(const int16_t *a, const int16_t *b, int16_t *out, uint32_t n) {
+  uint32_t i;
+  for (i = 0; i + 1U < n; i += 2U) write_pair(out + i, __QADD16(read_pair(a + i), read_pair(b + i)));
+  if (i < n) out[i] = sat_q15((int32_t)a[i] + b[i]);
+}
+
+int16_t dsp_max_q15(const int16_t *x, uint32_t n) {
+  uint32_t best = 0x80008000UL; // -32768 in both halves
+  uint32_t i;
+  for (i = 0; i + 1U < n; i += 2U) {
+    uint32_t v = read_pair(x + i);
+    (void)__SSUB16(v, best); // GE set for each half where v >= best
+    best = __SEL(v, best);
+  }
+  int16_t lo = (int16_t)(best & 0xFFFFU), hi = (int16_t)(best >> 16);
+  int16_t m = lo > hi ? lo : hi;
+  if (i < n && x[i] > m) m = x[i];
+  return m;
+}
+
+void dsp_add_q15_ref(const int16_t *a, const int16_t *b, int16_t *out, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) out[i] = sat_q15((int32_t)a[i] + b[i]);
+}
+
+int16_t dsp_max_q15_ref(const int16_t *x, uint32_t n) {
+  int16_t m = -32768;
+  for (uint32_t i = 0; i < n; i++) if (x[i] > m) m = x[i];
+  return m;
+}
@@ -0,0 +1,110 @@
+/*
+ * dsp.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Signal kernels for the Cortex-M7: filters, moving averages and sample
+ * format conversions, each with a plain scalar reference to check and
+ * time it against (see dsp-bench.h, and Sim/dsp-compare).
+ *
+ * The Q15 kernels (16-bit samples, 1.0 = 32768) work on two samples per
+ * 32-bit word with the DSP extension (Arm v7-M ARM Sec A4.4.3): SMLALD
+ * does two 16x16 multiplies into a 64-bit sum, SMLSD adds one sample and
+ * takes away another, QADD16 adds two pairs with saturation, and SSUB16
+ * sets the GE flags that SEL picks each half of a result by. Pairs are
+ * read with unaligned word loads, which the M7 allows (CCR.UNALIGN_TRP is
+ * left clear).
+ *
+ * The floating-point kernels use the FPv5 FPU, single or double precision
+ * (-mfpu=fpv5-d16); double costs more cycles per operation but keeps
+ * high-order IIR sections with poles near the unit circle accurate.
+ *
+ * Streaming kernels keep their history in a state buffer that the caller
+ * provides, sized for the largest block they will be given; any number
+ * of samples up to that can go through per call. The references start
+ * from rest (zero history) and take a whole signal at once.
+ *
+ * Q15 results round to nearest (halves up, or to even for the
+ * conversions) and saturate. The Q15 kernels give exactly what their
+ * references do; the floating-point ones differ by rounding only.
+ */
+
+#ifndef DSP_H_
+#define DSP_H_
+
+#include <stdint.h>
+
+// FIR filter, Q15: y[n] = sum of b[k] x[n-k], summed in 64 bits and
+// rounded once. Two outputs at a time, two taps per SMLALD.
+typedef struct {
+  const int16_t *taps;   // b[0] .. b[num_taps - 1]
+  uint32_t num_taps;
+  int16_t *state;        // num_taps - 1 + block samples
+  uint32_t block;
+} dsp_fir_q15_t;
+
+// Returns 0, or -1 if num_taps or block is 0
+int dsp_fir_q15_init(dsp_fir_q15_t *f, const int16_t *taps, uint32_t num_taps,
+                     int16_t *state, uint32_t block);
+// n up to the block size; in and out may be the same buffer
+void dsp_fir_q15(dsp_fir_q15_t *f, const int16_t *in, int16_t *out, uint32_t n);
+void dsp_fir_q15_ref(const int16_t *taps, uint32_t num_taps, const int16_t *x, int16_t *y,
+                     uint32_t n);
+
+// IIR filter: a cascade of biquad sections, each
+//   H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+// as five coefficients b0, b1, b2, a1, a2. Transposed direct form II,
+// each section's coefficients and state in registers for the block.
+typedef struct {
+  const float *coeffs;   // 5 per section
+  float *state;          // 2 per section
+  uint32_t sections;
+} dsp_biquad_f32_t;
+
+typedef struct {
+  const double *coeffs;
+  double *state;
+  uint32_t sections;
+} dsp_biquad_f64_t;
+
+void dsp_biquad_f32_init(dsp_biquad_f32_t *f, const float *coeffs, uint32_t sections, float *state);
+void dsp_biquad_f64_init(dsp_biquad_f64_t *f, const double *coeffs, uint32_t sections, double *state);
+// Any n; in and out may be the same buffer
+void dsp_biquad_f32(dsp_biquad_f32_t *f, const float *in, float *out, uint32_t n);
+void dsp_biquad_f64(dsp_biquad_f64_t *f, const double *in, double *out, uint32_t n);
+// Direct form I in double precision, one section over the whole signal
+// at a time
+void dsp_biquad_ref(const double *coeffs, uint32_t sections, const double *x, double *y,
+                    uint32_t n);
+
+// Moving average, Q15: the mean of the last len samples, as a running
+// sum that one SMLSD per sample moves along
+typedef struct {
+  int16_t *state;        // len + block samples
+  uint32_t len;
+  uint32_t block;
+  int32_t sum;
+  int32_t recip;         // 2^30 / len, rounded
+} dsp_movavg_q15_t;
+
+// Returns 0, or -1 if len or block is 0 or len is over 65536
+int dsp_movavg_q15_init(dsp_movavg_q15_t *m, uint32_t len, int16_t *state, uint32_t block);
+void dsp_movavg_q15(dsp_movavg_q15_t *m, const int16_t *in, int16_t *out, uint32_t n);
+void dsp_movavg_q15_ref(uint32_t len, const int16_t *x, int16_t *y, uint32_t n);
+
+// Q15 <-> float. To Q15 rounds to nearest even and saturates; NaN gives
+// 32767.
+void dsp_q15_to_f32(const int16_t *in, float *out, uint32_t n);
+void dsp_f32_to_q15(const float *in, int16_t *out, uint32_t n);
+void dsp_q15_to_f32_ref(const int16_t *in, float *out, uint32_t n);
+void dsp_f32_to_q15_ref(const float *in, int16_t *out, uint32_t n);
+
+// Saturating sum of two Q15 signals (QADD16), and the largest sample of
+// one (SSUB16 and SEL); n may be odd. dsp_max_q15() of nothing is -32768.
+void dsp_add_q15(const int16_t *a, const int16_t *b, int16_t *out, uint32_t n);
+int16_t dsp_max_q15(const int16_t *x, uint32_t n);
+void dsp_add_q15_ref(const int16_t *a, const int16_t *b, int16_t *out, uint32_t n);
+int16_t dsp_max_q15_ref(const int16_t *x, uint32_t n);
+
+#endif /* DSP_H_ */
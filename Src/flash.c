@@ -0,0 +1,142 @@
+/*
+ * flash.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See flash.h.
+ *
+ * Sequences: RM0410 Rev 5 Sec 3.3.6 (unlock), 3.3.7 (sector erase),
+ * 3.3.8 (programming). With EOPIE set, EOP comes at the end of each
+ * erase and of each word programmed; with ERRIE, OPERR comes with any
+ * error flag. SNB bit 4 picks the bank in dual-bank mode, and the bank
+ * is the physical one: swapped, the inactive bank is bank 1.
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "critical.h"
+#include "flash.h"
+
+#define FLASH_KEY1 0x45670123UL
+#define FLASH_KEY2 0xCDEF89ABUL
+#define FLASH_SR_ERRORS (FLASH_SR_OPERR | FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_ERSERR)
+#define FLASH_SNB_BANK2 0x10U
+
+// Sector sizes in K: RM0410 Rev 5 Sec 3.3.1 Table 4 (dual bank)
+static const uint8_t sector_kb[FLASH_SECTORS] = { 16, 16, 16, 16, 64, 128, 128, 128, 128, 128, 128, 128 };
+
+// The operation in progress; the handler's once started
+static volatile int busy;
+static volatile uint32_t last_error;
+static volatile uint32_t *prog_at;
+static const uint32_t *prog_src;
+static uint32_t prog_left;
+static flash_done_t done_cb;
+static flash_stats_t stats;
+
+int flash_dual_bank(void) {
+  return (FLASH->OPTCR & FLASH_OPTCR_nDBANK) == 0;
+}
+
+int flash_swapped(void) {
+  return (SYSCFG->MEMRMP & SYSCFG_MEMRMP_SWP_FB) != 0;
+}
+
+int flash_init(void) {
+  if (!flash_dual_bank()) return 0;
+  if (FLASH->CR & FLASH_CR_LOCK) {
+    FLASH->KEYR = FLASH_KEY1;
+    FLASH->KEYR = FLASH_KEY2;
+  }
+  FLASH->SR = FLASH_SR_EOP | FLASH_SR_ERRORS;
+  FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_EOPIE | FLASH_CR_ERRIE;
+  NVIC_SetPriority(FLASH_IRQn, FLASH_IRQ_PRIORITY);
+  NVIC_EnableIRQ(FLASH_IRQn);
+  return 1;
+}
+
+void flash_lock(void) {
+  flash_wait();
+  NVIC_DisableIRQ(FLASH_IRQn);
+  FLASH->CR = FLASH_CR_LOCK;
+}
+
+uint32_t flash_sector_offset(uint32_t n) {
+  uint32_t off = 0;
+  for (uint32_t i = 0; i < n && i < FLASH_SECTORS; i++) off += sector_kb[i] * 1024U;
+  return off;
+}
+
+uint32_t flash_sector_size(uint32_t n) {
+  return n < FLASH_SECTORS ? sector_kb[n] * 1024U : 0U;
+}
+
+uint32_t flash_sector_of(uint32_t offset) {
+  uint32_t n = 0;
+  while (n < FLASH_SECTORS - 1U && offset >= flash_sector_offset(n + 1U)) n++;
+  return n;
+}
+
+void flash_erase_start(uint32_t n, flash_done_t done) {
+  uint32_t snb = n | (flash_swapped() ? 0U : FLASH_SNB_BANK2);
+  done_cb = done;
+  prog_left = 0;
+  busy = 1;
+  stats.erases++;
+  FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_EOPIE | FLASH_CR_ERRIE | FLASH_CR_SER |
+              (snb << FLASH_CR_SNB_Pos);
+  FLASH->CR |= FLASH_CR_STRT;
+}
+
+void flash_program_start(uint32_t addr, const uint32_t *src, uint32_t words, flash_done_t done) {
+  done_cb = done;
+  prog_at = (volatile uint32_t *)(uintptr_t)addr;
+  prog_src = src;
+  prog_left = words;
+  busy = 1;
+  FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_EOPIE | FLASH_CR_ERRIE | FLASH_CR_PG;
+  *prog_at++ = *prog_src++;
+  __DSB(); // The store must reach the flash interface now
+}
+
+void FLASH_IRQHandler(void) {
+  uint32_t sr = FLASH->SR;
+  FLASH->SR = sr & (FLASH_SR_EOP | FLASH_SR_ERRORS);
+  uint32_t error = sr & FLASH_SR_ERRORS;
+
+  if (prog_left && !error) {
+    stats.words++;
+    if (--prog_left) {
+      *prog_at++ = *prog_src++;
+      __DSB();
+      return;
+    }
+  }
+  if (error) stats.errors++;
+  FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_EOPIE | FLASH_CR_ERRIE;
+  last_error = error;
+  busy = 0;
+  if (done_cb) done_cb(error);
+}
+
+int flash_busy(void) {
+  return busy;
+}
+
+uint32_t flash_wait(void) {
+  while (busy) {
+    uint32_t s = critical_enter();
+    if (busy) __WFI();
+    critical_exit(s);
+  }
+  return last_error;
+}
+
+const flash_stats_t *flash_stats(void) {
+  return &stats;
+}
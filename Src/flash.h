@@ -0,0 +1,81 @@
+/*
+ * flash.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Erasing and programming the bank the code is not running from.
+ * RM0410 Rev 5 Sec 3.3 (embedded flash), Sec 3.7 (registers).
+ *
+ * In dual-bank mode (option bit nDBANK clear; the part ships with it
+ * set) the 2MB is two 1MB banks, each of 4 x 16K, 64K and 7 x 128K
+ * sectors. Code keeps running from one bank while the other is erased or
+ * programmed, so an update can be written while the old image runs and
+ * the USART keeps receiving. SYSCFG->MEMRMP SWP_FB maps bank 2 at
+ * FLASHAXI_BASE and bank 1 above it; either way the bank not running is
+ * at FLASH_INACTIVE_BASE, and this driver only writes there.
+ *
+ * Operations are started here and finished by the flash interrupt (EOP,
+ * or an error with ERRIE), which calls the caller's done() from the
+ * handler: programming is one 32-bit word (PSIZE x32, for a 2.7-3.6V
+ * supply) per interrupt. Only one operation runs at a time.
+ */
+
+#ifndef FLASH_H_
+#define FLASH_H_
+
+#include <stdint.h>
+
+#define FLASH_BANK_SIZE     (1024U * 1024U)
+#define FLASH_SECTORS       12U   // Per bank
+#define FLASH_INACTIVE_BASE (0x08000000UL + FLASH_BANK_SIZE)
+
+#ifndef FLASH_IRQ_PRIORITY
+#define FLASH_IRQ_PRIORITY 8U
+#endif
+
+// From the flash interrupt handler: 0, or the FLASH->SR error bits
+typedef void (*flash_done_t)(uint32_t error);
+
+// Unlock the control register and enable the flash interrupt.
+// Returns 0 if the part is not in dual-bank mode.
+int flash_init(void);
+
+// Lock the control register again
+void flash_lock(void);
+
+// The option bytes have the part in dual-bank mode
+int flash_dual_bank(void);
+
+// Bank 2 is at FLASHAXI_BASE (the loader swapped the banks)
+int flash_swapped(void);
+
+// Where sector n starts in a bank, and its size
+uint32_t flash_sector_offset(uint32_t n);
+uint32_t flash_sector_size(uint32_t n);
+
+// The sector holding byte `offset` of a bank
+uint32_t flash_sector_of(uint32_t offset);
+
+// Erase sector n of the inactive bank
+void flash_erase_start(uint32_t n, flash_done_t done);
+
+// Program words at addr (in the inactive bank, word-aligned and erased)
+// from src, which must stay put until done() is called
+void flash_program_start(uint32_t addr, const uint32_t *src, uint32_t words, flash_done_t done);
+
+// An operation is running
+int flash_busy(void);
+
+// Sleep until the operation running (if any) is done; returns its error bits
+uint32_t flash_wait(void);
+
+typedef struct {
+  uint32_t erases;
+  uint32_t words;
+  uint32_t errors;
+} flash_stats_t;
+
+const flash_stats_t *flash_stats(void);
+
+#endif /* FLASH_H_ */
@@ -0,0 +1,95 @@
+/*
+ * fmt-bench.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See fmt-bench.h.
+ *
+ * Each case is run with interrupts masked: once to measure the stack and
+ * then FMT_BENCH_CALLS times for the cycle count. The stack is measured
+ * by painting the unused area below the current frame with a pattern,
+ * making the call, and finding the lowest byte it overwrote; with
+ * interrupts masked nothing else can touch that area meanwhile.
+ *
+ * Code size is not measured here: compare the .map file of a build that
+ * uses printf() with one that uses only console_printf().
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "stm32f7xx.h"
+
+#include "console.h"
+#include "critical.h"
+#include "cycles.h"
+#include "fmt.h"
+#include "fmt-bench.h"
+
+#define FMT_BENCH_CALLS 100U
+#define FMT_BENCH_PAINT 2048U  // Bytes below the frame checked for use
+#define FMT_BENCH_FILL  0xA5U
+
+typedef int (*fmt_fn_t)(char *buf, size_t size, const char *fmt, ...);
+
+static char out[128];
+
+__attribute__((noinline))
+static void run_case(fmt_fn_t fn, int which) {
+  switch (which) {
+  case 0: fn(out, sizeof(out), "%d", -12345); break;
+  case 1: fn(out, sizeof(out), "%s %08lx %5u", "CFSR", 0x8200UL, 42U); break;
+  default: fn(out, sizeof(out), "%.3f V", 3.3); break;
+  }
+}
+
+// Stack bytes fn needs for one case
+__attribute__((noinline))
+static uint32_t stack_used(fmt_fn_t fn, int which) {
+  volatile uint8_t here = 0;
+  volatile uint8_t *top = (volatile uint8_t *)((uintptr_t)&here - 64U); // Below this frame
+  uint32_t used = 0;
+
+  for (uint32_t i = 0; i < FMT_BENCH_PAINT; i++) top[-(int32_t)i] = FMT_BENCH_FILL;
+  run_case(fn, which);
+
+  for (uint32_t i = FMT_BENCH_PAINT; i > 0; i--) {
+    if (top[-(int32_t)(i - 1U)] != FMT_BENCH_FILL) {
+      used = i + 64U;
+      break;
+    }
+  }
+  return used;
+}
+
+static uint32_t cycles_per_call(fmt_fn_t fn, int which) {
+  uint32_t t0 = cycles_now();
+  for (uint32_t i = 0; i < FMT_BENCH_CALLS; i++) run_case(fn, which);
+  return (cycles_now() - t0) / FMT_BENCH_CALLS;
+}
+
+void fmt_bench(void) {
+  static const char *const names[3] = { "%d", "%s %08lx %5u", "%.3f" };
+  uint32_t cycles[3][2], stack[3][2];
+
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) cycles_init();
+
+  uint32_t s = critical_enter();
+  for (int k = 0; k < 3; k++) {
+    stack[k][0] = stack_used(snprintf, k);
+    stack[k][1] = stack_used(fmt_snprintf, k);
+    cycles[k][0] = cycles_per_call(snprintf, k);
+    cycles[k][1] = cycles_per_call(fmt_snprintf, k);
+  }
+  critical_exit(s);
+
+  console_printf("\r\nper call        snprintf    fmt_snprintf  (cycles, stack bytes)\r\n");
+  for (int k = 0; k < 3; k++) {
+    console_printf("%-14s %7lu %5lu %9lu %5lu\r\n", names[k],
+                   (unsigned long)cycles[k][0], (unsigned long)stack[k][0],
+                   (unsigned long)cycles[k][1], (unsigned long)stack[k][1]);
+  }
+}
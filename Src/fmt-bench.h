@@ -0,0 +1,17 @@
+/*
+ * fmt-bench.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * fmt_snprintf() against the C library's snprintf(): cycles per call and
+ * stack bytes used, for a few typical console lines.
+ */
+
+#ifndef FMT_BENCH_H_
+#define FMT_BENCH_H_
+
+// Print a table of cycles and stack depth per call of each formatter
+void fmt_bench(void);
+
+#endif /* FMT_BENCH_H_ */
@@ -0,0 +1,380 @@
+/*
+ * fmt.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * The formatter. See fmt.h.
+ *
+ * Everything is single pass: each conversion is turned into digits in a
+ * small buffer on the stack, then padding, prefix and digits are written
+ * straight to the output window. Integers that fit in 32 bits are
+ * converted with 32-bit division, which the Cortex-M7 does in hardware;
+ * only wider ones use the 64-bit library routine. %f uses the double
+ * precision FPU for one multiply and two conversions.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fmt.h"
+
+#define FMT_FLOAT_MAX_PREC 9
+
+typedef enum { LEN_INT, LEN_CHAR, LEN_SHORT, LEN_LONG, LEN_LLONG, LEN_SIZE, LEN_MAX, LEN_PTRDIFF } len_t;
+
+typedef struct {
+  uint8_t left;   // -
+  uint8_t zero;   // 0
+  uint8_t plus;   // +
+  uint8_t space;  // ' '
+  uint8_t alt;    // #
+  int width;
+  int prec;       // -1 if not given
+} spec_t;
+
+static const uint32_t fmt_pow10[FMT_FLOAT_MAX_PREC + 1] = {
+  1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
+
+// Make sure there is room for at least one byte; 0 if there never will be
+static int room(fmt_out_t *o) {
+  if (o->p != o->end) return 1;
+  if (o->next) o->next(o);
+  if (o->p != o->end) return 1;
+  o->next = NULL;
+  return 0;
+}
+
+static void put_n(fmt_out_t *o, const char *s, uint32_t n) {
+  o->count += n;
+  while (n) {
+    if (!room(o)) {
+      o->dropped += n;
+      return;
+    }
+    uint32_t r = (uint32_t)(o->end - o->p);
+    if (r > n) r = n;
+    memcpy(o->p, s, r);
+    o->p += r;
+    s += r;
+    n -= r;
+  }
+}
+
+static void pad(fmt_out_t *o, char c, int n) {
+  static const char spaces[8] = { ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ' };
+  static const char zeros[8] = { '0', '0', '0', '0', '0', '0', '0', '0' };
+  const char *run = c == '0' ? zeros : spaces;
+  while (n > 0) {
+    put_n(o, run, n > 8 ? 8U : (uint32_t)n);
+    n -= 8;
+  }
+}
+
+// Digits of v, least significant first; returns how many
+static int digits(char *buf, uint64_t v, unsigned base, int upper) {
+  const char *dig = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  int n = 0;
+  while (v > 0xFFFFFFFFULL) {
+    buf[n++] = dig[v % base];
+    v /= base;
+  }
+  uint32_t w = (uint32_t)v;
+  while (w) {
+    buf[n++] = dig[w % base];
+    w /= base;
+  }
+  return n;
+}
+
+// Width padding around prefix + leading zeros + body
+static void emit(fmt_out_t *o, const spec_t *s, const char *pre, int npre,
+                 int zeros, const char *rev, int nrev) {
+  int len = npre + zeros + nrev;
+  int fill = s->width > len ? s->width - len : 0;
+
+  if (!s->left) pad(o, ' ', fill);
+  put_n(o, pre, (uint32_t)npre);
+  pad(o, '0', zeros);
+  while (nrev) {
+    // Digits are reversed in buf; copy them out in runs
+    char run[8];
+    int k = 0;
+    while (nrev && k < 8) run[k++] = rev[--nrev];
+    put_n(o, run, (uint32_t)k);
+  }
+  if (s->left) pad(o, ' ', fill);
+}
+
+static void emit_int(fmt_out_t *o, spec_t *s, uint64_t v, int neg, unsigned base, int upper) {
+  char buf[24];
+  char pre[3];
+  int npre = 0;
+  int n = digits(buf, v, base, upper);
+  int prec = s->prec < 0 ? 1 : s->prec;
+  int zeros = prec > n ? prec - n : 0;
+
+  if (neg) pre[npre++] = '-';
+  else if (s->plus) pre[npre++] = '+';
+  else if (s->space) pre[npre++] = ' ';
+  if (s->alt && base == 16U && v) {
+    pre[npre++] = '0';
+    pre[npre++] = upper ? 'X' : 'x';
+  }
+  if (s->alt && base == 8U && zeros == 0) zeros = 1;
+
+  // The 0 flag pads with zeros after the prefix, unless there is a precision
+  if (s->zero && !s->left && s->prec < 0) {
+    int len = npre + zeros + n;
+    if (s->width > len) zeros += s->width - len;
+  }
+  emit(o, s, pre, npre, zeros, buf, n);
+}
+
+static void emit_str(fmt_out_t *o, const spec_t *s, const char *str) {
+  uint32_t n = 0;
+  if (!str) str = "(null)";
+  while (str[n] && (s->prec < 0 || n < (uint32_t)s->prec)) n++;
+
+  int fill = s->width > (int)n ? s->width - (int)n : 0;
+  if (!s->left) pad(o, ' ', fill);
+  put_n(o, str, n);
+  if (s->left) pad(o, ' ', fill);
+}
+
+static void emit_float(fmt_out_t *o, spec_t *s, double v, int upper) {
+  char buf[24];
+  char pre[1];
+  int npre = 0;
+  int neg = __builtin_signbit(v) != 0;
+  double a = neg ? -v : v;
+
+  if (neg) pre[npre++] = '-';
+  else if (s->plus) pre[npre++] = '+';
+  else if (s->space) pre[npre++] = ' ';
+
+  if (a != a || a > 1.7976931348623157e308) {
+    const char *word = a != a ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+    char rev[3] = { word[2], word[1], word[0] };
+    spec_t t = *s;
+    t.zero = 0;
+    emit(o, &t, pre, npre, 0, rev, 3);
+    return;
+  }
+
+  int prec = s->prec < 0 ? 6 : s->prec;
+  int extra = prec > FMT_FLOAT_MAX_PREC ? prec - FMT_FLOAT_MAX_PREC : 0;
+  prec -= extra;
+
+  // Beyond 64 bits, keep the leading digits and pad the rest with zeros
+  int tens = 0;
+  while (a >= 1e19) {
+    a /= 10.0;
+    tens++;
+  }
+
+  uint64_t ip = (uint64_t)a;
+  double frac = a - (double)ip;
+  double scale = (double)fmt_pow10[prec];
+  uint32_t fi = (uint32_t)(frac * scale);
+  double rem = frac * scale - (double)fi;
+  // The product may have been rounded onto a tie: the fused multiply-add
+  // gets the sign of frac * scale - (fi + 0.5) right
+  double tie = rem == 0.5 ? __builtin_fma(frac, scale, -((double)fi + 0.5)) : 0.0;
+  if (rem > 0.5 || (rem == 0.5 && (tie > 0.0 || (tie == 0.0 && ((prec ? fi : (uint32_t)ip) & 1U))))) {
+    if (++fi >= fmt_pow10[prec]) {
+      fi = 0;
+      ip++;
+    }
+  }
+
+  // Reversed: fraction digits, point, integer digits
+  int n = 0;
+  for (int i = 0; i < prec; i++) {
+    buf[n++] = (char)('0' + fi % 10U);
+    fi /= 10U;
+  }
+  int point = prec || s->alt || extra;
+  int ni = digits(buf + n + point, ip, 10U, 0);
+  if (ni == 0) buf[n + point + ni++] = '0';
+
+  int len = npre + ni + tens + point + prec + extra;
+  int zeros = 0;
+  if (s->zero && !s->left && s->width > len) zeros = s->width - len;
+  int fill = s->width > len + zeros ? s->width - len - zeros : 0;
+
+  if (!s->left) pad(o, ' ', fill);
+  put_n(o, pre, (uint32_t)npre);
+  pad(o, '0', zeros);
+  spec_t t = { 0, 0, 0, 0, 0, 0, -1 };
+  emit(o, &t, pre, 0, 0, buf + n + point, ni);
+  pad(o, '0', tens);
+  if (point) put_n(o, ".", 1);
+  emit(o, &t, pre, 0, 0, buf, n);
+  pad(o, '0', extra);
+  if (s->left) pad(o, ' ', fill);
+}
+
+static int64_t arg_signed(va_list *ap, len_t len) {
+  switch (len) {
+  case LEN_CHAR:    return (signed char)va_arg(*ap, int);
+  case LEN_SHORT:   return (short)va_arg(*ap, int);
+  case LEN_LONG:    return va_arg(*ap, long);
+  case LEN_LLONG:   return va_arg(*ap, long long);
+  case LEN_SIZE:    return (ptrdiff_t)va_arg(*ap, size_t);
+  case LEN_MAX:     return va_arg(*ap, intmax_t);
+  case LEN_PTRDIFF: return va_arg(*ap, ptrdiff_t);
+  case LEN_INT:
+  default:          return va_arg(*ap, int);
+  }
+}
+
+static uint64_t arg_unsigned(va_list *ap, len_t len) {
+  switch (len) {
+  case LEN_CHAR:    return (unsigned char)va_arg(*ap, unsigned int);
+  case LEN_SHORT:   return (unsigned short)va_arg(*ap, unsigned int);
+  case LEN_LONG:    return va_arg(*ap, unsigned long);
+  case LEN_LLONG:   return va_arg(*ap, unsigned long long);
+  case LEN_SIZE:    return va_arg(*ap, size_t);
+  case LEN_MAX:     return va_arg(*ap, uintmax_t);
+  case LEN_PTRDIFF: return (size_t)va_arg(*ap, ptrdiff_t);
+  case LEN_INT:
+  default:          return va_arg(*ap, unsigned int);
+  }
+}
+
+int fmt_vout(fmt_out_t *o, const char *fmt, va_list ap) {
+  uint32_t count0 = o->count;
+  va_list args;
+  va_copy(args, ap);
+
+  while (*fmt) {
+    const char *lit = fmt;
+    while (*fmt && *fmt != '%') fmt++;
+    if (fmt != lit) put_n(o, lit, (uint32_t)(fmt - lit));
+    if (!*fmt) break;
+    fmt++;
+
+    spec_t s = { 0, 0, 0, 0, 0, 0, -1 };
+    for (;; fmt++) {
+      if (*fmt == '-') s.left = 1;
+      else if (*fmt == '0') s.zero = 1;
+      else if (*fmt == '+') s.plus = 1;
+      else if (*fmt == ' ') s.space = 1;
+      else if (*fmt == '#') s.alt = 1;
+      else break;
+    }
+
+    if (*fmt == '*') {
+      s.width = va_arg(args, int);
+      if (s.width < 0) {
+        s.left = 1;
+        s.width = -s.width;
+      }
+      fmt++;
+    } else {
+      while (*fmt >= '0' && *fmt <= '9') s.width = s.width * 10 + (*fmt++ - '0');
+    }
+
+    if (*fmt == '.') {
+      fmt++;
+      s.prec = 0;
+      if (*fmt == '*') {
+        s.prec = va_arg(args, int);
+        if (s.prec < 0) s.prec = -1;
+        fmt++;
+      } else {
+        while (*fmt >= '0' && *fmt <= '9') s.prec = s.prec * 10 + (*fmt++ - '0');
+      }
+    }
+
+    len_t len = LEN_INT;
+    switch (*fmt) {
+    case 'h':
+      len = LEN_SHORT;
+      if (*++fmt == 'h') { len = LEN_CHAR; fmt++; }
+      break;
+    case 'l':
+      len = LEN_LONG;
+      if (*++fmt == 'l') { len = LEN_LLONG; fmt++; }
+      break;
+    case 'z': len = LEN_SIZE; fmt++; break;
+    case 'j': len = LEN_MAX; fmt++; break;
+    case 't': len = LEN_PTRDIFF; fmt++; break;
+    case 'L': fmt++; break; // long double is not supported; treated as double
+    default: break;
+    }
+
+    char c = *fmt;
+    if (!c) break;
+    fmt++;
+
+    switch (c) {
+    case 'd':
+    case 'i': {
+      int64_t v = arg_signed(&args, len);
+      emit_int(o, &s, v < 0 ? 0U - (uint64_t)v : (uint64_t)v, v < 0, 10U, 0);
+      break;
+    }
+    case 'u': emit_int(o, &s, arg_unsigned(&args, len), 0, 10U, 0); break;
+    case 'o': emit_int(o, &s, arg_unsigned(&args, len), 0, 8U, 0); break;
+    case 'x': emit_int(o, &s, arg_unsigned(&args, len), 0, 16U, 0); break;
+    case 'X': emit_int(o, &s, arg_unsigned(&args, len), 0, 16U, 1); break;
+    case 'p': {
+      void *ptr = va_arg(args, void *);
+      if (!ptr) {
+        emit_str(o, &s, "(nil)");
+      } else {
+        s.alt = 1;
+        emit_int(o, &s, (uintptr_t)ptr, 0, 16U, 0);
+      }
+      break;
+    }
+    case 'c': {
+      char ch = (char)va_arg(args, int);
+      int fill = s.width > 1 ? s.width - 1 : 0;
+      if (!s.left) pad(o, ' ', fill);
+      put_n(o, &ch, 1);
+      if (s.left) pad(o, ' ', fill);
+      break;
+    }
+    case 's': emit_str(o, &s, va_arg(args, const char *)); break;
+    case 'f': case 'e': case 'g': case 'a':
+      emit_float(o, &s, va_arg(args, double), 0);
+      break;
+    case 'F': case 'E': case 'G': case 'A':
+      emit_float(o, &s, va_arg(args, double), 1);
+      break;
+    case 'n': (void)va_arg(args, void *); break;
+    case '%': put_n(o, "%", 1); break;
+    default: {
+      char bad[2] = { '%', c };
+      put_n(o, bad, 2);
+      break;
+    }
+    }
+  }
+
+  va_end(args);
+  return (int)(o->count - count0);
+}
+
+int fmt_vsnprintf(char *buf, size_t size, const char *fmt, va_list ap) {
+  fmt_out_t o = { buf, size ? buf + size - 1 : buf, buf, NULL, NULL, 0, 0 };
+  int n = fmt_vout(&o, fmt, ap);
+  if (size) *o.p = '\0';
+  return n;
+}
+
+int fmt_snprintf(char *buf, size_t size, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = fmt_vsnprintf(buf, size, fmt, ap);
+  va_end(ap);
+  return n;
+}
@@ -0,0 +1,62 @@
+/*
+ * fmt.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Small printf-style formatter: no heap, no locale, no global state.
+ *
+ * Output goes to a fmt_out_t, which is a window (start..end) that the
+ * formatter fills byte by byte. When the window is full it calls next()
+ * to hand it on and get another one; console_printf() uses this to format
+ * straight into the free space of the TX ring, a contiguous chunk at a time.
+ * If next() has no more room, the rest of the output is counted in
+ * dropped and discarded.
+ *
+ * Conversions: d i u o x X c s p f F %, with the flags - 0 + space #,
+ * width and precision (also as *), and the length modifiers hh h l ll z j t.
+ * * %f is fixed-point: up to 9 decimal places (default 6), rounded half to
+ *   even like the C library. %e, %g and %a print as %f.
+ * * %n is not supported (it is consumed and ignored).
+ *
+ * The printing functions are declared with the printf format attribute,
+ * so GCC checks every format string against its arguments (-Wformat).
+ *
+ * Reentrant: all state is in the fmt_out_t and on the stack, so it may
+ * be used from any number of interrupt handlers at once.
+ */
+
+#ifndef FMT_H_
+#define FMT_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Check the format string and arguments at compile time like printf()
+#define FMT_CHECK(F, A) __attribute__((format(__printf__, F, A)))
+
+typedef struct fmt_out fmt_out_t;
+
+struct fmt_out {
+  char *p;       // Next byte to write
+  char *end;     // End of the current window
+  char *start;   // Start of the current window
+  // The window is full: hand on start..p and set up the next one.
+  // Leave p == end when there is no more room. NULL drops the rest.
+  void (*next)(fmt_out_t *o);
+  void *ctx;
+  uint32_t count;    // Bytes produced, stored or not
+  uint32_t dropped;  // Of those, discarded for lack of room
+};
+
+// Format into o; returns the number of bytes produced. Does not hand on
+// the final partial window: the caller does that with o->start..o->p.
+int fmt_vout(fmt_out_t *o, const char *fmt, va_list ap);
+
+// Like snprintf(): always NUL-terminates (if size > 0) and returns the
+// length the whole output would have had
+int fmt_snprintf(char *buf, size_t size, const char *fmt, ...) FMT_CHECK(3, 4);
+int fmt_vsnprintf(char *buf, size_t size, const char *fmt, va_list ap);
+
+#endif /* FMT_H_ */
@@ -0,0 +1,146 @@
+/*
+ * gpio-config.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Whole-port GPIO configuration, folded at compile time.
+ *
+ * The pins of one port are listed once, as an X-macro:
+ *
+ *   #define USART3_PINS(X) \
+ *     X(8, GPIO_CFG_MODE_AF, GPIO_CFG_PUSH_PULL, GPIO_CFG_SPEED_HIGH, GPIO_CFG_PULL_NONE, 7) \
+ *     X(9, GPIO_CFG_MODE_AF, GPIO_CFG_PUSH_PULL, GPIO_CFG_SPEED_HIGH, GPIO_CFG_PULL_UP,   7)
+ *
+ *   GPIO_PORT_APPLY(GPIOD, USART3_PINS);
+ *
+ * Each X(pin, mode, otype, speed, pull, af) contributes its bits to a
+ * constant mask/value pair per register, so the whole port is six pairs
+ * whatever the pin count. gpio_port_apply() then writes each register
+ * once: a plain store if every pin of it is described, one read and one
+ * store if only some are, and nothing if none are. Sixteen pins cost six
+ * stores, against four read-modify-writes per pin done one at a time.
+ *
+ * The AF field is only touched for pins in alternate function mode.
+ *
+ * GPIO registers: RM0410 Rev 5 Sec 6.4 p 218-223
+ * * MODER   - 2 bits per pin: input, output, alternate function, analog
+ * * OTYPER  - 1 bit per pin (low 16): push-pull or open-drain
+ * * OSPEEDR - 2 bits per pin: low, medium, high, very high
+ * * PUPDR   - 2 bits per pin: none, pull-up, pull-down
+ * * AFR[0]  - 4 bits per pin, pins 0-7; AFR[1] pins 8-15
+ */
+
+#ifndef GPIO_CONFIG_H_
+#define GPIO_CONFIG_H_
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#define GPIO_CFG_MODE_INPUT   (0x0UL)
+#define GPIO_CFG_MODE_OUTPUT  (0x1UL)
+#define GPIO_CFG_MODE_AF      (0x2UL)
+#define GPIO_CFG_MODE_ANALOG  (0x3UL)
+
+#define GPIO_CFG_PUSH_PULL    (0x0UL)
+#define GPIO_CFG_OPEN_DRAIN   (0x1UL)
+
+#define GPIO_CFG_SPEED_LOW    (0x0UL)
+#define GPIO_CFG_SPEED_MEDIUM (0x1UL)
+#define GPIO_CFG_SPEED_HIGH   (0x2UL)
+#define GPIO_CFG_SPEED_VHIGH  (0x3UL)
+
+#define GPIO_CFG_PULL_NONE    (0x0UL)
+#define GPIO_CFG_PULL_UP      (0x1UL)
+#define GPIO_CFG_PULL_DOWN    (0x2UL)
+
+typedef struct {
+  uint32_t mask;   // Bits this configuration owns
+  uint32_t value;  // What they are set to; always within mask
+} gpio_reg_cfg_t;
+
+typedef struct {
+  gpio_reg_cfg_t moder;
+  gpio_reg_cfg_t otyper;
+  gpio_reg_cfg_t ospeedr;
+  gpio_reg_cfg_t pupdr;
+  gpio_reg_cfg_t afr[2];
+} gpio_port_cfg_t;
+
+// One pin's contribution to each register; OR-folded by the list.
+// The unused arguments keep every one of these the same X() shape.
+#define GPIO_CFG_2BIT(PIN, V)  ((uint32_t)(V) << (2U * (PIN)))
+#define GPIO_CFG_AF(PIN, HI, V) \
+  ((((PIN) >= 8U) == (HI) ? (uint32_t)(V) : 0UL) << (4U * ((PIN) & 7U)))
+
+#define GPIO_CFG_MODER_M(P, M, T, S, U, A)   | GPIO_CFG_2BIT(P, 3U)
+#define GPIO_CFG_MODER_V(P, M, T, S, U, A)   | GPIO_CFG_2BIT(P, M)
+#define GPIO_CFG_OTYPER_M(P, M, T, S, U, A)  | (1UL << (P))
+#define GPIO_CFG_OTYPER_V(P, M, T, S, U, A)  | ((uint32_t)(T) << (P))
+#define GPIO_CFG_OSPEEDR_M(P, M, T, S, U, A) | GPIO_CFG_2BIT(P, 3U)
+#define GPIO_CFG_OSPEEDR_V(P, M, T, S, U, A) | GPIO_CFG_2BIT(P, S)
+#define GPIO_CFG_PUPDR_M(P, M, T, S, U, A)   | GPIO_CFG_2BIT(P, 3U)
+#define GPIO_CFG_PUPDR_V(P, M, T, S, U, A)   | GPIO_CFG_2BIT(P, U)
+#define GPIO_CFG_AFRL_M(P, M, T, S, U, A) \
+  | GPIO_CFG_AF(P, 0, (M) == GPIO_CFG_MODE_AF ? 0xFUL : 0UL)
+#define GPIO_CFG_AFRL_V(P, M, T, S, U, A) \
+  | GPIO_CFG_AF(P, 0, (M) == GPIO_CFG_MODE_AF ? (A) : 0UL)
+#define GPIO_CFG_AFRH_M(P, M, T, S, U, A) \
+  | GPIO_CFG_AF(P, 1, (M) == GPIO_CFG_MODE_AF ? 0xFUL : 0UL)
+#define GPIO_CFG_AFRH_V(P, M, T, S, U, A) \
+  | GPIO_CFG_AF(P, 1, (M) == GPIO_CFG_MODE_AF ? (A) : 0UL)
+
+#define GPIO_CFG_REG(LIST, R) \
+  { (uint32_t)(0UL LIST(GPIO_CFG_##R##_M)), (uint32_t)(0UL LIST(GPIO_CFG_##R##_V)) }
+
+// A constant gpio_port_cfg_t initializer for an X-macro pin list
+#define GPIO_PORT_CONFIG(LIST) { \
+  GPIO_CFG_REG(LIST, MODER), GPIO_CFG_REG(LIST, OTYPER), \
+  GPIO_CFG_REG(LIST, OSPEEDR), GPIO_CFG_REG(LIST, PUPDR), \
+  { GPIO_CFG_REG(LIST, AFRL), GPIO_CFG_REG(LIST, AFRH) } }
+
+// One access for a register: none, a store, or a read and a store.
+// A macro rather than a function so that it takes any register lvalue.
+#define GPIO_CFG_APPLY_REG(REG, C, FULL) do { \
+    if ((C).mask == 0) break; \
+    if (((C).mask & (FULL)) == (FULL)) (REG) = (C).value; \
+    else (REG) = ((REG) & ~(C).mask) | (C).value; \
+  } while (0)
+
+// Write a port's configuration, one access per register. The pin
+// properties go in before MODER, so a pin switching to output or
+// alternate function never drives with its old speed, type or AF.
+static inline void gpio_port_apply(GPIO_TypeDef *gpio, const gpio_port_cfg_t *cfg) {
+  GPIO_CFG_APPLY_REG(gpio->AFR[0], cfg->afr[0], 0xFFFFFFFFUL);
+  GPIO_CFG_APPLY_REG(gpio->AFR[1], cfg->afr[1], 0xFFFFFFFFUL);
+  GPIO_CFG_APPLY_REG(gpio->OTYPER, cfg->otyper, 0x0000FFFFUL);
+  GPIO_CFG_APPLY_REG(gpio->OSPEEDR, cfg->ospeedr, 0xFFFFFFFFUL);
+  GPIO_CFG_APPLY_REG(gpio->PUPDR, cfg->pupdr, 0xFFFFFFFFUL);
+  GPIO_CFG_APPLY_REG(gpio->MODER, cfg->moder, 0xFFFFFFFFUL);
+}
+
+// For pins only known at run time (e.g. from a descriptor table): add one
+// pin to a zeroed gpio_port_cfg_t, then gpio_port_apply() it as usual.
+static inline void gpio_cfg_add_pin(gpio_port_cfg_t *cfg, uint32_t pin, uint32_t mode,
+                                    uint32_t otype, uint32_t speed, uint32_t pull, uint32_t af) {
+  cfg->moder.mask |= GPIO_CFG_2BIT(pin, 3U);
+  cfg->moder.value |= GPIO_CFG_2BIT(pin, mode);
+  cfg->otyper.mask |= 1UL << pin;
+  cfg->otyper.value |= otype << pin;
+  cfg->ospeedr.mask |= GPIO_CFG_2BIT(pin, 3U);
+  cfg->ospeedr.value |= GPIO_CFG_2BIT(pin, speed);
+  cfg->pupdr.mask |= GPIO_CFG_2BIT(pin, 3U);
+  cfg->pupdr.value |= GPIO_CFG_2BIT(pin, pull);
+  if (mode == GPIO_CFG_MODE_AF) {
+    cfg->afr[pin >> 3].mask |= 0xFUL << (4U * (pin & 7U));
+    cfg->afr[pin >> 3].value |= af << (4U * (pin & 7U));
+  }
+}
+
+#define GPIO_PORT_APPLY(GPIOX, LIST) do { \
+    static const gpio_port_cfg_t gpio_port_cfg_ = GPIO_PORT_CONFIG(LIST); \
+    gpio_port_apply((GPIOX), &gpio_port_cfg_); \
+  } while (0)
+
+#endif /* GPIO_CONFIG_H_ */
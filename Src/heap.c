@@ -0,0 +1,95 @@
+/*
+ * heap.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * malloc() and friends on the pool.h size classes, in place of newlib's
+ * allocator on the _sbrk() heap (sysmem.c).
+ *
+ * Every call takes a bounded time and may be made from an interrupt
+ * handler. A request larger than the largest class, or made when it and
+ * every larger class are full, returns NULL with errno ENOMEM: there is
+ * no general heap behind the classes. Size them with POOL_CLASSES and
+ * watch the failure counts in pool_report().
+ *
+ * newlib calls the reentrant _malloc_r() family itself (stdio buffers,
+ * for one), so those are replaced too.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+// The host simulation renames these so as not to replace its own malloc()
+#ifndef HEAP_FN
+#define HEAP_FN(NAME) NAME
+#endif
+
+void *HEAP_FN(malloc)(size_t size) {
+  void *p = size <= UINT32_MAX ? pool_alloc_size((uint32_t)size) : NULL;
+  if (!p) errno = ENOMEM;
+  return p;
+}
+
+void HEAP_FN(free)(void *ptr) {
+  if (ptr) pool_free_any(ptr);
+}
+
+void *HEAP_FN(calloc)(size_t n, size_t size) {
+  if (size && n > SIZE_MAX / size) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  void *p = HEAP_FN(malloc)(n * size);
+  if (p) memset(p, 0, n * size);
+  return p;
+}
+
+void *HEAP_FN(realloc)(void *ptr, size_t size) {
+  if (!ptr) return HEAP_FN(malloc)(size);
+  if (!size) {
+    HEAP_FN(free)(ptr);
+    return NULL;
+  }
+  uint32_t have = pool_block_size(ptr);
+  if (size <= have) return ptr;
+  void *p = HEAP_FN(malloc)(size);
+  if (p) {
+    memcpy(p, ptr, have);
+    HEAP_FN(free)(ptr);
+  }
+  return p;
+}
+
+#ifdef _NEWLIB_VERSION
+
+struct _reent;
+
+void *_malloc_r(struct _reent *r, size_t size) {
+  (void)r;
+  return malloc(size);
+}
+
+void _free_r(struct _reent *r, void *ptr) {
+  (void)r;
+  free(ptr);
+}
+
+void *_calloc_r(struct _reent *r, size_t n, size_t size) {
+  (void)r;
+  return calloc(n, size);
+}
+
+void *_realloc_r(struct _reent *r, void *ptr, size_t size) {
+  (void)r;
+  return realloc(ptr, size);
+}
+
+#endif /* _NEWLIB_VERSION */
@@ -0,0 +1,89 @@
+/*
+ * kernel-port.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Cortex-M7 context switch for the kernel (kernel.h, kernel-port.h).
+ *
+ * A switched-out thread's process stack holds, from the top down:
+ * * the exception frame the hardware stacked on entry to PendSV: r0-r3,
+ *   r12, lr, pc, xPSR, and for a thread with an active FP context (CONTROL
+ *   FPCA) s0-s15 and FPSCR as well - an extended frame. With FPCCR LSPEN
+ *   set (boot.c) the hardware only reserves room for those; they are
+ *   written the first time the handler uses the FPU, if it does.
+ *   PM0253 Rev 5 Sec 2.3.7 and 4.6.3
+ * * s16-s31, for an extended frame only
+ * * r4-r11 and the EXC_RETURN value PendSV was entered with, whose bit 4
+ *   is clear for an extended frame: it says how to unstack the thread.
+ *   PM0253 Rev 5 Sec 2.3.8 Table 17
+ * Saving s16-s31 is itself an FPU instruction, so it is also what makes
+ * the hardware fill in s0-s15 for the outgoing thread. A thread that
+ * never used the FPU pays for none of it.
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "kernel.h"
+#include "kernel-port.h"
+#include "sections.h"
+
+// Return to thread mode on the process stack, basic frame
+#define EXC_RETURN_THREAD_PSP 0xFFFFFFFDUL
+#define XPSR_THUMB            0x01000000UL
+
+// The main stack, for handlers only once kernel_port_adopt() has run
+static uint64_t irq_stack[KERNEL_IRQ_STACK_BYTES / sizeof(uint64_t)];
+
+// A thread's function returning lands in kernel_thread_main(), never here
+static void trap(void) {
+  for (;;) {
+  }
+}
+
+void *kernel_port_frame(uint32_t *stack, uint32_t words, void (*entry)(void)) {
+  // The frame is 8-byte aligned, as exception entry would leave it
+  uint32_t *sp = (uint32_t *)((uintptr_t)(stack + words) & ~(uintptr_t)7U);
+
+  *--sp = XPSR_THUMB;
+  *--sp = (uint32_t)(uintptr_t)entry & ~1UL;  // pc
+  *--sp = (uint32_t)(uintptr_t)trap;          // lr
+  sp -= 5;                                    // r12, r3-r0
+  *--sp = EXC_RETURN_THREAD_PSP;
+  sp -= 8;                                    // r11-r4
+  return sp;
+}
+
+void *kernel_port_adopt(void) {
+  // Same address on the other stack pointer, so nothing moves; then the
+  // main stack starts afresh for handlers
+  __set_PSP(__get_MSP());
+  __set_CONTROL(__get_CONTROL() | CONTROL_SPSEL_Msk);
+  __ISB();
+  __set_MSP((uint32_t)(uintptr_t)&irq_stack[sizeof(irq_stack) / sizeof(irq_stack[0])]);
+  return 0;
+}
+
+// r0 carries the saved stack pointer into kernel_switch() and the next
+// thread's back out of it; lr, the EXC_RETURN, is saved with the thread.
+ITCM_CODE __attribute__((naked)) void PendSV_Handler(void) {
+  __asm volatile(
+    "  mrs      r0, psp\n"
+    "  isb\n"
+    "  tst      lr, #0x10\n"
+    "  it       eq\n"
+    "  vstmdbeq r0!, {s16-s31}\n"
+    "  stmdb    r0!, {r4-r11, lr}\n"
+    "  bl       kernel_switch\n"
+    "  ldmia    r0!, {r4-r11, lr}\n"
+    "  tst      lr, #0x10\n"
+    "  it       eq\n"
+    "  vldmiaeq r0!, {s16-s31}\n"
+    "  msr      psp, r0\n"
+    "  isb\n"
+    "  bx       lr\n");
+}
@@ -0,0 +1,37 @@
+/*
+ * kernel-port.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * What the kernel (kernel.h) needs from the core it runs on. The
+ * Cortex-M7 port is kernel-port.c; Sim/kernel-port.cpp stands in for it
+ * on the host.
+ *
+ * The port owns PendSV_Handler. It saves the running thread's context,
+ * calls kernel_switch() with the saved stack pointer, and restores the
+ * context at the one that returns.
+ */
+
+#ifndef KERNEL_PORT_H_
+#define KERNEL_PORT_H_
+
+#include <stdint.h>
+
+// Lay out a first context on stack[0..words) that starts entry(); returns
+// the thread's saved stack pointer
+void *kernel_port_frame(uint32_t *stack, uint32_t words, void (*entry)(void));
+
+// Move the caller, in thread mode, onto the stack pointer that PendSV
+// saves and restores, leaving the main stack to handlers. Returns what
+// kernel_switch() is to keep for it until it is first switched out.
+void *kernel_port_adopt(void);
+
+// From the port's PendSV_Handler, with the running thread's context
+// saved at sp: returns the saved stack pointer to switch to
+void *kernel_switch(void *sp);
+
+// Where kernel_port_frame() threads start
+void kernel_thread_main(void);
+
+#endif /* KERNEL_PORT_H_ */
@@ -0,0 +1,518 @@
+/*
+ * kernel.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Preemptive priority kernel. See kernel.h; the context switch itself is
+ * in the port (kernel-port.h).
+ *
+ * Lists are circular and doubly linked with a sentinel, as in sched.c, so
+ * a thread can leave one without knowing which it is on. Each priority
+ * has a ready list, and the running thread stays at the head of its own:
+ * a time slice or kernel_yield() moves it to the tail. Bit p of
+ * ready_bits is set while ready[p] is not empty, and the idle thread's
+ * bit is always set, so the next thread is the head of ready[ctz(bits)].
+ *
+ * Anything that makes a more urgent thread ready pends PendSV; the port's
+ * handler then calls kernel_switch(). From thread mode that happens as
+ * soon as interrupts are unmasked; from a handler, when it returns.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "console.h"
+#include "critical.h"
+#include "cycles.h"
+#include "kernel.h"
+#include "kernel-port.h"
+#include "memstat.h"
+#include "sections.h"
+#include "tick.h"
+
+#if KERNEL_PRIORITIES > 31U
+#error "KERNEL_PRIORITIES must be 31 or fewer: the idle thread has the next"
+#endif
+
+#define IDLE_PRIO KERNEL_PRIORITIES
+
+#define THREAD_OF(L) ((kernel_thread_t *)(L))
+#define TIMER_OF(L)  ((kernel_thread_t *)((uint8_t *)(L) - offsetof(kernel_thread_t, timer)))
+
+static kernel_link_t ready[KERNEL_PRIORITIES + 1U];
+static uint32_t ready_bits;
+static kernel_link_t sleepers;    // Timed waits, soonest first
+static kernel_thread_t *current;
+static kernel_thread_t *threads;  // Every one, for kernel_report()
+static int started;
+
+static kernel_thread_t idle_thread;
+static uint32_t idle_stack[KERNEL_IDLE_STACK_WORDS];
+
+static kernel_stats_t stats;
+static uint32_t ran_from;   // cycles_now() when current was switched in
+static uint32_t pend_at;    // When the switch pending was asked for
+static int pending;
+static uint32_t locked_at;
+
+static void list_init(kernel_link_t *l) {
+  l->next = l->prev = l;
+}
+
+static int list_empty(const kernel_link_t *l) {
+  return l->next == l;
+}
+
+static void list_unlink(kernel_link_t *l) {
+  l->prev->next = l->next;
+  l->next->prev = l->prev;
+  l->next = l->prev = l;
+}
+
+// Insert l before `at`: at the tail if `at` is the sentinel
+static void list_insert(kernel_link_t *at, kernel_link_t *l) {
+  l->prev = at->prev;
+  l->next = at;
+  at->prev->next = l;
+  at->prev = l;
+}
+
+// Mask interrupts, timing how long for if they were not already
+static uint32_t lock(void) {
+  uint32_t primask = critical_enter();
+  if (!primask) locked_at = cycles_now();
+  return primask;
+}
+
+static void unlock(uint32_t primask) {
+  if (!primask) {
+    uint32_t d = cycles_now() - locked_at;
+    if (d > stats.lock_max) stats.lock_max = d;
+  }
+  critical_exit(primask);
+}
+
+static void pend_switch(void) {
+  if (!pending) {
+    pending = 1;
+    pend_at = cycles_now();
+  }
+  SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+static void make_ready(kernel_thread_t *t) {
+  t->state = KERNEL_READY;
+  list_insert(&ready[t->prio], &t->link);
+  ready_bits |= 1UL << t->prio;
+  if (started && t->prio < current->prio) pend_switch();
+}
+
+static void unready(kernel_thread_t *t) {
+  list_unlink(&t->link);
+  if (list_empty(&ready[t->prio])) ready_bits &= ~(1UL << t->prio);
+}
+
+static void timer_add(kernel_thread_t *t, uint32_t ticks) {
+  kernel_link_t *l = sleepers.next;
+
+  t->wake = tick_now() + ticks;
+  while (l != &sleepers && (int32_t)(TIMER_OF(l)->wake - t->wake) <= 0) l = l->next;
+  list_insert(l, &t->timer);
+  t->timed = 1;
+}
+
+// End t's wait, whatever it was waiting on, with `result`
+static void wake(kernel_thread_t *t, kernel_status_t result) {
+  list_unlink(&t->link);
+  if (t->timed) {
+    list_unlink(&t->timer);
+    t->timed = 0;
+  }
+  t->result = (uint8_t)result;
+  make_ready(t);
+}
+
+static int can_block(uint32_t primask) {
+  return started && !primask && current != &idle_thread && __get_IPSR() == 0U;
+}
+
+// Take the running thread off its ready list to wait on `list` (or just
+// sleep, if NULL) for up to `ticks`, and switch away. Called locked, with
+// interrupts unmasked before; returns how the wait ended.
+static kernel_status_t block(kernel_link_t *list, uint32_t ticks, uint32_t primask) {
+  kernel_thread_t *t = current;
+  kernel_link_t *l;
+
+  unready(t);
+  if (list) {
+    // Most urgent first, then in the order they came
+    for (l = list->next; l != list && THREAD_OF(l)->prio <= t->prio; l = l->next) {
+    }
+    list_insert(l, &t->link);
+    t->state = KERNEL_WAITING;
+  } else {
+    t->state = KERNEL_SLEEPING;
+  }
+  if (ticks != KERNEL_FOREVER) timer_add(t, ticks);
+  pend_switch();
+  unlock(primask);
+  // PendSV is taken here, and this thread resumes once it is woken
+  __ISB();
+  return (kernel_status_t)t->result;
+}
+
+// SysTick, after the count: end timed waits that are due, and turn the
+// running thread to the back of its priority at the end of its slice
+ITCM_CODE static void kernel_tick(void) {
+  if (!started) return;
+
+  uint32_t primask = lock();
+  uint32_t now = tick_now();
+  while (!list_empty(&sleepers)) {
+    kernel_thread_t *t = TIMER_OF(sleepers.next);
+    if ((int32_t)(t->wake - now) > 0) break;
+    wake(t, KERNEL_TIMEOUT);
+  }
+
+  kernel_thread_t *c = current;
+  if (c->state == KERNEL_READY && (c->slice == 0 || --c->slice == 0)) {
+    kernel_link_t *r = &ready[c->prio];
+    c->slice = KERNEL_SLICE_TICKS;
+    if (r->next != r->prev) {
+      list_unlink(&c->link);
+      list_insert(r, &c->link);
+      stats.slices++;
+      pend_switch();
+    }
+  }
+  unlock(primask);
+}
+
+ITCM_CODE void *kernel_switch(void *sp) {
+  uint32_t primask = lock();
+  uint32_t now = cycles_now();
+  kernel_thread_t *t = current;
+  kernel_thread_t *next = THREAD_OF(ready[__builtin_ctz(ready_bits)].next);
+
+  t->sp = sp;
+  t->cycles += now - ran_from;
+  ran_from = now;
+  if (next != t) {
+    stats.switches++;
+    next->switches++;
+    next->slice = KERNEL_SLICE_TICKS;
+    current = next;
+  }
+  if (pending) {
+    uint32_t d = now - pend_at;
+    if (d > stats.switch_max) stats.switch_max = d;
+    pending = 0;
+  }
+  unlock(primask);
+  return next->sp;
+}
+
+void kernel_thread_main(void) {
+  kernel_thread_t *t = current;
+
+  t->fn(t->arg);
+
+  uint32_t primask = lock();
+  unready(t);
+  t->state = KERNEL_DONE;
+  pend_switch();
+  unlock(primask);
+  // Never switched back in
+  for (;;) {
+  }
+}
+
+static void idle(void *arg) {
+  (void)arg;
+  for (;;) __WFI();
+}
+
+// Fill in t, and put it on the list of all threads if it is not there
+static void thread_init(kernel_thread_t *t, const char *name, uint32_t prio, uint32_t *stack,
+                        uint32_t words) {
+  kernel_thread_t *p;
+
+  for (p = threads; p && p != t; p = p->next_all) {
+  }
+  kernel_thread_t *next_all = p ? t->next_all : threads;
+  memset(t, 0, sizeof(*t));
+  t->next_all = next_all;
+  if (!p) threads = t;
+
+  list_init(&t->link);
+  list_init(&t->timer);
+  t->name = name;
+  t->prio = (uint8_t)prio;
+  t->stack = stack;
+  t->stack_words = words;
+  t->slice = KERNEL_SLICE_TICKS;
+}
+
+static void thread_stack(kernel_thread_t *t, kernel_fn_t fn, void *arg) {
+  // Painted as memstat.c paints the main stack, for kernel_report()
+  for (uint32_t i = 0; i < t->stack_words; i++) t->stack[i] = MEMSTAT_PAINT;
+  t->fn = fn;
+  t->arg = arg;
+  t->sp = kernel_port_frame(t->stack, t->stack_words, kernel_thread_main);
+}
+
+void kernel_init(void) {
+  for (uint32_t p = 0; p <= KERNEL_PRIORITIES; p++) list_init(&ready[p]);
+  list_init(&sleepers);
+  ready_bits = 0;
+  threads = NULL;
+  current = NULL;
+  started = 0;
+  pending = 0;
+  memset(&stats, 0, sizeof(stats));
+
+  NVIC_SetPriority(PendSV_IRQn, KERNEL_IRQ_PRIORITY);
+  thread_init(&idle_thread, "idle", IDLE_PRIO, idle_stack, KERNEL_IDLE_STACK_WORDS);
+  thread_stack(&idle_thread, idle, NULL);
+  make_ready(&idle_thread);
+  tick_set_hook(kernel_tick);
+}
+
+void kernel_thread_create(kernel_thread_t *t, const char *name, uint32_t prio, uint32_t *stack,
+                          uint32_t words, kernel_fn_t fn, void *arg) {
+  if (prio >= KERNEL_PRIORITIES) prio = KERNEL_PRIORITIES - 1U;
+  uint32_t primask = lock();
+  thread_init(t, name, prio, stack, words);
+  thread_stack(t, fn, arg);
+  make_ready(t);
+  unlock(primask);
+  __ISB();
+}
+
+void kernel_start(kernel_thread_t *t, const char *name, uint32_t prio) {
+  if (prio >= KERNEL_PRIORITIES) prio = KERNEL_PRIORITIES - 1U;
+  uint32_t primask = lock();
+  thread_init(t, name, prio, NULL, 0);
+  t->sp = kernel_port_adopt();
+  t->switches = 1;
+  make_ready(t);
+  current = t;
+  ran_from = cycles_now();
+  started = 1;
+  if ((uint32_t)__builtin_ctz(ready_bits) < prio) pend_switch();
+  unlock(primask);
+  __ISB();
+}
+
+kernel_thread_t *kernel_self(void) {
+  return current;
+}
+
+void kernel_yield(void) {
+  uint32_t primask = lock();
+  kernel_thread_t *t = current;
+  if (started && t->state == KERNEL_READY) {
+    kernel_link_t *r = &ready[t->prio];
+    if (r->next != r->prev) {
+      list_unlink(&t->link);
+      list_insert(r, &t->link);
+      pend_switch();
+    }
+  }
+  unlock(primask);
+  __ISB();
+}
+
+void kernel_sleep(uint32_t ticks) {
+  if (!ticks) {
+    kernel_yield();
+    return;
+  }
+  uint32_t primask = lock();
+  if (can_block(primask)) {
+    block(NULL, ticks, primask);
+    return;
+  }
+  unlock(primask);
+}
+
+void kernel_sleep_until(uint32_t *due, uint32_t period) {
+  uint32_t primask = lock();
+  *due += period;
+  int32_t left = (int32_t)(*due - tick_now());
+  if (left > 0 && can_block(primask)) {
+    block(NULL, (uint32_t)left, primask);
+    return;
+  }
+  unlock(primask);
+}
+
+uint32_t kernel_ticks_to_next(void) {
+  uint32_t n = KERNEL_NEVER;
+  uint32_t primask = lock();
+  if (!list_empty(&sleepers)) {
+    int32_t left = (int32_t)(TIMER_OF(sleepers.next)->wake - tick_now());
+    n = left > 0 ? (uint32_t)left : 0U;
+  }
+  unlock(primask);
+  return n;
+}
+
+void kernel_sem_init(kernel_sem_t *s, uint32_t count, uint32_t max) {
+  list_init(&s->waiters);
+  s->count = count;
+  s->max = max;
+}
+
+kernel_status_t kernel_sem_take(kernel_sem_t *s, uint32_t timeout) {
+  uint32_t primask = lock();
+  if (s->count) {
+    s->count--;
+    unlock(primask);
+    return KERNEL_OK;
+  }
+  if (!timeout || !can_block(primask)) {
+    unlock(primask);
+    return KERNEL_TIMEOUT;
+  }
+  return block(&s->waiters, timeout, primask);
+}
+
+kernel_status_t kernel_sem_give(kernel_sem_t *s) {
+  kernel_status_t r = KERNEL_OK;
+  uint32_t primask = lock();
+  if (!list_empty(&s->waiters)) {
+    wake(THREAD_OF(s->waiters.next), KERNEL_OK);
+  } else if (s->count < s->max) {
+    s->count++;
+  } else {
+    r = KERNEL_FULL;
+  }
+  unlock(primask);
+  return r;
+}
+
+void kernel_queue_init(kernel_queue_t *q, void *buf, uint32_t size, uint32_t len) {
+  list_init(&q->getters);
+  list_init(&q->putters);
+  q->buf = (uint8_t *)buf;
+  q->size = size;
+  q->len = len;
+  q->head = 0;
+  q->count = 0;
+}
+
+kernel_status_t kernel_queue_put(kernel_queue_t *q, const void *item, uint32_t timeout) {
+  uint32_t primask = lock();
+  if (!list_empty(&q->getters)) {
+    kernel_thread_t *t = THREAD_OF(q->getters.next);
+    memcpy(t->item, item, q->size);
+    wake(t, KERNEL_OK);
+  } else if (q->count < q->len) {
+    uint32_t at = q->head + q->count;
+    if (at >= q->len) at -= q->len;
+    memcpy(q->buf + at * q->size, item, q->size);
+    q->count++;
+  } else if (!timeout || !can_block(primask)) {
+    unlock(primask);
+    return KERNEL_TIMEOUT;
+  } else {
+    // Taken straight from here by the kernel_queue_get() that makes room
+    current->item = (void *)(uintptr_t)item;
+    return block(&q->putters, timeout, primask);
+  }
+  unlock(primask);
+  return KERNEL_OK;
+}
+
+kernel_status_t kernel_queue_get(kernel_queue_t *q, void *item, uint32_t timeout) {
+  uint32_t primask = lock();
+  if (q->count) {
+    memcpy(item, q->buf + q->head * q->size, q->size);
+    if (++q->head == q->len) q->head = 0;
+    q->count--;
+    if (!list_empty(&q->putters)) {
+      // The queue was full: the longest waiting item goes in at the tail
+      kernel_thread_t *t = THREAD_OF(q->putters.next);
+      uint32_t at = q->head + q->count;
+      if (at >= q->len) at -= q->len;
+      memcpy(q->buf + at * q->size, t->item, q->size);
+      q->count++;
+      wake(t, KERNEL_OK);
+    }
+  } else if (!timeout || !can_block(primask)) {
+    unlock(primask);
+    return KERNEL_TIMEOUT;
+  } else {
+    current->item = item;
+    return block(&q->getters, timeout, primask);
+  }
+  unlock(primask);
+  return KERNEL_OK;
+}
+
+uint32_t kernel_queue_count(const kernel_queue_t *q) {
+  return q->count;
+}
+
+const kernel_stats_t *kernel_stats(void) {
+  return &stats;
+}
+
+void kernel_reset_stats(void) {
+  uint32_t primask = lock();
+  memset(&stats, 0, sizeof(stats));
+  for (kernel_thread_t *t = threads; t; t = t->next_all) {
+    t->switches = 0;
+    t->cycles = 0;
+  }
+  ran_from = cycles_now();
+  unlock(primask);
+}
+
+// Words at the top of t's stack that have been written
+static uint32_t stack_used(const kernel_thread_t *t) {
+  uint32_t i = 0;
+  while (i < t->stack_words && t->stack[i] == MEMSTAT_PAINT) i++;
+  return t->stack_words - i;
+}
+
+void kernel_report(void) {
+  static const char *const states[] = { "ready", "sleep", "wait", "done" };
+  uint64_t total = 0, running;
+
+  uint32_t primask = lock();
+  running = current->cycles + (cycles_now() - ran_from);
+  for (kernel_thread_t *t = threads; t; t = t->next_all) {
+    total += t == current ? running : t->cycles;
+  }
+  unlock(primask);
+  if (!total) total = 1;
+
+  console_printf("\r\nkernel: %lu switches (%lu at the end of a time slice), worst switch %lu "
+                 "cycles, worst masked %lu cycles\r\n",
+                 (unsigned long)stats.switches, (unsigned long)stats.slices,
+                 (unsigned long)stats.switch_max, (unsigned long)stats.lock_max);
+  console_printf("  %-10s %3s %-6s %9s %7s %s\r\n", "thread", "pri", "state", "switches", "time",
+                 "stack used/words");
+  for (kernel_thread_t *t = threads; t; t = t->next_all) {
+    uint64_t c = t == current ? running : t->cycles;
+    uint32_t permille = (uint32_t)(c * 1000U / total);
+    console_printf("  %-10s %3u %-6s %9lu %3lu.%lu%%", t->name, (unsigned)t->prio,
+                   t == current ? "run" : states[t->state], (unsigned long)t->switches,
+                   (unsigned long)(permille / 10U), (unsigned long)(permille % 10U));
+    if (t->stack) {
+      console_printf(" %5lu/%lu%s\r\n", (unsigned long)stack_used(t),
+                     (unsigned long)t->stack_words,
+                     t->stack[0] != MEMSTAT_PAINT ? " overflowed" : "");
+    } else {
+      console_printf(" %5s\r\n", "main");
+    }
+  }
+}
@@ -0,0 +1,212 @@
+/*
+ * kernel.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Small preemptive kernel: fixed-priority threads on static stacks, with
+ * semaphores and queues that interrupt handlers may signal.
+ *
+ * Priority 0 is the most urgent, as with the NVIC. The most urgent ready
+ * thread always runs; one readied by an interrupt handler runs as soon
+ * as the handler returns. Threads of equal priority take turns, each
+ * running for KERNEL_SLICE_TICKS SysTick periods (tick.h) unless it
+ * blocks first. A bitmap of the priorities with a ready thread picks the
+ * next one in constant time.
+ *
+ * Threads switch in PendSV (PM0253 Rev 5 Sec 2.3.2), at the lowest
+ * interrupt priority, so a switch never delays another handler and
+ * several requests in a row give one switch. Threads run on the process
+ * stack (PSP); handlers keep the main stack. The port (kernel-port.c)
+ * saves r4-r11, and s16-s31 only for a thread that has used the FPU:
+ * the hardware stacks s0-s15 lazily (boot.c sets LSPEN), so a thread
+ * that never touches a float register costs no FPU save at all.
+ *
+ * kernel_start() turns its caller into a thread, so main() carries on
+ * as one after it - typically at the lowest priority, polling and
+ * sleeping as it did before. An idle thread below every priority runs
+ * WFI when nothing else can.
+ *
+ * Waits take a time limit in ticks: 0 never blocks (the only kind that
+ * makes sense in an interrupt handler, or with interrupts masked), and
+ * KERNEL_FOREVER has none. Waiting threads are woken most urgent first,
+ * and in the order they came within a priority.
+ *
+ * The kernel masks interrupts (PRIMASK) around its own bookkeeping only.
+ * Every masked section is bounded - by the number of threads at most,
+ * and for queues by copying one item - and the longest one, which is
+ * what the kernel adds to any interrupt's latency, is measured along
+ * with the longest switch: type 'k'.
+ */
+
+#ifndef KERNEL_H_
+#define KERNEL_H_
+
+#include <stdint.h>
+
+// Thread priorities 0 (most urgent) to KERNEL_PRIORITIES - 1; at most 31
+#ifndef KERNEL_PRIORITIES
+#define KERNEL_PRIORITIES 8U
+#endif
+
+// Ticks a thread runs before another ready at its priority gets a turn
+#ifndef KERNEL_SLICE_TICKS
+#define KERNEL_SLICE_TICKS 5U
+#endif
+
+// The main stack that interrupt handlers use once kernel_start() has
+// moved thread mode onto the process stack
+#ifndef KERNEL_IRQ_STACK_BYTES
+#define KERNEL_IRQ_STACK_BYTES 2048U
+#endif
+
+// The idle thread's stack: one exception frame with the FPU state, and
+// what PendSV saves on top of it
+#ifndef KERNEL_IDLE_STACK_WORDS
+#define KERNEL_IDLE_STACK_WORDS 128U
+#endif
+
+// PendSV: the lowest priority, the same as SysTick's (tick.h)
+#define KERNEL_IRQ_PRIORITY 15U
+
+// No time limit
+#define KERNEL_FOREVER 0xFFFFFFFFUL
+
+// kernel_ticks_to_next(): no thread is waiting for a time
+#define KERNEL_NEVER 0xFFFFFFFFUL
+
+typedef enum {
+  KERNEL_OK = 0,
+  KERNEL_TIMEOUT,  // Not in time, or would have had to wait
+  KERNEL_FULL      // kernel_sem_give() on a semaphore at its maximum
+} kernel_status_t;
+
+typedef enum {
+  KERNEL_READY = 0,  // Running, or able to
+  KERNEL_SLEEPING,   // kernel_sleep()
+  KERNEL_WAITING,    // On a semaphore or queue
+  KERNEL_DONE        // Its function returned
+} kernel_state_t;
+
+typedef void (*kernel_fn_t)(void *arg);
+
+typedef struct kernel_link {
+  struct kernel_link *next;
+  struct kernel_link *prev;
+} kernel_link_t;
+
+typedef struct kernel_thread {
+  kernel_link_t link;        // Ready list, or a wait list; must be first
+  kernel_link_t timer;       // Sleep list while a wait has a time limit
+  void *sp;                  // Saved by the port while switched out
+  const char *name;
+  kernel_fn_t fn;
+  void *arg;
+  uint32_t *stack;           // Lowest word; NULL for kernel_start()'s caller
+  uint32_t stack_words;
+  uint8_t prio;
+  uint8_t state;             // kernel_state_t
+  uint8_t result;            // kernel_status_t of its last wait
+  uint8_t timed;             // On the sleep list
+  uint32_t wake;             // Tick a timed wait ends in
+  uint32_t slice;            // Ticks left of its turn
+  void *item;                // Queue item it is waiting to put or get
+  struct kernel_thread *next_all;
+
+  uint32_t switches;         // Times switched in
+  uint64_t cycles;           // Core clocks it has run for
+} kernel_thread_t;
+
+typedef struct {
+  kernel_link_t waiters;
+  uint32_t count;
+  uint32_t max;
+} kernel_sem_t;
+
+typedef struct {
+  kernel_link_t getters;     // Waiting for an item; only while empty
+  kernel_link_t putters;     // Waiting for room; only while full
+  uint8_t *buf;
+  uint32_t size;             // Of an item, in bytes
+  uint32_t len;              // Items buf holds
+  uint32_t head;             // Oldest item
+  uint32_t count;
+} kernel_queue_t;
+
+typedef struct {
+  uint32_t switches;         // From one thread to another
+  uint32_t slices;           // Of those, turns ended by the time slice
+  uint32_t switch_max;       // Core clocks from a switch being asked for
+                             // to PendSV choosing the next thread
+  uint32_t lock_max;         // Longest the kernel masked interrupts for
+} kernel_stats_t;
+
+// Set up the idle thread and PendSV, and take the SysTick hook. Call
+// after tick_init() and prof_init() (the statistics use the DWT).
+void kernel_init(void);
+
+// Make a thread running fn(arg) at priority prio on stack[0..words).
+// Before kernel_start() it waits for that; after, it runs at once if it
+// is the most urgent. t may be new or a thread whose function has
+// returned; it and the stack must stay valid.
+void kernel_thread_create(kernel_thread_t *t, const char *name, uint32_t prio, uint32_t *stack,
+                          uint32_t words, kernel_fn_t fn, void *arg);
+
+// Start switching threads, with the caller as thread t at priority prio,
+// on the stack it already has. Returns once it is the most urgent ready.
+void kernel_start(kernel_thread_t *t, const char *name, uint32_t prio);
+
+// The running thread (the interrupted one, in a handler)
+kernel_thread_t *kernel_self(void);
+
+// Let any other thread ready at this priority run
+void kernel_yield(void);
+
+// Block for `ticks` SysTick periods; 0 yields
+void kernel_sleep(uint32_t ticks);
+
+// Block until tick *due + period, and advance *due to it: a period that
+// does not drift with the time the thread takes. Set *due to tick_now()
+// to begin with. Returns at once if that tick is already past, so a
+// thread that falls behind runs its missed periods back to back.
+void kernel_sleep_until(uint32_t *due, uint32_t period);
+
+// Ticks until the next timed wait ends: 0 if one is due, KERNEL_NEVER
+// if none. For choosing how deeply to sleep (power.h).
+uint32_t kernel_ticks_to_next(void);
+
+// Counting semaphore holding count, at most max
+void kernel_sem_init(kernel_sem_t *s, uint32_t count, uint32_t max);
+
+// Take one, waiting up to `timeout` ticks for it
+kernel_status_t kernel_sem_take(kernel_sem_t *s, uint32_t timeout);
+
+// Give one: to the most urgent waiter, if any. Safe in a handler.
+kernel_status_t kernel_sem_give(kernel_sem_t *s);
+
+// Queue of `len` items of `size` bytes in buf (size * len bytes). Items
+// are copied in and out with interrupts masked: keep them small.
+void kernel_queue_init(kernel_queue_t *q, void *buf, uint32_t size, uint32_t len);
+
+// Copy an item in, waiting up to `timeout` ticks for room. A thread
+// waiting to get one has it copied straight to it. Safe in a handler
+// with a timeout of 0.
+kernel_status_t kernel_queue_put(kernel_queue_t *q, const void *item, uint32_t timeout);
+
+// Copy the oldest item out, waiting up to `timeout` ticks for one. Safe
+// in a handler with a timeout of 0.
+kernel_status_t kernel_queue_get(kernel_queue_t *q, void *item, uint32_t timeout);
+
+uint32_t kernel_queue_count(const kernel_queue_t *q);
+
+const kernel_stats_t *kernel_stats(void);
+
+// Clear the statistics, and every thread's switches and run time
+void kernel_reset_stats(void);
+
+// console_printf() each thread's state, share of the time and stack use,
+// and the worst switch and masked times. A thread's time includes any
+// it spent sleeping in WFI itself, as main() does in power_idle().
+void kernel_report(void);
+
+#endif /* KERNEL_H_ */
@@ -0,0 +1,121 @@
+/*
+ * loader.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See loader.h. Runs straight out of reset: the clock is the 16MHz HSI,
+ * the caches are off, and only the stack (from its own vector table) is
+ * set up. Every function here is LOADER_CODE, and everything it uses is
+ * either in registers, on the stack, or in flash at a fixed address.
+ *
+ * CRCs are the CRC unit's, set up as crc.c does it, over whole words:
+ * image sizes are multiples of 4, so no software tail is needed.
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "flash.h"
+#include "loader.h"
+#include "sections.h"
+#include "update.h"
+
+#define LOADER_SIZE 0x4000U
+
+// Where the application's stack and reset handler may be
+#define RAM_START 0x20000000UL
+#define RAM_END   0x20080000UL
+
+extern uint32_t _estack[];
+
+typedef void (*loader_vector_t)(void);
+
+// Just the two words the core reads at reset; nothing else is enabled
+// while the loader runs
+LOADER_VECTORS const loader_vector_t loader_vectors[2] = {
+  (loader_vector_t)_estack,
+  loader_reset,
+};
+
+LOADER_CODE static uint32_t loader_crc(const uint32_t *p, uint32_t words) {
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_CRCEN);
+  (void)RCC->AHB1ENR;
+  CRC->INIT = 0xFFFFFFFFUL;
+  CRC->POL = 0x04C11DB7UL;
+  CRC->CR = CRC_CR_REV_IN | CRC_CR_REV_OUT | CRC_CR_RESET;
+  for (uint32_t i = 0; i < words; i++) CRC->DR = p[i];
+  return ~(uint32_t)CRC->DR;
+}
+
+// The first two words of a vector table could start an application
+LOADER_CODE static int plausible(uint32_t base) {
+  const uint32_t *v = (const uint32_t *)(uintptr_t)(base + UPDATE_APP_OFFSET);
+  uint32_t app = 0x08000000UL + UPDATE_APP_OFFSET;
+  return v[0] > RAM_START && v[0] <= RAM_END && !(v[0] & 3U) &&
+         (v[1] & 1U) && v[1] >= app && v[1] < app + UPDATE_APP_MAX;
+}
+
+// Returns 1 and the sequence number if the bank at base can be run
+LOADER_CODE static int valid(uint32_t base, int factory_ok, uint32_t *seq) {
+  const update_desc_t *d = (const update_desc_t *)(uintptr_t)(base + UPDATE_DESC_OFFSET);
+
+  if (d->magic == 0xFFFFFFFFUL) {
+    *seq = 0;
+    return factory_ok && plausible(base);
+  }
+  if (d->magic != UPDATE_MAGIC) return 0;
+  if (loader_crc(&d->magic, 4) != d->desc_crc) return 0;
+  if (!d->size || d->size > UPDATE_APP_MAX || (d->size & 3U)) return 0;
+  if (loader_crc((const uint32_t *)(uintptr_t)(base + UPDATE_APP_OFFSET), d->size / 4U) != d->crc) return 0;
+  *seq = d->seq;
+  return plausible(base);
+}
+
+LOADER_CODE static int same_loader(void) {
+  const uint32_t *a = (const uint32_t *)(uintptr_t)0x08000000UL;
+  const uint32_t *b = (const uint32_t *)(uintptr_t)FLASH_INACTIVE_BASE;
+  for (uint32_t i = 0; i < LOADER_SIZE / 4U; i++) {
+    if (a[i] != b[i]) return 0;
+  }
+  return 1;
+}
+
+LOADER_CODE loader_bank_t loader_select(void) {
+  uint32_t seq1 = 0, seq2 = 0;
+  int ok1 = valid(0x08000000UL, 1, &seq1);
+  int ok2 = valid(FLASH_INACTIVE_BASE, 0, &seq2) && same_loader();
+
+  if (ok2 && (!ok1 || (int32_t)(seq2 - seq1) > 0)) {
+    // RM0410 Rev 5 Sec 3.3.1 and 7.2.1: bank 2 at 0x08000000. The ART
+    // may hold bank 1's lines: reset it, which needs it off.
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_SYSCFGEN);
+    (void)RCC->APB2ENR;
+    SET_BIT(SYSCFG->MEMRMP, SYSCFG_MEMRMP_SWP_FB);
+    __DSB();
+    __ISB();
+    CLEAR_BIT(FLASH->ACR, FLASH_ACR_ARTEN);
+    SET_BIT(FLASH->ACR, FLASH_ACR_ARTRST);
+    CLEAR_BIT(FLASH->ACR, FLASH_ACR_ARTRST);
+    return LOADER_BANK2;
+  }
+  return ok1 ? LOADER_BANK1 : LOADER_NONE;
+}
+
+LOADER_CODE void loader_reset(void) {
+  const uint32_t *app = (const uint32_t *)(uintptr_t)(0x08000000UL + UPDATE_APP_OFFSET);
+
+  // Nothing to run: wait for a debugger
+  if (loader_select() == LOADER_NONE) {
+    for (;;) __WFI();
+  }
+  SCB->VTOR = (uint32_t)(uintptr_t)app;
+  __set_MSP(app[0]);
+  __DSB();
+  __ISB();
+  ((loader_vector_t)(uintptr_t)app[1])();
+  for (;;) {}
+}
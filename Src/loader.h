@@ -0,0 +1,46 @@
+/*
+ * loader.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * The resident loader: what runs at reset, from flash sector 0 of bank 1
+ * (its own LOADER region in STM32F767ZITX_FLASH.ld), to pick which bank's
+ * application to start. See update.h for the bank layout.
+ *
+ * A bank is valid if its descriptor (update_desc_t) has the magic number
+ * and a good CRC, and its image has the CRC the descriptor gives. Bank 1
+ * with no descriptor at all (flash erased there) but a plausible vector
+ * table is taken as valid with sequence number 0: that is an image put
+ * there with a debugger. Bank 2 is chosen only if it is valid, newer than
+ * bank 1 (or bank 1 is not valid) and has the same loader in its sector
+ * 0; then SYSCFG->MEMRMP SWP_FB maps it at FLASHAXI_BASE. The loader
+ * keeps running straight through the swap, which is why the loader
+ * sectors must match.
+ *
+ * It then points VTOR and MSP at the application's vector table at
+ * FLASHAXI_BASE + UPDATE_APP_OFFSET and jumps to its reset handler.
+ *
+ * Nothing in it may use .data, .bss or .rodata, or call the
+ * application's code: those are in the sectors an update rewrites.
+ */
+
+#ifndef LOADER_H_
+#define LOADER_H_
+
+#include <stdint.h>
+
+typedef enum {
+  LOADER_NONE = 0,  // Neither bank holds a valid image
+  LOADER_BANK1,
+  LOADER_BANK2      // Swapped in
+} loader_bank_t;
+
+// Pick the bank to run and swap it in if that is bank 2. The host
+// simulation calls this directly, as a reset would.
+loader_bank_t loader_select(void);
+
+// The reset vector: loader_select() then start the application
+void loader_reset(void) __attribute__((noreturn));
+
+#endif /* LOADER_H_ */
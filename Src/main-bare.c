@@ -42,6 +42,12 @@ limitations under the License.
 
 #include <stdint.h>
 
+// The SysTick time base and the scheduler are built on the CMSIS headers;
+// only this file sticks to raw addresses
+#include "clock.h"
+#include "sched.h"
+#include "tick.h"
+
 // Create a variable/register we can assign/read from an address
 #define MAKE_REG(ADDR) (*(volatile unsigned int *)(ADDR))
 
@@ -144,6 +150,28 @@ limitations under the License.
 
 
 
+#define BLINK_MS 500U
+
+static sched_timer_t blink_timer;
+
+// Turn on and off an LED, one LED per call
+static void blink(void *arg) {
+  static unsigned int cur = 0;
+  static unsigned int pin = 0;
+  const unsigned int num_pins = 3;
+  (void)arg;
+
+  switch (pin) {
+    case 0: ODR_PIN_SET(GPIOB_ODR_R, GREEN_PIN_B, cur); break;
+    case 1: ODR_PIN_SET(GPIOB_ODR_R, BLUE_PIN_B,  cur); break;
+    case 2: ODR_PIN_SET(GPIOB_ODR_R, RED_PIN_B,   cur); break;
+    default: break;
+  }
+  cur = ~cur;
+  pin++;
+  if (pin >= num_pins) pin = 0;
+}
+
 int main() {
 
   // Enable clock access to GPIO Port B
@@ -154,24 +182,13 @@ int main() {
   MODER_PIN_SET(GPIOB_MODER_R, BLUE_PIN_B,  MODER_OUTPUT);
   MODER_PIN_SET(GPIOB_MODER_R, RED_PIN_B,   MODER_OUTPUT);
 
-  // Turn on and off an LED with busy waiting.
-  unsigned int cur = 0;
-  unsigned int pin = 0;
-  const unsigned int num_pins = 3;
-  while (1) {
-    switch (pin) {
-      case 0: ODR_PIN_SET(GPIOB_ODR_R, GREEN_PIN_B, cur); break;
-      case 1: ODR_PIN_SET(GPIOB_ODR_R, BLUE_PIN_B,  cur); break;
-      case 2: ODR_PIN_SET(GPIOB_ODR_R, RED_PIN_B,   cur); break;
-      default: break;
-    }
-    cur = ~cur;
-    pin++;
-    if (pin >= num_pins) pin = 0;
-    for (unsigned int i = 0; i < 1 * 1000 * 1000; i++);
-    // The default clock must be very slow as this busy loop
-    // causes like a 0.5Hz blink.
-  }
+  // Step the LEDs every BLINK_MS from SysTick, sleeping in between.
+  // (This used to be a 1,000,000 iteration busy loop, whose speed
+  // depended on the optimization level: about 0.5Hz at 16MHz.)
+  tick_init(clock_hclk_hz());
+  sched_init();
+  sched_start(&blink_timer, "blink", TICK_MS(BLINK_MS), TICK_MS(BLINK_MS), blink, 0);
+  sched_loop();
 
   return 0; // Required by C convention, but this should never return.
 }
@@ -42,6 +42,10 @@ limitations under the License.
 //   (Several others were already defined, e.g. STM32F767ZITx)
 #include "stm32f7xx.h"
 
+#include "clock.h"
+#include "sched.h"
+#include "tick.h"
+
 // Define our pins
 
 #define GPIOB_CLK_EN      (1UL << 1) // Bit 1 of RCC_AHB1ENR_R - see page 185 of RM
@@ -58,6 +62,20 @@ limitations under the License.
 #define USER_LED2       (1U <<  BLUE_PIN_B)
 #define USER_LED3       (1U <<   RED_PIN_B)
 
+#define BLINK_MS 500U
+
+static sched_timer_t blink_timer;
+
+// Alternately set and reset the LEDs: BSRR needs no read-modify-write
+static void blink(void *arg) {
+  static int on;
+  (void)arg;
+
+  on = !on;
+  if (on) GPIOB->BSRR = USER_LED1 | USER_LED2 | USER_LED3; // Turn LEDs on
+  else    GPIOB->BSRR = (USER_LED1 | USER_LED2 | USER_LED3) << 16; // Turn LEDs off
+}
+
 int main(void) {
   // Enable clock access to Port B
   RCC->AHB1ENR |= GPIOB_CLK_EN;
@@ -66,14 +84,11 @@ int main(void) {
 
   GPIOB->MODER |= USER_LED1_MODER | USER_LED2_MODER | USER_LED3_MODER;
 
-  while (1) {
-    // Toggle LEDs
-
-    GPIOB->BSRR = USER_LED1 | USER_LED2 | USER_LED3; // Turn LEDs on
-    for (int i = 0; i < 1000000; i++);
-
-    GPIOB->BSRR = (USER_LED1 | USER_LED2 | USER_LED3) << 16; // Turn LEDs off
-    for (int i = 0; i < 1000000; i++);
-  }
+  // Toggle LEDs from the SysTick scheduler and sleep in between,
+  // rather than busy-waiting for a time that depends on -O level
+  tick_init(clock_hclk_hz());
+  sched_init();
+  sched_start(&blink_timer, "blink", TICK_MS(BLINK_MS), TICK_MS(BLINK_MS), blink, 0);
+  sched_loop();
 }
 #endif
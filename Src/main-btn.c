@@ -42,59 +42,101 @@ limitations under the License.
 //   (Several others were already defined, e.g. STM32F767ZITx)
 #include "stm32f7xx.h"
 
+#include "button.h"
+#include "clock.h"
+#include "critical.h"
+#include "power.h"
+#include "prof.h"
+#include "sched.h"
+#include "tick.h"
+
 // Define our pins
 
 // Clock enable bits
 #define GPIOB_CLK_EN      (1UL << 1) // Bit 1 of RCC_AHB1ENR_R - see page 185 of RM
-#define GPIOC_CLK_EN      (1UL << 2) // Bit 2 of RCC_AHB1ENR_R - see page 185 of RM
 
 // Blue button is a user input
 // Per Nucleo user guide, it's PC13 (UM1974 Rev 10 p24 sec 6.6)
-// Per Datasheet, this is also on AHB1
-// Per RM, we can set the GPIOC
-// IDR - input data register - lower 16 bits
+// button.c looks after it: EXTI13 tells us when it changes, and TIM7
+// times the debounce, so nothing here polls it
 
 // Pin numbers in a bank
 #define GREEN_PIN_B 0
 #define BLUE_PIN_B  7
 #define RED_PIN_B   14
-#define USER_BTN_B  13
 
 // Mode registers
 #define USER_LED1_MODER (1U << (GREEN_PIN_B * 2)) // Output
 #define USER_LED2_MODER (1U << ( BLUE_PIN_B * 2))
 #define USER_LED3_MODER (1U << (  RED_PIN_B * 2))
-#define USER_BTN_MODER  (~(3U << (USER_BTN_B * 2))) // Input
 
 // Output registers
 #define USER_LED1       (1U << GREEN_PIN_B)
 #define USER_LED2       (1U <<  BLUE_PIN_B)
 #define USER_LED3       (1U <<   RED_PIN_B)
+#define USER_LEDS       (USER_LED1 | USER_LED2 | USER_LED3)
+
+#define BLINK_MS  500U
+
+static sched_timer_t blink_timer;
+static int blinking = 1;
+
+// TIM7 debouncing would freeze in Stop mode
+static const power_busy_t stop_busy[] = { button_busy };
+
+static void leds(int on) {
+  if (on) GPIOB->BSRR = USER_LEDS; // Turn LEDs on
+  else    GPIOB->BSRR = USER_LEDS << 16; // Turn LEDs off
+}
+
+// Toggle LEDs when button not pushed
+static void blink(void *arg) {
+  static int on;
+  (void)arg;
 
-// Input registers
-#define USER_BTN        (1U << USER_BTN_B)
+  if (!blinking || button_down()) return;
+  on = !on;
+  leds(on);
+}
+
+// LEDs on as soon as the button goes down; a long press stops or
+// restarts the blinking. Type 'p' on a console build to see how long
+// events waited for us (button_react).
+static void react(const button_event_t *ev) {
+  if (ev->type == BUTTON_PRESS) {
+    leds(1);
+  } else if (ev->type == BUTTON_RELEASE) {
+    if (!blinking) leds(0);
+  } else if (ev->type == BUTTON_LONG_PRESS) {
+    blinking = !blinking;
+  }
+}
 
 int main(void) {
-  // Enable clock access to Ports B & C
-  RCC->AHB1ENR |= GPIOB_CLK_EN | GPIOC_CLK_EN;
+  button_event_t ev;
+
+  // Enable clock access to Port B (button.c does Port C)
+  RCC->AHB1ENR |= GPIOB_CLK_EN;
 
   // Configure LED pins as output pins
   GPIOB->MODER |= USER_LED1_MODER | USER_LED2_MODER | USER_LED3_MODER;
 
-  // Configure button pin as input pin
-  GPIOC->MODER &= USER_BTN_MODER;
-
-  while (1) {
-    // Toggle LEDs when button not pushed
-    if (!(GPIOC->IDR & USER_BTN)) {
-      GPIOB->BSRR = USER_LED1 | USER_LED2 | USER_LED3; // Turn LEDs on
-      for (int i = 0; i < 1000000; i++);
-    }
-
-    if (!(GPIOC->IDR & USER_BTN)) {
-      GPIOB->BSRR = (USER_LED1 | USER_LED2 | USER_LED3) << 16; // Turn LEDs off
-      for (int i = 0; i < 1000000; i++);
-    }
+  prof_init();
+  tick_init(clock_hclk_hz());
+  sched_init();
+  button_init();
+  sched_start(&blink_timer, "blink", TICK_MS(BLINK_MS), TICK_MS(BLINK_MS), blink, 0);
+  power_init(stop_busy, sizeof(stop_busy) / sizeof(stop_busy[0]), 0);
+
+  // Stop until the next blink or a button edge; Sleep while the button
+  // is being debounced
+  for (;;) {
+    sched_run();
+    while (button_get(&ev)) react(&ev);
+    uint32_t primask = critical_enter();
+    uint32_t next = sched_ticks_to_next();
+    if (!button_pending() && next) power_idle(POWER_STOP, next);
+    critical_exit(primask);
   }
 }
 #endif
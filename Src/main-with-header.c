@@ -42,6 +42,10 @@ limitations under the License.
 //   (Several others were already defined, e.g. STM32F767ZITx)
 #include "stm32f7xx.h"
 
+#include "clock.h"
+#include "sched.h"
+#include "tick.h"
+
 // Define our pins
 
 #define GPIOB_CLK_EN      (1UL << 1) // Bit 1 of RCC_AHB1ENR_R - see page 185 of RM
@@ -58,6 +62,16 @@ limitations under the License.
 #define USER_LED2       (1U <<  BLUE_PIN_B)
 #define USER_LED3       (1U <<   RED_PIN_B)
 
+#define BLINK_MS 500U
+
+static sched_timer_t blink_timer;
+
+static void blink(void *arg) {
+  (void)arg;
+  // Toggle LEDs
+  GPIOB->ODR ^= USER_LED1 | USER_LED2 | USER_LED3;
+}
+
 int main(void) {
   // Enable clock access to Port B
   RCC->AHB1ENR |= GPIOB_CLK_EN;
@@ -68,11 +82,9 @@ int main(void) {
   // Set initial ones
   GPIOB->ODR ^= USER_LED2;
 
-  while (1) {
-    // Toggle LEDs
-    GPIOB->ODR ^= USER_LED1 | USER_LED2 | USER_LED3;
-
-    for (int i = 0; i < 1000000; i++);
-  }
+  tick_init(clock_hclk_hz());
+  sched_init();
+  sched_start(&blink_timer, "blink", TICK_MS(BLINK_MS), TICK_MS(BLINK_MS), blink, 0);
+  sched_loop();
 }
 #endif
@@ -30,7 +30,6 @@ limitations under the License.
 */
 
 #include <stdint.h>
-#include <stdio.h>
 
 // We need to set include files from STM32CubeF7
 //   Project -> Properties -> C/C++ General -> Paths and Symbols
@@ -47,11 +46,31 @@ limitations under the License.
 #include "nucleo-clk.h"
 #include "nucleo-uart.h"
 
-#define GPIO_ALTERNATE_MODE (0x2U)
+#include "baud.h"
+#include "boot.h"
+#include "button.h"
+#include "capture.h"
+#include "clock.h"
+#include "cmd.h"
+#include "console.h"
+#include "critical.h"
+#include "cycles.h"
+#include "dsp-bench.h"
+#include "fmt-bench.h"
+#include "kernel.h"
+#include "memstat.h"
+#include "pool.h"
+#include "power.h"
+#include "prof.h"
+#include "sections.h"
+#include "tcm-bench.h"
+#include "tick.h"
+#include "trace.h"
+#include "uart.h"
+#include "update.h"
+#include "wave.h"
 
-#define UART_DATA_8     (0x0UL)
-#define UART_PARTY_NONE (0x0UL)
-#define UART_STOPBITS_1 (0x0UL)
+#define GPIO_ALTERNATE_MODE (0x2U)
 
 // TODO: Make these inline non-extern (compiled) functions
 // Enable one or more peripheral clocks on AHB1
@@ -78,6 +97,8 @@ void set_abp2_periph_clk(uint32_t periphs) {
 
 // Sets the mode of an I/O pin
 void set_pin_mode(GPIO_TypeDef *gpiox, uint32_t pin_num, uint32_t mode) {
+  PROF_SCOPE(set_pin_mode);
+
   // Clear relevant bits in mode register
   gpiox->MODER &= ~(3U << (2 * pin_num));
   // Set the relevant bits in the mode register
@@ -87,157 +108,333 @@ void set_pin_mode(GPIO_TypeDef *gpiox, uint32_t pin_num, uint32_t mode) {
   // MODIFY_REG(gpiox->MODER, (3U << (2 * pin_num)), mode << (2 * pin_num));
 }
 
-// Configures the control registers for a U(S)ART
-// BUT the values must be the masked bits to set for PS, PCE, M and STOP, not the logical values!!
-// (in other words, this is a stupid function that requires you to know the STM bits to set)
-void config_uart_params(USART_TypeDef *usartx, uint32_t data_width, uint32_t parity, uint32_t stop_bits) {
-  // The bits are defined in the STM header file
-  // M is two non-contiguous bits!
-  MODIFY_REG(usartx->CR1, USART_CR1_PS | USART_CR1_PCE | USART_CR1_M, parity | data_width);
-  MODIFY_REG(usartx->CR2, USART_CR2_STOP, stop_bits);
-}
-
-uint16_t compute_uart_divider(uint32_t periph_clk, uint32_t desired_rate) {
-  // round by adding half of a desired rate.
-  // FIXME: handle 32 -> 16 bit conversion explicitly
-  return (uint16_t)((periph_clk + (desired_rate / 2U)) / desired_rate);
-}
-
-void set_uart_baud_rate(USART_TypeDef *usartx, uint32_t periph_clk, uint32_t baud_rate) {
-  usartx->BRR = compute_uart_divider(periph_clk, baud_rate);
-}
+// USART3 is the uart.c USART3 port; the console (console.c) adds the
+// interrupt-driven side with console_init()
 
-// Enable the receiver and/or transmitter of the U(S)ART
-// RM0410 Rev 5 Sec 34.8.1 p 1276
-// Bits 3:2 TE:RE
-void set_uart_transfer_enable(USART_TypeDef *usartx, int tx, int rx) {
-  uint32_t t = 0;
-  if (tx) t |= USART_CR1_TE;
-  if (rx) t |= USART_CR1_RE;
-  MODIFY_REG(usartx->CR1, USART_CR1_RE | USART_CR1_TE, t);
-}
-
-// This function much improved in uart3_rxtx_init()
+// Transmit only: the receiver is left off
 void uart3_tx_init(void) {
-  // Enable clock access for USART3 on GPIOD
-  set_ahb1_periph_clk(GPIOD_CLK_EN);
-
-  // Set PD8 mode to USART3 TX alternate function
-  set_pin_mode(GPIOD, USART3_TX_PIN_D, GPIO_ALTERNATE_MODE);
-
-  // Set the alternate function for pin 8 on GPIOD to AF7
-  // Index 0 = AFR low; 1 = AFR high
-  GPIOD->AFR[1] &= ~(0xFUL << 0);
-  GPIOD->AFR[1] |=  (0x7UL << 0);
-
-  // Turn on our UART clock
-  set_apb1_periph_clk(USART3_CLK_EN);
-
-  // Configure USART: 8 N 1
-  config_uart_params(USART3, UART_DATA_8, UART_PARTY_NONE, UART_STOPBITS_1);
-
-  // Configure speed: 115,200 baud
-  // Note: Default clock speed is 16MHz
-  set_uart_baud_rate(USART3, 16000000, 115200);
-
-  // Enable the USART module: RM0410 Rev 5 p 1279
-  USART3->CR1 |= USART_CR1_UE;
-
-  // And enable transmission
+  uart_open(uart_port(UART_USART3), 115200);
   set_uart_transfer_enable(USART3, 1, 0); // tx only
 }
 
+// Baud rate error from the last uart3_rxtx_init(), for reporting once
+// the console is up
+static int32_t uart3_baud_error_ppm;
 
-// Configure the USART3 with RX and TX
+// Configure the USART3 with RX and TX: 8N1 at 115,200 baud from whatever
+// APB1 is running at (16MHz out of reset, 54MHz after clock_init()),
+// PD8/PD9 on AF7
 void uart3_rxtx_init(void) {
+  uart3_baud_error_ppm = uart_open(uart_port(UART_USART3), 115200);
+}
 
-  // Enable clock access for USART3 on GPIOD
-  set_ahb1_periph_clk(GPIOD_CLK_EN);
-
-  // Set up TX pin
-  // Set PD8 mode to USART3 TX alternate function
-  set_pin_mode(GPIOD, USART3_TX_PIN_D, GPIO_ALTERNATE_MODE);
-
-  // Set the alternate function for pin 8 on GPIOD to AF7
-  // Index 0 = AFR low; 1 = AFR high
-  int afr = USART3_TX_PIN_D >= 8 ? 1 : 0;
-  int shift = (USART3_TX_PIN_D - 8 * afr) * 4;
-  GPIOD->AFR[afr] &= ~(0xFUL << shift);  // Clear the 4 AFR bits
-  GPIOD->AFR[afr] |=  (0x7UL << shift);  // And set them to 0x7
+// In ITCM so the TXE poll loop runs zero-wait-state
+ITCM_CODE void uart_write(USART_TypeDef *usartx, uint8_t val) {
+  // Ensure transmit data register is empty - "TXE"
+  // If it's 1, the transmit is empty.
+  // How long we wait is the uart_tx_wait probe: up to a whole 10 bit
+  // frame, which at 115,200 baud is ~18,750 cycles at 216MHz
+  PROF_BEGIN(uart_tx_wait);
+  while (!(usartx->ISR & USART_ISR_TXE));
+  PROF_END(uart_tx_wait);
 
-  // Set up RX pin PD9: alternate function, and
-  set_pin_mode(GPIOD, USART3_RX_PIN_D, GPIO_ALTERNATE_MODE);
+  // Write the value into the transmit data register
+  usartx->TDR = val;
+}
 
-  afr = USART3_RX_PIN_D >= 8 ? 1 : 0;
-  shift = (USART3_RX_PIN_D - 8 * afr) * 4;
-  GPIOD->AFR[afr] &= ~(0xFUL << shift);  // Clear the 4 AFR bits
-  GPIOD->AFR[afr] |=  (0x7UL << shift);  // And set them to 0x7 for alternate function 7
 
-  // Turn on our UART clock
-  set_apb1_periph_clk(USART3_CLK_EN);
+// console_printf() formats straight into the USART3 transmit ring, which
+// the USART3 interrupt drains; printf() still works through _write().
+// uart_write() remains as the simple polled path.
 
-  // Configure USART: 8 N 1
-  config_uart_params(USART3, UART_DATA_8, UART_PARTY_NONE, UART_STOPBITS_1);
 
-  // Configure speed: 115,200 baud
-  // Note: Default clock speed is 16MHz
-  set_uart_baud_rate(USART3, 16000000, 115200);
+// Polled read. Do not use this on USART3 after console_init(): the console
+// interrupt takes every byte - use uart_try_read() or getchar() instead.
+uint8_t uart_read(USART_TypeDef *usartx) {
+  // Wait for read data register not empty - it will become 1
+  while (!(usartx->ISR & USART_ISR_RXNE));
 
-  // Enable the USART module: RM0410 Rev 5 p 1279
-  USART3->CR1 |= USART_CR1_UE;
+  // Read the receive data register and mask it to a byte
+  return READ_BIT(usartx->RDR, USART_RDR_RDR) & 0xFFUL;
+}
 
-  // And enable transmission
-  set_uart_transfer_enable(USART3, 1, 1); // tx & rx
+// Chase the three LEDs round from a table played by TIM8 and DMA2, or
+// stop it: the CPU does nothing for it but one interrupt per pass
+static void wave_demo(void) {
+  static const uint32_t green[] = { 2 };
+  static const uint32_t blue[] = { 2, 4 };
+  static const uint32_t red[] = { 4 };
+  static const wave_pin_t pins[] = {
+    { GREEN_PIN_B, 1, green, 1 },
+    { BLUE_PIN_B, 0, blue, 2 },
+    { RED_PIN_B, 0, red, 1 },
+  };
+  static uint32_t table[6];
+
+  if (wave_busy()) {
+    wave_stop();
+    console_printf("wave: stopped after %lu passes\r\n", (unsigned long)wave_stats()->passes);
+    return;
+  }
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_GPIOBEN);
+  for (uint32_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++) {
+    MODIFY_REG(GPIOB->MODER, 3UL << (2U * pins[i].pin), 1UL << (2U * pins[i].pin));
+  }
+  wave_compile(table, 6, pins, 3);
+  console_printf("wave: %lu steps/s\r\n", (unsigned long)wave_start(table, 6, 4, WAVE_CIRCULAR));
 }
 
-int uart_write(USART_TypeDef *usartx, uint8_t val) {
-  // Ensure transmit data register is empty - "TXE"
-  // If it's 1, the transmit is empty
+// Record the three LEDs at 1 MHz from their first edge until the next
+// 'l' (type 'w' to set them going), or stop: Sim/capture-vcd writes the
+// frames to a VCD file
+static void capture_demo(void) {
+  static const uint16_t leds = (1U << GREEN_PIN_B) | (1U << BLUE_PIN_B) | (1U << RED_PIN_B);
+  const capture_config_t cfg = { GPIOB, leds, leds, leds, 1000000U, 1000U, 0 };
 
-  // the compiler optimizes this away as a "register int"
-  // but not as an "int" or a "volatile register int",
-  // and not if you return it
-  register int x = 0;
+  if (capture_busy()) {
+    capture_stop();
+    return;
+  }
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_GPIOBEN);
+  if (!capture_start(&cfg)) console_printf("capture: cannot sample at 1 MHz\r\n");
+}
 
-  // I am immensely curious what x is. It presumably is related to however
-  // many instructions/clocks this takes per iteration and the divider
-  // (which is 16,000,000 / 115,200 ~~ 138 to 139
-  while (!(usartx->ISR & USART_ISR_TXE)) x++;
+// Command 0x10: payload bit 0 green, bit 1 blue, bit 2 red; a set bit
+// turns the LED on, a clear one off
+static cmd_status_t cmd_leds(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len) {
+  static const uint32_t leds[] = { USER_LED1, USER_LED2, USER_LED3 };
+  uint32_t on = 0, off = 0;
+
+  (void)resp;
+  (void)resp_len;
+  if (req->payload[0] & ~7U) return CMD_ERR_ARG;
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_GPIOBEN);
+  MODIFY_REG(GPIOB->MODER, (3UL << (2U * GREEN_PIN_B)) | (3UL << (2U * BLUE_PIN_B)) | (3UL << (2U * RED_PIN_B)),
+             USER_LED1_MODER | USER_LED2_MODER | USER_LED3_MODER);
+  for (uint32_t i = 0; i < 3; i++) {
+    if (req->payload[0] & (1U << i)) on |= leds[i];
+    else                             off |= leds[i];
+  }
+  GPIOB->BSRR = on | (off << 16);
+  return CMD_OK;
+}
 
-  // Write the value into the transmit data register
-  usartx->TDR = val;
+// Framed commands on the console line (cmd.h); Sim/cmd-host.h speaks them
+static const cmd_entry_t commands[] = {
+  { 0x01, 0, CMD_PAYLOAD_MAX, "ping", cmd_ping },
+  { 0x02, 0, 0, "stats", cmd_get_stats },
+  { 0x10, 1, 1, "leds", cmd_leds },
+  { UPDATE_CMD_BEGIN, 12, 13, "update-begin", update_begin },
+  { UPDATE_CMD_DATA, 5, CMD_PAYLOAD_MAX, "update-data", update_data },
+  { UPDATE_CMD_END, 0, 1, "update-end", update_end },
+  { BAUD_CMD_PROPOSE, 4, 4, "baud-propose", baud_propose },
+  { BAUD_CMD_VERIFY, BAUD_PATTERN_LEN, BAUD_PATTERN_LEN, "baud-verify", baud_verify },
+  { BAUD_CMD_COMMIT, 0, 0, "baud-commit", baud_commit },
+};
+
+// Stop would freeze these part way
+static const power_busy_t stop_busy[] = {
+  console_tx_busy, wave_busy, update_busy, capture_busy, button_busy, baud_busy
+};
+
+// Kernel threads (kernel.h). The console is main() itself, at the lowest
+// priority; the control loop and the button run above it, so a long
+// console command ('c', 'b', 'f') holds neither of them up. Type 'k' for
+// their share of the time and the kernel's worst switch and masked times.
+#define CONTROL_PRIORITY 1U
+#define BUTTON_PRIORITY  2U
+#define CONSOLE_PRIORITY 3U
+#define CONTROL_PERIOD   TICK_MS(10U)
+
+static kernel_thread_t console_thread, control_thread, button_thread;
+static uint32_t control_stack[256], button_stack[256];
+static kernel_sem_t button_sem;
+
+// Button events for the console thread to print
+static button_event_t console_events_buf[8];
+static kernel_queue_t console_events;
+
+// How late the control loop ran: core clocks from the start of its tick
+static uint32_t control_runs, control_late_max;
+
+// A fixed-period control loop: the place for reading sensors and driving
+// outputs on time, whatever the console is doing
+static void control_main(void *arg) {
+  uint32_t due = tick_now();
+
+  (void)arg;
+  for (;;) {
+    kernel_sleep_until(&due, CONTROL_PERIOD);
+    uint32_t late = tick_cycles_since(due);
+    if (late > control_late_max) control_late_max = late;
+    control_runs++;
+  }
+}
 
-  return x;
+static void button_wake(void) {
+  kernel_sem_give(&button_sem);
 }
 
+// Hands each button event to the console as soon as its handler has run
+static void button_main(void *arg) {
+  button_event_t ev;
 
-// To enable printf to send via our "console" port, we need
-// to implement this function
-int __io_putchar(int ch) {
-  uart_write(USART3, (uint8_t)ch);
-  return ch;
+  (void)arg;
+  button_set_notify(button_wake);
+  button_init();
+  for (;;) {
+    kernel_sem_take(&button_sem, KERNEL_FOREVER);
+    while (button_get(&ev)) kernel_queue_put(&console_events, &ev, 0);
+  }
 }
 
+static void print_button_event(const button_event_t *ev) {
+  static const char *const names[] = { "?", "press", "release", "long press" };
+  console_printf("button: %s, %lu us ago\r\n", names[ev->type < 4U ? ev->type : 0U],
+                 (unsigned long)((cycles_now() - ev->cycles) / (clock_hclk_hz() / 1000000U)));
+}
 
-uint8_t uart_read(USART_TypeDef *usartx) {
-  // Wait for read data register not empty - it will become 1
-  while (!(usartx->ISR & USART_ISR_RXNE));
-
-  // Read the receive data register and mask it to a byte
-  return READ_BIT(usartx->RDR, USART_RDR_RDR) & 0xFFUL;
+static void kernel_demo_start(void) {
+  kernel_init();
+  kernel_sem_init(&button_sem, 0, 1);
+  kernel_queue_init(&console_events, console_events_buf, sizeof(console_events_buf[0]),
+                    sizeof(console_events_buf) / sizeof(console_events_buf[0]));
+  kernel_thread_create(&control_thread, "control", CONTROL_PRIORITY, control_stack,
+                       sizeof(control_stack) / sizeof(control_stack[0]), control_main, NULL);
+  kernel_thread_create(&button_thread, "button", BUTTON_PRIORITY, button_stack,
+                       sizeof(button_stack) / sizeof(button_stack[0]), button_main, NULL);
+  kernel_start(&console_thread, "console", CONSOLE_PRIORITY);
 }
 
+// How deeply to idle waiting for input: type 'z' to allow Stop. A key
+// typed while in Stop wakes the core but is lost, so press it twice.
+static power_state_t idle_state = POWER_SLEEP;
+
 // Send stuff over ST-LINK UART
 int main(void) {
   uint8_t rxc;
+  clock_source_t clk;
 
-  uart3_rxtx_init();
+  // Stack guard first: type 's' for stack and heap use
+  memstat_init();
+
+  // Start-up phases are probed: type 'p' to see them
+  prof_init();
+  {
+    PROF_SCOPE(boot_clock);
+    clk = clock_init();
+  }
+  // update.c times out an idle update in ticks
+  tick_init(clock_hclk_hz());
+  {
+    PROF_SCOPE(boot_uart);
+    uart3_rxtx_init();
+  }
+  {
+    PROF_SCOPE(boot_console);
+    console_init();
+  }
+  trace_init();
+  cmd_init(commands, sizeof(commands) / sizeof(commands[0]));
+  power_init(stop_busy, sizeof(stop_busy) / sizeof(stop_busy[0]), POWER_WAKE_UART3);
+  // A host at another rate sends 'U' first (baud.h)
+  baud_init();
+
+  // A no-op unless BOOT_DEFER_CONSTRUCTORS held them back until now
+  boot_constructors();
+
+  console_printf("\r\nSYSCLK %lu Hz from %s, PCLK1 %lu Hz, 115200 baud error %ld ppm\r\n",
+                 (unsigned long)clock_sysclk_hz(),
+                 clk == CLOCK_PLL_HSE ? "HSE PLL" : clk == CLOCK_PLL_HSI ? "HSI PLL" : "HSI (PLL failed)",
+                 (unsigned long)clock_pclk1_hz(), (long)uart3_baud_error_ppm);
+  uint32_t overflow_at;
+  if (memstat_overflowed(&overflow_at)) {
+    console_printf("Reset after a stack overflow at %08lx\r\n", (unsigned long)overflow_at);
+  }
+  // Reset_Handler's phases: type 'b' to compare its loops with the old ones
+  boot_report();
+
+  // From here on this is the console thread
+  kernel_demo_start();
 
   while (1) {
-    printf("\r\n\r\nHello, world!\r\n");
-    rxc = uart_read(USART3);
+    console_printf("\r\n\r\nHello, world!\r\n");
+    // Input is buffered by the USART3 interrupt, so other work
+    // could happen here while we wait: command frames are answered.
+    // Otherwise idle until an interrupt: 'i' shows where the time went.
+    while (!uart_try_read(&rxc)) {
+      cmd_poll();
+      if (baud_poll()) {
+        console_printf("\r\nline: %lu baud, from auto-baud\r\n", (unsigned long)baud_stats()->autobaud);
+      }
+      // A firmware update (Sim/update-send) ends here
+      if (update_poll()) NVIC_SystemReset();
+      capture_poll();
+      button_event_t ev;
+      while (kernel_queue_get(&console_events, &ev, 0) == KERNEL_OK) print_button_event(&ev);
+      uint32_t primask = critical_enter();
+      if (!console_rx_available() && !cmd_pending() && !kernel_queue_count(&console_events)) {
+        // The threads above wake the core for their own timed waits
+        power_idle(idle_state, kernel_ticks_to_next());
+      }
+      critical_exit(primask);
+    }
     if (rxc == 'g' || rxc == 'G') {
-      printf("Goodbye, cruel world...");
+      console_printf("Goodbye, cruel world...");
+    } else if (rxc == 'c' || rxc == 'C') {
+      tcm_bench();
+    } else if (rxc == 'f' || rxc == 'F') {
+      fmt_bench();
+    } else if (rxc == 'd') {
+      dsp_bench();
+    } else if (rxc == 't') {
+      // Binary: read it with Sim/trace-decode
+      TRACE("trace: %lu records so far, %lu dropped",
+            (unsigned long)trace_stats()->records, (unsigned long)trace_stats()->dropped);
+    } else if (rxc == 's') {
+      memstat_report();
+    } else if (rxc == 'm') {
+      pool_report();
+    } else if (rxc == 'w') {
+      wave_demo();
+    } else if (rxc == 'l') {
+      capture_demo();
+    } else if (rxc == 'b') {
+      boot_report();
+      boot_bench();
+    } else if (rxc == 'p') {
+      prof_report();
+    } else if (rxc == 'P') {
+      prof_reset();
+    } else if (rxc == 'i') {
+      power_report();
+    } else if (rxc == 'u') {
+      const update_stats_t *u = update_stats();
+      console_printf("update: %lu started, %lu done, %lu failed, %lu abandoned; last %lu ms, "
+                     "%lu of %lu sectors erased, %lu waits for the flash\r\n",
+                     (unsigned long)u->started, (unsigned long)u->completed, (unsigned long)u->failed,
+                     (unsigned long)u->abandoned, (unsigned long)u->ms, (unsigned long)u->erases,
+                     (unsigned long)u->sectors, (unsigned long)u->stage_waits);
+    } else if (rxc == 'r') {
+      const baud_stats_t *b = baud_stats();
+      uart_port_t *p = uart_port(UART_USART3);
+      console_printf("line: %lu baud, error %ld ppm; auto-baud %lu; %lu proposals, %lu kept, "
+                     "%lu fell back, %lu bad patterns; nothing from %lu up\r\n",
+                     (unsigned long)p->baud, (long)p->baud_error_ppm, (unsigned long)b->autobaud,
+                     (unsigned long)b->proposals, (unsigned long)b->committed,
+                     (unsigned long)b->fallbacks, (unsigned long)b->bad_verify,
+                     (unsigned long)b->limit);
+    } else if (rxc == 'k') {
+      kernel_report();
+      console_printf("control: %lu runs every %lu ticks, at most %lu cycles late\r\n",
+                     (unsigned long)control_runs, (unsigned long)CONTROL_PERIOD,
+                     (unsigned long)control_late_max);
+    } else if (rxc == 'K') {
+      kernel_reset_stats();
+      control_late_max = 0;
+    } else if (rxc == 'z') {
+      idle_state = idle_state == POWER_STOP ? POWER_SLEEP : POWER_STOP;
+      console_printf("idle: %s\r\n", idle_state == POWER_STOP ? "stop" : "sleep");
     }
   }
 
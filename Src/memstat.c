@@ -0,0 +1,116 @@
+/*
+ * memstat.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Stack and heap use, and the MPU stack guard. See memstat.h.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "console.h"
+#include "memstat.h"
+#include "pool.h"
+#include "sections.h"
+
+// Linker script symbols
+extern uint32_t _sstack_guard[];  // Guard region, up to _sstack
+extern uint32_t _sstack[];        // Lowest address the stack may use
+extern uint32_t _estack[];        // Initial SP
+extern uint8_t _sheap[];          // _sbrk() heap: the end of .bss...
+extern uint8_t _eheap[];          // ...to the end of SRAM1
+
+// From sysmem.c (which has no header of its own)
+void *_sbrk(ptrdiff_t incr);
+
+#define FAULT_MAGIC 0x5AC0FFEEUL
+
+// Kept over the reset that follows a stack overflow
+typedef struct {
+  uint32_t magic;
+  uint32_t cfsr;
+  uint32_t mmfar;
+} fault_record_t;
+
+SRAM1_NOINIT static volatile fault_record_t fault_record;
+
+static int overflowed;
+static uint32_t overflow_addr;
+
+void memstat_init(void) {
+  if (fault_record.magic == FAULT_MAGIC) {
+    overflowed = 1;
+    overflow_addr = (fault_record.cfsr & SCB_CFSR_MMARVALID_Msk) ? fault_record.mmfar : 0U;
+  }
+  fault_record.magic = 0;
+
+  uint32_t regions = (MPU->TYPE & MPU_TYPE_DREGION_Msk) >> MPU_TYPE_DREGION_Pos;
+  uint32_t size = (uint32_t)((uintptr_t)_sstack - (uintptr_t)_sstack_guard);
+  if (!regions || size < 32U || (size & (size - 1U))) return;
+
+  // PM0253 Rev 5 Sec 4.6.6-4.6.9: region size is 2^(SIZE+1) bytes, and
+  // the base must be aligned to it (the linker script sees to that).
+  // No access (AP=000), never execute, normal non-cacheable (TEX=001).
+  __DMB();
+  MPU->CTRL = 0;
+  MPU->RNR = regions - 1U;
+  MPU->RBAR = (uint32_t)(uintptr_t)_sstack_guard;
+  MPU->RASR = MPU_RASR_XN_Msk | (1UL << MPU_RASR_TEX_Pos) |
+              ((uint32_t)(__builtin_ctz(size) - 1) << MPU_RASR_SIZE_Pos) | MPU_RASR_ENABLE_Msk;
+  MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+  SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk;
+  __DSB();
+  __ISB();
+}
+
+// Called with SP back at _estack: nothing below it matters now
+ITCM_CODE void memstat_stack_fault(void) {
+  fault_record.cfsr = SCB->CFSR;
+  fault_record.mmfar = SCB->MMFAR;
+  fault_record.magic = FAULT_MAGIC;
+  __DSB();
+  NVIC_SystemReset();
+}
+
+int memstat_overflowed(uint32_t *addr) {
+  if (addr) *addr = overflow_addr;
+  return overflowed;
+}
+
+void memstat_get(memstat_t *m) {
+  const volatile uint32_t *w = _sstack;
+  while (w < _estack && *w == MEMSTAT_PAINT) w++;
+  m->stack_size = (uint32_t)((uintptr_t)_estack - (uintptr_t)_sstack);
+  m->stack_peak = (uint32_t)((uintptr_t)_estack - (uintptr_t)w);
+
+  m->heap_size = (uint32_t)(_eheap - _sheap);
+  m->heap_peak = (uint32_t)((uint8_t *)_sbrk(0) - _sheap);
+
+  m->pool_size = m->pool_peak = 0;
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    const pool_t *p = pool_class(i);
+    m->pool_size += p->block_size * p->count;
+    m->pool_peak += p->block_size * p->peak;
+  }
+}
+
+void memstat_report(void) {
+  memstat_t m;
+  memstat_get(&m);
+  console_printf("stack  %6lu of %6lu bytes at most, %6lu never used\r\n",
+                 (unsigned long)m.stack_peak, (unsigned long)m.stack_size,
+                 (unsigned long)(m.stack_size - m.stack_peak));
+  console_printf("heap   %6lu of %6lu bytes at most (_sbrk)\r\n",
+                 (unsigned long)m.heap_peak, (unsigned long)m.heap_size);
+  console_printf("pools  %6lu of %6lu bytes at most (malloc size classes)\r\n",
+                 (unsigned long)m.pool_peak, (unsigned long)m.pool_size);
+  if (overflowed) {
+    console_printf("last reset: stack overflow at %08lx\r\n", (unsigned long)overflow_addr);
+  }
+}
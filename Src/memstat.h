@@ -0,0 +1,61 @@
+/*
+ * memstat.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * How much stack and heap the program really uses, and a guard that
+ * stops a stack overflow before it overwrites anything.
+ *
+ * Stack: the main stack runs down from _estack (the top of DTCM-RAM) to
+ * _sstack. The startup paints that area with MEMSTAT_PAINT before main(),
+ * so the lowest word not still painted is the deepest the stack - thread
+ * mode and interrupt handlers, which share it - has ever been.
+ *
+ * Below _sstack is a guard region of _Stack_Guard_Size bytes (see the
+ * linker script). memstat_init() makes it no-access with the highest
+ * numbered MPU region, PM0253 Rev 5 Sec 4.6, with the default memory map
+ * for everything else (PRIVDEFENA). A push into it raises a MemManage
+ * fault; the handler (in the startup code) moves SP back to _estack,
+ * records the fault in memory that survives a reset, and resets. A single
+ * frame larger than the guard can still step over it.
+ *
+ * Heap: the _sbrk() heap only grows, so its end is its high-water mark.
+ * The malloc() size classes (pool.h) keep their own peaks.
+ */
+
+#ifndef MEMSTAT_H_
+#define MEMSTAT_H_
+
+#include <stdint.h>
+
+// Unused stack; must match the word the startup code paints with
+#define MEMSTAT_PAINT 0xC5C5C5C5UL
+
+typedef struct {
+  uint32_t stack_size;  // _sstack to _estack
+  uint32_t stack_peak;  // Deepest the stack has been
+  uint32_t heap_size;   // _sbrk() heap, from the end of .bss to _eheap
+  uint32_t heap_peak;   // How far _sbrk() has moved into it
+  uint32_t pool_size;   // Bytes in the malloc() size classes
+  uint32_t pool_peak;   // Sum of each class's peak: at least the peak at once
+} memstat_t;
+
+// Turn on the stack guard and MemManage faults. Call early in main().
+void memstat_init(void);
+
+// Current figures. The stack scan reads every unused word: ~30K cycles
+// for 100K of stack.
+void memstat_get(memstat_t *m);
+
+// True if the last reset was the stack guard's; addr is the fault address
+// if the core recorded one, else 0
+int memstat_overflowed(uint32_t *addr);
+
+// printf() the figures, and what could be given back
+void memstat_report(void);
+
+// MemManage_Handler's C half: record the fault and reset
+void memstat_stack_fault(void) __attribute__((noreturn));
+
+#endif /* MEMSTAT_H_ */
@@ -0,0 +1,119 @@
+/*
+ * mpsc.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Multi-producer/single-consumer queue of fixed-size items, without
+ * masking interrupts: any number of handlers, at any priorities, and
+ * thread mode may put, and one context gets.
+ *
+ * Producers claim a slot by advancing head with LDREX/STREX (GCC's
+ * compare-and-swap on ARMv7-M); one interrupted between the two has its
+ * STREX fail, since exception entry and return clear the exclusive
+ * monitor (PM0253 Rev 5 Sec 3.10.8), and tries again. The claimed slot is
+ * then filled in its own time. Each slot carries a sequence word that
+ * says whose turn it is - a producer's on this lap, the consumer's once
+ * it is filled - so a producer preempted part way through filling its
+ * slot holds up only the consumer, which sees an empty queue there until
+ * it is done; no producer ever waits for another. Ordering is as in
+ * ring.h: acquire on the sequence word before touching the item, release
+ * after, with a DMB each on the target.
+ *
+ * The sequence words start at 0, so a zeroed queue is an empty one and
+ * MPSC_INIT() needs no code to run. The number of items must be a power
+ * of two, and at least 2. The item copies are memcpy(): keep items
+ * small, or put pointers to pool blocks (pool.h) in the queue.
+ */
+
+#ifndef MPSC_H_
+#define MPSC_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ring.h"
+
+typedef struct {
+  uint8_t *buf;            // len items of size bytes
+  uint32_t *seq;           // Per slot, relative to its lap: 0 free, 1 full
+  uint32_t size;           // Of an item, in bytes
+  uint32_t mask;           // len - 1
+  volatile uint32_t head;  // Next slot to claim; producers, by LDREX/STREX
+  volatile uint32_t tail;  // Next slot to read; consumer only
+} mpsc_t;
+
+// Static initializer; SEQ is LEN zeroed words, BUF LEN items of SIZE
+// bytes, and LEN a power of two of at least 2
+#define MPSC_INIT(BUF, SEQ, SIZE, LEN) { (uint8_t *)(BUF), (SEQ), (SIZE), (LEN) - 1U, 0U, 0U }
+
+static inline uint32_t mpsc_len(const mpsc_t *q) {
+  return q->mask + 1U;
+}
+
+// Items claimed and not yet got, some perhaps still being filled
+static inline uint32_t mpsc_count(const mpsc_t *q) {
+  uint32_t tail = RING_LOAD_ACQUIRE(&q->tail);
+  return RING_LOAD_ACQUIRE(&q->head) - tail;
+}
+
+// Producer: copy an item in. Returns 0 if the queue is full. Safe in
+// any handler.
+static inline int mpsc_put(mpsc_t *q, const void *item) {
+  uint32_t head = RING_LOAD_OWN(&q->head);
+  for (;;) {
+    uint32_t *seq = &q->seq[head & q->mask];
+    uint32_t lap = head & ~q->mask;
+    int32_t diff = (int32_t)(RING_LOAD_ACQUIRE(seq) - lap);
+    if (diff < 0) return 0; // Still full from the lap before
+    if (diff == 0) {
+      // One LDREX/STREX attempt; a failure reloads head
+      if (__atomic_compare_exchange_n(&q->head, &head, head + 1U, 1, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        memcpy(&q->buf[(head & q->mask) * q->size], item, q->size);
+        RING_STORE_RELEASE(seq, lap + 1U);
+        return 1;
+      }
+    } else {
+      head = RING_LOAD_OWN(&q->head); // Another producer took this slot
+    }
+  }
+}
+
+// Consumer: the oldest item in place, or NULL if there is none yet (or
+// its producer has not finished filling it). mpsc_release() it when done.
+static inline const void *mpsc_peek(const mpsc_t *q) {
+  uint32_t tail = RING_LOAD_OWN(&q->tail);
+  uint32_t lap = tail & ~q->mask;
+  if (RING_LOAD_ACQUIRE(&q->seq[tail & q->mask]) != lap + 1U) return NULL;
+  return &q->buf[(tail & q->mask) * q->size];
+}
+
+static inline void mpsc_release(mpsc_t *q) {
+  uint32_t tail = RING_LOAD_OWN(&q->tail);
+  uint32_t lap = tail & ~q->mask;
+  RING_STORE_RELEASE(&q->seq[tail & q->mask], lap + mpsc_len(q)); // Free on the next lap
+  RING_STORE_RELEASE(&q->tail, tail + 1U);
+}
+
+// Consumer: copy the oldest item out. Returns 0 if there is none yet.
+static inline int mpsc_get(mpsc_t *q, void *item) {
+  const void *p = mpsc_peek(q);
+  if (!p) return 0;
+  memcpy(item, p, q->size);
+  mpsc_release(q);
+  return 1;
+}
+
+// Consumer: copy up to n items out, in order. Returns the number copied.
+static inline uint32_t mpsc_read(mpsc_t *q, void *items, uint32_t n) {
+  uint8_t *dst = (uint8_t *)items;
+  uint32_t got = 0;
+  while (got < n && mpsc_get(q, dst)) {
+    dst += q->size;
+    got++;
+  }
+  return got;
+}
+
+#endif /* MPSC_H_ */
@@ -10,11 +10,34 @@
 
 
 // Clock enable bits on AHB1
+#define GPIOA_CLK_EN      (1UL << 0) // Bit 0 of RCC_AHB1ENR_R - see page 185 of RM
 #define GPIOB_CLK_EN      (1UL << 1) // Bit 1 of RCC_AHB1ENR_R - see page 185 of RM
 #define GPIOC_CLK_EN      (1UL << 2) // Bit 2 of RCC_AHB1ENR_R - see page 185 of RM
 #define GPIOD_CLK_EN      (1UL << 3) // Bit 3 of RCC_AHB1ENR_R - see page 185 of RM
+#define GPIOE_CLK_EN      (1UL << 4) // Bit 4 of RCC_AHB1ENR_R - see page 185 of RM
+#define DMA1_CLK_EN       (1UL << 21) // Bit 21 of RCC_AHB1ENR_R - see page 185 of RM
 
 // Clock enable bits on APB1 (5.3.13 p 188 of RM0410 Rev 5)
+#define USART2_CLK_EN     (1UL << 17)
 #define USART3_CLK_EN     (1UL << 18)
+#define UART4_CLK_EN      (1UL << 19)
+#define UART5_CLK_EN      (1UL << 20)
+#define PWR_CLK_EN        (1UL << 28)
+#define UART7_CLK_EN      (1UL << 30)
+#define UART8_CLK_EN      (1UL << 31)
+
+// Clock enable bits on APB2 (5.3.14 p 191 of RM0410 Rev 5)
+#define USART1_CLK_EN     (1UL << 4)
+#define USART6_CLK_EN     (1UL << 5)
+
+// Oscillators
+// HSI: internal 16MHz RC, what we run on out of reset (RM0410 Rev 5 Sec 5.2.2)
+// HSE: the ST-LINK's 8MHz MCO drives PH0 in bypass mode (UM1974 Rev 10 Sec 6.7.1 p 23)
+#define HSI_HZ            16000000UL
+#define HSE_HZ             8000000UL
+// LSE: the 32.768kHz crystal X2 (UM1974 Rev 10 Sec 6.7.2); LSI: internal
+// RC, 32kHz nominal but anywhere from 17 to 47kHz (DS11532 Table 47)
+#define LSE_HZ               32768UL
+#define LSI_HZ               32000UL
 
 #endif /* NUCLEO_CLK_H_ */
@@ -22,5 +22,31 @@
 // USART3 transmit data pin on bank D alternate mode
 #define USART3_TX_PIN_D 8
 #define USART3_RX_PIN_D 9
+#define USART3_AF       7
+
+/*
+
+* The other U(S)ARTs, on pins free on the Nucleo-144 connectors
+  (UM1974 Rev 10 Sec 6.12, DataSheet Rev 8 p89 Table 13):
+  * Not PA9-12 (USB), PB0/PB7/PB14 (LEDs), PA1/PA2/PA7/PC1/PC4/PC5/PG11/PG13/PB13 (Ethernet)
+  * USART1 RX is on AF4 while its TX is on AF7
+  * USART1 and USART6 are on APB2; the rest on APB1
+
+ */
+
+#define USART1_TX_PIN_B 6   // AF7
+#define USART1_RX_PIN_B 15  // AF4
+#define USART2_TX_PIN_D 5   // AF7
+#define USART2_RX_PIN_D 6   // AF7
+#define UART4_TX_PIN_C  10  // AF8
+#define UART4_RX_PIN_C  11  // AF8
+#define UART5_TX_PIN_C  12  // AF8
+#define UART5_RX_PIN_D  2   // AF8
+#define USART6_TX_PIN_C 6   // AF8
+#define USART6_RX_PIN_C 7   // AF8
+#define UART7_TX_PIN_E  8   // AF8
+#define UART7_RX_PIN_E  7   // AF8
+#define UART8_TX_PIN_E  1   // AF8
+#define UART8_RX_PIN_E  0   // AF8
 
 #endif /* NUCLEO_UART_H_ */
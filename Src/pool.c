@@ -0,0 +1,124 @@
+/*
+ * pool.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Fixed-block pools and the malloc() size classes. See pool.h.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "console.h"
+#include "critical.h"
+#include "pool.h"
+
+// A free block holds the link to the next one
+typedef struct pool_block {
+  struct pool_block *next;
+} pool_block_t;
+
+#define CLASS_STORAGE(SIZE, COUNT) \
+  static uint64_t class_##SIZE##_[POOL_ROUND(SIZE) / 8U * (COUNT)];
+POOL_CLASSES(CLASS_STORAGE)
+
+#define CLASS_POOL(SIZE, COUNT) \
+  { "pool" #SIZE, (uint8_t *)class_##SIZE##_, POOL_ROUND(SIZE), (COUNT), 0, 0, 0, 0, 0 },
+static pool_t classes[] = { POOL_CLASSES(CLASS_POOL) };
+
+static uint32_t size_failures;
+static uint32_t bad_frees;
+
+void *pool_alloc(pool_t *p) {
+  uint32_t primask = critical_enter();
+  pool_block_t *b = (pool_block_t *)p->free;
+  if (b) {
+    p->free = b->next;
+  } else if (p->fresh < p->count) {
+    b = (pool_block_t *)(p->base + p->fresh++ * p->block_size);
+  }
+  if (b) {
+    if (++p->used > p->peak) p->peak = p->used;
+  } else {
+    p->failures++;
+  }
+  critical_exit(primask);
+  return b;
+}
+
+void pool_free(pool_t *p, void *block) {
+  pool_block_t *b = (pool_block_t *)block;
+  uint32_t primask = critical_enter();
+  b->next = (pool_block_t *)p->free;
+  p->free = b;
+  p->used--;
+  critical_exit(primask);
+}
+
+int pool_owns(const pool_t *p, const void *ptr) {
+  uintptr_t off = (uintptr_t)ptr - (uintptr_t)p->base;
+  return off < (uintptr_t)p->block_size * p->count && off % p->block_size == 0;
+}
+
+void *pool_alloc_size(uint32_t size) {
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    if (size > classes[i].block_size) continue;
+    void *b = pool_alloc(&classes[i]);
+    if (b) return b;
+  }
+  uint32_t primask = critical_enter();
+  size_failures++;
+  critical_exit(primask);
+  return NULL;
+}
+
+static pool_t *owner(const void *ptr) {
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    if (pool_owns(&classes[i], ptr)) return &classes[i];
+  }
+  return NULL;
+}
+
+void pool_free_any(void *ptr) {
+  pool_t *p = owner(ptr);
+  if (p) {
+    pool_free(p, ptr);
+  } else {
+    uint32_t primask = critical_enter();
+    bad_frees++;
+    critical_exit(primask);
+  }
+}
+
+uint32_t pool_block_size(const void *ptr) {
+  const pool_t *p = owner(ptr);
+  return p ? p->block_size : 0U;
+}
+
+pool_t *pool_class(uint32_t i) {
+  return i < POOL_NUM_CLASSES ? &classes[i] : NULL;
+}
+
+uint32_t pool_size_failures(void) {
+  return size_failures;
+}
+
+uint32_t pool_bad_frees(void) {
+  return bad_frees;
+}
+
+void pool_report(void) {
+  console_printf("pool       block  count   used   peak  failures\r\n");
+  for (uint32_t i = 0; i < POOL_NUM_CLASSES; i++) {
+    const pool_t *p = &classes[i];
+    console_printf("%-9s %6lu %6lu %6lu %6lu %9lu\r\n", p->name,
+                   (unsigned long)p->block_size, (unsigned long)p->count,
+                   (unsigned long)p->used, (unsigned long)p->peak,
+                   (unsigned long)p->failures);
+  }
+  console_printf("%lu requests no class could meet, %lu bad frees\r\n",
+                 (unsigned long)size_failures, (unsigned long)bad_frees);
+}
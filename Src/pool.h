@@ -0,0 +1,97 @@
+/*
+ * pool.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Fixed-block memory pools, and the size classes that malloc() uses
+ * (see heap.c).
+ *
+ * A pool hands out blocks of one size from a static array. Freed blocks
+ * go on a list threaded through the blocks themselves; blocks never yet
+ * handed out are taken in order after that, so a pool needs no set-up
+ * and works from reset, .bss being zeroed. Allocating and freeing are
+ * O(1) and mask interrupts for a few instructions, so both may be used
+ * from interrupt handlers.
+ *
+ * The size classes are a list of pools from small to large, set with
+ * POOL_CLASSES. pool_alloc_size() takes a block from the smallest class
+ * that fits and, if that one is empty, from the next larger ones: it
+ * looks at no more than POOL_NUM_CLASSES pools, however long the program
+ * has run. There is no fragmentation beyond the rounding up to a class:
+ * any freed block can serve the next request of its class.
+ *
+ * Blocks are 8-byte aligned, like malloc().
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdint.h>
+
+typedef struct pool {
+  const char *name;
+  uint8_t *base;
+  uint32_t block_size;  // A multiple of 8
+  uint32_t count;
+  void *free;           // Freed blocks, most recent first
+  uint32_t fresh;       // Blocks from here on have never been handed out
+
+  uint32_t used;        // Blocks handed out now
+  uint32_t peak;        // Most blocks ever handed out at once
+  uint32_t failures;    // Times an allocation found the pool empty
+} pool_t;
+
+#define POOL_ROUND(SIZE) (((SIZE) + 7U) & ~7U)
+
+// Define a pool of COUNT blocks of at least SIZE bytes
+#define POOL_DEFINE(NAME, SIZE, COUNT) \
+  static uint64_t NAME##_storage_[POOL_ROUND(SIZE) / 8U * (COUNT)]; \
+  pool_t NAME = { #NAME, (uint8_t *)NAME##_storage_, POOL_ROUND(SIZE), (COUNT), \
+                  0, 0, 0, 0, 0 }
+
+// Size classes as X(block size, count), smallest first. About 20K of .bss
+// by default; the 1024-byte class holds newlib's stdio buffers.
+#ifndef POOL_CLASSES
+#define POOL_CLASSES(X) \
+  X(16, 128) \
+  X(32, 64) \
+  X(64, 64) \
+  X(128, 32) \
+  X(256, 16) \
+  X(1024, 4)
+#endif
+
+#define POOL_COUNT_CLASS(SIZE, COUNT) + 1U
+#define POOL_NUM_CLASSES (0U POOL_CLASSES(POOL_COUNT_CLASS))
+
+// A block from one pool, or NULL if it is empty
+void *pool_alloc(pool_t *p);
+
+// Return a block to the pool it came from
+void pool_free(pool_t *p, void *block);
+
+// True if ptr is a block of this pool
+int pool_owns(const pool_t *p, const void *ptr);
+
+// A block of at least size bytes from the size classes, or NULL
+void *pool_alloc_size(uint32_t size);
+
+// Return a block from pool_alloc_size(). Anything else is ignored and
+// counted (see pool_bad_frees()).
+void pool_free_any(void *ptr);
+
+// Size of the block ptr points into, or 0 if it is not from a class
+uint32_t pool_block_size(const void *ptr);
+
+// The size classes, smallest first
+pool_t *pool_class(uint32_t i);
+
+// Requests no class could meet, and frees of pointers not from a class
+uint32_t pool_size_failures(void);
+uint32_t pool_bad_frees(void);
+
+// printf() each class's use, and the failure counts
+void pool_report(void);
+
+#endif /* POOL_H_ */
@@ -0,0 +1,327 @@
+/*
+ * power.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Low-power idle in Sleep or Stop mode. See power.h.
+ *
+ * Stop mode:  RM0410 Rev 5 Sec 4.3.6 p 139, PWR_CR1 Sec 4.4.1 p 143
+ * LSE, LSI:   RM0410 Rev 5 Sec 5.2.4-5.2.5; the LSE is in the backup
+ *             domain, writable once PWR_CR1 DBP is set, Sec 4.1.2
+ * LPTIM1:     RM0410 Rev 5 Sec 33.4 p 1010 - IER and CFGR may only be
+ *             written with ENABLE clear, CMP and ARR only with it set,
+ *             and CNT must be read twice until two reads agree, Sec 33.7.7
+ * EXTI lines: 9 is PD9 through SYSCFG_EXTICR3, 23 is LPTIM1, Sec 11.3 p 297
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "nucleo-clk.h"
+#include "nucleo-btn.h"
+#include "nucleo-uart.h"
+
+#include "clock.h"
+#include "console.h"
+#include "critical.h"
+#include "power.h"
+#include "sections.h"
+#include "tick.h"
+#include "uart.h"
+
+#define UART_LINE   (1UL << USART3_RX_PIN_D)
+#define BUTTON_LINE USER_BTN
+#define LPTIM_LINE  (1UL << 23)
+
+// The LSE crystal takes up to 2s to start (DS11532 Table 42 tSU(LSE));
+// this many polls is longer than that at 216MHz
+#define LSE_TIMEOUT 100000000UL
+#define LSI_TIMEOUT 100000UL
+
+static const power_busy_t *busy_table;
+static uint32_t busy_len;
+static uint32_t wake_flags;
+static uint32_t lp_hz;
+static volatile uint32_t lp_wraps;  // ARRM interrupts: once every 65536 counts
+static uint64_t lp_start;
+static uint32_t tick_carry;         // LPTIM1 counts short of a whole tick
+static uint32_t uart_awake_until;   // Tick: no Stop before it
+static uint32_t uart_rx_seen;       // USART3 bytes in as of the last look
+static power_stats_t stats;
+
+// The backup domain keeps the LSE running across resets, so it may be
+// ready already
+static int lse_start(void) {
+  SET_BIT(RCC->APB1ENR, PWR_CLK_EN);
+  SET_BIT(PWR->CR1, PWR_CR1_DBP);
+  SET_BIT(RCC->BDCR, RCC_BDCR_LSEON);
+  uint32_t t = LSE_TIMEOUT;
+  while (!(RCC->BDCR & RCC_BDCR_LSERDY) && --t);
+  if (t) return 1;
+  CLEAR_BIT(RCC->BDCR, RCC_BDCR_LSEON);
+  return 0;
+}
+
+static int lsi_start(void) {
+  SET_BIT(RCC->CSR, RCC_CSR_LSION);
+  uint32_t t = LSI_TIMEOUT;
+  while (!(RCC->CSR & RCC_CSR_LSIRDY) && --t);
+  return t != 0;
+}
+
+static uint32_t lp_cnt(void) {
+  uint32_t a, b = LPTIM1->CNT;
+  do {
+    a = b;
+    b = LPTIM1->CNT;
+  } while (a != b);
+  return a;
+}
+
+// CMPOK says the last write has reached the LPTIM clock domain
+static void lp_set_cmp(uint32_t v) {
+  while (!(LPTIM1->ISR & LPTIM_ISR_CMPOK));
+  LPTIM1->ICR = LPTIM_ICR_CMPOKCF;
+  LPTIM1->CMP = v & 0xFFFFU;
+}
+
+ITCM_CODE void LP_Timer1_IRQHandler(void) {
+  uint32_t isr = LPTIM1->ISR;
+  LPTIM1->ICR = isr & (LPTIM_ICR_CMPMCF | LPTIM_ICR_ARRMCF);
+  EXTI->PR = LPTIM_LINE;
+  if (isr & LPTIM_ISR_ARRM) lp_wraps++;
+}
+
+// Only unmasked in Stop mode; all it has to do is wake the core
+ITCM_CODE void EXTI9_5_IRQHandler(void) {
+  EXTI->PR = UART_LINE;
+}
+
+void power_init(const power_busy_t *busy, uint32_t n, uint32_t flags) {
+  busy_table = busy;
+  busy_len = n;
+  wake_flags = flags;
+  uart_awake_until = tick_now();
+
+  int lse = lse_start();
+  lp_hz = LSE_HZ;
+  if (!lse) {
+    lsi_start();
+    lp_hz = LSI_HZ;
+  }
+
+  // LPTIM1 free-running from the LSE (or LSI), no prescaler
+  SET_BIT(RCC->APB1ENR, RCC_APB1ENR_LPTIM1EN);
+  MODIFY_REG(RCC->DCKCFGR2, RCC_DCKCFGR2_LPTIM1SEL,
+             lse ? RCC_DCKCFGR2_LPTIM1SEL : RCC_DCKCFGR2_LPTIM1SEL_0);
+  LPTIM1->CR = 0;
+  LPTIM1->CFGR = 0;
+  LPTIM1->IER = LPTIM_IER_CMPMIE | LPTIM_IER_ARRMIE;
+  LPTIM1->CR = LPTIM_CR_ENABLE;
+  LPTIM1->ARR = 0xFFFFU;
+  while (!(LPTIM1->ISR & LPTIM_ISR_ARROK));
+  LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+  LPTIM1->CMP = 0xFFFFU;
+  lp_wraps = 0;
+  LPTIM1->CR = LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT;
+
+  EXTI->RTSR |= LPTIM_LINE;
+  EXTI->PR = LPTIM_LINE;
+  EXTI->IMR |= LPTIM_LINE;
+  NVIC_SetPriority(LPTIM1_IRQn, POWER_IRQ_PRIORITY);
+  NVIC_EnableIRQ(LPTIM1_IRQn);
+
+  if (flags & POWER_WAKE_UART3) {
+    uart_port_t *p = uart_port(UART_USART3);
+    uart_flush(p);
+    uart_set_clock(p, UART_CLK_HSI);
+
+    // A falling edge on PD9, the start bit; unmasked only for Stop
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_SYSCFGEN);
+    MODIFY_REG(SYSCFG->EXTICR[2], SYSCFG_EXTICR3_EXTI9, SYSCFG_EXTICR3_EXTI9_PD);
+    EXTI->IMR &= ~UART_LINE;
+    EXTI->FTSR |= UART_LINE;
+    EXTI->PR = UART_LINE;
+    NVIC_SetPriority(EXTI9_5_IRQn, POWER_IRQ_PRIORITY);
+    NVIC_EnableIRQ(EXTI9_5_IRQn);
+  }
+
+  power_reset_stats();
+}
+
+uint32_t power_lp_hz(void) {
+  return lp_hz;
+}
+
+// ARRM is set as the counter reaches 0xFFFF, one count before it wraps
+uint64_t power_lp_now(void) {
+  uint32_t cnt, wraps;
+  uint32_t primask = critical_enter();
+  do {
+    cnt = lp_cnt();
+    wraps = lp_wraps + ((LPTIM1->ISR & LPTIM_ISR_ARRM) ? 1U : 0U);
+  } while (lp_cnt() != cnt);
+  critical_exit(primask);
+  if (cnt == 0xFFFFU) wraps--;
+  return ((uint64_t)wraps << 16) | cnt;
+}
+
+void power_reset_stats(void) {
+  memset(&stats, 0, sizeof(stats));
+  lp_start = power_lp_now();
+}
+
+const power_stats_t *power_stats(void) {
+  uint64_t total = power_lp_now() - lp_start;
+  stats.lp[POWER_RUN] = total - stats.lp[POWER_SLEEP] - stats.lp[POWER_STOP];
+  return &stats;
+}
+
+static int stop_vetoed(void) {
+  for (uint32_t i = 0; i < busy_len; i++) {
+    if (busy_table[i]()) return 1;
+  }
+  return 0;
+}
+
+// Whether USART3 has been quiet for POWER_UART_AWAKE_MS: the rest of a
+// command may be on its way
+static int uart_quiet(void) {
+  if (!(wake_flags & POWER_WAKE_UART3)) return 1;
+  const uart_rx_stats_t *rs = uart_rx_stats(uart_port(UART_USART3));
+  uint32_t n = rs->received + rs->filtered + rs->dropped;
+  if (n != uart_rx_seen) {
+    // Their start bits; any byte still arriving is counted before Stop
+    // can be next tried, or sets PR9 again
+    EXTI->PR = UART_LINE;
+    uart_rx_seen = n;
+    uart_awake_until = tick_now() + TICK_MS(POWER_UART_AWAKE_MS);
+  }
+  return (int32_t)(uart_awake_until - tick_now()) <= 0;
+}
+
+static void enter_sleep(void) {
+  uint64_t t0 = power_lp_now();
+  __WFI();
+  stats.lp[POWER_SLEEP] += power_lp_now() - t0;
+}
+
+static void enter_stop(uint32_t ticks) {
+  uint64_t t0 = power_lp_now();
+  int on_pll = (RCC->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_PLL;
+
+  // Wake early enough to have the clocks back when the timer is due: it
+  // may be as little as ticks - 1 whole ticks away
+  uint64_t lp = 0xFFF0U;
+  if (ticks != POWER_NO_TIMER) {
+    uint64_t early = ((uint64_t)POWER_WAKE_EARLY_US * lp_hz + 999999U) / 1000000U;
+    uint64_t until = (uint64_t)(ticks - 1U) * lp_hz / TICK_HZ;
+    lp = until > early ? until - early : 1U;
+    if (lp > 0xFFF0U) lp = 0xFFF0U; // Any further and CMP would match early
+  }
+  lp_set_cmp((uint32_t)(t0 + lp));
+
+  if (wake_flags & POWER_WAKE_UART3) {
+    // PR9 is left as it is: an edge since the last Stop may be a byte
+    // still arriving, and Stop would cut it off. It wakes the core at once.
+    EXTI->IMR |= UART_LINE;
+  }
+  MODIFY_REG(PWR->CR1, PWR_CR1_PDDS | PWR_CR1_LPDS | PWR_CR1_FPDS, PWR_CR1_LPDS | PWR_CR1_FPDS);
+  SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+  __DSB();
+  __WFI();
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+  uint64_t t1 = power_lp_now();
+  stats.lp[POWER_STOP] += t1 - t0;
+
+  uint32_t pr = EXTI->PR;
+  EXTI->IMR &= ~UART_LINE;
+  if (pr & UART_LINE) stats.wake_uart++;
+  else if (pr & BUTTON_LINE) stats.wake_button++;
+  else if (pr & LPTIM_LINE) stats.wake_timer++;
+  else stats.wake_other++;
+
+  // Back on the HSI: put the PLL back
+  uint64_t t2 = t1;
+  if (on_pll) {
+    if (clock_init() == CLOCK_FAILED) {
+      stats.restore_failed++;
+      tick_init(clock_hclk_hz());
+    }
+    t2 = power_lp_now();
+    uint32_t took = (uint32_t)(t2 - t1);
+    stats.restore_sum += took;
+    if (took > stats.restore_max) stats.restore_max = took;
+  }
+
+  // SysTick stood still in Stop, and as good as still on the HSI with
+  // its reload value for 216MHz
+  uint64_t n = (t2 - t0) * TICK_HZ + tick_carry;
+  tick_skip((uint32_t)(n / lp_hz));
+  tick_carry = (uint32_t)(n % lp_hz);
+
+  // The byte that woke the core is lost: uart_quiet() does not see it
+  if (pr & UART_LINE) uart_awake_until = tick_now() + TICK_MS(POWER_UART_AWAKE_MS);
+}
+
+power_state_t power_idle(power_state_t deepest, uint32_t ticks) {
+  power_state_t state = deepest;
+  if (state == POWER_STOP) {
+    if (ticks < POWER_STOP_MIN_TICKS) {
+      stats.too_soon++;
+      state = POWER_SLEEP;
+    } else if (!uart_quiet() || stop_vetoed()) {
+      stats.vetoed++;
+      state = POWER_SLEEP;
+    }
+  }
+
+  if (state == POWER_STOP) enter_stop(ticks);
+  else if (state == POWER_SLEEP) enter_sleep();
+  stats.entries[state]++;
+  return state;
+}
+
+uint32_t power_average_ua(const power_stats_t *s) {
+  static const uint32_t ua[POWER_NUM_STATES] = { POWER_RUN_UA, POWER_SLEEP_UA, POWER_STOP_UA };
+  uint64_t total = 0, charge = 0;
+  for (uint32_t i = 0; i < POWER_NUM_STATES; i++) {
+    total += s->lp[i];
+    charge += s->lp[i] * ua[i];
+  }
+  return total ? (uint32_t)(charge / total) : 0U;
+}
+
+void power_report(void) {
+  static const char *const names[POWER_NUM_STATES] = { "run", "sleep", "stop" };
+  const power_stats_t *s = power_stats();
+  uint64_t total = s->lp[POWER_RUN] + s->lp[POWER_SLEEP] + s->lp[POWER_STOP];
+
+  console_printf("\r\npower over %lu ms, LPTIM1 at %lu Hz (%s)\r\n",
+                 (unsigned long)(total * 1000U / lp_hz), (unsigned long)lp_hz,
+                 lp_hz == LSE_HZ ? "LSE" : "LSI");
+  for (uint32_t i = 0; i < POWER_NUM_STATES; i++) {
+    console_printf("  %-6s %10lu ms %5lu.%lu%% %8lu entries\r\n", names[i],
+                   (unsigned long)(s->lp[i] * 1000U / lp_hz),
+                   (unsigned long)(total ? s->lp[i] * 100U / total : 0U),
+                   (unsigned long)(total ? s->lp[i] * 1000U / total % 10U : 0U),
+                   (unsigned long)s->entries[i]);
+  }
+  console_printf("  stop refused: %lu busy, %lu timer too soon\r\n",
+                 (unsigned long)s->vetoed, (unsigned long)s->too_soon);
+  console_printf("  woken by: uart %lu, button %lu, timer %lu, other %lu\r\n",
+                 (unsigned long)s->wake_uart, (unsigned long)s->wake_button,
+                 (unsigned long)s->wake_timer, (unsigned long)s->wake_other);
+  uint32_t stops = s->entries[POWER_STOP];
+  console_printf("  clock restore: mean %lu us, max %lu us, %lu failed\r\n",
+                 (unsigned long)(stops ? s->restore_sum * 1000000U / lp_hz / stops : 0U),
+                 (unsigned long)((uint64_t)s->restore_max * 1000000U / lp_hz),
+                 (unsigned long)s->restore_failed);
+  console_printf("  est. %lu uA average (assumed run %u, sleep %u, stop %u uA)\r\n",
+                 (unsigned long)power_average_ua(s), POWER_RUN_UA, POWER_SLEEP_UA, POWER_STOP_UA);
+}
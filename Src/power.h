@@ -0,0 +1,136 @@
+/*
+ * power.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Low-power idle. The main loop calls power_idle() when it has nothing
+ * left to do, and the core sleeps as deeply as what is still going on
+ * allows:
+ * * Sleep: WFI with the clocks running. Any interrupt wakes the core,
+ *   SysTick included, so at least every tick. PM0253 Rev 5 Sec 2.5
+ * * Stop: WFI with SLEEPDEEP. The PLL, the HSE and every clock taken from
+ *   them stop, the regulator goes to low-power mode and the flash is
+ *   powered down (LPDS, FPDS). Only EXTI lines wake the core: the user
+ *   button (EXTI13, button.c), the USART3 RX pin (EXTI9: the falling
+ *   edge of a start bit on PD9) and LPTIM1 (EXTI23) for a timed wake-up.
+ *   The core comes back on the 16MHz HSI; if it was on the PLL,
+ *   power_idle() runs clock_init() again before it returns.
+ *   RM0410 Rev 5 Sec 4.3.6 p 139
+ *
+ * Stop is only used when it is worth it and safe: the next timer is at
+ * least POWER_STOP_MIN_TICKS away (LPTIM1 wakes the core early enough to
+ * have the clocks back by then), and no busy() function in the table
+ * given to power_init() says no. Anything clocked from the core or an
+ * APB would freeze part way: a USART sending, TIM7 debouncing, a DMA
+ * waveform. SysTick stops too; power_idle() adds the ticks it missed.
+ *
+ * The byte whose start bit wakes the core from Stop is lost, and so is
+ * any that follows within the wake-up time: the USART has no clock to
+ * receive it with. A host should send a 0x00 and wait a millisecond
+ * before a command (cmd.c takes extra 0x00s as empty frames), or resend
+ * when no answer comes. After any USART3 input Stop waits until the
+ * line has been quiet for POWER_UART_AWAKE_MS, so the rest of a command
+ * gets through. USART3 runs from the HSI so that its baud rate is
+ * right as soon as the core wakes, before the PLL is back.
+ *
+ * LPTIM1 counts the LSE (32.768kHz crystal), or the LSI if that does not
+ * start, all the time: it is the one clock that runs in every state, so
+ * the time in each is counted with it.
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <stdint.h>
+
+typedef enum {
+  POWER_RUN = 0,  // No sleeping: power_idle() returns at once
+  POWER_SLEEP,
+  POWER_STOP,
+  POWER_NUM_STATES
+} power_state_t;
+
+// Stop is not worth the wake-up below this many ticks to the next timer
+#ifndef POWER_STOP_MIN_TICKS
+#define POWER_STOP_MIN_TICKS 3U
+#endif
+
+// How long before a timer LPTIM1 wakes the core from Stop: the wake-up
+// itself (DS11532 tWUSTOP, about 100us with the low-power regulator) plus
+// the HSE and the PLL starting again
+#ifndef POWER_WAKE_EARLY_US
+#define POWER_WAKE_EARLY_US 500U
+#endif
+
+// Supply current in each state at 3.3V, in uA: rough figures of the order
+// of the datasheet's (DS11532 Sec 6.3.6), not measurements. Measure on the
+// board with an ammeter in place of the IDD jumper JP5 and set these to
+// match.
+#ifndef POWER_RUN_UA
+#define POWER_RUN_UA   150000U  // 216MHz, caches on
+#define POWER_SLEEP_UA  70000U  // 216MHz, core clock stopped
+#define POWER_STOP_UA     350U  // Low-power regulator, flash powered down
+#endif
+
+// How long Stop is refused after USART3 input, in ms: time for the rest
+// of a command to arrive and be answered
+#ifndef POWER_UART_AWAKE_MS
+#define POWER_UART_AWAKE_MS 20U
+#endif
+
+#ifndef POWER_IRQ_PRIORITY
+#define POWER_IRQ_PRIORITY 14U
+#endif
+
+// power_init() flags
+#define POWER_WAKE_UART3 (1UL << 0)  // Wake from Stop on USART3 input
+
+// No timer to wake for
+#define POWER_NO_TIMER 0xFFFFFFFFUL
+
+// Says whether Stop would break something in progress
+typedef int (*power_busy_t)(void);
+
+typedef struct {
+  uint64_t lp[POWER_NUM_STATES];        // Time in each state, LPTIM1 counts
+  uint32_t entries[POWER_NUM_STATES];   // power_idle() calls ending in each
+  uint32_t wake_uart;      // Stop ended by a start bit on USART3 RX
+  uint32_t wake_button;
+  uint32_t wake_timer;     // LPTIM1: a timer due, or its 2s wrap
+  uint32_t wake_other;
+  uint32_t vetoed;         // Slept instead of Stop: a busy() said no, or
+                           // USART3 input came in just now
+  uint32_t too_soon;       // Slept instead of Stop: a timer was due too soon
+  uint32_t restore_max;    // clock_init() after Stop, LPTIM1 counts
+  uint64_t restore_sum;
+  uint32_t restore_failed; // clock_init() failed: left on the HSI
+} power_stats_t;
+
+// Start LPTIM1 and the wake-up lines. busy[0..n-1] are asked before each
+// Stop; the table must stay valid. Call after clock_init() and
+// tick_init(), and after uart_open() for POWER_WAKE_UART3.
+void power_init(const power_busy_t *busy, uint32_t n, uint32_t flags);
+
+// Sleep until an interrupt, no deeper than `deepest`, with the next
+// timer `ticks` away (or POWER_NO_TIMER). Call with interrupts masked,
+// having checked there is no work; they are still masked on return and
+// the interrupt that woke the core runs once they are unmasked. Returns
+// the state it slept in.
+power_state_t power_idle(power_state_t deepest, uint32_t ticks);
+
+// LPTIM1 counts since power_init(), and their rate in Hz
+uint64_t power_lp_now(void);
+uint32_t power_lp_hz(void);
+
+// Up to date as of now; lp[POWER_RUN] is whatever was not spent asleep
+const power_stats_t *power_stats(void);
+void power_reset_stats(void);
+
+// Average supply current from the time in each state and POWER_*_UA
+uint32_t power_average_ua(const power_stats_t *s);
+
+// console_printf() the statistics
+void power_report(void);
+
+#endif /* POWER_H_ */
@@ -0,0 +1,91 @@
+/*
+ * prof.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Probe statistics and reporting. See prof.h.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "console.h"
+#include "critical.h"
+#include "cycles.h"
+#include "prof.h"
+
+static prof_site_t *sites;
+
+void prof_init(void) {
+  // Leave it running if something started it already: zeroing it under
+  // a probe (or boot's timings) would make their spans nonsense
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) cycles_init();
+}
+
+static uint32_t bucket(uint32_t cycles) {
+  return 31U - (uint32_t)__builtin_clz(cycles | 1U);
+}
+
+void prof_record(prof_site_t *site, uint32_t cycles) {
+  uint32_t primask = critical_enter();
+
+  if (!site->listed) {
+    site->next = sites;
+    sites = site;
+    site->listed = 1;
+  }
+  if (!site->count || cycles < site->min) site->min = cycles;
+  if (cycles > site->max) site->max = cycles;
+  site->count++;
+  site->sum += cycles;
+  site->hist[bucket(cycles)]++;
+
+  critical_exit(primask);
+}
+
+prof_site_t *prof_sites(void) {
+  return sites;
+}
+
+prof_site_t *prof_find(const char *name) {
+  for (prof_site_t *s = sites; s; s = s->next) {
+    if (!strcmp(s->name, name)) return s;
+  }
+  return 0;
+}
+
+void prof_reset(void) {
+  uint32_t primask = critical_enter();
+  for (prof_site_t *s = sites; s; s = s->next) {
+    s->count = s->min = s->max = 0;
+    s->sum = 0;
+    memset(s->hist, 0, sizeof(s->hist));
+  }
+  critical_exit(primask);
+}
+
+void prof_report(void) {
+  console_printf("\r\nprobe                count        min       mean        max  (cycles)\r\n");
+  for (prof_site_t *s = sites; s; s = s->next) {
+    // Copy so the line is consistent even if the site records meanwhile
+    uint32_t primask = critical_enter();
+    prof_site_t c = *s;
+    critical_exit(primask);
+
+    if (!c.count) continue;
+    console_printf("%-16s %9lu %10lu %10lu %10lu\r\n", c.name, (unsigned long)c.count,
+                   (unsigned long)c.min, (unsigned long)(c.sum / c.count), (unsigned long)c.max);
+
+    // Histogram: one "2^k:n" pair per occupied bucket
+    console_printf("  log2");
+    for (uint32_t k = 0; k < PROF_BUCKETS; k++) {
+      if (c.hist[k]) console_printf(" %lu:%lu", (unsigned long)k, (unsigned long)c.hist[k]);
+    }
+    console_printf("\r\n");
+  }
+}
@@ -0,0 +1,104 @@
+/*
+ * prof.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Cycle-count profiling probes on DWT->CYCCNT (see cycles.h).
+ *
+ * Each probe site is a static record, created where it is used:
+ *
+ *   PROF_BEGIN(uart_tx_wait);
+ *   while (!(USART3->ISR & USART_ISR_TXE));
+ *   PROF_END(uart_tx_wait);
+ *
+ * or, for a whole block, PROF_SCOPE(name) - which ends when the
+ * enclosing block is left, however that happens.
+ *
+ * Sites keep count, min, max, mean and a log2 histogram of cycles, and
+ * link themselves into a list the first time they record, so that
+ * prof_report() can print every site that has run.
+ *
+ * Build with PROF_ENABLE=0 and every probe compiles to nothing.
+ * The cost when enabled is two CYCCNT reads plus prof_record(), which
+ * masks interrupts for the update so that sites may be used in handlers.
+ */
+
+#ifndef PROF_H_
+#define PROF_H_
+
+#include <stdint.h>
+
+#ifndef PROF_ENABLE
+#define PROF_ENABLE 1
+#endif
+
+// hist[k] counts durations of 2^k to 2^(k+1)-1 cycles (hist[0] includes 0)
+#define PROF_BUCKETS 32U
+
+typedef struct prof_site {
+  const char *name;
+  struct prof_site *next;  // Sites that have recorded, newest first
+  uint8_t listed;
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  uint32_t hist[PROF_BUCKETS];
+} prof_site_t;
+
+// Start the cycle counter, unless it is already running. Call before
+// anything that is probed.
+void prof_init(void);
+
+// Add one duration to a site
+void prof_record(prof_site_t *site, uint32_t cycles);
+
+// Sites that have recorded something, newest first; walk with ->next
+prof_site_t *prof_sites(void);
+
+// Site by name, or NULL if it has not recorded yet
+prof_site_t *prof_find(const char *name);
+
+// printf() every site's statistics and histogram
+void prof_report(void);
+
+// Clear every site's statistics
+void prof_reset(void);
+
+#if PROF_ENABLE
+
+#include "cycles.h"
+
+typedef struct {
+  prof_site_t *site;
+  uint32_t t0;
+} prof_probe_t;
+
+static inline void prof_scope_end(prof_probe_t *p) {
+  prof_record(p->site, cycles_now() - p->t0);
+}
+
+#define PROF_SITE(NAME) prof_site_##NAME
+
+#define PROF_BEGIN(NAME) \
+  static prof_site_t PROF_SITE(NAME) = { #NAME, 0, 0, 0, 0, 0, 0, { 0 } }; \
+  uint32_t prof_t0_##NAME = cycles_now()
+
+#define PROF_END(NAME) \
+  prof_record(&PROF_SITE(NAME), cycles_now() - prof_t0_##NAME)
+
+#define PROF_SCOPE(NAME) \
+  static prof_site_t PROF_SITE(NAME) = { #NAME, 0, 0, 0, 0, 0, 0, { 0 } }; \
+  prof_probe_t prof_probe_##NAME __attribute__((cleanup(prof_scope_end))) = \
+    { &PROF_SITE(NAME), cycles_now() }
+
+#else
+
+#define PROF_BEGIN(NAME) do { } while (0)
+#define PROF_END(NAME)   do { } while (0)
+#define PROF_SCOPE(NAME) do { } while (0)
+
+#endif /* PROF_ENABLE */
+
+#endif /* PROF_H_ */
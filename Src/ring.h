@@ -0,0 +1,176 @@
+/*
+ * ring.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Single-producer/single-consumer byte ring buffer.
+ *
+ * The head and tail are free-running 32-bit counters; only the producer
+ * writes head and only the consumer writes tail, so one side can be an
+ * interrupt handler and the other the main loop without any locking.
+ * The buffer size must be a power of two so the counters can be masked
+ * into an index and used = head - tail works across wrap-around.
+ *
+ * Each side reads the other's counter with acquire ordering and publishes
+ * its own with release ordering, so the bytes are in memory before the
+ * counter that covers them says so, and are read only after it has. The
+ * Cortex-M7 may reorder accesses to Normal memory (PM0253 Rev 5 Sec
+ * 2.2.6), which matters once the other side is a DMA stream or another
+ * bus master; for that GCC puts a DMB after the acquiring load and before
+ * the releasing store (ARMv7-M has no LDA/STL). When both sides are on
+ * this core - a handler and thread mode - program order is enough, and
+ * -DRING_DMB=0 leaves only the compiler ordering. The host build always
+ * uses the atomics, so ThreadSanitizer can check them (Sim/ring-bench.cpp).
+ *
+ * Bulk copies (ring_write(), ring_read()) move the counter once per call.
+ * For DMA, ring_reserve()/ring_commit() and ring_peek()/ring_consume()
+ * hand out the contiguous space or data up to the wrap, so a stream can
+ * fill or drain the buffer in place. Src/mpsc.h is the multi-producer
+ * counterpart, of fixed-size items.
+ */
+
+#ifndef RING_H_
+#define RING_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// DMB around the counters on the target; see above
+#ifndef RING_DMB
+#define RING_DMB 1
+#endif
+
+typedef struct {
+  uint8_t *buf;
+  uint32_t mask;           // size - 1
+  volatile uint32_t head;  // Next slot to write; producer only
+  volatile uint32_t tail;  // Next slot to read; consumer only
+} ring_t;
+
+// Static initializer; SIZE must be a power of two
+#define RING_INIT(BUF, SIZE) { (BUF), (SIZE) - 1U, 0U, 0U }
+
+// Keep the compiler from moving buffer accesses across index updates
+#define RING_BARRIER() __asm volatile ("" ::: "memory")
+
+// The other side's counter, and this side's once its bytes are done with
+#if defined(__arm__) && !RING_DMB
+#define RING_LOAD_ACQUIRE(P) \
+  ({ uint32_t v_ = __atomic_load_n((P), __ATOMIC_RELAXED); RING_BARRIER(); v_; })
+#define RING_STORE_RELEASE(P, V) \
+  do { RING_BARRIER(); __atomic_store_n((P), (V), __ATOMIC_RELAXED); } while (0)
+#else
+#define RING_LOAD_ACQUIRE(P)     __atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define RING_STORE_RELEASE(P, V) __atomic_store_n((P), (V), __ATOMIC_RELEASE)
+#endif
+
+// A side's own counter, which only it writes
+#define RING_LOAD_OWN(P) __atomic_load_n((P), __ATOMIC_RELAXED)
+
+static inline uint32_t ring_size(const ring_t *r) {
+  return r->mask + 1U;
+}
+
+static inline uint32_t ring_used(const ring_t *r) {
+  uint32_t tail = RING_LOAD_ACQUIRE(&r->tail);
+  return RING_LOAD_ACQUIRE(&r->head) - tail;
+}
+
+static inline uint32_t ring_free(const ring_t *r) {
+  return ring_size(r) - ring_used(r);
+}
+
+static inline int ring_empty(const ring_t *r) {
+  return ring_used(r) == 0U;
+}
+
+static inline int ring_full(const ring_t *r) {
+  return ring_used(r) == ring_size(r);
+}
+
+// Producer: add one byte. Returns 0 if the ring is full.
+static inline int ring_put(ring_t *r, uint8_t c) {
+  uint32_t head = RING_LOAD_OWN(&r->head);
+  if (head - RING_LOAD_ACQUIRE(&r->tail) == ring_size(r)) return 0;
+  r->buf[head & r->mask] = c;
+  RING_STORE_RELEASE(&r->head, head + 1U);
+  return 1;
+}
+
+// Consumer: remove one byte. Returns 0 if the ring is empty.
+static inline int ring_get(ring_t *r, uint8_t *c) {
+  uint32_t tail = RING_LOAD_OWN(&r->tail);
+  if (tail == RING_LOAD_ACQUIRE(&r->head)) return 0;
+  *c = r->buf[tail & r->mask];
+  RING_STORE_RELEASE(&r->tail, tail + 1U);
+  return 1;
+}
+
+// Producer: copy up to len bytes in (at most two memcpy's around the wrap).
+// Returns the number of bytes actually added.
+static inline uint32_t ring_write(ring_t *r, const uint8_t *src, uint32_t len) {
+  uint32_t head = RING_LOAD_OWN(&r->head);
+  uint32_t space = ring_size(r) - (head - RING_LOAD_ACQUIRE(&r->tail));
+  if (len > space) len = space;
+
+  uint32_t idx = head & r->mask;
+  uint32_t first = ring_size(r) - idx;
+  if (first > len) first = len;
+  memcpy(&r->buf[idx], src, first);
+  memcpy(&r->buf[0], src + first, len - first);
+
+  RING_STORE_RELEASE(&r->head, head + len);
+  return len;
+}
+
+// Producer: the free space from head up to the wrap, for filling in
+// place (e.g. by a formatter); *len is its size, which may be 0. Then
+// ring_commit() however much of it was written.
+static inline uint8_t *ring_reserve(const ring_t *r, uint32_t *len) {
+  uint32_t head = RING_LOAD_OWN(&r->head);
+  uint32_t space = ring_size(r) - (head - RING_LOAD_ACQUIRE(&r->tail));
+  uint32_t idx = head & r->mask;
+  uint32_t first = ring_size(r) - idx;
+  *len = first < space ? first : space;
+  return &r->buf[idx];
+}
+
+static inline void ring_commit(ring_t *r, uint32_t len) {
+  RING_STORE_RELEASE(&r->head, RING_LOAD_OWN(&r->head) + len);
+}
+
+// Consumer: copy up to len bytes out. Returns the number of bytes removed.
+static inline uint32_t ring_read(ring_t *r, uint8_t *dst, uint32_t len) {
+  uint32_t tail = RING_LOAD_OWN(&r->tail);
+  uint32_t avail = RING_LOAD_ACQUIRE(&r->head) - tail;
+  if (len > avail) len = avail;
+
+  uint32_t idx = tail & r->mask;
+  uint32_t first = ring_size(r) - idx;
+  if (first > len) first = len;
+  memcpy(dst, &r->buf[idx], first);
+  memcpy(dst + first, &r->buf[0], len - first);
+
+  RING_STORE_RELEASE(&r->tail, tail + len);
+  return len;
+}
+
+// Consumer: the data from tail up to the wrap, for reading in place (e.g.
+// as a DMA stream's source); *len is its size, which may be 0. Then
+// ring_consume() however much of it was used - for DMA, once the stream
+// has finished with it.
+static inline const uint8_t *ring_peek(const ring_t *r, uint32_t *len) {
+  uint32_t tail = RING_LOAD_OWN(&r->tail);
+  uint32_t avail = RING_LOAD_ACQUIRE(&r->head) - tail;
+  uint32_t idx = tail & r->mask;
+  uint32_t first = ring_size(r) - idx;
+  *len = first < avail ? first : avail;
+  return &r->buf[idx];
+}
+
+static inline void ring_consume(ring_t *r, uint32_t len) {
+  RING_STORE_RELEASE(&r->tail, RING_LOAD_OWN(&r->tail) + len);
+}
+
+#endif /* RING_H_ */
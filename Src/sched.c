@@ -0,0 +1,183 @@
+/*
+ * sched.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Cooperative timer-wheel scheduler. See sched.h.
+ *
+ * Each wheel slot is a circular doubly-linked list with its own sentinel,
+ * so a timer can be unlinked without knowing which slot it is in.
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "console.h"
+#include "critical.h"
+#include "sched.h"
+#include "tick.h"
+
+#if (SCHED_WHEEL_SLOTS & (SCHED_WHEEL_SLOTS - 1U)) != 0
+#error "SCHED_WHEEL_SLOTS must be a power of two"
+#endif
+
+#define SLOT_MASK (SCHED_WHEEL_SLOTS - 1U)
+
+static sched_link_t wheel[SCHED_WHEEL_SLOTS];
+static uint32_t sched_tick; // Last tick whose slot has been run
+
+static void list_init(sched_link_t *l) {
+  l->next = l->prev = l;
+}
+
+static void list_unlink(sched_link_t *l) {
+  l->prev->next = l->next;
+  l->next->prev = l->prev;
+  l->next = l->prev = l;
+}
+
+static void list_append(sched_link_t *head, sched_link_t *l) {
+  l->prev = head->prev;
+  l->next = head;
+  head->prev->next = l;
+  head->prev = l;
+}
+
+static void wheel_insert(sched_timer_t *t) {
+  list_append(&wheel[t->due & SLOT_MASK], &t->link);
+  t->active = 1;
+}
+
+void sched_init(void) {
+  for (uint32_t i = 0; i < SCHED_WHEEL_SLOTS; i++) list_init(&wheel[i]);
+  sched_tick = tick_now();
+}
+
+void sched_reset_stats(sched_timer_t *t) {
+  t->runs = 0;
+  t->late_min = 0xFFFFFFFFUL;
+  t->late_max = 0;
+  t->late_sum = 0;
+  t->skipped = 0;
+}
+
+void sched_start(sched_timer_t *t, const char *name, uint32_t delay,
+                 uint32_t period, sched_fn_t fn, void *arg) {
+  sched_stop(t);
+  t->name = name;
+  t->fn = fn;
+  t->arg = arg;
+  t->period = period;
+  t->due = tick_now() + (delay ? delay : 1U);
+  sched_reset_stats(t);
+  wheel_insert(t);
+}
+
+void sched_stop(sched_timer_t *t) {
+  if (t->active) list_unlink(&t->link);
+  t->active = 0;
+}
+
+int sched_run(void) {
+  uint32_t now = tick_now();
+  int ran = 0;
+
+  while (sched_tick != now) {
+    uint32_t k = ++sched_tick;
+    sched_link_t *slot = &wheel[k & SLOT_MASK];
+    sched_link_t due;
+    sched_link_t *l, *next;
+
+    // Take this tick's timers off the wheel first, so callbacks are free
+    // to start and stop timers (including each other) as they run
+    list_init(&due);
+    for (l = slot->next; l != slot; l = next) {
+      next = l->next;
+      if (((sched_timer_t *)l)->due == k) {
+        list_unlink(l);
+        list_append(&due, l);
+      }
+    }
+
+    while (due.next != &due) {
+      sched_timer_t *t = (sched_timer_t *)due.next;
+      uint32_t late = tick_cycles_since(k);
+
+      list_unlink(&t->link);
+      t->active = 0;
+
+      t->runs++;
+      t->late_sum += late;
+      if (late < t->late_min) t->late_min = late;
+      if (late > t->late_max) t->late_max = late;
+
+      // Re-arm before the callback so that it can stop itself. Keep the
+      // phase, but drop runs we are already a whole period late for.
+      if (t->period) {
+        t->due = k + t->period;
+        while ((int32_t)(t->due - tick_now()) < 0) {
+          t->due += t->period;
+          t->skipped++;
+        }
+        wheel_insert(t);
+      }
+
+      t->fn(t->arg);
+      ran++;
+    }
+  }
+
+  return ran;
+}
+
+void sched_wait(void) {
+  // Sleep only if no tick arrived since sched_run() looked. With
+  // interrupts masked WFI still wakes on the pending SysTick, which
+  // then runs as soon as we unmask.
+  uint32_t primask = critical_enter();
+  if (tick_now() == sched_tick) __WFI();
+  critical_exit(primask);
+}
+
+uint32_t sched_ticks_to_next(void) {
+  uint32_t now = tick_now();
+  if (now != sched_tick) return 0;
+
+  // Every timer's due is after sched_tick, or it would have run
+  uint32_t best = SCHED_NEVER;
+  for (uint32_t i = 0; i < SCHED_WHEEL_SLOTS; i++) {
+    for (sched_link_t *l = wheel[i].next; l != &wheel[i]; l = l->next) {
+      uint32_t d = ((sched_timer_t *)l)->due - now;
+      if (d < best) best = d;
+    }
+  }
+  return best;
+}
+
+void sched_loop(void) {
+  for (;;) {
+    sched_run();
+    sched_wait();
+  }
+}
+
+static void report_slot(sched_link_t *slot) {
+  for (sched_link_t *l = slot->next; l != slot; l = l->next) {
+    const sched_timer_t *t = (const sched_timer_t *)l;
+    if (!t->runs) continue;
+    console_printf("%-12s %6lu %8lu %8lu %8lu %8lu %8lu\r\n",
+                   t->name ? t->name : "?", (unsigned long)t->period, (unsigned long)t->runs,
+                   (unsigned long)t->late_min, (unsigned long)(t->late_sum / t->runs),
+                   (unsigned long)t->late_max, (unsigned long)t->skipped);
+  }
+}
+
+void sched_report(void) {
+  console_printf("timer        period     runs      min     mean      max  skipped"
+                 "  (late, core clocks)\r\n");
+  for (uint32_t i = 0; i < SCHED_WHEEL_SLOTS; i++) report_slot(&wheel[i]);
+}
@@ -0,0 +1,92 @@
+/*
+ * sched.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Cooperative timer-wheel scheduler on the tick.h time base.
+ *
+ * Timers live in a hashed wheel of SCHED_WHEEL_SLOTS lists indexed by
+ * (due tick % slots), so starting and stopping a timer is O(1), and each
+ * tick only looks at one slot. Timers more than SCHED_WHEEL_SLOTS ticks
+ * away share the slot and are passed over until their lap comes round.
+ *
+ * Callbacks run from sched_run() in thread mode, never from the tick
+ * interrupt, so they may take their time - at the cost of delaying
+ * whatever is due after them. Each timer records how late its callbacks
+ * ran (from the start of the tick it was due in, in core clocks) so that
+ * jitter can be measured; see sched_report().
+ *
+ * Not thread safe: start, stop and run timers from thread mode only.
+ * sched_timer_t must start out zeroed (static, or = {0}).
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdint.h>
+
+// Power of two; timers up to this many ticks away are never passed over
+#ifndef SCHED_WHEEL_SLOTS
+#define SCHED_WHEEL_SLOTS 256U
+#endif
+
+typedef void (*sched_fn_t)(void *arg);
+
+typedef struct sched_link {
+  struct sched_link *next;
+  struct sched_link *prev;
+} sched_link_t;
+
+typedef struct sched_timer {
+  sched_link_t link;         // Wheel slot list; must be first
+  uint32_t due;              // Tick this runs in next
+  uint32_t period;           // Ticks between runs; 0 = one shot
+  sched_fn_t fn;
+  void *arg;
+  const char *name;
+  uint8_t active;
+
+  // Lateness of each run, in core clocks after the start of its due tick
+  uint32_t runs;
+  uint32_t late_min;
+  uint32_t late_max;
+  uint64_t late_sum;
+  uint32_t skipped;          // Periods dropped because a run was a whole period late
+} sched_timer_t;
+
+// Empty the wheel. tick_init() must have been called.
+void sched_init(void);
+
+// Run fn(arg) in `delay` ticks (at least 1), then every `period` ticks
+// if that is not 0. Restarts the timer if it is already running.
+// name is only used by sched_report().
+void sched_start(sched_timer_t *t, const char *name, uint32_t delay,
+                 uint32_t period, sched_fn_t fn, void *arg);
+
+// Stop a timer; safe on a stopped timer and from inside callbacks
+void sched_stop(sched_timer_t *t);
+
+// Run every callback that is due. Returns how many ran.
+int sched_run(void);
+
+// Sleep (WFI) until the next tick, unless one has already arrived
+// since sched_run() last looked
+void sched_wait(void);
+
+// Ticks until the next callback is due: 0 if one is due now or a tick has
+// arrived that sched_run() has not looked at, SCHED_NEVER if no timer is
+// running. For choosing how deeply to sleep; call with interrupts masked.
+#define SCHED_NEVER 0xFFFFFFFFUL
+uint32_t sched_ticks_to_next(void);
+
+// Run callbacks forever, sleeping (WFI) whenever nothing is due
+void sched_loop(void) __attribute__((noreturn));
+
+// Clear one timer's lateness statistics
+void sched_reset_stats(sched_timer_t *t);
+
+// printf() the lateness statistics of every running timer, in core clocks
+void sched_report(void);
+
+#endif /* SCHED_H_ */
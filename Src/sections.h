@@ -0,0 +1,51 @@
+/*
+ * sections.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Attributes to place code and data in a particular memory.
+ * Memory map: RM0410 Rev 5 Sec 2.2.2 p 77; bus matrix Sec 2.1 p 69.
+ *
+ * * ITCM-RAM 0x00000000  16K - instruction TCM: zero-wait-state fetch at
+ *                              216MHz, not cached. Copied from flash at reset.
+ * * DTCM-RAM 0x20000000 128K - data TCM: zero-wait-state, never cached, so
+ *                              also safe for DMA buffers with the D-cache on.
+ *                              Holds the main stack (at the top), with an
+ *                              MPU guard region below it (memstat.h).
+ * * SRAM1    0x20020000 368K - .data, .bss and the heap. Cached (write-back):
+ *                              DMA buffers here need cache maintenance.
+ * * SRAM2    0x2007C000  16K - a separate bank, for DMA that should not
+ *                              contend with the CPU on SRAM1.
+ * Flash    0x08000000 2M   - sector 0 is the resident loader (loader.h),
+ *                              sector 1 the update descriptor, and the
+ *                              application starts at 0x08008000.
+ *
+ * See STM32F767ZITX_FLASH.ld for the sections these name.
+ */
+
+#ifndef SECTIONS_H_
+#define SECTIONS_H_
+
+// Hot functions and interrupt handlers. Calls between ITCM and flash are
+// too far for BL; the linker adds a veneer, so keep the hot loop itself
+// within ITCM code.
+#define ITCM_CODE     __attribute__((section(".itcm"), noinline))
+
+// Hot or DMA-shared data: initialized, and zeroed at reset, respectively
+#define DTCM_DATA     __attribute__((section(".dtcm_data")))
+#define DTCM_BSS      __attribute__((section(".dtcm_bss")))
+
+// Large buffers that are NOT initialized or zeroed at reset: they cost
+// nothing at boot, and keep their contents over a watchdog or software
+// reset. Code written for the usual ".noinit" section name gets SRAM1.
+#define SRAM1_NOINIT  __attribute__((section(".sram1_noinit")))
+#define SRAM2_NOINIT  __attribute__((section(".sram2_noinit")))
+#define DTCM_NOINIT   __attribute__((section(".dtcm_noinit")))
+
+// The resident loader, alone in flash sector 0: its vector table first,
+// then its code. An update never rewrites it.
+#define LOADER_VECTORS __attribute__((section(".loader_vectors"), used))
+#define LOADER_CODE    __attribute__((section(".loader")))
+
+#endif /* SECTIONS_H_ */
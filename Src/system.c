@@ -0,0 +1,36 @@
+/*
+ * system.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * SystemInit(): called by Reset_Handler before .data and .bss are set up,
+ * so nothing here may use a global or static variable.
+ *
+ * L1 caches: Cortex-M7 PM0253 Rev 5 Sec 4.8 and TRM Sec 5.
+ * Both caches come out of reset disabled with undefined contents, so each
+ * has to be invalidated before it is enabled. The CMSIS helpers do the
+ * invalidate (by set/way for the D-cache), enable, and DSB/ISB sequence.
+ *
+ * With the D-cache on (write-back), memory a DMA reads or writes must be
+ * in DTCM-RAM, which is never cached, or be cleaned/invalidated around
+ * the transfer. See sections.h.
+ *
+ * VTOR: the loader (loader.h) has already pointed it at this vector
+ * table when starting from flash; setting it again covers a start
+ * straight into Reset_Handler, such as the RAM build.
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+extern uint32_t g_pfnVectors[];
+
+void SystemInit(void) {
+  SCB->VTOR = (uint32_t)g_pfnVectors;
+  SCB_EnableICache();
+  SCB_EnableDCache();
+}
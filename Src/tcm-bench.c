@@ -0,0 +1,105 @@
+/*
+ * tcm-bench.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * See tcm-bench.h.
+ *
+ * At 216MHz flash needs 7 wait states (RM0410 Rev 5 Sec 3.3.2 p 89), and
+ * code at 0x08000000 is fetched over AXIM, which the ART accelerator does
+ * not serve. So with the I-cache off each fetch from flash stalls, while
+ * ITCM-RAM is always zero-wait-state; once the loop is in the I-cache
+ * both should run at the same rate. SRAM1 data goes through the
+ * D-cache (or the AXI bus when it is off); DTCM never does.
+ *
+ * Each case is timed twice with interrupts masked: "cold" right after
+ * switching the caches, then "warm".
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "console.h"
+#include "critical.h"
+#include "cycles.h"
+#include "sections.h"
+#include "tcm-bench.h"
+
+#define BENCH_WORDS 512U
+
+DTCM_BSS static uint32_t dtcm_buf[BENCH_WORDS];
+static uint32_t sram1_buf[BENCH_WORDS];
+
+// The same loop twice: once left in flash, once copied to ITCM
+#define SUM_BODY                                  \
+  uint32_t s = 0;                                 \
+  for (uint32_t i = 0; i < n; i++) {              \
+    s = ((s << 1) | (s >> 31)) ^ buf[i];          \
+  }                                               \
+  return s;
+
+__attribute__((noinline))
+static uint32_t sum_flash(const uint32_t *buf, uint32_t n) { SUM_BODY }
+
+ITCM_CODE
+static uint32_t sum_itcm(const uint32_t *buf, uint32_t n) { SUM_BODY }
+
+typedef uint32_t (*sum_fn_t)(const uint32_t *buf, uint32_t n);
+
+static volatile uint32_t sink; // Keeps the sums from being optimized away
+
+static void set_caches(int on) {
+  if (on) {
+    SCB_EnableICache();
+    SCB_EnableDCache();
+  } else {
+    SCB_DisableDCache(); // Cleans first, so no data is lost
+    SCB_DisableICache();
+  }
+}
+
+static void run(const char *code, sum_fn_t fn, const char *data,
+                const uint32_t *buf, int caches) {
+  uint32_t cold, warm, t0;
+  uint32_t primask = critical_enter();
+
+  set_caches(caches);
+  t0 = cycles_now();
+  sink = fn(buf, BENCH_WORDS);
+  cold = cycles_now() - t0;
+  t0 = cycles_now();
+  sink = fn(buf, BENCH_WORDS);
+  warm = cycles_now() - t0;
+
+  critical_exit(primask);
+
+  console_printf("%-6s %-6s %-4s %8lu.%02lu %8lu.%02lu\r\n", code, data, caches ? "on" : "off",
+                 (unsigned long)(cold / BENCH_WORDS), (unsigned long)(cold * 100U / BENCH_WORDS % 100U),
+                 (unsigned long)(warm / BENCH_WORDS), (unsigned long)(warm * 100U / BENCH_WORDS % 100U));
+}
+
+void tcm_bench(void) {
+  int was_on = (SCB->CCR & SCB_CCR_IC_Msk) != 0;
+
+  for (uint32_t i = 0; i < BENCH_WORDS; i++) {
+    dtcm_buf[i] = sram1_buf[i] = i * 2654435761UL;
+  }
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) cycles_init();
+
+  console_printf("\r\ncycles per iteration of a %u word loop\r\n", BENCH_WORDS);
+  console_printf("code   data   $        cold        warm\r\n");
+  run("flash", sum_flash, "SRAM1", sram1_buf, 0);
+  run("flash", sum_flash, "DTCM", dtcm_buf, 0);
+  run("ITCM", sum_itcm, "SRAM1", sram1_buf, 0);
+  run("ITCM", sum_itcm, "DTCM", dtcm_buf, 0);
+  run("flash", sum_flash, "SRAM1", sram1_buf, 1);
+  run("flash", sum_flash, "DTCM", dtcm_buf, 1);
+  run("ITCM", sum_itcm, "SRAM1", sram1_buf, 1);
+  run("ITCM", sum_itcm, "DTCM", dtcm_buf, 1);
+
+  set_caches(was_on);
+}
@@ -0,0 +1,18 @@
+/*
+ * tcm-bench.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Cycle-count comparison of the memories hot code and data can live in:
+ * the same loop run from flash and from ITCM-RAM, over data in SRAM1
+ * and in DTCM-RAM, with the L1 caches off and on.
+ */
+
+#ifndef TCM_BENCH_H_
+#define TCM_BENCH_H_
+
+// printf() a table of cycles per loop iteration; leaves the caches as it found them
+void tcm_bench(void);
+
+#endif /* TCM_BENCH_H_ */
@@ -0,0 +1,102 @@
+/*
+ * tick.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * SysTick time base. See tick.h.
+ *
+ * SysTick registers: PM0253 Rev 5 Sec 4.4.1-4.4.4
+ * * LOAD  - reload value: the counter runs LOAD..0, so one period is LOAD+1
+ * * VAL   - current count; any write clears it and it reloads on the next clock
+ * * CTRL  - CLKSOURCE=1 counts the core clock (HCLK) rather than HCLK/8
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "sections.h"
+#include "tick.h"
+
+static volatile uint32_t tick_count;
+static uint32_t per_tick;   // Core clocks per tick
+static uint32_t per_us;     // Core clocks per microsecond
+static tick_hook_t hook;
+
+void tick_init(uint32_t hclk_hz) {
+  per_tick = hclk_hz / TICK_HZ;
+  per_us = hclk_hz / 1000000UL;
+  if (per_us == 0) per_us = 1;
+
+  SysTick->CTRL = 0;
+  SysTick->LOAD = (per_tick - 1UL) & SysTick_LOAD_RELOAD_Msk;
+  NVIC_SetPriority(SysTick_IRQn, TICK_IRQ_PRIORITY);
+  SysTick->VAL = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk |
+                  SysTick_CTRL_ENABLE_Msk;
+}
+
+ITCM_CODE void SysTick_Handler(void) {
+  tick_count++;
+  if (hook) hook();
+}
+
+void tick_set_hook(tick_hook_t fn) {
+  hook = fn;
+}
+
+uint32_t tick_now(void) {
+  return tick_count;
+}
+
+uint32_t tick_cycles_per_tick(void) {
+  return per_tick;
+}
+
+// Read the tick count and how far into that tick we are, consistently.
+// If the counter has wrapped but SysTick_Handler has not run yet
+// (interrupts masked, or we are in a handler of the same or higher
+// priority) the pending bit tells us to count that tick ourselves.
+static uint32_t tick_read(uint32_t *into) {
+  uint32_t t, val, pending;
+
+  // Retry if SysTick_Handler ran while we were looking
+  do {
+    t = tick_count;
+    val = SysTick->VAL;
+    pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) ? 1U : 0U;
+    if (pending) val = SysTick->VAL; // Certainly after the wrap
+  } while (t != tick_count);
+  t += pending;
+
+  *into = (per_tick - 1UL) - val;
+  return t;
+}
+
+uint32_t tick_cycles_since(uint32_t since) {
+  uint32_t into;
+  uint32_t t = tick_read(&into);
+  uint64_t c = (uint64_t)(t - since) * per_tick + into;
+  return c > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)c;
+}
+
+uint32_t tick_us(void) {
+  uint32_t into;
+  uint32_t t = tick_read(&into);
+  return t * (1000000UL / TICK_HZ) + into / per_us;
+}
+
+void tick_skip(uint32_t ticks) {
+  tick_count += ticks;
+}
+
+void tick_delay_ms(uint32_t ms) {
+  uint32_t start = tick_now();
+  uint32_t ticks = (ms * TICK_HZ + 999U) / 1000U;
+
+  // +1: the first tick may be almost over already
+  while (tick_now() - start < ticks + 1U) __WFI();
+}
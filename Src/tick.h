@@ -0,0 +1,62 @@
+/*
+ * tick.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * SysTick time base: a TICK_HZ interrupt counts ticks, and the SysTick
+ * down-counter gives the position within the current tick to one core
+ * clock, so short intervals can be measured without the DWT.
+ * Cortex-M7 PM0253 Rev 5 Sec 4.4 p 246
+ *
+ * The tick count wraps after 2^32 ticks (~49 days at 1kHz): only ever
+ * subtract two readings, or compare with (int32_t)(a - b) < 0.
+ */
+
+#ifndef TICK_H_
+#define TICK_H_
+
+#include <stdint.h>
+
+#ifndef TICK_HZ
+#define TICK_HZ 1000U
+#endif
+
+// Milliseconds to ticks
+#define TICK_MS(MS) (((MS) * TICK_HZ) / 1000U)
+
+// SysTick is the lowest priority interrupt; it only counts
+#ifndef TICK_IRQ_PRIORITY
+#define TICK_IRQ_PRIORITY 15U
+#endif
+
+// Start SysTick from the core clock (HCLK) at TICK_HZ.
+// Call again with the new rate after changing the clock tree.
+void tick_init(uint32_t hclk_hz);
+
+// Ticks since tick_init()
+uint32_t tick_now(void);
+
+// Core clocks per tick
+uint32_t tick_cycles_per_tick(void);
+
+// Core clocks from the start of tick `since` until now
+// (saturates at 0xFFFFFFFF; ~19s at 216MHz)
+uint32_t tick_cycles_since(uint32_t since);
+
+// Microseconds since tick_init(); wraps after ~71 minutes
+uint32_t tick_us(void);
+
+// Sleep (WFI) for at least ms milliseconds
+void tick_delay_ms(uint32_t ms);
+
+// Called from SysTick_Handler after each tick is counted (the kernel's
+// time slices and timed waits: kernel.h); NULL for none
+typedef void (*tick_hook_t)(void);
+void tick_set_hook(tick_hook_t fn);
+
+// Count ticks that passed while SysTick was stopped (Stop mode). Call
+// with interrupts masked.
+void tick_skip(uint32_t ticks);
+
+#endif /* TICK_H_ */
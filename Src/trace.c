@@ -0,0 +1,105 @@
+/*
+ * trace.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Record encoding for TRACE(). See trace.h for the format.
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "cobs.h"
+#include "console.h"
+#include "critical.h"
+#include "cycles.h"
+#include "sections.h"
+#include "trace.h"
+
+// id, arguments and timestamp as varints of up to 5 bytes, and the check
+#define TRACE_RECORD_MAX (5U * (TRACE_MAX_ARGS + 2U) + 1U)
+// Plus the two delimiters
+#define TRACE_FRAME_MAX  (COBS_MAX(TRACE_RECORD_MAX) + 2U)
+
+#define TRACE_STR_(X) #X
+#define TRACE_STR(X)  TRACE_STR_(X)
+
+// Set by the linker script at the start of the trace_fmt section
+extern const char __start_trace_fmt[];
+
+// Tells the decoder the timestamp unit, and makes sure the section exists
+static const char trace_ts_shift[] __attribute__((section("trace_fmt"), used)) =
+  "TRACE_TS_SHIFT=" TRACE_STR(TRACE_TS_SHIFT);
+
+static uint32_t last_cycles;  // Time of the previous record, in whole units of time
+static trace_stats_t stats;
+
+static inline uint8_t *put_varint(uint8_t *p, uint32_t v) {
+  while (v >= 0x80U) {
+    *p++ = (uint8_t)(v | 0x80U);
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+static inline uint32_t zigzag(uint32_t v) {
+  return (v << 1) ^ (uint32_t)((int32_t)v >> 31);
+}
+
+void trace_init(void) {
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) cycles_init();
+  last_cycles = cycles_now();
+}
+
+ITCM_CODE void trace_record(const char *fmt, const uint32_t *args, uint32_t n) {
+  uint8_t rec[TRACE_RECORD_MAX];
+  uint8_t frame[TRACE_FRAME_MAX];
+  uint8_t *p = rec;
+
+  if (n > TRACE_MAX_ARGS) n = TRACE_MAX_ARGS;
+  p = put_varint(p, (uint32_t)(fmt - __start_trace_fmt));
+  for (uint32_t i = 0; i < n; i++) p = put_varint(p, zigzag(args[i]));
+  uint8_t check = 0;
+  for (const uint8_t *q = rec; q < p; q++) check ^= *q;
+
+  // Everything up to the timestamp is encoded before masking
+  cobs_enc_t e;
+  frame[0] = 0;
+  cobs_begin(&e, frame + 1);
+  cobs_put(&e, rec, (uint32_t)(p - rec));
+
+  // The timestamp and the copy have to be in the same order as the
+  // records: only they, and the last few bytes of encoding, are masked
+  uint32_t s = critical_enter();
+  uint32_t ticks = (cycles_now() - last_cycles) >> TRACE_TS_SHIFT;
+  uint8_t *ts = p;
+  p = put_varint(ts, ticks);
+  for (const uint8_t *q = ts; q < p; q++) check ^= *q;
+  *p++ = check;
+  cobs_put(&e, ts, (uint32_t)(p - ts));
+
+  uint32_t len = cobs_end(&e, frame + 1) + 1U;
+  frame[len++] = 0;
+
+  if (console_write_isr(frame, len, 1) == len) {
+    last_cycles += ticks << TRACE_TS_SHIFT;
+    stats.records++;
+    stats.bytes += len;
+  } else {
+    stats.dropped++;
+  }
+  critical_exit(s);
+}
+
+const trace_stats_t *trace_stats(void) {
+  return &stats;
+}
+
+void trace_check_(const char *fmt, ...) {
+  (void)fmt;
+}
@@ -0,0 +1,114 @@
+/*
+ * trace.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Binary trace log with the formatting deferred to the host.
+ *
+ *   TRACE("timer %u late by %lu cycles", t->id, late);
+ *
+ * The format string goes into the trace_fmt section, which the linker
+ * script places at address 0 as INFO: it is in the ELF file but takes no
+ * flash. At run time only a short record goes out on the console line,
+ * and Sim/trace-decode turns the records back into text with the ELF:
+ *
+ *   trace-decode firmware.elf /dev/ttyACM0
+ *
+ * A record, before framing, is a string of LEB128 varints:
+ * * the string id: the format's offset in trace_fmt
+ * * each argument, as a 32-bit value, zigzag-encoded so small negative
+ *   numbers stay short
+ * * the timestamp: time since the previous record, in units of
+ *   2^TRACE_TS_SHIFT core cycles (DWT->CYCCNT); 64 cycles, 0.3us, by default
+ * followed by one check byte, the XOR of all the bytes before it.
+ * Each record is COBS-encoded (no 0x00 inside) between two 0x00 bytes, so
+ * records can share the line with ordinary console text and the decoder
+ * picks up again after a damaged byte.
+ *
+ * TRACE() may be used anywhere, interrupt handlers included: it encodes
+ * the id and arguments on the stack, COBS included, then masks interrupts
+ * only to take the timestamp, append it and the check byte to the
+ * encoding (six bytes at most) and copy the frame into the console's
+ * transmit ring with console_write_isr(). A record that does not fit is
+ * dropped whole and counted; it never waits.
+ *
+ * Arguments are cast to 32 bits, so only these conversions can be
+ * deferred: d i u o x X c p, with flags, width and precision (also *),
+ * and the length modifiers hh h l z t. Use console_printf() for %s, %f or
+ * 64-bit values. The format is still checked against the arguments at
+ * compile time. At most TRACE_MAX_ARGS arguments.
+ *
+ * Build with TRACE_ENABLE=0 and every TRACE() compiles to nothing.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+#include "fmt.h"
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 1
+#endif
+
+#define TRACE_MAX_ARGS 8U
+
+// Timestamp resolution; the decoder reads it from the ELF file
+#ifndef TRACE_TS_SHIFT
+#define TRACE_TS_SHIFT 6
+#endif
+
+typedef struct {
+  uint32_t records;  // Queued whole
+  uint32_t bytes;    // On the wire, framing included
+  uint32_t dropped;  // Records that found no room
+} trace_stats_t;
+
+// Start the cycle counter if it is not running; prof_init() also does
+void trace_init(void);
+
+// Send one record; fmt must be in the trace_fmt section. Use TRACE().
+void trace_record(const char *fmt, const uint32_t *args, uint32_t n);
+
+const trace_stats_t *trace_stats(void);
+
+// Never called: lets the compiler check TRACE() formats like printf()
+void trace_check_(const char *fmt, ...) FMT_CHECK(1, 2);
+
+#define TRACE_CAT_(A, B)  A##B
+#define TRACE_CAT(A, B)   TRACE_CAT_(A, B)
+#define TRACE_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+#define TRACE_NARGS(...)  TRACE_NARGS_(_0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+#define TRACE_ARG(X)  , (uint32_t)(uintptr_t)(X)
+#define TRACE_MAP_0()
+#define TRACE_MAP_1(a)                   TRACE_ARG(a)
+#define TRACE_MAP_2(a, b)                TRACE_ARG(a) TRACE_MAP_1(b)
+#define TRACE_MAP_3(a, b, c)             TRACE_ARG(a) TRACE_MAP_2(b, c)
+#define TRACE_MAP_4(a, b, c, d)          TRACE_ARG(a) TRACE_MAP_3(b, c, d)
+#define TRACE_MAP_5(a, b, c, d, e)       TRACE_ARG(a) TRACE_MAP_4(b, c, d, e)
+#define TRACE_MAP_6(a, b, c, d, e, f)    TRACE_ARG(a) TRACE_MAP_5(b, c, d, e, f)
+#define TRACE_MAP_7(a, b, c, d, e, f, g) TRACE_ARG(a) TRACE_MAP_6(b, c, d, e, f, g)
+#define TRACE_MAP_8(a, b, c, d, e, f, g, h) \
+  TRACE_ARG(a) TRACE_MAP_7(b, c, d, e, f, g, h)
+
+#if TRACE_ENABLE
+
+// The leading 0 keeps the array non-empty when there are no arguments
+#define TRACE(FMT, ...) do { \
+    static const char trace_fmt_[] __attribute__((section("trace_fmt"), used)) = FMT; \
+    const uint32_t trace_args_[] = \
+      { 0U TRACE_CAT(TRACE_MAP_, TRACE_NARGS(__VA_ARGS__))(__VA_ARGS__) }; \
+    if (0) trace_check_(FMT, ##__VA_ARGS__); \
+    trace_record(trace_fmt_, trace_args_ + 1, TRACE_NARGS(__VA_ARGS__)); \
+  } while (0)
+
+#else
+
+#define TRACE(FMT, ...) do { if (0) trace_check_(FMT, ##__VA_ARGS__); } while (0)
+
+#endif /* TRACE_ENABLE */
+
+#endif /* TRACE_H_ */
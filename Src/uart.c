@@ -0,0 +1,528 @@
+/*
+ * uart.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Table-driven U(S)ART driver. See uart.h for an overview.
+ *
+ * Enabling: RM0410 Rev 5 Sec 34.5.2 p 1242 - M, OVER8, BRR and STOP are
+ * set with UE clear, then UE, then TE/RE.
+ * Kernel clock: DCKCFGR2 at reset selects PCLK1 for the APB1 U(S)ARTs and
+ * PCLK2 for USART1/6 (RM0410 Rev 5 Sec 5.3.28 p 221); uart_set_clock()
+ * changes it. Each port has a 2-bit field there, in uart_id_t order.
+ */
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "nucleo-clk.h"
+#include "nucleo-uart.h"
+
+#include "clock.h"
+#include "critical.h"
+#include "gpio-config.h"
+#include "sections.h"
+#include "uart.h"
+
+#define USART_ISR_ERRORS (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE | USART_ISR_PE)
+#define USART_ICR_ERRORS (USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF | USART_ICR_PECF)
+
+const uart_hw_t uart_hw[UART_NUM] = {
+  { "USART1", USART1, UART_APB2, USART1_CLK_EN, USART1_IRQn,
+    GPIOB, GPIOB_CLK_EN, USART1_TX_PIN_B, 7, GPIOB, GPIOB_CLK_EN, USART1_RX_PIN_B, 4 },
+  { "USART2", USART2, UART_APB1, USART2_CLK_EN, USART2_IRQn,
+    GPIOD, GPIOD_CLK_EN, USART2_TX_PIN_D, 7, GPIOD, GPIOD_CLK_EN, USART2_RX_PIN_D, 7 },
+  { "USART3", USART3, UART_APB1, USART3_CLK_EN, USART3_IRQn,
+    GPIOD, GPIOD_CLK_EN, USART3_TX_PIN_D, USART3_AF, GPIOD, GPIOD_CLK_EN, USART3_RX_PIN_D, USART3_AF },
+  { "UART4",  UART4,  UART_APB1, UART4_CLK_EN,  UART4_IRQn,
+    GPIOC, GPIOC_CLK_EN, UART4_TX_PIN_C,  8, GPIOC, GPIOC_CLK_EN, UART4_RX_PIN_C,  8 },
+  { "UART5",  UART5,  UART_APB1, UART5_CLK_EN,  UART5_IRQn,
+    GPIOC, GPIOC_CLK_EN, UART5_TX_PIN_C,  8, GPIOD, GPIOD_CLK_EN, UART5_RX_PIN_D,  8 },
+  { "USART6", USART6, UART_APB2, USART6_CLK_EN, USART6_IRQn,
+    GPIOC, GPIOC_CLK_EN, USART6_TX_PIN_C, 8, GPIOC, GPIOC_CLK_EN, USART6_RX_PIN_C, 8 },
+  { "UART7",  UART7,  UART_APB1, UART7_CLK_EN,  UART7_IRQn,
+    GPIOE, GPIOE_CLK_EN, UART7_TX_PIN_E,  8, GPIOE, GPIOE_CLK_EN, UART7_RX_PIN_E,  8 },
+  { "UART8",  UART8,  UART_APB1, UART8_CLK_EN,  UART8_IRQn,
+    GPIOE, GPIOE_CLK_EN, UART8_TX_PIN_E,  8, GPIOE, GPIOE_CLK_EN, UART8_RX_PIN_E,  8 },
+};
+
+static uart_port_t ports[UART_NUM];
+
+uart_port_t *uart_port(uart_id_t id) {
+  uart_port_t *p = &ports[id];
+  p->hw = &uart_hw[id];
+  return p;
+}
+
+
+// Configures the control registers for a U(S)ART
+// BUT the values must be the masked bits to set for PS, PCE, M and STOP, not the logical values!!
+// (in other words, this is a stupid function that requires you to know the STM bits to set)
+void config_uart_params(USART_TypeDef *usartx, uint32_t data_width, uint32_t parity, uint32_t stop_bits) {
+  // The bits are defined in the STM header file
+  // M is two non-contiguous bits!
+  MODIFY_REG(usartx->CR1, USART_CR1_PS | USART_CR1_PCE | USART_CR1_M, parity | data_width);
+  MODIFY_REG(usartx->CR2, USART_CR2_STOP, stop_bits);
+}
+
+// Work out the BRR value for a baud rate from the USART kernel clock.
+// RM0410 Rev 5 Sec 34.5.4 p 1248:
+//   16x oversampling: baud = fck / USARTDIV,     BRR = USARTDIV
+//    8x oversampling: baud = 2 * fck / USARTDIV, BRR[15:4] = USARTDIV[15:4],
+//                                                BRR[3:0] = USARTDIV[3:0] >> 1
+// USARTDIV must be 16..65535 either way. 16x tolerates more clock error,
+// so 8x is only used for rates above fck / 16 (several Mbaud at 54MHz).
+// Returns the BRR value, or 0 if the rate cannot be reached.
+// Sets *over8 if 8x oversampling is needed, and *error_ppm to how far the
+// achieved rate is from the desired one, in parts per million.
+uint32_t compute_uart_divider(uint32_t periph_clk, uint32_t desired_rate,
+                              int *over8, int32_t *error_ppm) {
+  uint64_t div;
+  uint64_t achieved;
+
+  if (desired_rate == 0) return 0;
+
+  // round by adding half of a desired rate.
+  div = ((uint64_t)periph_clk + (desired_rate / 2U)) / desired_rate;
+  *over8 = div < 16U;
+  if (*over8) {
+    div = (2ULL * periph_clk + (desired_rate / 2U)) / desired_rate;
+  }
+  if (div < 16U || div > 0xFFFFU) return 0;
+
+  achieved = (*over8 ? 2ULL * periph_clk : (uint64_t)periph_clk) / div;
+  *error_ppm = (int32_t)(((int64_t)achieved - (int64_t)desired_rate) * 1000000LL /
+                         (int64_t)desired_rate);
+
+  if (*over8) return (uint32_t)((div & 0xFFF0U) | ((div & 0xFU) >> 1));
+  return (uint32_t)div;
+}
+
+// Set the baud rate, picking 16x or 8x oversampling as needed.
+// Returns the achieved error in ppm, or UART_BAUD_UNREACHABLE.
+// OVER8 can only be changed with the USART disabled, so if it is running
+// it is briefly disabled: flush any output first.
+int32_t set_uart_baud_rate(USART_TypeDef *usartx, uint32_t periph_clk, uint32_t baud_rate) {
+  int over8;
+  int32_t error_ppm;
+  uint32_t brr = compute_uart_divider(periph_clk, baud_rate, &over8, &error_ppm);
+  if (brr == 0) return UART_BAUD_UNREACHABLE;
+
+  uint32_t ue = usartx->CR1 & USART_CR1_UE;
+  CLEAR_BIT(usartx->CR1, USART_CR1_UE);
+  MODIFY_REG(usartx->CR1, USART_CR1_OVER8, over8 ? USART_CR1_OVER8 : 0U);
+  usartx->BRR = brr;
+  SET_BIT(usartx->CR1, ue);
+
+  return error_ppm;
+}
+
+// Enable the receiver and/or transmitter of the U(S)ART
+// RM0410 Rev 5 Sec 34.8.1 p 1276
+// Bits 3:2 TE:RE
+void set_uart_transfer_enable(USART_TypeDef *usartx, int tx, int rx) {
+  uint32_t t = 0;
+  if (tx) t |= USART_CR1_TE;
+  if (rx) t |= USART_CR1_RE;
+  MODIFY_REG(usartx->CR1, USART_CR1_RE | USART_CR1_TE, t);
+}
+
+
+int32_t uart_open(uart_port_t *p, uint32_t baud) {
+  const uart_hw_t *hw = p->hw;
+  USART_TypeDef *u = hw->regs;
+
+  SET_BIT(RCC->AHB1ENR, hw->tx_gpio_en | hw->rx_gpio_en);
+
+  // TX and RX to their AFs; one pass per GPIO port. The RX pull-up holds
+  // the line idle if nothing is attached.
+  gpio_port_cfg_t tx = { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 }, { { 0, 0 }, { 0, 0 } } };
+  gpio_port_cfg_t rx = tx;
+  gpio_cfg_add_pin(&tx, hw->tx_pin, GPIO_CFG_MODE_AF, GPIO_CFG_PUSH_PULL,
+                   GPIO_CFG_SPEED_HIGH, GPIO_CFG_PULL_NONE, hw->tx_af);
+  gpio_cfg_add_pin(hw->rx_gpio == hw->tx_gpio ? &tx : &rx, hw->rx_pin, GPIO_CFG_MODE_AF,
+                   GPIO_CFG_PUSH_PULL, GPIO_CFG_SPEED_HIGH, GPIO_CFG_PULL_UP, hw->rx_af);
+  gpio_port_apply(hw->tx_gpio, &tx);
+  if (hw->rx_gpio != hw->tx_gpio) gpio_port_apply(hw->rx_gpio, &rx);
+
+  if (hw->bus == UART_APB2) SET_BIT(RCC->APB2ENR, hw->clk_en);
+  else                     SET_BIT(RCC->APB1ENR, hw->clk_en);
+
+  CLEAR_BIT(u->CR1, USART_CR1_UE);
+  config_uart_params(u, UART_DATA_8, UART_PARTY_NONE, UART_STOPBITS_1);
+  CLEAR_BIT(u->CR2, USART_CR2_ABREN);
+  p->autobaud = UART_AUTOBAUD_OFF;
+  p->baud = baud;
+  p->baud_error_ppm = set_uart_baud_rate(u, uart_kernel_hz(p), baud);
+  if (p->baud_error_ppm == UART_BAUD_UNREACHABLE) return p->baud_error_ppm;
+
+  // Enable the USART module: RM0410 Rev 5 p 1279
+  SET_BIT(u->CR1, USART_CR1_UE);
+  set_uart_transfer_enable(u, 1, 1);
+  return p->baud_error_ppm;
+}
+
+uint32_t uart_kernel_hz(const uart_port_t *p) {
+  uint32_t shift = 2U * (uint32_t)(p->hw - uart_hw);
+  switch ((RCC->DCKCFGR2 >> shift) & 3U) {
+  case UART_CLK_SYSCLK: return clock_sysclk_hz();
+  case UART_CLK_HSI:    return HSI_HZ;
+  case UART_CLK_LSE:    return LSE_HZ;
+  default:              return p->hw->bus == UART_APB2 ? clock_pclk2_hz() : clock_pclk1_hz();
+  }
+}
+
+int32_t uart_set_clock(uart_port_t *p, uart_clock_t clk) {
+  uint32_t shift = 2U * (uint32_t)(p->hw - uart_hw);
+  MODIFY_REG(RCC->DCKCFGR2, 3UL << shift, (uint32_t)clk << shift);
+  p->baud_error_ppm = set_uart_baud_rate(p->hw->regs, uart_kernel_hz(p), p->baud);
+  return p->baud_error_ppm;
+}
+
+// ABREN and ABRMOD only change with UE clear: RM0410 Rev 5 Sec 34.8.2
+static void set_autobaud_bits(USART_TypeDef *u, uint32_t bits) {
+  uint32_t ue = u->CR1 & USART_CR1_UE;
+  CLEAR_BIT(u->CR1, USART_CR1_UE);
+  MODIFY_REG(u->CR2, USART_CR2_ABREN | USART_CR2_ABRMOD, bits);
+  SET_BIT(u->CR1, ue);
+}
+
+void uart_autobaud_start(uart_port_t *p) {
+  USART_TypeDef *u = p->hw->regs;
+  p->autobaud = UART_AUTOBAUD_WAITING;
+  set_autobaud_bits(u, USART_CR2_ABREN | USART_CR2_ABRMOD);
+  u->RQR = USART_RQR_ABRRQ;
+}
+
+void uart_autobaud_stop(uart_port_t *p) {
+  if (p->autobaud == UART_AUTOBAUD_WAITING) p->autobaud = UART_AUTOBAUD_OFF;
+  set_autobaud_bits(p->hw->regs, 0);
+}
+
+// The rate BRR gives, as the hardware left it
+static uint32_t measured_baud(const uart_port_t *p) {
+  USART_TypeDef *u = p->hw->regs;
+  uint32_t brr = u->BRR & 0xFFFFUL;
+  uint64_t clk = uart_kernel_hz(p);
+  if (u->CR1 & USART_CR1_OVER8) {
+    brr = (brr & 0xFFF0UL) | ((brr & 0x7UL) << 1);
+    clk *= 2U;
+  }
+  return brr ? (uint32_t)((clk + brr / 2U) / brr) : 0U;
+}
+
+int32_t uart_set_baud(uart_port_t *p, uint32_t baud) {
+  int32_t error = set_uart_baud_rate(p->hw->regs, uart_kernel_hz(p), baud);
+  if (error == UART_BAUD_UNREACHABLE) return error;
+  p->baud = baud;
+  p->baud_error_ppm = error;
+  return error;
+}
+
+void uart_start(uart_port_t *p, uint8_t *tx_buf, uint32_t tx_size,
+                uint8_t *rx_buf, uint32_t rx_size) {
+  USART_TypeDef *u = p->hw->regs;
+  ring_t tx = RING_INIT(tx_buf, tx_size);
+  ring_t rx = RING_INIT(rx_buf, rx_size);
+
+  NVIC_DisableIRQ(p->hw->irqn);
+  CLEAR_BIT(u->CR1, USART_CR1_TXEIE | USART_CR1_TCIE | USART_CR1_RXNEIE);
+  p->tx = tx;
+  p->rx = rx;
+  p->tx_active = 0;
+
+  // Throw away anything that arrived before we were listening
+  u->ICR = USART_ICR_ERRORS;
+  u->RQR = USART_RQR_RXFRQ;
+  SET_BIT(u->CR1, USART_CR1_RXNEIE);
+
+  NVIC_EnableIRQ(p->hw->irqn);
+}
+
+void uart_set_tx_policy(uart_port_t *p, uart_tx_policy_t policy) {
+  p->policy = policy;
+}
+
+uart_tx_policy_t uart_get_tx_policy(const uart_port_t *p) {
+  return p->policy;
+}
+
+void uart_set_rx_filter(uart_port_t *p, uart_rx_filter_t filter) {
+  p->rx_filter = filter;
+}
+
+const uart_tx_stats_t *uart_tx_stats(const uart_port_t *p) {
+  return &p->tx_stats;
+}
+
+const uart_rx_stats_t *uart_rx_stats(const uart_port_t *p) {
+  return &p->rx_stats;
+}
+
+uint32_t uart_tx_free(const uart_port_t *p) {
+  return ring_free(&p->tx);
+}
+
+int uart_tx_busy(const uart_port_t *p) {
+  return p->tx_active || !ring_empty(&p->tx);
+}
+
+// Make sure the ISR is running. Done with interrupts masked because the ISR
+// also read-modify-writes CR1.
+static void tx_kick(uart_port_t *p) {
+  uint32_t s = critical_enter();
+  p->tx_active = 1;
+  MODIFY_REG(p->hw->regs->CR1, USART_CR1_TCIE, USART_CR1_TXEIE);
+  critical_exit(s);
+}
+
+// Send one byte from the ring by polling. Used when the ring is full and
+// the ISR can neither run nor be running beneath us (CRITICAL_IRQ_POLL).
+static void tx_poll_one(uart_port_t *p) {
+  USART_TypeDef *u = p->hw->regs;
+  uint8_t c;
+  while (!(u->ISR & USART_ISR_TXE));
+  if (ring_get(&p->tx, &c)) {
+    u->TDR = c;
+    p->tx_stats.sent++;
+  }
+}
+
+static void note_peak(uart_port_t *p) {
+  uint32_t used = ring_used(&p->tx);
+  if (used > p->tx_stats.peak_used) p->tx_stats.peak_used = used;
+}
+
+int uart_send(uart_port_t *p, const uint8_t *buf, int len) {
+  if (len <= 0) return len;
+
+  ring_t *r = &p->tx;
+  uint32_t left = (uint32_t)len;
+  uint32_t n;
+
+  switch (p->policy) {
+  case UART_TX_DROP_NEWEST:
+    n = ring_write(r, buf, left);
+    p->tx_stats.dropped += left - n;
+    left = n;
+    break;
+
+  case UART_TX_OVERWRITE_OLDEST: {
+    // Only keep the newest bytes if we were handed more than fits at all
+    if (left > ring_size(r)) {
+      p->tx_stats.overwritten += left - ring_size(r);
+      buf += left - ring_size(r);
+      left = ring_size(r);
+    }
+    // Moving the tail belongs to the ISR, so keep it out while we do it
+    uint32_t s = critical_enter();
+    uint32_t space = ring_free(r);
+    if (space < left) {
+      r->tail += left - space;
+      p->tx_stats.overwritten += left - space;
+    }
+    ring_write(r, buf, left);
+    critical_exit(s);
+    break;
+  }
+
+  case UART_TX_BLOCK:
+  default:
+    n = 0;
+    while (n < left) {
+      uint32_t w = ring_write(r, buf + n, left - n);
+      n += w;
+      if (n < left) {
+        p->tx_stats.full_waits++;
+        note_peak(p);
+        tx_kick(p);
+        critical_irq_t how = critical_irq_progress(p->hw->irqn);
+        if (how == CRITICAL_IRQ_POLL) {
+          tx_poll_one(p);
+        } else if (how == CRITICAL_IRQ_WAIT) {
+          while (ring_full(r)) __NOP(); // The ISR makes room
+        } else {
+          // Its ISR is beneath us: nothing will make room until we return
+          p->tx_stats.dropped += left - n;
+          left = n;
+        }
+      }
+    }
+    break;
+  }
+
+  p->tx_stats.queued += left;
+  note_peak(p);
+  if (left) tx_kick(p);
+
+  return len;
+}
+
+uint8_t *uart_tx_reserve(uart_port_t *p, uint32_t want, uint32_t *len) {
+  ring_t *r = &p->tx;
+  uint8_t *dst = ring_reserve(r, len);
+  if (*len > want) *len = want;
+  if (*len || !want) return dst;
+
+  switch (p->policy) {
+  case UART_TX_DROP_NEWEST:
+    break;
+
+  case UART_TX_OVERWRITE_OLDEST: {
+    // Full: give up the oldest bytes, as many as fit before the wrap.
+    // The ISR may have made room since, so only drop what is still short.
+    uint32_t s = critical_enter();
+    uint32_t first = ring_size(r) - (r->head & r->mask);
+    uint32_t n = want < first ? want : first;
+    uint32_t space = ring_free(r);
+    uint32_t drop = n > space ? n - space : 0U;
+    r->tail += drop;
+    p->tx_stats.overwritten += drop;
+    critical_exit(s);
+    dst = ring_reserve(r, len);
+    if (*len > want) *len = want;
+    break;
+  }
+
+  case UART_TX_BLOCK:
+  default:
+    p->tx_stats.full_waits++;
+    note_peak(p);
+    tx_kick(p);
+    critical_irq_t how = critical_irq_progress(p->hw->irqn);
+    if (how == CRITICAL_IRQ_PREEMPTED) break; // As DROP_NEWEST: nothing will make room
+    while (ring_full(r)) {
+      if (how == CRITICAL_IRQ_POLL) {
+        tx_poll_one(p);
+      } else {
+        __NOP(); // The ISR makes room
+      }
+    }
+    dst = ring_reserve(r, len);
+    if (*len > want) *len = want;
+    break;
+  }
+  return dst;
+}
+
+void uart_tx_commit(uart_port_t *p, uint32_t len, uint32_t dropped) {
+  ring_commit(&p->tx, len);
+  p->tx_stats.queued += len;
+  p->tx_stats.dropped += dropped;
+  note_peak(p);
+  if (len) tx_kick(p);
+}
+
+uint32_t uart_send_nowait(uart_port_t *p, const uint8_t *buf, uint32_t len) {
+  uint32_t n = ring_write(&p->tx, buf, len);
+  p->tx_stats.queued += n;
+  p->tx_stats.dropped += len - n;
+  note_peak(p);
+  if (n) tx_kick(p);
+  return n;
+}
+
+void uart_flush(uart_port_t *p) {
+  USART_TypeDef *u = p->hw->regs;
+  critical_irq_t how = critical_irq_progress(p->hw->irqn);
+
+  // Preempting its ISR, we would wait for ever
+  if (how == CRITICAL_IRQ_PREEMPTED) return;
+  while (uart_tx_busy(p)) {
+    if (how == CRITICAL_IRQ_POLL) {
+      // No interrupts will come, so do their work ourselves
+      if (!ring_empty(&p->tx)) {
+        tx_poll_one(p);
+      } else if (p->tx_active && (u->ISR & USART_ISR_TC)) {
+        CLEAR_BIT(u->CR1, USART_CR1_TXEIE | USART_CR1_TCIE);
+        p->tx_active = 0;
+      }
+    } else {
+      __NOP(); // The ISR sends the rest
+    }
+  }
+}
+
+int uart_recv(uart_port_t *p, uint8_t *buf, int len) {
+  if (len <= 0) return 0;
+  // Pick up a byte ourselves if the ISR cannot, and is not running beneath us
+  if (critical_irq_progress(p->hw->irqn) == CRITICAL_IRQ_POLL) uart_irq(p);
+  return (int)ring_read(&p->rx, buf, (uint32_t)len);
+}
+
+int uart_rx_available(const uart_port_t *p) {
+  return (int)ring_used(&p->rx);
+}
+
+ITCM_CODE void uart_irq(uart_port_t *p) {
+  USART_TypeDef *u = p->hw->regs;
+  uint32_t isr = u->ISR;
+  uint32_t cr1 = u->CR1;
+
+  if (isr & USART_ISR_ERRORS) {
+    // The byte with FE/NE/PE is still delivered in RDR below; ORE means
+    // a byte was lost because RDR was not read in time.
+    if (isr & USART_ISR_ORE) p->rx_stats.overrun++;
+    if (isr & USART_ISR_FE)  p->rx_stats.framing++;
+    if (isr & USART_ISR_NE)  p->rx_stats.noise++;
+    if (isr & USART_ISR_PE)  p->rx_stats.parity++;
+    u->ICR = USART_ICR_ERRORS;
+  }
+
+  if (p->autobaud == UART_AUTOBAUD_WAITING && (isr & USART_ISR_ABRF)) {
+    if (!(isr & USART_ISR_ABRE)) {
+      p->baud = measured_baud(p);
+      p->baud_error_ppm = 0;
+      p->autobaud = UART_AUTOBAUD_LOCKED;
+      u->RQR = USART_RQR_RXFRQ; // Drop the 0x55 itself
+      isr &= ~USART_ISR_RXNE;
+    } else if (isr & USART_ISR_FE) {
+      p->rx_stats.autobaud++;
+      // Drop it, and try again on the next character
+      u->RQR = USART_RQR_RXFRQ | USART_RQR_ABRRQ;
+      isr &= ~USART_ISR_RXNE;
+    } else {
+      p->rx_stats.autobaud++;
+      p->autobaud = UART_AUTOBAUD_KEPT;
+    }
+  }
+
+  if (isr & USART_ISR_RXNE) {
+    uint8_t c = (uint8_t)(u->RDR & 0xFFUL); // Reading clears RXNE
+    uart_rx_filter_t filter = p->rx_filter;
+    if (filter && filter(c)) {
+      p->rx_stats.filtered++;
+    } else if (ring_put(&p->rx, c)) {
+      p->rx_stats.received++;
+    } else {
+      p->rx_stats.dropped++;
+    }
+  }
+
+  if ((cr1 & USART_CR1_TXEIE) && (isr & USART_ISR_TXE)) {
+    uint8_t c;
+    if (ring_get(&p->tx, &c)) {
+      u->TDR = c;
+      p->tx_stats.sent++;
+    } else {
+      // Ring drained: stop TXE interrupts and wait for the line to go idle
+      MODIFY_REG(u->CR1, USART_CR1_TXEIE, USART_CR1_TCIE);
+    }
+  } else if ((cr1 & USART_CR1_TCIE) && (isr & USART_ISR_TC)) {
+    CLEAR_BIT(u->CR1, USART_CR1_TCIE);
+    p->tx_active = 0;
+  }
+}
+
+ITCM_CODE void USART1_IRQHandler(void) { uart_irq(&ports[UART_USART1]); }
+ITCM_CODE void USART2_IRQHandler(void) { uart_irq(&ports[UART_USART2]); }
+ITCM_CODE void USART3_IRQHandler(void) { uart_irq(&ports[UART_USART3]); }
+ITCM_CODE void UART4_IRQHandler(void)  { uart_irq(&ports[UART_UART4]); }
+ITCM_CODE void UART5_IRQHandler(void)  { uart_irq(&ports[UART_UART5]); }
+ITCM_CODE void USART6_IRQHandler(void) { uart_irq(&ports[UART_USART6]); }
+ITCM_CODE void UART7_IRQHandler(void)  { uart_irq(&ports[UART_UART7]); }
+ITCM_CODE void UART8_IRQHandler(void)  { uart_irq(&ports[UART_UART8]); }
@@ -0,0 +1,245 @@
+/*
+ * uart.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Interrupt-driven, ring-buffered driver for any of the eight U(S)ARTs.
+ *
+ * Each U(S)ART is described once, in the const uart_hw[] table in uart.c:
+ * register block, RCC enable bit and bus, TX/RX pins and AFs, and IRQ.
+ * A uart_port_t holds everything that changes at run time: the two rings,
+ * the TX policy and the statistics. Ports share no state, so a busy port
+ * costs the others only the CPU time of its own interrupts.
+ *
+ *   uart_port_t *p = uart_port(UART_USART2);
+ *   uart_open(p, 460800);                                    // Clocks, pins, 8N1
+ *   uart_start(p, tx_buf, sizeof(tx_buf), rx_buf, sizeof(rx_buf));  // Interrupts
+ *   uart_send(p, data, n);
+ *
+ * The console (console.c) is the USART3 port with a few extras on top.
+ *
+ * USART interrupts: RM0410 Rev 5 Sec 34.7 p 1275
+ * * TXE  - TDR is empty; enabled by TXEIE. We feed it one byte each time.
+ * * TC   - The last byte has completely left the shift register; enabled
+ *          by TCIE. Used only to learn that the line is idle.
+ * * RXNE - RDR holds a received byte; enabled by RXNEIE. Also raised for
+ *          overrun (ORE). Error flags must be cleared in ICR or the
+ *          interrupt keeps firing. ISR/ICR bits: RM0410 Rev 5 Sec 34.8.8-9 p 1289
+ *
+ * Auto-baud: RM0410 Rev 5 Sec 34.5.6 p 1252. With ABREN the USART times
+ * the next character's bits and writes BRR to match, then sets ABRF, and
+ * RXNE too if the character came in. ABRMOD 11 wants 0x55 ('U'), whose
+ * every bit is an edge, and sets ABRE as well for anything else.
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <stdint.h>
+
+#include "stm32f7xx.h"
+
+#include "ring.h"
+
+#define UART_DATA_8     (0x0UL)
+#define UART_PARTY_NONE (0x0UL)
+#define UART_STOPBITS_1 (0x0UL)
+
+// set_uart_baud_rate() could not get within range of the requested rate
+#define UART_BAUD_UNREACHABLE INT32_MIN
+
+typedef enum {
+  UART_USART1 = 0,
+  UART_USART2,
+  UART_USART3,  // ST-LINK virtual COM port: the console
+  UART_UART4,
+  UART_UART5,
+  UART_USART6,
+  UART_UART7,
+  UART_UART8,
+  UART_NUM
+} uart_id_t;
+
+typedef enum {
+  UART_APB1 = 0,
+  UART_APB2
+} uart_bus_t;
+
+// Kernel clock, as the DCKCFGR2 field: RM0410 Rev 5 Sec 5.3.28 p 221.
+// Only the HSI and LSE keep running in Stop mode.
+typedef enum {
+  UART_CLK_PCLK = 0,  // PCLK1 or PCLK2, per uart_bus_t: the reset value
+  UART_CLK_SYSCLK,
+  UART_CLK_HSI,
+  UART_CLK_LSE
+} uart_clock_t;
+
+// How one U(S)ART is wired up on the board
+typedef struct {
+  const char *name;
+  USART_TypeDef *regs;
+  uart_bus_t bus;          // PCLK1 or PCLK2
+  uint32_t clk_en;         // RCC APB1ENR/APB2ENR bit
+  IRQn_Type irqn;
+  GPIO_TypeDef *tx_gpio;
+  uint32_t tx_gpio_en;     // RCC AHB1ENR bit
+  uint8_t tx_pin;
+  uint8_t tx_af;
+  GPIO_TypeDef *rx_gpio;
+  uint32_t rx_gpio_en;
+  uint8_t rx_pin;
+  uint8_t rx_af;
+} uart_hw_t;
+
+extern const uart_hw_t uart_hw[UART_NUM];
+
+// What to do when the transmit ring is full
+typedef enum {
+  UART_TX_BLOCK = 0,        // Wait until the ISR makes room (never loses output,
+                            // unless sent from a handler that preempted the ISR)
+  UART_TX_DROP_NEWEST,      // Discard the bytes that do not fit
+  UART_TX_OVERWRITE_OLDEST  // Discard the oldest unsent bytes to make room
+} uart_tx_policy_t;
+
+typedef struct {
+  uint32_t queued;       // Bytes accepted into the ring
+  uint32_t sent;         // Bytes written to TDR by the ISR
+  uint32_t dropped;      // Bytes discarded by UART_TX_DROP_NEWEST, or by
+                         // UART_TX_BLOCK in a handler that preempted the ISR
+  uint32_t overwritten;  // Bytes discarded by UART_TX_OVERWRITE_OLDEST
+  uint32_t full_waits;   // Times UART_TX_BLOCK had to wait for room
+  uint32_t peak_used;    // High-water mark of the ring
+} uart_tx_stats_t;
+
+typedef struct {
+  uint32_t received;  // Bytes placed in the ring
+  uint32_t dropped;   // Bytes lost because the ring was full
+  uint32_t filtered;  // Bytes taken by the rx filter
+  uint32_t overrun;   // ORE: bytes lost because RDR was not read in time
+  uint32_t framing;   // FE: stop bit missing (wrong baud rate, break)
+  uint32_t noise;     // NE: noise detected while sampling
+  uint32_t parity;    // PE: parity mismatch (when parity is enabled)
+  uint32_t autobaud;  // Characters that failed auto-baud detection
+} uart_rx_stats_t;
+
+typedef enum {
+  UART_AUTOBAUD_OFF = 0,
+  UART_AUTOBAUD_WAITING,  // For the far end's 0x55
+  UART_AUTOBAUD_LOCKED,   // BRR is the far end's rate; baud has it
+  UART_AUTOBAUD_KEPT      // A character came in cleanly at the rate we had
+} uart_autobaud_t;
+
+// Sees each received byte in the interrupt handler, ahead of the
+// receive ring; returns nonzero if it took the byte, which then does not
+// go into the ring
+typedef int (*uart_rx_filter_t)(uint8_t c);
+
+typedef struct {
+  const uart_hw_t *hw;
+  ring_t tx;
+  ring_t rx;
+  volatile uart_rx_filter_t rx_filter;
+  volatile uart_tx_policy_t policy;
+  volatile int tx_active;  // TXE or TC interrupt still pending
+  uint32_t baud;           // From the last uart_open() or uart_set_baud(),
+                           // or as auto-baud measured it
+  int32_t baud_error_ppm;
+  volatile uart_autobaud_t autobaud;
+  uart_tx_stats_t tx_stats;
+  uart_rx_stats_t rx_stats;
+} uart_port_t;
+
+uart_port_t *uart_port(uart_id_t id);
+
+// Clocks, pins, 8N1 at baud from the current bus clock, TX and RX enabled.
+// Polled I/O works after this. Returns the baud rate error in ppm, or
+// UART_BAUD_UNREACHABLE (and the port is left disabled).
+int32_t uart_open(uart_port_t *p, uint32_t baud);
+
+// Switch the kernel clock and set the baud rate again for it. The HSI
+// keeps a port's baud rate whatever SYSCLK and the APB prescalers do.
+// The clock must be running (the HSI is, from reset); flush any output
+// first. Returns as uart_open().
+int32_t uart_set_clock(uart_port_t *p, uart_clock_t clk);
+
+// Change the baud rate of an open port, keeping everything else. Flush
+// any output first. Returns as uart_open(); if the rate is unreachable
+// the port keeps its old one.
+int32_t uart_set_baud(uart_port_t *p, uint32_t baud);
+
+// The kernel clock in Hz, from the RCC registers
+uint32_t uart_kernel_hz(const uart_port_t *p);
+
+// Take the baud rate from the next 0x55 the far end sends, whatever rate
+// it sends at; the port keeps its rate until then. The interrupt handler
+// drops that character, so the rx filter and the ring never see it. A
+// character that fails detection but came in without a framing error
+// shows the far end is at our rate already: it is passed on as usual,
+// and the port stays as it is (KEPT). One with a framing error is
+// dropped, and detection starts again. Needs uart_start() first; flush
+// any output first.
+void uart_autobaud_start(uart_port_t *p);
+
+// Turn detection off again, keeping the rate: once LOCKED or KEPT, or to
+// give up waiting. Flush any output first.
+void uart_autobaud_stop(uart_port_t *p);
+
+// Hand the port its rings (sizes must be powers of two) and turn on its
+// interrupt. Anything received before this is thrown away.
+void uart_start(uart_port_t *p, uint8_t *tx_buf, uint32_t tx_size,
+                uint8_t *rx_buf, uint32_t rx_size);
+
+void uart_set_tx_policy(uart_port_t *p, uart_tx_policy_t policy);
+// NULL for none
+void uart_set_rx_filter(uart_port_t *p, uart_rx_filter_t filter);
+uart_tx_policy_t uart_get_tx_policy(const uart_port_t *p);
+
+// Queue bytes for transmission according to the port's policy.
+// Returns the number of bytes consumed from buf (always len unless len < 0).
+int uart_send(uart_port_t *p, const uint8_t *buf, int len);
+
+// Room in the transmit ring: a uart_send() of this much never waits or drops
+uint32_t uart_tx_free(const uart_port_t *p);
+
+// Writing in place, for formatters (console_printf()). uart_tx_reserve()
+// returns contiguous free space in the transmit ring, at most want bytes,
+// and its size in *len. When there is none, the policy decides: BLOCK
+// waits for some (but acts as DROP_NEWEST in a handler that preempted the
+// port's ISR), OVERWRITE_OLDEST discards the oldest bytes to make it,
+// DROP_NEWEST returns *len == 0. uart_tx_commit() then queues the first
+// len bytes written there and counts dropped bytes that found no room.
+// One writer at a time, as for uart_send().
+uint8_t *uart_tx_reserve(uart_port_t *p, uint32_t want, uint32_t *len);
+void uart_tx_commit(uart_port_t *p, uint32_t len, uint32_t dropped);
+
+// Queue what fits now and drop the rest, whatever the policy; never waits.
+// Returns the number of bytes queued.
+uint32_t uart_send_nowait(uart_port_t *p, const uint8_t *buf, uint32_t len);
+
+// Nonzero while bytes are queued or still shifting out
+int uart_tx_busy(const uart_port_t *p);
+
+// Wait until everything queued has left the shift register. Returns at
+// once from a handler that preempted the port's ISR, which could not.
+void uart_flush(uart_port_t *p);
+
+// Non-blocking input: copies up to len buffered bytes, returns how many
+int uart_recv(uart_port_t *p, uint8_t *buf, int len);
+int uart_rx_available(const uart_port_t *p);
+
+const uart_tx_stats_t *uart_tx_stats(const uart_port_t *p);
+const uart_rx_stats_t *uart_rx_stats(const uart_port_t *p);
+
+// The interrupt handler body; also called directly when the handler cannot
+// run and is not part way through (see critical_irq_progress())
+void uart_irq(uart_port_t *p);
+
+// Register-level helpers (also used by the polled code in main.c)
+void config_uart_params(USART_TypeDef *usartx, uint32_t data_width, uint32_t parity, uint32_t stop_bits);
+uint32_t compute_uart_divider(uint32_t periph_clk, uint32_t desired_rate,
+                              int *over8, int32_t *error_ppm);
+int32_t set_uart_baud_rate(USART_TypeDef *usartx, uint32_t periph_clk, uint32_t baud_rate);
+void set_uart_transfer_enable(USART_TypeDef *usartx, int tx, int rx);
+
+#endif /* UART_H_ */
@@ -0,0 +1,372 @@
+/*
+ * update.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Firmware update into the inactive bank. See update.h for the protocol.
+ *
+ * Who moves what: the DATA handler (thread mode, from cmd_poll()) only
+ * advances `received`, the flash handler only `programmed`, `erase_next`
+ * and `erased_to`. kick() starts the next flash operation; it runs from
+ * the flash handler when one finishes, and from thread mode with
+ * interrupts masked when new data comes in while the flash is idle.
+ * Staged bytes live in the ring between programmed and received.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "baud.h"
+#include "console.h"
+#include "crc.h"
+#include "critical.h"
+#include "flash.h"
+#include "ring.h"
+#include "sections.h"
+#include "tick.h"
+#include "uart.h"
+#include "update.h"
+
+#if (UPDATE_STAGE_SIZE & (UPDATE_STAGE_SIZE - 1U)) != 0
+#error "UPDATE_STAGE_SIZE must be a power of two"
+#endif
+
+// Most bytes programmed in one go: their room in the ring is only given
+// back when the whole run is done. 4K is 16ms of flash time.
+#define UPDATE_RUN_MAX 4096U
+
+#define LOADER_SIZE 0x4000U  // Sector 0
+
+typedef enum {
+  UP_IDLE = 0,
+  UP_RECEIVING,
+  UP_FAILED
+} up_state_t;
+
+static uint32_t stage[UPDATE_STAGE_SIZE / 4U] SRAM1_NOINIT;
+
+static volatile up_state_t state;
+static uint32_t size, image_crc, seq;
+static uint8_t begin_flags;
+static uint32_t last_sector;           // Of the image
+static uint32_t need_erase;            // Sectors not already blank, by bit
+static volatile uint32_t received;     // Bytes staged so far
+static volatile uint32_t programmed;   // Bytes in flash so far
+static volatile uint32_t erase_next;   // The next sector to erase, or skip
+static volatile uint32_t erased_to;    // Bank offset up to which it is ready
+static uint32_t run;                   // Bytes being programmed, 0 for an erase
+
+// The line: the rate to change to once the response has gone, and the
+// one BEGIN came at while it is changed
+static uint32_t new_baud, home_baud;
+static uint32_t last_heard;            // tick_now() of the last request
+static uint32_t started_at;
+static int reboot;
+
+// The response to the last good END, for an END sent again because that
+// response was lost
+static uint8_t end_resp[12];
+static int end_done;
+
+static update_stats_t stats;
+
+static inline uint32_t get_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+// The D-cache may hold what the inactive bank had before an erase or
+// program: drop it before reading the bank
+static void forget(uint32_t addr, uint32_t len) {
+  SCB_InvalidateDCache_by_Addr((uint32_t *)(uintptr_t)addr, (int32_t)len);
+}
+
+static int blank(uint32_t addr, uint32_t len) {
+  const uint32_t *p = (const uint32_t *)(uintptr_t)addr;
+  forget(addr, len);
+  for (uint32_t i = 0; i < len / 4U; i++) {
+    if (p[i] != 0xFFFFFFFFUL) return 0;
+  }
+  return 1;
+}
+
+static void flash_done(uint32_t error);
+
+// Start the next flash operation, if there is one and the flash is free.
+// Called with interrupts masked, or from the flash handler.
+static void kick(void) {
+  if (state != UP_RECEIVING || flash_busy()) return;
+
+  // Sectors found blank at BEGIN are ready as they are
+  while (erase_next <= last_sector && !(need_erase & (1UL << erase_next))) {
+    erase_next++;
+    erased_to = flash_sector_offset(erase_next);
+  }
+
+  uint32_t ready = received & ~3U;
+  uint32_t limit = erased_to > UPDATE_APP_OFFSET ? erased_to - UPDATE_APP_OFFSET : 0U;
+  if (limit > ready) limit = ready;
+  int may_program = !(begin_flags & UPDATE_BEGIN_SERIAL) || erase_next > last_sector;
+
+  if (may_program && programmed < limit) {
+    uint32_t at = programmed & (UPDATE_STAGE_SIZE - 1U);
+    run = limit - programmed;
+    if (run > UPDATE_STAGE_SIZE - at) run = UPDATE_STAGE_SIZE - at;
+    if (run > UPDATE_RUN_MAX) run = UPDATE_RUN_MAX;
+    flash_program_start(FLASH_INACTIVE_BASE + UPDATE_APP_OFFSET + programmed, &stage[at / 4U],
+                        run / 4U, flash_done);
+  } else if (erase_next <= last_sector) {
+    run = 0;
+    stats.erases++;
+    flash_erase_start(erase_next, flash_done);
+  }
+}
+
+static void flash_done(uint32_t error) {
+  if (error) {
+    state = UP_FAILED;
+    stats.failed++;
+    return;
+  }
+  if (run) {
+    programmed += run;
+  } else {
+    erase_next++;
+    erased_to = flash_sector_offset(erase_next);
+  }
+  kick();
+}
+
+static void kick_now(void) {
+  uint32_t s = critical_enter();
+  kick();
+  critical_exit(s);
+}
+
+// Sleep until the flash handler has moved things on
+static void wait(void) {
+  uint32_t s = critical_enter();
+  if (flash_busy()) __WFI();
+  critical_exit(s);
+}
+
+// Copy the running loader into the other bank unless it is there already:
+// the loader only boots a bank that has the same one
+static int copy_loader(void) {
+  const uint32_t *mine = (const uint32_t *)(uintptr_t)FLASHAXI_BASE;
+  const uint32_t *other = (const uint32_t *)(uintptr_t)FLASH_INACTIVE_BASE;
+
+  forget(FLASH_INACTIVE_BASE, LOADER_SIZE);
+  if (!memcmp(mine, other, LOADER_SIZE)) return 1;
+  flash_erase_start(0, NULL);
+  if (flash_wait()) return 0;
+  flash_program_start(FLASH_INACTIVE_BASE, mine, LOADER_SIZE / 4U, NULL);
+  if (flash_wait()) return 0;
+  forget(FLASH_INACTIVE_BASE, LOADER_SIZE);
+  return !memcmp(mine, other, LOADER_SIZE);
+}
+
+cmd_status_t update_begin(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len) {
+  const update_desc_t *active = (const update_desc_t *)(uintptr_t)(FLASHAXI_BASE + UPDATE_DESC_OFFSET);
+  uint32_t sz = get_le32(req->payload);
+  uint32_t max_baud = get_le32(req->payload + 8);
+
+  if (!sz || sz > UPDATE_APP_MAX || (sz & 3U)) return CMD_ERR_ARG;
+
+  // A BEGIN during an update starts it again
+  state = UP_IDLE;
+  end_done = 0;
+  flash_wait();
+  if (!flash_init()) return CMD_ERR_FAILED; // Not in dual-bank mode
+  if (!copy_loader()) {
+    stats.failed++;
+    return CMD_ERR_FAILED;
+  }
+
+  size = sz;
+  image_crc = get_le32(req->payload + 4);
+  begin_flags = req->len > 12U ? req->payload[12] : 0U;
+  seq = (active->magic == UPDATE_MAGIC ? active->seq : 0U) + 1U;
+  last_sector = flash_sector_of(UPDATE_APP_OFFSET + sz - 1U);
+  need_erase = 0;
+  for (uint32_t n = 1; n <= last_sector; n++) {
+    uint32_t at = FLASH_INACTIVE_BASE + flash_sector_offset(n);
+    if (!blank(at, flash_sector_size(n))) need_erase |= 1UL << n;
+  }
+  stats.sectors += last_sector;
+  received = programmed = 0;
+  stats.stage_peak = 0;
+  erase_next = 1;
+  erased_to = UPDATE_DESC_OFFSET;
+  reboot = 0;
+  started_at = last_heard = tick_now();
+  stats.started++;
+  state = UP_RECEIVING;
+  kick_now();
+
+  if (begin_flags & UPDATE_BEGIN_SERIAL) {
+    while (state == UP_RECEIVING && erase_next <= last_sector) wait();
+    if (state != UP_RECEIVING) return CMD_ERR_FAILED;
+  }
+
+  // Not a rate that has failed a trial (baud.h)
+  uint32_t baud = baud_pick(max_baud, UPDATE_BAUD_MAX_PPM);
+  uart_port_t *p = uart_port(UART_USART3);
+  if (baud != p->baud) {
+    if (!home_baud) home_baud = p->baud;
+    new_baud = baud;
+  }
+  put_le32(resp, baud);
+  put_le32(resp + 4, UPDATE_STAGE_SIZE);
+  *resp_len = 8;
+  return CMD_OK;
+}
+
+cmd_status_t update_data(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len) {
+  uint32_t off = get_le32(req->payload);
+  uint32_t n = req->len - 4U;
+  const uint8_t *src = req->payload + 4;
+  uint32_t next = received;
+  cmd_status_t status = CMD_OK;
+
+  last_heard = tick_now();
+  *resp_len = 4;
+  if (state != UP_RECEIVING) {
+    put_le32(resp, next);
+    return CMD_ERR_FAILED;
+  }
+  if (off > next) {
+    stats.gaps++;
+    status = CMD_ERR_ARG;
+  } else if (off + n <= next) {
+    stats.duplicates++;
+  } else if (off + n > size) {
+    status = CMD_ERR_ARG;
+  } else {
+    // Only the part not seen before
+    src += next - off;
+    n -= next - off;
+    if (UPDATE_STAGE_SIZE - (next - programmed) < n) {
+      stats.stage_waits++;
+      while (state == UP_RECEIVING && UPDATE_STAGE_SIZE - (next - programmed) < n) wait();
+      if (state != UP_RECEIVING) {
+        put_le32(resp, next);
+        return CMD_ERR_FAILED;
+      }
+    }
+    uint8_t *ring = (uint8_t *)stage;
+    uint32_t at = next & (UPDATE_STAGE_SIZE - 1U);
+    uint32_t first = UPDATE_STAGE_SIZE - at < n ? UPDATE_STAGE_SIZE - at : n;
+    memcpy(ring + at, src, first);
+    memcpy(ring, src + first, n - first);
+    RING_BARRIER(); // The bytes before the count that covers them
+    received = next += n;
+    if (next - programmed > stats.stage_peak) stats.stage_peak = next - programmed;
+    kick_now();
+
+    if (begin_flags & UPDATE_BEGIN_SERIAL) {
+      while (state == UP_RECEIVING && programmed < (next & ~3U)) wait();
+      if (state != UP_RECEIVING) status = CMD_ERR_FAILED;
+    }
+  }
+  put_le32(resp, next);
+  return status;
+}
+
+cmd_status_t update_end(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len) {
+  uint32_t flags = req->len ? req->payload[0] : 0U;
+  uint32_t base = FLASH_INACTIVE_BASE;
+
+  last_heard = tick_now();
+  if (state == UP_IDLE && end_done) {
+    memcpy(resp, end_resp, sizeof(end_resp));
+    *resp_len = sizeof(end_resp);
+    return CMD_OK;
+  }
+  if (state == UP_RECEIVING && received != size) {
+    put_le32(resp, received);
+    *resp_len = 4;
+    return CMD_ERR_ARG;
+  }
+  // Whatever happens now, the line goes back to its old rate after this
+  if (home_baud) new_baud = home_baud;
+  while (state == UP_RECEIVING && programmed < size) wait();
+  if (state != UP_RECEIVING) return CMD_ERR_FAILED;
+
+  forget(base + UPDATE_APP_OFFSET, size);
+  uint32_t crc = crc32((const void *)(uintptr_t)(base + UPDATE_APP_OFFSET), size);
+  put_le32(resp, crc);
+  *resp_len = 4;
+  if (crc != image_crc) {
+    state = UP_FAILED;
+    stats.failed++;
+    return CMD_ERR_FAILED;
+  }
+
+  // Last: from here on the loader may boot this bank
+  update_desc_t d = { UPDATE_MAGIC, seq, size, crc, 0 };
+  d.desc_crc = crc32(&d, offsetof(update_desc_t, desc_crc));
+  flash_program_start(base + UPDATE_DESC_OFFSET, (const uint32_t *)&d, sizeof(d) / 4U, NULL);
+  if (flash_wait()) {
+    state = UP_FAILED;
+    stats.failed++;
+    return CMD_ERR_FAILED;
+  }
+  flash_lock();
+
+  state = UP_IDLE;
+  stats.completed++;
+  stats.ms = (tick_now() - started_at) * 1000U / TICK_HZ;
+  reboot = (flags & UPDATE_END_REBOOT) != 0;
+  put_le32(resp + 4, stats.ms);
+  put_le32(resp + 8, seq);
+  *resp_len = 12;
+  memcpy(end_resp, resp, sizeof(end_resp));
+  end_done = 1;
+  return CMD_OK;
+}
+
+int update_poll(void) {
+  uart_port_t *p = uart_port(UART_USART3);
+
+  // The response asking for it has to be all the way out first
+  if (new_baud && !console_tx_busy()) {
+    uart_set_baud(p, new_baud);
+    if (new_baud == home_baud) home_baud = 0;
+    new_baud = 0;
+    last_heard = tick_now();
+  }
+  if ((state == UP_RECEIVING || home_baud) && !new_baud &&
+      tick_now() - last_heard > TICK_MS(UPDATE_IDLE_MS)) {
+    if (state == UP_RECEIVING) {
+      state = UP_IDLE;
+      stats.abandoned++;
+    }
+    if (home_baud) new_baud = home_baud;
+  }
+  if (reboot && !new_baud && !console_tx_busy()) {
+    reboot = 0;
+    return 1;
+  }
+  return 0;
+}
+
+int update_busy(void) {
+  return state == UP_RECEIVING || home_baud || new_baud || flash_busy();
+}
+
+const update_stats_t *update_stats(void) {
+  return &stats;
+}
@@ -0,0 +1,129 @@
+/*
+ * update.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Firmware update over the console line, into the flash bank that is
+ * not running (flash.h), as three cmd.h commands:
+ *
+ *   BEGIN  {size, crc, max_baud: u32, flags: u8}
+ *          -> {baud, stage: u32}
+ *          size is a multiple of 4 (pad with 0xFF) up to UPDATE_APP_MAX,
+ *          crc is crc.h's CRC-32 of it. Once the response has gone, the
+ *          line changes to `baud`: baud_pick() of max_baud within
+ *          UPDATE_BAUD_MAX_PPM, so never a rate that has failed a baud.h
+ *          trial. The host changes with it and waits UPDATE_SETTLE_MS
+ *          before sending more.
+ *   DATA   {offset: u32, up to UPDATE_CHUNK_MAX bytes}
+ *          -> {next: u32}, the offset the device wants next. A chunk it
+ *          already has is OK; one past `next` is CMD_ERR_ARG, and the
+ *          host goes back to `next`.
+ *   END    {flags: u8}
+ *          -> {crc, ms, seq: u32}
+ *          Waits for the flash, checks the image's CRC, then programs
+ *          the descriptor that makes the bank bootable. The line goes
+ *          back to the rate BEGIN came at after the response, and with
+ *          UPDATE_END_REBOOT update_poll() then asks for a reset.
+ *
+ * Bank layout, the same in both banks:
+ *   sector 0  (16K) the resident loader (loader.h); never erased here,
+ *                   except to copy the running one into the other bank
+ *   sector 1  (16K) the update descriptor, erased first, programmed last
+ *   sector 2+       the application, linked at 0x08008000
+ *
+ * The pipeline: DATA copies the chunk into a staging ring and returns,
+ * and the flash interrupt does the rest (kick() in update.c). Each time
+ * the flash finishes something it programs whatever is staged into
+ * erased space, else erases the next sector ahead of the data, skipping
+ * sectors already blank. So erases and programming overlap the line,
+ * and the host is only held up (DATA waits for room in the ring) when the
+ * flash falls behind. UPDATE_BEGIN_SERIAL does it the simple way for
+ * comparison: erase everything in BEGIN, then program each chunk before
+ * answering it.
+ *
+ * Sim/update-host.h is the host side, Sim/update-send the tool.
+ */
+
+#ifndef UPDATE_H_
+#define UPDATE_H_
+
+#include <stdint.h>
+
+#include "cmd.h"
+#include "flash.h"
+
+#define UPDATE_CMD_BEGIN 0x20U
+#define UPDATE_CMD_DATA  0x21U
+#define UPDATE_CMD_END   0x22U
+
+#define UPDATE_BEGIN_SERIAL 0x01U  // BEGIN flags
+#define UPDATE_END_REBOOT   0x01U  // END flags
+
+#define UPDATE_CHUNK_MAX (CMD_PAYLOAD_MAX - 4U)
+
+#define UPDATE_DESC_OFFSET 0x4000U  // Sector 1
+#define UPDATE_APP_OFFSET  0x8000U  // Sector 2
+#define UPDATE_APP_MAX     (FLASH_BANK_SIZE - UPDATE_APP_OFFSET)
+
+#define UPDATE_MAGIC 0x31445055UL  // "UPD1"
+
+// Staging ring for received data (SRAM1, not zeroed); a power of two
+#ifndef UPDATE_STAGE_SIZE
+#define UPDATE_STAGE_SIZE (64U * 1024U)
+#endif
+
+// Baud rate error the line may have at the high rate
+#ifndef UPDATE_BAUD_MAX_PPM
+#define UPDATE_BAUD_MAX_PPM 10000
+#endif
+
+// How long the host waits after a baud rate change before sending
+#define UPDATE_SETTLE_MS 5U
+
+// An update nobody sends anything for is abandoned, and the line goes
+// back to the rate BEGIN came at
+#ifndef UPDATE_IDLE_MS
+#define UPDATE_IDLE_MS 3000U
+#endif
+
+// At UPDATE_DESC_OFFSET in a bank: the loader boots the valid bank with
+// the highest seq. desc_crc covers the words before it.
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t size;
+  uint32_t crc;       // CRC-32 of the size bytes at UPDATE_APP_OFFSET
+  uint32_t desc_crc;
+} update_desc_t;
+
+typedef struct {
+  uint32_t started;      // BEGINs accepted
+  uint32_t completed;    // ENDs with a good image
+  uint32_t failed;       // Flash errors and bad CRCs
+  uint32_t abandoned;    // Idle for UPDATE_IDLE_MS
+  uint32_t duplicates;   // DATA chunks already received
+  uint32_t gaps;         // DATA chunks past the next offset
+  uint32_t erases;       // Sectors erased, of
+  uint32_t sectors;      // sectors the image and descriptor cover
+  uint32_t stage_waits;  // DATA chunks that had to wait for room
+  uint32_t stage_peak;   // Most bytes staged at once in the last update
+  uint32_t ms;           // BEGIN to END of the last update
+} update_stats_t;
+
+// Command handlers for the application's table (cmd.h)
+cmd_status_t update_begin(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len);
+cmd_status_t update_data(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len);
+cmd_status_t update_end(const cmd_msg_t *req, uint8_t *resp, uint32_t *resp_len);
+
+// From the main loop after cmd_poll(): changes the baud rate once the
+// response asking for it has gone, and abandons an idle update. Returns 1
+// when the device should reset into the new image.
+int update_poll(void);
+
+// An update is in progress: for power_init()'s busy table
+int update_busy(void);
+
+const update_stats_t *update_stats(void);
+
+#endif /* UPDATE_H_ */
@@ -0,0 +1,196 @@
+/*
+ * wave.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ * License: Apache License, Version 2.0
+ *          https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ * Timer-paced DMA from a table into GPIOB->BSRR. See wave.h.
+ *
+ * TIM8 time base: RM0410 Rev 5 Sec 17.3.1-17.3.2 p 559; DIER.UDE raises
+ *   a DMA request at each update event, Sec 17.4.4. The repetition
+ *   counter is left at 0 so that every overflow is an update.
+ * Timer clock: APB2 timers run at PCLK2, or 2 x PCLK2 if APB2 is
+ *   divided, Sec 5.2 p 150
+ * DMA2 Stream 1 Channel 7 is TIM8_UP: Sec 8.3.4 Table 28 p 229
+ * Double-buffer mode: Sec 8.3.10 p 235 - with the stream enabled only
+ *   the memory address register not in use (per CR.CT) may be written
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32f7xx.h"
+
+#include "clock.h"
+#include "critical.h"
+#include "sections.h"
+#include "wave.h"
+
+#define WAVE_TIM       TIM8
+#define WAVE_DMA       DMA2
+#define WAVE_STREAM    DMA2_Stream1
+#define WAVE_DMA_CHAN  7UL
+
+// All the stream 1 flags live in LISR/LIFCR bits 6-11
+#define DMA_S1_FLAGS (DMA_LIFCR_CTCIF1 | DMA_LIFCR_CHTIF1 | DMA_LIFCR_CTEIF1 | \
+                      DMA_LIFCR_CDMEIF1 | DMA_LIFCR_CFEIF1)
+
+static volatile uint8_t running;
+static wave_mode_t wave_mode;
+static uint32_t wave_len;
+static const uint32_t *volatile next;  // Table waiting to be swapped in
+static volatile uint8_t swap_stage;    // Memory addresses changed to it so far
+static wave_stats_t stats;
+
+int wave_compile(uint32_t *table, uint32_t len, const wave_pin_t *pins, uint32_t num_pins) {
+  uint32_t used = 0;
+
+  if (len == 0) return -1;
+  memset(table, 0, len * sizeof(table[0]));
+  for (uint32_t i = 0; i < num_pins; i++) {
+    const wave_pin_t *p = &pins[i];
+    if (p->pin > 15U || (used & (1UL << p->pin))) return -1;
+    used |= 1UL << p->pin;
+
+    int level = p->initial != 0;
+    uint32_t prev = 0;
+    table[0] |= level ? WAVE_SET(p->pin) : WAVE_RESET(p->pin);
+    for (uint32_t e = 0; e < p->num_edges; e++) {
+      uint32_t step = p->edges[e];
+      if (step <= prev || step >= len) return -1;
+      prev = step;
+      level = !level;
+      table[step] |= level ? WAVE_SET(p->pin) : WAVE_RESET(p->pin);
+    }
+  }
+  return 0;
+}
+
+// Stop the timer and the stream. Safe from the DMA interrupt.
+static void halt(void) {
+  WAVE_TIM->CR1 &= ~TIM_CR1_CEN;
+  WAVE_TIM->DIER = 0;
+  CLEAR_BIT(WAVE_STREAM->CR, DMA_SxCR_EN);
+  while (WAVE_STREAM->CR & DMA_SxCR_EN);
+  WAVE_DMA->LIFCR = DMA_S1_FLAGS;
+  next = NULL;
+  swap_stage = 0;
+  running = 0;
+}
+
+static void clean(const uint32_t *table, uint32_t len) {
+  SCB_CleanDCache_by_Addr((uint32_t *)(uintptr_t)table, (int32_t)(len * sizeof(table[0])));
+}
+
+uint32_t wave_start(const uint32_t *table, uint32_t len, uint32_t rate_hz, wave_mode_t mode) {
+  uint32_t pclk2 = clock_pclk2_hz();
+  uint32_t tim_clk = clock_hclk_hz() == pclk2 ? pclk2 : 2U * pclk2;
+
+  if (len == 0 || len > 0xFFFFU || rate_hz == 0 || rate_hz > tim_clk / 2U) return 0;
+
+  // Timer clocks per step, split between the prescaler and ARR
+  uint64_t period = ((uint64_t)tim_clk + rate_hz / 2U) / rate_hz;
+  uint64_t psc = (period - 1U) / 0x10000U;
+  if (psc > 0xFFFFU) return 0;
+  uint64_t arr = period / (psc + 1U) - 1U;
+
+  SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA2EN);
+  SET_BIT(RCC->APB2ENR, RCC_APB2ENR_TIM8EN);
+  halt();
+  clean(table, len);
+
+  // Count without requests until everything is set up
+  WAVE_TIM->CR1 = TIM_CR1_URS;
+  WAVE_TIM->PSC = (uint32_t)psc;
+  WAVE_TIM->ARR = (uint32_t)arr;
+  WAVE_TIM->RCR = 0;
+  WAVE_TIM->CNT = 0;
+  WAVE_TIM->EGR = TIM_EGR_UG; // Load PSC now
+  WAVE_TIM->SR = 0;
+
+  // Channel 7, word to word, memory increment, memory-to-peripheral,
+  // very high priority, interrupts on complete and error; circular
+  // mode plays the two memory addresses in turn, both on the table
+  WAVE_STREAM->PAR = (uint32_t)(uintptr_t)&GPIOB->BSRR;
+  WAVE_STREAM->M0AR = (uint32_t)(uintptr_t)table;
+  WAVE_STREAM->M1AR = (uint32_t)(uintptr_t)table;
+  WAVE_STREAM->NDTR = len;
+  WAVE_STREAM->FCR = 0; // Direct mode, no FIFO
+  WAVE_STREAM->CR = (WAVE_DMA_CHAN << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_PL |
+                    DMA_SxCR_MSIZE_1 | DMA_SxCR_PSIZE_1 | DMA_SxCR_MINC | DMA_SxCR_DIR_0 |
+                    (mode == WAVE_CIRCULAR ? DMA_SxCR_DBM : 0U) |
+                    DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+  wave_mode = mode;
+  wave_len = len;
+  running = 1;
+  WAVE_STREAM->CR |= DMA_SxCR_EN;
+
+  NVIC_EnableIRQ(DMA2_Stream1_IRQn);
+  WAVE_TIM->DIER = TIM_DIER_UDE;
+  WAVE_TIM->CR1 |= TIM_CR1_CEN;
+
+  return (uint32_t)(tim_clk / ((psc + 1U) * (arr + 1U)));
+}
+
+int wave_swap(const uint32_t *table) {
+  int ok = 0;
+  uint32_t primask = critical_enter();
+  if (running && wave_mode == WAVE_CIRCULAR && !next) {
+    clean(table, wave_len);
+    next = table;
+    swap_stage = 0;
+    ok = 1;
+  }
+  critical_exit(primask);
+  return ok;
+}
+
+int wave_swap_pending(void) {
+  return next != NULL;
+}
+
+void wave_stop(void) {
+  uint32_t primask = critical_enter();
+  halt();
+  critical_exit(primask);
+}
+
+int wave_busy(void) {
+  return running;
+}
+
+const wave_stats_t *wave_stats(void) {
+  return &stats;
+}
+
+ITCM_CODE void DMA2_Stream1_IRQHandler(void) {
+  uint32_t isr = WAVE_DMA->LISR;
+
+  WAVE_DMA->LIFCR = DMA_S1_FLAGS;
+  if (isr & DMA_LISR_TEIF1) {
+    stats.errors++;
+    halt();
+    return;
+  }
+  if (!(isr & DMA_LISR_TCIF1)) return;
+
+  stats.passes++;
+  if (wave_mode == WAVE_ONE_SHOT) {
+    halt();
+    return;
+  }
+  if (next) {
+    // The stream has just moved to the other memory address, so the one
+    // it left may change. The second time, the new table is playing.
+    uint32_t addr = (uint32_t)(uintptr_t)next;
+    if (WAVE_STREAM->CR & DMA_SxCR_CT) WAVE_STREAM->M0AR = addr;
+    else                               WAVE_STREAM->M1AR = addr;
+    if (++swap_stage == 2U) {
+      next = NULL;
+      swap_stage = 0;
+      stats.swaps++;
+    }
+  }
+}
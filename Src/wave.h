@@ -0,0 +1,84 @@
+/*
+ * wave.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Douglas P. Fields, Jr.
+ *
+ * Waveform engine: parallel pin patterns on GPIOB, played by hardware.
+ *
+ * A table holds one 32-bit BSRR word per step (set bits in 0-15, reset
+ * bits in 16-31). TIM8's update event requests DMA2 Stream 1 (channel 7,
+ * TIM8_UP: RM0410 Rev 5 Sec 8.3.4 Table 28), which copies the next word
+ * into GPIOB->BSRR. Edges land on timer periods, whatever the CPU is
+ * doing, and no interrupt runs except once per pass through the table.
+ * The DMA takes a few AHB cycles per word, so keep the step rate within
+ * the low tens of MHz: the timer does not wait for a request it raised.
+ *
+ * Circular mode runs the stream in double-buffer mode (Sec 8.3.10) with
+ * both memory addresses on the table. wave_swap() changes the idle one
+ * from the transfer-complete interrupt, so a new table starts exactly
+ * at a pass boundary - the second one after the call at the latest.
+ *
+ * One-shot mode plays the table once and stops the timer.
+ *
+ * Tables must stay put while in use, and be reachable by DMA2: not ITCM.
+ * They are cleaned from the D-cache when they are handed over.
+ *
+ * wave_compile() builds a table from a list of edges for each pin.
+ */
+
+#ifndef WAVE_H_
+#define WAVE_H_
+
+#include <stdint.h>
+
+typedef enum {
+  WAVE_ONE_SHOT,
+  WAVE_CIRCULAR,
+} wave_mode_t;
+
+// BSRR words
+#define WAVE_SET(PIN)   (1UL << (PIN))
+#define WAVE_RESET(PIN) (1UL << ((PIN) + 16U))
+
+// One pin's part in a table: it is driven to `initial` at step 0, then
+// toggles at each step in `edges` (ascending, all below the table length)
+typedef struct {
+  uint8_t pin;            // GPIOB pin, 0-15
+  uint8_t initial;        // Level at step 0
+  const uint32_t *edges;
+  uint32_t num_edges;
+} wave_pin_t;
+
+typedef struct {
+  uint32_t passes;  // Times through the table
+  uint32_t swaps;   // Tables swapped in
+  uint32_t errors;  // DMA transfer errors; each one stops the engine
+} wave_stats_t;
+
+// Fill table[0..len) from the pins' edges, leaving other pins alone.
+// Returns 0, or -1 if a pin or an edge is out of range or out of order.
+int wave_compile(uint32_t *table, uint32_t len, const wave_pin_t *pins, uint32_t num_pins);
+
+// Start playing table[0..len) (len up to 65535) at rate_hz steps per
+// second. The pins must already be outputs. table[0] goes out one step
+// after this returns. Stops anything already playing. Returns the rate
+// actually set (the timer clock divided down), or 0 if it cannot be.
+uint32_t wave_start(const uint32_t *table, uint32_t len, uint32_t rate_hz, wave_mode_t mode);
+
+// Circular mode: play `table`, the same length, from a pass boundary.
+// Returns 0 if nothing is playing or a swap is already waiting.
+int wave_swap(const uint32_t *table);
+
+// True while a swap waits for its pass boundary
+int wave_swap_pending(void);
+
+// Stop at once, leaving the pins as they are
+void wave_stop(void);
+
+// True while a table is playing
+int wave_busy(void);
+
+const wave_stats_t *wave_stats(void);
+
+#endif /* WAVE_H_ */
@@ -24,7 +24,7 @@
 
 .syntax unified
 .cpu cortex-m7
-.fpu softvfp
+.fpu fpv5-d16
 .thumb
 
 .global g_pfnVectors
@@ -41,12 +41,79 @@ defined in linker script */
 .word _sbss
 /* end address for the .bss section. defined in linker script */
 .word _ebss
+/* ITCM code: load address, start and end. defined in linker script */
+.word _siitcm
+.word _sitcm
+.word _eitcm
+/* DTCM data: load address, start and end, and its bss. defined in linker script */
+.word _sidtcm
+.word _sdtcm
+.word _edtcm
+.word _sdtcm_bss
+.word _edtcm_bss
+/* lowest address the stack may use. defined in linker script */
+.word _sstack
+
+/* Copy words from [r2] to [r0], up to r1: eight at a time with LDM/STM
+   while 32 bytes or more are left, then one at a time. All three must be
+   word aligned. Uses r3-r11. */
+.macro copy_block
+  b 2f
+1:
+  ldmia r2!, {r4-r11}
+  stmia r0!, {r4-r11}
+2:
+  subs r3, r1, r0
+  cmp  r3, #32
+  bhs  1b
+  b 4f
+3:
+  ldr  r3, [r2], #4
+  str  r3, [r0], #4
+4:
+  cmp  r0, r1
+  bcc  3b
+.endm
+
+/* Fill words at [r0], up to r1, with r4; as copy_block. Uses r3-r11. */
+.macro fill_block
+  mov  r5, r4
+  mov  r6, r4
+  mov  r7, r4
+  mov  r8, r4
+  mov  r9, r4
+  mov  r10, r4
+  mov  r11, r4
+  b 2f
+1:
+  stmia r0!, {r4-r11}
+2:
+  subs r3, r1, r0
+  cmp  r3, #32
+  bhs  1b
+  b 4f
+3:
+  str  r4, [r0], #4
+4:
+  cmp  r0, r1
+  bcc  3b
+.endm
+
+/* Record DWT->CYCCNT as boot_cycles[n] (Src/boot.h). Uses r3 and r12. */
+.macro boot_mark n
+  ldr  r3, =0xE0001004
+  ldr  r3, [r3]
+  ldr  r12, =boot_cycles
+  str  r3, [r12, #(4 * \n)]
+.endm
 
 /**
  * @brief  This is the code that gets called when the processor first
  *          starts execution following a reset event. Only the absolutely
  *          necessary set is performed, after which the application
  *          supplied main() routine is called.
+ *          Each phase is timed with the DWT cycle counter into
+ *          boot_cycles[], in DTCM .dtcm_noinit; Src/boot.c reports them.
  * @param  None
  * @retval : None
 */
@@ -57,42 +124,95 @@ defined in linker script */
 Reset_Handler:
   ldr   r0, =_estack
   mov   sp, r0          /* set stack pointer */
+
+/* The C code is built -mfloat-abi=hard -mfpu=fpv5-d16, so give it the FPU
+   (CP10 and CP11 full access, PM0253 Rev 5 Sec 4.7.1) before any of it
+   runs. With ASPEN and LSPEN (Sec 4.7.2; both set out of reset, but
+   nothing may have cleared them) exception entry reserves room for
+   S0-S15 and FPSCR and stores them only if the handler uses the FPU. */
+  ldr   r0, =0xE000ED88 /* SCB->CPACR */
+  ldr   r1, [r0]
+  orr   r1, r1, #0x00F00000
+  str   r1, [r0]
+  ldr   r0, =0xE000EF34 /* FPU->FPCCR */
+  ldr   r1, [r0]
+  orr   r1, r1, #0xC0000000
+  str   r1, [r0]
+  dsb
+  isb
+
+/* Start the cycle counter from 0, as cycles_init() in Src/cycles.h:
+   DEMCR.TRCENA, unlock the Cortex-M7 DWT, then CYCCNTENA */
+  ldr   r0, =0xE000EDFC /* CoreDebug->DEMCR */
+  ldr   r1, [r0]
+  orr   r1, r1, #0x01000000
+  str   r1, [r0]
+  ldr   r0, =0xE0001000 /* DWT */
+  ldr   r1, =0xC5ACCE55
+  str   r1, [r0, #0xFB0] /* LAR */
+  movs  r1, #0
+  str   r1, [r0, #4]    /* CYCCNT */
+  ldr   r1, [r0]
+  orr   r1, r1, #1      /* CTRL.CYCCNTENA */
+  str   r1, [r0]
+  boot_mark 0
+
 /* Call the clock system initialization function.*/
+/* (SystemInit() in system.c turns on the caches; it must not use .data/.bss) */
   bl  SystemInit
+  boot_mark 1
 
 /* Copy the data segment initializers from flash to SRAM */
   ldr r0, =_sdata
   ldr r1, =_edata
   ldr r2, =_sidata
-  movs r3, #0
-  b LoopCopyDataInit
-
-CopyDataInit:
-  ldr r4, [r2, r3]
-  str r4, [r0, r3]
-  adds r3, r3, #4
-
-LoopCopyDataInit:
-  adds r4, r0, r3
-  cmp r4, r1
-  bcc CopyDataInit
+  copy_block
+  boot_mark 2
+
+/* Copy the DTCM data initializers from flash */
+  ldr r0, =_sdtcm
+  ldr r1, =_edtcm
+  ldr r2, =_sidtcm
+  copy_block
+  boot_mark 3
+
+/* Copy the hot code from flash to ITCM-RAM */
+  ldr r0, =_sitcm
+  ldr r1, =_eitcm
+  ldr r2, =_siitcm
+  copy_block
+
+/* The code was written through the data side: let the stores complete
+   before anything is fetched from ITCM (Arm v7-M ARM Sec A3.7.3) */
+  dsb
+  isb
+  boot_mark 4
 
 /* Zero fill the bss segment. */
-  ldr r2, =_sbss
-  ldr r4, =_ebss
-  movs r3, #0
-  b LoopFillZerobss
-
-FillZerobss:
-  str  r3, [r2]
-  adds r2, r2, #4
-
-LoopFillZerobss:
-  cmp r2, r4
-  bcc FillZerobss
-
-/* Call static constructors */
-  bl __libc_init_array
+  ldr r0, =_sbss
+  ldr r1, =_ebss
+  movs r4, #0
+  fill_block
+  boot_mark 5
+
+/* Zero fill the DTCM bss. */
+  ldr r0, =_sdtcm_bss
+  ldr r1, =_edtcm_bss
+  movs r4, #0
+  fill_block
+  boot_mark 6
+
+/* Paint the unused stack, _sstack up to here, so that memstat.c can find
+   how deep it has ever been. The word must match MEMSTAT_PAINT. */
+  ldr r0, =_sstack
+  mov r1, sp
+  ldr r4, =0xC5C5C5C5
+  fill_block
+  boot_mark 7
+
+/* Call static constructors, unless Src/boot.h defers them to main() */
+  bl boot_reset_constructors
+  boot_mark 8
 /* Call the application's entry point.*/
   bl main
 
@@ -101,10 +221,69 @@ LoopForever:
 
   .size Reset_Handler, .-Reset_Handler
 
+/* The same loops, callable from C for Src/boot.c's comparison:
+   void boot_copy_block(uint32_t *dst, uint32_t *end, const uint32_t *src)
+   void boot_fill_block(uint32_t *dst, uint32_t *end, uint32_t value) */
+  .section .text.boot_copy_block
+  .global boot_copy_block
+  .type boot_copy_block, %function
+boot_copy_block:
+  push  {r4-r11}
+  copy_block
+  pop   {r4-r11}
+  bx    lr
+  .size boot_copy_block, .-boot_copy_block
+
+  .section .text.boot_fill_block
+  .global boot_fill_block
+  .type boot_fill_block, %function
+boot_fill_block:
+  push  {r4-r11}
+  mov   r4, r2
+  fill_block
+  pop   {r4-r11}
+  bx    lr
+  .size boot_fill_block, .-boot_fill_block
+
+/* The one-word-per-iteration loops Reset_Handler used before, kept to be
+   compared with: same arguments as above */
+  .section .text.boot_copy_word
+  .global boot_copy_word
+  .type boot_copy_word, %function
+boot_copy_word:
+  movs  r3, #0
+  b 2f
+1:
+  ldr   r12, [r2, r3]
+  str   r12, [r0, r3]
+  adds  r3, r3, #4
+2:
+  adds  r12, r0, r3
+  cmp   r12, r1
+  bcc   1b
+  bx    lr
+  .size boot_copy_word, .-boot_copy_word
+
+  .section .text.boot_fill_word
+  .global boot_fill_word
+  .type boot_fill_word, %function
+boot_fill_word:
+  b 2f
+1:
+  str   r2, [r0]
+  adds  r0, r0, #4
+2:
+  cmp   r0, r1
+  bcc   1b
+  bx    lr
+  .size boot_fill_word, .-boot_fill_word
+
 /**
  * @brief  This is the code that gets called when the processor receives an
  *         unexpected interrupt.  This simply enters an infinite loop, preserving
  *         the system state for examination by a debugger.
+ *         It stays in flash: a fault in SystemInit() or the copy loops
+ *         comes before the ITCM code is there to run.
  *
  * @param  None
  * @retval : None
@@ -115,6 +294,24 @@ Infinite_Loop:
   b Infinite_Loop
   .size Default_Handler, .-Default_Handler
 
+/**
+ * @brief  MemManage fault: with Src/memstat.c that is the stack running
+ *         into the guard region below _sstack. Nothing more can be pushed
+ *         there, so put SP back at the top and let memstat_stack_fault()
+ *         record the fault and reset.
+ *
+ * @param  None
+ * @retval : None
+*/
+  .section .itcm.MemManage_Handler,"ax",%progbits
+  .global MemManage_Handler
+  .type MemManage_Handler, %function
+MemManage_Handler:
+  ldr r0, =_estack
+  mov sp, r0
+  b memstat_stack_fault
+  .size MemManage_Handler, .-MemManage_Handler
+
 /******************************************************************************
 *
 * The STM32F767ZITx vector table.  Note that the proper constructs
@@ -268,8 +465,6 @@ g_pfnVectors:
 	.weak	HardFault_Handler
 	.thumb_set HardFault_Handler,Default_Handler
 
-	.weak	MemManage_Handler
-	.thumb_set MemManage_Handler,Default_Handler
 
 	.weak	BusFault_Handler
 	.thumb_set BusFault_Handler,Default_Handler